@@ -7,6 +7,7 @@
 #include "esp_netif.h"
 #include "lwip/ip4_addr.h"
 #include "bacnet/datalink/bip.h"
+#include "bacnet/datalink/biptask.h"
 #include "bacnet/datalink/bvlc.h"
 #include "bacnet/bacdcode.h"
 #include <lwip/sockets.h>
@@ -17,6 +18,10 @@ static BACNET_IP_ADDRESS My_Broadcast_Address = { {255, 255, 255, 255}, 0xBAC0 }
 
 /* UDP socket for BACnet/IP */
 static int bip_socket = -1;
+/* set by bip_receive_shutdown(); lwIP select() has no pipe to wake it,
+   so a wait without a timeout checks this every BIP_WAIT_SLICE_MS */
+static volatile bool bip_shutdown = false;
+#define BIP_WAIT_SLICE_MS 1000
 
 /**
  * Initialize BACnet/IP
@@ -100,6 +105,7 @@ bool bip_init(char *ifname)
     }
     
     printf("BACnet: UDP socket created and bound to port 0xBAC0\n");
+    bip_shutdown = false;
     
     return true;
 }
@@ -181,11 +187,10 @@ int bip_send_pdu(
     uint8_t *pdu,
     unsigned int pdu_len)
 {
-    struct sockaddr_in addr;
+    BACNET_IP_ADDRESS bip_dest;
     uint8_t tx_buffer[1502];  /* Max BACnet packet + BVLC header */
     int bvlc_len;
     int total_len;
-    int bytes_sent = 0;
     uint8_t bvlc_function = BVLC_ORIGINAL_UNICAST_NPDU;  /* Default to unicast */
     
     if (bip_socket < 0 || pdu == NULL || pdu_len == 0) {
@@ -225,42 +230,23 @@ int bip_send_pdu(
     /* Copy PDU after BVLC header */
     memcpy(&tx_buffer[4], pdu, pdu_len);
     
-    /* Build socket address from BACnet address */
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(
-        ((uint32_t)dest->adr[0] << 24) |
-        ((uint32_t)dest->adr[1] << 16) |
-        ((uint32_t)dest->adr[2] << 8) |
-        ((uint32_t)dest->adr[3])
-    );
-    addr.sin_port = htons(((uint16_t)dest->adr[4] << 8) | dest->adr[5]);
-    
-    /* Send UDP packet with BVLC wrapper */
-    bytes_sent = sendto(bip_socket, (const char *)tx_buffer, total_len, 0, 
-                       (struct sockaddr *)&addr, sizeof(addr));
-    
-    if (bytes_sent < 0) {
-        return 0;
-    }
+    /* Build B/IP address from BACnet address */
+    memcpy(&bip_dest.address[0], &dest->adr[0], 4);
+    bip_dest.port = ((uint16_t)dest->adr[4] << 8) | dest->adr[5];
     
-    return bytes_sent;
+    /* Send UDP packet with BVLC wrapper, or hold it in the batch */
+    return bip_send_mpdu(&bip_dest, tx_buffer, total_len);
 }
 
 /**
- * Send BACnet/IP MPDU (BVLC already encoded) to a B/IP address
+ * Send one datagram to a B/IP address
  */
-int bip_send_mpdu(
+static int bip_sendto(
     const BACNET_IP_ADDRESS *dest, const uint8_t *mtu, uint16_t mtu_len)
 {
     struct sockaddr_in addr;
     int bytes_sent = 0;
 
-    if (bip_socket < 0 || dest == NULL || mtu == NULL || mtu_len == 0) {
-        printf("BACnet: bip_send_mpdu() - invalid socket or MTU\n");
-        return 0;
-    }
-
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(
@@ -282,42 +268,65 @@ int bip_send_mpdu(
 }
 
 /**
- * Receive a BACnet/IP PDU from UDP socket
+ * Send BACnet/IP MPDU (BVLC already encoded) to a B/IP address
  */
-uint16_t bip_receive(
-    BACNET_ADDRESS *src,
-    uint8_t *pdu,
-    uint16_t max_pdu,
-    unsigned timeout)
+int bip_send_mpdu(
+    const BACNET_IP_ADDRESS *dest, const uint8_t *mtu, uint16_t mtu_len)
 {
-    struct sockaddr_in from_addr;
-    socklen_t from_len = sizeof(from_addr);
-    int received_bytes = 0;
-    uint16_t pdu_len = 0;
+    if (bip_socket < 0 || dest == NULL || mtu == NULL || mtu_len == 0) {
+        printf("BACnet: bip_send_mpdu() - invalid socket or MTU\n");
+        return 0;
+    }
+
+    /* sent later with the rest of the batch - see bip_send_batch_begin() */
+    if (bip_send_batch_queue(dest, mtu, mtu_len)) {
+        return mtu_len;
+    }
+
+    return bip_sendto(dest, mtu, mtu_len);
+}
+
+/**
+ * Send a batch of BACnet/IP MPDUs (BVLC already encoded).
+ * lwIP has no sendmmsg(), so this is one sendto() per datagram.
+ */
+int bip_send_mpdu_batch(const BIP_MPDU *batch, unsigned count)
+{
+    unsigned i;
+    int sent = 0;
+
+    if (bip_socket < 0) {
+        return -1;
+    }
+    if (batch == NULL) {
+        return 0;
+    }
+    for (i = 0; i < count; i++) {
+        if (bip_sendto(&batch[i].addr, batch[i].mtu, batch[i].mtu_len) > 0) {
+            sent++;
+        }
+    }
+
+    return sent;
+}
+
+/**
+ * Decode the BVLC header of one received datagram.
+ * Returns the offset of the NPDU in the datagram, or 0 if there is none.
+ */
+int bip_mpdu_handler(BIP_MPDU *mpdu, BACNET_ADDRESS *src)
+{
+    uint8_t *pdu = NULL;
     uint8_t bvlc_function = 0;
-    uint16_t bvlc_length = 0;
     int offset = 0;
-    
-    if (bip_socket < 0 || pdu == NULL || src == NULL) {
+
+    if (mpdu == NULL || mpdu->mtu == NULL || src == NULL) {
         return 0;
     }
-    
-    /* Set socket to non-blocking for timeout support */
-    struct timeval tv;
-    tv.tv_sec = timeout / 1000;
-    tv.tv_usec = (timeout % 1000) * 1000;
-    setsockopt(bip_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    
-    /* Receive UDP packet */
-    received_bytes = recvfrom(bip_socket, (char *)pdu, max_pdu, 0,
-                             (struct sockaddr *)&from_addr, &from_len);
-    
-    if (received_bytes <= 0) {
-        return 0;  /* No data or error */
-    }
+    pdu = mpdu->mtu;
     
     /* Decode BVLC header (4 bytes minimum) */
-    if (received_bytes < 4) {
+    if (mpdu->mtu_len < 4) {
         return 0;  /* Too short */
     }
     
@@ -327,51 +336,173 @@ uint16_t bip_receive(
     }
     
     bvlc_function = pdu[1];
-    bvlc_length = (pdu[2] << 8) | pdu[3];
     
-    /* Extract source address from socket */
+    /* Source address from socket */
     src->net = 0;  /* Local network */
     src->len = 6;  /* 4 bytes IP + 2 bytes port */
-    uint32_t from_ip = ntohl(from_addr.sin_addr.s_addr);
-    src->adr[0] = (from_ip >> 24) & 0xFF;
-    src->adr[1] = (from_ip >> 16) & 0xFF;
-    src->adr[2] = (from_ip >> 8) & 0xFF;
-    src->adr[3] = from_ip & 0xFF;
-    uint16_t from_port = ntohs(from_addr.sin_port);
-    src->adr[4] = (from_port >> 8) & 0xFF;
-    src->adr[5] = from_port & 0xFF;
+    memcpy(&src->adr[0], &mpdu->addr.address[0], 4);
+    src->adr[4] = (mpdu->addr.port >> 8) & 0xFF;
+    src->adr[5] = mpdu->addr.port & 0xFF;
     
     /* Process BVLC function */
     if (bvlc_function == BVLC_ORIGINAL_UNICAST_NPDU ||
         bvlc_function == BVLC_ORIGINAL_BROADCAST_NPDU) {
-        /* Original unicast/broadcast NPDU - return NPDU without BVLC header */
-        offset = 4;  /* Skip 4-byte BVLC header */
-        pdu_len = received_bytes - offset;
-        if (pdu_len > 0 && pdu_len <= max_pdu) {
-            /* Move NPDU to start of buffer (remove BVLC header) */
-            memmove(pdu, &pdu[offset], pdu_len);
-            return pdu_len;
-        }
+        /* Original unicast/broadcast NPDU - skip 4-byte BVLC header */
+        offset = 4;
     } else if (bvlc_function == BVLC_FORWARDED_NPDU) {
         /* Forwarded NPDU - skip BVLC header + 6 bytes original source */
         offset = 4 + 6;
-        pdu_len = received_bytes - offset;
-        if (pdu_len > 0 && pdu_len <= max_pdu && received_bytes >= offset) {
+        if (mpdu->mtu_len > offset) {
             /* Extract original source from forwarded message */
-            src->adr[0] = pdu[4];
-            src->adr[1] = pdu[5];
-            src->adr[2] = pdu[6];
-            src->adr[3] = pdu[7];
-            src->adr[4] = pdu[8];
-            src->adr[5] = pdu[9];
-            /* Move NPDU to start of buffer */
-            memmove(pdu, &pdu[offset], pdu_len);
-            return pdu_len;
+            memcpy(&src->adr[0], &pdu[4], 6);
         }
     }
     /* Ignore other BVLC functions like register, read-bdt, etc. */
+    if (offset == 0 || mpdu->mtu_len <= offset) {
+        return 0;
+    }
     
-    return 0;
+    return offset;
+}
+
+/**
+ * Receive a BACnet/IP PDU from UDP socket
+ */
+uint16_t bip_receive(
+    BACNET_ADDRESS *src,
+    uint8_t *pdu,
+    uint16_t max_pdu,
+    unsigned timeout)
+{
+    struct sockaddr_in from_addr;
+    socklen_t from_len = sizeof(from_addr);
+    int received_bytes = 0;
+    uint16_t pdu_len = 0;
+    BIP_MPDU mpdu = { 0 };
+    int offset = 0;
+    
+    if (bip_socket < 0 || pdu == NULL || src == NULL) {
+        return 0;
+    }
+    
+    /* wait for the datagram in select(): setting SO_RCVTIMEO on every
+       call costs a socket option round trip, and 0 would block forever */
+    if (timeout > 0 && bip_receive_wait(timeout) <= 0) {
+        return 0;
+    }
+    
+    /* Receive UDP packet - never blocks, so a timeout of 0 polls */
+    received_bytes = recvfrom(bip_socket, (char *)pdu, max_pdu, MSG_DONTWAIT,
+                             (struct sockaddr *)&from_addr, &from_len);
+    
+    if (received_bytes <= 0) {
+        return 0;  /* No data or error */
+    }
+    
+    /* B/IP address of the sender */
+    uint32_t from_ip = ntohl(from_addr.sin_addr.s_addr);
+    mpdu.addr.address[0] = (from_ip >> 24) & 0xFF;
+    mpdu.addr.address[1] = (from_ip >> 16) & 0xFF;
+    mpdu.addr.address[2] = (from_ip >> 8) & 0xFF;
+    mpdu.addr.address[3] = from_ip & 0xFF;
+    mpdu.addr.port = ntohs(from_addr.sin_port);
+    mpdu.mtu = pdu;
+    mpdu.mtu_size = max_pdu;
+    mpdu.mtu_len = (uint16_t)received_bytes;
+    
+    offset = bip_mpdu_handler(&mpdu, src);
+    if (offset > 0) {
+        /* Move NPDU to start of buffer (remove BVLC header) */
+        pdu_len = received_bytes - offset;
+        memmove(pdu, &pdu[offset], pdu_len);
+    }
+    
+    return pdu_len;
 }
 
+/**
+ * Receive the datagrams already queued on the socket, up to the size of
+ * the batch, without waiting. lwIP has no recvmmsg(), so this is one
+ * recvfrom() per datagram.
+ */
+int bip_receive_mpdu_batch(BIP_MPDU *batch, unsigned count)
+{
+    struct sockaddr_in from_addr;
+    socklen_t from_len;
+    int received_bytes = 0;
+    int received = 0;
+    uint32_t from_ip;
+    unsigned i;
+
+    if (bip_socket < 0) {
+        return -1;
+    }
+    if (batch == NULL) {
+        return 0;
+    }
+    for (i = 0; i < count; i++) {
+        from_len = sizeof(from_addr);
+        received_bytes = recvfrom(bip_socket, (char *)batch[i].mtu,
+                                  batch[i].mtu_size, MSG_DONTWAIT,
+                                  (struct sockaddr *)&from_addr, &from_len);
+        if (received_bytes <= 0) {
+            break;  /* nothing queued, or an error */
+        }
+        from_ip = ntohl(from_addr.sin_addr.s_addr);
+        batch[i].addr.address[0] = (from_ip >> 24) & 0xFF;
+        batch[i].addr.address[1] = (from_ip >> 16) & 0xFF;
+        batch[i].addr.address[2] = (from_ip >> 8) & 0xFF;
+        batch[i].addr.address[3] = from_ip & 0xFF;
+        batch[i].addr.port = ntohs(from_addr.sin_port);
+        batch[i].mtu_len = (uint16_t)received_bytes;
+        batch[i].broadcast = false;
+        received++;
+    }
+
+    return received;
+}
 
+/**
+ * Block until a datagram is queued on the socket, without receiving it.
+ * Returns positive if one is queued, 0 on timeout, or negative after
+ * bip_receive_shutdown() or if the socket is closed.
+ */
+int bip_receive_wait(unsigned timeout)
+{
+    fd_set read_fds;
+    struct timeval tv;
+    unsigned slice = 0;
+    int status = 0;
+
+    do {
+        if (bip_socket < 0 || bip_shutdown) {
+            return -1;
+        }
+        slice = timeout;
+        if (slice > BIP_WAIT_SLICE_MS) {
+            slice = BIP_WAIT_SLICE_MS;
+        }
+        tv.tv_sec = slice / 1000;
+        tv.tv_usec = (slice % 1000) * 1000;
+        FD_ZERO(&read_fds);
+        FD_SET(bip_socket, &read_fds);
+        status = select(bip_socket + 1, &read_fds, NULL, NULL, &tv);
+        if (status != 0) {
+            return (status > 0) ? status : -1;
+        }
+        if (timeout != BIP_RECEIVE_WAIT_FOREVER) {
+            timeout -= slice;
+        }
+    } while (timeout > 0);
+
+    return 0;
+}
+
+/**
+ * Make bip_receive_wait() return a negative value, within
+ * BIP_WAIT_SLICE_MS for a task that is already waiting
+ */
+void bip_receive_shutdown(void)
+{
+    bip_shutdown = true;
+}
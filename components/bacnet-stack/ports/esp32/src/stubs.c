@@ -13,23 +13,32 @@
 #include "bacnet/basic/sys/mstimer.h"
 
 /* datetime_local - used by device.c Update_Current_Time() 
-   Returns: bool, sets date and time pointers, UTC offset and daylight saving */
+   Returns: bool, sets date and time pointers, UTC offset and daylight saving.
+   There is no time source, so the clock starts at 2024-01-01 00:00:00 on
+   each boot and counts up from there: the Trend Log takes its samples and
+   time stamps from this clock. */
 bool datetime_local(
     BACNET_DATE *date,
     BACNET_TIME *time,
     int16_t *utc_offset_minutes,
     bool *is_dst)
 {
+    static bacnet_time_t boot_seconds = 0;
+    BACNET_DATE_TIME bdatetime = { 0 };
+    uint64_t uptime_us = (uint64_t)esp_timer_get_time();
+
+    if (boot_seconds == 0) {
+        datetime_set_values(&bdatetime, 2024, 1, 1, 0, 0, 0, 0);
+        boot_seconds = datetime_seconds_since_epoch(&bdatetime);
+    }
+    datetime_since_epoch_seconds(
+        &bdatetime, boot_seconds + (bacnet_time_t)(uptime_us / 1000000ULL));
+    bdatetime.time.hundredths = (uint8_t)((uptime_us / 10000ULL) % 100ULL);
     if (date) {
-        date->year = 2024;
-        date->month = 1;
-        date->day = 1;
+        *date = bdatetime.date;
     }
     if (time) {
-        time->hour = 0;
-        time->min = 0;
-        time->sec = 0;
-        time->hundredths = 0;
+        *time = bdatetime.time;
     }
     if (utc_offset_minutes) {
         *utc_offset_minutes = 0;
@@ -5,6 +5,10 @@
  * @date 2005
  * @copyright SPDX-License-Identifier: GPL-2.0-or-later WITH GCC-exception-2.0
  */
+#ifndef _GNU_SOURCE
+/* recvmmsg() and sendmmsg() */
+#define _GNU_SOURCE
+#endif
 #include <asm/types.h>
 #include <netinet/ether.h>
 #include <netinet/in.h>
@@ -27,6 +31,7 @@
 #include "bacnet/bacdcode.h"
 #include "bacnet/bacint.h"
 #include "bacnet/datalink/bip.h"
+#include "bacnet/datalink/biptask.h"
 #include "bacnet/basic/sys/debug.h"
 #include "bacnet/basic/bbmd/h_bbmd.h"
 #include "bacport.h"
@@ -34,6 +39,13 @@
 /* unix sockets */
 static int BIP_Socket = -1;
 static int BIP_Broadcast_Socket = -1;
+/* self-pipe: bip_receive_shutdown() makes it readable to wake a task
+   blocked in bip_receive_wait() */
+static int BIP_Wake_Pipe[2] = { -1, -1 };
+/* datagrams per recvmmsg() or sendmmsg() call */
+#if defined(MSG_WAITFORONE)
+#define BIP_MMSG_MAX 32
+#endif
 
 /* NOTE: we store address and port in network byte order
    since BACnet/IP uses network byte order for all address byte arrays
@@ -306,6 +318,10 @@ int bip_send_mpdu(
         }
         return BIP_Socket;
     }
+    /* sent later with the rest of the batch - see bip_send_batch_begin() */
+    if (bip_send_batch_queue(dest, mtu, mtu_len)) {
+        return mtu_len;
+    }
     /* load destination IP address */
     bip_dest.sin_family = AF_INET;
     memcpy(&bip_dest.sin_addr.s_addr, &dest->address[0], 4);
@@ -318,6 +334,126 @@ int bip_send_mpdu(
         sizeof(struct sockaddr));
 }
 
+/**
+ * @brief Send a batch of BACnet/IP MPDUs, each already encoded with its
+ *  BVLC header, with one sendmmsg() for up to BIP_MMSG_MAX datagrams.
+ * @param batch - datagrams and their destination B/IP addresses
+ * @param count - number of datagrams in the batch
+ * @return number of datagrams sent, or -1 if the driver is not
+ *  initialized.  A datagram the IP stack refuses is skipped, as a
+ *  failed sendto() would be, and the rest of the batch is still sent.
+ */
+int bip_send_mpdu_batch(const BIP_MPDU *batch, unsigned count)
+{
+    unsigned index = 0;
+    int sent = 0;
+#if defined(BIP_MMSG_MAX)
+    struct mmsghdr msg[BIP_MMSG_MAX];
+    struct iovec iov[BIP_MMSG_MAX];
+    struct sockaddr_in sin[BIP_MMSG_MAX];
+    unsigned length;
+    unsigned i;
+    int status;
+#endif
+
+    if (BIP_Socket < 0) {
+        return -1;
+    }
+    if (!batch) {
+        return 0;
+    }
+#if defined(BIP_MMSG_MAX)
+    while (index < count) {
+        length = count - index;
+        if (length > BIP_MMSG_MAX) {
+            length = BIP_MMSG_MAX;
+        }
+        memset(msg, 0, sizeof(msg[0]) * length);
+        memset(sin, 0, sizeof(sin[0]) * length);
+        for (i = 0; i < length; i++) {
+            sin[i].sin_family = AF_INET;
+            memcpy(
+                &sin[i].sin_addr.s_addr, &batch[index + i].addr.address[0], 4);
+            sin[i].sin_port = htons(batch[index + i].addr.port);
+            iov[i].iov_base = batch[index + i].mtu;
+            iov[i].iov_len = batch[index + i].mtu_len;
+            msg[i].msg_hdr.msg_name = &sin[i];
+            msg[i].msg_hdr.msg_namelen = sizeof(sin[i]);
+            msg[i].msg_hdr.msg_iov = &iov[i];
+            msg[i].msg_hdr.msg_iovlen = 1;
+            debug_print_ipv4(
+                "Sending MPDU->", &sin[i].sin_addr, sin[i].sin_port,
+                iov[i].iov_len);
+        }
+        status = sendmmsg(BIP_Socket, msg, length, 0);
+        if (status > 0) {
+            index += status;
+            sent += status;
+        } else if ((status < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            /* the first datagram was refused: drop it, keep the rest */
+            index++;
+        }
+    }
+#else
+    for (index = 0; index < count; index++) {
+        if (bip_send_mpdu(
+                &batch[index].addr, batch[index].mtu, batch[index].mtu_len) >
+            0) {
+            sent++;
+        }
+    }
+#endif
+
+    return sent;
+}
+
+/**
+ * @brief Pass one received BACnet/IP MPDU through the BVLC handler
+ * @param mpdu - the datagram, its source address, and which socket
+ *  it arrived on
+ * @param src - returns the source address of the NPDU
+ * @return offset of the NPDU in the datagram, or 0 if there is none
+ *  (a BVLC function, or a datagram that is not B/IP)
+ */
+int bip_mpdu_handler(BIP_MPDU *mpdu, BACNET_ADDRESS *src)
+{
+    int offset = 0;
+    int max = 0;
+
+    if (!mpdu || !mpdu->mtu || (mpdu->mtu_len == 0)) {
+        return 0;
+    }
+    /* the signature of a BACnet/IPv packet */
+    if (mpdu->mtu[0] != BVLL_TYPE_BACNET_IP) {
+        return 0;
+    }
+    /* Erase up to 16 bytes after the received bytes as safety margin to
+     * ensure that the decoding functions will run into a 'safe field'
+     * of zero, if for any reason they would overrun, when parsing the
+     * message. */
+    max = (int)mpdu->mtu_size - mpdu->mtu_len;
+    if (max > 0) {
+        if (max > 16) {
+            max = 16;
+        }
+        memset(&mpdu->mtu[mpdu->mtu_len], 0, max);
+    }
+    /* pass the packet into the BBMD handler */
+    if (mpdu->broadcast) {
+        offset = bvlc_broadcast_handler(
+            &mpdu->addr, src, mpdu->mtu, mpdu->mtu_len);
+    } else {
+        offset = bvlc_handler(&mpdu->addr, src, mpdu->mtu, mpdu->mtu_len);
+    }
+    if ((offset <= 0) || (offset >= mpdu->mtu_len)) {
+        return 0;
+    }
+
+    return offset;
+}
+
 /**
  * BACnet/IP Datalink Receive handler.
  *
@@ -336,7 +472,7 @@ uint16_t bip_receive(
     int max = 0;
     struct timeval select_timeout;
     struct sockaddr_in sin = { 0 };
-    BACNET_IP_ADDRESS addr = { 0 };
+    BIP_MPDU mpdu = { 0 };
     socklen_t sin_len = sizeof(sin);
     int received_bytes = 0;
     int offset = 0;
@@ -382,57 +518,209 @@ uint16_t bip_receive(
     if (received_bytes == 0) {
         return 0;
     }
-    /* the signature of a BACnet/IPv packet */
-    if (npdu[0] != BVLL_TYPE_BACNET_IP) {
-        return 0;
-    }
-    /* Erase up to 16 bytes after the received bytes as safety margin to
-     * ensure that the decoding functions will run into a 'safe field'
-     * of zero, if for any reason they would overrun, when parsing the
-     * message. */
-    max = (int)max_npdu - received_bytes;
-    if (max > 0) {
-        if (max > 16) {
-            max = 16;
-        }
-        memset(&npdu[received_bytes], 0, max);
-    }
     /* Data link layer addressing between B/IPv4 nodes consists of a 32-bit
        IPv4 address followed by a two-octet UDP port number (both of which
        shall be transmitted with the most significant octet first). This
        address shall be referred to as a B/IPv4 address.
     */
-    memcpy(&addr.address[0], &sin.sin_addr.s_addr, 4);
-    addr.port = ntohs(sin.sin_port);
+    memcpy(&mpdu.addr.address[0], &sin.sin_addr.s_addr, 4);
+    mpdu.addr.port = ntohs(sin.sin_port);
+    mpdu.mtu = npdu;
+    mpdu.mtu_size = max_npdu;
+    mpdu.mtu_len = (uint16_t)received_bytes;
+    mpdu.broadcast = (socket != BIP_Socket);
     debug_print_ipv4(
         "Received MPDU->", &sin.sin_addr, sin.sin_port, received_bytes);
-    /* pass the packet into the BBMD handler */
-    if (socket == BIP_Socket) {
-        offset = bvlc_handler(&addr, src, npdu, received_bytes);
-    } else {
-        offset = bvlc_broadcast_handler(&addr, src, npdu, received_bytes);
-    }
+    offset = bip_mpdu_handler(&mpdu, src);
     if (offset > 0) {
         npdu_len = received_bytes - offset;
         debug_print_ipv4(
             "Received NPDU->", &sin.sin_addr, sin.sin_port, npdu_len);
-        if (npdu_len <= max_npdu) {
-            /* shift the buffer to return a valid NPDU */
-            for (i = 0; i < npdu_len; i++) {
-                npdu[i] = npdu[offset + i];
-            }
-        } else {
-            if (BIP_Debug) {
-                debug_fprintf(stderr, "BIP: NPDU dropped!\n");
-                fflush(stderr);
-            }
-            npdu_len = 0;
+        /* shift the buffer to return a valid NPDU */
+        for (i = 0; i < npdu_len; i++) {
+            npdu[i] = npdu[offset + i];
         }
     }
 
     return npdu_len;
 }
 
+/**
+ * @brief Receive the datagrams already queued on one socket, up to the
+ *  size of the batch, without waiting
+ * @param sock - the socket
+ * @param broadcast - true for the broadcast socket
+ * @param batch - buffers to receive into
+ * @param count - number of buffers in the batch
+ * @return number of datagrams received, or -1 on a socket error
+ */
+static int bip_socket_receive_batch(
+    int sock, bool broadcast, BIP_MPDU *batch, unsigned count)
+{
+    int received = 0;
+    unsigned i;
+#if defined(BIP_MMSG_MAX)
+    struct mmsghdr msg[BIP_MMSG_MAX];
+    struct iovec iov[BIP_MMSG_MAX];
+    struct sockaddr_in sin[BIP_MMSG_MAX];
+
+    if (count > BIP_MMSG_MAX) {
+        count = BIP_MMSG_MAX;
+    }
+    memset(msg, 0, sizeof(msg[0]) * count);
+    for (i = 0; i < count; i++) {
+        iov[i].iov_base = batch[i].mtu;
+        iov[i].iov_len = batch[i].mtu_size;
+        msg[i].msg_hdr.msg_name = &sin[i];
+        msg[i].msg_hdr.msg_namelen = sizeof(sin[i]);
+        msg[i].msg_hdr.msg_iov = &iov[i];
+        msg[i].msg_hdr.msg_iovlen = 1;
+    }
+    received = recvmmsg(sock, msg, count, MSG_DONTWAIT, NULL);
+    if (received < 0) {
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK) ||
+                (errno == EINTR))
+            ? 0
+            : -1;
+    }
+    for (i = 0; i < (unsigned)received; i++) {
+        memcpy(&batch[i].addr.address[0], &sin[i].sin_addr.s_addr, 4);
+        batch[i].addr.port = ntohs(sin[i].sin_port);
+        batch[i].mtu_len = (uint16_t)msg[i].msg_len;
+        batch[i].broadcast = broadcast;
+        debug_print_ipv4(
+            "Received MPDU->", &sin[i].sin_addr, sin[i].sin_port,
+            batch[i].mtu_len);
+    }
+#else
+    struct sockaddr_in sin = { 0 };
+    socklen_t sin_len;
+    int received_bytes;
+
+    for (i = 0; i < count; i++) {
+        sin_len = sizeof(sin);
+        received_bytes = recvfrom(
+            sock, (char *)batch[i].mtu, batch[i].mtu_size, MSG_DONTWAIT,
+            (struct sockaddr *)&sin, &sin_len);
+        if (received_bytes < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) ||
+                (errno == EINTR)) {
+                break;
+            }
+            return (received > 0) ? received : -1;
+        }
+        memcpy(&batch[i].addr.address[0], &sin.sin_addr.s_addr, 4);
+        batch[i].addr.port = ntohs(sin.sin_port);
+        batch[i].mtu_len = (uint16_t)received_bytes;
+        batch[i].broadcast = broadcast;
+        received++;
+    }
+#endif
+
+    return received;
+}
+
+/**
+ * @brief Receive the datagrams already queued on the BACnet/IP sockets,
+ *  up to the size of the batch, with one recvmmsg() per socket.
+ *  Does not wait - see bip_receive_wait().
+ * @param batch - buffers to receive into; mtu and mtu_size are set by
+ *  the caller, the rest is returned for each datagram received
+ * @param count - number of buffers in the batch
+ * @return number of datagrams received, or -1 on a socket error
+ */
+int bip_receive_mpdu_batch(BIP_MPDU *batch, unsigned count)
+{
+    int received = 0;
+    int status = 0;
+
+    if (BIP_Socket < 0) {
+        return -1;
+    }
+    if (!batch || (count == 0)) {
+        return 0;
+    }
+    received = bip_socket_receive_batch(BIP_Socket, false, batch, count);
+    if (received < 0) {
+        return -1;
+    }
+    if ((BIP_Broadcast_Socket != BIP_Socket) && ((unsigned)received < count)) {
+        status = bip_socket_receive_batch(
+            BIP_Broadcast_Socket, true, &batch[received], count - received);
+        if (status > 0) {
+            received += status;
+        }
+    }
+
+    return received;
+}
+
+/**
+ * @brief Block until a datagram is queued on either BACnet/IP socket,
+ *  without receiving it
+ * @param timeout - milliseconds to wait, 0 to poll, or
+ *  BIP_RECEIVE_WAIT_FOREVER
+ * @return positive if a datagram is queued, 0 on timeout, or negative
+ *  after bip_receive_shutdown() or if the sockets are closed
+ */
+int bip_receive_wait(unsigned timeout)
+{
+    fd_set read_fds;
+    struct timeval select_timeout;
+    struct timeval *ptimeout = NULL;
+    int max = 0;
+    int status;
+
+    if (BIP_Socket < 0) {
+        return -1;
+    }
+    if (timeout != BIP_RECEIVE_WAIT_FOREVER) {
+        select_timeout.tv_sec = timeout / 1000;
+        select_timeout.tv_usec = 1000 * (timeout % 1000);
+        ptimeout = &select_timeout;
+    }
+    FD_ZERO(&read_fds);
+    FD_SET(BIP_Socket, &read_fds);
+    max = BIP_Socket;
+    if (BIP_Broadcast_Socket >= 0) {
+        FD_SET(BIP_Broadcast_Socket, &read_fds);
+        if (BIP_Broadcast_Socket > max) {
+            max = BIP_Broadcast_Socket;
+        }
+    }
+    if (BIP_Wake_Pipe[0] >= 0) {
+        FD_SET(BIP_Wake_Pipe[0], &read_fds);
+        if (BIP_Wake_Pipe[0] > max) {
+            max = BIP_Wake_Pipe[0];
+        }
+    }
+    status = select(max + 1, &read_fds, NULL, NULL, ptimeout);
+    if (status < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    if ((BIP_Wake_Pipe[0] >= 0) && FD_ISSET(BIP_Wake_Pipe[0], &read_fds)) {
+        /* left in the pipe so that every waiting task sees it */
+        return -1;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Wake every task blocked in bip_receive_wait() and make it return
+ *  a negative value until bip_cleanup()
+ */
+void bip_receive_shutdown(void)
+{
+    const uint8_t wake = 0;
+
+    if (BIP_Wake_Pipe[1] >= 0) {
+        if (write(BIP_Wake_Pipe[1], &wake, sizeof(wake)) < 0) {
+            debug_perror("BIP: wake pipe");
+        }
+    }
+}
+
 /**
  * The common send function for BACnet/IP application layer
  *
@@ -975,6 +1263,12 @@ bool bip_init(char *ifname)
         }
     }
 
+    if (BIP_Wake_Pipe[0] < 0) {
+        if (pipe(BIP_Wake_Pipe) < 0) {
+            BIP_Wake_Pipe[0] = -1;
+            BIP_Wake_Pipe[1] = -1;
+        }
+    }
     bvlc_init();
 
     return true;
@@ -1003,6 +1297,13 @@ void bip_cleanup(void)
         close(BIP_Broadcast_Socket);
     }
     BIP_Broadcast_Socket = -1;
+
+    if (BIP_Wake_Pipe[0] != -1) {
+        close(BIP_Wake_Pipe[0]);
+        close(BIP_Wake_Pipe[1]);
+    }
+    BIP_Wake_Pipe[0] = -1;
+    BIP_Wake_Pipe[1] = -1;
     /* these were set non-zero during interface configuration */
     BIP_Address.s_addr = 0;
     BIP_Broadcast_Addr.s_addr = 0;
@@ -0,0 +1,346 @@
+/**
+ * @file
+ * @brief An event driven RS-485 driver for the MS/TP datalink on a Linux
+ *  serial port or pseudo-terminal.
+ *
+ * The functions fill a struct dlmstp_rs485_driver.  Instead of a byte at a
+ * time, the serial port is read in bursts into a ring (mstpburst.c) that
+ * the MS/TP receive state machine consumes in one pass, and the wait
+ * function sleeps in poll() until data arrives or the timeout expires,
+ * the same way the ESP32 driver sleeps on its UART event queue.
+ *
+ * With a pseudo-terminal from RS485_TTY_Pty_Open() the driver needs no
+ * serial hardware, so the MS/TP datalink can be run in a host test.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/datalink/mstpburst.h"
+#include "rs485-tty.h"
+
+static char RS485_TTY_Name[128] = "/dev/ttyUSB0";
+static int RS485_TTY_Handle = -1;
+static uint32_t RS485_TTY_Baud = 38400;
+static MSTP_BURST_BUFFER RS485_TTY_Rx;
+/* microseconds of the monotonic clock when the line went silent */
+static uint64_t RS485_TTY_Silence_Start;
+/* arrival of the burst of the last byte read, for the silence reset
+   that the receive state machine does after each byte */
+static uint64_t RS485_TTY_Rx_Burst;
+static bool RS485_TTY_Rx_Burst_Pending;
+static uint32_t RS485_TTY_Wakeup_Count;
+
+static uint64_t rs485_tty_microseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static speed_t rs485_tty_speed(uint32_t baud)
+{
+    switch (baud) {
+        case 9600:
+            return B9600;
+        case 19200:
+            return B19200;
+        case 38400:
+            return B38400;
+        case 57600:
+            return B57600;
+        case 115200:
+            return B115200;
+        default:
+            break;
+    }
+
+    return B0;
+}
+
+/**
+ * @brief Configure the port for raw 8N1 at the current baud rate
+ */
+static void rs485_tty_configure(int handle)
+{
+    struct termios tio;
+    speed_t speed;
+
+    if (tcgetattr(handle, &tio) != 0) {
+        return;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    speed = rs485_tty_speed(RS485_TTY_Baud);
+    if (speed != B0) {
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+    }
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(handle, TCSANOW, &tio);
+}
+
+/**
+ * @brief Read everything the port has into the bursts, without blocking
+ */
+static void rs485_tty_read_bursts(void)
+{
+    uint32_t timestamp;
+    uint8_t *data;
+    ssize_t len;
+
+    if (RS485_TTY_Handle < 0) {
+        return;
+    }
+    timestamp = (uint32_t)rs485_tty_microseconds();
+    for (;;) {
+        data = MSTP_Burst_Write_Buffer(&RS485_TTY_Rx);
+        if (!data) {
+            /* the rest stays in the kernel until the bursts are read */
+            break;
+        }
+        len = read(RS485_TTY_Handle, data, MSTP_BURST_SIZE);
+        if (len <= 0) {
+            break;
+        }
+        MSTP_Burst_Write_Commit(&RS485_TTY_Rx, (uint16_t)len, timestamp);
+    }
+}
+
+/**
+ * @brief Set the serial port, or pseudo-terminal, to open on init
+ * @param ifname - name of the device, such as /dev/ttyUSB0 or /dev/pts/3
+ */
+void RS485_TTY_Set_Interface(const char *ifname)
+{
+    if (ifname) {
+        snprintf(RS485_TTY_Name, sizeof(RS485_TTY_Name), "%s", ifname);
+    }
+}
+
+/**
+ * @brief Create a pseudo-terminal to stand in for the RS-485 line.
+ *  The driver opens the slave; the caller is the rest of the bus, and
+ *  reads and writes the frames of the other nodes on the master.
+ * @param slave_name - place for the name of the slave device
+ * @param slave_name_size - size of the place for the name
+ * @return handle of the master side, or -1 on failure
+ */
+int RS485_TTY_Pty_Open(char *slave_name, size_t slave_name_size)
+{
+    int handle;
+
+    handle = posix_openpt(O_RDWR | O_NOCTTY);
+    if (handle < 0) {
+        return -1;
+    }
+    if ((grantpt(handle) != 0) || (unlockpt(handle) != 0) ||
+        (ptsname_r(handle, slave_name, slave_name_size) != 0)) {
+        close(handle);
+        return -1;
+    }
+    rs485_tty_configure(handle);
+
+    return handle;
+}
+
+/**
+ * @brief Open and configure the serial port
+ */
+void RS485_TTY_Init(void)
+{
+    if (RS485_TTY_Handle >= 0) {
+        return;
+    }
+    MSTP_Burst_Init(&RS485_TTY_Rx);
+    RS485_TTY_Handle =
+        open(RS485_TTY_Name, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (RS485_TTY_Handle < 0) {
+        perror(RS485_TTY_Name);
+        return;
+    }
+    rs485_tty_configure(RS485_TTY_Handle);
+    tcflush(RS485_TTY_Handle, TCIOFLUSH);
+    RS485_TTY_Silence_Start = rs485_tty_microseconds();
+}
+
+/**
+ * @brief Transmit a frame, and wait until it has been sent
+ * @param payload - frame to send
+ * @param payload_len - number of bytes in the frame
+ */
+void RS485_TTY_Send(const uint8_t *payload, uint16_t payload_len)
+{
+    struct pollfd pfd;
+    ssize_t written;
+    uint16_t offset = 0;
+
+    if ((RS485_TTY_Handle < 0) || !payload) {
+        return;
+    }
+    while (offset < payload_len) {
+        written =
+            write(RS485_TTY_Handle, &payload[offset], payload_len - offset);
+        if (written > 0) {
+            offset += (uint16_t)written;
+        } else if ((written < 0) && (errno == EAGAIN)) {
+            pfd.fd = RS485_TTY_Handle;
+            pfd.events = POLLOUT;
+            (void)poll(&pfd, 1, 10);
+        } else if ((written < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            break;
+        }
+    }
+    tcdrain(RS485_TTY_Handle);
+    RS485_TTY_Rx_Burst_Pending = false;
+    RS485_TTY_Silence_Start = rs485_tty_microseconds();
+}
+
+/**
+ * @brief Get the next received byte, or check if one is available
+ * @param buf - place for the byte, or NULL to only check
+ * @return true if a byte is available
+ */
+bool RS485_TTY_Read(uint8_t *buf)
+{
+    uint32_t timestamp = 0;
+    uint64_t now;
+
+    if (MSTP_Burst_Empty(&RS485_TTY_Rx)) {
+        rs485_tty_read_bursts();
+    }
+    if (!MSTP_Burst_Read(&RS485_TTY_Rx, buf, &timestamp)) {
+        return false;
+    }
+    if (buf) {
+        /* the line went silent when the burst arrived, not now */
+        now = rs485_tty_microseconds();
+        RS485_TTY_Rx_Burst = now - (uint32_t)((uint32_t)now - timestamp);
+        RS485_TTY_Rx_Burst_Pending = true;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Sleep until a byte is received, or the milliseconds elapse
+ * @param milliseconds - longest time to sleep
+ * @return true if a byte is available
+ */
+bool RS485_TTY_Wait(uint32_t milliseconds)
+{
+    struct pollfd pfd;
+
+    if (RS485_TTY_Handle < 0) {
+        return false;
+    }
+    if (MSTP_Burst_Empty(&RS485_TTY_Rx)) {
+        rs485_tty_read_bursts();
+    }
+    if (MSTP_Burst_Empty(&RS485_TTY_Rx)) {
+        pfd.fd = RS485_TTY_Handle;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        (void)poll(&pfd, 1, (int)milliseconds);
+        RS485_TTY_Wakeup_Count++;
+        if (pfd.revents & POLLIN) {
+            rs485_tty_read_bursts();
+        }
+    }
+
+    return !MSTP_Burst_Empty(&RS485_TTY_Rx);
+}
+
+/**
+ * @brief The send function blocks until the frame is sent
+ * @return false
+ */
+bool RS485_TTY_Transmitting(void)
+{
+    return false;
+}
+
+uint32_t RS485_TTY_Baud_Rate(void)
+{
+    return RS485_TTY_Baud;
+}
+
+/**
+ * @brief Set the baud rate.  A pseudo-terminal accepts any rate.
+ * @param baud - new baud rate
+ * @return true if the baud rate is supported
+ */
+bool RS485_TTY_Baud_Rate_Set(uint32_t baud)
+{
+    if (rs485_tty_speed(baud) == B0) {
+        return false;
+    }
+    RS485_TTY_Baud = baud;
+    if (RS485_TTY_Handle >= 0) {
+        rs485_tty_configure(RS485_TTY_Handle);
+    }
+
+    return true;
+}
+
+uint32_t RS485_TTY_Silence_Milliseconds(void)
+{
+    return (uint32_t)((rs485_tty_microseconds() - RS485_TTY_Silence_Start) /
+                      1000ULL);
+}
+
+uint32_t RS485_TTY_Silence_Microseconds(void)
+{
+    uint64_t microseconds;
+
+    microseconds = rs485_tty_microseconds() - RS485_TTY_Silence_Start;
+    if (microseconds > UINT32_MAX) {
+        return UINT32_MAX;
+    }
+
+    return (uint32_t)microseconds;
+}
+
+void RS485_TTY_Silence_Reset(void)
+{
+    if (RS485_TTY_Rx_Burst_Pending) {
+        RS485_TTY_Silence_Start = RS485_TTY_Rx_Burst;
+        RS485_TTY_Rx_Burst_Pending = false;
+    } else {
+        RS485_TTY_Silence_Start = rs485_tty_microseconds();
+    }
+}
+
+/**
+ * @brief Get the number of times the wait function went to sleep
+ * @return number of sleeps
+ */
+uint32_t RS485_TTY_Wakeups(void)
+{
+    return RS485_TTY_Wakeup_Count;
+}
+
+void RS485_TTY_Cleanup(void)
+{
+    if (RS485_TTY_Handle >= 0) {
+        close(RS485_TTY_Handle);
+        RS485_TTY_Handle = -1;
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * @file
+ * @brief API for an event driven RS-485 driver for the MS/TP datalink
+ *  (struct dlmstp_rs485_driver) on a Linux serial port or pseudo-terminal
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef RS485_TTY_H
+#define RS485_TTY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+void RS485_TTY_Set_Interface(const char *ifname);
+BACNET_STACK_EXPORT
+int RS485_TTY_Pty_Open(char *slave_name, size_t slave_name_size);
+
+/* functions of the struct dlmstp_rs485_driver */
+BACNET_STACK_EXPORT
+void RS485_TTY_Init(void);
+BACNET_STACK_EXPORT
+void RS485_TTY_Send(const uint8_t *payload, uint16_t payload_len);
+BACNET_STACK_EXPORT
+bool RS485_TTY_Read(uint8_t *buf);
+BACNET_STACK_EXPORT
+bool RS485_TTY_Transmitting(void);
+BACNET_STACK_EXPORT
+uint32_t RS485_TTY_Baud_Rate(void);
+BACNET_STACK_EXPORT
+bool RS485_TTY_Baud_Rate_Set(uint32_t baud);
+BACNET_STACK_EXPORT
+uint32_t RS485_TTY_Silence_Milliseconds(void);
+BACNET_STACK_EXPORT
+uint32_t RS485_TTY_Silence_Microseconds(void);
+BACNET_STACK_EXPORT
+void RS485_TTY_Silence_Reset(void);
+BACNET_STACK_EXPORT
+bool RS485_TTY_Wait(uint32_t milliseconds);
+
+BACNET_STACK_EXPORT
+uint32_t RS485_TTY_Wakeups(void);
+BACNET_STACK_EXPORT
+void RS485_TTY_Cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
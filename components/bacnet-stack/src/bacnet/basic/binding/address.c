@@ -10,6 +10,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 /* BACnet Stack defines - first */
 #include "bacnet/bacdef.h"
 /* BACnet Stack API */
@@ -41,14 +42,91 @@ static uint32_t Own_Device_ID = 0xFFFFFFFF;
 #define MAX_ADDRESS_CACHE 255
 #endif
 
+/* The entries are found by device ID and by MAC address with hash
+   indices, a free entry is taken from a list, the entry to drop when the
+   cache is full is the least recently used one, and the time to live of
+   the entries runs out on a timer wheel, so adding, finding and expiring
+   an entry does not walk the cache.  The links between entries are the
+   index of an entry plus one, so that zero, which is how the tables
+   start, is no entry. */
+#if (MAX_ADDRESS_CACHE > 65535)
+#error "MAX_ADDRESS_CACHE must be 65535 or less"
+#endif
+typedef uint16_t ADDRESS_LINK;
+
+/* buckets of each hash index, a power of two no smaller than the cache */
+#if !defined(ADDRESS_HASH_BITS)
+#if (MAX_ADDRESS_CACHE <= 16)
+#define ADDRESS_HASH_BITS 4
+#elif (MAX_ADDRESS_CACHE <= 64)
+#define ADDRESS_HASH_BITS 6
+#elif (MAX_ADDRESS_CACHE <= 256)
+#define ADDRESS_HASH_BITS 8
+#elif (MAX_ADDRESS_CACHE <= 1024)
+#define ADDRESS_HASH_BITS 10
+#elif (MAX_ADDRESS_CACHE <= 4096)
+#define ADDRESS_HASH_BITS 12
+#else
+#define ADDRESS_HASH_BITS 16
+#endif
+#endif
+#define ADDRESS_HASH_SIZE (1UL << ADDRESS_HASH_BITS)
+
 static struct Address_Cache_Entry {
     uint8_t Flags;
     uint32_t device_id;
     unsigned max_apdu;
     BACNET_ADDRESS address;
-    uint32_t TimeToLive;
+    /* clock time in seconds when the entry has expired, unless static */
+    uint32_t Expires;
+    /* next entry in the chain of the device ID and of the MAC address */
+    ADDRESS_LINK Device_Next;
+    ADDRESS_LINK Address_Next;
+    /* the free list, or the list of least recently used entries */
+    ADDRESS_LINK Next;
+    ADDRESS_LINK Prev;
+    /* the slot of the timers */
+    ADDRESS_LINK Timer_Next;
+    ADDRESS_LINK Timer_Prev;
+    /* list + 1 holding the entry, or 0 */
+    uint8_t List;
+    /* slot + 1 of the timers holding the entry, or 0 */
+    uint8_t Slot;
 } Address_Cache[MAX_ADDRESS_CACHE];
 
+static ADDRESS_LINK Address_Device_Hash[ADDRESS_HASH_SIZE];
+/* only bound entries have a MAC address to find */
+static ADDRESS_LINK Address_MAC_Hash[ADDRESS_HASH_SIZE];
+static unsigned Address_Bound_Count;
+/* entries that were used and are free again, linked through Next */
+static ADDRESS_LINK Address_Free_List;
+/* entries from this one up have never been used */
+static unsigned Address_Used;
+
+/* the entries that may be dropped for a new one, least recently used
+   first: bound ones, then those with a bind request outstanding */
+#define ADDRESS_LIST_BOUND 0
+#define ADDRESS_LIST_BIND_REQ 1
+static struct Address_Cache_List {
+    ADDRESS_LINK Head;
+    ADDRESS_LINK Tail;
+} Address_LRU[2];
+
+/* The time to live runs out on a hierarchical timer wheel, as do the
+   request timers of the TSM: a level of 64 slots of one second, then
+   one of 64 slots of 64 seconds, then one of 64 slots of 4096 seconds,
+   which covers three days.  Entries that live longer go around the top
+   level until they are in range. */
+#define ADDRESS_WHEEL_BITS 6
+#define ADDRESS_WHEEL_SLOTS (1U << ADDRESS_WHEEL_BITS)
+#define ADDRESS_WHEEL_MASK (ADDRESS_WHEEL_SLOTS - 1U)
+#define ADDRESS_WHEEL_LEVELS 3
+static ADDRESS_LINK Address_Wheel[ADDRESS_WHEEL_LEVELS * ADDRESS_WHEEL_SLOTS];
+/* the clock of the wheel, in seconds */
+static uint32_t Address_Clock;
+static unsigned Address_Timer_Count;
+static unsigned Address_Timer_Near_Count;
+
 /* State flags for cache entries */
 
 /* Address cache entry in use */
@@ -69,6 +147,325 @@ static struct Address_Cache_Entry {
 #define BAC_ADDR_SHORT_TIME BAC_ADDR_SECS_1HOUR
 #define BAC_ADDR_FOREVER 0xFFFFFFFF /* Permanent entry */
 
+/* the link to an entry */
+static ADDRESS_LINK address_link(const struct Address_Cache_Entry *pMatch)
+{
+    return (ADDRESS_LINK)((pMatch - &Address_Cache[0]) + 1);
+}
+
+/* Fibonacci hashing of a device ID */
+static unsigned address_device_hash(uint32_t device_id)
+{
+    return (unsigned)((uint32_t)(device_id * 2654435761UL) >>
+                      (32 - ADDRESS_HASH_BITS));
+}
+
+/* FNV-1a of the fields of an address that bacnet_address_same() compares */
+static unsigned address_mac_hash(const BACNET_ADDRESS *src)
+{
+    uint32_t hash = 2166136261UL;
+    uint8_t i;
+
+    hash = (hash ^ src->mac_len) * 16777619UL;
+    for (i = 0; (i < src->mac_len) && (i < MAX_MAC_LEN); i++) {
+        hash = (hash ^ src->mac[i]) * 16777619UL;
+    }
+    hash = (hash ^ (src->net & 0xFF)) * 16777619UL;
+    hash = (hash ^ (src->net >> 8)) * 16777619UL;
+    if (src->net) {
+        hash = (hash ^ src->len) * 16777619UL;
+        for (i = 0; (i < src->len) && (i < MAX_MAC_LEN); i++) {
+            hash = (hash ^ src->adr[i]) * 16777619UL;
+        }
+    }
+
+    return (unsigned)((uint32_t)(hash * 2654435761UL) >>
+                      (32 - ADDRESS_HASH_BITS));
+}
+
+/* Take a link out of a chain of a hash index */
+static void address_chain_remove(
+    ADDRESS_LINK *head, ADDRESS_LINK link, bool device_chain)
+{
+    struct Address_Cache_Entry *pMatch;
+    ADDRESS_LINK *next = head;
+
+    while (*next) {
+        pMatch = &Address_Cache[*next - 1];
+        if (*next == link) {
+            *next = device_chain ? pMatch->Device_Next : pMatch->Address_Next;
+            break;
+        }
+        next = device_chain ? &pMatch->Device_Next : &pMatch->Address_Next;
+    }
+}
+
+/* Find the entry in use for a device ID */
+static struct Address_Cache_Entry *address_device_find(uint32_t device_id)
+{
+    struct Address_Cache_Entry *pMatch;
+    ADDRESS_LINK link;
+
+    link = Address_Device_Hash[address_device_hash(device_id)];
+    while (link) {
+        pMatch = &Address_Cache[link - 1];
+        if (pMatch->device_id == device_id) {
+            return pMatch;
+        }
+        link = pMatch->Device_Next;
+    }
+
+    return NULL;
+}
+
+/* Give a bound entry its MAC address and put it into the index */
+static void address_mac_bind(
+    struct Address_Cache_Entry *pMatch, const BACNET_ADDRESS *src)
+{
+    unsigned hash;
+
+    if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
+        address_chain_remove(
+            &Address_MAC_Hash[address_mac_hash(&pMatch->address)],
+            address_link(pMatch), false);
+        Address_Bound_Count--;
+    }
+    bacnet_address_copy(&pMatch->address, src);
+    pMatch->Flags &= ~BAC_ADDR_BIND_REQ;
+    hash = address_mac_hash(&pMatch->address);
+    pMatch->Address_Next = Address_MAC_Hash[hash];
+    Address_MAC_Hash[hash] = address_link(pMatch);
+    Address_Bound_Count++;
+}
+
+/* Take an entry out of its list of least recently used entries */
+static void address_lru_remove(struct Address_Cache_Entry *pMatch)
+{
+    struct Address_Cache_List *list;
+
+    if (!pMatch->List) {
+        return;
+    }
+    list = &Address_LRU[pMatch->List - 1];
+    if (pMatch->Prev) {
+        Address_Cache[pMatch->Prev - 1].Next = pMatch->Next;
+    } else {
+        list->Head = pMatch->Next;
+    }
+    if (pMatch->Next) {
+        Address_Cache[pMatch->Next - 1].Prev = pMatch->Prev;
+    } else {
+        list->Tail = pMatch->Prev;
+    }
+    pMatch->Next = 0;
+    pMatch->Prev = 0;
+    pMatch->List = 0;
+}
+
+/* Make an entry the most recently used one of its list; static entries
+   are never dropped, so they are in no list */
+static void address_lru_touch(struct Address_Cache_Entry *pMatch)
+{
+    struct Address_Cache_List *list;
+    unsigned list_index;
+
+    address_lru_remove(pMatch);
+    if (pMatch->Flags & BAC_ADDR_STATIC) {
+        return;
+    }
+    list_index = (pMatch->Flags & BAC_ADDR_BIND_REQ) ? ADDRESS_LIST_BIND_REQ
+                                                      : ADDRESS_LIST_BOUND;
+    list = &Address_LRU[list_index];
+    pMatch->List = (uint8_t)(list_index + 1);
+    pMatch->Prev = list->Tail;
+    pMatch->Next = 0;
+    if (list->Tail) {
+        Address_Cache[list->Tail - 1].Next = address_link(pMatch);
+    } else {
+        list->Head = address_link(pMatch);
+    }
+    list->Tail = address_link(pMatch);
+}
+
+/* Put an entry into the slot of the wheel for its expiry time */
+static void address_timer_insert(struct Address_Cache_Entry *pMatch)
+{
+    uint32_t expires = pMatch->Expires;
+    unsigned level = 0;
+    unsigned slot;
+
+    while ((level < (ADDRESS_WHEEL_LEVELS - 1U)) &&
+           (((expires >> (level * ADDRESS_WHEEL_BITS)) -
+             (Address_Clock >> (level * ADDRESS_WHEEL_BITS))) >=
+            ADDRESS_WHEEL_SLOTS)) {
+        level++;
+    }
+    slot = (level * ADDRESS_WHEEL_SLOTS) +
+        ((expires >> (level * ADDRESS_WHEEL_BITS)) & ADDRESS_WHEEL_MASK);
+    pMatch->Slot = (uint8_t)(slot + 1U);
+    pMatch->Timer_Prev = 0;
+    pMatch->Timer_Next = Address_Wheel[slot];
+    if (pMatch->Timer_Next) {
+        Address_Cache[pMatch->Timer_Next - 1].Timer_Prev =
+            address_link(pMatch);
+    }
+    Address_Wheel[slot] = address_link(pMatch);
+    Address_Timer_Count++;
+    if (level == 0) {
+        Address_Timer_Near_Count++;
+    }
+}
+
+/* Take an entry out of the wheel */
+static void address_timer_stop(struct Address_Cache_Entry *pMatch)
+{
+    unsigned slot;
+
+    if (!pMatch->Slot) {
+        return;
+    }
+    slot = pMatch->Slot - 1U;
+    if (pMatch->Timer_Prev) {
+        Address_Cache[pMatch->Timer_Prev - 1].Timer_Next = pMatch->Timer_Next;
+    } else {
+        Address_Wheel[slot] = pMatch->Timer_Next;
+    }
+    if (pMatch->Timer_Next) {
+        Address_Cache[pMatch->Timer_Next - 1].Timer_Prev = pMatch->Timer_Prev;
+    }
+    pMatch->Slot = 0;
+    pMatch->Timer_Next = 0;
+    pMatch->Timer_Prev = 0;
+    Address_Timer_Count--;
+    if (slot < ADDRESS_WHEEL_SLOTS) {
+        Address_Timer_Near_Count--;
+    }
+}
+
+/* Set the time to live of an entry, in seconds: it expires once more than
+   that has passed.  Static entries do not expire. */
+static void
+address_ttl_set(struct Address_Cache_Entry *pMatch, uint32_t seconds)
+{
+    address_timer_stop(pMatch);
+    if (pMatch->Flags & BAC_ADDR_STATIC) {
+        return;
+    }
+    if (seconds >= BAC_ADDR_FOREVER) {
+        seconds = BAC_ADDR_FOREVER - 1;
+    }
+    pMatch->Expires = Address_Clock + seconds + 1;
+    address_timer_insert(pMatch);
+}
+
+/* The time to live of an entry, in seconds */
+static uint32_t address_ttl(const struct Address_Cache_Entry *pMatch)
+{
+    if (pMatch->Flags & BAC_ADDR_STATIC) {
+        return BAC_ADDR_FOREVER;
+    }
+
+    return pMatch->Expires - Address_Clock - 1;
+}
+
+/* Free an entry and take it out of every index, list and timer */
+static void address_entry_free(struct Address_Cache_Entry *pMatch)
+{
+    if ((pMatch->Flags & BAC_ADDR_IN_USE) == 0) {
+        return;
+    }
+    address_chain_remove(
+        &Address_Device_Hash[address_device_hash(pMatch->device_id)],
+        address_link(pMatch), true);
+    if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
+        address_chain_remove(
+            &Address_MAC_Hash[address_mac_hash(&pMatch->address)],
+            address_link(pMatch), false);
+        Address_Bound_Count--;
+    }
+    address_lru_remove(pMatch);
+    address_timer_stop(pMatch);
+    pMatch->Flags = 0;
+    pMatch->Device_Next = 0;
+    pMatch->Address_Next = 0;
+    pMatch->Next = Address_Free_List;
+    Address_Free_List = address_link(pMatch);
+}
+
+/**
+ * @brief Drop the least recently used entry to make room for another one.
+ * Bound entries are dropped first, except the protected ones, then those
+ * with a bind request outstanding.  Static entries are never dropped.
+ * Does not check for free entries as it is assumed we are calling this
+ * due to the lack of those.
+ *
+ * @return true if an entry was dropped
+ */
+static bool address_remove_oldest(void)
+{
+    struct Address_Cache_Entry *pMatch;
+    ADDRESS_LINK link;
+
+    if (Top_Protected_Entry > (MAX_ADDRESS_CACHE - 1)) {
+        return false;
+    }
+    /* First pass - try only bound entries */
+    link = Address_LRU[ADDRESS_LIST_BOUND].Head;
+    while (link && ((uint32_t)(link - 1) < Top_Protected_Entry)) {
+        link = Address_Cache[link - 1].Next;
+    }
+    if (!link) {
+        /* Second pass - try un bound as last resort */
+        link = Address_LRU[ADDRESS_LIST_BIND_REQ].Head;
+    }
+    if (!link) {
+        return false;
+    }
+    pMatch = &Address_Cache[link - 1];
+    address_entry_free(pMatch);
+
+    return true;
+}
+
+/**
+ * @brief Take a free entry for a device, dropping the least recently used
+ * entry if the cache is full, and put it into the device ID index.
+ *
+ * @param device_id  ID of the device
+ * @param flags  State flags of the new entry
+ *
+ * @return Pointer to the entry, or NULL if there is no room.
+ */
+static struct Address_Cache_Entry *
+address_entry_new(uint32_t device_id, uint8_t flags)
+{
+    struct Address_Cache_Entry *pMatch = NULL;
+    unsigned hash;
+
+    if (!Address_Free_List && (Address_Used >= MAX_ADDRESS_CACHE)) {
+        if (!address_remove_oldest()) {
+            return NULL;
+        }
+    }
+    if (Address_Free_List) {
+        pMatch = &Address_Cache[Address_Free_List - 1];
+        Address_Free_List = pMatch->Next;
+    } else {
+        pMatch = &Address_Cache[Address_Used];
+        Address_Used++;
+    }
+    pMatch->Flags = flags;
+    pMatch->device_id = device_id;
+    pMatch->Next = 0;
+    pMatch->Prev = 0;
+    pMatch->List = 0;
+    hash = address_device_hash(device_id);
+    pMatch->Device_Next = Address_Device_Hash[hash];
+    Address_Device_Hash[hash] = address_link(pMatch);
+
+    return pMatch;
+}
+
 /**
  * @brief Set the index of the first (top) address being protected.
  *
@@ -99,90 +496,67 @@ void address_own_device_id_set(uint32_t own_id)
 void address_remove_device(uint32_t device_id)
 {
     struct Address_Cache_Entry *pMatch;
-    uint32_t index = 0;
 
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            pMatch->Flags = 0;
-            if (index < Top_Protected_Entry) {
-                Top_Protected_Entry--;
-            }
-            break;
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        if ((uint32_t)(pMatch - &Address_Cache[0]) < Top_Protected_Entry) {
+            Top_Protected_Entry--;
         }
+        address_entry_free(pMatch);
     }
 
     return;
 }
 
-/**
- * @brief Search the cache for the entry nearest expiry and delete it. Mark the
- * entry as reserved with a 1 hour TTL and return a pointer to the reserved
- * entry. Will not delete a static entry and returns NULL pointer if no
- * entry available to free up. Does not check for free entries as it is
- * assumed we are calling this due to the lack of those.
- *
- * @return Pointer to the entry that has been removed or NULL.
- */
-static struct Address_Cache_Entry *address_remove_oldest(void)
+/* Put the entries in use back into the indices, lists and timers, and the
+   others into the free list, lowest index first */
+static void address_cache_rebuild(void)
 {
     struct Address_Cache_Entry *pMatch;
-    struct Address_Cache_Entry *pCandidate;
-    uint32_t ulTime;
+    unsigned hash;
     unsigned index;
 
-    pCandidate = NULL;
-    if (Top_Protected_Entry > (MAX_ADDRESS_CACHE - 1)) {
-        return pCandidate;
-    }
-    /* Longest possible non static time to live */
-    ulTime = BAC_ADDR_FOREVER - 1;
-
-    /* First pass - try only in use and bound entries */
-
-    for (index = Top_Protected_Entry; index < MAX_ADDRESS_CACHE; index++) {
+    memset(Address_Device_Hash, 0, sizeof(Address_Device_Hash));
+    memset(Address_MAC_Hash, 0, sizeof(Address_MAC_Hash));
+    memset(Address_LRU, 0, sizeof(Address_LRU));
+    memset(Address_Wheel, 0, sizeof(Address_Wheel));
+    Address_Bound_Count = 0;
+    Address_Timer_Count = 0;
+    Address_Timer_Near_Count = 0;
+    Address_Free_List = 0;
+    Address_Used = MAX_ADDRESS_CACHE;
+    index = MAX_ADDRESS_CACHE;
+    while (index > 0) {
+        index--;
         pMatch = &Address_Cache[index];
-        if ((pMatch->Flags &
-             (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ | BAC_ADDR_STATIC)) ==
-            BAC_ADDR_IN_USE) {
-            if (pMatch->TimeToLive <= ulTime) {
-                /* Shorter lived entry found */
-                ulTime = pMatch->TimeToLive;
-                pCandidate = pMatch;
-            }
+        pMatch->Next = 0;
+        pMatch->Prev = 0;
+        pMatch->List = 0;
+        pMatch->Slot = 0;
+        pMatch->Timer_Next = 0;
+        pMatch->Timer_Prev = 0;
+        pMatch->Device_Next = 0;
+        pMatch->Address_Next = 0;
+        if ((pMatch->Flags & BAC_ADDR_IN_USE) == 0) {
+            pMatch->Flags = 0;
+            pMatch->Next = Address_Free_List;
+            Address_Free_List = address_link(pMatch);
+            continue;
         }
-    }
-
-    if (pCandidate != NULL) {
-        /* Found something to free up */
-        pCandidate->Flags = BAC_ADDR_RESERVED;
-        /* only reserve it for a short while */
-        pCandidate->TimeToLive = BAC_ADDR_SHORT_TIME;
-        return (pCandidate);
-    }
-
-    /* Second pass - try in use and un bound as last resort */
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if ((pMatch->Flags &
-             (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ | BAC_ADDR_STATIC)) ==
-            ((uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ))) {
-            if (pMatch->TimeToLive <= ulTime) { /* Shorter lived entry found */
-                ulTime = pMatch->TimeToLive;
-                pCandidate = pMatch;
-            }
+        hash = address_device_hash(pMatch->device_id);
+        pMatch->Device_Next = Address_Device_Hash[hash];
+        Address_Device_Hash[hash] = address_link(pMatch);
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
+            hash = address_mac_hash(&pMatch->address);
+            pMatch->Address_Next = Address_MAC_Hash[hash];
+            Address_MAC_Hash[hash] = address_link(pMatch);
+            Address_Bound_Count++;
+        }
+        address_lru_touch(pMatch);
+        if ((pMatch->Flags & BAC_ADDR_STATIC) == 0) {
+            address_timer_insert(pMatch);
         }
     }
-
-    if (pCandidate != NULL) {
-        /* Found something to free up */
-        pCandidate->Flags = BAC_ADDR_RESERVED;
-        /* only reserve it for a short while */
-        pCandidate->TimeToLive = BAC_ADDR_SHORT_TIME;
-    }
-
-    return (pCandidate);
 }
 
 #ifdef BACNET_ADDRESS_CACHE_FILE
@@ -262,6 +636,7 @@ void address_init(void)
         pMatch = &Address_Cache[index];
         pMatch->Flags = 0;
     }
+    address_cache_rebuild();
 #ifdef BACNET_ADDRESS_CACHE_FILE
     address_file_init(Address_Cache_Filename);
 #endif
@@ -285,7 +660,7 @@ void address_init_partial(void)
         if ((pMatch->Flags & BAC_ADDR_IN_USE) != 0) {
             /* It's in use so let's check further */
             if (((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0) ||
-                (pMatch->TimeToLive == 0)) {
+                (address_ttl(pMatch) == 0)) {
                 pMatch->Flags = 0;
             }
         }
@@ -295,6 +670,7 @@ void address_init_partial(void)
             pMatch->Flags = 0;
         }
     }
+    address_cache_rebuild();
 #ifdef BACNET_ADDRESS_CACHE_FILE
     address_file_init(Address_Cache_Filename);
 #endif
@@ -316,27 +692,20 @@ void address_set_device_TTL(
     uint32_t device_id, uint32_t TimeOut, bool StaticFlag)
 {
     struct Address_Cache_Entry *pMatch;
-    unsigned index;
 
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
-                /* If bound then we have either static or normaal */
-                if (StaticFlag) {
-                    pMatch->Flags |= BAC_ADDR_STATIC;
-                    pMatch->TimeToLive = BAC_ADDR_FOREVER;
-                } else {
-                    pMatch->Flags &= ~BAC_ADDR_STATIC;
-                    pMatch->TimeToLive = TimeOut;
-                }
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
+            /* If bound then we have either static or normaal */
+            if (StaticFlag) {
+                pMatch->Flags |= BAC_ADDR_STATIC;
             } else {
-                /* For unbound we can only set the time to live */
-                pMatch->TimeToLive = TimeOut;
+                pMatch->Flags &= ~BAC_ADDR_STATIC;
             }
-            break; /* Exit now if found at all - bound or unbound */
         }
+        /* For unbound we can only set the time to live */
+        address_ttl_set(pMatch, TimeOut);
+        address_lru_touch(pMatch);
     }
 }
 
@@ -352,24 +721,17 @@ bool address_get_by_device(
 {
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
-    unsigned index;
 
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
-                /* If bound then fetch data */
-                bacnet_address_copy(src, &pMatch->address);
-                if (max_apdu) {
-                    *max_apdu = pMatch->max_apdu;
-                }
-                /* Prove we found it */
-                found = true;
-            }
-            /* Exit now if found at all - bound or unbound */
-            break;
+    pMatch = address_device_find(device_id);
+    if (pMatch && ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0)) {
+        /* If bound then fetch data */
+        bacnet_address_copy(src, &pMatch->address);
+        if (max_apdu) {
+            *max_apdu = pMatch->max_apdu;
         }
+        address_lru_touch(pMatch);
+        /* Prove we found it */
+        found = true;
     }
 
     return found;
@@ -387,21 +749,24 @@ bool address_get_device_id(const BACNET_ADDRESS *src, uint32_t *device_id)
 {
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
-    unsigned index;
+    ADDRESS_LINK link;
 
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
-            BAC_ADDR_IN_USE) {
-            /* If bound */
-            if (bacnet_address_same(&pMatch->address, src)) {
-                if (device_id) {
-                    *device_id = pMatch->device_id;
-                }
-                found = true;
-                break;
+    if (!src) {
+        return false;
+    }
+    link = Address_MAC_Hash[address_mac_hash(src)];
+    while (link) {
+        pMatch = &Address_Cache[link - 1];
+        /* only bound entries are in the index */
+        if (bacnet_address_same(&pMatch->address, src)) {
+            if (device_id) {
+                *device_id = pMatch->device_id;
             }
+            address_lru_touch(pMatch);
+            found = true;
+            break;
         }
+        link = pMatch->Address_Next;
     }
 
     return found;
@@ -417,9 +782,8 @@ bool address_get_device_id(const BACNET_ADDRESS *src, uint32_t *device_id)
 void address_add(
     uint32_t device_id, unsigned max_apdu, const BACNET_ADDRESS *src)
 {
-    bool found = false; /* return value */
     struct Address_Cache_Entry *pMatch;
-    unsigned index;
+    uint32_t ttl;
 
     if (Own_Device_ID == device_id) {
         return;
@@ -432,62 +796,37 @@ void address_add(
        bind request if it exists */
 
     /* existing device or bind request outstanding - update address */
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        /* Device already in the list, then update the values. */
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            bacnet_address_copy(&pMatch->address, src);
-            pMatch->max_apdu = max_apdu;
-            /* Pick the right time to live */
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0) {
-                /* Bind requested so long time */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
-            } else if ((pMatch->Flags & BAC_ADDR_STATIC) != 0) {
-                /* Static already so make sure it never expires */
-                pMatch->TimeToLive = BAC_ADDR_FOREVER;
-            } else if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) {
-                /* Opportunistic entry so leave on short fuse */
-                pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
-            } else {
-                /* Renewing existing entry */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
-            }
-            /* Clear bind request flag just in case */
-            pMatch->Flags &= ~BAC_ADDR_BIND_REQ;
-            found = true;
-            break;
-        }
-    }
-    /* New device - add to cache if there is room. */
-    if (!found) {
-        for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-            pMatch = &Address_Cache[index];
-            if ((pMatch->Flags & BAC_ADDR_IN_USE) == 0) {
-                pMatch->Flags = BAC_ADDR_IN_USE;
-                pMatch->device_id = device_id;
-                pMatch->max_apdu = max_apdu;
-                bacnet_address_copy(&pMatch->address, src);
-                /* Opportunistic entry so leave on short fuse */
-                pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
-                found = true;
-                break;
-            }
-        }
-    }
-    /* If adding has failed, see if we can squeeze it in by removed the oldest
-     * entry. */
-    if (!found) {
-        pMatch = address_remove_oldest();
-        if (pMatch != NULL) {
-            pMatch->Flags = BAC_ADDR_IN_USE;
-            pMatch->device_id = device_id;
-            pMatch->max_apdu = max_apdu;
-            bacnet_address_copy(&pMatch->address, src);
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        /* Pick the right time to live */
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0) {
+            /* Bind requested so long time */
+            ttl = BAC_ADDR_LONG_TIME;
+        } else if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) {
             /* Opportunistic entry so leave on short fuse */
-            pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+            ttl = BAC_ADDR_SHORT_TIME;
+        } else {
+            /* Renewing existing entry, static ones never expire */
+            ttl = BAC_ADDR_LONG_TIME;
+        }
+    } else {
+        /* New device - add to cache, if need be in place of the least
+           recently used entry. */
+        pMatch = address_entry_new(device_id, BAC_ADDR_IN_USE);
+        if (!pMatch) {
+            return;
         }
+        /* the MAC address is not in the index yet */
+        pMatch->Flags |= BAC_ADDR_BIND_REQ;
+        /* Opportunistic entry so leave on short fuse */
+        ttl = BAC_ADDR_SHORT_TIME;
     }
+    /* Clears the bind request flag just in case */
+    address_mac_bind(pMatch, src);
+    pMatch->max_apdu = max_apdu;
+    address_ttl_set(pMatch, ttl);
+    address_lru_touch(pMatch);
+
     return;
 }
 
@@ -512,61 +851,44 @@ bool address_device_bind_request(
 {
     bool found = false; /* return value */
     struct Address_Cache_Entry *pMatch;
-    unsigned index;
 
     /* existing device - update address info if currently bound */
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
-                /* Already bound */
-                found = true;
-                if (src) {
-                    bacnet_address_copy(src, &pMatch->address);
-                }
-                if (max_apdu) {
-                    *max_apdu = pMatch->max_apdu;
-                }
-                if (device_ttl) {
-                    *device_ttl = pMatch->TimeToLive;
-                }
-                if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) {
-                    /* Was picked up opportunistacilly */
-                    /* Convert to normal entry  */
-                    pMatch->Flags &= ~BAC_ADDR_SHORT_TTL;
-                    /* And give it a decent time to live */
-                    pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
-                }
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
+            /* Already bound */
+            found = true;
+            if (src) {
+                bacnet_address_copy(src, &pMatch->address);
             }
-            /* True if bound, false if bind request outstanding */
-            return (found);
-        }
-    }
-
-    /* Not there already so look for a free entry to put it in */
-    /* existing device - update address info if currently bound */
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_RESERVED)) == 0) {
-            /* In use and awaiting binding */
-            pMatch->Flags = (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ);
-            pMatch->device_id = device_id;
-            /* No point in leaving bind requests in for long haul */
-            pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
-            /* now would be a good time to do a Who-Is request */
-            return (false);
+            if (max_apdu) {
+                *max_apdu = pMatch->max_apdu;
+            }
+            if (device_ttl) {
+                *device_ttl = address_ttl(pMatch);
+            }
+            if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) {
+                /* Was picked up opportunistacilly */
+                /* Convert to normal entry  */
+                pMatch->Flags &= ~BAC_ADDR_SHORT_TTL;
+                /* And give it a decent time to live */
+                address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);
+            }
+            address_lru_touch(pMatch);
         }
+        /* True if bound, false if bind request outstanding */
+        return (found);
     }
 
-    /* No free entries, See if we can squeeze it in by dropping an existing one
-     */
-    pMatch = address_remove_oldest();
+    /* Not there already so take a free entry, or squeeze it in by
+       dropping an existing one */
+    pMatch = address_entry_new(
+        device_id, (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ));
     if (pMatch != NULL) {
-        pMatch->Flags = (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ);
-        pMatch->device_id = device_id;
         /* No point in leaving bind requests in for long haul */
-        pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+        address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);
+        address_lru_touch(pMatch);
+        /* now would be a good time to do a Who-Is request */
     }
     return (false);
 }
@@ -600,24 +922,16 @@ void address_add_binding(
     uint32_t device_id, unsigned max_apdu, const BACNET_ADDRESS *src)
 {
     struct Address_Cache_Entry *pMatch;
-    unsigned index;
 
     /* existing device or bind request - update address */
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            bacnet_address_copy(&pMatch->address, src);
-            pMatch->max_apdu = max_apdu;
-            /* Clear bind request flag in case it was set */
-            pMatch->Flags &= ~BAC_ADDR_BIND_REQ;
-            /* Only update TTL if not static */
-            if ((pMatch->Flags & BAC_ADDR_STATIC) == 0) {
-                /* and set it on a long fuse */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
-            }
-            break;
-        }
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        /* Clears the bind request flag in case it was set */
+        address_mac_bind(pMatch, src);
+        pMatch->max_apdu = max_apdu;
+        /* Only update TTL if not static, and set it on a long fuse */
+        address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);
+        address_lru_touch(pMatch);
     }
     return;
 }
@@ -659,7 +973,7 @@ bool address_device_get_by_index(
                 *max_apdu = pMatch->max_apdu;
             }
             if (device_ttl) {
-                *device_ttl = pMatch->TimeToLive;
+                *device_ttl = address_ttl(pMatch);
             }
             found = true;
         }
@@ -695,20 +1009,8 @@ bool address_get_by_index(
  */
 unsigned address_count(void)
 {
-    struct Address_Cache_Entry *pMatch;
-    unsigned count = 0; /* return value */
-    unsigned index;
-
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        /* Only count bound entries */
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
-            BAC_ADDR_IN_USE) {
-            count++;
-        }
-    }
-
-    return count;
+    /* Only count bound entries */
+    return Address_Bound_Count;
 }
 
 /**
@@ -973,8 +1275,43 @@ int rr_address_list_encode(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
     return (iLen);
 }
 
+/* Advance the clock of the wheel by one second: move the entries of the
+   slots that start now down a level, then drop the entries of the slot of
+   the lowest level */
+static void address_cache_tick(void)
+{
+    struct Address_Cache_Entry *pMatch;
+    ADDRESS_LINK link;
+    unsigned level;
+    unsigned slot;
+
+    Address_Clock++;
+    for (level = ADDRESS_WHEEL_LEVELS - 1U; level > 0; level--) {
+        if (Address_Clock & ((1UL << (level * ADDRESS_WHEEL_BITS)) - 1UL)) {
+            continue;
+        }
+        slot = (level * ADDRESS_WHEEL_SLOTS) +
+            ((Address_Clock >> (level * ADDRESS_WHEEL_BITS)) &
+             ADDRESS_WHEEL_MASK);
+        /* take the whole slot first: an entry that is still out of range
+           goes back into this slot */
+        link = Address_Wheel[slot];
+        while (link) {
+            pMatch = &Address_Cache[link - 1];
+            link = pMatch->Timer_Next;
+            address_timer_stop(pMatch);
+            address_timer_insert(pMatch);
+        }
+    }
+    slot = Address_Clock & ADDRESS_WHEEL_MASK;
+    while (Address_Wheel[slot]) {
+        pMatch = &Address_Cache[Address_Wheel[slot] - 1];
+        address_entry_free(pMatch);
+    }
+}
+
 /**
- * Scan the cache and eliminate any expired entries. Should be called
+ * Eliminate any expired entries. Should be called
  * periodically to ensure the cache is managed correctly. If this function
  * is never called at all the whole cache is effectively rendered static and
  * entries never expire unless explicitly deleted.
@@ -984,20 +1321,25 @@ int rr_address_list_encode(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
  */
 void address_cache_timer(uint16_t uSeconds)
 {
-    struct Address_Cache_Entry *pMatch;
-    unsigned index;
+    uint16_t skip;
 
-    for (index = 0; index < MAX_ADDRESS_CACHE; index++) {
-        pMatch = &Address_Cache[index];
-        if (((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_RESERVED)) != 0) &&
-            ((pMatch->Flags & BAC_ADDR_STATIC) ==
-             0)) { /* Check all entries holding a slot except statics
-                    */
-            if (pMatch->TimeToLive >= uSeconds) {
-                pMatch->TimeToLive -= uSeconds;
-            } else {
-                pMatch->Flags = 0;
+    while (uSeconds > 0) {
+        if (Address_Timer_Count == 0) {
+            Address_Clock += uSeconds;
+            break;
+        }
+        if (Address_Timer_Near_Count == 0) {
+            /* nothing expires before the next slot of the second level */
+            skip = (uint16_t)(ADDRESS_WHEEL_MASK -
+                              (Address_Clock & ADDRESS_WHEEL_MASK));
+            if (skip >= uSeconds) {
+                Address_Clock += uSeconds;
+                break;
             }
+            Address_Clock += skip;
+            uSeconds -= skip;
         }
+        address_cache_tick();
+        uSeconds--;
     }
 }
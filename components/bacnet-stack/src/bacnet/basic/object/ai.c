@@ -16,18 +16,22 @@
 /* BACnet Stack API */
 #include "bacnet/bacapp.h"
 #include "bacnet/bacdcode.h"
+#include "bacnet/cov.h"
 #include "bacnet/bactext.h"
 #include "bacnet/datetime.h"
 #include "bacnet/proplist.h"
 #include "bacnet/timestamp.h"
 #include "bacnet/basic/services.h"
 #include "bacnet/basic/sys/keylist.h"
+#include "bacnet/basic/object/name_index.h"
 #include "bacnet/basic/sys/debug.h"
+#include "bacnet/basic/sys/strarena.h"
 /* me! */
 #include "bacnet/basic/object/ai.h"
 
 extern void bacnet_nvs_save_ai_name(uint32_t instance, const char *name, uint16_t length);
 extern void bacnet_nvs_save_ai_desc(uint32_t instance, const char *desc, uint16_t length);
+extern void bacnet_nvs_save_ai_cov_increment(uint32_t instance, float value);
 
 /* Key List for storing the object data sorted by instance number  */
 static OS_Keylist Object_List;
@@ -192,11 +196,12 @@ float Analog_Input_Present_Value(uint32_t object_instance)
  *
  * This method will update the COV-changed attribute.
  *
- * @param index  Object index
+ * @param pObject  Object data
+ * @param object_instance  Object instance number
  * @param value  Given present value.
  */
-static void
-Analog_Input_COV_Detect(struct analog_input_descr *pObject, float value)
+static void Analog_Input_COV_Detect(
+    struct analog_input_descr *pObject, uint32_t object_instance, float value)
 {
     float prior_value = 0.0f;
     float cov_increment = 0.0f;
@@ -213,6 +218,7 @@ Analog_Input_COV_Detect(struct analog_input_descr *pObject, float value)
         if (cov_delta >= cov_increment) {
             pObject->Changed = true;
             pObject->Prior_Value = value;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
     }
 }
@@ -230,8 +236,9 @@ void Analog_Input_Present_Value_Set(uint32_t object_instance, float value)
 
     pObject = Analog_Input_Object(object_instance);
     if (pObject) {
-        Analog_Input_COV_Detect(pObject, value);
+        Analog_Input_COV_Detect(pObject, object_instance, value);
         pObject->Present_Value = value;
+        rpm_cache_value_changed(Object_Type, object_instance);
     }
 }
 
@@ -285,6 +292,8 @@ bool Analog_Input_Name_Set(uint32_t object_instance, const char *new_name)
     if (pObject) {
         status = true;
         pObject->Object_Name = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
+        Object_Name_Index_Changed(Object_Type, object_instance);
     }
 
     return status;
@@ -371,6 +380,7 @@ bool Analog_Input_Notification_Class_Set(
 
     if (pObject) {
         pObject->Notification_Class = notification_class;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -416,6 +426,7 @@ bool Analog_Input_Event_Enable_Set(
               ~(EVENT_ENABLE_TO_OFFNORMAL | EVENT_ENABLE_TO_FAULT |
                 EVENT_ENABLE_TO_NORMAL))) {
             pObject->Event_Enable = event_enable;
+            rpm_cache_object_changed(Object_Type, object_instance);
             status = true;
         }
     }
@@ -460,6 +471,7 @@ bool Analog_Input_Notify_Type_Set(
     if (pObject) {
         if ((notify_type == NOTIFY_EVENT) || (notify_type == NOTIFY_ALARM)) {
             pObject->Notify_Type = notify_type;
+            rpm_cache_object_changed(Object_Type, object_instance);
             status = true;
         }
     }
@@ -527,6 +539,7 @@ bool Analog_Input_Event_Detection_Enable_Set(
             conditions.*/
             Analog_Input_Reset_Event_Properties(pObject);
         }
+        rpm_cache_object_changed(Object_Type, object_instance);
         retval = true;
     }
 
@@ -567,12 +580,56 @@ bool Analog_Input_Description_Set(
     pObject = Analog_Input_Object(object_instance);
     if (pObject) {
         pObject->Description = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
     return status;
 }
 
+/**
+ * @brief Set the object name or the description to a copy of a string
+ *  written with WriteProperty.  The object keeps the copy until the next
+ *  write or until it is deleted.
+ * @param  object_instance - object-instance number of the object
+ * @param  property - PROP_OBJECT_NAME or PROP_DESCRIPTION
+ * @param  value - the string written
+ * @return  true if set, false if there is no memory for the copy
+ */
+static bool Analog_Input_String_Write(
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID property,
+    const BACNET_CHARACTER_STRING *value)
+{
+    struct analog_input_descr *pObject;
+    char **written;
+    char *copy;
+    size_t length;
+
+    pObject = Analog_Input_Object(object_instance);
+    if (!pObject) {
+        return false;
+    }
+    length = characterstring_length(value);
+    copy = malloc(length + 1);
+    if (!copy) {
+        return false;
+    }
+    memcpy(copy, characterstring_value(value), length);
+    copy[length] = 0;
+    if (property == PROP_OBJECT_NAME) {
+        Analog_Input_Name_Set(object_instance, copy);
+        written = &pObject->Object_Name_Written;
+    } else {
+        Analog_Input_Description_Set(object_instance, copy);
+        written = &pObject->Description_Written;
+    }
+    free(*written);
+    *written = copy;
+
+    return true;
+}
+
 /**
  * @brief For a given object instance-number, returns the reliability
  * @param  object_instance - object-instance number of the object
@@ -626,8 +683,10 @@ bool Analog_Input_Reliability_Set(
     if (pObject) {
         fault = Analog_Input_Object_Fault(pObject);
         pObject->Reliability = value;
+        rpm_cache_object_changed(Object_Type, object_instance);
         if (fault != Analog_Input_Object_Fault(pObject)) {
             pObject->Changed = true;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
         status = true;
     }
@@ -748,7 +807,9 @@ void Analog_Input_COV_Increment_Set(uint32_t object_instance, float value)
     pObject = Analog_Input_Object(object_instance);
     if (pObject) {
         pObject->COV_Increment = value;
-        Analog_Input_COV_Detect(pObject, pObject->Present_Value);
+        rpm_cache_object_changed(Object_Type, object_instance);
+        Analog_Input_COV_Detect(
+            pObject, object_instance, pObject->Present_Value);
     }
 }
 
@@ -789,6 +850,7 @@ bool Analog_Input_Units_Set(
     pObject = Analog_Input_Object(object_instance);
     if (pObject) {
         pObject->Units = units;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -829,8 +891,10 @@ void Analog_Input_Out_Of_Service_Set(uint32_t object_instance, bool value)
     if (pObject) {
         if (pObject->Out_Of_Service != value) {
             pObject->Changed = true;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
         pObject->Out_Of_Service = value;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 }
 
@@ -882,6 +946,7 @@ bool Analog_Input_Event_Message_Text_Custom_Set(
     pObject = Analog_Input_Object(object_instance);
     if (pObject && transition < MAX_BACNET_EVENT_TRANSITION) {
         pObject->Event_Message_Texts_Custom[transition] = custom_text;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -999,9 +1064,14 @@ int Analog_Input_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                 &apdu[0], Object_Type, rpdata->object_instance);
             break;
         case PROP_OBJECT_NAME:
-            Analog_Input_Object_Name(rpdata->object_instance, &char_string);
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode(
+                string_arena_shared(),
+                Analog_Input_Name_ASCII(rpdata->object_instance), &apdu[0]);
+            if (apdu_len == 0) {
+                Analog_Input_Object_Name(rpdata->object_instance, &char_string);
+                apdu_len =
+                    encode_application_character_string(&apdu[0], &char_string);
+            }
             break;
         case PROP_OBJECT_TYPE:
             apdu_len = encode_application_enumerated(&apdu[0], Object_Type);
@@ -1038,11 +1108,8 @@ int Analog_Input_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
             apdu_len = encode_application_enumerated(&apdu[0], pObject->Units);
             break;
         case PROP_DESCRIPTION:
-            characterstring_init_ansi(
-                &char_string,
-                Analog_Input_Description(rpdata->object_instance));
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode_ansi(
+                &apdu[0], Analog_Input_Description(rpdata->object_instance));
             break;
         case PROP_COV_INCREMENT:
             apdu_len =
@@ -1229,6 +1296,8 @@ bool Analog_Input_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                 if (value.type.Real >= 0.0f) {
                     Analog_Input_COV_Increment_Set(
                         wp_data->object_instance, value.type.Real);
+                    bacnet_nvs_save_ai_cov_increment(
+                        wp_data->object_instance, value.type.Real);
                 } else {
                     status = false;
                     wp_data->error_class = ERROR_CLASS_PROPERTY;
@@ -1237,47 +1306,27 @@ bool Analog_Input_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
             }
             break;
         case PROP_OBJECT_NAME:
-            status = write_property_type_valid(
-                wp_data, &value, BACNET_APPLICATION_TAG_CHARACTER_STRING);
-            if (status) {
-                uint16_t len = value.type.Character_String.length;
-                size_t copy_len = len;
-                if (copy_len > 64) {
-                    copy_len = 64;
-                }
-                char *name_buf = calloc(copy_len + 1, 1);
-                if (name_buf) {
-                    if (copy_len > 0) {
-                        memcpy(name_buf, value.type.Character_String.value, copy_len);
-                    }
-                    name_buf[copy_len] = 0;
-                    Analog_Input_Name_Set(wp_data->object_instance, name_buf);
-                }
-                bacnet_nvs_save_ai_name(wp_data->object_instance,
-                    (const char *)value.type.Character_String.value,
-                    value.type.Character_String.length);
-            }
-            break;
         case PROP_DESCRIPTION:
             status = write_property_type_valid(
                 wp_data, &value, BACNET_APPLICATION_TAG_CHARACTER_STRING);
             if (status) {
-                uint16_t len = value.type.Character_String.length;
-                size_t copy_len = len;
-                if (copy_len > 128) {
-                    copy_len = 128;
-                }
-                char *desc_buf = calloc(copy_len + 1, 1);
-                if (desc_buf) {
-                    if (copy_len > 0) {
-                        memcpy(desc_buf, value.type.Character_String.value, copy_len);
-                    }
-                    desc_buf[copy_len] = 0;
-                    Analog_Input_Description_Set(wp_data->object_instance, desc_buf);
+                status = Analog_Input_String_Write(
+                    wp_data->object_instance, wp_data->object_property,
+                    &value.type.Character_String);
+                if (!status) {
+                    wp_data->error_class = ERROR_CLASS_RESOURCES;
+                    wp_data->error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+                } else if (wp_data->object_property == PROP_OBJECT_NAME) {
+                    bacnet_nvs_save_ai_name(
+                        wp_data->object_instance,
+                        characterstring_value(&value.type.Character_String),
+                        characterstring_length(&value.type.Character_String));
+                } else {
+                    bacnet_nvs_save_ai_desc(
+                        wp_data->object_instance,
+                        characterstring_value(&value.type.Character_String),
+                        characterstring_length(&value.type.Character_String));
                 }
-                bacnet_nvs_save_ai_desc(wp_data->object_instance,
-                    (const char *)value.type.Character_String.value,
-                    value.type.Character_String.length);
             }
             break;
 #if defined(INTRINSIC_REPORTING)
@@ -1562,6 +1611,7 @@ void Analog_Input_Intrinsic_Reporting(uint32_t object_instance)
         if (FromState != ToState ||
             (ToState == EVENT_STATE_FAULT &&
              Reliability != CurrentAI->Last_ToFault_Event_Reliability)) {
+            rpm_cache_object_changed(Object_Type, object_instance);
             /* Event_State has changed.
                Need to fill only the basic parameters of this type of event.
                Other parameters will be filled in common function. */
@@ -1998,6 +2048,8 @@ int Analog_Input_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentAI->Ack_notify_data.bSendAckNotify = true;
     CurrentAI->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    rpm_cache_object_changed(
+        Object_Type, alarmack_data->eventObjectIdentifier.instance);
 
     return 1;
 }
@@ -2130,6 +2182,7 @@ uint32_t Analog_Input_Create(uint32_t object_instance)
                 free(pObject);
                 return BACNET_MAX_INSTANCE;
             }
+            Object_Name_Index_Changed(Object_Type, object_instance);
         } else {
             return BACNET_MAX_INSTANCE;
         }
@@ -2150,7 +2203,11 @@ bool Analog_Input_Delete(uint32_t object_instance)
 
     pObject = Keylist_Data_Delete(Object_List, object_instance);
     if (pObject) {
+        free(pObject->Object_Name_Written);
+        free(pObject->Description_Written);
         free(pObject);
+        Object_Name_Index_Remove(Object_Type, object_instance);
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -2168,11 +2225,14 @@ void Analog_Input_Cleanup(void)
         do {
             pObject = Keylist_Data_Pop(Object_List);
             if (pObject) {
+                free(pObject->Object_Name_Written);
+                free(pObject->Description_Written);
                 free(pObject);
             }
         } while (pObject);
         Keylist_Delete(Object_List);
         Object_List = NULL;
+        rpm_cache_invalidate();
     }
 }
 
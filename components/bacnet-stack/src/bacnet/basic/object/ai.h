@@ -34,6 +34,9 @@ typedef struct analog_input_descr {
     bool Changed;
     const char *Object_Name;
     const char *Description;
+    /* copies of a written name and description, owned by the object */
+    char *Object_Name_Written;
+    char *Description_Written;
     void *Context;
 #if defined(INTRINSIC_REPORTING)
     uint32_t Time_Delay;
@@ -18,19 +18,23 @@
 /* BACnet Stack API */
 #include "bacnet/bacapp.h"
 #include "bacnet/bacdcode.h"
+#include "bacnet/cov.h"
 #include "bacnet/bactext.h"
 #include "bacnet/datetime.h"
 #include "bacnet/proplist.h"
 #include "bacnet/timestamp.h"
 #include "bacnet/basic/services.h"
 #include "bacnet/basic/sys/keylist.h"
+#include "bacnet/basic/object/name_index.h"
 #include "bacnet/basic/sys/debug.h"
+#include "bacnet/basic/sys/strarena.h"
 /* me! */
 #include "bacnet/basic/object/av.h"
 
 /* External NVS callbacks (from main.c if available) */
 extern void bacnet_nvs_save_av_name(uint32_t instance, const char *name, uint16_t length);
 extern void bacnet_nvs_save_av_desc(uint32_t instance, const char *desc, uint16_t length);
+extern void bacnet_nvs_save_av_cov_increment(uint32_t instance, float value);
 extern void bacnet_nvs_save_av_units(uint32_t instance, uint16_t units);
 extern void bacnet_nvs_save_av_pv(uint32_t instance, float value);
 
@@ -192,11 +196,12 @@ float Analog_Value_Present_Value(uint32_t object_instance)
  *
  * This method will update the COV-changed attribute.
  *
- * @param index  Object index
+ * @param pObject  Object data
+ * @param object_instance  Object instance number
  * @param value  Given present value.
  */
-static void
-Analog_Value_COV_Detect(struct analog_value_descr *pObject, float value)
+static void Analog_Value_COV_Detect(
+    struct analog_value_descr *pObject, uint32_t object_instance, float value)
 {
     float prior_value = 0.0f;
     float cov_increment = 0.0f;
@@ -213,6 +218,7 @@ Analog_Value_COV_Detect(struct analog_value_descr *pObject, float value)
         if (cov_delta >= cov_increment) {
             pObject->Changed = true;
             pObject->Prior_Value = value;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
     }
 }
@@ -236,8 +242,9 @@ bool Analog_Value_Present_Value_Set(
     (void)priority;
     pObject = Analog_Value_Object(object_instance);
     if (pObject) {
-        Analog_Value_COV_Detect(pObject, value);
+        Analog_Value_COV_Detect(pObject, object_instance, value);
         pObject->Present_Value = value;
+        rpm_cache_value_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -294,6 +301,8 @@ bool Analog_Value_Name_Set(uint32_t object_instance, const char *new_name)
     if (pObject) {
         status = true;
         pObject->Object_Name = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
+        Object_Name_Index_Changed(Object_Type, object_instance);
     }
 
     return status;
@@ -381,6 +390,7 @@ bool Analog_Value_Event_Detection_Enable_Set(
 
     if (pObject) {
         pObject->Event_Detection_Enable = value;
+        rpm_cache_object_changed(Object_Type, object_instance);
         retval = true;
     }
 #endif
@@ -421,12 +431,56 @@ bool Analog_Value_Description_Set(
     pObject = Analog_Value_Object(object_instance);
     if (pObject) {
         pObject->Description = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
     return status;
 }
 
+/**
+ * @brief Set the object name or the description to a copy of a string
+ *  written with WriteProperty.  The object keeps the copy until the next
+ *  write or until it is deleted.
+ * @param  object_instance - object-instance number of the object
+ * @param  property - PROP_OBJECT_NAME or PROP_DESCRIPTION
+ * @param  value - the string written
+ * @return  true if set, false if there is no memory for the copy
+ */
+static bool Analog_Value_String_Write(
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID property,
+    const BACNET_CHARACTER_STRING *value)
+{
+    struct analog_value_descr *pObject;
+    char **written;
+    char *copy;
+    size_t length;
+
+    pObject = Analog_Value_Object(object_instance);
+    if (!pObject) {
+        return false;
+    }
+    length = characterstring_length(value);
+    copy = malloc(length + 1);
+    if (!copy) {
+        return false;
+    }
+    memcpy(copy, characterstring_value(value), length);
+    copy[length] = 0;
+    if (property == PROP_OBJECT_NAME) {
+        Analog_Value_Name_Set(object_instance, copy);
+        written = &pObject->Object_Name_Written;
+    } else {
+        Analog_Value_Description_Set(object_instance, copy);
+        written = &pObject->Description_Written;
+    }
+    free(*written);
+    *written = copy;
+
+    return true;
+}
+
 /**
  * @brief For a given object instance-number, returns the reliability
  * @param  object_instance - object-instance number of the object
@@ -480,8 +534,10 @@ bool Analog_Value_Reliability_Set(
     if (pObject) {
         fault = Analog_Value_Object_Fault(pObject);
         pObject->Reliability = value;
+        rpm_cache_object_changed(Object_Type, object_instance);
         if (fault != Analog_Value_Object_Fault(pObject)) {
             pObject->Changed = true;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
         status = true;
     }
@@ -602,7 +658,9 @@ void Analog_Value_COV_Increment_Set(uint32_t object_instance, float value)
     pObject = Analog_Value_Object(object_instance);
     if (pObject) {
         pObject->COV_Increment = value;
-        Analog_Value_COV_Detect(pObject, pObject->Present_Value);
+        rpm_cache_object_changed(Object_Type, object_instance);
+        Analog_Value_COV_Detect(
+            pObject, object_instance, pObject->Present_Value);
     }
 }
 
@@ -643,6 +701,7 @@ bool Analog_Value_Units_Set(
     pObject = Analog_Value_Object(object_instance);
     if (pObject) {
         pObject->Units = units;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -683,8 +742,10 @@ void Analog_Value_Out_Of_Service_Set(uint32_t object_instance, bool value)
     if (pObject) {
         if (pObject->Out_Of_Service != value) {
             pObject->Changed = true;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
         pObject->Out_Of_Service = value;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 }
 
@@ -780,7 +841,11 @@ int Analog_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                 &apdu[0], Object_Type, rpdata->object_instance);
             break;
         case PROP_OBJECT_NAME:
-            if (Analog_Value_Object_Name(
+            apdu_len = string_arena_encode(
+                string_arena_shared(),
+                Analog_Value_Name_ASCII(rpdata->object_instance), &apdu[0]);
+            if ((apdu_len == 0) &&
+                Analog_Value_Object_Name(
                     rpdata->object_instance, &char_string)) {
                 apdu_len =
                     encode_application_character_string(&apdu[0], &char_string);
@@ -822,11 +887,8 @@ int Analog_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                 encode_application_enumerated(&apdu[0], CurrentAV->Units);
             break;
         case PROP_DESCRIPTION:
-            characterstring_init_ansi(
-                &char_string,
-                Analog_Value_Description(rpdata->object_instance));
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode_ansi(
+                &apdu[0], Analog_Value_Description(rpdata->object_instance));
             break;
         case PROP_COV_INCREMENT:
             apdu_len =
@@ -1059,6 +1121,8 @@ bool Analog_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                 if (value.type.Real >= 0.0f) {
                     Analog_Value_COV_Increment_Set(
                         wp_data->object_instance, value.type.Real);
+                    bacnet_nvs_save_av_cov_increment(
+                        wp_data->object_instance, value.type.Real);
                 } else {
                     status = false;
                     wp_data->error_class = ERROR_CLASS_PROPERTY;
@@ -1150,40 +1214,27 @@ bool Analog_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
             break;
 #endif
         case PROP_OBJECT_NAME:
-            status = write_property_type_valid(
-                wp_data, &value, BACNET_APPLICATION_TAG_CHARACTER_STRING);
-            if (status) {
-                static char name_bufs[256][65];  /* Support up to 256 instances */
-                uint16_t len = value.type.Character_String.length;
-                uint8_t idx = wp_data->object_instance & 0xFF;
-                memset(name_bufs[idx], 0, sizeof(name_bufs[idx]));
-                if (len > 0 && len < sizeof(name_bufs[idx])) {
-                    memcpy(name_bufs[idx], value.type.Character_String.value, len);
-                    name_bufs[idx][len] = 0;
-                }
-                Analog_Value_Name_Set(wp_data->object_instance, name_bufs[idx]);
-                bacnet_nvs_save_av_name(wp_data->object_instance,
-                    (const char *)value.type.Character_String.value,
-                    value.type.Character_String.length);
-            }
-            break;
-
         case PROP_DESCRIPTION:
             status = write_property_type_valid(
                 wp_data, &value, BACNET_APPLICATION_TAG_CHARACTER_STRING);
             if (status) {
-                static char desc_bufs[256][129];  /* Support up to 256 instances */
-                uint16_t len = value.type.Character_String.length;
-                uint8_t idx = wp_data->object_instance & 0xFF;
-                memset(desc_bufs[idx], 0, sizeof(desc_bufs[idx]));
-                if (len > 0 && len < sizeof(desc_bufs[idx])) {
-                    memcpy(desc_bufs[idx], value.type.Character_String.value, len);
-                    desc_bufs[idx][len] = 0;
+                status = Analog_Value_String_Write(
+                    wp_data->object_instance, wp_data->object_property,
+                    &value.type.Character_String);
+                if (!status) {
+                    wp_data->error_class = ERROR_CLASS_RESOURCES;
+                    wp_data->error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+                } else if (wp_data->object_property == PROP_OBJECT_NAME) {
+                    bacnet_nvs_save_av_name(
+                        wp_data->object_instance,
+                        characterstring_value(&value.type.Character_String),
+                        characterstring_length(&value.type.Character_String));
+                } else {
+                    bacnet_nvs_save_av_desc(
+                        wp_data->object_instance,
+                        characterstring_value(&value.type.Character_String),
+                        characterstring_length(&value.type.Character_String));
                 }
-                Analog_Value_Description_Set(wp_data->object_instance, desc_bufs[idx]);
-                bacnet_nvs_save_av_desc(wp_data->object_instance,
-                    (const char *)value.type.Character_String.value,
-                    value.type.Character_String.length);
             }
             break;
 
@@ -1376,6 +1427,7 @@ void Analog_Value_Intrinsic_Reporting(uint32_t object_instance)
         ToState = CurrentAV->Event_State;
 
         if (FromState != ToState) {
+            rpm_cache_object_changed(Object_Type, object_instance);
             /* Event_State has changed.
                Need to fill only the basic parameters of this type of event.
                Other parameters will be filled in common function. */
@@ -1757,6 +1809,8 @@ int Analog_Value_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentAV->Ack_notify_data.bSendAckNotify = true;
     CurrentAV->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    rpm_cache_object_changed(
+        Object_Type, alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
@@ -1898,6 +1952,7 @@ uint32_t Analog_Value_Create(uint32_t object_instance)
                 free(pObject);
                 return BACNET_MAX_INSTANCE;
             }
+            Object_Name_Index_Changed(Object_Type, object_instance);
         } else {
             return BACNET_MAX_INSTANCE;
         }
@@ -1918,7 +1973,11 @@ bool Analog_Value_Delete(uint32_t object_instance)
 
     pObject = Keylist_Data_Delete(Object_List, object_instance);
     if (pObject) {
+        free(pObject->Object_Name_Written);
+        free(pObject->Description_Written);
         free(pObject);
+        Object_Name_Index_Remove(Object_Type, object_instance);
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -1936,11 +1995,14 @@ void Analog_Value_Cleanup(void)
         do {
             pObject = Keylist_Data_Pop(Object_List);
             if (pObject) {
+                free(pObject->Object_Name_Written);
+                free(pObject->Description_Written);
                 free(pObject);
             }
         } while (pObject);
         Keylist_Delete(Object_List);
         Object_List = NULL;
+        rpm_cache_invalidate();
     }
 }
 
@@ -35,6 +35,9 @@ typedef struct analog_value_descr {
     bool Changed;
     const char *Object_Name;
     const char *Description;
+    /* copies of a written name and description, owned by the object */
+    char *Object_Name_Written;
+    char *Description_Written;
     BACNET_RELIABILITY Reliability;
     void *Context;
 #if defined(INTRINSIC_REPORTING)
@@ -29,6 +29,8 @@
 #include "bacnet/wp.h"
 #include "bacnet/basic/services.h"
 #include "bacnet/basic/sys/keylist.h"
+#include "bacnet/basic/sys/strarena.h"
+#include "bacnet/basic/object/name_index.h"
 /* me! */
 #include "bo.h"
 
@@ -49,6 +51,9 @@ struct object_data {
     const char *Active_Text;
     const char *Inactive_Text;
     const char *Description;
+    /* copies of a written name and description, owned by the object */
+    char *Object_Name_Written;
+    char *Description_Written;
     void *Context;
 };
 /* Key List for storing the object data sorted by instance number  */
@@ -313,9 +318,12 @@ bool Binary_Output_Present_Value_Set(
                 }
                 status = true;
             }
+            /* the priority array changes even if the value does not */
+            rpm_cache_object_changed(Object_Type, object_instance);
             new_value = Object_Present_Value(pObject);
             if (old_value != new_value) {
                 pObject->Changed = true;
+                cov_change_detected_notify(Object_Type, object_instance);
             }
         }
     }
@@ -391,9 +399,11 @@ bool Binary_Output_Present_Value_Relinquish(
             old_value = Object_Present_Value(pObject);
             BIT_CLEAR(pObject->Priority_Active_Bits, priority);
             BIT_CLEAR(pObject->Priority_Array, priority);
+            rpm_cache_object_changed(Object_Type, object_instance);
             new_value = Object_Present_Value(pObject);
             if (old_value != new_value) {
                 pObject->Changed = true;
+                cov_change_detected_notify(Object_Type, object_instance);
             }
             status = true;
         }
@@ -552,7 +562,9 @@ void Binary_Output_Out_Of_Service_Set(uint32_t object_instance, bool value)
     if (pObject) {
         if (pObject->Out_Of_Service != value) {
             pObject->Out_Of_Service = value;
+            rpm_cache_object_changed(Object_Type, object_instance);
             pObject->Changed = true;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
     }
 }
@@ -608,6 +620,8 @@ bool Binary_Output_Name_Set(uint32_t object_instance, const char *new_name)
     if (pObject) {
         status = true;
         pObject->Object_Name = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
+        Object_Name_Index_Changed(Object_Type, object_instance);
     }
 
     return status;
@@ -675,6 +689,7 @@ bool Binary_Output_Polarity_Set(
             } else {
                 pObject->Polarity = true;
             }
+            rpm_cache_object_changed(Object_Type, object_instance);
             status = true;
         }
     }
@@ -731,6 +746,7 @@ bool Binary_Output_Relinquish_Default_Set(
             pObject->Relinquish_Default = false;
             status = true;
         }
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 
     return status;
@@ -796,8 +812,10 @@ bool Binary_Output_Reliability_Set(
         if (value <= 255) {
             fault = Binary_Output_Object_Fault(pObject);
             pObject->Reliability = value;
+            rpm_cache_object_changed(Object_Type, object_instance);
             if (fault != Binary_Output_Object_Fault(pObject)) {
                 pObject->Changed = true;
+                cov_change_detected_notify(Object_Type, object_instance);
             }
             status = true;
         }
@@ -860,11 +878,55 @@ bool Binary_Output_Description_Set(
     if (pObject) {
         status = true;
         pObject->Description = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 
     return status;
 }
 
+/**
+ * @brief Set the object name or the description to a copy of a string
+ *  written with WriteProperty.  The object keeps the copy until the next
+ *  write or until it is deleted.
+ * @param  object_instance - object-instance number of the object
+ * @param  property - PROP_OBJECT_NAME or PROP_DESCRIPTION
+ * @param  value - the string written
+ * @return  true if set, false if there is no memory for the copy
+ */
+static bool Binary_Output_String_Write(
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID property,
+    const BACNET_CHARACTER_STRING *value)
+{
+    struct object_data *pObject;
+    char **written;
+    char *copy;
+    size_t length;
+
+    pObject = Keylist_Data(Object_List, object_instance);
+    if (!pObject) {
+        return false;
+    }
+    length = characterstring_length(value);
+    copy = malloc(length + 1);
+    if (!copy) {
+        return false;
+    }
+    memcpy(copy, characterstring_value(value), length);
+    copy[length] = 0;
+    if (property == PROP_OBJECT_NAME) {
+        Binary_Output_Name_Set(object_instance, copy);
+        written = &pObject->Object_Name_Written;
+    } else {
+        Binary_Output_Description_Set(object_instance, copy);
+        written = &pObject->Description_Written;
+    }
+    free(*written);
+    *written = copy;
+
+    return true;
+}
+
 /**
  * For a given object instance-number, returns the active text value
  *
@@ -903,6 +965,7 @@ bool Binary_Output_Active_Text_Set(
     if (pObject) {
         status = true;
         pObject->Active_Text = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 
     return status;
@@ -946,6 +1009,7 @@ bool Binary_Output_Inactive_Text_Set(
     if (pObject) {
         status = true;
         pObject->Inactive_Text = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 
     return status;
@@ -1056,9 +1120,15 @@ int Binary_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                 &apdu[0], Object_Type, rpdata->object_instance);
             break;
         case PROP_OBJECT_NAME:
-            Binary_Output_Object_Name(rpdata->object_instance, &char_string);
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode(
+                string_arena_shared(),
+                Binary_Output_Name_ASCII(rpdata->object_instance), &apdu[0]);
+            if (apdu_len == 0) {
+                Binary_Output_Object_Name(
+                    rpdata->object_instance, &char_string);
+                apdu_len =
+                    encode_application_character_string(&apdu[0], &char_string);
+            }
             break;
         case PROP_OBJECT_TYPE:
             apdu_len = encode_application_enumerated(&apdu[0], Object_Type);
@@ -1114,25 +1184,16 @@ int Binary_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
             apdu_len = encode_application_enumerated(&apdu[0], present_value);
             break;
         case PROP_DESCRIPTION:
-            characterstring_init_ansi(
-                &char_string,
-                Binary_Output_Description(rpdata->object_instance));
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode_ansi(
+                &apdu[0], Binary_Output_Description(rpdata->object_instance));
             break;
         case PROP_ACTIVE_TEXT:
-            characterstring_init_ansi(
-                &char_string,
-                Binary_Output_Active_Text(rpdata->object_instance));
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode_ansi(
+                &apdu[0], Binary_Output_Active_Text(rpdata->object_instance));
             break;
         case PROP_INACTIVE_TEXT:
-            characterstring_init_ansi(
-                &char_string,
-                Binary_Output_Inactive_Text(rpdata->object_instance));
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode_ansi(
+                &apdu[0], Binary_Output_Inactive_Text(rpdata->object_instance));
             break;
         case PROP_CURRENT_COMMAND_PRIORITY:
             i = Binary_Output_Present_Value_Priority(rpdata->object_instance);
@@ -1221,47 +1282,27 @@ bool Binary_Output_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
             }
             break;
         case PROP_OBJECT_NAME:
-            status = write_property_type_valid(
-                wp_data, &value, BACNET_APPLICATION_TAG_CHARACTER_STRING);
-            if (status) {
-                uint16_t len = value.type.Character_String.length;
-                size_t copy_len = len;
-                if (copy_len > 64) {
-                    copy_len = 64;
-                }
-                char *name_buf = calloc(copy_len + 1, 1);
-                if (name_buf) {
-                    if (copy_len > 0) {
-                        memcpy(name_buf, value.type.Character_String.value, copy_len);
-                    }
-                    name_buf[copy_len] = 0;
-                    Binary_Output_Name_Set(wp_data->object_instance, name_buf);
-                }
-                bacnet_nvs_save_bo_name(wp_data->object_instance,
-                    (const char *)value.type.Character_String.value,
-                    value.type.Character_String.length);
-            }
-            break;
         case PROP_DESCRIPTION:
             status = write_property_type_valid(
                 wp_data, &value, BACNET_APPLICATION_TAG_CHARACTER_STRING);
             if (status) {
-                uint16_t len = value.type.Character_String.length;
-                size_t copy_len = len;
-                if (copy_len > 128) {
-                    copy_len = 128;
-                }
-                char *desc_buf = calloc(copy_len + 1, 1);
-                if (desc_buf) {
-                    if (copy_len > 0) {
-                        memcpy(desc_buf, value.type.Character_String.value, copy_len);
-                    }
-                    desc_buf[copy_len] = 0;
-                    Binary_Output_Description_Set(wp_data->object_instance, desc_buf);
+                status = Binary_Output_String_Write(
+                    wp_data->object_instance, wp_data->object_property,
+                    &value.type.Character_String);
+                if (!status) {
+                    wp_data->error_class = ERROR_CLASS_RESOURCES;
+                    wp_data->error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+                } else if (wp_data->object_property == PROP_OBJECT_NAME) {
+                    bacnet_nvs_save_bo_name(
+                        wp_data->object_instance,
+                        characterstring_value(&value.type.Character_String),
+                        characterstring_length(&value.type.Character_String));
+                } else {
+                    bacnet_nvs_save_bo_desc(
+                        wp_data->object_instance,
+                        characterstring_value(&value.type.Character_String),
+                        characterstring_length(&value.type.Character_String));
                 }
-                bacnet_nvs_save_bo_desc(wp_data->object_instance,
-                    (const char *)value.type.Character_String.value,
-                    value.type.Character_String.length);
             }
             break;
         default:
@@ -1363,6 +1404,7 @@ uint32_t Binary_Output_Create(uint32_t object_instance)
                 free(pObject);
                 return BACNET_MAX_INSTANCE;
             }
+            Object_Name_Index_Changed(Object_Type, object_instance);
         } else {
             return BACNET_MAX_INSTANCE;
         }
@@ -1382,11 +1424,14 @@ void Binary_Output_Cleanup(void)
         do {
             pObject = Keylist_Data_Pop(Object_List);
             if (pObject) {
+                free(pObject->Object_Name_Written);
+                free(pObject->Description_Written);
                 free(pObject);
             }
         } while (pObject);
         Keylist_Delete(Object_List);
         Object_List = NULL;
+        rpm_cache_invalidate();
     }
 }
 
@@ -1400,7 +1445,11 @@ bool Binary_Output_Delete(uint32_t object_instance)
 
     pObject = Keylist_Data_Delete(Object_List, object_instance);
     if (pObject) {
+        free(pObject->Object_Name_Written);
+        free(pObject->Description_Written);
         free(pObject);
+        Object_Name_Index_Remove(Object_Type, object_instance);
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -27,7 +27,9 @@
 #include "bacnet/basic/services.h"
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/sys/keylist.h"
+#include "bacnet/basic/object/name_index.h"
 #include "bacnet/basic/sys/debug.h"
+#include "bacnet/basic/sys/strarena.h"
 /* me! */
 #include "bacnet/basic/object/bv.h"
 
@@ -49,6 +51,9 @@ struct object_data {
     const char *Active_Text;
     const char *Inactive_Text;
     const char *Description;
+    /* copies of a written name and description, owned by the object */
+    char *Object_Name_Written;
+    char *Description_Written;
     void *Context;
 #if defined(INTRINSIC_REPORTING) && (BINARY_VALUE_INTRINSIC_REPORTING)
     uint32_t Time_Delay;
@@ -252,14 +257,18 @@ BACNET_BINARY_PV Binary_Value_Present_Value(uint32_t object_instance)
 /**
  * @brief For a given object instance-number, checks the present-value for COV
  * @param  pObject - specific object with valid data
+ * @param  object_instance - object-instance number of the object
  * @param  value - binary value
  */
 static void Binary_Value_Present_Value_COV_Detect(
-    struct object_data *pObject, BACNET_BINARY_PV value)
+    struct object_data *pObject,
+    uint32_t object_instance,
+    BACNET_BINARY_PV value)
 {
     if (pObject) {
         if (Binary_Present_Value(pObject->Present_Value) != value) {
             pObject->Change_Of_Value = true;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
     }
 }
@@ -298,8 +307,10 @@ void Binary_Value_Out_Of_Service_Set(uint32_t object_instance, bool value)
     if (pObject) {
         if (pObject->Out_Of_Service != value) {
             pObject->Change_Of_Value = true;
+            cov_change_detected_notify(Object_Type, object_instance);
         }
         pObject->Out_Of_Service = value;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 
     return;
@@ -362,8 +373,10 @@ bool Binary_Value_Reliability_Set(
         if (value <= 255) {
             fault = Binary_Value_Object_Fault(pObject);
             pObject->Reliability = value;
+            rpm_cache_object_changed(Object_Type, object_instance);
             if (fault != Binary_Value_Object_Fault(pObject)) {
                 pObject->Change_Of_Value = true;
+                cov_change_detected_notify(Object_Type, object_instance);
             }
             status = true;
         }
@@ -471,8 +484,10 @@ bool Binary_Value_Present_Value_Set(
     pObject = Binary_Value_Object(object_instance);
     if (pObject) {
         if (value <= MAX_BINARY_PV) {
-            Binary_Value_Present_Value_COV_Detect(pObject, value);
+            Binary_Value_Present_Value_COV_Detect(
+                pObject, object_instance, value);
             pObject->Present_Value = Binary_Present_Value_Boolean(value);
+            rpm_cache_value_changed(Object_Type, object_instance);
             status = true;
         }
     }
@@ -505,7 +520,8 @@ static bool Binary_Value_Present_Value_Write(
         if (value <= MAX_BINARY_PV) {
             if (pObject->Write_Enabled) {
                 old_value = Binary_Present_Value(pObject->Present_Value);
-                Binary_Value_Present_Value_COV_Detect(pObject, value);
+                Binary_Value_Present_Value_COV_Detect(
+                    pObject, object_instance, value);
                 pObject->Present_Value = Binary_Present_Value_Boolean(value);
                 if (pObject->Out_Of_Service) {
                     /* The physical point that the object represents
@@ -614,6 +630,8 @@ bool Binary_Value_Name_Set(uint32_t object_instance, const char *new_name)
     if (pObject) {
         status = true;
         pObject->Object_Name = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
+        Object_Name_Index_Changed(Object_Type, object_instance);
     }
 
     return status;
@@ -675,11 +693,55 @@ bool Binary_Value_Description_Set(
     if (pObject) {
         status = true;
         pObject->Description = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 
     return status;
 }
 
+/**
+ * @brief Set the object name or the description to a copy of a string
+ *  written with WriteProperty.  The object keeps the copy until the next
+ *  write or until it is deleted.
+ * @param  object_instance - object-instance number of the object
+ * @param  property - PROP_OBJECT_NAME or PROP_DESCRIPTION
+ * @param  value - the string written
+ * @return  true if set, false if there is no memory for the copy
+ */
+static bool Binary_Value_String_Write(
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID property,
+    const BACNET_CHARACTER_STRING *value)
+{
+    struct object_data *pObject;
+    char **written;
+    char *copy;
+    size_t length;
+
+    pObject = Binary_Value_Object(object_instance);
+    if (!pObject) {
+        return false;
+    }
+    length = characterstring_length(value);
+    copy = malloc(length + 1);
+    if (!copy) {
+        return false;
+    }
+    memcpy(copy, characterstring_value(value), length);
+    copy[length] = 0;
+    if (property == PROP_OBJECT_NAME) {
+        Binary_Value_Name_Set(object_instance, copy);
+        written = &pObject->Object_Name_Written;
+    } else {
+        Binary_Value_Description_Set(object_instance, copy);
+        written = &pObject->Description_Written;
+    }
+    free(*written);
+    *written = copy;
+
+    return true;
+}
+
 /**
  * For a given object instance-number, returns the active text value
  *
@@ -718,6 +780,7 @@ bool Binary_Value_Active_Text_Set(
     if (pObject) {
         status = true;
         pObject->Active_Text = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 
     return status;
@@ -761,6 +824,7 @@ bool Binary_Value_Inactive_Text_Set(
     if (pObject) {
         status = true;
         pObject->Inactive_Text = new_name;
+        rpm_cache_object_changed(Object_Type, object_instance);
     }
 
     return status;
@@ -858,9 +922,14 @@ int Binary_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
             break;
         case PROP_OBJECT_NAME:
             /* note: object name must be unique in our device */
-            Binary_Value_Object_Name(rpdata->object_instance, &char_string);
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode(
+                string_arena_shared(),
+                Binary_Value_Name_ASCII(rpdata->object_instance), &apdu[0]);
+            if (apdu_len == 0) {
+                Binary_Value_Object_Name(rpdata->object_instance, &char_string);
+                apdu_len =
+                    encode_application_character_string(&apdu[0], &char_string);
+            }
             break;
         case PROP_OBJECT_TYPE:
             apdu_len = encode_application_enumerated(&apdu[0], Object_Type);
@@ -895,25 +964,16 @@ int Binary_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                 &apdu[0], Binary_Value_Reliability(rpdata->object_instance));
             break;
         case PROP_DESCRIPTION:
-            characterstring_init_ansi(
-                &char_string,
-                Binary_Value_Description(rpdata->object_instance));
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode_ansi(
+                &apdu[0], Binary_Value_Description(rpdata->object_instance));
             break;
         case PROP_ACTIVE_TEXT:
-            characterstring_init_ansi(
-                &char_string,
-                Binary_Value_Active_Text(rpdata->object_instance));
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode_ansi(
+                &apdu[0], Binary_Value_Active_Text(rpdata->object_instance));
             break;
         case PROP_INACTIVE_TEXT:
-            characterstring_init_ansi(
-                &char_string,
-                Binary_Value_Inactive_Text(rpdata->object_instance));
-            apdu_len =
-                encode_application_character_string(&apdu[0], &char_string);
+            apdu_len = string_arena_encode_ansi(
+                &apdu[0], Binary_Value_Inactive_Text(rpdata->object_instance));
             break;
 #if defined(INTRINSIC_REPORTING) && (BINARY_VALUE_INTRINSIC_REPORTING)
         case PROP_ALARM_VALUE:
@@ -1188,40 +1248,27 @@ bool Binary_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
             break;
 #endif
         case PROP_OBJECT_NAME:
-            status = write_property_type_valid(
-                wp_data, &value, BACNET_APPLICATION_TAG_CHARACTER_STRING);
-            if (status) {
-                static char name_bufs[256][65];  /* Support up to 256 instances */
-                uint16_t len = value.type.Character_String.length;
-                uint8_t idx = wp_data->object_instance & 0xFF;
-                memset(name_bufs[idx], 0, sizeof(name_bufs[idx]));
-                if (len > 0 && len < sizeof(name_bufs[idx])) {
-                    memcpy(name_bufs[idx], value.type.Character_String.value, len);
-                    name_bufs[idx][len] = 0;
-                }
-                Binary_Value_Name_Set(wp_data->object_instance, name_bufs[idx]);
-                bacnet_nvs_save_bv_name(wp_data->object_instance,
-                    (const char *)value.type.Character_String.value,
-                    value.type.Character_String.length);
-            }
-            break;
-
         case PROP_DESCRIPTION:
             status = write_property_type_valid(
                 wp_data, &value, BACNET_APPLICATION_TAG_CHARACTER_STRING);
             if (status) {
-                static char desc_bufs[256][129];  /* Support up to 256 instances */
-                uint16_t len = value.type.Character_String.length;
-                uint8_t idx = wp_data->object_instance & 0xFF;
-                memset(desc_bufs[idx], 0, sizeof(desc_bufs[idx]));
-                if (len > 0 && len < sizeof(desc_bufs[idx])) {
-                    memcpy(desc_bufs[idx], value.type.Character_String.value, len);
-                    desc_bufs[idx][len] = 0;
+                status = Binary_Value_String_Write(
+                    wp_data->object_instance, wp_data->object_property,
+                    &value.type.Character_String);
+                if (!status) {
+                    wp_data->error_class = ERROR_CLASS_RESOURCES;
+                    wp_data->error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+                } else if (wp_data->object_property == PROP_OBJECT_NAME) {
+                    bacnet_nvs_save_bv_name(
+                        wp_data->object_instance,
+                        characterstring_value(&value.type.Character_String),
+                        characterstring_length(&value.type.Character_String));
+                } else {
+                    bacnet_nvs_save_bv_desc(
+                        wp_data->object_instance,
+                        characterstring_value(&value.type.Character_String),
+                        characterstring_length(&value.type.Character_String));
                 }
-                Binary_Value_Description_Set(wp_data->object_instance, desc_bufs[idx]);
-                bacnet_nvs_save_bv_desc(wp_data->object_instance,
-                    (const char *)value.type.Character_String.value,
-                    value.type.Character_String.length);
             }
             break;
 
@@ -1397,6 +1444,7 @@ uint32_t Binary_Value_Create(uint32_t object_instance)
                 free(pObject);
                 return BACNET_MAX_INSTANCE;
             }
+            Object_Name_Index_Changed(Object_Type, object_instance);
         } else {
             return BACNET_MAX_INSTANCE;
         }
@@ -1416,11 +1464,14 @@ void Binary_Value_Cleanup(void)
         do {
             pObject = Keylist_Data_Pop(Object_List);
             if (pObject) {
+                free(pObject->Object_Name_Written);
+                free(pObject->Description_Written);
                 free(pObject);
             }
         } while (pObject);
         Keylist_Delete(Object_List);
         Object_List = NULL;
+        rpm_cache_invalidate();
     }
 }
 
@@ -1434,7 +1485,11 @@ bool Binary_Value_Delete(uint32_t object_instance)
 
     pObject = Keylist_Data_Delete(Object_List, object_instance);
     if (pObject) {
+        free(pObject->Object_Name_Written);
+        free(pObject->Description_Written);
         free(pObject);
+        Object_Name_Index_Remove(Object_Type, object_instance);
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -1519,6 +1574,7 @@ bool Binary_Value_Event_Detection_Enable_Set(
 
     if (pObject) {
         pObject->Event_Detection_Enable = value;
+        rpm_cache_object_changed(Object_Type, object_instance);
         retval = true;
     }
 #endif
@@ -1576,6 +1632,7 @@ bool Binary_Value_Event_Enable_Set(
               ~(EVENT_ENABLE_TO_OFFNORMAL | EVENT_ENABLE_TO_FAULT |
                 EVENT_ENABLE_TO_NORMAL))) {
             pObject->Event_Enable = event_enable;
+            rpm_cache_object_changed(Object_Type, object_instance);
             status = true;
         }
     }
@@ -1620,6 +1677,7 @@ bool Binary_Value_Notify_Type_Set(
     if (pObject) {
         if ((notify_type == NOTIFY_EVENT) || (notify_type == NOTIFY_ALARM)) {
             pObject->Notify_Type = notify_type;
+            rpm_cache_object_changed(Object_Type, object_instance);
             status = true;
         }
     }
@@ -1798,6 +1856,8 @@ int Binary_Value_Alarm_Ack(
     }
     pObject->Ack_notify_data.bSendAckNotify = true;
     pObject->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    rpm_cache_object_changed(
+        Object_Type, alarmack_data->eventObjectIdentifier.instance);
 
     return 1;
 }
@@ -1881,6 +1941,7 @@ bool Binary_Value_Time_Delay_Set(uint32_t object_instance, uint32_t time_delay)
 
     if (pObject) {
         pObject->Time_Delay = time_delay;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -1924,6 +1985,7 @@ bool Binary_Value_Notification_Class_Set(
 
     if (pObject) {
         pObject->Notification_Class = notification_class;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -1965,6 +2027,7 @@ bool Binary_Value_Alarm_Value_Set(
 
     if (pObject) {
         pObject->Alarm_Value = value;
+        rpm_cache_object_changed(Object_Type, object_instance);
         status = true;
     }
 
@@ -2062,6 +2125,7 @@ void Binary_Value_Intrinsic_Reporting(uint32_t object_instance)
         ToState = pObject->Event_State;
 
         if (FromState != ToState) {
+            rpm_cache_object_changed(Object_Type, object_instance);
             /* Event_State has changed.
                Need to fill only the basic parameters of this type of event.
                Other parameters will be filled in common function. */
@@ -27,6 +27,7 @@
 #include "bacnet/basic/binding/address.h"
 /* include the device object */
 #include "bacnet/basic/object/device.h"
+#include "bacnet/basic/object/name_index.h"
 #include "bacnet/basic/object/acc.h"
 #include "bacnet/basic/object/ai.h"
 #include "bacnet/basic/object/ao.h"
@@ -73,6 +74,12 @@ extern int Routed_Device_Read_Property_Local(BACNET_READ_PROPERTY_DATA *rpdata);
 extern bool
 Routed_Device_Write_Property_Local(BACNET_WRITE_PROPERTY_DATA *wp_data);
 
+/* Object types are found through a direct index of the object table,
+   unless this is 0, where every lookup walks the table */
+#ifndef DEVICE_OBJECT_TYPE_INDEX
+#define DEVICE_OBJECT_TYPE_INDEX 1
+#endif
+
 /* may be overridden by outside table */
 static object_functions_t *Object_Table;
 
@@ -132,6 +139,16 @@ static object_functions_t My_Object_Table[] = {
         Binary_Output_Change_Of_Value_Clear, NULL /* Intrinsic Reporting */,
         NULL /* Add_List_Element */, NULL /* Remove_List_Element */,
         Binary_Output_Create, Binary_Output_Delete, NULL /* Timer */ },
+#if defined(BACNET_TREND_LOG)
+    { OBJECT_TRENDLOG, Trend_Log_Init, Trend_Log_Count,
+        Trend_Log_Index_To_Instance, Trend_Log_Valid_Instance,
+        Trend_Log_Object_Name, Trend_Log_Read_Property,
+        Trend_Log_Write_Property, Trend_Log_Property_Lists,
+        TrendLogGetRRInfo, NULL /* Iterator */, NULL /* Value_Lists */,
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        NULL /* Add_List_Element */, NULL /* Remove_List_Element */,
+        NULL /* Create */, NULL /* Delete */, NULL /* Timer */ },
+#endif
     { MAX_BACNET_OBJECT_TYPE, NULL /* Init */, NULL /* Count */,
         NULL /* Index_To_Instance */, NULL /* Valid_Instance */,
         NULL /* Object_Name */, NULL /* Read_Property */,
@@ -143,6 +160,36 @@ static object_functions_t My_Object_Table[] = {
 };
 /* clang-format on */
 
+#if DEVICE_OBJECT_TYPE_INDEX
+/* position + 1 of each standard object type in Object_Table, or 0 */
+static uint16_t Object_Type_Index[OBJECT_PROPRIETARY_MIN];
+#endif
+
+/**
+ * @brief Index the standard object types of the object table so that a
+ *  handler finds the object functions without walking the table.
+ *  Proprietary object types are still found by walking the table.
+ */
+static void Device_Object_Type_Index_Init(void)
+{
+#if DEVICE_OBJECT_TYPE_INDEX
+    struct object_functions *pObject = NULL;
+    uint16_t position = 0;
+
+    memset(Object_Type_Index, 0, sizeof(Object_Type_Index));
+    pObject = Object_Table;
+    while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
+        position++;
+        /* the first entry for a type wins, as it does in a table walk */
+        if ((pObject->Object_Type < OBJECT_PROPRIETARY_MIN) &&
+            (Object_Type_Index[pObject->Object_Type] == 0)) {
+            Object_Type_Index[pObject->Object_Type] = position;
+        }
+        pObject++;
+    }
+#endif
+}
+
 /** Glue function to let the Device object, when called by a handler,
  * lookup which Object type needs to be invoked.
  * @ingroup ObjHelpers
@@ -156,6 +203,14 @@ Device_Object_Functions_Find(BACNET_OBJECT_TYPE Object_Type)
 {
     struct object_functions *pObject = NULL;
 
+#if DEVICE_OBJECT_TYPE_INDEX
+    if (Object_Type < OBJECT_PROPRIETARY_MIN) {
+        if (Object_Type_Index[Object_Type] == 0) {
+            return (NULL);
+        }
+        return (&Object_Table[Object_Type_Index[Object_Type] - 1]);
+    }
+#endif
     pObject = Object_Table;
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         /* handle each object type */
@@ -261,6 +316,11 @@ static const int32_t Device_Properties_Required[] = {
     PROP_NUMBER_OF_APDU_RETRIES,
     PROP_DEVICE_ADDRESS_BINDING,
     PROP_DATABASE_REVISION,
+#if (MAX_SEGMENTED_TRANSACTIONS)
+    /* required when segmentation is supported */
+    PROP_MAX_SEGMENTS_ACCEPTED,
+    PROP_APDU_SEGMENT_TIMEOUT,
+#endif
     -1
 };
 
@@ -573,7 +633,9 @@ bool Device_Set_Object_Instance_Number(uint32_t object_id)
 
     if (object_id <= BACNET_MAX_INSTANCE) {
         /* Make the change and update the database revision */
+        Object_Name_Index_Remove(OBJECT_DEVICE, Object_Instance_Number);
         Object_Instance_Number = object_id;
+        Object_Name_Index_Changed(OBJECT_DEVICE, Object_Instance_Number);
         Device_Inc_Database_Revision();
     } else {
         status = false;
@@ -606,6 +668,7 @@ bool Device_Set_Object_Name(const BACNET_CHARACTER_STRING *object_name)
     if (!characterstring_same(&My_Object_Name, object_name)) {
         /* Make the change and update the database revision */
         status = characterstring_copy(&My_Object_Name, object_name);
+        Object_Name_Index_Changed(OBJECT_DEVICE, Object_Instance_Number);
         Device_Inc_Database_Revision();
     }
 
@@ -619,7 +682,12 @@ bool Device_Set_Object_Name(const BACNET_CHARACTER_STRING *object_name)
  */
 bool Device_Object_Name_ANSI_Init(const char *value)
 {
-    return characterstring_init_ansi(&My_Object_Name, value);
+    bool status;
+
+    status = characterstring_init_ansi(&My_Object_Name, value);
+    Object_Name_Index_Changed(OBJECT_DEVICE, Object_Instance_Number);
+
+    return status;
 }
 
 /**
@@ -867,7 +935,11 @@ uint8_t Device_Protocol_Revision(void)
 
 BACNET_SEGMENTATION Device_Segmentation_Supported(void)
 {
+#if (MAX_SEGMENTED_TRANSACTIONS)
+    return SEGMENTATION_BOTH;
+#else
     return SEGMENTATION_NONE;
+#endif
 }
 
 /**
@@ -886,6 +958,7 @@ uint32_t Device_Database_Revision(void)
 void Device_Set_Database_Revision(uint32_t revision)
 {
     Database_Revision = revision;
+    rpm_cache_invalidate();
 }
 
 /*
@@ -896,6 +969,7 @@ void Device_Set_Database_Revision(uint32_t revision)
 void Device_Inc_Database_Revision(void)
 {
     Database_Revision++;
+    rpm_cache_invalidate();
 }
 
 /** Get the total count of objects supported by this Device Object.
@@ -1012,9 +1086,75 @@ int Device_Object_List_Element_Encode(
     return apdu_len;
 }
 
+/**
+ * @brief Confirm that an object currently has the given name
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the candidate
+ * @param object_instance [in] The object instance number of the candidate
+ * @param object_name [in] The name that is being looked up
+ * @return true if the object exists and has this name
+ */
+static bool Device_Object_Name_Match(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    const BACNET_CHARACTER_STRING *object_name)
+{
+    BACNET_CHARACTER_STRING name;
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Object_Functions_Find(object_type);
+    if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
+        pObject->Object_Name(object_instance, &name)) {
+        return characterstring_same(object_name, &name);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Update the object name index with the current name of an object.
+ *  Objects report a create or rename through Object_Name_Index_Changed().
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the object
+ * @param object_instance [in] The object instance number of the object
+ */
+static void Device_Object_Name_Index_Update(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    BACNET_CHARACTER_STRING name;
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Object_Functions_Find(object_type);
+    if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
+        pObject->Object_Name(object_instance, &name)) {
+        Object_Name_Index_Set(object_type, object_instance, &name);
+    } else {
+        Object_Name_Index_Remove(object_type, object_instance);
+    }
+}
+
+/**
+ * @brief Index the names of all the objects in the device
+ */
+static void Device_Object_Name_Index_Init(void)
+{
+    BACNET_OBJECT_TYPE type = OBJECT_NONE;
+    uint32_t instance;
+    uint32_t max_objects = 0, i = 0;
+
+    Object_Name_Index_Cleanup();
+    max_objects = Device_Object_List_Count();
+    for (i = 1; i <= max_objects; i++) {
+        if (Device_Object_List_Identifier(i, &type, &instance)) {
+            Device_Object_Name_Index_Update(type, instance);
+        }
+    }
+    Object_Name_Index_Changed_Callback_Set(Device_Object_Name_Index_Update);
+}
+
 /** Determine if we have an object with the given object_name.
  * If the object_type and object_instance pointers are not null,
  * and the lookup succeeds, they will be given the resulting values.
+ * The names are found through the object name index, which the objects
+ * keep current when they are created, renamed, or deleted.
  * @param object_name [in] The desired Object Name to look for.
  * @param object_type [out] The BACNET_OBJECT_TYPE of the matching Object.
  * @param object_instance [out] The object instance number of the matching
@@ -1026,35 +1166,32 @@ bool Device_Valid_Object_Name(
     BACNET_OBJECT_TYPE *object_type,
     uint32_t *object_instance)
 {
-    bool found = false;
+#ifdef BAC_ROUTING
     BACNET_OBJECT_TYPE type = OBJECT_NONE;
     uint32_t instance;
     uint32_t max_objects = 0, i = 0;
-    bool check_id = false;
-    BACNET_CHARACTER_STRING object_name2;
-    struct object_functions *pObject = NULL;
 
-    max_objects = Device_Object_List_Count();
-    for (i = 1; i <= max_objects; i++) {
-        check_id = Device_Object_List_Identifier(i, &type, &instance);
-        if (check_id) {
-            pObject = Device_Object_Functions_Find(type);
-            if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
-                (pObject->Object_Name(instance, &object_name2) &&
-                 characterstring_same(object_name1, &object_name2))) {
-                found = true;
+    if (Device_Router_Mode) {
+        /* the routed devices are not in the index */
+        max_objects = Device_Object_List_Count();
+        for (i = 1; i <= max_objects; i++) {
+            if (Device_Object_List_Identifier(i, &type, &instance) &&
+                Device_Object_Name_Match(type, instance, object_name1)) {
                 if (object_type) {
                     *object_type = type;
                 }
                 if (object_instance) {
                     *object_instance = instance;
                 }
-                break;
+                return true;
             }
         }
+        return false;
     }
+#endif
 
-    return found;
+    return Object_Name_Index_Find(
+        object_name1, Device_Object_Name_Match, object_type, object_instance);
 }
 
 /** Determine if we have an object of this type and instance number.
@@ -1355,6 +1492,17 @@ int Device_Read_Property_Local(BACNET_READ_PROPERTY_DATA *rpdata)
         case PROP_APDU_TIMEOUT:
             apdu_len = encode_application_unsigned(&apdu[0], apdu_timeout());
             break;
+#if (MAX_SEGMENTED_TRANSACTIONS)
+        case PROP_MAX_SEGMENTS_ACCEPTED:
+            /* segments of our own MAX_APDU that fit in one buffer */
+            apdu_len = encode_application_unsigned(
+                &apdu[0], MAX_SEGMENTED_APDU / MAX_APDU);
+            break;
+        case PROP_APDU_SEGMENT_TIMEOUT:
+            apdu_len =
+                encode_application_unsigned(&apdu[0], apdu_segment_timeout());
+            break;
+#endif
         case PROP_NUMBER_OF_APDU_RETRIES:
             apdu_len = encode_application_unsigned(&apdu[0], apdu_retries());
             break;
@@ -1857,6 +2005,9 @@ bool Device_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                 } else {
                     status = pObject->Object_Write_Property(wp_data);
                 }
+                /* a write that failed may still have changed the object */
+                rpm_cache_object_changed(
+                    wp_data->object_type, wp_data->object_instance);
                 if (status) {
                     Device_Write_Property_Store(wp_data);
                 }
@@ -2206,6 +2357,7 @@ void Device_Init(object_functions_t *object_table)
     } else {
         Object_Table = &My_Object_Table[0];
     }
+    Device_Object_Type_Index_Init();
     pObject = Object_Table;
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         if (pObject->Object_Init) {
@@ -2213,6 +2365,7 @@ void Device_Init(object_functions_t *object_table)
         }
         pObject++;
     }
+    Device_Object_Name_Index_Init();
     /* minimal build: no Channel/Loop/Timer callback wiring */
 }
 
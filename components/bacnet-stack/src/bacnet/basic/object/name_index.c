@@ -0,0 +1,365 @@
+/**
+ * @file
+ * @brief A hashed index of the object names in this device.
+ *
+ * Each object is kept in two hash chains: one keyed by a hash of its name,
+ * and one keyed by its object identifier.  A lookup by name walks a single
+ * short chain no matter how many objects the device has, and a rename or
+ * delete finds the old entry by object identifier without needing the old
+ * name, which the object may already have overwritten.
+ *
+ * Only the hash of a name is stored, so the names remain owned by the
+ * objects, and every hit is confirmed by a match function that compares
+ * the current name of the candidate object.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacstr.h"
+#include "bacnet/basic/object/name_index.h"
+
+/* initial number of entries; the table doubles when it is full */
+#ifndef OBJECT_NAME_INDEX_SIZE
+#define OBJECT_NAME_INDEX_SIZE 32
+#endif
+
+#define NAME_INDEX_NONE UINT32_MAX
+
+struct name_index_entry {
+    uint32_t name_hash;
+    uint32_t object_id;
+    /* next entry in the name chain */
+    uint32_t next_name;
+    /* next entry in the object identifier chain, or the free list */
+    uint32_t next_id;
+};
+
+static struct name_index_entry *Name_Index_Entries;
+/* heads of the chains - one bucket per entry */
+static uint32_t *Name_Index_Name_Buckets;
+static uint32_t *Name_Index_Id_Buckets;
+static uint32_t Name_Index_Size;
+static uint32_t Name_Index_Count;
+static uint32_t Name_Index_Free = NAME_INDEX_NONE;
+static object_name_index_changed_callback Name_Index_Changed_Callback;
+
+/**
+ * @brief FNV-1a hash of the encoding and octets of a name
+ * @param object_name [in] The name to hash
+ * @return hash of the name
+ */
+static uint32_t name_index_hash(const BACNET_CHARACTER_STRING *object_name)
+{
+    uint32_t hash = 2166136261UL;
+    const char *value;
+    size_t length, i;
+
+    value = characterstring_value(object_name);
+    length = characterstring_length(object_name);
+    hash ^= characterstring_encoding(object_name);
+    hash *= 16777619UL;
+    for (i = 0; i < length; i++) {
+        hash ^= (uint8_t)value[i];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Pack an object type and instance into one key
+ */
+static uint32_t name_index_object_id(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    return ((uint32_t)object_type << 22) | (object_instance & 0x3FFFFFUL);
+}
+
+/**
+ * @brief Mix the object identifier so that consecutive instances of
+ *  different object types spread across the buckets
+ */
+static uint32_t name_index_id_hash(uint32_t object_id)
+{
+    return object_id * 2654435761UL;
+}
+
+/**
+ * @brief Put every entry in use back onto its chains, and every other
+ *  entry onto the free list
+ * @param first_free [in] index of the first entry not yet in use
+ */
+static void name_index_rebuild(uint32_t first_free)
+{
+    uint32_t i, bucket;
+    uint32_t mask = Name_Index_Size - 1;
+
+    for (i = 0; i < Name_Index_Size; i++) {
+        Name_Index_Name_Buckets[i] = NAME_INDEX_NONE;
+        Name_Index_Id_Buckets[i] = NAME_INDEX_NONE;
+    }
+    for (i = 0; i < first_free; i++) {
+        bucket = Name_Index_Entries[i].name_hash & mask;
+        Name_Index_Entries[i].next_name = Name_Index_Name_Buckets[bucket];
+        Name_Index_Name_Buckets[bucket] = i;
+        bucket = name_index_id_hash(Name_Index_Entries[i].object_id) & mask;
+        Name_Index_Entries[i].next_id = Name_Index_Id_Buckets[bucket];
+        Name_Index_Id_Buckets[bucket] = i;
+    }
+    Name_Index_Free = NAME_INDEX_NONE;
+    for (i = Name_Index_Size; i > first_free; i--) {
+        Name_Index_Entries[i - 1].next_id = Name_Index_Free;
+        Name_Index_Free = i - 1;
+    }
+}
+
+/**
+ * @brief Double the number of entries and buckets.  Only called when
+ *  every entry is in use, so the entries in use are packed at the front.
+ * @return true if the table grew
+ */
+static bool name_index_grow(void)
+{
+    uint32_t size;
+    struct name_index_entry *entries;
+    uint32_t *name_buckets, *id_buckets;
+
+    if (Name_Index_Size == 0) {
+        size = OBJECT_NAME_INDEX_SIZE;
+    } else {
+        size = Name_Index_Size * 2;
+    }
+    entries = realloc(Name_Index_Entries, size * sizeof(*entries));
+    if (!entries) {
+        return false;
+    }
+    Name_Index_Entries = entries;
+    name_buckets = realloc(Name_Index_Name_Buckets, size * sizeof(uint32_t));
+    if (!name_buckets) {
+        return false;
+    }
+    Name_Index_Name_Buckets = name_buckets;
+    id_buckets = realloc(Name_Index_Id_Buckets, size * sizeof(uint32_t));
+    if (!id_buckets) {
+        return false;
+    }
+    Name_Index_Id_Buckets = id_buckets;
+    Name_Index_Size = size;
+    name_index_rebuild(Name_Index_Count);
+
+    return true;
+}
+
+/**
+ * @brief Unlink an entry from a name chain
+ */
+static void name_index_name_unlink(uint32_t index)
+{
+    uint32_t *link;
+
+    link = &Name_Index_Name_Buckets
+               [Name_Index_Entries[index].name_hash & (Name_Index_Size - 1)];
+    while (*link != NAME_INDEX_NONE) {
+        if (*link == index) {
+            *link = Name_Index_Entries[index].next_name;
+            break;
+        }
+        link = &Name_Index_Entries[*link].next_name;
+    }
+}
+
+/**
+ * @brief Find the link that refers to the entry of an object
+ * @param object_id [in] packed object type and instance
+ * @return the link to the entry, or NULL if the object is not indexed
+ */
+static uint32_t *name_index_id_link(uint32_t object_id)
+{
+    uint32_t *link;
+
+    if (Name_Index_Size == 0) {
+        return NULL;
+    }
+    link = &Name_Index_Id_Buckets
+               [name_index_id_hash(object_id) & (Name_Index_Size - 1)];
+    while (*link != NAME_INDEX_NONE) {
+        if (Name_Index_Entries[*link].object_id == object_id) {
+            return link;
+        }
+        link = &Name_Index_Entries[*link].next_id;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Set the function that is called to (re)index an object whose
+ *  name has changed
+ * @param cb [in] The function to be called, or NULL to disable
+ */
+void Object_Name_Index_Changed_Callback_Set(
+    object_name_index_changed_callback cb)
+{
+    Name_Index_Changed_Callback = cb;
+}
+
+/**
+ * @brief Called by an object when it is created or its name is set, so
+ *  that the index follows the current name of the object
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the object
+ * @param object_instance [in] The object instance number of the object
+ */
+void Object_Name_Index_Changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    if (Name_Index_Changed_Callback) {
+        Name_Index_Changed_Callback(object_type, object_instance);
+    }
+}
+
+/**
+ * @brief Index the name of an object, replacing any previous name
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the object
+ * @param object_instance [in] The object instance number of the object
+ * @param object_name [in] The current name of the object
+ * @return true if the object name was indexed
+ */
+bool Object_Name_Index_Set(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    const BACNET_CHARACTER_STRING *object_name)
+{
+    uint32_t object_id, index, bucket;
+    uint32_t *link;
+
+    if (!object_name) {
+        return false;
+    }
+    object_id = name_index_object_id(object_type, object_instance);
+    link = name_index_id_link(object_id);
+    if (link) {
+        /* renamed: move the entry to its new name chain */
+        index = *link;
+        name_index_name_unlink(index);
+    } else {
+        if ((Name_Index_Free == NAME_INDEX_NONE) && !name_index_grow()) {
+            return false;
+        }
+        index = Name_Index_Free;
+        Name_Index_Free = Name_Index_Entries[index].next_id;
+        Name_Index_Entries[index].object_id = object_id;
+        bucket = name_index_id_hash(object_id) & (Name_Index_Size - 1);
+        Name_Index_Entries[index].next_id = Name_Index_Id_Buckets[bucket];
+        Name_Index_Id_Buckets[bucket] = index;
+        Name_Index_Count++;
+    }
+    Name_Index_Entries[index].name_hash = name_index_hash(object_name);
+    bucket = Name_Index_Entries[index].name_hash & (Name_Index_Size - 1);
+    Name_Index_Entries[index].next_name = Name_Index_Name_Buckets[bucket];
+    Name_Index_Name_Buckets[bucket] = index;
+
+    return true;
+}
+
+/**
+ * @brief Remove an object from the index, usually when it is deleted
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the object
+ * @param object_instance [in] The object instance number of the object
+ * @return true if the object was in the index
+ */
+bool Object_Name_Index_Remove(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    uint32_t object_id, index;
+    uint32_t *link;
+
+    object_id = name_index_object_id(object_type, object_instance);
+    link = name_index_id_link(object_id);
+    if (!link) {
+        return false;
+    }
+    index = *link;
+    *link = Name_Index_Entries[index].next_id;
+    name_index_name_unlink(index);
+    Name_Index_Entries[index].next_id = Name_Index_Free;
+    Name_Index_Free = index;
+    Name_Index_Count--;
+
+    return true;
+}
+
+/**
+ * @brief Find the object with the given name
+ * @param object_name [in] The name to look for
+ * @param match [in] function that confirms a candidate has this name
+ * @param object_type [out] The BACNET_OBJECT_TYPE of the object, or NULL
+ * @param object_instance [out] The object instance number, or NULL
+ * @return true if an object with this name was found
+ */
+bool Object_Name_Index_Find(
+    const BACNET_CHARACTER_STRING *object_name,
+    object_name_index_match_function match,
+    BACNET_OBJECT_TYPE *object_type,
+    uint32_t *object_instance)
+{
+    uint32_t hash, index;
+    BACNET_OBJECT_TYPE type;
+    uint32_t instance;
+
+    if (!object_name || !match || (Name_Index_Count == 0)) {
+        return false;
+    }
+    hash = name_index_hash(object_name);
+    index = Name_Index_Name_Buckets[hash & (Name_Index_Size - 1)];
+    while (index != NAME_INDEX_NONE) {
+        if (Name_Index_Entries[index].name_hash == hash) {
+            type = (BACNET_OBJECT_TYPE)(Name_Index_Entries[index].object_id >>
+                                        22);
+            instance = Name_Index_Entries[index].object_id & 0x3FFFFFUL;
+            if (match(type, instance, object_name)) {
+                if (object_type) {
+                    *object_type = type;
+                }
+                if (object_instance) {
+                    *object_instance = instance;
+                }
+                return true;
+            }
+        }
+        index = Name_Index_Entries[index].next_name;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the number of objects in the index
+ * @return number of objects in the index
+ */
+unsigned Object_Name_Index_Count(void)
+{
+    return Name_Index_Count;
+}
+
+/**
+ * @brief Remove every object from the index and free its memory
+ */
+void Object_Name_Index_Cleanup(void)
+{
+    free(Name_Index_Entries);
+    free(Name_Index_Name_Buckets);
+    free(Name_Index_Id_Buckets);
+    Name_Index_Entries = NULL;
+    Name_Index_Name_Buckets = NULL;
+    Name_Index_Id_Buckets = NULL;
+    Name_Index_Size = 0;
+    Name_Index_Count = 0;
+    Name_Index_Free = NAME_INDEX_NONE;
+}
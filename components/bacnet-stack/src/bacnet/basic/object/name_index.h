@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @brief API for a hashed index of the object names in this device,
+ *  used to find an object by its name without walking the object list.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_BASIC_OBJECT_NAME_INDEX_H
+#define BACNET_BASIC_OBJECT_NAME_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacstr.h"
+
+/**
+ * @brief Callback to (re)index the current name of an object.
+ *  Called when an object reports that its name has changed.
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the object
+ * @param object_instance [in] The object instance number of the object
+ */
+typedef void (*object_name_index_changed_callback)(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance);
+
+/**
+ * @brief Callback to confirm that a candidate object has the given name.
+ *  The index stores only a hash of each name, so every hit is confirmed
+ *  against the object itself.
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the candidate
+ * @param object_instance [in] The object instance number of the candidate
+ * @param object_name [in] The name that is being looked up
+ * @return true if the candidate object has this name
+ */
+typedef bool (*object_name_index_match_function)(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    const BACNET_CHARACTER_STRING *object_name);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+void Object_Name_Index_Changed_Callback_Set(
+    object_name_index_changed_callback cb);
+BACNET_STACK_EXPORT
+void Object_Name_Index_Changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance);
+
+BACNET_STACK_EXPORT
+bool Object_Name_Index_Set(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    const BACNET_CHARACTER_STRING *object_name);
+BACNET_STACK_EXPORT
+bool Object_Name_Index_Remove(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance);
+BACNET_STACK_EXPORT
+bool Object_Name_Index_Find(
+    const BACNET_CHARACTER_STRING *object_name,
+    object_name_index_match_function match,
+    BACNET_OBJECT_TYPE *object_type,
+    uint32_t *object_instance);
+BACNET_STACK_EXPORT
+unsigned Object_Name_Index_Count(void);
+BACNET_STACK_EXPORT
+void Object_Name_Index_Cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,337 @@
+/**
+ * @file
+ * @brief A table-driven factory that creates the objects of this device
+ *  from a compact table of object descriptors.
+ *
+ * Each object type has one create function here that applies the
+ * initial properties of a descriptor to a new object of that type.  The
+ * strings of the descriptor are copied into a string arena first, so
+ * the table may be a const table in flash or a transient blob, and the
+ * number of objects is limited only by the size of the arena and the
+ * heap used by the objects themselves.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacenum.h"
+#include "bacnet/basic/object/ai.h"
+#include "bacnet/basic/object/av.h"
+#include "bacnet/basic/object/bi.h"
+#include "bacnet/basic/object/bo.h"
+#include "bacnet/basic/object/bv.h"
+#include "bacnet/basic/object/objfactory.h"
+
+typedef bool (*object_factory_create_function)(
+    const BACNET_OBJECT_DESCRIPTOR *object);
+
+struct object_factory_type {
+    BACNET_OBJECT_TYPE object_type;
+    object_factory_create_function create;
+};
+
+static bool Analog_Value_Factory_Create(const BACNET_OBJECT_DESCRIPTOR *object)
+{
+    uint32_t instance = object->object_instance;
+
+    if (Analog_Value_Create(instance) != instance) {
+        return false;
+    }
+    Analog_Value_Name_Set(instance, object->name);
+    Analog_Value_Description_Set(instance, object->description);
+    Analog_Value_Units_Set(instance, (BACNET_ENGINEERING_UNITS)object->units);
+    Analog_Value_Present_Value_Set(
+        instance, object->present_value, BACNET_MAX_PRIORITY);
+    Analog_Value_COV_Increment_Set(instance, object->cov_increment);
+    Analog_Value_Reliability_Set(instance, RELIABILITY_NO_FAULT_DETECTED);
+    Analog_Value_Out_Of_Service_Set(instance, false);
+
+    return true;
+}
+
+static bool Analog_Input_Factory_Create(const BACNET_OBJECT_DESCRIPTOR *object)
+{
+    uint32_t instance = object->object_instance;
+
+    if (Analog_Input_Create(instance) != instance) {
+        return false;
+    }
+    Analog_Input_Name_Set(instance, object->name);
+    Analog_Input_Description_Set(instance, object->description);
+    Analog_Input_Units_Set(instance, (BACNET_ENGINEERING_UNITS)object->units);
+    Analog_Input_Present_Value_Set(instance, object->present_value);
+    Analog_Input_COV_Increment_Set(instance, object->cov_increment);
+    Analog_Input_Reliability_Set(instance, RELIABILITY_NO_FAULT_DETECTED);
+    Analog_Input_Out_Of_Service_Set(instance, false);
+
+    return true;
+}
+
+static bool Binary_Value_Factory_Create(const BACNET_OBJECT_DESCRIPTOR *object)
+{
+    uint32_t instance = object->object_instance;
+
+    if (Binary_Value_Create(instance) != instance) {
+        return false;
+    }
+    Binary_Value_Name_Set(instance, object->name);
+    Binary_Value_Description_Set(instance, object->description);
+    Binary_Value_Active_Text_Set(instance, object->active_text);
+    Binary_Value_Inactive_Text_Set(instance, object->inactive_text);
+    Binary_Value_Present_Value_Set(
+        instance, (BACNET_BINARY_PV)object->present_value_binary);
+    Binary_Value_Reliability_Set(instance, RELIABILITY_NO_FAULT_DETECTED);
+    Binary_Value_Out_Of_Service_Set(instance, false);
+    Binary_Value_Write_Enable(instance);
+
+    return true;
+}
+
+static bool Binary_Input_Factory_Create(const BACNET_OBJECT_DESCRIPTOR *object)
+{
+    uint32_t instance = object->object_instance;
+
+    if (Binary_Input_Create(instance) != instance) {
+        return false;
+    }
+    Binary_Input_Name_Set(instance, object->name);
+    Binary_Input_Description_Set(instance, object->description);
+    Binary_Input_Active_Text_Set(instance, object->active_text);
+    Binary_Input_Inactive_Text_Set(instance, object->inactive_text);
+    Binary_Input_Present_Value_Set(
+        instance, (BACNET_BINARY_PV)object->present_value_binary);
+    Binary_Input_Reliability_Set(instance, RELIABILITY_NO_FAULT_DETECTED);
+    Binary_Input_Out_Of_Service_Set(instance, false);
+
+    return true;
+}
+
+static bool Binary_Output_Factory_Create(const BACNET_OBJECT_DESCRIPTOR *object)
+{
+    uint32_t instance = object->object_instance;
+
+    if (Binary_Output_Create(instance) != instance) {
+        return false;
+    }
+    Binary_Output_Name_Set(instance, object->name);
+    Binary_Output_Description_Set(instance, object->description);
+    Binary_Output_Active_Text_Set(instance, object->active_text);
+    Binary_Output_Inactive_Text_Set(instance, object->inactive_text);
+    Binary_Output_Present_Value_Set(
+        instance, (BACNET_BINARY_PV)object->present_value_binary,
+        BACNET_MAX_PRIORITY);
+    Binary_Output_Out_Of_Service_Set(instance, false);
+
+    return true;
+}
+
+static const struct object_factory_type Object_Factory_Types[] = {
+    { OBJECT_ANALOG_VALUE, Analog_Value_Factory_Create },
+    { OBJECT_ANALOG_INPUT, Analog_Input_Factory_Create },
+    { OBJECT_BINARY_VALUE, Binary_Value_Factory_Create },
+    { OBJECT_BINARY_INPUT, Binary_Input_Factory_Create },
+    { OBJECT_BINARY_OUTPUT, Binary_Output_Factory_Create },
+};
+
+#define OBJECT_FACTORY_TYPES \
+    (sizeof(Object_Factory_Types) / sizeof(Object_Factory_Types[0]))
+
+static const struct object_factory_type *
+Object_Factory_Type(BACNET_OBJECT_TYPE object_type)
+{
+    size_t i;
+
+    for (i = 0; i < OBJECT_FACTORY_TYPES; i++) {
+        if (Object_Factory_Types[i].object_type == object_type) {
+            return &Object_Factory_Types[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Determine if the factory can create objects of a type
+ * @param object_type - the object type
+ * @return true if the type has a create function
+ */
+bool Object_Factory_Supported(BACNET_OBJECT_TYPE object_type)
+{
+    return Object_Factory_Type(object_type) != NULL;
+}
+
+/* The strings of a descriptor */
+static void Object_Factory_Strings(
+    const BACNET_OBJECT_DESCRIPTOR *object, const char *text[4])
+{
+    text[0] = object->name;
+    text[1] = object->description;
+    text[2] = object->active_text;
+    text[3] = object->inactive_text;
+}
+
+/**
+ * @brief Size of the string arena that holds the strings of a table,
+ *  each distinct string once, as it does if it has an index while the
+ *  objects are created
+ * @param table - the object descriptors
+ * @param count - number of descriptors in the table
+ * @param strings - filled with the number of strings, for the size of
+ *  that index, or NULL
+ * @return octets of string records
+ */
+size_t Object_Factory_Arena_Size(
+    const BACNET_OBJECT_DESCRIPTOR *table, size_t count, unsigned *strings)
+{
+    const char *text[4];
+    STRING_ARENA arena;
+    unsigned found = 0;
+    size_t size = 0;
+    size_t index_size;
+    char *data;
+    void *index;
+    size_t i, t;
+
+    for (i = 0; table && (i < count); i++) {
+        Object_Factory_Strings(&table[i], text);
+        for (t = 0; t < 4; t++) {
+            if (text[t]) {
+                size += string_arena_need(text[t]);
+                found++;
+            }
+        }
+    }
+    if (strings) {
+        *strings = found;
+    }
+    if (found == 0) {
+        return size;
+    }
+    /* intern them once to learn the octets without the duplicates; if
+       there is no memory for that, the arena holds every copy */
+    index_size = string_arena_index_size(found);
+    data = malloc(size);
+    index = malloc(index_size);
+    if (data && index) {
+        string_arena_init(&arena, data, size);
+        string_arena_index_set(&arena, index, index_size);
+        for (i = 0; i < count; i++) {
+            Object_Factory_Strings(&table[i], text);
+            for (t = 0; t < 4; t++) {
+                (void)string_arena_add(&arena, text[t]);
+            }
+        }
+        size = string_arena_used(&arena);
+    }
+    free(data);
+    free(index);
+
+    return size;
+}
+
+/* Copy one string of a descriptor into the arena, if there is one */
+static bool Object_Factory_Intern(STRING_ARENA *arena, const char **string)
+{
+    const char *copy;
+
+    if (!arena || !*string) {
+        return true;
+    }
+    copy = string_arena_add(arena, *string);
+    if (!copy) {
+        return false;
+    }
+    *string = copy;
+
+    return true;
+}
+
+/**
+ * @brief Create one object from its descriptor
+ * @param object - the descriptor
+ * @param arena - where the strings of the object are copied, or NULL to
+ *  use the strings of the descriptor, which must then outlive the object
+ * @return true if the object was created
+ */
+bool Object_Factory_Object_Create(
+    const BACNET_OBJECT_DESCRIPTOR *object, STRING_ARENA *arena)
+{
+    const struct object_factory_type *type;
+    BACNET_OBJECT_DESCRIPTOR interned;
+
+    if (!object) {
+        return false;
+    }
+    type = Object_Factory_Type(object->object_type);
+    if (!type) {
+        return false;
+    }
+    interned = *object;
+    if (!Object_Factory_Intern(arena, &interned.name) ||
+        !Object_Factory_Intern(arena, &interned.description) ||
+        !Object_Factory_Intern(arena, &interned.active_text) ||
+        !Object_Factory_Intern(arena, &interned.inactive_text)) {
+        return false;
+    }
+
+    return type->create(&interned);
+}
+
+/**
+ * @brief Create every object of a table of descriptors
+ * @param table - the object descriptors
+ * @param count - number of descriptors in the table
+ * @param arena - where the strings of the objects are copied, sized with
+ *  Object_Factory_Arena_Size(), or NULL to use the strings of the table
+ * @return the number of objects created
+ */
+unsigned Object_Factory_Create(
+    const BACNET_OBJECT_DESCRIPTOR *table, size_t count, STRING_ARENA *arena)
+{
+    unsigned created = 0;
+    size_t i;
+
+    if (!table) {
+        return 0;
+    }
+    for (i = 0; i < count; i++) {
+        if (Object_Factory_Object_Create(&table[i], arena)) {
+            created++;
+        }
+    }
+
+    return created;
+}
+
+/**
+ * @brief Count the descriptors of one object type in a table
+ * @param table - the object descriptors
+ * @param count - number of descriptors in the table
+ * @param object_type - the object type
+ * @return the number of descriptors of the type
+ */
+unsigned Object_Factory_Count(
+    const BACNET_OBJECT_DESCRIPTOR *table,
+    size_t count,
+    BACNET_OBJECT_TYPE object_type)
+{
+    unsigned found = 0;
+    size_t i;
+
+    if (!table) {
+        return 0;
+    }
+    for (i = 0; i < count; i++) {
+        if (table[i].object_type == object_type) {
+            found++;
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @brief API for a table-driven factory that creates the objects of
+ *  this device from a compact table of object descriptors.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_BASIC_OBJECT_OBJFACTORY_H
+#define BACNET_BASIC_OBJECT_OBJFACTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacenum.h"
+#include "bacnet/basic/sys/strarena.h"
+
+/**
+ * @brief The initial properties of one object.  Analog objects use
+ *  the units, present value and COV increment; binary objects use the
+ *  active and inactive text and the binary present value.
+ */
+typedef struct bacnet_object_descriptor {
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    const char *name;
+    const char *description;
+    /* analog objects */
+    uint16_t units;
+    float present_value;
+    float cov_increment;
+    /* binary objects */
+    const char *active_text;
+    const char *inactive_text;
+    uint8_t present_value_binary;
+} BACNET_OBJECT_DESCRIPTOR;
+
+/* one row of a descriptor table */
+#define BACNET_OBJECT_ANALOG_VALUE(                                    \
+    instance, name, description, units, value, cov_increment)          \
+    { OBJECT_ANALOG_VALUE, (instance), (name), (description), (units), \
+      (value), (cov_increment), NULL, NULL, 0 }
+#define BACNET_OBJECT_ANALOG_INPUT(                                    \
+    instance, name, description, units, value, cov_increment)          \
+    { OBJECT_ANALOG_INPUT, (instance), (name), (description), (units), \
+      (value), (cov_increment), NULL, NULL, 0 }
+#define BACNET_OBJECT_BINARY_VALUE(                                 \
+    instance, name, description, active_text, inactive_text, value) \
+    { OBJECT_BINARY_VALUE, (instance), (name), (description), 0,    \
+      0.0f, 0.0f, (active_text), (inactive_text), (value) }
+#define BACNET_OBJECT_BINARY_INPUT(                                 \
+    instance, name, description, active_text, inactive_text, value) \
+    { OBJECT_BINARY_INPUT, (instance), (name), (description), 0,    \
+      0.0f, 0.0f, (active_text), (inactive_text), (value) }
+#define BACNET_OBJECT_BINARY_OUTPUT(                                \
+    instance, name, description, active_text, inactive_text, value) \
+    { OBJECT_BINARY_OUTPUT, (instance), (name), (description), 0,   \
+      0.0f, 0.0f, (active_text), (inactive_text), (value) }
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+bool Object_Factory_Supported(BACNET_OBJECT_TYPE object_type);
+
+BACNET_STACK_EXPORT
+size_t Object_Factory_Arena_Size(
+    const BACNET_OBJECT_DESCRIPTOR *table, size_t count, unsigned *strings);
+
+BACNET_STACK_EXPORT
+bool Object_Factory_Object_Create(
+    const BACNET_OBJECT_DESCRIPTOR *object, STRING_ARENA *arena);
+
+BACNET_STACK_EXPORT
+unsigned Object_Factory_Create(
+    const BACNET_OBJECT_DESCRIPTOR *table, size_t count, STRING_ARENA *arena);
+
+BACNET_STACK_EXPORT
+unsigned Object_Factory_Count(
+    const BACNET_OBJECT_DESCRIPTOR *table,
+    size_t count,
+    BACNET_OBJECT_TYPE object_type);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -22,6 +22,7 @@
 #include "bacnet/basic/services.h"
 #include "bacnet/basic/binding/address.h"
 #include "bacnet/basic/object/trendlog.h"
+#include "bacnet/basic/object/trendlog_store.h"
 #include "bacnet/datalink/datalink.h"
 #if defined(BACFILE)
 #include "bacnet/basic/object/bacfile.h" /* object list dependency */
@@ -32,9 +33,36 @@
 #define MAX_TREND_LOGS 8
 #endif
 
-static TL_DATA_REC Logs[MAX_TREND_LOGS][TL_MAX_ENTRIES];
+/* fill the logs with readings for testing */
+#ifndef TRENDLOG_DEMO_DATA
+#define TRENDLOG_DEMO_DATA 1
+#endif
+
+/* seconds between copies of the newest block of each log to flash */
+#ifndef TRENDLOG_FLASH_CHECKPOINT
+#define TRENDLOG_FLASH_CHECKPOINT 300
+#endif
+
+/* records of the flash log: a block of a log, with its index, or a purge
+   of a log, with the sequence number of the record before the next one */
+#define TL_FLASH_BLOCK 'B'
+#define TL_FLASH_PURGE 'P'
+#define TL_FLASH_BLOCK_HEADER 18
+#define TL_FLASH_PURGE_LENGTH 6
+
+static TRENDLOG_STORE Logs[MAX_TREND_LOGS];
 static TL_LOG_INFO LogInfo[MAX_TREND_LOGS];
 
+/* where sealed blocks are kept across a reset, or NULL */
+static FLASH_LOG *TL_Flash;
+static uint8_t
+    TL_Flash_Record[TL_FLASH_BLOCK_HEADER + TRENDLOG_STORE_BLOCK_SIZE];
+/* the newest block of each log, and how many of its records are in
+   flash */
+static uint32_t TL_Flash_Sequence[MAX_TREND_LOGS];
+static uint16_t TL_Flash_Count[MAX_TREND_LOGS];
+static bacnet_time_t TL_Flash_Time;
+
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int32_t Trend_Log_Properties_Required[] = {
     PROP_OBJECT_IDENTIFIER,
@@ -146,6 +174,230 @@ static bacnet_time_t Trend_Log_Epoch_Seconds_Now(void)
     return datetime_seconds_since_epoch(&bdatetime);
 }
 
+/**
+ * @brief Copy a block of a Trend Log to the flash log
+ * @param iLog - Index of the log
+ * @param block - block number from the oldest
+ * @return true if the block is in flash
+ */
+static bool TL_Flash_Block_Write(int iLog, uint16_t block)
+{
+    TRENDLOG_STORE_BLOCK index;
+    const uint8_t *data = NULL;
+    uint8_t *record = TL_Flash_Record;
+
+    if (!TL_Flash ||
+        !trendlog_store_block(&Logs[iLog], block, &index, &data)) {
+        return false;
+    }
+    record[0] = TL_FLASH_BLOCK;
+    record[1] = (uint8_t)iLog;
+    encode_unsigned64(&record[2], (uint64_t)index.first_time);
+    encode_unsigned32(&record[10], index.first_sequence);
+    encode_unsigned16(&record[14], index.count);
+    encode_unsigned16(&record[16], index.used);
+    memcpy(&record[TL_FLASH_BLOCK_HEADER], data, index.used);
+
+    return flash_log_append(
+        TL_Flash, record, TL_FLASH_BLOCK_HEADER + index.used);
+}
+
+/**
+ * @brief Copy the newest block of a Trend Log to flash if it has records
+ *  that are not there yet
+ * @param iLog - Index of the log
+ */
+static void TL_Flash_Checkpoint(int iLog)
+{
+    TRENDLOG_STORE_BLOCK index;
+    uint16_t block = trendlog_store_blocks(&Logs[iLog]) - 1;
+
+    if (trendlog_store_block(&Logs[iLog], block, &index, NULL) &&
+        (index.first_sequence == TL_Flash_Sequence[iLog]) &&
+        (index.count != TL_Flash_Count[iLog]) &&
+        TL_Flash_Block_Write(iLog, block)) {
+        TL_Flash_Count[iLog] = index.count;
+    }
+}
+
+/**
+ * @brief After a record is added: when it starts a new block, the block
+ *  before it is sealed, and goes to flash
+ * @param iLog - Index of the log
+ */
+static void TL_Flash_Sync(int iLog)
+{
+    TRENDLOG_STORE_BLOCK index, prior;
+    uint16_t blocks;
+
+    if (!TL_Flash) {
+        return;
+    }
+    blocks = trendlog_store_blocks(&Logs[iLog]);
+    if (!trendlog_store_block(&Logs[iLog], blocks - 1, &index, NULL) ||
+        (index.first_sequence == TL_Flash_Sequence[iLog])) {
+        return;
+    }
+    if ((blocks > 1) &&
+        trendlog_store_block(&Logs[iLog], blocks - 2, &prior, NULL) &&
+        (prior.first_sequence == TL_Flash_Sequence[iLog]) &&
+        (prior.count != TL_Flash_Count[iLog])) {
+        TL_Flash_Block_Write(iLog, blocks - 2);
+    }
+    TL_Flash_Sequence[iLog] = index.first_sequence;
+    TL_Flash_Count[iLog] = 0;
+}
+
+/**
+ * @brief Add a record to a Trend Log, pushing out the oldest when full
+ * @param iLog - Index of the log
+ * @param pRecord - the record
+ */
+static void TL_Insert_Record(int iLog, const TL_DATA_REC *pRecord)
+{
+    trendlog_store_append(&Logs[iLog], pRecord);
+    LogInfo[iLog].ulRecordCount = trendlog_store_count(&Logs[iLog]);
+    LogInfo[iLog].ulTotalRecordCount = trendlog_store_sequence(&Logs[iLog]);
+    TL_Flash_Sync(iLog);
+}
+
+/**
+ * @brief Remove all the records of a Trend Log, and record the fact
+ * @param iLog - Index of the log
+ */
+static void TL_Purge(int iLog)
+{
+    uint8_t record[TL_FLASH_PURGE_LENGTH];
+
+    trendlog_store_purge(&Logs[iLog], LogInfo[iLog].ulTotalRecordCount);
+    LogInfo[iLog].ulRecordCount = 0;
+    if (TL_Flash) {
+        record[0] = TL_FLASH_PURGE;
+        record[1] = (uint8_t)iLog;
+        encode_unsigned32(&record[2], LogInfo[iLog].ulTotalRecordCount);
+        flash_log_append(TL_Flash, record, sizeof(record));
+        TL_Flash_Sequence[iLog] = 0;
+        TL_Flash_Count[iLog] = 0;
+    }
+    TL_Insert_Status_Rec(iLog, LOG_STATUS_BUFFER_PURGED, true);
+}
+
+/**
+ * @brief Replay one record of the flash log into the Trend Logs
+ * @param record - the record
+ * @param length - octets of the record
+ * @param restored - which logs have had their records replaced so far
+ */
+static void
+TL_Flash_Restore(const uint8_t *record, size_t length, bool *restored)
+{
+    TRENDLOG_STORE_BLOCK index;
+    uint64_t first_time = 0;
+    uint32_t sequence = 0;
+    unsigned iLog;
+
+    if (length < TL_FLASH_PURGE_LENGTH) {
+        return;
+    }
+    iLog = record[1];
+    if (iLog >= MAX_TREND_LOGS) {
+        return;
+    }
+    if (!restored[iLog]) {
+        /* the records in flash replace those logged since the reset */
+        restored[iLog] = true;
+        trendlog_store_purge(&Logs[iLog], 0);
+    }
+    if (record[0] == TL_FLASH_PURGE) {
+        decode_unsigned32(&record[2], &sequence);
+        trendlog_store_purge(&Logs[iLog], sequence);
+    } else if (
+        (record[0] == TL_FLASH_BLOCK) && (length >= TL_FLASH_BLOCK_HEADER)) {
+        decode_unsigned64(&record[2], &first_time);
+        index.first_time = (bacnet_time_t)first_time;
+        decode_unsigned32(&record[10], &index.first_sequence);
+        decode_unsigned16(&record[14], &index.count);
+        decode_unsigned16(&record[16], &index.used);
+        if (length == (TL_FLASH_BLOCK_HEADER + (size_t)index.used)) {
+            trendlog_store_block_add(
+                &Logs[iLog], &index, &record[TL_FLASH_BLOCK_HEADER]);
+        }
+    }
+}
+
+/**
+ * @brief Keep the Trend Logs in a flash log across resets.  The records
+ *  already in the flash log are restored first, replacing those of each
+ *  log found there, and a Log-Interrupted status record marks the reset.
+ *  From then on, each block of records goes to flash when it is sealed,
+ *  and the newest block every TRENDLOG_FLASH_CHECKPOINT seconds.
+ * @param log - a mounted flash log, or NULL to keep the logs in RAM only
+ * @return true if the flash log can hold the blocks of the logs
+ */
+bool Trend_Log_Flash_Set(FLASH_LOG *log)
+{
+    FLASH_LOG_CURSOR cursor;
+    TRENDLOG_STORE_BLOCK index;
+    bool restored[MAX_TREND_LOGS] = { 0 };
+    const uint8_t *record;
+    bool found;
+    int iLog;
+
+    TL_Flash = NULL;
+    if (!log) {
+        return true;
+    }
+    if (flash_log_record_max(log) < sizeof(TL_Flash_Record)) {
+        return false;
+    }
+    /* read in place when the partition is mapped */
+    found = flash_log_first(log, &cursor);
+    while (found) {
+        record = flash_log_read(
+            log, &cursor, TL_Flash_Record, sizeof(TL_Flash_Record));
+        if (record) {
+            TL_Flash_Restore(record, cursor.length, restored);
+        }
+        found = flash_log_next(log, &cursor);
+    }
+    for (iLog = 0; iLog < MAX_TREND_LOGS; iLog++) {
+        if (restored[iLog]) {
+            LogInfo[iLog].ulRecordCount = trendlog_store_count(&Logs[iLog]);
+            LogInfo[iLog].ulTotalRecordCount =
+                trendlog_store_sequence(&Logs[iLog]);
+        }
+        TL_Flash_Sequence[iLog] = 0;
+        TL_Flash_Count[iLog] = 0;
+        if (trendlog_store_block(
+                &Logs[iLog], trendlog_store_blocks(&Logs[iLog]) - 1, &index,
+                NULL)) {
+            TL_Flash_Sequence[iLog] = index.first_sequence;
+            if (restored[iLog]) {
+                TL_Flash_Count[iLog] = index.count;
+            }
+        }
+    }
+    TL_Flash = log;
+    TL_Flash_Time = Trend_Log_Epoch_Seconds_Now();
+    for (iLog = 0; iLog < MAX_TREND_LOGS; iLog++) {
+        if (restored[iLog]) {
+            TL_Insert_Status_Rec(iLog, LOG_STATUS_LOG_INTERRUPTED, true);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Determine if the next record will push out the oldest one
+ * @param iLog - Index of the log
+ * @return true if the log is full
+ */
+static bool TL_Is_Full(int iLog)
+{
+    return trendlog_store_full(&Logs[iLog]);
+}
+
 /*
  * Things to do when starting up the stack for Trend Logs.
  * Should be called whenever we reset the device or power it up
@@ -154,10 +406,13 @@ void Trend_Log_Init(void)
 {
     static bool initialized = false;
     int iLog;
+#if TRENDLOG_DEMO_DATA
     int iEntry;
+    TL_DATA_REC TempRec = { 0 };
     BACNET_DATE_TIME bdatetime = { 0 };
     bacnet_time_t tClock;
     uint8_t month;
+#endif
 
     if (!initialized) {
         initialized = true;
@@ -176,50 +431,50 @@ void Trend_Log_Init(void)
              * entries into any active logs if the power down or reset
              * may have caused us to miss readings.
              */
+            trendlog_store_init(&Logs[iLog], TL_MAX_ENTRIES);
+            LogInfo[iLog].bAlignIntervals = true;
+            LogInfo[iLog].bStopWhenFull = false;
+            LogInfo[iLog].bTrigger = false;
+            LogInfo[iLog].LoggingType = LOGGING_TYPE_POLLED;
+            LogInfo[iLog].ucTimeFlags = 0;
+            LogInfo[iLog].ulIntervalOffset = 0;
+            LogInfo[iLog].ulLogInterval = 900;
+            LogInfo[iLog].ulRecordCount = 0;
+            LogInfo[iLog].ulTotalRecordCount = 0;
 
+            LogInfo[iLog].Source.deviceIdentifier.instance =
+                Device_Object_Instance_Number();
+            LogInfo[iLog].Source.deviceIdentifier.type = OBJECT_DEVICE;
+            LogInfo[iLog].Source.objectIdentifier.instance = iLog;
+            LogInfo[iLog].Source.objectIdentifier.type = OBJECT_ANALOG_INPUT;
+            LogInfo[iLog].Source.arrayIndex = BACNET_ARRAY_ALL;
+            LogInfo[iLog].Source.propertyIdentifier = PROP_PRESENT_VALUE;
+#if TRENDLOG_DEMO_DATA
             /* We will just fill the logs with some entries for testing
              * purposes.
              */
+            trendlog_store_purge(&Logs[iLog], 10000 - TL_MAX_ENTRIES);
             /* Different month for each log */
             month = iLog + 1;
             datetime_set_values(&bdatetime, 2009, month, 1, 0, 0, 0, 0);
             tClock = datetime_seconds_since_epoch(&bdatetime);
             for (iEntry = 0; iEntry < TL_MAX_ENTRIES; iEntry++) {
-                Logs[iLog][iEntry].tTimeStamp = tClock;
-                Logs[iLog][iEntry].ucRecType = TL_TYPE_REAL;
-                Logs[iLog][iEntry].Datum.fReal =
-                    (float)(iEntry + (iLog * TL_MAX_ENTRIES));
+                TempRec.tTimeStamp = tClock;
+                TempRec.ucRecType = TL_TYPE_REAL;
+                TempRec.Datum.fReal = (float)(iEntry + (iLog * TL_MAX_ENTRIES));
                 /* Put status flags with every second log */
                 if ((iLog & 1) == 0) {
-                    Logs[iLog][iEntry].ucStatus = 128;
+                    TempRec.ucStatus = 128;
                 } else {
-                    Logs[iLog][iEntry].ucStatus = 0;
+                    TempRec.ucStatus = 0;
                 }
+                TL_Insert_Record(iLog, &TempRec);
                 /* advance 15 minutes, in seconds */
                 tClock += 900;
             }
 
             LogInfo[iLog].tLastDataTime = tClock - 900;
-            LogInfo[iLog].bAlignIntervals = true;
             LogInfo[iLog].bEnable = true;
-            LogInfo[iLog].bStopWhenFull = false;
-            LogInfo[iLog].bTrigger = false;
-            LogInfo[iLog].LoggingType = LOGGING_TYPE_POLLED;
-            LogInfo[iLog].Source.arrayIndex = 0;
-            LogInfo[iLog].ucTimeFlags = 0;
-            LogInfo[iLog].ulIntervalOffset = 0;
-            LogInfo[iLog].iIndex = 0;
-            LogInfo[iLog].ulLogInterval = 900;
-            LogInfo[iLog].ulRecordCount = TL_MAX_ENTRIES;
-            LogInfo[iLog].ulTotalRecordCount = 10000;
-
-            LogInfo[iLog].Source.deviceIdentifier.instance =
-                Device_Object_Instance_Number();
-            LogInfo[iLog].Source.deviceIdentifier.type = OBJECT_DEVICE;
-            LogInfo[iLog].Source.objectIdentifier.instance = iLog;
-            LogInfo[iLog].Source.objectIdentifier.type = OBJECT_ANALOG_INPUT;
-            LogInfo[iLog].Source.arrayIndex = BACNET_ARRAY_ALL;
-            LogInfo[iLog].Source.propertyIdentifier = PROP_PRESENT_VALUE;
 
             datetime_set_values(
                 &LogInfo[iLog].StartTime, 2009, 1, 1, 0, 0, 0, 0);
@@ -229,12 +484,132 @@ void Trend_Log_Init(void)
                 &LogInfo[iLog].StopTime, 2020, 12, 22, 23, 59, 59, 99);
             LogInfo[iLog].tStopTime =
                 TL_BAC_Time_To_Local(&LogInfo[iLog].StopTime);
+#else
+            /* empty and disabled until configured, with no time limits */
+            LogInfo[iLog].tLastDataTime = 0;
+            LogInfo[iLog].bEnable = false;
+            LogInfo[iLog].ucTimeFlags = TL_T_START_WILD | TL_T_STOP_WILD;
+            datetime_wildcard_set(&LogInfo[iLog].StartTime);
+            LogInfo[iLog].tStartTime = 0;
+            datetime_wildcard_set(&LogInfo[iLog].StopTime);
+            LogInfo[iLog].tStopTime = datetime_seconds_since_epoch_max();
+#endif
         }
     }
 
     return;
 }
 
+/**
+ * @brief Set the property a Trend Log records, clearing the log if the
+ *  property changes
+ * @param object_instance - object-instance number of the object
+ * @param source - the object property to record
+ * @return true if the source was set
+ */
+bool Trend_Log_Source_Set(
+    uint32_t object_instance,
+    const BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE *source)
+{
+    unsigned log_index = Trend_Log_Instance_To_Index(object_instance);
+
+    if ((log_index >= MAX_TREND_LOGS) || !source) {
+        return false;
+    }
+    if (memcmp(
+            source, &LogInfo[log_index].Source,
+            sizeof(BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE)) != 0) {
+        LogInfo[log_index].Source = *source;
+        TL_Purge(log_index);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Set the time between readings of a polled Trend Log
+ * @param object_instance - object-instance number of the object
+ * @param seconds - time between readings, not zero
+ * @return true if the interval was set
+ */
+bool Trend_Log_Interval_Set(uint32_t object_instance, uint32_t seconds)
+{
+    unsigned log_index = Trend_Log_Instance_To_Index(object_instance);
+
+    if ((log_index >= MAX_TREND_LOGS) || (seconds == 0)) {
+        return false;
+    }
+    LogInfo[log_index].LoggingType = LOGGING_TYPE_POLLED;
+    LogInfo[log_index].ulLogInterval = seconds;
+
+    return true;
+}
+
+/**
+ * @brief Get the memory the records of a Trend Log use
+ * @param object_instance - object-instance number of the object
+ * @return number of octets of compressed records
+ */
+size_t Trend_Log_Buffer_Octets(uint32_t object_instance)
+{
+    unsigned log_index = Trend_Log_Instance_To_Index(object_instance);
+
+    if (log_index >= MAX_TREND_LOGS) {
+        return 0;
+    }
+
+    return trendlog_store_octets(&Logs[log_index]);
+}
+
+/**
+ * @brief Enable or disable a Trend Log, recording the change in the log
+ * @param log_index - Index of the log
+ * @param enable - true to enable the log
+ */
+static void TL_Enable_Set(int log_index, bool enable)
+{
+    bool bEffectiveEnable;
+
+    /* Only trigger this validation on a potential change of state */
+    if (LogInfo[log_index].bEnable != enable) {
+        bEffectiveEnable = TL_Is_Enabled(log_index);
+        LogInfo[log_index].bEnable = enable;
+        if (enable == false) {
+            if (bEffectiveEnable == true) {
+                /* Only insert record if we really were
+                   enabled i.e. times and enable flags */
+                TL_Insert_Status_Rec(log_index, LOG_STATUS_LOG_DISABLED, true);
+            }
+        } else {
+            if (TL_Is_Enabled(log_index)) {
+                /* Have really gone from disabled to enabled as
+                 * enable flag and times were correct
+                 */
+                TL_Insert_Status_Rec(
+                    log_index, LOG_STATUS_LOG_DISABLED, false);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Enable or disable a Trend Log
+ * @param object_instance - object-instance number of the object
+ * @param enable - true to enable the log
+ * @return true if the log exists
+ */
+bool Trend_Log_Enable_Set(uint32_t object_instance, bool enable)
+{
+    unsigned log_index = Trend_Log_Instance_To_Index(object_instance);
+
+    if (log_index >= MAX_TREND_LOGS) {
+        return false;
+    }
+    TL_Enable_Set(log_index, enable);
+
+    return true;
+}
+
 /*
  * Note: we use the instance number here and build the name based
  * on the assumption that there is a 1 to 1 correspondence. If there
@@ -459,37 +834,14 @@ bool Trend_Log_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                  * set */
                 if ((CurrentLog->bEnable == false) &&
                     (CurrentLog->bStopWhenFull == true) &&
-                    (CurrentLog->ulRecordCount == TL_MAX_ENTRIES) &&
-                    (value.type.Boolean == true)) {
+                    TL_Is_Full(log_index) && (value.type.Boolean == true)) {
                     status = false;
                     wp_data->error_class = ERROR_CLASS_OBJECT;
                     wp_data->error_code = ERROR_CODE_LOG_BUFFER_FULL;
                     break;
                 }
-
-                /* Only trigger this validation on a potential change of state
-                 */
-                if (CurrentLog->bEnable != value.type.Boolean) {
-                    bEffectiveEnable = TL_Is_Enabled(log_index);
-                    CurrentLog->bEnable = value.type.Boolean;
-                    /* To do: what actions do we need to take on writing ? */
-                    if (value.type.Boolean == false) {
-                        if (bEffectiveEnable == true) {
-                            /* Only insert record if we really were
-                               enabled i.e. times and enable flags */
-                            TL_Insert_Status_Rec(
-                                log_index, LOG_STATUS_LOG_DISABLED, true);
-                        }
-                    } else {
-                        if (TL_Is_Enabled(log_index)) {
-                            /* Have really gone from disabled to enabled as
-                             * enable flag and times were correct
-                             */
-                            TL_Insert_Status_Rec(
-                                log_index, LOG_STATUS_LOG_DISABLED, false);
-                        }
-                    }
-                }
+                /* To do: what actions do we need to take on writing ? */
+                TL_Enable_Set(log_index, value.type.Boolean);
             }
             break;
 
@@ -502,7 +854,7 @@ bool Trend_Log_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                     CurrentLog->bStopWhenFull = value.type.Boolean;
 
                     if ((value.type.Boolean == true) &&
-                        (CurrentLog->ulRecordCount == TL_MAX_ENTRIES) &&
+                        TL_Is_Full(log_index) &&
                         (CurrentLog->bEnable == true)) {
                         /* When full log is switched from normal to stop when
                          * full disable the log and record the fact - see
@@ -531,10 +883,7 @@ bool Trend_Log_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
             if (status) {
                 if (value.type.Unsigned_Int == 0) {
                     /* Time to clear down the log */
-                    CurrentLog->ulRecordCount = 0;
-                    CurrentLog->iIndex = 0;
-                    TL_Insert_Status_Rec(
-                        log_index, LOG_STATUS_BUFFER_PURGED, true);
+                    TL_Purge(log_index);
                 }
             }
             break;
@@ -697,11 +1046,9 @@ bool Trend_Log_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                     &TempSource, &CurrentLog->Source,
                     sizeof(BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE)) != 0) {
                 /* Clear buffer if property being logged is changed */
-                CurrentLog->ulRecordCount = 0;
-                CurrentLog->iIndex = 0;
-                TL_Insert_Status_Rec(log_index, LOG_STATUS_BUFFER_PURGED, true);
+                CurrentLog->Source = TempSource;
+                TL_Purge(log_index);
             }
-            CurrentLog->Source = TempSource;
             status = true;
             break;
 
@@ -844,16 +1191,7 @@ void TL_Insert_Status_Rec(int iLog, BACNET_LOG_STATUS eStatus, bool bState)
             break;
     }
 
-    Logs[iLog][CurrentLog->iIndex++] = TempRec;
-    if (CurrentLog->iIndex >= TL_MAX_ENTRIES) {
-        CurrentLog->iIndex = 0;
-    }
-
-    CurrentLog->ulTotalRecordCount++;
-
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES) {
-        CurrentLog->ulRecordCount++;
-    }
+    TL_Insert_Record(iLog, &TempRec);
 }
 
 /*****************************************************************************
@@ -934,7 +1272,22 @@ bacnet_time_t TL_BAC_Time_To_Local(const BACNET_DATE_TIME *bdatetime)
 
 void TL_Local_Time_To_BAC(BACNET_DATE_TIME *bdatetime, bacnet_time_t seconds)
 {
-    datetime_since_epoch_seconds(bdatetime, seconds);
+    /* the records of a log buffer list mostly share a day, and finding
+       the date counts the years from the epoch, so keep the last one */
+    static uint32_t Last_Day = UINT32_MAX;
+    static BACNET_DATE Last_Date;
+    const uint32_t day_seconds = 24UL * 60UL * 60UL;
+    uint32_t days;
+
+    days = (uint32_t)(seconds / day_seconds);
+    if (days != Last_Day) {
+        datetime_days_since_epoch_into_date(days, &Last_Date);
+        Last_Day = days;
+    }
+    bdatetime->date = Last_Date;
+    datetime_seconds_since_midnight_into_time(
+        (uint32_t)(seconds - ((bacnet_time_t)days * day_seconds)),
+        &bdatetime->time);
 }
 
 /****************************************************************************
@@ -958,6 +1311,8 @@ void TL_Local_Time_To_BAC(BACNET_DATE_TIME *bdatetime, bacnet_time_t seconds)
 
 #define TL_MAX_ENC 23 /* Maximum size of encoded log entry, see above */
 
+static int TL_encode_record(uint8_t *apdu, const TL_DATA_REC *pSource);
+
 /**
  * @brief Handle encoding for the options.
  * @param apdu - Pointer to the buffer to encode into.
@@ -1018,6 +1373,7 @@ int TL_encode_by_position(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
     uint32_t uiLast = 0; /* Entry number we finished encoding on */
     uint32_t uiTarget = 0; /* Last entry we are required to encode */
     uint32_t uiRemaining = 0; /* Amount of unused space in packet */
+    TRENDLOG_STORE_CURSOR cursor = { 0 };
 
     /* See how much space we have */
     uiRemaining = MAX_APDU - pRequest->Overhead;
@@ -1078,6 +1434,9 @@ int TL_encode_by_position(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
 
     uiIndex = pRequest->Range.RefIndex;
     uiFirst = uiIndex; /* Record where we started from */
+    if (!trendlog_store_seek_position(&Logs[log_index], uiIndex, &cursor)) {
+        return (0);
+    }
     while (uiIndex <= uiTarget) {
         if (uiRemaining < TL_MAX_ENC) {
             /*
@@ -1089,12 +1448,13 @@ int TL_encode_by_position(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
             break;
         }
 
-        iTemp = TL_encode_entry(&apdu[iLen], log_index, uiIndex);
+        iTemp = TL_encode_record(&apdu[iLen], &cursor.record);
 
         uiRemaining -= iTemp; /* Reduce the remaining space */
         iLen += iTemp; /* and increase the length consumed */
         uiLast = uiIndex; /* Record the last entry encoded */
         uiIndex++; /* and get ready for next one */
+        trendlog_store_next(&cursor);
         pRequest->ItemCount++; /* Chalk up another one for the response count */
     }
 
@@ -1141,6 +1501,7 @@ int TL_encode_by_sequence(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
                               uint32_t? */
     bool bWrapLog =
         false; /* Has log sequence range spanned the max for uint32_t? */
+    TRENDLOG_STORE_CURSOR cursor = { 0 };
 
     /* See how much space we have */
     uiRemaining = MAX_APDU - pRequest->Overhead;
@@ -1232,6 +1593,9 @@ int TL_encode_by_sequence(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
     uiIndex = uiBegin - uiFirstSeq + 1;
     uiSequence = uiBegin;
     uiFirst = uiIndex; /* Record where we started from */
+    if (!trendlog_store_seek_position(&Logs[log_index], uiIndex, &cursor)) {
+        return (0);
+    }
     while (uiSequence != uiEnd + 1) {
         if (uiRemaining < TL_MAX_ENC) {
             /*
@@ -1243,12 +1607,13 @@ int TL_encode_by_sequence(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
             break;
         }
 
-        iTemp = TL_encode_entry(&apdu[iLen], log_index, uiIndex);
+        iTemp = TL_encode_record(&apdu[iLen], &cursor.record);
 
         uiRemaining -= iTemp; /* Reduce the remaining space */
         iLen += iTemp; /* and increase the length consumed */
         uiLast = uiIndex; /* Record the last entry encoded */
         uiIndex++; /* and get ready for next one */
+        trendlog_store_next(&cursor);
         uiSequence++;
         pRequest->ItemCount++; /* Chalk up another one for the response count */
     }
@@ -1291,6 +1656,7 @@ int TL_encode_by_time(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
     uint32_t uiRemaining = 0; /* Amount of unused space in packet */
     uint32_t uiFirstSeq = 0; /* Sequence number for 1st record in log */
     bacnet_time_t tRefTime = 0; /* The time from the request in local format */
+    TRENDLOG_STORE_CURSOR cursor = { 0 };
 
     /* See how much space we have */
     uiRemaining = MAX_APDU - pRequest->Overhead;
@@ -1298,32 +1664,16 @@ int TL_encode_by_time(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
     CurrentLog = &LogInfo[log_index];
 
     tRefTime = TL_BAC_Time_To_Local(&pRequest->Range.RefTime);
-    /* Find correct position for oldest entry in log */
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES) {
-        uiIndex = 0;
-    } else {
-        uiIndex = CurrentLog->iIndex;
-    }
-
     if (pRequest->Count < 0) {
-        /* Start at end of log and look for record which has
-         * timestamp greater than or equal to the reference.
+        /* Find the last record which has a timestamp before
+         * the reference.
          */
-        iCount = CurrentLog->ulRecordCount - 1;
-        /* Start out with the sequence number for the last record */
-        uiFirstSeq = CurrentLog->ulTotalRecordCount;
-        for (;;) {
-            if (Logs[log_index][(uiIndex + iCount) % TL_MAX_ENTRIES]
-                    .tTimeStamp < tRefTime) {
-                break;
-            }
-
-            uiFirstSeq--;
-            iCount--;
-            if (iCount < 0) {
-                return (0);
-            }
+        if (!trendlog_store_seek_before(&Logs[log_index], tRefTime, &cursor)) {
+            return (0);
         }
+        iCount = cursor.position - 1;
+        /* Start out with the sequence number for that record */
+        uiFirstSeq = cursor.sequence;
 
         /* We have an and point for our request,
          * now work backwards to find where we should start from
@@ -1345,32 +1695,25 @@ int TL_encode_by_time(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
             iCount -= iTemp;
         }
     } else {
-        /* Start at beginning of log and look for 1st record which has
-         * timestamp greater than the reference time.
+        /* Find the 1st record which has timestamp greater than
+         * the reference time.
          */
-        iCount = 0;
-        /* Figure out the sequence number for the first record, last is
-         * ulTotalRecordCount */
-        uiFirstSeq =
-            CurrentLog->ulTotalRecordCount - (CurrentLog->ulRecordCount - 1);
-        for (;;) {
-            if (Logs[log_index][(uiIndex + iCount) % TL_MAX_ENTRIES]
-                    .tTimeStamp > tRefTime) {
-                break;
-            }
-
-            uiFirstSeq++;
-            iCount++;
-            if ((uint32_t)iCount == CurrentLog->ulRecordCount) {
-                return (0);
-            }
+        if (!trendlog_store_seek_after(&Logs[log_index], tRefTime, &cursor)) {
+            return (0);
         }
+        iCount = cursor.position - 1;
+        /* and the sequence number for that record */
+        uiFirstSeq = cursor.sequence;
     }
 
     /* We now have a starting point for the operation and a +ve count */
 
     uiIndex = iCount + 1; /* Convert to BACnet 1 based reference */
     uiFirst = uiIndex; /* Record where we started from */
+    if ((cursor.position != uiIndex) &&
+        !trendlog_store_seek_position(&Logs[log_index], uiIndex, &cursor)) {
+        return (0);
+    }
     iCount = pRequest->Count;
     while (iCount != 0) {
         if (uiRemaining < TL_MAX_ENC) {
@@ -1383,12 +1726,13 @@ int TL_encode_by_time(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
             break;
         }
 
-        iTemp = TL_encode_entry(&apdu[iLen], log_index, uiIndex);
+        iTemp = TL_encode_record(&apdu[iLen], &cursor.record);
 
         uiRemaining -= iTemp; /* Reduce the remaining space */
         iLen += iTemp; /* and increase the length consumed */
         uiLast = uiIndex; /* Record the last entry encoded */
         uiIndex++; /* and get ready for next one */
+        trendlog_store_next(&cursor);
         pRequest->ItemCount++; /* Chalk up another one for the response count */
         iCount--; /* And finally cross another one off the requested count
                    */
@@ -1420,23 +1764,30 @@ int TL_encode_by_time(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
  * @param iEntry - Index of the entry to encode (1 based).
  */
 int TL_encode_entry(uint8_t *apdu, int iLog, int iEntry)
+{
+    TRENDLOG_STORE_CURSOR cursor = { 0 };
+
+    if ((iEntry < 1) ||
+        !trendlog_store_seek_position(&Logs[iLog], iEntry, &cursor)) {
+        return 0;
+    }
+
+    return TL_encode_record(apdu, &cursor.record);
+}
+
+/**
+ * @brief Encode a single log record into the APDU buffer.
+ * @param apdu - Pointer to the buffer to encode into.
+ * @param pSource - the record
+ * @return number of bytes encoded
+ */
+static int TL_encode_record(uint8_t *apdu, const TL_DATA_REC *pSource)
 {
     int iLen = 0;
-    TL_DATA_REC *pSource = NULL;
     BACNET_BIT_STRING TempBits;
     uint8_t ucCount = 0;
     BACNET_DATE_TIME TempTime;
 
-    /* Convert from BACnet 1 based to 0 based array index and then
-     * handle wrap around of the circular buffer */
-
-    if (LogInfo[iLog].ulRecordCount < TL_MAX_ENTRIES) {
-        pSource = &Logs[iLog][(iEntry - 1) % TL_MAX_ENTRIES];
-    } else {
-        pSource =
-            &Logs[iLog][(LogInfo[iLog].iIndex + iEntry - 1) % TL_MAX_ENTRIES];
-    }
-
     iLen = 0;
     /* First stick the time stamp in with tag [0] */
     TL_Local_Time_To_BAC(&TempTime, pSource->tTimeStamp);
@@ -1698,16 +2049,7 @@ static void TL_fetch_property(int iLog)
         TempRec.ucStatus = 128 | bitstring_octet(&TempBits, 0);
     }
 
-    Logs[iLog][CurrentLog->iIndex++] = TempRec;
-    if (CurrentLog->iIndex >= TL_MAX_ENTRIES) {
-        CurrentLog->iIndex = 0;
-    }
-
-    CurrentLog->ulTotalRecordCount++;
-
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES) {
-        CurrentLog->ulRecordCount++;
-    }
+    TL_Insert_Record(iLog, &TempRec);
 }
 
 /**
@@ -1723,6 +2065,13 @@ void trend_log_timer(uint16_t uSeconds)
     (void)uSeconds;
     /* use OS to get the current time */
     tNow = Trend_Log_Epoch_Seconds_Now();
+    if (TL_Flash && ((tNow < TL_Flash_Time) ||
+                     ((tNow - TL_Flash_Time) >= TRENDLOG_FLASH_CHECKPOINT))) {
+        TL_Flash_Time = tNow;
+        for (iCount = 0; iCount < MAX_TREND_LOGS; iCount++) {
+            TL_Flash_Checkpoint(iCount);
+        }
+    }
     for (iCount = 0; iCount < MAX_TREND_LOGS; iCount++) {
         CurrentLog = &LogInfo[iCount];
         if (TL_Is_Enabled(iCount)) {
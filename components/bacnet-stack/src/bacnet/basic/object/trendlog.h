@@ -8,6 +8,7 @@
 #ifndef BACNET_BASIC_OBJECT_TRENDLOG_H
 #define BACNET_BASIC_OBJECT_TRENDLOG_H
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 /* BACnet Stack defines - first */
 #include "bacnet/bacdef.h"
@@ -17,6 +18,7 @@
 #include "bacnet/readrange.h"
 #include "bacnet/rp.h"
 #include "bacnet/wp.h"
+#include "bacnet/basic/sys/flashlog.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -67,7 +69,9 @@ typedef struct tl_data_record {
 #define TL_T_START_WILD 1 /* Start time is wild carded */
 #define TL_T_STOP_WILD 2 /* Stop Time is wild carded */
 
+#ifndef TL_MAX_ENTRIES
 #define TL_MAX_ENTRIES 1000 /* Entries per datalog */
+#endif
 
 /* Structure containing config and status info for a Trend Log */
 
@@ -90,7 +94,6 @@ typedef struct tl_log_info {
     /* Offset from start of period for taking reading in seconds */
     uint32_t ulIntervalOffset;
     bool bTrigger; /* Set to 1 to cause a reading to be taken */
-    int iIndex; /* Current insertion point */
     bacnet_time_t tLastDataTime;
 } TL_LOG_INFO;
 
@@ -141,6 +144,19 @@ bool Trend_Log_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data);
 BACNET_STACK_EXPORT
 void Trend_Log_Init(void);
 
+BACNET_STACK_EXPORT
+bool Trend_Log_Source_Set(
+    uint32_t object_instance,
+    const BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE *source);
+BACNET_STACK_EXPORT
+bool Trend_Log_Interval_Set(uint32_t object_instance, uint32_t seconds);
+BACNET_STACK_EXPORT
+bool Trend_Log_Enable_Set(uint32_t object_instance, bool enable);
+BACNET_STACK_EXPORT
+size_t Trend_Log_Buffer_Octets(uint32_t object_instance);
+BACNET_STACK_EXPORT
+bool Trend_Log_Flash_Set(FLASH_LOG *log);
+
 BACNET_STACK_EXPORT
 void TL_Insert_Status_Rec(int iLog, BACNET_LOG_STATUS eStatus, bool bState);
 
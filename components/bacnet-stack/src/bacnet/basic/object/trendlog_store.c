@@ -0,0 +1,1243 @@
+/**
+ * @file
+ * @brief Compressed record store for the Trend Log object.
+ *
+ * Each record is encoded as the changes from the record before it, into
+ * fixed-size blocks kept in a ring.  Every block starts from a blank
+ * record, so it can be decoded on its own, and the index holds the time
+ * stamp and sequence number of the first record of each block: seeking
+ * by position, sequence or time is a binary search of the index and a
+ * short walk through one block.
+ *
+ * A record starts with an opcode:
+ *
+ *   0x00-0x7F  RUN: 1-128 copies of the record before, each the same
+ *              time after the one before it.
+ *   0x80-0xBF  STEP: as RUN, but the integral value changes by -32..31.
+ *   0xC0-0xCF  RECORD: followed by the parts that changed, in the order
+ *              of the flags: type, status, change of the time between
+ *              records (zigzag varint), and the value.
+ *   0xD0-0xDF  STEPS: followed by 1-16 octets of steps of -1, 0 or +1,
+ *              four to an octet from the top bits, unused ones last.
+ *
+ * Values of a REAL record are stored as the XOR with the value before,
+ * less the leading and trailing zero octets; unsigned, signed and
+ * enumerated values as a zigzag varint of the difference.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/basic/object/trendlog_store.h"
+
+#define STORE_RUN_MAX 0x7F
+#define STORE_STEP 0x80
+#define STORE_STEP_MIN (-32)
+#define STORE_STEP_MAX 31
+#define STORE_RECORD 0xC0
+#define STORE_PACK 0xD0
+#define STORE_PACK_OCTETS_MAX 16
+/* two bit steps: 0, +1 and -1, and the code of an unused one */
+#define STORE_PACK_UNUSED 2
+#define STORE_PACK_EMPTY 0xAA
+/* zero steps in a row after which a run is smaller */
+#define STORE_PACK_ZEROS_MAX 8
+#define STORE_FLAG_DOD 0x01
+#define STORE_FLAG_STATUS 0x02
+#define STORE_FLAG_TYPE 0x04
+#define STORE_FLAG_VALUE 0x08
+/* record type of the blank record each block starts from */
+#define STORE_TYPE_NONE 0xFF
+
+/* how a record is added to the newest block */
+typedef enum {
+    STORE_EDIT_RECORD,
+    STORE_EDIT_RUN,
+    STORE_EDIT_STEPS,
+    STORE_EDIT_PACK
+} STORE_EDIT;
+
+/**
+ * @brief Get the ring slot of a block
+ * @param store - the store
+ * @param block - block number from the oldest
+ * @return slot of the block in the index and data arrays
+ */
+static uint16_t store_slot(const TRENDLOG_STORE *store, uint16_t block)
+{
+    return (uint16_t)((store->head + block) % TRENDLOG_STORE_BLOCKS);
+}
+
+/**
+ * @brief Copy the parts of a record its type uses, so that two records
+ *  with the same value compare equal
+ * @param dest - the copy
+ * @param src - the record
+ */
+static void record_copy(TL_DATA_REC *dest, const TL_DATA_REC *src)
+{
+    memset(dest, 0, sizeof(*dest));
+    dest->tTimeStamp = src->tTimeStamp;
+    dest->ucRecType = src->ucRecType;
+    dest->ucStatus = src->ucStatus;
+    switch (src->ucRecType) {
+        case TL_TYPE_STATUS:
+            dest->Datum.ucLogStatus = src->Datum.ucLogStatus;
+            break;
+        case TL_TYPE_BOOL:
+            dest->Datum.ucBoolean = src->Datum.ucBoolean;
+            break;
+        case TL_TYPE_REAL:
+            dest->Datum.fReal = src->Datum.fReal;
+            break;
+        case TL_TYPE_DELTA:
+            dest->Datum.fTime = src->Datum.fTime;
+            break;
+        case TL_TYPE_ENUM:
+            dest->Datum.ulEnum = src->Datum.ulEnum;
+            break;
+        case TL_TYPE_UNSIGN:
+            dest->Datum.ulUValue = src->Datum.ulUValue;
+            break;
+        case TL_TYPE_SIGN:
+            dest->Datum.lSValue = src->Datum.lSValue;
+            break;
+        case TL_TYPE_BITS:
+            dest->Datum.Bits.ucLen = src->Datum.Bits.ucLen;
+            if ((dest->Datum.Bits.ucLen >> 4) > 4) {
+                dest->Datum.Bits.ucLen = (4 << 4) | (src->Datum.Bits.ucLen & 7);
+            }
+            memcpy(
+                dest->Datum.Bits.ucStore, src->Datum.Bits.ucStore,
+                dest->Datum.Bits.ucLen >> 4);
+            break;
+        case TL_TYPE_ERROR:
+            dest->Datum.Error = src->Datum.Error;
+            break;
+        default:
+            break;
+    }
+}
+
+static int varint_encode(uint8_t *buffer, uint64_t value)
+{
+    int len = 0;
+
+    while (value >= 0x80) {
+        buffer[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[len++] = (uint8_t)value;
+
+    return len;
+}
+
+static int varint_decode(const uint8_t *buffer, uint64_t *value)
+{
+    int len = 0;
+    unsigned shift = 0;
+
+    *value = 0;
+    do {
+        *value |= (uint64_t)(buffer[len] & 0x7F) << shift;
+        shift += 7;
+    } while ((buffer[len++] & 0x80) && (shift < 64));
+
+    return len;
+}
+
+static uint64_t zigzag_encode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static uint32_t real_bits(float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    return bits;
+}
+
+static float real_value(uint32_t bits)
+{
+    float value;
+
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+/**
+ * @brief Find the change of an integral value from one record to the next
+ * @param prior - the record before
+ * @param record - the record
+ * @param step - the change, -32..31
+ * @return true if the value changed by a step the opcode can hold
+ */
+static bool record_step(
+    const TL_DATA_REC *prior, const TL_DATA_REC *record, int *step)
+{
+    int64_t difference;
+    float real_step;
+
+    switch (record->ucRecType) {
+        case TL_TYPE_REAL:
+            real_step = record->Datum.fReal - prior->Datum.fReal;
+            if (!((real_step >= STORE_STEP_MIN) &&
+                  (real_step <= STORE_STEP_MAX))) {
+                return false;
+            }
+            *step = (int)real_step;
+            /* only if adding it back gives exactly the same value */
+            return real_bits(prior->Datum.fReal + (float)*step) ==
+                real_bits(record->Datum.fReal);
+        case TL_TYPE_ENUM:
+        case TL_TYPE_UNSIGN:
+            difference = (int32_t)(record->Datum.ulUValue -
+                                   prior->Datum.ulUValue);
+            break;
+        case TL_TYPE_SIGN:
+            difference =
+                (int64_t)record->Datum.lSValue - prior->Datum.lSValue;
+            break;
+        default:
+            return false;
+    }
+    if ((difference < STORE_STEP_MIN) || (difference > STORE_STEP_MAX)) {
+        return false;
+    }
+    *step = (int)difference;
+
+    return true;
+}
+
+static void record_step_apply(TL_DATA_REC *record, int step)
+{
+    switch (record->ucRecType) {
+        case TL_TYPE_REAL:
+            record->Datum.fReal += (float)step;
+            break;
+        case TL_TYPE_ENUM:
+        case TL_TYPE_UNSIGN:
+            record->Datum.ulUValue += (uint32_t)step;
+            break;
+        case TL_TYPE_SIGN:
+            record->Datum.lSValue =
+                (int32_t)((uint32_t)record->Datum.lSValue + (uint32_t)step);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Encode the value of a record as the change from the one before
+ * @param buffer - where to encode, at least 5 octets
+ * @param prior - the record before, or a blank value of the same type
+ * @param record - the record
+ * @return number of octets encoded
+ */
+static int value_encode(
+    uint8_t *buffer, const TL_DATA_REC *prior, const TL_DATA_REC *record)
+{
+    int len = 0;
+    uint32_t bits;
+    uint8_t lead = 0, trail = 0, octets;
+
+    switch (record->ucRecType) {
+        case TL_TYPE_REAL:
+        case TL_TYPE_DELTA:
+            bits = real_bits(record->Datum.fReal) ^
+                real_bits(prior->Datum.fReal);
+            while ((lead < 3) && ((bits >> (24 - 8 * lead)) == 0)) {
+                lead++;
+            }
+            while ((lead + trail < 3) &&
+                   (((bits >> (8 * trail)) & 0xFF) == 0)) {
+                trail++;
+            }
+            buffer[len++] = (uint8_t)((lead << 2) | trail);
+            for (octets = 4 - lead - trail; octets > 0; octets--) {
+                buffer[len++] = (uint8_t)(bits >> (8 * (trail + octets - 1)));
+            }
+            break;
+        case TL_TYPE_ENUM:
+        case TL_TYPE_UNSIGN:
+            len = varint_encode(
+                buffer,
+                zigzag_encode((int32_t)(record->Datum.ulUValue -
+                                        prior->Datum.ulUValue)));
+            break;
+        case TL_TYPE_SIGN:
+            len = varint_encode(
+                buffer,
+                zigzag_encode(
+                    (int64_t)record->Datum.lSValue - prior->Datum.lSValue));
+            break;
+        case TL_TYPE_STATUS:
+        case TL_TYPE_BOOL:
+            buffer[len++] = record->Datum.ucBoolean;
+            break;
+        case TL_TYPE_BITS:
+            buffer[len++] = record->Datum.Bits.ucLen;
+            memcpy(
+                &buffer[len], record->Datum.Bits.ucStore,
+                record->Datum.Bits.ucLen >> 4);
+            len += record->Datum.Bits.ucLen >> 4;
+            break;
+        case TL_TYPE_ERROR:
+            len = varint_encode(buffer, record->Datum.Error.usClass);
+            len += varint_encode(&buffer[len], record->Datum.Error.usCode);
+            break;
+        default:
+            break;
+    }
+
+    return len;
+}
+
+/**
+ * @brief Decode the value of a record from the change from the one before
+ * @param buffer - the encoded value
+ * @param record - holds the record before, and gets the record
+ * @return number of octets decoded
+ */
+static int value_decode(const uint8_t *buffer, TL_DATA_REC *record)
+{
+    int len = 0;
+    uint32_t bits = 0;
+    uint8_t lead, trail, octets;
+    uint64_t value = 0, value2 = 0;
+
+    switch (record->ucRecType) {
+        case TL_TYPE_REAL:
+        case TL_TYPE_DELTA:
+            lead = (buffer[len] >> 2) & 0x03;
+            trail = buffer[len++] & 0x03;
+            for (octets = 4 - lead - trail; octets > 0; octets--) {
+                bits = (bits << 8) | buffer[len++];
+            }
+            bits <<= 8 * trail;
+            record->Datum.fReal =
+                real_value(real_bits(record->Datum.fReal) ^ bits);
+            break;
+        case TL_TYPE_ENUM:
+        case TL_TYPE_UNSIGN:
+            len = varint_decode(buffer, &value);
+            record->Datum.ulUValue += (uint32_t)zigzag_decode(value);
+            break;
+        case TL_TYPE_SIGN:
+            len = varint_decode(buffer, &value);
+            record->Datum.lSValue =
+                (int32_t)(record->Datum.lSValue + zigzag_decode(value));
+            break;
+        case TL_TYPE_STATUS:
+        case TL_TYPE_BOOL:
+            record->Datum.ucBoolean = buffer[len++];
+            break;
+        case TL_TYPE_BITS:
+            record->Datum.Bits.ucLen = buffer[len++];
+            memset(
+                record->Datum.Bits.ucStore, 0,
+                sizeof(record->Datum.Bits.ucStore));
+            memcpy(
+                record->Datum.Bits.ucStore, &buffer[len],
+                record->Datum.Bits.ucLen >> 4);
+            len += record->Datum.Bits.ucLen >> 4;
+            break;
+        case TL_TYPE_ERROR:
+            len = varint_decode(buffer, &value);
+            len += varint_decode(&buffer[len], &value2);
+            record->Datum.Error.usClass = (uint16_t)value;
+            record->Datum.Error.usCode = (uint16_t)value2;
+            break;
+        default:
+            break;
+    }
+
+    return len;
+}
+
+/**
+ * @brief Set the blank record each block starts from
+ * @param record - the record
+ * @param delta - time between records
+ * @param first_time - time stamp of the first record of the block
+ */
+static void record_blank(
+    TL_DATA_REC *record, int64_t *delta, bacnet_time_t first_time)
+{
+    memset(record, 0, sizeof(*record));
+    record->ucRecType = STORE_TYPE_NONE;
+    record->tTimeStamp = first_time;
+    *delta = 0;
+}
+
+/**
+ * @brief Encode a record as the changes from the newest one in the store
+ * @param store - the store
+ * @param record - the record, as from record_copy()
+ * @param buffer - where to encode, TRENDLOG_STORE_RECORD_MAX octets
+ * @param delta - time from the newest record to this one
+ * @param edit - how the record is added: as the octets encoded, or by
+ *  extending the opcode at the end of the newest block
+ * @param step - the step of an extended step opcode
+ * @return number of octets the record adds to the block
+ */
+static int record_encode(
+    const TRENDLOG_STORE *store,
+    const TL_DATA_REC *record,
+    uint8_t *buffer,
+    int64_t *delta,
+    STORE_EDIT *edit,
+    int *step)
+{
+    const TL_DATA_REC *prior = &store->last;
+    TL_DATA_REC blank;
+    int64_t dod;
+    int len = 1;
+    uint8_t flags = 0;
+    bool same_value;
+
+    *edit = STORE_EDIT_RECORD;
+    *step = 0;
+    *delta = (int64_t)(record->tTimeStamp - prior->tTimeStamp);
+    dod = *delta - store->last_delta;
+    if (record->ucRecType != prior->ucRecType) {
+        flags |= STORE_FLAG_TYPE;
+        /* the value of a new type is relative to a blank one */
+        memset(&blank, 0, sizeof(blank));
+        prior = &blank;
+        same_value = false;
+    } else {
+        same_value =
+            (memcmp(&record->Datum, &prior->Datum, sizeof(record->Datum)) ==
+             0);
+    }
+    if (record->ucStatus != store->last.ucStatus) {
+        flags |= STORE_FLAG_STATUS;
+    }
+    if ((flags == 0) && (dod == 0)) {
+        if (same_value && store->run) {
+            *edit = STORE_EDIT_RUN;
+            return 0;
+        }
+        if (same_value && store->pack &&
+            (store->pack_zeros >= STORE_PACK_ZEROS_MAX)) {
+            /* a long wait for a change costs less as a run */
+            buffer[0] = 0;
+            return 1;
+        }
+        if (same_value || record_step(prior, record, step)) {
+            if ((*step >= -1) && (*step <= 1)) {
+                if (store->pack) {
+                    *edit = STORE_EDIT_PACK;
+                    return (store->pack_steps == 4) ? 1 : 0;
+                }
+                if (store->step) {
+                    *edit = STORE_EDIT_STEPS;
+                    return 1;
+                }
+            }
+            if (same_value) {
+                buffer[0] = 0;
+            } else {
+                buffer[0] = STORE_STEP | ((unsigned)*step & 0x3F);
+            }
+            return 1;
+        }
+    }
+    if (flags & STORE_FLAG_TYPE) {
+        buffer[len++] = record->ucRecType;
+    }
+    if (flags & STORE_FLAG_STATUS) {
+        buffer[len++] = record->ucStatus;
+    }
+    if (dod != 0) {
+        flags |= STORE_FLAG_DOD;
+        len += varint_encode(&buffer[len], zigzag_encode(dod));
+    }
+    if (!same_value) {
+        flags |= STORE_FLAG_VALUE;
+        len += value_encode(&buffer[len], prior, record);
+    }
+    buffer[0] = STORE_RECORD | flags;
+
+    return len;
+}
+
+/**
+ * @brief Put a step into the packed steps at the end of the newest block
+ * @param store - the store
+ * @param slot - ring slot of the newest block
+ * @param step - the step, -1, 0 or +1
+ */
+static void store_pack_step(TRENDLOG_STORE *store, uint16_t slot, int step)
+{
+    TRENDLOG_STORE_BLOCK *index = &store->index[slot];
+    uint8_t *octet;
+    unsigned shift;
+
+    if (store->pack_steps == 4) {
+        store->data[slot][store->pack - 1]++;
+        store->data[slot][index->used] = STORE_PACK_EMPTY;
+        index->used++;
+        store->octets++;
+        store->pack_steps = 0;
+    }
+    octet = &store->data[slot][index->used - 1];
+    shift = 6 - (2 * store->pack_steps);
+    *octet &= (uint8_t)~(3 << shift);
+    *octet |= (uint8_t)(((unsigned)step & 3) << shift);
+    store->pack_steps++;
+    if (step == 0) {
+        store->pack_zeros++;
+    } else {
+        store->pack_zeros = 0;
+    }
+    if ((store->pack_steps == 4) &&
+        ((store->data[slot][store->pack - 1] & 0x0F) ==
+         (STORE_PACK_OCTETS_MAX - 1))) {
+        store->pack = 0;
+    }
+}
+
+/**
+ * @brief Add an encoded record to the end of the newest block
+ * @param store - the store
+ * @param slot - ring slot of the newest block
+ * @param buffer - the encoded record
+ * @param len - number of octets the record adds to the block
+ * @param edit - how the record is added
+ * @param step - the step of an extended step opcode
+ */
+static void store_record_write(
+    TRENDLOG_STORE *store,
+    uint16_t slot,
+    const uint8_t *buffer,
+    int len,
+    STORE_EDIT edit,
+    int step)
+{
+    TRENDLOG_STORE_BLOCK *index = &store->index[slot];
+    uint8_t *op;
+    int prior_step;
+
+    switch (edit) {
+        case STORE_EDIT_RUN:
+            op = &store->data[slot][store->run - 1];
+            (*op)++;
+            if (*op == STORE_RUN_MAX) {
+                store->run = 0;
+            }
+            break;
+        case STORE_EDIT_STEPS:
+            /* the step before and this one start packed steps */
+            op = &store->data[slot][store->step - 1];
+            prior_step = *op & 0x3F;
+            if (prior_step & 0x20) {
+                prior_step -= 0x40;
+            }
+            *op = STORE_PACK;
+            store->data[slot][index->used] = STORE_PACK_EMPTY;
+            index->used++;
+            store->octets++;
+            store->pack = store->step;
+            store->step = 0;
+            store->pack_steps = 0;
+            store->pack_zeros = 0;
+            store_pack_step(store, slot, prior_step);
+            store_pack_step(store, slot, step);
+            break;
+        case STORE_EDIT_PACK:
+            store_pack_step(store, slot, step);
+            break;
+        default:
+            memcpy(&store->data[slot][index->used], buffer, (size_t)len);
+            store->run = 0;
+            store->step = 0;
+            store->pack = 0;
+            if (buffer[0] <= STORE_RUN_MAX) {
+                store->run = index->used + 1;
+            } else if (buffer[0] < STORE_RECORD) {
+                prior_step = buffer[0] & 0x3F;
+                if ((prior_step <= 1) || (prior_step == 0x3F)) {
+                    store->step = index->used + 1;
+                }
+            }
+            index->used += (uint16_t)len;
+            store->octets += (size_t)len;
+            break;
+    }
+}
+
+/**
+ * @brief Load a block into a cursor, before its first record
+ * @param cursor - the cursor
+ * @param block - block number from the oldest
+ */
+static void cursor_block(TRENDLOG_STORE_CURSOR *cursor, uint16_t block)
+{
+    const TRENDLOG_STORE_BLOCK *index;
+
+    index = &cursor->store->index[store_slot(cursor->store, block)];
+    cursor->block = block;
+    cursor->offset = 0;
+    cursor->left = index->count;
+    cursor->repeat = 0;
+    cursor->packed = 0;
+    cursor->sequence = index->first_sequence - 1;
+    record_blank(&cursor->record, &cursor->delta, index->first_time);
+}
+
+/**
+ * @brief Decode the next record of the block of a cursor
+ * @param cursor - the cursor, with records left in its block
+ */
+static void cursor_decode(TRENDLOG_STORE_CURSOR *cursor)
+{
+    const uint8_t *data;
+    uint8_t op, flags;
+    uint64_t value = 0;
+    int step;
+
+    data = cursor->store->data[store_slot(cursor->store, cursor->block)];
+    if (cursor->repeat) {
+        cursor->repeat--;
+        cursor->record.tTimeStamp += (bacnet_time_t)cursor->delta;
+        cursor->left--;
+        cursor->sequence++;
+        return;
+    }
+    while (cursor->packed) {
+        step = data[cursor->pack_offset] >> (2 * ((cursor->packed - 1) % 4));
+        step &= 3;
+        cursor->packed--;
+        if ((cursor->packed % 4) == 0) {
+            cursor->pack_offset++;
+        }
+        if (step != STORE_PACK_UNUSED) {
+            if (step == 3) {
+                step = -1;
+            }
+            cursor->record.tTimeStamp += (bacnet_time_t)cursor->delta;
+            record_step_apply(&cursor->record, step);
+            cursor->left--;
+            cursor->sequence++;
+            return;
+        }
+    }
+    op = data[cursor->offset++];
+    if (op <= STORE_RUN_MAX) {
+        cursor->repeat = op;
+        cursor->record.tTimeStamp += (bacnet_time_t)cursor->delta;
+    } else if (op < STORE_RECORD) {
+        step = op & 0x3F;
+        if (step & 0x20) {
+            step -= 0x40;
+        }
+        cursor->record.tTimeStamp += (bacnet_time_t)cursor->delta;
+        record_step_apply(&cursor->record, step);
+    } else if (op >= STORE_PACK) {
+        cursor->pack_offset = cursor->offset;
+        cursor->packed = (uint8_t)(((op & 0x0F) + 1) * 4);
+        cursor->offset += (op & 0x0F) + 1;
+        /* the first of packed steps is always used */
+        cursor_decode(cursor);
+        return;
+    } else {
+        flags = op & 0x0F;
+        if (flags & STORE_FLAG_TYPE) {
+            cursor->record.ucRecType = data[cursor->offset++];
+            memset(&cursor->record.Datum, 0, sizeof(cursor->record.Datum));
+        }
+        if (flags & STORE_FLAG_STATUS) {
+            cursor->record.ucStatus = data[cursor->offset++];
+        }
+        if (flags & STORE_FLAG_DOD) {
+            cursor->offset += varint_decode(&data[cursor->offset], &value);
+            cursor->delta += zigzag_decode(value);
+        }
+        cursor->record.tTimeStamp += (bacnet_time_t)cursor->delta;
+        if (flags & STORE_FLAG_VALUE) {
+            cursor->offset +=
+                value_decode(&data[cursor->offset], &cursor->record);
+        }
+    }
+    cursor->left--;
+    cursor->sequence++;
+}
+
+/**
+ * @brief Move a cursor to the next record, into the next block if needed
+ * @param cursor - the cursor
+ * @return false if there are no more records
+ */
+static bool cursor_step(TRENDLOG_STORE_CURSOR *cursor)
+{
+    if (cursor->left == 0) {
+        if ((cursor->block + 1) >= cursor->store->blocks) {
+            return false;
+        }
+        cursor_block(cursor, cursor->block + 1);
+    }
+    cursor_decode(cursor);
+
+    return true;
+}
+
+/**
+ * @brief Move a cursor on by a number of records in its block,
+ *  skipping runs in one go
+ * @param cursor - the cursor
+ * @param count - number of records, no more than are left in the block
+ */
+static void cursor_skip(TRENDLOG_STORE_CURSOR *cursor, uint32_t count)
+{
+    uint32_t repeat;
+
+    while (count > 0) {
+        if (cursor->repeat) {
+            repeat = cursor->repeat;
+            if (repeat > count) {
+                repeat = count;
+            }
+            cursor->record.tTimeStamp +=
+                (bacnet_time_t)(cursor->delta * (int64_t)repeat);
+            cursor->repeat -= (uint8_t)repeat;
+            cursor->left -= (uint16_t)repeat;
+            cursor->sequence += repeat;
+            count -= repeat;
+        } else {
+            cursor_decode(cursor);
+            count--;
+        }
+    }
+}
+
+/**
+ * @brief Move a cursor on past the rest of a run when the whole run is
+ *  before a time
+ * @param cursor - the cursor
+ * @param time - the time
+ * @param inclusive - true if a run ending at the time is skipped too
+ */
+static void
+cursor_skip_run(TRENDLOG_STORE_CURSOR *cursor, bacnet_time_t time, bool inclusive)
+{
+    bacnet_time_t end;
+
+    if (cursor->repeat && (cursor->delta >= 0)) {
+        end = cursor->record.tTimeStamp +
+            (bacnet_time_t)(cursor->delta * (int64_t)cursor->repeat);
+        if ((end < time) || (inclusive && (end == time))) {
+            cursor_skip(cursor, cursor->repeat);
+        }
+    }
+}
+
+/**
+ * @brief Load the first record of a block into a cursor, after any
+ *  records of the oldest block already dropped
+ * @param store - the store
+ * @param block - block number from the oldest
+ * @param cursor - the cursor
+ */
+static void cursor_first(
+    const TRENDLOG_STORE *store,
+    uint16_t block,
+    TRENDLOG_STORE_CURSOR *cursor)
+{
+    cursor->store = store;
+    cursor_block(cursor, block);
+    cursor_decode(cursor);
+    if (block == 0) {
+        cursor_skip(cursor, store->skip);
+    }
+}
+
+/**
+ * @brief Set the position of a cursor from its sequence number
+ * @param cursor - the cursor
+ */
+static void cursor_position(TRENDLOG_STORE_CURSOR *cursor)
+{
+    const TRENDLOG_STORE *store = cursor->store;
+
+    cursor->position = cursor->sequence -
+        (store->index[store->head].first_sequence + store->skip) + 1;
+}
+
+/**
+ * @brief Find the newest block whose first record is before a time
+ * @param store - the store, not empty
+ * @param time - the time
+ * @param inclusive - true if a first record at the time counts as before
+ * @param block - the block number from the oldest
+ * @return false if no block starts before the time
+ */
+static bool
+store_block_before(
+    const TRENDLOG_STORE *store,
+    bacnet_time_t time,
+    bool inclusive,
+    uint16_t *block)
+{
+    uint16_t low = 0, high = store->blocks, middle;
+    bacnet_time_t first_time;
+
+    /* first block that does not start before the time */
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        first_time = store->index[store_slot(store, middle)].first_time;
+        if ((first_time < time) || (inclusive && (first_time == time))) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0) {
+        return false;
+    }
+    *block = low - 1;
+
+    return true;
+}
+
+/**
+ * @brief Drop the oldest block of the store
+ * @param store - the store
+ */
+static void store_drop_block(TRENDLOG_STORE *store)
+{
+    TRENDLOG_STORE_BLOCK *index = &store->index[store->head];
+
+    store->count -= index->count - store->skip;
+    store->octets -= index->used;
+    store->skip = 0;
+    store->head = store_slot(store, 1);
+    store->blocks--;
+    if (store->blocks == 0) {
+        store->head = 0;
+        store->run = 0;
+        store->step = 0;
+        store->pack = 0;
+    }
+}
+
+/**
+ * @brief Initialize a store with no records
+ * @param store - the store
+ * @param records_max - most records to keep, oldest dropped first
+ */
+void trendlog_store_init(TRENDLOG_STORE *store, uint32_t records_max)
+{
+    if (store) {
+        store->records_max = records_max;
+        trendlog_store_purge(store, 0);
+    }
+}
+
+/**
+ * @brief Remove all the records of a store
+ * @param store - the store
+ * @param sequence - sequence number of the record before the next one
+ */
+void trendlog_store_purge(TRENDLOG_STORE *store, uint32_t sequence)
+{
+    if (store) {
+        store->head = 0;
+        store->blocks = 0;
+        store->skip = 0;
+        store->count = 0;
+        store->sequence = sequence;
+        store->octets = 0;
+        store->run = 0;
+        store->step = 0;
+        store->pack = 0;
+        store->open = false;
+        record_blank(&store->last, &store->last_delta, 0);
+    }
+}
+
+/**
+ * @brief Add a record to a store, dropping the oldest records when there
+ *  are records_max already or the blocks are all in use
+ * @param store - the store
+ * @param record - the record
+ * @return true if the record was added
+ */
+bool trendlog_store_append(TRENDLOG_STORE *store, const TL_DATA_REC *record)
+{
+    TRENDLOG_STORE_BLOCK *index = NULL;
+    TL_DATA_REC copy;
+    uint8_t buffer[TRENDLOG_STORE_RECORD_MAX];
+    int64_t delta = 0;
+    STORE_EDIT edit = STORE_EDIT_RECORD;
+    int step = 0;
+    int len = 0;
+    uint16_t slot = 0;
+
+    if (!store || !record || (store->records_max == 0)) {
+        return false;
+    }
+    record_copy(&copy, record);
+    if (store->count >= store->records_max) {
+        if ((store->skip + 1) >= store->index[store->head].count) {
+            store_drop_block(store);
+        } else {
+            store->skip++;
+            store->count--;
+        }
+    }
+    if (store->blocks && store->open) {
+        slot = store_slot(store, store->blocks - 1);
+        index = &store->index[slot];
+        len = record_encode(store, &copy, buffer, &delta, &edit, &step);
+        if ((index->count == UINT16_MAX) ||
+            ((index->used + len) > TRENDLOG_STORE_BLOCK_SIZE)) {
+            index = NULL;
+        }
+    }
+    if (!index) {
+        if (store->blocks == TRENDLOG_STORE_BLOCKS) {
+            store_drop_block(store);
+        }
+        slot = store_slot(store, store->blocks);
+        store->blocks++;
+        index = &store->index[slot];
+        index->first_time = copy.tTimeStamp;
+        index->first_sequence = store->sequence + 1;
+        index->count = 0;
+        index->used = 0;
+        store->run = 0;
+        store->step = 0;
+        store->pack = 0;
+        store->open = true;
+        record_blank(&store->last, &store->last_delta, copy.tTimeStamp);
+        len = record_encode(store, &copy, buffer, &delta, &edit, &step);
+    }
+    store_record_write(store, slot, buffer, len, edit, step);
+    index->count++;
+    store->count++;
+    store->sequence++;
+    store->last = copy;
+    store->last_delta = delta;
+
+    return true;
+}
+
+/**
+ * @brief Determine if the next record will push out the oldest one
+ * @param store - the store
+ * @return true if the store is full
+ */
+bool trendlog_store_full(const TRENDLOG_STORE *store)
+{
+    const TRENDLOG_STORE_BLOCK *index;
+
+    if (!store) {
+        return false;
+    }
+    if (store->count >= store->records_max) {
+        return true;
+    }
+    if (store->blocks == TRENDLOG_STORE_BLOCKS) {
+        index = &store->index[store_slot(store, store->blocks - 1)];
+        if (!store->open ||
+            ((index->used + TRENDLOG_STORE_RECORD_MAX) >
+             TRENDLOG_STORE_BLOCK_SIZE)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the number of records in a store
+ * @param store - the store
+ * @return number of records
+ */
+uint32_t trendlog_store_count(const TRENDLOG_STORE *store)
+{
+    return store ? store->count : 0;
+}
+
+/**
+ * @brief Get the sequence number of the newest record of a store
+ * @param store - the store
+ * @return sequence number, which counts every record ever added
+ */
+uint32_t trendlog_store_sequence(const TRENDLOG_STORE *store)
+{
+    return store ? store->sequence : 0;
+}
+
+/**
+ * @brief Get the number of octets the records of a store use
+ * @param store - the store
+ * @return number of octets of encoded records
+ */
+size_t trendlog_store_octets(const TRENDLOG_STORE *store)
+{
+    return store ? store->octets : 0;
+}
+
+/**
+ * @brief Get the number of blocks of a store
+ * @param store - the store
+ * @return number of blocks in use
+ */
+uint16_t trendlog_store_blocks(const TRENDLOG_STORE *store)
+{
+    return store ? store->blocks : 0;
+}
+
+/**
+ * @brief Get a block of a store, as it is kept, to copy it elsewhere
+ * @param store - the store
+ * @param block - block number from the oldest
+ * @param index - filled with the index of the block
+ * @param data - if not NULL, set to the index->used octets of the block
+ * @return true if there is such a block
+ */
+bool trendlog_store_block(
+    const TRENDLOG_STORE *store,
+    uint16_t block,
+    TRENDLOG_STORE_BLOCK *index,
+    const uint8_t **data)
+{
+    uint16_t slot;
+
+    if (!store || !index || (block >= store->blocks)) {
+        return false;
+    }
+    slot = store_slot(store, block);
+    *index = store->index[slot];
+    if (data) {
+        *data = store->data[slot];
+    }
+
+    return true;
+}
+
+/**
+ * @brief Add a block from trendlog_store_block() after the newest one,
+ *  as when restoring a store.  A later copy of the newest block, with
+ *  more records, takes its place.  The block is closed: the next record
+ *  appended starts a new block.
+ * @param store - the store
+ * @param index - index of the block
+ * @param data - the index->used octets of the block
+ * @return true if the block was added
+ */
+bool trendlog_store_block_add(
+    TRENDLOG_STORE *store,
+    const TRENDLOG_STORE_BLOCK *index,
+    const uint8_t *data)
+{
+    TRENDLOG_STORE_BLOCK *newest = NULL;
+    uint16_t slot = 0;
+    uint32_t excess;
+
+    if (!store || !index || !data || (index->count == 0) ||
+        (index->used > TRENDLOG_STORE_BLOCK_SIZE) ||
+        (store->records_max == 0)) {
+        return false;
+    }
+    if (store->blocks) {
+        slot = store_slot(store, store->blocks - 1);
+        newest = &store->index[slot];
+        if (newest->first_sequence != index->first_sequence) {
+            newest = NULL;
+        }
+    }
+    if (newest) {
+        if (index->count < newest->count) {
+            return false;
+        }
+        store->count += index->count - newest->count;
+        store->octets -= newest->used;
+    } else {
+        if (index->first_sequence <= store->sequence) {
+            return false;
+        }
+        if (index->first_sequence != (store->sequence + 1)) {
+            /* records are missing, so those before cannot be numbered */
+            trendlog_store_purge(store, index->first_sequence - 1);
+        }
+        if (store->blocks == TRENDLOG_STORE_BLOCKS) {
+            store_drop_block(store);
+        }
+        slot = store_slot(store, store->blocks);
+        store->blocks++;
+        store->count += index->count;
+    }
+    store->index[slot] = *index;
+    memcpy(store->data[slot], data, index->used);
+    store->octets += index->used;
+    store->sequence = index->first_sequence + index->count - 1;
+    while (store->count > store->records_max) {
+        excess = store->count - store->records_max;
+        if (excess >=
+            (uint32_t)(store->index[store->head].count - store->skip)) {
+            store_drop_block(store);
+        } else {
+            store->skip += (uint16_t)excess;
+            store->count -= excess;
+        }
+    }
+    store->run = 0;
+    store->step = 0;
+    store->pack = 0;
+    store->open = false;
+    record_blank(&store->last, &store->last_delta, 0);
+
+    return true;
+}
+
+/**
+ * @brief Point a cursor at a record of a store
+ * @param store - the store
+ * @param position - 1 for the oldest record
+ * @param cursor - the cursor
+ * @return false if there is no record at the position
+ */
+bool trendlog_store_seek_position(
+    const TRENDLOG_STORE *store,
+    uint32_t position,
+    TRENDLOG_STORE_CURSOR *cursor)
+{
+    uint32_t base, offset;
+    uint16_t low = 0, high, middle;
+
+    if (!store || !cursor || (position == 0) || (position > store->count)) {
+        return false;
+    }
+    /* sequence numbers from the oldest block, which may wrap */
+    base = store->index[store->head].first_sequence;
+    offset = store->skip + position - 1;
+    /* newest block that starts at or before the record */
+    high = store->blocks;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if ((store->index[store_slot(store, middle)].first_sequence - base) <=
+            offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    cursor->store = store;
+    cursor_block(cursor, low - 1);
+    cursor_decode(cursor);
+    cursor_skip(cursor, base + offset - cursor->sequence);
+    cursor->position = position;
+
+    return true;
+}
+
+/**
+ * @brief Point a cursor at the oldest record of a store that is after
+ *  a time
+ * @param store - the store
+ * @param time - the time
+ * @param cursor - the cursor
+ * @return false if there is no record after the time
+ */
+bool trendlog_store_seek_after(
+    const TRENDLOG_STORE *store,
+    bacnet_time_t time,
+    TRENDLOG_STORE_CURSOR *cursor)
+{
+    uint16_t block = 0;
+
+    if (!store || !cursor || (store->count == 0)) {
+        return false;
+    }
+    /* records of the blocks before are no later than its first one */
+    (void)store_block_before(store, time, true, &block);
+    cursor_first(store, block, cursor);
+    while (cursor->record.tTimeStamp <= time) {
+        cursor_skip_run(cursor, time, true);
+        if (!cursor_step(cursor)) {
+            return false;
+        }
+    }
+    cursor_position(cursor);
+
+    return true;
+}
+
+/**
+ * @brief Point a cursor at the newest record of a store that is before
+ *  a time
+ * @param store - the store
+ * @param time - the time
+ * @param cursor - the cursor
+ * @return false if there is no record before the time
+ */
+bool trendlog_store_seek_before(
+    const TRENDLOG_STORE *store,
+    bacnet_time_t time,
+    TRENDLOG_STORE_CURSOR *cursor)
+{
+    TRENDLOG_STORE_CURSOR next;
+    uint16_t block = 0;
+
+    if (!store || !cursor || (store->count == 0)) {
+        return false;
+    }
+    /* the records of the blocks after it are no earlier than the time */
+    if (!store_block_before(store, time, false, &block)) {
+        return false;
+    }
+    cursor_first(store, block, cursor);
+    if (cursor->record.tTimeStamp >= time) {
+        return false;
+    }
+    for (;;) {
+        cursor_skip_run(cursor, time, false);
+        next = *cursor;
+        if (!cursor_step(&next) || (next.record.tTimeStamp >= time)) {
+            break;
+        }
+        *cursor = next;
+    }
+    cursor_position(cursor);
+
+    return true;
+}
+
+/**
+ * @brief Move a cursor to the next record of its store
+ * @param cursor - the cursor
+ * @return false if the cursor was at the newest record
+ */
+bool trendlog_store_next(TRENDLOG_STORE_CURSOR *cursor)
+{
+    if (!cursor || !cursor->store ||
+        (cursor->position >= cursor->store->count)) {
+        return false;
+    }
+    if (!cursor_step(cursor)) {
+        return false;
+    }
+    cursor->position++;
+
+    return true;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file
+ * @brief API for the compressed record store of the Trend Log object:
+ *  records packed into fixed-size blocks, with an index of the first
+ *  time stamp and sequence number of each block.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_BASIC_OBJECT_TRENDLOG_STORE_H
+#define BACNET_BASIC_OBJECT_TRENDLOG_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/basic/object/trendlog.h"
+
+/* octets of one block of records, up to 65535 */
+#ifndef TRENDLOG_STORE_BLOCK_SIZE
+#define TRENDLOG_STORE_BLOCK_SIZE 256
+#endif
+/* blocks of each log; the oldest block is dropped for a new one */
+#ifndef TRENDLOG_STORE_BLOCKS
+#define TRENDLOG_STORE_BLOCKS 32
+#endif
+/* octets of the longest encoded record */
+#define TRENDLOG_STORE_RECORD_MAX 24
+
+typedef struct trendlog_store_block {
+    /* time stamp of the first record, the earliest while the clock
+       only goes forward */
+    bacnet_time_t first_time;
+    uint32_t first_sequence;
+    uint16_t count;
+    uint16_t used;
+} TRENDLOG_STORE_BLOCK;
+
+typedef struct trendlog_store {
+    /* ring of blocks: the oldest, and the number in use */
+    uint16_t head;
+    uint16_t blocks;
+    /* records of the oldest block already dropped from the log */
+    uint16_t skip;
+    uint32_t records_max;
+    uint32_t count;
+    /* sequence number of the newest record */
+    uint32_t sequence;
+    size_t octets;
+    /* the newest record, and the time from the one before it: the next
+       record is encoded as the changes from these */
+    TL_DATA_REC last;
+    int64_t last_delta;
+    /* offset + 1 of the opcode at the end of the newest block that the
+       next record may extend: a run, a step, or packed steps, or 0 */
+    uint16_t run;
+    uint16_t step;
+    uint16_t pack;
+    /* steps in the last octet of the packed steps, and how many of the
+       newest steps were zero */
+    uint8_t pack_steps;
+    uint8_t pack_zeros;
+    /* true if the next record may go into the newest block: a block
+       added whole is closed, and the next record starts a new one */
+    bool open;
+    TRENDLOG_STORE_BLOCK index[TRENDLOG_STORE_BLOCKS];
+    uint8_t data[TRENDLOG_STORE_BLOCKS][TRENDLOG_STORE_BLOCK_SIZE];
+} TRENDLOG_STORE;
+
+/* a record of the store, decoded, and where the next one starts */
+typedef struct trendlog_store_cursor {
+    const TRENDLOG_STORE *store;
+    /* block number from the oldest */
+    uint16_t block;
+    uint16_t offset;
+    /* records of the block after this one */
+    uint16_t left;
+    /* repeats of a run after this one */
+    uint8_t repeat;
+    /* packed steps after this one, and the offset of the first */
+    uint8_t packed;
+    uint16_t pack_offset;
+    int64_t delta;
+    /* 1 for the oldest record */
+    uint32_t position;
+    uint32_t sequence;
+    TL_DATA_REC record;
+} TRENDLOG_STORE_CURSOR;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+void trendlog_store_init(TRENDLOG_STORE *store, uint32_t records_max);
+
+BACNET_STACK_EXPORT
+void trendlog_store_purge(TRENDLOG_STORE *store, uint32_t sequence);
+
+BACNET_STACK_EXPORT
+bool trendlog_store_append(TRENDLOG_STORE *store, const TL_DATA_REC *record);
+
+BACNET_STACK_EXPORT
+bool trendlog_store_full(const TRENDLOG_STORE *store);
+
+BACNET_STACK_EXPORT
+uint32_t trendlog_store_count(const TRENDLOG_STORE *store);
+
+BACNET_STACK_EXPORT
+uint32_t trendlog_store_sequence(const TRENDLOG_STORE *store);
+
+BACNET_STACK_EXPORT
+size_t trendlog_store_octets(const TRENDLOG_STORE *store);
+
+BACNET_STACK_EXPORT
+uint16_t trendlog_store_blocks(const TRENDLOG_STORE *store);
+
+BACNET_STACK_EXPORT
+bool trendlog_store_block(
+    const TRENDLOG_STORE *store,
+    uint16_t block,
+    TRENDLOG_STORE_BLOCK *index,
+    const uint8_t **data);
+
+BACNET_STACK_EXPORT
+bool trendlog_store_block_add(
+    TRENDLOG_STORE *store,
+    const TRENDLOG_STORE_BLOCK *index,
+    const uint8_t *data);
+
+BACNET_STACK_EXPORT
+bool trendlog_store_seek_position(
+    const TRENDLOG_STORE *store,
+    uint32_t position,
+    TRENDLOG_STORE_CURSOR *cursor);
+
+BACNET_STACK_EXPORT
+bool trendlog_store_seek_after(
+    const TRENDLOG_STORE *store,
+    bacnet_time_t time,
+    TRENDLOG_STORE_CURSOR *cursor);
+
+BACNET_STACK_EXPORT
+bool trendlog_store_seek_before(
+    const TRENDLOG_STORE *store,
+    bacnet_time_t time,
+    TRENDLOG_STORE_CURSOR *cursor);
+
+BACNET_STACK_EXPORT
+bool trendlog_store_next(TRENDLOG_STORE_CURSOR *cursor);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -25,6 +25,8 @@
 static uint16_t Timeout_Milliseconds = 3000;
 /* Number of APDU Retries */
 static uint8_t Number_Of_Retries = 3;
+/* APDU Segment Timeout in Milliseconds */
+static uint16_t Segment_Timeout_Milliseconds = 2000;
 static uint8_t Local_Network_Priority; /* Fixing test 10.1.2 Network priority */
 
 /* a simple table for crossing the services supported */
@@ -492,6 +494,16 @@ void apdu_retries_set(uint8_t value)
     Number_Of_Retries = value;
 }
 
+uint16_t apdu_segment_timeout(void)
+{
+    return Segment_Timeout_Milliseconds;
+}
+
+void apdu_segment_timeout_set(uint16_t milliseconds)
+{
+    Segment_Timeout_Milliseconds = milliseconds;
+}
+
 /* When network communications are completely disabled,
    only DeviceCommunicationControl and ReinitializeDevice APDUs
    shall be processed and no messages shall be initiated.
@@ -572,6 +584,9 @@ void apdu_handler(
     uint8_t *service_request = NULL;
     uint16_t service_request_len = 0;
     int len = 0; /* counts where we are in PDU */
+#if (MAX_SEGMENTED_TRANSACTIONS)
+    bool reassembled = false;
+#endif
 #if !BACNET_SVC_SERVER
     uint8_t invoke_id = 0;
     BACNET_CONFIRMED_SERVICE_ACK_DATA service_ack_data = { 0 };
@@ -604,6 +619,26 @@ void apdu_handler(
                     initiated. */
                 break;
             }
+#if (MAX_SEGMENTED_TRANSACTIONS)
+            if (tsm_segmented_response_pending(src, service_data.invoke_id)) {
+                /* a repeat of a request whose reply is being sent */
+                break;
+            }
+            if (service_data.segmented_message) {
+                /* handled once all of its segments are here */
+                if (!tsm_segment_received(
+                        src, true, service_data.invoke_id,
+                        service_data.sequence_number,
+                        service_data.proposed_window_number,
+                        service_data.more_follows, &service_request,
+                        &service_request_len)) {
+                    break;
+                }
+                service_data.segmented_message = false;
+                service_data.more_follows = false;
+                reassembled = true;
+            }
+#endif
             if ((service_choice < MAX_BACNET_CONFIRMED_SERVICE) &&
                 (Confirmed_Function[service_choice])) {
                 Confirmed_Function[service_choice](
@@ -612,6 +647,11 @@ void apdu_handler(
                 Unrecognized_Service_Handler(
                     service_request, service_request_len, src, &service_data);
             }
+#if (MAX_SEGMENTED_TRANSACTIONS)
+            if (reassembled) {
+                tsm_segmented_release(service_request);
+            }
+#endif
             break;
         case PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST:
             if (apdu_len < 2) {
@@ -672,6 +712,22 @@ void apdu_handler(
             /* prepare the service request buffer and length */
             service_request_len = apdu_len - (uint16_t)len;
             service_request = &apdu[len];
+#if (MAX_SEGMENTED_TRANSACTIONS)
+            if (service_ack_data.segmented_message) {
+                /* handled once all of its segments are here */
+                if (!tsm_segment_received(
+                        src, false, invoke_id,
+                        service_ack_data.sequence_number,
+                        service_ack_data.proposed_window_number,
+                        service_ack_data.more_follows, &service_request,
+                        &service_request_len)) {
+                    break;
+                }
+                service_ack_data.segmented_message = false;
+                service_ack_data.more_follows = false;
+                reassembled = true;
+            }
+#endif
             if (!apdu_confirmed_simple_ack_service(service_choice)) {
                 if (service_choice < MAX_BACNET_CONFIRMED_SERVICE) {
                     if (Confirmed_ACK_Function[service_choice].complex !=
@@ -683,12 +739,27 @@ void apdu_handler(
                 }
                 tsm_free_invoke_id(invoke_id);
             }
+#if (MAX_SEGMENTED_TRANSACTIONS)
+            if (reassembled) {
+                tsm_segmented_release(service_request);
+            }
+#endif
+            break;
+#endif
+#if (MAX_SEGMENTED_TRANSACTIONS)
+        case PDU_TYPE_SEGMENT_ACK:
+            /* the peer acknowledges segments of a reply, so only the
+               source of the request can move it along */
+            tsm_segment_ack_handler(src, apdu, apdu_len);
             break;
+#elif !BACNET_SVC_SERVER
         case PDU_TYPE_SEGMENT_ACK:
             /* FIXME: what about a denial of service attack here?
                 we could check src to see if that matched the tsm */
             tsm_free_invoke_id(invoke_id);
             break;
+#endif
+#if !BACNET_SVC_SERVER
         case PDU_TYPE_ERROR:
             if (apdu_len < 3) {
                 break;
@@ -737,6 +808,10 @@ void apdu_handler(
             if (Abort_Function) {
                 Abort_Function(src, invoke_id, reason, server);
             }
+#if (MAX_SEGMENTED_TRANSACTIONS)
+            /* an Abort from a server ends what we receive from it */
+            tsm_segmented_abort(src, invoke_id, !server);
+#endif
             tsm_free_invoke_id(invoke_id);
             break;
 #endif
@@ -155,6 +155,10 @@ BACNET_STACK_EXPORT
 uint8_t apdu_retries(void);
 BACNET_STACK_EXPORT
 void apdu_retries_set(uint8_t value);
+BACNET_STACK_EXPORT
+uint16_t apdu_segment_timeout(void);
+BACNET_STACK_EXPORT
+void apdu_segment_timeout_set(uint16_t milliseconds);
 
 BACNET_STACK_EXPORT
 void apdu_handler(
@@ -38,6 +38,10 @@
 typedef struct BACnet_COV_Address {
     bool valid : 1;
     BACNET_ADDRESS dest;
+#if defined(BACDL_MULTIPLE)
+    /* port the subscription came in on, and the notifications go out on */
+    DATALINK_PORT *port;
+#endif
 } BACNET_COV_ADDRESS;
 
 /* note: This COV service only monitors the properties
@@ -46,6 +50,8 @@ typedef struct BACnet_COV_Subscription_Flags {
     bool valid : 1;
     bool issueConfirmedNotifications : 1; /* optional */
     bool send_requested : 1;
+    /* on the pending list */
+    bool pending : 1;
 } BACNET_COV_SUBSCRIPTION_FLAGS;
 
 typedef struct BACnet_COV_Subscription {
@@ -55,6 +61,10 @@ typedef struct BACnet_COV_Subscription {
     uint32_t subscriberProcessIdentifier;
     uint32_t lifetime; /* optional */
     BACNET_OBJECT_ID monitoredObjectIdentifier;
+    /* next subscription in the same monitored-object bucket */
+    unsigned next_index;
+    /* next subscription on the pending list */
+    unsigned pending_index;
 } BACNET_COV_SUBSCRIPTION;
 
 #ifndef MAX_COV_SUBCRIPTIONS
@@ -65,6 +75,182 @@ static BACNET_COV_SUBSCRIPTION COV_Subscriptions[MAX_COV_SUBCRIPTIONS];
 #define MAX_COV_ADDRESSES 16
 #endif
 static BACNET_COV_ADDRESS COV_Addresses[MAX_COV_ADDRESSES];
+/* subscriptions are chained into buckets by monitored object so that
+   a changed object only visits its own subscribers. Power of two. */
+#ifndef MAX_COV_OBJECT_BUCKETS
+#define MAX_COV_OBJECT_BUCKETS 64
+#endif
+static unsigned COV_Object_Buckets[MAX_COV_OBJECT_BUCKETS];
+/* queue of objects that reported a change-of-value since the last pass */
+#ifndef MAX_COV_CHANGED_OBJECTS
+#define MAX_COV_CHANGED_OBJECTS 32
+#endif
+static BACNET_OBJECT_ID COV_Changed_Objects[MAX_COV_CHANGED_OBJECTS];
+static volatile unsigned COV_Changed_Head;
+static volatile unsigned COV_Changed_Count;
+/* the queue overflowed: mark changes by checking every subscription */
+static volatile bool COV_Changed_Overflow;
+/* subscriptions with send_requested set, or with a confirmed
+   notification in the TSM, chained through pending_index so that a
+   pass only visits those */
+static unsigned COV_Pending_Head;
+/* Objects that do not call cov_change_detected_notify() are found by
+   checking Device_COV() for every subscription once per second. */
+#ifndef COV_CHANGE_POLLING
+#define COV_CHANGE_POLLING 1
+#endif
+/* The values of the last object notified in this pass, encoded once as
+   the list-of-values and copied into the notification of each of its
+   subscribers. A list that does not fit is encoded per subscriber. */
+#ifndef MAX_COV_VALUES_SIZE
+#define MAX_COV_VALUES_SIZE 64
+#endif
+typedef struct BACnet_COV_Values {
+    bool valid : 1;
+    BACNET_OBJECT_ID object_id;
+    BACNET_PROPERTY_VALUE value_list[MAX_COV_PROPERTIES];
+    /* 0 when the encoded list did not fit */
+    uint16_t apdu_len;
+    uint8_t apdu[MAX_COV_VALUES_SIZE];
+} BACNET_COV_VALUES;
+static BACNET_COV_VALUES COV_Values;
+
+/**
+ * @brief Hash a monitored object identifier into a subscription bucket
+ * @param object_type - monitored object type
+ * @param object_instance - monitored object instance
+ * @return bucket number 0..MAX_COV_OBJECT_BUCKETS-1
+ */
+static unsigned cov_object_bucket(uint32_t object_type, uint32_t object_instance)
+{
+    uint32_t hash;
+
+    hash = (object_instance * 2654435761UL) ^ object_type;
+
+    return (unsigned)(hash & (MAX_COV_OBJECT_BUCKETS - 1));
+}
+
+/**
+ * @brief Add a valid subscription to its monitored-object bucket
+ * @param index - subscription index
+ */
+static void cov_subscription_link(unsigned index)
+{
+    unsigned bucket;
+
+    bucket = cov_object_bucket(
+        COV_Subscriptions[index].monitoredObjectIdentifier.type,
+        COV_Subscriptions[index].monitoredObjectIdentifier.instance);
+    COV_Subscriptions[index].next_index = COV_Object_Buckets[bucket];
+    COV_Object_Buckets[bucket] = index;
+}
+
+/**
+ * @brief Remove a subscription from its monitored-object bucket
+ * @param index - subscription index
+ */
+static void cov_subscription_unlink(unsigned index)
+{
+    unsigned bucket;
+    unsigned *link;
+
+    bucket = cov_object_bucket(
+        COV_Subscriptions[index].monitoredObjectIdentifier.type,
+        COV_Subscriptions[index].monitoredObjectIdentifier.instance);
+    link = &COV_Object_Buckets[bucket];
+    while (*link < MAX_COV_SUBCRIPTIONS) {
+        if (*link == index) {
+            *link = COV_Subscriptions[index].next_index;
+            break;
+        }
+        link = &COV_Subscriptions[*link].next_index;
+    }
+    COV_Subscriptions[index].next_index = MAX_COV_SUBCRIPTIONS;
+}
+
+/**
+ * @brief Add a subscription to the pending list, if not already on it
+ * @param index - subscription index
+ */
+static void cov_pending_add(unsigned index)
+{
+    if (!COV_Subscriptions[index].flag.pending) {
+        COV_Subscriptions[index].pending_index = COV_Pending_Head;
+        COV_Pending_Head = index;
+        COV_Subscriptions[index].flag.pending = true;
+    }
+}
+
+/**
+ * @brief Remove a subscription from the pending list
+ * @param index - subscription index
+ */
+static void cov_pending_remove(unsigned index)
+{
+    unsigned *link;
+
+    if (!COV_Subscriptions[index].flag.pending) {
+        return;
+    }
+    link = &COV_Pending_Head;
+    while (*link < MAX_COV_SUBCRIPTIONS) {
+        if (*link == index) {
+            *link = COV_Subscriptions[index].pending_index;
+            break;
+        }
+        link = &COV_Subscriptions[*link].pending_index;
+    }
+    COV_Subscriptions[index].pending_index = MAX_COV_SUBCRIPTIONS;
+    COV_Subscriptions[index].flag.pending = false;
+}
+
+/**
+ * @brief Queue an object that detected a change-of-value. Registered
+ *  with cov_change_detected_callback_set() and called from the objects.
+ * @param object_type - changed object type
+ * @param object_instance - changed object instance
+ */
+static void
+cov_change_detected(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    unsigned i;
+    unsigned offset;
+
+    for (i = 0; i < COV_Changed_Count; i++) {
+        offset = (COV_Changed_Head + i) % MAX_COV_CHANGED_OBJECTS;
+        if ((COV_Changed_Objects[offset].type == object_type) &&
+            (COV_Changed_Objects[offset].instance == object_instance)) {
+            /* already queued */
+            return;
+        }
+    }
+    if (COV_Changed_Count < MAX_COV_CHANGED_OBJECTS) {
+        offset =
+            (COV_Changed_Head + COV_Changed_Count) % MAX_COV_CHANGED_OBJECTS;
+        COV_Changed_Objects[offset].type = object_type;
+        COV_Changed_Objects[offset].instance = object_instance;
+        COV_Changed_Count++;
+    } else {
+        COV_Changed_Overflow = true;
+    }
+}
+
+/**
+ * @brief Remove the oldest object from the changed-object queue
+ * @param object_id - [out] changed object identifier
+ * @return true if an object was removed from the queue
+ */
+static bool cov_changed_object_pop(BACNET_OBJECT_ID *object_id)
+{
+    if (COV_Changed_Count == 0) {
+        return false;
+    }
+    *object_id = COV_Changed_Objects[COV_Changed_Head];
+    COV_Changed_Head = (COV_Changed_Head + 1) % MAX_COV_CHANGED_OBJECTS;
+    COV_Changed_Count--;
+
+    return true;
+}
 
 /**
  * Gets the address from the list of COV addresses
@@ -135,6 +321,11 @@ static int cov_address_add(const BACNET_ADDRESS *dest)
             if (valid) {
                 cov_dest = &COV_Addresses[i].dest;
                 found = bacnet_address_same(dest, cov_dest);
+#if defined(BACDL_MULTIPLE)
+                if (COV_Addresses[i].port != datalink_port_bound()) {
+                    found = false;
+                }
+#endif
                 if (found) {
                     index = i;
                     break;
@@ -149,6 +340,9 @@ static int cov_address_add(const BACNET_ADDRESS *dest)
                     index = i;
                     cov_dest = &COV_Addresses[i].dest;
                     bacnet_address_copy(cov_dest, dest);
+#if defined(BACDL_MULTIPLE)
+                    COV_Addresses[i].port = datalink_port_bound();
+#endif
                     COV_Addresses[i].valid = true;
                     break;
                 }
@@ -333,10 +527,21 @@ void handler_cov_init(void)
         COV_Subscriptions[index].invokeID = 0;
         COV_Subscriptions[index].lifetime = 0;
         COV_Subscriptions[index].flag.send_requested = false;
+        COV_Subscriptions[index].flag.pending = false;
+        COV_Subscriptions[index].next_index = MAX_COV_SUBCRIPTIONS;
+        COV_Subscriptions[index].pending_index = MAX_COV_SUBCRIPTIONS;
     }
     for (index = 0; index < MAX_COV_ADDRESSES; index++) {
         COV_Addresses[index].valid = false;
     }
+    for (index = 0; index < MAX_COV_OBJECT_BUCKETS; index++) {
+        COV_Object_Buckets[index] = MAX_COV_SUBCRIPTIONS;
+    }
+    COV_Changed_Head = 0;
+    COV_Changed_Count = 0;
+    COV_Changed_Overflow = false;
+    COV_Pending_Head = MAX_COV_SUBCRIPTIONS;
+    cov_change_detected_callback_set(cov_change_detected);
 }
 
 static bool cov_list_subscribe(
@@ -375,6 +580,8 @@ static bool cov_list_subscribe(
                 existing_entry = true;
                 if (cov_data->cancellationRequest) {
                     /* initialize with invalid COV address */
+                    cov_subscription_unlink(index);
+                    cov_pending_remove(index);
                     COV_Subscriptions[index].flag.valid = false;
                     COV_Subscriptions[index].dest_index = MAX_COV_ADDRESSES;
                     cov_address_remove_unused();
@@ -384,6 +591,7 @@ static bool cov_list_subscribe(
                         cov_data->issueConfirmedNotifications;
                     COV_Subscriptions[index].lifetime = cov_data->lifetime;
                     COV_Subscriptions[index].flag.send_requested = true;
+                    cov_pending_add(index);
                 }
                 if (COV_Subscriptions[index].invokeID) {
                     tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
@@ -421,6 +629,8 @@ static bool cov_list_subscribe(
             COV_Subscriptions[index].invokeID = 0;
             COV_Subscriptions[index].lifetime = cov_data->lifetime;
             COV_Subscriptions[index].flag.send_requested = true;
+            cov_subscription_link(index);
+            cov_pending_add(index);
         }
     } else if (!existing_entry) {
         if (first_invalid_index < 0) {
@@ -441,9 +651,51 @@ static bool cov_list_subscribe(
     return found;
 }
 
+/**
+ * @brief Get the values of a monitored object for its notifications,
+ *  encoded once for every subscriber of the object in this pass
+ * @param object_type - monitored object type
+ * @param object_instance - monitored object instance
+ * @return the values, or NULL if the object has none
+ */
+static BACNET_COV_VALUES *
+cov_values_encode(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    int len = 0;
+
+    if (COV_Values.valid && (COV_Values.object_id.type == object_type) &&
+        (COV_Values.object_id.instance == object_instance)) {
+        return &COV_Values;
+    }
+    COV_Values.valid = false;
+    COV_Values.object_id.type = object_type;
+    COV_Values.object_id.instance = object_instance;
+    /* configure the linked list for the two properties */
+    bacapp_property_value_list_init(
+        &COV_Values.value_list[0], MAX_COV_PROPERTIES);
+    if (!Device_Encode_Value_List(
+            object_type, object_instance, &COV_Values.value_list[0])) {
+        return NULL;
+    }
+    len = cov_notify_values_encode(
+        COV_Values.apdu, sizeof(COV_Values.apdu), &COV_Values.value_list[0]);
+    COV_Values.apdu_len = (uint16_t)len;
+    COV_Values.valid = true;
+
+    return &COV_Values;
+}
+
+/**
+ * @brief Forget the encoded values, so that the next notification
+ *  reads the object again
+ */
+static void cov_values_invalidate(void)
+{
+    COV_Values.valid = false;
+}
+
 static bool cov_send_request(
-    BACNET_COV_SUBSCRIPTION *cov_subscription,
-    BACNET_PROPERTY_VALUE *value_list)
+    BACNET_COV_SUBSCRIPTION *cov_subscription, BACNET_COV_VALUES *values)
 {
     int len = 0;
     int pdu_len = 0;
@@ -454,6 +706,9 @@ static bool cov_send_request(
     bool status = false; /* return value */
     BACNET_COV_DATA cov_data = { 0 };
     BACNET_ADDRESS *dest = NULL;
+#if defined(BACDL_MULTIPLE)
+    DATALINK_PORT *port = NULL;
+#endif
 
     if (!dcc_communication_enabled()) {
         return status;
@@ -471,7 +726,12 @@ static bool cov_send_request(
 #endif
         return status;
     }
+#if defined(BACDL_MULTIPLE)
+    port = COV_Addresses[cov_subscription->dest_index].port;
+    datalink_port_get_my_address(port, &my_address);
+#else
     datalink_get_my_address(&my_address);
+#endif
     npdu_encode_npdu_data(
         &npdu_data, cov_subscription->flag.issueConfirmedNotifications,
         MESSAGE_PRIORITY_NORMAL);
@@ -486,18 +746,26 @@ static bool cov_send_request(
     cov_data.monitoredObjectIdentifier.instance =
         cov_subscription->monitoredObjectIdentifier.instance;
     cov_data.timeRemaining = cov_subscription->lifetime;
-    cov_data.listOfValues = value_list;
+    cov_data.listOfValues = &values->value_list[0];
     if (cov_subscription->flag.issueConfirmedNotifications) {
         invoke_id = tsm_next_free_invokeID();
-        if (invoke_id) {
-            cov_subscription->invokeID = invoke_id;
-            len = ccov_notify_encode_apdu(
-                &Handler_Transmit_Buffer[pdu_len],
-                sizeof(Handler_Transmit_Buffer) - pdu_len, invoke_id,
-                &cov_data);
-        } else {
+        if (!invoke_id) {
             goto COV_FAILED;
         }
+        cov_subscription->invokeID = invoke_id;
+    }
+    if (values->apdu_len > 0) {
+        /* the header, then a copy of the values shared by the
+           subscribers of the object */
+        len = cov_notify_values_apdu_encode(
+            &Handler_Transmit_Buffer[pdu_len],
+            sizeof(Handler_Transmit_Buffer) - pdu_len,
+            cov_subscription->flag.issueConfirmedNotifications, invoke_id,
+            &cov_data, values->apdu, values->apdu_len);
+    } else if (cov_subscription->flag.issueConfirmedNotifications) {
+        len = ccov_notify_encode_apdu(
+            &Handler_Transmit_Buffer[pdu_len],
+            sizeof(Handler_Transmit_Buffer) - pdu_len, invoke_id, &cov_data);
     } else {
         len = ucov_notify_encode_apdu(
             &Handler_Transmit_Buffer[pdu_len],
@@ -505,12 +773,25 @@ static bool cov_send_request(
     }
     pdu_len += len;
     if (cov_subscription->flag.issueConfirmedNotifications) {
+#if defined(BACDL_MULTIPLE)
+        tsm_port_set_confirmed_unsegmented_transaction(
+            port, invoke_id, dest, &npdu_data, &Handler_Transmit_Buffer[0],
+            (uint16_t)pdu_len);
+#else
         tsm_set_confirmed_unsegmented_transaction(
             invoke_id, dest, &npdu_data, &Handler_Transmit_Buffer[0],
             (uint16_t)pdu_len);
+#endif
     }
+#if defined(BACDL_MULTIPLE)
+    /* the port the subscription came in on, not the one, if any, the
+       calling task is bound to */
+    bytes_sent = datalink_port_send_pdu(
+        port, dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+#else
     bytes_sent = datalink_send_pdu(
         dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+#endif
     if (bytes_sent > 0) {
         status = true;
 #if PRINT_ENABLED
@@ -549,6 +830,8 @@ static void cov_lifetime_expiration_handler(
                 COV_Subscriptions[index].lifetime);
 #endif
             /* initialize with invalid COV address */
+            cov_subscription_unlink(index);
+            cov_pending_remove(index);
             COV_Subscriptions[index].flag.valid = false;
             COV_Subscriptions[index].dest_index = MAX_COV_ADDRESSES;
             cov_address_remove_unused();
@@ -562,24 +845,55 @@ static void cov_lifetime_expiration_handler(
     }
 }
 
+/**
+ * @brief Mark every subscription whose monitored object reports a
+ *  change-of-value, then clear the COV flag of those objects.
+ *  Used when the changed-object queue has overflowed, and for objects
+ *  that do not report their changes with cov_change_detected_notify().
+ */
+static void cov_mark_changed_subscriptions(void)
+{
+    unsigned index = 0;
+    BACNET_OBJECT_TYPE object_type = MAX_BACNET_OBJECT_TYPE;
+    uint32_t object_instance = 0;
+
+    for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
+        if (COV_Subscriptions[index].flag.valid) {
+            object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
+                              .monitoredObjectIdentifier.type;
+            object_instance =
+                COV_Subscriptions[index].monitoredObjectIdentifier.instance;
+            if (Device_COV(object_type, object_instance)) {
+                COV_Subscriptions[index].flag.send_requested = true;
+                cov_pending_add(index);
+#if PRINT_ENABLED
+                debug_fprintf(stderr, "COVtask: Marking...\n");
+#endif
+            }
+        }
+    }
+    for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
+        if ((COV_Subscriptions[index].flag.valid) &&
+            (COV_Subscriptions[index].flag.send_requested)) {
+            object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
+                              .monitoredObjectIdentifier.type;
+            object_instance =
+                COV_Subscriptions[index].monitoredObjectIdentifier.instance;
+            Device_COV_Clear(object_type, object_instance);
+        }
+    }
+}
+
 /** Handler to check the list of subscribed objects for any that have changed
  *  and so need to have notifications sent.
  * @ingroup DSCOV
  * This handler will be invoked by the main program every second or so.
- * This example only handles Binary Inputs, but can be easily extended to
- * support other types.
  * For each subscribed object,
  *  - See if the subscription has timed out
  *    - Remove it if it has timed out.
- *  - See if the subscribed object instance has changed
- *    (eg, check with Binary_Input_Change_Of_Value() )
- *  - If changed,
- *    - Clear the COV (eg, Binary_Input_Change_Of_Value_Clear() )
- *    - Send the notice with cov_send_request()
- *      - Will be confirmed or unconfirmed, as per the subscription.
- *
- * @note worst case tasking: MS/TP with the ability to send only
- *        one notification per task cycle.
+ *  - When COV_CHANGE_POLLING is enabled, see if the subscribed object
+ *    instance has changed (eg, check with Device_COV() ) and mark the
+ *    subscription to be sent by the next handler_cov_task().
  *
  * @param elapsed_seconds [in] How many seconds have elapsed since last called.
  */
@@ -600,136 +914,209 @@ void handler_cov_timer_seconds(uint32_t elapsed_seconds)
                 }
             }
         }
+#if COV_CHANGE_POLLING
+        cov_mark_changed_subscriptions();
+#endif
     }
 }
 
-bool handler_cov_fsm(void)
+/**
+ * @brief Send a notification for one subscription, if it can be sent now
+ * @param index - subscription index
+ * @param values - values of the monitored object
+ * @return true if the notification was sent
+ */
+static bool cov_subscription_send(unsigned index, BACNET_COV_VALUES *values)
 {
-    static int index = 0;
-    BACNET_OBJECT_TYPE object_type = MAX_BACNET_OBJECT_TYPE;
-    uint32_t object_instance = 0;
     bool status = false;
-    bool send = false;
-    BACNET_PROPERTY_VALUE value_list[MAX_COV_PROPERTIES] = { 0 };
-    /* states for transmitting */
-    static enum {
-        COV_STATE_IDLE = 0,
-        COV_STATE_MARK,
-        COV_STATE_CLEAR,
-        COV_STATE_FREE,
-        COV_STATE_SEND
-    } cov_task_state = COV_STATE_IDLE;
-
-    switch (cov_task_state) {
-        case COV_STATE_IDLE:
-            index = 0;
-            cov_task_state = COV_STATE_MARK;
-            break;
-        case COV_STATE_MARK:
-            /* mark any subscriptions where the value has changed */
-            if (COV_Subscriptions[index].flag.valid) {
-                object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
-                                  .monitoredObjectIdentifier.type;
-                object_instance =
-                    COV_Subscriptions[index].monitoredObjectIdentifier.instance;
-                status = Device_COV(object_type, object_instance);
-                if (status) {
-                    COV_Subscriptions[index].flag.send_requested = true;
+
+    if (COV_Subscriptions[index].flag.issueConfirmedNotifications) {
+        if (COV_Subscriptions[index].invokeID != 0) {
+            /* already sending */
+            return false;
+        }
+        if (!tsm_transaction_available()) {
+            /* no transactions available - can't send now */
+            return false;
+        }
+    }
 #if PRINT_ENABLED
-                    debug_fprintf(stderr, "COVtask: Marking...\n");
+    debug_fprintf(stderr, "COVtask: Sending...\n");
 #endif
-                }
-            }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_CLEAR;
-            }
-            break;
-        case COV_STATE_CLEAR:
-            /* clear the COV flag after checking all subscriptions */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.send_requested)) {
-                object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
-                                  .monitoredObjectIdentifier.type;
-                object_instance =
-                    COV_Subscriptions[index].monitoredObjectIdentifier.instance;
-                Device_COV_Clear(object_type, object_instance);
+    status = cov_send_request(&COV_Subscriptions[index], values);
+    if (status) {
+        COV_Subscriptions[index].flag.send_requested = false;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Notify every subscriber of one changed object. The value list
+ *  is encoded once and copied into the notification of each subscriber.
+ * @param object_id - changed object identifier
+ */
+static void cov_changed_object_notify(const BACNET_OBJECT_ID *object_id)
+{
+    BACNET_OBJECT_TYPE object_type = (BACNET_OBJECT_TYPE)object_id->type;
+    uint32_t object_instance = object_id->instance;
+    BACNET_COV_VALUES *values = NULL;
+    bool encoded = false;
+    unsigned index;
+
+    if (!Device_COV(object_type, object_instance)) {
+        /* already handled */
+        return;
+    }
+    Device_COV_Clear(object_type, object_instance);
+    /* the values changed since they were last encoded */
+    cov_values_invalidate();
+    index = COV_Object_Buckets[cov_object_bucket(object_type, object_instance)];
+    while (index < MAX_COV_SUBCRIPTIONS) {
+        if ((COV_Subscriptions[index].flag.valid) &&
+            (COV_Subscriptions[index].monitoredObjectIdentifier.type ==
+             object_type) &&
+            (COV_Subscriptions[index].monitoredObjectIdentifier.instance ==
+             object_instance)) {
+            COV_Subscriptions[index].flag.send_requested = true;
+            if (!encoded) {
+                values = cov_values_encode(object_type, object_instance);
+                encoded = true;
             }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_FREE;
+            if (values) {
+                cov_subscription_send(index, values);
             }
-            break;
-        case COV_STATE_FREE:
-            /* confirmed notification house keeping */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.issueConfirmedNotifications) &&
+            if ((COV_Subscriptions[index].flag.send_requested) ||
                 (COV_Subscriptions[index].invokeID)) {
-                if (tsm_invoke_id_free(COV_Subscriptions[index].invokeID)) {
-                    COV_Subscriptions[index].invokeID = 0;
-                } else if (tsm_invoke_id_failed(
-                               COV_Subscriptions[index].invokeID)) {
-                    tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
-                    COV_Subscriptions[index].invokeID = 0;
-                }
-            }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_SEND;
+                /* try again, or wait for the ack, from the pending list */
+                cov_pending_add(index);
             }
-            break;
-        case COV_STATE_SEND:
-            /* send any COVs that are requested */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.send_requested)) {
-                send = true;
-                if (COV_Subscriptions[index].flag.issueConfirmedNotifications) {
-                    if (COV_Subscriptions[index].invokeID != 0) {
-                        /* already sending */
-                        send = false;
-                    }
-                    if (!tsm_transaction_available()) {
-                        /* no transactions available - can't send now */
-                        send = false;
-                    }
-                }
-                if (send) {
-                    object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
-                                      .monitoredObjectIdentifier.type;
-                    object_instance = COV_Subscriptions[index]
-                                          .monitoredObjectIdentifier.instance;
-#if PRINT_ENABLED
-                    debug_fprintf(stderr, "COVtask: Sending...\n");
-#endif
-                    /* configure the linked list for the two properties */
-                    bacapp_property_value_list_init(
-                        &value_list[0], MAX_COV_PROPERTIES);
-                    status = Device_Encode_Value_List(
-                        object_type, object_instance, &value_list[0]);
-                    if (status) {
-                        status = cov_send_request(
-                            &COV_Subscriptions[index], &value_list[0]);
-                    }
-                    if (status) {
-                        COV_Subscriptions[index].flag.send_requested = false;
-                    }
-                }
+        }
+        index = COV_Subscriptions[index].next_index;
+    }
+}
+
+/**
+ * @brief Take a subscription off the pending list once it has neither a
+ *  notification to send nor a confirmed notification in the TSM
+ * @param link - the link to the subscription, updated to the next one
+ * @return true if the subscription was taken off the list
+ */
+static bool cov_pending_done(unsigned *link)
+{
+    unsigned index = *link;
+
+    if ((COV_Subscriptions[index].flag.send_requested) ||
+        (COV_Subscriptions[index].invokeID)) {
+        return false;
+    }
+    *link = COV_Subscriptions[index].pending_index;
+    COV_Subscriptions[index].pending_index = MAX_COV_SUBCRIPTIONS;
+    COV_Subscriptions[index].flag.pending = false;
+
+    return true;
+}
+
+/**
+ * @brief Confirmed notification house keeping: release the invoke IDs
+ *  of completed or failed transactions.
+ */
+static void cov_confirmed_housekeeping(void)
+{
+    unsigned *link = &COV_Pending_Head;
+    unsigned index;
+
+    while (*link < MAX_COV_SUBCRIPTIONS) {
+        index = *link;
+        if (COV_Subscriptions[index].invokeID) {
+            if (tsm_invoke_id_free(COV_Subscriptions[index].invokeID)) {
+                COV_Subscriptions[index].invokeID = 0;
+            } else if (tsm_invoke_id_failed(
+                           COV_Subscriptions[index].invokeID)) {
+                tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
+                COV_Subscriptions[index].invokeID = 0;
             }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_IDLE;
+        }
+        if (!cov_pending_done(link)) {
+            link = &COV_Subscriptions[index].pending_index;
+        }
+    }
+}
+
+/**
+ * @brief Send any notifications that were requested but could not be
+ *  sent when the change was handled, such as the initial notification
+ *  of a new subscription or a confirmed notification waiting for the TSM.
+ */
+static void cov_send_pending(void)
+{
+    unsigned *link = &COV_Pending_Head;
+    unsigned index;
+    BACNET_OBJECT_TYPE object_type = MAX_BACNET_OBJECT_TYPE;
+    uint32_t object_instance = 0;
+    BACNET_COV_VALUES *values = NULL;
+
+    while (*link < MAX_COV_SUBCRIPTIONS) {
+        index = *link;
+        if (COV_Subscriptions[index].flag.send_requested) {
+            object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
+                              .monitoredObjectIdentifier.type;
+            object_instance =
+                COV_Subscriptions[index].monitoredObjectIdentifier.instance;
+            values = cov_values_encode(object_type, object_instance);
+            if (values) {
+                cov_subscription_send(index, values);
             }
-            break;
-        default:
-            index = 0;
-            cov_task_state = COV_STATE_IDLE;
-            break;
+        }
+        if (!cov_pending_done(link)) {
+            link = &COV_Subscriptions[index].pending_index;
+        }
     }
-    return (cov_task_state == COV_STATE_IDLE);
+}
+
+/**
+ * @brief Determine if handler_cov_task() has work to do right now
+ * @return true if changed objects are queued or notifications are pending
+ */
+bool handler_cov_pending(void)
+{
+    return (COV_Changed_Count > 0) || COV_Changed_Overflow ||
+        (COV_Pending_Head < MAX_COV_SUBCRIPTIONS);
+}
+
+/**
+ * @brief Handle the COV notifications in one pass:
+ *  - release the invoke IDs of finished confirmed notifications
+ *  - drain the queue of changed objects and notify each of their
+ *    subscribers immediately
+ *  - retry any notifications that could not be sent earlier
+ *
+ * Subscriptions of objects that have not changed are not visited,
+ * unless a confirmed notification or a retry is outstanding.
+ *
+ * @return true when the pass is complete (always)
+ */
+bool handler_cov_fsm(void)
+{
+    BACNET_OBJECT_ID object_id = { 0 };
+
+    /* the values are read again in every pass */
+    cov_values_invalidate();
+    if (COV_Pending_Head < MAX_COV_SUBCRIPTIONS) {
+        cov_confirmed_housekeeping();
+    }
+    if (COV_Changed_Overflow) {
+        COV_Changed_Overflow = false;
+        cov_mark_changed_subscriptions();
+    }
+    while (cov_changed_object_pop(&object_id)) {
+        cov_changed_object_notify(&object_id);
+    }
+    if (COV_Pending_Head < MAX_COV_SUBCRIPTIONS) {
+        cov_send_pending();
+    }
+
+    return true;
 }
 
 void handler_cov_task(void)
@@ -875,8 +1262,15 @@ void handler_cov_subscribe(
         }
     }
     pdu_len = npdu_len + apdu_len;
+#if defined(BACDL_MULTIPLE)
+    /* the reply goes out on the port the subscription is kept for */
+    bytes_sent = datalink_port_send_pdu(
+        datalink_port_bound(), src, &npdu_data, &Handler_Transmit_Buffer[0],
+        pdu_len);
+#else
     bytes_sent = datalink_send_pdu(
         src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+#endif
     if (bytes_sent <= 0) {
         debug_perror("SubscribeCOV: Failed to send PDU");
     }
@@ -967,8 +1361,15 @@ void handler_cov_subscribe_property(
         }
     }
     pdu_len = npdu_len + apdu_len;
+#if defined(BACDL_MULTIPLE)
+    /* the reply goes out on the port the subscription is kept for */
+    bytes_sent = datalink_port_send_pdu(
+        datalink_port_bound(), src, &npdu_data, &Handler_Transmit_Buffer[0],
+        pdu_len);
+#else
     bytes_sent = datalink_send_pdu(
         src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+#endif
     if (bytes_sent <= 0) {
         debug_perror("SubscribeCOVProperty: Failed to send PDU");
     }
@@ -38,6 +38,8 @@ bool handler_cov_fsm(void);
 BACNET_STACK_EXPORT
 void handler_cov_task(void);
 BACNET_STACK_EXPORT
+bool handler_cov_pending(void);
+BACNET_STACK_EXPORT
 void handler_cov_timer_seconds(uint32_t elapsed_seconds);
 BACNET_STACK_EXPORT
 void handler_cov_init(void);
@@ -40,7 +40,7 @@
  * - an Abort if
  *   - the message is segmented
  *   - if decoding fails
- *   - if the response would be too large
+ *   - if the response would be too large, and can not be segmented
  * - the result from Device_Read_Property(), if it succeeds
  * - an Error if Device_Read_Property() fails
  *   or there isn't enough room in the APDU to fit the data.
@@ -66,6 +66,9 @@ void handler_read_property(
     bool error = true; /* assume that there is an error */
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *apdu;
+    uint16_t apdu_size;
+    uint8_t *segmented_apdu;
 
     /* configure default error code as an abort since it is common */
     rpdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
@@ -74,6 +77,19 @@ void handler_read_property(
     npdu_encode_npdu_data(&npdu_data, false, service_data->priority);
     npdu_len = npdu_encode_pdu(
         &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    /* a reply longer than the requester takes in one APDU, such as the
+       Object_List of many objects, is sent in segments if it takes them */
+    segmented_apdu =
+        tsm_segmented_response_buffer(src, service_data, &apdu_size);
+    if (segmented_apdu) {
+        apdu = segmented_apdu;
+    } else if (npdu_len > 0) {
+        apdu = &Handler_Transmit_Buffer[npdu_len];
+        apdu_size = (uint16_t)(sizeof(Handler_Transmit_Buffer) - npdu_len);
+    } else {
+        apdu = &Handler_Transmit_Buffer[0];
+        apdu_size = 0;
+    }
     if (npdu_len <= 0) {
         /* If 0 or negative, there were problems with the data or encoding. */
         len = BACNET_STATUS_ABORT;
@@ -116,14 +132,11 @@ void handler_read_property(
                 rpdata.object_instance = Network_Port_Index_To_Instance(0);
             }
 #endif
-            apdu_len = rp_ack_encode_apdu_init(
-                &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
-                &rpdata);
+            apdu_len =
+                rp_ack_encode_apdu_init(apdu, service_data->invoke_id, &rpdata);
             /* configure our storage */
-            rpdata.application_data =
-                &Handler_Transmit_Buffer[npdu_len + apdu_len];
-            rpdata.application_data_len =
-                sizeof(Handler_Transmit_Buffer) - (npdu_len + apdu_len);
+            rpdata.application_data = &apdu[apdu_len];
+            rpdata.application_data_len = apdu_size - apdu_len;
             if (!read_property_bacnet_array_valid(&rpdata)) {
                 len = BACNET_STATUS_ERROR;
             } else {
@@ -131,10 +144,9 @@ void handler_read_property(
             }
             if (len >= 0) {
                 apdu_len += len;
-                len = rp_ack_encode_apdu_object_property_end(
-                    &Handler_Transmit_Buffer[npdu_len + apdu_len]);
+                len = rp_ack_encode_apdu_object_property_end(&apdu[apdu_len]);
                 apdu_len += len;
-                if (apdu_len > service_data->max_resp) {
+                if (!segmented_apdu && (apdu_len > service_data->max_resp)) {
                     /* too big for the sender - send an abort!
                        Setting of error code needed here as read property
                        processing may have overridden the default set at start
@@ -164,25 +176,30 @@ void handler_read_property(
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
             apdu_len = abort_encode_apdu(
-                &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
+                apdu, service_data->invoke_id,
                 abort_convert_error_code(rpdata.error_code), true);
             debug_print("RP: Sending Abort!\n");
         } else if (len == BACNET_STATUS_ERROR) {
             apdu_len = bacerror_encode_apdu(
-                &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
+                apdu, service_data->invoke_id,
                 SERVICE_CONFIRMED_READ_PROPERTY, rpdata.error_class,
                 rpdata.error_code);
             debug_print("RP: Sending Error!\n");
         } else if (len == BACNET_STATUS_REJECT) {
             apdu_len = reject_encode_apdu(
-                &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
+                apdu, service_data->invoke_id,
                 reject_convert_error_code(rpdata.error_code));
             debug_print("RP: Sending Reject!\n");
         }
     }
-    pdu_len = npdu_len + apdu_len;
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    if (segmented_apdu) {
+        bytes_sent =
+            tsm_segmented_response_send(segmented_apdu, (uint16_t)apdu_len);
+    } else {
+        pdu_len = npdu_len + apdu_len;
+        bytes_sent = datalink_send_pdu(
+            src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    }
     if (bytes_sent <= 0) {
         debug_perror("RP: Failed to send PDU");
     }
@@ -183,6 +183,86 @@ static int RPM_Encode_Property(
     return apdu_len;
 }
 
+/**
+ * @brief Encode the list of results of the special property ALL, REQUIRED
+ * or OPTIONAL of an object: a copy of its cached list if there is one,
+ * else each property of the list, and the list is then cached.
+ * @param apdu [out] The buffer to encode the list into.
+ * @param offset [in] The offset into the buffer to start encoding.
+ * @param max_apdu [in] The maximum length of the buffer.
+ * @param rpmdata [in] The RPM data of the special property.
+ * @param property_list [in] The property lists of the object.
+ * @param property_count [in] The number of properties in the list.
+ * @return The length of the encoding, or the negative status of the
+ * property that did not fit.
+ */
+static int RPM_Encode_Property_List(
+    uint8_t *apdu,
+    uint16_t offset,
+    uint16_t max_apdu,
+    BACNET_RPM_DATA *rpmdata,
+    struct special_property_list_t *property_list,
+    unsigned property_count)
+{
+    BACNET_PROPERTY_ID special_property = rpmdata->object_property;
+    uint8_t value[32];
+    uint16_t value_offset = 0;
+    uint16_t value_len = 0;
+    size_t free_len;
+    uint32_t changes;
+    bool cached;
+    int apdu_len = 0;
+    int len = 0;
+    unsigned index;
+
+    cached = rpm_cache_object_type(rpmdata->object_type);
+    changes = rpm_cache_changes();
+    if (cached) {
+        free_len = (offset < max_apdu) ? (max_apdu - offset) : 0;
+        apdu_len = rpm_cache_encode(
+            rpmdata->object_type, rpmdata->object_instance, special_property,
+            &apdu[offset], free_len, &value_offset, &value_len);
+        if ((apdu_len > 0) && (value_len > 0)) {
+            /* the present value changed: encode it again */
+            rpmdata->object_property = PROP_PRESENT_VALUE;
+            len = RPM_Encode_Property(value, 0, sizeof(value), rpmdata);
+            if (len == value_len) {
+                memcpy(&apdu[offset + value_offset], value, value_len);
+                rpm_cache_value_store(
+                    rpmdata->object_type, rpmdata->object_instance,
+                    special_property, value, value_len, changes);
+            } else {
+                apdu_len = 0;
+            }
+        }
+        if (apdu_len > 0) {
+            return apdu_len;
+        }
+        value_len = 0;
+    }
+    for (index = 0; index < property_count; index++) {
+        rpmdata->object_property =
+            RPM_Object_Property(property_list, special_property, index);
+        len = RPM_Encode_Property(
+            apdu, (uint16_t)(offset + apdu_len), max_apdu, rpmdata);
+        if (len <= 0) {
+            return len;
+        }
+        if (rpmdata->object_property == PROP_PRESENT_VALUE) {
+            value_offset = (uint16_t)apdu_len;
+            value_len = (uint16_t)len;
+        }
+        apdu_len += len;
+    }
+    if (cached) {
+        rpm_cache_store(
+            rpmdata->object_type, rpmdata->object_instance, special_property,
+            &apdu[offset], (size_t)apdu_len, value_offset, value_len, changes);
+    }
+
+    return apdu_len;
+}
+
 /** Handler for a ReadPropertyMultiple Service request.
  * @ingroup DSRPM
  * This handler will be invoked by apdu_handler() if it has been enabled
@@ -191,7 +271,7 @@ static int RPM_Encode_Property(
  * - an Abort if
  *   - the message is segmented
  *   - if decoding fails
- *   - if the response would be too large
+ *   - if the response would be too large, and can not be segmented
  * - the result from each included read request, if it succeeds
  * - an Error if processing fails for all, or individual errors if only some
  * fail, or there isn't enough room in the APDU to fit the data.
@@ -220,12 +300,25 @@ void handler_read_property_multiple(
     int apdu_len = 0;
     int npdu_len = 0;
     int error = 0;
+    uint8_t *apdu;
+    uint16_t apdu_size;
+    uint8_t *segmented_apdu;
 
     if (service_data) {
         datalink_get_my_address(&my_address);
         npdu_encode_npdu_data(&npdu_data, false, service_data->priority);
         npdu_len = npdu_encode_pdu(
             &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+        /* a reply longer than the requester takes in one APDU is sent in
+           segments, if it takes them and a buffer is free */
+        segmented_apdu =
+            tsm_segmented_response_buffer(src, service_data, &apdu_size);
+        if (segmented_apdu) {
+            apdu = segmented_apdu;
+        } else {
+            apdu = &Handler_Transmit_Buffer[npdu_len];
+            apdu_size = MAX_APDU;
+        }
         if (service_len == 0) {
             rpmdata.error_code = ERROR_CODE_REJECT_MISSING_REQUIRED_PARAMETER;
             error = BACNET_STATUS_REJECT;
@@ -237,8 +330,7 @@ void handler_read_property_multiple(
         } else {
             /* decode apdu request & encode apdu reply
                encode complex ack, invoke id, service choice */
-            apdu_len = rpm_ack_encode_apdu_init(
-                &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id);
+            apdu_len = rpm_ack_encode_apdu_init(apdu, service_data->invoke_id);
 
             for (;;) {
                 /* Start by looking for an object ID */
@@ -280,9 +372,8 @@ void handler_read_property_multiple(
 #endif
                 /* Stick this object id into the reply - if it will fit */
                 len = rpm_ack_encode_apdu_object_begin(&Temp_Buf[0], &rpmdata);
-                copy_len = memcopy(
-                    &Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0], apdu_len,
-                    len, MAX_APDU);
+                copy_len =
+                    memcopy(apdu, &Temp_Buf[0], apdu_len, len, apdu_size);
                 if (copy_len == 0) {
                     debug_print("RPM: Response too big!\n");
                     rpmdata.error_code =
@@ -314,14 +405,12 @@ void handler_read_property_multiple(
                         (rpmdata.object_property == PROP_OPTIONAL)) {
                         struct special_property_list_t property_list;
                         unsigned property_count = 0;
-                        unsigned index = 0;
                         BACNET_PROPERTY_ID special_object_property;
 
                         if (!Device_Valid_Object_Id(
                                 rpmdata.object_type, rpmdata.object_instance)) {
                             len = RPM_Encode_Property(
-                                &Handler_Transmit_Buffer[npdu_len],
-                                (uint16_t)apdu_len, MAX_APDU, &rpmdata);
+                                apdu, (uint16_t)apdu_len, apdu_size, &rpmdata);
                             if (len > 0) {
                                 apdu_len += len;
                             } else {
@@ -340,8 +429,7 @@ void handler_read_property_multiple(
                                 rpmdata.array_index);
 
                             copy_len = memcopy(
-                                &Handler_Transmit_Buffer[npdu_len],
-                                &Temp_Buf[0], apdu_len, len, MAX_APDU);
+                                apdu, &Temp_Buf[0], apdu_len, len, apdu_size);
 
                             if (copy_len == 0) {
                                 debug_print(
@@ -361,8 +449,7 @@ void handler_read_property_multiple(
                                 ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY);
 
                             copy_len = memcopy(
-                                &Handler_Transmit_Buffer[npdu_len],
-                                &Temp_Buf[0], apdu_len, len, MAX_APDU);
+                                apdu, &Temp_Buf[0], apdu_len, len, apdu_size);
 
                             if (copy_len == 0) {
                                 debug_print("RPM: Too full to encode error!\n");
@@ -395,8 +482,8 @@ void handler_read_property_multiple(
                                         rpmdata.object_type,
                                         rpmdata.object_instance)) {
                                     len = RPM_Encode_Property(
-                                        &Handler_Transmit_Buffer[npdu_len],
-                                        (uint16_t)apdu_len, MAX_APDU, &rpmdata);
+                                        apdu, (uint16_t)apdu_len, apdu_size,
+                                        &rpmdata);
                                     if (len > 0) {
                                         apdu_len += len;
                                     } else {
@@ -410,34 +497,26 @@ void handler_read_property_multiple(
                                     }
                                 }
                             } else {
-                                for (index = 0; index < property_count;
-                                     index++) {
-                                    rpmdata.object_property =
-                                        RPM_Object_Property(
-                                            &property_list,
-                                            special_object_property, index);
-                                    len = RPM_Encode_Property(
-                                        &Handler_Transmit_Buffer[npdu_len],
-                                        (uint16_t)apdu_len, MAX_APDU, &rpmdata);
-                                    if (len > 0) {
-                                        apdu_len += len;
-                                    } else {
-                                        debug_print(
-                                            "RPM: Too full for property!\n");
-                                        error = len;
-                                        /* The berror flag ensures that
-                                           both loops will be broken! */
-                                        berror = true;
-                                        break;
-                                    }
+                                len = RPM_Encode_Property_List(
+                                    apdu, (uint16_t)apdu_len, apdu_size,
+                                    &rpmdata, &property_list, property_count);
+                                if (len > 0) {
+                                    apdu_len += len;
+                                } else {
+                                    debug_print(
+                                        "RPM: Too full for property!\n");
+                                    error = len;
+                                    /* The berror flag ensures that
+                                       both loops will be broken! */
+                                    berror = true;
+                                    break;
                                 }
                             }
                         }
                     } else {
                         /* handle an individual property */
                         len = RPM_Encode_Property(
-                            &Handler_Transmit_Buffer[npdu_len],
-                            (uint16_t)apdu_len, MAX_APDU, &rpmdata);
+                            apdu, (uint16_t)apdu_len, apdu_size, &rpmdata);
                         if (len > 0) {
                             apdu_len += len;
                         } else {
@@ -458,8 +537,7 @@ void handler_read_property_multiple(
                         decode_len++;
                         len = rpm_ack_encode_apdu_object_end(&Temp_Buf[0]);
                         copy_len = memcopy(
-                            &Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0],
-                            apdu_len, len, MAX_APDU);
+                            apdu, &Temp_Buf[0], apdu_len, len, apdu_size);
                         if (copy_len == 0) {
                             debug_print(
                                 "RPM: Too full to encode object end!\n");
@@ -486,7 +564,7 @@ void handler_read_property_multiple(
                 }
             }
             /* If not having an error so far, check the remaining space. */
-            if (!berror) {
+            if (!berror && !segmented_apdu) {
                 if (apdu_len > service_data->max_resp) {
                     /* too big for the sender - send an abort */
                     rpmdata.error_code =
@@ -500,25 +578,30 @@ void handler_read_property_multiple(
         if (error) {
             if (error == BACNET_STATUS_ABORT) {
                 apdu_len = abort_encode_apdu(
-                    &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
+                    apdu, service_data->invoke_id,
                     abort_convert_error_code(rpmdata.error_code), true);
                 debug_print("RPM: Sending Abort!\n");
             } else if (error == BACNET_STATUS_ERROR) {
                 apdu_len = bacerror_encode_apdu(
-                    &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
+                    apdu, service_data->invoke_id,
                     SERVICE_CONFIRMED_READ_PROP_MULTIPLE, rpmdata.error_class,
                     rpmdata.error_code);
                 debug_print("RPM: Sending Error!\n");
             } else if (error == BACNET_STATUS_REJECT) {
                 apdu_len = reject_encode_apdu(
-                    &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
+                    apdu, service_data->invoke_id,
                     reject_convert_error_code(rpmdata.error_code));
                 debug_print("RPM: Sending Reject!\n");
             }
         }
-        pdu_len = apdu_len + npdu_len;
-        bytes_sent = datalink_send_pdu(
-            src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        if (segmented_apdu) {
+            bytes_sent =
+                tsm_segmented_response_send(segmented_apdu, (uint16_t)apdu_len);
+        } else {
+            pdu_len = apdu_len + npdu_len;
+            bytes_sent = datalink_send_pdu(
+                src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        }
         if (bytes_sent <= 0) {
             debug_perror("RPM: Failed to send PDU");
         }
@@ -0,0 +1,401 @@
+/**
+ * @file
+ * @brief A cache of the encoded results of ReadPropertyMultiple ALL,
+ *  REQUIRED and OPTIONAL requests for the objects of this device.
+ *
+ * A controller that polls this device reads every object with
+ * ReadPropertyMultiple ALL, over and over, and almost everything in the
+ * answer is the same as last time: the name, the type, the units and
+ * the status flags.  The first answer for an object is kept here as
+ * encoded BACnet, so the next one is a copy of it.
+ *
+ * The objects tell the cache when they change.  A change of the
+ * present value marks only the present value result of the object as
+ * stale, so that result is encoded again and patched into the copy;
+ * any other change of an object drops its results, and a change of the
+ * database revision drops them all.  Only the object types that report
+ * every change are cached.
+ *
+ * The objects may change in another task than the one that answers the
+ * requests.  A count of the changes is read before the results are
+ * encoded, and results are kept only if no change was counted since.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacenum.h"
+#include "bacnet/basic/service/h_rpm_cache.h"
+
+/* the cached lists of results of one object share a set */
+#define RPM_CACHE_WAYS 2
+#define RPM_CACHE_SETS ((RPM_CACHE_OBJECTS + 1) / RPM_CACHE_WAYS)
+
+struct rpm_cache_entry {
+    /* valid while it equals RPM_Cache_Generation */
+    volatile uint32_t generation;
+    uint32_t object_instance;
+    uint16_t object_type;
+    uint16_t object_property;
+    uint16_t length;
+    /* the present value result in the list, if its length is not 0 */
+    uint16_t value_offset;
+    uint16_t value_length;
+    volatile bool value_stale;
+    uint8_t results[RPM_CACHE_RESULTS_MAX];
+};
+
+#if RPM_CACHE_OBJECTS
+static struct rpm_cache_entry RPM_Cache[RPM_CACHE_SETS][RPM_CACHE_WAYS];
+/* the way of each set that was used last */
+static uint8_t RPM_Cache_Recent[RPM_CACHE_SETS];
+#endif
+static volatile uint32_t RPM_Cache_Generation = 1;
+static volatile uint32_t RPM_Cache_Changes;
+static uint32_t RPM_Cache_Hits;
+static uint32_t RPM_Cache_Misses;
+
+/**
+ * @brief The set that holds the cached results of an object
+ * @param object_type - object type
+ * @param object_instance - object instance
+ * @param set - filled with the number of the set
+ * @return the ways of the set, or NULL if the cache is disabled
+ */
+static struct rpm_cache_entry *
+rpm_cache_set(uint32_t object_type, uint32_t object_instance, unsigned *set)
+{
+#if RPM_CACHE_OBJECTS
+    uint32_t hash;
+
+    hash = (object_instance * 2654435761UL) ^ object_type;
+    *set = (unsigned)(hash % RPM_CACHE_SETS);
+
+    return RPM_Cache[*set];
+#else
+    (void)object_type;
+    (void)object_instance;
+    *set = 0;
+
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Find the valid cached results of an object
+ * @param object_type - object type
+ * @param object_instance - object instance
+ * @param object_property - ALL, REQUIRED or OPTIONAL
+ * @param set - filled with the number of the set
+ * @param way - filled with the way of the set that holds them
+ * @return the cached results, or NULL if there are none
+ */
+static struct rpm_cache_entry *rpm_cache_find(
+    uint32_t object_type,
+    uint32_t object_instance,
+    uint32_t object_property,
+    unsigned *set,
+    unsigned *way)
+{
+    struct rpm_cache_entry *ways;
+    unsigned i;
+
+    ways = rpm_cache_set(object_type, object_instance, set);
+    if (!ways) {
+        return NULL;
+    }
+    for (i = 0; i < RPM_CACHE_WAYS; i++) {
+        if ((ways[i].generation == RPM_Cache_Generation) &&
+            (ways[i].object_instance == object_instance) &&
+            (ways[i].object_type == object_type) &&
+            (ways[i].object_property == object_property)) {
+            *way = i;
+            return &ways[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Determine if the results of an object type may be cached:
+ *  the objects of the type report every change of their properties
+ * @param object_type - object type
+ * @return true if the cache is enabled and the type may be cached
+ */
+bool rpm_cache_object_type(BACNET_OBJECT_TYPE object_type)
+{
+#if RPM_CACHE_OBJECTS
+    switch (object_type) {
+        case OBJECT_ANALOG_INPUT:
+        case OBJECT_ANALOG_VALUE:
+        case OBJECT_BINARY_INPUT:
+        case OBJECT_BINARY_OUTPUT:
+        case OBJECT_BINARY_VALUE:
+            return true;
+        default:
+            break;
+    }
+#else
+    (void)object_type;
+#endif
+
+    return false;
+}
+
+/**
+ * @brief The count of changes, read before results are encoded and
+ *  given back when they are stored
+ * @return the count of changes reported so far
+ */
+uint32_t rpm_cache_changes(void)
+{
+    return RPM_Cache_Changes;
+}
+
+/**
+ * @brief Encode the cached list of results of an object
+ * @param object_type - object type
+ * @param object_instance - object instance
+ * @param object_property - ALL, REQUIRED or OPTIONAL
+ * @param apdu - where to copy the list of results
+ * @param apdu_size - octets free at apdu; the list must be shorter
+ * @param value_offset - filled with where the present value result is
+ * @param value_length - filled with the length of the present value
+ *  result if it is stale and the caller must encode it again, else 0
+ * @return octets copied, or 0 if there are no cached results or they
+ *  do not fit, and the caller encodes the list the usual way
+ */
+int rpm_cache_encode(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint8_t *apdu,
+    size_t apdu_size,
+    uint16_t *value_offset,
+    uint16_t *value_length)
+{
+    struct rpm_cache_entry *entry;
+    unsigned set = 0, way = 0;
+    uint32_t generation;
+    bool stale;
+
+    entry = rpm_cache_find(
+        object_type, object_instance, object_property, &set, &way);
+    if (!entry || !apdu || (entry->length >= apdu_size)) {
+        RPM_Cache_Misses++;
+        return 0;
+    }
+    generation = entry->generation;
+    stale = entry->value_stale;
+    memcpy(apdu, entry->results, entry->length);
+    if (generation != entry->generation) {
+        /* dropped by a change in another task while it was copied */
+        RPM_Cache_Misses++;
+        return 0;
+    }
+    if (value_offset) {
+        *value_offset = entry->value_offset;
+    }
+    if (value_length) {
+        *value_length = stale ? entry->value_length : 0;
+    }
+#if RPM_CACHE_OBJECTS
+    RPM_Cache_Recent[set] = (uint8_t)way;
+#endif
+    RPM_Cache_Hits++;
+
+    return (int)entry->length;
+}
+
+/**
+ * @brief Keep the encoded list of results of an object
+ * @param object_type - object type
+ * @param object_instance - object instance
+ * @param object_property - ALL, REQUIRED or OPTIONAL
+ * @param results - the encoded list of results
+ * @param results_len - octets of the list
+ * @param value_offset - where the present value result is in the list
+ * @param value_len - octets of the present value result, or 0 if the
+ *  list does not have one
+ * @param changes - rpm_cache_changes() from before the list was encoded
+ */
+void rpm_cache_store(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    const uint8_t *results,
+    size_t results_len,
+    size_t value_offset,
+    size_t value_len,
+    uint32_t changes)
+{
+    struct rpm_cache_entry *ways;
+    struct rpm_cache_entry *entry;
+    unsigned set = 0, way = 0;
+
+    if (!rpm_cache_object_type(object_type) || !results ||
+        (results_len == 0) || (results_len > RPM_CACHE_RESULTS_MAX) ||
+        ((value_offset + value_len) > results_len)) {
+        return;
+    }
+    if (changes != RPM_Cache_Changes) {
+        return;
+    }
+    entry = rpm_cache_find(
+        object_type, object_instance, object_property, &set, &way);
+    if (!entry) {
+        ways = rpm_cache_set(object_type, object_instance, &set);
+        if (!ways) {
+            return;
+        }
+#if RPM_CACHE_OBJECTS
+        way = (RPM_Cache_Recent[set] + 1U) % RPM_CACHE_WAYS;
+#endif
+        entry = &ways[way];
+    }
+    entry->generation = 0;
+    entry->object_instance = object_instance;
+    entry->object_type = (uint16_t)object_type;
+    entry->object_property = (uint16_t)object_property;
+    entry->length = (uint16_t)results_len;
+    entry->value_offset = (uint16_t)value_offset;
+    entry->value_length = (uint16_t)value_len;
+    entry->value_stale = false;
+    memcpy(entry->results, results, results_len);
+    entry->generation = RPM_Cache_Generation;
+    if (changes != RPM_Cache_Changes) {
+        /* changed in another task while it was stored */
+        entry->generation = 0;
+    }
+#if RPM_CACHE_OBJECTS
+    RPM_Cache_Recent[set] = (uint8_t)way;
+#endif
+}
+
+/**
+ * @brief Patch the present value result of a cached list of results
+ *  that rpm_cache_encode() reported as stale
+ * @param object_type - object type
+ * @param object_instance - object instance
+ * @param object_property - ALL, REQUIRED or OPTIONAL
+ * @param value - the encoded present value result
+ * @param value_len - octets of the result, the same as the stale one
+ * @param changes - rpm_cache_changes() from before it was encoded
+ */
+void rpm_cache_value_store(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    const uint8_t *value,
+    size_t value_len,
+    uint32_t changes)
+{
+    struct rpm_cache_entry *entry;
+    unsigned set = 0, way = 0;
+
+    if (!value || (changes != RPM_Cache_Changes)) {
+        return;
+    }
+    entry = rpm_cache_find(
+        object_type, object_instance, object_property, &set, &way);
+    if (!entry || (entry->value_length == 0) ||
+        (entry->value_length != value_len)) {
+        return;
+    }
+    memcpy(&entry->results[entry->value_offset], value, value_len);
+    entry->value_stale = false;
+    if (changes != RPM_Cache_Changes) {
+        entry->value_stale = true;
+    }
+}
+
+/**
+ * @brief Report that the present value of an object has changed
+ * @param object_type - object type
+ * @param object_instance - object instance
+ */
+void rpm_cache_value_changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    struct rpm_cache_entry *ways;
+    unsigned set = 0;
+    unsigned i;
+
+    RPM_Cache_Changes++;
+    ways = rpm_cache_set(object_type, object_instance, &set);
+    if (!ways) {
+        return;
+    }
+    for (i = 0; i < RPM_CACHE_WAYS; i++) {
+        if ((ways[i].object_instance == object_instance) &&
+            (ways[i].object_type == object_type)) {
+            if (ways[i].value_length) {
+                ways[i].value_stale = true;
+            } else {
+                /* nothing to patch: drop it, in case it had the value */
+                ways[i].generation = 0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Report that any property of an object has changed, or that the
+ *  object was deleted
+ * @param object_type - object type
+ * @param object_instance - object instance
+ */
+void rpm_cache_object_changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    struct rpm_cache_entry *ways;
+    unsigned set = 0;
+    unsigned i;
+
+    RPM_Cache_Changes++;
+    ways = rpm_cache_set(object_type, object_instance, &set);
+    if (!ways) {
+        return;
+    }
+    for (i = 0; i < RPM_CACHE_WAYS; i++) {
+        if ((ways[i].object_instance == object_instance) &&
+            (ways[i].object_type == object_type)) {
+            ways[i].generation = 0;
+        }
+    }
+}
+
+/**
+ * @brief Drop every cached list of results, as when the database
+ *  revision of the device changes
+ */
+void rpm_cache_invalidate(void)
+{
+    RPM_Cache_Changes++;
+    RPM_Cache_Generation++;
+    if (RPM_Cache_Generation == 0) {
+        RPM_Cache_Generation++;
+    }
+}
+
+/**
+ * @brief The number of lists of results found in the cache, and not
+ * @param hits - filled with the lists copied from the cache, or NULL
+ * @param misses - filled with the lists encoded the usual way, or NULL
+ */
+void rpm_cache_statistics(uint32_t *hits, uint32_t *misses)
+{
+    if (hits) {
+        *hits = RPM_Cache_Hits;
+    }
+    if (misses) {
+        *misses = RPM_Cache_Misses;
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * @brief API for a cache of the encoded results of ReadPropertyMultiple
+ *  ALL, REQUIRED and OPTIONAL requests for the objects of this device.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_BASIC_SERVICE_HANDLER_RPM_CACHE_H
+#define BACNET_BASIC_SERVICE_HANDLER_RPM_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacenum.h"
+
+/* number of cached lists of results, two per set; 0 disables the cache */
+#ifndef RPM_CACHE_OBJECTS
+#define RPM_CACHE_OBJECTS 0
+#endif
+/* octets of the longest list of results that is cached */
+#ifndef RPM_CACHE_RESULTS_MAX
+#define RPM_CACHE_RESULTS_MAX 256
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+bool rpm_cache_object_type(BACNET_OBJECT_TYPE object_type);
+
+BACNET_STACK_EXPORT
+uint32_t rpm_cache_changes(void);
+
+BACNET_STACK_EXPORT
+int rpm_cache_encode(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint8_t *apdu,
+    size_t apdu_size,
+    uint16_t *value_offset,
+    uint16_t *value_length);
+
+BACNET_STACK_EXPORT
+void rpm_cache_store(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    const uint8_t *results,
+    size_t results_len,
+    size_t value_offset,
+    size_t value_len,
+    uint32_t changes);
+
+BACNET_STACK_EXPORT
+void rpm_cache_value_store(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    const uint8_t *value,
+    size_t value_len,
+    uint32_t changes);
+
+BACNET_STACK_EXPORT
+void rpm_cache_value_changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance);
+
+BACNET_STACK_EXPORT
+void rpm_cache_object_changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance);
+
+BACNET_STACK_EXPORT
+void rpm_cache_invalidate(void);
+
+BACNET_STACK_EXPORT
+void rpm_cache_statistics(uint32_t *hits, uint32_t *misses);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -12,11 +12,13 @@
 /* BACnet Stack defines - first */
 #include "bacnet/bacdef.h"
 /* BACnet Stack API */
+#include "bacnet/bacaddr.h"
 #include "bacnet/bacdcode.h"
 #include "bacnet/whois.h"
 #include "bacnet/iam.h"
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
+#include "bacnet/basic/service/h_whois.h"
 #include "bacnet/basic/tsm/tsm.h"
 
 /** @file h_whois.c  Handles Who-Is requests. */
@@ -131,6 +133,303 @@ void handler_who_is_who_am_i_unicast(
     }
 }
 
+/* true if clock time a is at or after clock time b */
+static bool who_is_time_reached(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) >= 0;
+}
+
+/* xorshift32: each device draws its own reply times from its seed */
+static uint32_t who_is_random(WHO_IS_RESPONDER *responder)
+{
+    uint32_t x = responder->random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    responder->random = x;
+
+    return x;
+}
+
+/**
+ * @brief Initialize a Who-Is responder with the default settings and no
+ *  periodic I-Am
+ * @param responder [in] the responder of one port
+ * @param seed [in] seed of the random reply times, such as the device
+ *  instance, so that devices of a segment differ
+ */
+void who_is_responder_init(WHO_IS_RESPONDER *responder, uint32_t seed)
+{
+    if (!responder) {
+        return;
+    }
+    memset(responder, 0, sizeof(*responder));
+    responder->reply_window_ms = WHO_IS_REPLY_WINDOW_MS;
+    responder->reply_interval_ms = WHO_IS_REPLY_INTERVAL_MS;
+    responder->reply_burst = WHO_IS_REPLY_BURST;
+    responder->duplicate_window_ms = WHO_IS_DUPLICATE_WINDOW_MS;
+    /* scramble the seed, as close seeds give close first draws */
+    responder->random = (seed * 2654435761UL) ^ 0x9E3779B9UL;
+    if (responder->random == 0) {
+        responder->random = 0x9E3779B9UL;
+    }
+    responder->credit_ms =
+        responder->reply_interval_ms * responder->reply_burst;
+}
+
+/**
+ * @brief Set the periodic I-Am of a responder
+ * @param responder [in] the responder of one port
+ * @param min_ms [in] time after the last I-Am, or 0 for no periodic I-Am
+ * @param max_ms [in] longest time between periodic I-Am
+ */
+void who_is_responder_announce_set(
+    WHO_IS_RESPONDER *responder, uint32_t min_ms, uint32_t max_ms)
+{
+    if (!responder) {
+        return;
+    }
+    if (max_ms < min_ms) {
+        max_ms = min_ms;
+    }
+    responder->announce_min_ms = min_ms;
+    responder->announce_max_ms = max_ms;
+    responder->announce_interval_ms = min_ms;
+}
+
+/**
+ * @brief Go back to the shortest time between periodic I-Am, such as
+ *  when the port comes back up
+ * @param responder [in] the responder of one port
+ */
+void who_is_responder_announce_reset(WHO_IS_RESPONDER *responder)
+{
+    if (responder) {
+        responder->announce_interval_ms = responder->announce_min_ms;
+    }
+}
+
+/* true if the same request came from the same client within the window;
+   otherwise remember it in place of the oldest one */
+static bool who_is_responder_duplicate(
+    WHO_IS_RESPONDER *responder,
+    const BACNET_ADDRESS *src,
+    int32_t low_limit,
+    int32_t high_limit)
+{
+    struct who_is_request *request;
+    struct who_is_request *oldest = &responder->recent[0];
+    unsigned i;
+
+    for (i = 0; i < WHO_IS_DUPLICATE_REQUESTS; i++) {
+        request = &responder->recent[i];
+        if (request->valid &&
+            ((responder->clock - request->time) >=
+             responder->duplicate_window_ms)) {
+            request->valid = false;
+        }
+        if (!request->valid) {
+            oldest = request;
+            continue;
+        }
+        if ((request->low_limit == low_limit) &&
+            (request->high_limit == high_limit) &&
+            bacnet_address_same(&request->src, src)) {
+            return true;
+        }
+        if (oldest->valid &&
+            ((responder->clock - request->time) >
+             (responder->clock - oldest->time))) {
+            oldest = request;
+        }
+    }
+    if (src) {
+        bacnet_address_copy(&oldest->src, src);
+    } else {
+        memset(&oldest->src, 0, sizeof(oldest->src));
+    }
+    oldest->low_limit = low_limit;
+    oldest->high_limit = high_limit;
+    oldest->time = responder->clock;
+    oldest->valid = true;
+
+    return false;
+}
+
+/**
+ * @brief Handle a Who-Is for a device with a responder: a request for the
+ *  device is answered by a broadcast I-Am at a random time within the
+ *  reply window, see who_is_responder_timer()
+ * @param responder [in] the responder of the port the Who-Is came in on
+ * @param device_id [in] instance of the device
+ * @param service_request [in] the Who-Is service request
+ * @param service_len [in] length of the service request
+ * @param src [in] the address of the client
+ * @return true if the device will answer: a new reply, or one that was
+ *  waiting already; false if the request is not for the device, is not
+ *  valid, or repeats one that was answered
+ */
+bool who_is_responder_request(
+    WHO_IS_RESPONDER *responder,
+    uint32_t device_id,
+    const uint8_t *service_request,
+    uint16_t service_len,
+    const BACNET_ADDRESS *src)
+{
+    int len;
+    int32_t low_limit = 0;
+    int32_t high_limit = BACNET_MAX_INSTANCE;
+
+    if (!responder) {
+        return false;
+    }
+    len = whois_decode_service_request(
+        service_request, service_len, &low_limit, &high_limit);
+    if (len == 0) {
+        /* no limits */
+        low_limit = 0;
+        high_limit = BACNET_MAX_INSTANCE;
+    } else if (len == BACNET_STATUS_ERROR) {
+        return false;
+    }
+    if ((device_id < (uint32_t)low_limit) ||
+        (device_id > (uint32_t)high_limit)) {
+        return false;
+    }
+    responder->requests++;
+    if (who_is_responder_duplicate(responder, src, low_limit, high_limit)) {
+        responder->duplicates++;
+        return false;
+    }
+    if (responder->reply_pending) {
+        responder->coalesced++;
+        return true;
+    }
+    responder->reply_pending = true;
+    responder->reply_time = responder->clock;
+    if (responder->reply_window_ms) {
+        responder->reply_time +=
+            who_is_random(responder) % responder->reply_window_ms;
+    }
+
+    return true;
+}
+
+/* take a token for an I-Am, if there is one */
+static bool who_is_responder_token(WHO_IS_RESPONDER *responder)
+{
+    if (responder->credit_ms < responder->reply_interval_ms) {
+        return false;
+    }
+    responder->credit_ms -= responder->reply_interval_ms;
+
+    return true;
+}
+
+/**
+ * @brief Advance the clock of a responder and tell what it has to send:
+ *  the caller sends a broadcast I-Am on the port for either event
+ * @param responder [in] the responder of one port
+ * @param milliseconds [in] time since the last call
+ * @return the I-Am to send now, if any
+ */
+WHO_IS_RESPONDER_EVENT
+who_is_responder_timer(WHO_IS_RESPONDER *responder, uint32_t milliseconds)
+{
+    uint32_t credit_max;
+
+    if (!responder) {
+        return WHO_IS_RESPONDER_NONE;
+    }
+    responder->clock += milliseconds;
+    credit_max = responder->reply_interval_ms * responder->reply_burst;
+    if ((credit_max - responder->credit_ms) > milliseconds) {
+        responder->credit_ms += milliseconds;
+    } else {
+        responder->credit_ms = credit_max;
+    }
+    if (responder->reply_pending &&
+        who_is_time_reached(responder->clock, responder->reply_time) &&
+        who_is_responder_token(responder)) {
+        responder->reply_pending = false;
+        responder->replies++;
+        who_is_responder_sent(responder);
+        return WHO_IS_RESPONDER_REPLY;
+    }
+    if (responder->announce_interval_ms &&
+        ((responder->clock - responder->i_am_time) >=
+         responder->announce_interval_ms) &&
+        who_is_responder_token(responder)) {
+        responder->announcements++;
+        who_is_responder_sent(responder);
+        /* nobody asked: back off */
+        if (responder->announce_interval_ms <
+            (responder->announce_max_ms / 2)) {
+            responder->announce_interval_ms *= 2;
+        } else {
+            responder->announce_interval_ms = responder->announce_max_ms;
+        }
+        return WHO_IS_RESPONDER_ANNOUNCE;
+    }
+
+    return WHO_IS_RESPONDER_NONE;
+}
+
+/**
+ * @brief Time until a responder may have something to send
+ * @param responder [in] the responder of one port
+ * @return milliseconds, or UINT32_MAX if nothing is waiting
+ */
+uint32_t who_is_responder_next(const WHO_IS_RESPONDER *responder)
+{
+    uint32_t next = UINT32_MAX;
+    uint32_t token = 0;
+    uint32_t due;
+
+    if (!responder) {
+        return next;
+    }
+    if (responder->credit_ms < responder->reply_interval_ms) {
+        token = responder->reply_interval_ms - responder->credit_ms;
+    }
+    if (responder->reply_pending) {
+        due = 0;
+        if (!who_is_time_reached(responder->clock, responder->reply_time)) {
+            due = responder->reply_time - responder->clock;
+        }
+        next = (due > token) ? due : token;
+    }
+    if (responder->announce_interval_ms) {
+        due = 0;
+        if ((responder->clock - responder->i_am_time) <
+            responder->announce_interval_ms) {
+            due = responder->announce_interval_ms -
+                (responder->clock - responder->i_am_time);
+        }
+        if (due < token) {
+            due = token;
+        }
+        if (due < next) {
+            next = due;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * @brief Note an I-Am sent on the port, such as the one at start-up: the
+ *  next periodic I-Am is counted from it
+ * @param responder [in] the responder of one port
+ */
+void who_is_responder_sent(WHO_IS_RESPONDER *responder)
+{
+    if (responder) {
+        responder->i_am_time = responder->clock;
+    }
+}
+
 #ifdef BAC_ROUTING /* was for BAC_ROUTING - delete in 2/2012 if still unused \
                     */
 /* EKH: I restored this to BAC_ROUTING (from DEPRECATED) because I found that
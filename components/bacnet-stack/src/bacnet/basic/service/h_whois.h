@@ -20,6 +20,80 @@
 /* BACnet Stack API */
 #include "bacnet/apdu.h"
 
+/* I-Am replies to Who-Is are sent at a random time within this window,
+   so that the devices of a segment do not all answer at once */
+#ifndef WHO_IS_REPLY_WINDOW_MS
+#define WHO_IS_REPLY_WINDOW_MS 2000
+#endif
+/* at most this many I-Am in a row, then one per interval */
+#ifndef WHO_IS_REPLY_BURST
+#define WHO_IS_REPLY_BURST 3
+#endif
+#ifndef WHO_IS_REPLY_INTERVAL_MS
+#define WHO_IS_REPLY_INTERVAL_MS 5000
+#endif
+/* the same Who-Is from the same client within this window is answered
+   once; this many requests are remembered */
+#ifndef WHO_IS_DUPLICATE_WINDOW_MS
+#define WHO_IS_DUPLICATE_WINDOW_MS 10000
+#endif
+#ifndef WHO_IS_DUPLICATE_REQUESTS
+#define WHO_IS_DUPLICATE_REQUESTS 4
+#endif
+
+/* what a Who-Is responder has to send now */
+typedef enum {
+    WHO_IS_RESPONDER_NONE = 0,
+    /* an I-Am that answers a Who-Is */
+    WHO_IS_RESPONDER_REPLY,
+    /* a periodic I-Am that is not in response to a Who-Is */
+    WHO_IS_RESPONDER_ANNOUNCE
+} WHO_IS_RESPONDER_EVENT;
+
+struct who_is_request {
+    BACNET_ADDRESS src;
+    int32_t low_limit;
+    int32_t high_limit;
+    /* clock time it came in, in milliseconds */
+    uint32_t time;
+    bool valid;
+};
+
+/**
+ * @brief The I-Am replies to Who-Is and the periodic I-Am of one port.
+ *  A reply waits a random time within the reply window, every Who-Is
+ *  that comes in meanwhile is answered by the same I-Am, and a repeat
+ *  of a Who-Is from the same client within the duplicate window is not
+ *  answered again.  Every I-Am takes a token of a bucket that holds
+ *  reply_burst tokens and gains one per reply_interval_ms.  The periodic
+ *  I-Am waits announce_min_ms after the last I-Am, then twice as long
+ *  after each periodic one, up to announce_max_ms.
+ */
+typedef struct who_is_responder {
+    uint32_t reply_window_ms;
+    uint32_t reply_interval_ms;
+    uint8_t reply_burst;
+    uint32_t duplicate_window_ms;
+    /* 0 for no periodic I-Am */
+    uint32_t announce_min_ms;
+    uint32_t announce_max_ms;
+    /* state */
+    uint32_t clock;
+    uint32_t random;
+    uint32_t credit_ms;
+    bool reply_pending;
+    uint32_t reply_time;
+    uint32_t announce_interval_ms;
+    uint32_t i_am_time;
+    struct who_is_request recent[WHO_IS_DUPLICATE_REQUESTS];
+    /* counters */
+    uint32_t requests;
+    uint32_t duplicates;
+    uint32_t coalesced;
+    uint32_t replies;
+    uint32_t announcements;
+} WHO_IS_RESPONDER;
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -44,6 +118,34 @@ BACNET_STACK_EXPORT
 void handler_who_is_unicast_for_routing(
     uint8_t *service_request, uint16_t service_len, BACNET_ADDRESS *src);
 
+BACNET_STACK_EXPORT
+void who_is_responder_init(WHO_IS_RESPONDER *responder, uint32_t seed);
+
+BACNET_STACK_EXPORT
+void who_is_responder_announce_set(
+    WHO_IS_RESPONDER *responder, uint32_t min_ms, uint32_t max_ms);
+
+BACNET_STACK_EXPORT
+void who_is_responder_announce_reset(WHO_IS_RESPONDER *responder);
+
+BACNET_STACK_EXPORT
+bool who_is_responder_request(
+    WHO_IS_RESPONDER *responder,
+    uint32_t device_id,
+    const uint8_t *service_request,
+    uint16_t service_len,
+    const BACNET_ADDRESS *src);
+
+BACNET_STACK_EXPORT
+WHO_IS_RESPONDER_EVENT
+who_is_responder_timer(WHO_IS_RESPONDER *responder, uint32_t milliseconds);
+
+BACNET_STACK_EXPORT
+uint32_t who_is_responder_next(const WHO_IS_RESPONDER *responder);
+
+BACNET_STACK_EXPORT
+void who_is_responder_sent(WHO_IS_RESPONDER *responder);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
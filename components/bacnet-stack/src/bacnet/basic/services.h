@@ -43,6 +43,7 @@
 #include "bacnet/basic/service/h_rp_a.h"
 #include "bacnet/basic/service/h_rpm.h"
 #include "bacnet/basic/service/h_rpm_a.h"
+#include "bacnet/basic/service/h_rpm_cache.h"
 #include "bacnet/basic/service/h_rr.h"
 #include "bacnet/basic/service/h_rr_a.h"
 #include "bacnet/basic/service/h_ts.h"
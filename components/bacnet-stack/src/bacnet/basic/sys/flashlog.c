@@ -0,0 +1,578 @@
+/**
+ * @file
+ * @brief An append-only log of records in a flash partition, kept in a
+ *  ring of erase segments.
+ *
+ * The partition is cut into segments of one or more erase sectors.
+ * Records are only ever appended to the newest segment; when it is
+ * full, the next segment of the ring is erased and takes the records
+ * that follow, dropping the oldest segment once all of them are in
+ * use.  Every segment is erased once per trip around the ring, which
+ * spreads the wear evenly over the partition.
+ *
+ * Each segment starts with a header holding a sequence number, one more
+ * than that of the segment before it, and the number of times it has
+ * been erased.  Each record has its length and a CRC in front of it,
+ * and the data are written before the header, so a record is only found
+ * once all of it is in flash.
+ *
+ * At boot, flash_log_init() reads the header of every segment and then
+ * the records of the newest one, so the time to recover depends on the
+ * number of segments and the size of one of them, not on how much the
+ * log holds.  A write cut short by a reset leaves the rest of the newest
+ * segment unused, and the next record starts a new segment.  A segment
+ * whose erase or header write was cut short is not part of the log, and
+ * is erased again when the ring comes round to it.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacint.h"
+#include "bacnet/datalink/crc.h"
+#include "bacnet/basic/sys/flashlog.h"
+
+/* segment header: 'F', 'L', version, 0xFF, sequence(4), erase count(4),
+   0xFFFF, CRC(2) */
+#define FLASH_LOG_MARK_0 'F'
+#define FLASH_LOG_MARK_1 'L'
+#define FLASH_LOG_VERSION 1
+#define FLASH_LOG_SEGMENT_CRC 14
+/* octets read at a time when the partition is not mapped */
+#define FLASH_LOG_CHUNK 64
+
+/* what is at an offset of a segment */
+typedef enum {
+    FLASH_LOG_RECORD_VALID,
+    FLASH_LOG_RECORD_ERASED,
+    FLASH_LOG_RECORD_INVALID
+} FLASH_LOG_RECORD_STATUS;
+
+static uint32_t flash_log_aligned(uint32_t length)
+{
+    return (length + (FLASH_LOG_ALIGN - 1)) & ~(uint32_t)(FLASH_LOG_ALIGN - 1);
+}
+
+/* address in the partition of an offset of a segment */
+static uint32_t
+flash_log_slot_address(const FLASH_LOG *log, uint16_t slot, uint32_t offset)
+{
+    return ((uint32_t)slot * log->segment_size) + offset;
+}
+
+/* ring slot of a segment numbered from the oldest */
+static uint16_t flash_log_slot(const FLASH_LOG *log, uint16_t segment)
+{
+    return (uint16_t)(((uint32_t)log->tail + segment) % log->segments);
+}
+
+static bool flash_log_octets(
+    const FLASH_LOG *log, uint32_t address, void *data, size_t length)
+{
+    if (log->driver->mapped) {
+        memcpy(data, &log->driver->mapped[address], length);
+        return true;
+    }
+
+    return log->driver->read(log->driver->context, address, data, length);
+}
+
+/**
+ * @brief Continue a CRC over octets of the partition
+ * @return true if the octets could be read
+ */
+static bool flash_log_crc(
+    const FLASH_LOG *log, uint32_t address, uint32_t length, uint16_t *crc)
+{
+    uint8_t chunk[FLASH_LOG_CHUNK];
+    uint32_t len;
+
+    if (log->driver->mapped) {
+        *crc = CRC_Calc_Data_Block(&log->driver->mapped[address], length, *crc);
+        return true;
+    }
+    while (length > 0) {
+        len = (length > sizeof(chunk)) ? sizeof(chunk) : length;
+        if (!flash_log_octets(log, address, chunk, len)) {
+            return false;
+        }
+        *crc = CRC_Calc_Data_Block(chunk, len, *crc);
+        address += len;
+        length -= len;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Determine if octets of the partition are still erased
+ */
+static bool
+flash_log_blank(const FLASH_LOG *log, uint32_t address, uint32_t length)
+{
+    uint8_t chunk[FLASH_LOG_CHUNK];
+    uint32_t len;
+    uint32_t i;
+
+    while (length > 0) {
+        len = (length > sizeof(chunk)) ? sizeof(chunk) : length;
+        if (!flash_log_octets(log, address, chunk, len)) {
+            return false;
+        }
+        for (i = 0; i < len; i++) {
+            if (chunk[i] != 0xFF) {
+                return false;
+            }
+        }
+        address += len;
+        length -= len;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Read the header of the segment in a ring slot
+ * @return true if the header is whole
+ */
+static bool flash_log_segment_header(
+    const FLASH_LOG *log,
+    uint16_t slot,
+    uint32_t *sequence,
+    uint32_t *erase_count)
+{
+    uint8_t header[FLASH_LOG_SEGMENT_HEADER];
+    uint16_t crc = 0;
+
+    if (!flash_log_octets(
+            log, flash_log_slot_address(log, slot, 0), header,
+            sizeof(header))) {
+        return false;
+    }
+    decode_unsigned16(&header[FLASH_LOG_SEGMENT_CRC], &crc);
+    if ((header[0] != FLASH_LOG_MARK_0) || (header[1] != FLASH_LOG_MARK_1) ||
+        (header[2] != FLASH_LOG_VERSION) ||
+        (CRC_Calc_Data_Block(header, FLASH_LOG_SEGMENT_CRC, 0xFFFF) != crc)) {
+        return false;
+    }
+    decode_unsigned32(&header[4], sequence);
+    decode_unsigned32(&header[8], erase_count);
+
+    return true;
+}
+
+/**
+ * @brief Check the record at an offset of the segment in a ring slot
+ * @param end - where the records of the segment end
+ * @param length - length of a valid record
+ */
+static FLASH_LOG_RECORD_STATUS flash_log_record_check(
+    const FLASH_LOG *log,
+    uint16_t slot,
+    uint32_t offset,
+    uint32_t end,
+    uint16_t *length)
+{
+    uint8_t header[FLASH_LOG_RECORD_HEADER];
+    uint32_t address = flash_log_slot_address(log, slot, offset);
+    uint16_t crc = 0;
+    uint16_t len = 0;
+
+    if ((offset + FLASH_LOG_RECORD_HEADER) > end) {
+        return FLASH_LOG_RECORD_ERASED;
+    }
+    if (!flash_log_octets(log, address, header, sizeof(header))) {
+        return FLASH_LOG_RECORD_INVALID;
+    }
+    if ((header[0] == 0xFF) && (header[1] == 0xFF) && (header[2] == 0xFF) &&
+        (header[3] == 0xFF)) {
+        return FLASH_LOG_RECORD_ERASED;
+    }
+    decode_unsigned16(&header[0], &len);
+    if ((len == 0) || ((offset + FLASH_LOG_RECORD_HEADER + len) > end)) {
+        return FLASH_LOG_RECORD_INVALID;
+    }
+    crc = CRC_Calc_Data_Block(header, 2, 0xFFFF);
+    if (!flash_log_crc(log, address + FLASH_LOG_RECORD_HEADER, len, &crc)) {
+        return FLASH_LOG_RECORD_INVALID;
+    }
+    if (((uint8_t)(crc >> 8) != header[2]) || ((uint8_t)crc != header[3])) {
+        return FLASH_LOG_RECORD_INVALID;
+    }
+    *length = len;
+
+    return FLASH_LOG_RECORD_VALID;
+}
+
+/**
+ * @brief Erase the next segment of the ring and make it the newest,
+ *  dropping the oldest segment if every one is in use
+ * @return true if the segment is ready for records
+ */
+static bool flash_log_segment_open(FLASH_LOG *log)
+{
+    uint8_t header[FLASH_LOG_SEGMENT_HEADER];
+    uint16_t slot;
+    uint32_t address;
+    uint32_t sequence = 0;
+    uint32_t erase_count = 0;
+
+    slot = (uint16_t)((log->head + 1U) % log->segments);
+    if (log->used == log->segments) {
+        log->tail = flash_log_slot(log, 1);
+        log->used--;
+    }
+    if (!flash_log_segment_header(log, slot, &sequence, &erase_count)) {
+        /* not known: as worn as the most worn, which is at most one
+           erase ahead of it */
+        erase_count = log->erase_count ? (log->erase_count - 1) : 0;
+    }
+    erase_count++;
+    address = flash_log_slot_address(log, slot, 0);
+    if (!log->driver->erase(log->driver->context, address, log->segment_size)) {
+        return false;
+    }
+    sequence = log->sequence + 1;
+    header[0] = FLASH_LOG_MARK_0;
+    header[1] = FLASH_LOG_MARK_1;
+    header[2] = FLASH_LOG_VERSION;
+    header[3] = 0xFF;
+    encode_unsigned32(&header[4], sequence);
+    encode_unsigned32(&header[8], erase_count);
+    header[12] = 0xFF;
+    header[13] = 0xFF;
+    encode_unsigned16(
+        &header[FLASH_LOG_SEGMENT_CRC],
+        CRC_Calc_Data_Block(header, FLASH_LOG_SEGMENT_CRC, 0xFFFF));
+    if (!log->driver->write(
+            log->driver->context, address, header, sizeof(header))) {
+        return false;
+    }
+    if (log->used == 0) {
+        log->tail = slot;
+    }
+    log->head = slot;
+    log->used++;
+    log->sequence = sequence;
+    log->offset = FLASH_LOG_SEGMENT_HEADER;
+    if (erase_count > log->erase_count) {
+        log->erase_count = erase_count;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Move a cursor to the first record at or after where it points
+ * @return true if there is a record
+ */
+static bool flash_log_seek(const FLASH_LOG *log, FLASH_LOG_CURSOR *cursor)
+{
+    uint16_t slot;
+    uint32_t end;
+
+    while (cursor->segment < log->used) {
+        slot = flash_log_slot(log, cursor->segment);
+        end = log->segment_size;
+        if (slot == log->head) {
+            end = log->offset;
+        }
+        if (flash_log_record_check(
+                log, slot, cursor->offset, end, &cursor->length) ==
+            FLASH_LOG_RECORD_VALID) {
+            return true;
+        }
+        /* the rest of the segment is erased, or was cut short */
+        cursor->segment++;
+        cursor->offset = FLASH_LOG_SEGMENT_HEADER;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Mount the log of a flash partition, finding the newest segment
+ *  and the end of its records.  A partition without a log is used as a
+ *  blank one, each segment erased as the log reaches it.
+ * @param log - the log
+ * @param driver - the partition
+ * @param size - octets of the partition
+ * @param segment_size - octets of a segment, a whole number of erase
+ *  sectors
+ * @return true if the log is ready for records
+ */
+bool flash_log_init(
+    FLASH_LOG *log,
+    const FLASH_LOG_DRIVER *driver,
+    uint32_t size,
+    uint32_t segment_size)
+{
+    FLASH_LOG_RECORD_STATUS status = FLASH_LOG_RECORD_ERASED;
+    uint32_t sequence = 0;
+    uint32_t erase_count = 0;
+    uint32_t segments;
+    uint16_t length = 0;
+    uint16_t slot;
+    bool found = false;
+
+    if (!log || !driver || !driver->read || !driver->write ||
+        !driver->erase || (segment_size % FLASH_LOG_ALIGN) ||
+        (segment_size <
+         (FLASH_LOG_SEGMENT_HEADER + FLASH_LOG_RECORD_HEADER +
+          FLASH_LOG_ALIGN))) {
+        return false;
+    }
+    segments = size / segment_size;
+    if (segments < 2) {
+        return false;
+    }
+    if (segments > UINT16_MAX) {
+        segments = UINT16_MAX;
+    }
+    memset(log, 0, sizeof(*log));
+    log->driver = driver;
+    log->segment_size = segment_size;
+    log->segments = (uint16_t)segments;
+    log->head = (uint16_t)(segments - 1);
+    log->offset = segment_size;
+    /* the newest segment has the highest sequence number */
+    for (slot = 0; slot < log->segments; slot++) {
+        if (!flash_log_segment_header(log, slot, &sequence, &erase_count)) {
+            continue;
+        }
+        if (erase_count > log->erase_count) {
+            log->erase_count = erase_count;
+        }
+        if (!found || (sequence > log->sequence)) {
+            found = true;
+            log->head = slot;
+            log->sequence = sequence;
+        }
+    }
+    if (!found) {
+        return true;
+    }
+    /* and the segments before it in the ring count down to the oldest */
+    log->used = 1;
+    while (log->used < log->segments) {
+        slot = (uint16_t)((log->head + log->segments - log->used) %
+                          log->segments);
+        if (!flash_log_segment_header(log, slot, &sequence, &erase_count) ||
+            (sequence != (log->sequence - log->used))) {
+            break;
+        }
+        log->used++;
+    }
+    log->tail = (uint16_t)((log->head + log->segments - (log->used - 1U)) %
+                           log->segments);
+    log->offset = FLASH_LOG_SEGMENT_HEADER;
+    for (;;) {
+        status = flash_log_record_check(
+            log, log->head, log->offset, log->segment_size, &length);
+        if (status != FLASH_LOG_RECORD_VALID) {
+            break;
+        }
+        log->offset += flash_log_aligned(FLASH_LOG_RECORD_HEADER + length);
+    }
+    if ((status != FLASH_LOG_RECORD_ERASED) ||
+        !flash_log_blank(
+            log, flash_log_slot_address(log, log->head, log->offset),
+            log->segment_size - log->offset)) {
+        /* a write was cut short here: the next record starts a new
+           segment rather than writing over it */
+        log->offset = log->segment_size;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Erase every segment, leaving a blank log
+ * @param log - the log
+ * @return true if the partition was erased
+ */
+bool flash_log_format(FLASH_LOG *log)
+{
+    uint16_t slot;
+
+    if (!log || !log->driver) {
+        return false;
+    }
+    log->head = (uint16_t)(log->segments - 1);
+    log->tail = 0;
+    log->used = 0;
+    log->offset = log->segment_size;
+    for (slot = 0; slot < log->segments; slot++) {
+        if (!log->driver->erase(
+                log->driver->context, flash_log_slot_address(log, slot, 0),
+                log->segment_size)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get the length of the longest record
+ * @param log - the log
+ * @return octets of the longest record a segment holds
+ */
+size_t flash_log_record_max(const FLASH_LOG *log)
+{
+    size_t length;
+
+    if (!log || !log->driver) {
+        return 0;
+    }
+    length = log->segment_size -
+        (FLASH_LOG_SEGMENT_HEADER + FLASH_LOG_RECORD_HEADER);
+    if (length > (UINT16_MAX - 1)) {
+        length = UINT16_MAX - 1;
+    }
+
+    return length;
+}
+
+/**
+ * @brief Add a record to the end of the log, dropping the oldest
+ *  segment of records when there is no room
+ * @param log - the log
+ * @param data - the record
+ * @param length - octets of the record, up to flash_log_record_max()
+ * @return true if the record is in flash
+ */
+bool flash_log_append(FLASH_LOG *log, const void *data, size_t length)
+{
+    uint8_t header[FLASH_LOG_RECORD_HEADER];
+    uint32_t address;
+    uint32_t size;
+    uint16_t crc;
+
+    if (!log || !log->driver || !data || (length == 0) ||
+        (length > flash_log_record_max(log))) {
+        return false;
+    }
+    size = flash_log_aligned(FLASH_LOG_RECORD_HEADER + (uint32_t)length);
+    if ((log->used == 0) || ((log->offset + size) > log->segment_size)) {
+        if (!flash_log_segment_open(log)) {
+            return false;
+        }
+    }
+    address = flash_log_slot_address(log, log->head, log->offset);
+    encode_unsigned16(&header[0], (uint16_t)length);
+    crc = CRC_Calc_Data_Block(header, 2, 0xFFFF);
+    crc = CRC_Calc_Data_Block(data, length, crc);
+    encode_unsigned16(&header[2], crc);
+    /* the data first: the record is only there once its header is */
+    if (!log->driver->write(
+            log->driver->context, address + FLASH_LOG_RECORD_HEADER, data,
+            length) ||
+        !log->driver->write(
+            log->driver->context, address, header, sizeof(header))) {
+        log->offset = log->segment_size;
+        return false;
+    }
+    log->offset += size;
+
+    return true;
+}
+
+/**
+ * @brief Point a cursor at the oldest record of the log.  Appending a
+ *  record may drop the records a cursor points at.
+ * @param log - the log
+ * @param cursor - the cursor
+ * @return true if there is a record
+ */
+bool flash_log_first(const FLASH_LOG *log, FLASH_LOG_CURSOR *cursor)
+{
+    if (!log || !log->driver || !cursor) {
+        return false;
+    }
+    cursor->segment = 0;
+    cursor->offset = FLASH_LOG_SEGMENT_HEADER;
+    cursor->length = 0;
+
+    return flash_log_seek(log, cursor);
+}
+
+/**
+ * @brief Move a cursor to the next record of the log
+ * @param log - the log
+ * @param cursor - the cursor
+ * @return true if there is a record
+ */
+bool flash_log_next(const FLASH_LOG *log, FLASH_LOG_CURSOR *cursor)
+{
+    if (!log || !log->driver || !cursor || (cursor->length == 0)) {
+        return false;
+    }
+    cursor->offset +=
+        flash_log_aligned(FLASH_LOG_RECORD_HEADER + cursor->length);
+    cursor->length = 0;
+
+    return flash_log_seek(log, cursor);
+}
+
+/**
+ * @brief Get the data of the record a cursor points at: in place when
+ *  the partition is mapped, or else copied into a buffer
+ * @param log - the log
+ * @param cursor - the cursor
+ * @param buffer - where to copy the record if the partition is not
+ *  mapped
+ * @param size - octets of the buffer
+ * @return the record, cursor->length octets, or NULL
+ */
+const uint8_t *flash_log_read(
+    const FLASH_LOG *log,
+    const FLASH_LOG_CURSOR *cursor,
+    uint8_t *buffer,
+    size_t size)
+{
+    uint32_t address;
+
+    if (!log || !log->driver || !cursor || (cursor->length == 0)) {
+        return NULL;
+    }
+    address = flash_log_slot_address(
+        log, flash_log_slot(log, cursor->segment),
+        cursor->offset + FLASH_LOG_RECORD_HEADER);
+    if (log->driver->mapped) {
+        return &log->driver->mapped[address];
+    }
+    if (!buffer || (size < cursor->length) ||
+        !log->driver->read(
+            log->driver->context, address, buffer, cursor->length)) {
+        return NULL;
+    }
+
+    return buffer;
+}
+
+/**
+ * @brief Get the number of segments that hold records
+ * @param log - the log
+ * @return number of segments in use
+ */
+uint16_t flash_log_segments_used(const FLASH_LOG *log)
+{
+    return log ? log->used : 0;
+}
+
+/**
+ * @brief Get the number of times the most worn segment has been erased
+ * @param log - the log
+ * @return erase count
+ */
+uint32_t flash_log_erase_count(const FLASH_LOG *log)
+{
+    return log ? log->erase_count : 0;
+}
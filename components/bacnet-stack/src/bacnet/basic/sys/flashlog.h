@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief API for an append-only log of records in a flash partition,
+ *  kept in a ring of erase segments.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_SYS_FLASHLOG_H
+#define BACNET_SYS_FLASHLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+
+/* octets at the start of each segment: mark, version, sequence number,
+   erase count and CRC */
+#define FLASH_LOG_SEGMENT_HEADER 16
+/* octets before each record: length and CRC */
+#define FLASH_LOG_RECORD_HEADER 4
+/* records start on this boundary */
+#define FLASH_LOG_ALIGN 4
+
+/**
+ * @brief The flash partition under the log.  Addresses are from the
+ *  start of the partition.  Erased flash reads as all ones, and a write
+ *  only clears bits.
+ */
+typedef struct flash_log_driver {
+    bool (*read)(void *context, uint32_t address, void *data, size_t length);
+    bool (*write)(
+        void *context, uint32_t address, const void *data, size_t length);
+    /* erase whole segments to all ones */
+    bool (*erase)(void *context, uint32_t address, size_t length);
+    /* optional: the partition mapped into memory, to read records in
+       place instead of copying them out */
+    const uint8_t *mapped;
+    void *context;
+} FLASH_LOG_DRIVER;
+
+typedef struct flash_log {
+    const FLASH_LOG_DRIVER *driver;
+    uint32_t segment_size;
+    uint16_t segments;
+    /* ring of segments: the oldest, the newest, and how many are used */
+    uint16_t tail;
+    uint16_t head;
+    uint16_t used;
+    /* sequence number of the newest segment, one more for each */
+    uint32_t sequence;
+    /* where the next record goes in the newest segment */
+    uint32_t offset;
+    /* most times any segment has been erased */
+    uint32_t erase_count;
+} FLASH_LOG;
+
+/* a record of the log */
+typedef struct flash_log_cursor {
+    /* segment number from the oldest */
+    uint16_t segment;
+    /* offset of the record in its segment, and its length */
+    uint32_t offset;
+    uint16_t length;
+} FLASH_LOG_CURSOR;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+bool flash_log_init(
+    FLASH_LOG *log,
+    const FLASH_LOG_DRIVER *driver,
+    uint32_t size,
+    uint32_t segment_size);
+
+BACNET_STACK_EXPORT
+bool flash_log_format(FLASH_LOG *log);
+
+BACNET_STACK_EXPORT
+bool flash_log_append(FLASH_LOG *log, const void *data, size_t length);
+
+BACNET_STACK_EXPORT
+size_t flash_log_record_max(const FLASH_LOG *log);
+
+BACNET_STACK_EXPORT
+bool flash_log_first(const FLASH_LOG *log, FLASH_LOG_CURSOR *cursor);
+
+BACNET_STACK_EXPORT
+bool flash_log_next(const FLASH_LOG *log, FLASH_LOG_CURSOR *cursor);
+
+BACNET_STACK_EXPORT
+const uint8_t *flash_log_read(
+    const FLASH_LOG *log,
+    const FLASH_LOG_CURSOR *cursor,
+    uint8_t *buffer,
+    size_t size);
+
+BACNET_STACK_EXPORT
+uint16_t flash_log_segments_used(const FLASH_LOG *log);
+
+BACNET_STACK_EXPORT
+uint32_t flash_log_erase_count(const FLASH_LOG *log);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
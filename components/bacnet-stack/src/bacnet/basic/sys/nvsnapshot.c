@@ -0,0 +1,363 @@
+/**
+ * @file
+ * @brief A packed snapshot of the persisted object properties, stored
+ *  as one versioned and CRC protected blob.
+ *
+ * Restoring a device from one key per property costs one store lookup
+ * and one formatted key per property of every object.  The snapshot
+ * holds every persisted property of every object in one blob, so a
+ * restore is a single read and one pass over RAM:
+ *
+ *  header: 'S', 'N', version, 0, object count(4), blob length(4)
+ *  object: type(2), instance(4), properties, then each property held:
+ *          name and description as length, characters and terminator;
+ *          units(2); present value or COV increment as a REAL(4);
+ *          enumerated present value(4)
+ *  CRC-16 of everything before it
+ *
+ * A newer version of the format is not decoded; the caller then falls
+ * back to its defaults, or to an older layout of the store.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacint.h"
+#include "bacnet/bacreal.h"
+#include "bacnet/datalink/crc.h"
+#include "bacnet/basic/sys/nvsnapshot.h"
+
+#define NV_SNAPSHOT_MARK_0 'S'
+#define NV_SNAPSHOT_MARK_1 'N'
+#define NV_SNAPSHOT_HEADER 12
+#define NV_SNAPSHOT_CRC 2
+
+static int nv_snapshot_string_encode(uint8_t *buffer, const char *value)
+{
+    size_t length = 0;
+
+    if (value) {
+        length = strlen(value);
+    }
+    if (length > NV_SNAPSHOT_STRING_MAX) {
+        length = NV_SNAPSHOT_STRING_MAX;
+    }
+    if (buffer) {
+        buffer[0] = (uint8_t)length;
+        if (length) {
+            memcpy(&buffer[1], value, length);
+        }
+        buffer[1 + length] = 0;
+    }
+
+    return (int)length + 2;
+}
+
+/**
+ * @brief Encode the record of one object
+ * @param buffer - where to encode, or NULL to get the length
+ * @param object - the object
+ * @return number of octets of the record
+ */
+int nv_snapshot_object_encode(uint8_t *buffer, const NV_SNAPSHOT_OBJECT *object)
+{
+    int len = 0;
+
+    len += encode_unsigned16(
+        buffer ? &buffer[len] : NULL, (uint16_t)object->object_type);
+    len += encode_unsigned32(
+        buffer ? &buffer[len] : NULL, object->object_instance);
+    if (buffer) {
+        buffer[len] = object->properties;
+    }
+    len++;
+    if (object->properties & NV_SNAPSHOT_NAME) {
+        len += nv_snapshot_string_encode(
+            buffer ? &buffer[len] : NULL, object->name);
+    }
+    if (object->properties & NV_SNAPSHOT_DESCRIPTION) {
+        len += nv_snapshot_string_encode(
+            buffer ? &buffer[len] : NULL, object->description);
+    }
+    if (object->properties & NV_SNAPSHOT_UNITS) {
+        len += encode_unsigned16(buffer ? &buffer[len] : NULL, object->units);
+    }
+    if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_REAL) {
+        len += encode_bacnet_real(
+            object->present_value, buffer ? &buffer[len] : NULL);
+    }
+    if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED) {
+        len += encode_unsigned32(
+            buffer ? &buffer[len] : NULL, object->present_value_enumerated);
+    }
+    if (object->properties & NV_SNAPSHOT_COV_INCREMENT) {
+        len += encode_bacnet_real(
+            object->cov_increment, buffer ? &buffer[len] : NULL);
+    }
+
+    return len;
+}
+
+/**
+ * @brief Size of the snapshot of the objects, to size the buffer
+ * @param object_get - returns each object in turn
+ * @param context - passed to object_get
+ * @return number of octets of the snapshot
+ */
+size_t
+nv_snapshot_size(nv_snapshot_object_get_function object_get, void *context)
+{
+    NV_SNAPSHOT_OBJECT object;
+    size_t length = NV_SNAPSHOT_OVERHEAD;
+    unsigned index = 0;
+
+    while (object_get(index++, &object, context)) {
+        length += (size_t)nv_snapshot_object_encode(NULL, &object);
+    }
+
+    return length;
+}
+
+/**
+ * @brief Encode the snapshot of the objects
+ * @param buffer - where to encode
+ * @param buffer_size - size of the buffer
+ * @param object_get - returns each object in turn
+ * @param context - passed to object_get
+ * @return number of octets of the snapshot, or 0 if it does not fit
+ */
+size_t nv_snapshot_encode(
+    uint8_t *buffer,
+    size_t buffer_size,
+    nv_snapshot_object_get_function object_get,
+    void *context)
+{
+    NV_SNAPSHOT_OBJECT object;
+    size_t offset = NV_SNAPSHOT_HEADER;
+    uint32_t count = 0;
+    size_t len;
+
+    if (!buffer || (buffer_size < NV_SNAPSHOT_OVERHEAD)) {
+        return 0;
+    }
+    while (object_get(count, &object, context)) {
+        len = (size_t)nv_snapshot_object_encode(NULL, &object);
+        if ((offset + len + NV_SNAPSHOT_CRC) > buffer_size) {
+            return 0;
+        }
+        (void)nv_snapshot_object_encode(&buffer[offset], &object);
+        offset += len;
+        count++;
+    }
+    buffer[0] = NV_SNAPSHOT_MARK_0;
+    buffer[1] = NV_SNAPSHOT_MARK_1;
+    buffer[2] = NV_SNAPSHOT_VERSION;
+    buffer[3] = 0;
+    (void)encode_unsigned32(&buffer[4], count);
+    (void)encode_unsigned32(&buffer[8], (uint32_t)(offset + NV_SNAPSHOT_CRC));
+    (void)encode_unsigned16(
+        &buffer[offset], CRC_Calc_Data_Block(buffer, offset, 0xFFFF));
+
+    return offset + NV_SNAPSHOT_CRC;
+}
+
+/**
+ * @brief Check the mark, version, length and CRC of a snapshot
+ * @param buffer - the snapshot
+ * @param length - number of octets read from the store
+ * @param count - returns the number of objects, may be NULL
+ * @return true if the snapshot is whole and of this version
+ */
+bool nv_snapshot_valid(const uint8_t *buffer, size_t length, unsigned *count)
+{
+    uint32_t snapshot_length = 0;
+    uint32_t snapshot_count = 0;
+    uint16_t crc = 0;
+
+    if (!buffer || (length < NV_SNAPSHOT_OVERHEAD) ||
+        (buffer[0] != NV_SNAPSHOT_MARK_0) ||
+        (buffer[1] != NV_SNAPSHOT_MARK_1) ||
+        (buffer[2] != NV_SNAPSHOT_VERSION)) {
+        return false;
+    }
+    (void)decode_unsigned32(&buffer[4], &snapshot_count);
+    (void)decode_unsigned32(&buffer[8], &snapshot_length);
+    if (snapshot_length != length) {
+        return false;
+    }
+    (void)decode_unsigned16(&buffer[length - NV_SNAPSHOT_CRC], &crc);
+    if (CRC_Calc_Data_Block(buffer, length - NV_SNAPSHOT_CRC, 0xFFFF) !=
+        crc) {
+        return false;
+    }
+    if (count) {
+        *count = snapshot_count;
+    }
+
+    return true;
+}
+
+static bool nv_snapshot_string_decode(
+    const uint8_t *buffer, size_t end, size_t *offset, const char **value)
+{
+    size_t length;
+
+    if ((*offset + 2) > end) {
+        return false;
+    }
+    length = buffer[*offset];
+    if (((*offset + length + 2) > end) ||
+        (buffer[*offset + 1 + length] != 0)) {
+        return false;
+    }
+    *value = (const char *)&buffer[*offset + 1];
+    *offset += length + 2;
+
+    return true;
+}
+
+/**
+ * @brief Decode the object record at an offset of a valid snapshot
+ * @return true if the record was decoded, and offset moved past it
+ */
+static bool nv_snapshot_object_decode(
+    const uint8_t *buffer,
+    size_t end,
+    size_t *offset,
+    NV_SNAPSHOT_OBJECT *object)
+{
+    uint16_t object_type = 0;
+    size_t fixed = 0;
+
+    if ((*offset + 7) > end) {
+        return false;
+    }
+    memset(object, 0, sizeof(*object));
+    *offset += decode_unsigned16(&buffer[*offset], &object_type);
+    object->object_type = (BACNET_OBJECT_TYPE)object_type;
+    *offset += decode_unsigned32(&buffer[*offset], &object->object_instance);
+    object->properties = buffer[(*offset)++];
+    if ((object->properties & NV_SNAPSHOT_NAME) &&
+        !nv_snapshot_string_decode(buffer, end, offset, &object->name)) {
+        return false;
+    }
+    if ((object->properties & NV_SNAPSHOT_DESCRIPTION) &&
+        !nv_snapshot_string_decode(
+            buffer, end, offset, &object->description)) {
+        return false;
+    }
+    if (object->properties & NV_SNAPSHOT_UNITS) {
+        fixed += 2;
+    }
+    if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_REAL) {
+        fixed += 4;
+    }
+    if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED) {
+        fixed += 4;
+    }
+    if (object->properties & NV_SNAPSHOT_COV_INCREMENT) {
+        fixed += 4;
+    }
+    if ((*offset + fixed) > end) {
+        return false;
+    }
+    if (object->properties & NV_SNAPSHOT_UNITS) {
+        *offset += decode_unsigned16(&buffer[*offset], &object->units);
+    }
+    if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_REAL) {
+        *offset += decode_real(&buffer[*offset], &object->present_value);
+    }
+    if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED) {
+        *offset += decode_unsigned32(
+            &buffer[*offset], &object->present_value_enumerated);
+    }
+    if (object->properties & NV_SNAPSHOT_COV_INCREMENT) {
+        *offset += decode_real(&buffer[*offset], &object->cov_increment);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Restore every object of a snapshot, in one pass
+ * @param buffer - the snapshot, which has to outlive the restored names
+ * @param length - number of octets read from the store
+ * @param object_set - called with each object
+ * @param context - passed to object_set
+ * @return number of objects restored, or -1 if the snapshot is not valid
+ */
+int nv_snapshot_decode(
+    const uint8_t *buffer,
+    size_t length,
+    nv_snapshot_object_set_function object_set,
+    void *context)
+{
+    NV_SNAPSHOT_OBJECT object;
+    size_t offset = NV_SNAPSHOT_HEADER;
+    size_t end;
+    unsigned count = 0;
+    unsigned i;
+
+    if (!nv_snapshot_valid(buffer, length, &count)) {
+        return -1;
+    }
+    end = length - NV_SNAPSHOT_CRC;
+    for (i = 0; i < count; i++) {
+        if (!nv_snapshot_object_decode(buffer, end, &offset, &object)) {
+            return -1;
+        }
+        if (object_set) {
+            object_set(&object, context);
+        }
+    }
+
+    return (int)count;
+}
+
+/**
+ * @brief Find one object in a snapshot
+ * @param buffer - the snapshot
+ * @param length - number of octets read from the store
+ * @param object_type - type of the object
+ * @param object_instance - instance of the object
+ * @param object - returns the object, may be NULL
+ * @return true if the snapshot is valid and holds the object
+ */
+bool nv_snapshot_object_find(
+    const uint8_t *buffer,
+    size_t length,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    NV_SNAPSHOT_OBJECT *object)
+{
+    NV_SNAPSHOT_OBJECT found;
+    size_t offset = NV_SNAPSHOT_HEADER;
+    size_t end;
+    unsigned count = 0;
+    unsigned i;
+
+    if (!nv_snapshot_valid(buffer, length, &count)) {
+        return false;
+    }
+    end = length - NV_SNAPSHOT_CRC;
+    for (i = 0; i < count; i++) {
+        if (!nv_snapshot_object_decode(buffer, end, &offset, &found)) {
+            return false;
+        }
+        if ((found.object_type == object_type) &&
+            (found.object_instance == object_instance)) {
+            if (object) {
+                *object = found;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
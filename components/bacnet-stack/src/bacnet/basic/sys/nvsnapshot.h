@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @brief API for a packed snapshot of the persisted object properties,
+ *  stored as one versioned and CRC protected blob.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_SYS_NVSNAPSHOT_H
+#define BACNET_SYS_NVSNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacenum.h"
+
+/* key of the snapshot in the store */
+#define NV_SNAPSHOT_KEY "bacnet_snap"
+#define NV_SNAPSHOT_VERSION 1
+/* header and CRC around the object records */
+#define NV_SNAPSHOT_OVERHEAD 14
+/* longest name or description, not counting the terminator */
+#define NV_SNAPSHOT_STRING_MAX 255
+
+/* which of the properties an object record holds */
+#define NV_SNAPSHOT_NAME 0x01
+#define NV_SNAPSHOT_DESCRIPTION 0x02
+#define NV_SNAPSHOT_UNITS 0x04
+#define NV_SNAPSHOT_PRESENT_VALUE_REAL 0x08
+#define NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED 0x10
+#define NV_SNAPSHOT_COV_INCREMENT 0x20
+
+/**
+ * @brief The persisted properties of one object.  When decoded, the
+ *  strings point into the snapshot, which holds their terminators, so
+ *  the snapshot has to outlive the objects that use them.
+ */
+typedef struct nv_snapshot_object {
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    /* NV_SNAPSHOT_NAME, ... */
+    uint8_t properties;
+    const char *name;
+    const char *description;
+    uint16_t units;
+    float present_value;
+    uint32_t present_value_enumerated;
+    float cov_increment;
+} NV_SNAPSHOT_OBJECT;
+
+/**
+ * @brief Fill in the object at an index, for the encoder
+ * @return false when there are no more objects
+ */
+typedef bool (*nv_snapshot_object_get_function)(
+    unsigned index, NV_SNAPSHOT_OBJECT *object, void *context);
+
+/**
+ * @brief Restore one decoded object
+ */
+typedef void (*nv_snapshot_object_set_function)(
+    const NV_SNAPSHOT_OBJECT *object, void *context);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+int nv_snapshot_object_encode(
+    uint8_t *buffer, const NV_SNAPSHOT_OBJECT *object);
+
+BACNET_STACK_EXPORT
+size_t
+nv_snapshot_size(nv_snapshot_object_get_function object_get, void *context);
+
+BACNET_STACK_EXPORT
+size_t nv_snapshot_encode(
+    uint8_t *buffer,
+    size_t buffer_size,
+    nv_snapshot_object_get_function object_get,
+    void *context);
+
+BACNET_STACK_EXPORT
+bool nv_snapshot_valid(const uint8_t *buffer, size_t length, unsigned *count);
+
+BACNET_STACK_EXPORT
+int nv_snapshot_decode(
+    const uint8_t *buffer,
+    size_t length,
+    nv_snapshot_object_set_function object_set,
+    void *context);
+
+BACNET_STACK_EXPORT
+bool nv_snapshot_object_find(
+    const uint8_t *buffer,
+    size_t length,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    NV_SNAPSHOT_OBJECT *object);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
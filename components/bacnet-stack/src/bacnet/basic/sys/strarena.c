@@ -0,0 +1,424 @@
+/**
+ * @file
+ * @brief A read-mostly arena of interned strings, sized once, that holds
+ *  the names, descriptions and state texts of the objects in this
+ *  device, each with its BACnet CharacterString encoding.
+ *
+ * The objects keep a pointer to their name and description rather than
+ * a copy.  Giving each object its own fixed-size buffers wastes the
+ * unused part of every buffer and caps the number of objects; the arena
+ * packs every string into one block whose size is known up front from
+ * the object descriptors, so the RAM used by the strings of a device
+ * does not depend on the heap.
+ *
+ * A string added twice is stored once: a hash index of the strings finds
+ * the first copy, so the state texts that most binary objects share, or
+ * a name restored with the value it already has, cost nothing.  The
+ * index is a separate block, needed only while the objects are created
+ * and restored, and freed after that.
+ *
+ * Each string is stored as a record:
+ *
+ *  header length h, padding, then the last h octets of the prefix hold
+ *  the encoded application tag and length of the CharacterString and
+ *  its character set; then the characters and a terminator.
+ *
+ * The tag length is the length prefix of the string.  The pointer handed
+ * out is to the characters, so the string is an ordinary C string to the
+ * objects, while a ReadProperty of a name is one copy of the h octets in
+ * front of it and the characters.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/bacdcode.h"
+#include "bacnet/bacenum.h"
+#include "bacnet/bacstr.h"
+#include "bacnet/basic/sys/strarena.h"
+
+/* what characterstring_init() accepts, so that both encode the same */
+#define STRING_ARENA_ENCODE_MAX (MAX_CHARACTER_STRING_BYTES - 1)
+
+/* the arena whose strings the objects encode with one copy */
+static STRING_ARENA *String_Arena_Shared;
+
+/* FNV-1a */
+static uint32_t string_arena_hash(const char *string, size_t length)
+{
+    uint32_t hash = 2166136261UL;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        hash ^= (uint8_t)string[i];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/* Number of index slots for a number of strings: a power of two, with
+   the index at most half full */
+static uint32_t string_arena_index_slots(unsigned strings)
+{
+    uint32_t slots = 8;
+
+    if (strings == 0) {
+        return 0;
+    }
+    while ((slots / 2) < strings) {
+        slots *= 2;
+    }
+
+    return slots;
+}
+
+/* The characters of the string record at an offset */
+static const char *string_arena_record(const STRING_ARENA *arena, size_t offset)
+{
+    return &arena->data[offset + STRING_ARENA_PREFIX];
+}
+
+/* The length of a string in the arena, from its encoded header */
+static size_t string_arena_record_length(const char *string)
+{
+    const uint8_t *header;
+    uint8_t header_len;
+    uint32_t length;
+
+    header_len = (uint8_t)string[-STRING_ARENA_PREFIX];
+    header = (const uint8_t *)string - header_len;
+    length = header[0] & 0x07;
+    if (length == 5) {
+        if (header[1] == 254) {
+            length = ((uint32_t)header[2] << 8) | header[3];
+        } else {
+            length = header[1];
+        }
+    }
+
+    /* not counting the character set */
+    return length - 1;
+}
+
+/* Find a string in the index; the slot where it is, or the empty slot
+   where it would go */
+static uint32_t *string_arena_find(
+    const STRING_ARENA *arena, const char *string, size_t length)
+{
+    uint32_t slot;
+    uint32_t *entry;
+    const char *found;
+
+    slot = string_arena_hash(string, length) & arena->index_mask;
+    for (;;) {
+        entry = &arena->index[slot];
+        if (*entry == 0) {
+            return entry;
+        }
+        found = string_arena_record(arena, *entry - 1);
+        if ((string_arena_record_length(found) == length) &&
+            (memcmp(found, string, length) == 0)) {
+            return entry;
+        }
+        slot = (slot + 1) & arena->index_mask;
+    }
+}
+
+/**
+ * @brief Initialize an arena over a block of memory, without an index
+ * @param arena - the arena
+ * @param data - the block, of string_arena_need() octets per string
+ * @param size - octets of the block
+ */
+void string_arena_init(STRING_ARENA *arena, char *data, size_t size)
+{
+    if (!arena) {
+        return;
+    }
+    memset(arena, 0, sizeof(*arena));
+    if (data) {
+        arena->data = data;
+        arena->size = size;
+    }
+}
+
+/**
+ * @brief Octets of index for a number of strings
+ * @param strings - most strings that will be added while it is set
+ * @return octets of index to pass to string_arena_index_set()
+ */
+size_t string_arena_index_size(unsigned strings)
+{
+    return string_arena_index_slots(strings) * sizeof(uint32_t);
+}
+
+/**
+ * @brief Set the index that finds the strings already added, so that a
+ *  string added twice is stored once.  The index is only needed while
+ *  strings are added, and can be removed and freed once they all are.
+ * @param arena - the arena, whose strings are indexed now
+ * @param index - the index, aligned for uint32_t, or NULL to remove it
+ * @param size - octets of index, from string_arena_index_size()
+ */
+void string_arena_index_set(STRING_ARENA *arena, void *index, size_t size)
+{
+    uint32_t slots = 8;
+    uint32_t *entry;
+    const char *string;
+    size_t length;
+    size_t offset;
+    unsigned strings = 0;
+
+    if (!arena) {
+        return;
+    }
+    arena->index = NULL;
+    arena->index_mask = 0;
+    if (!index || (size < (slots * sizeof(uint32_t)))) {
+        return;
+    }
+    while ((slots * 2 * sizeof(uint32_t)) <= size) {
+        slots *= 2;
+    }
+    arena->index = index;
+    arena->index_mask = slots - 1;
+    memset(arena->index, 0, slots * sizeof(uint32_t));
+    /* the records are back to back, so the arena can be walked */
+    for (offset = 0; (offset < arena->used) && (strings < (slots / 2));
+         offset += string_arena_need_length(length)) {
+        string = string_arena_record(arena, offset);
+        length = string_arena_record_length(string);
+        entry = string_arena_find(arena, string, length);
+        if (*entry == 0) {
+            *entry = (uint32_t)offset + 1;
+            strings++;
+        }
+    }
+    arena->indexed = strings;
+}
+
+/**
+ * @brief Octets of arena that a string of some length takes
+ * @param length - number of characters
+ * @return the octets of its record
+ */
+size_t string_arena_need_length(size_t length)
+{
+    return STRING_ARENA_PREFIX + length + 1;
+}
+
+/**
+ * @brief Octets of arena that a string takes, if it is not a duplicate
+ * @param string - the string, or NULL
+ * @return the octets of its record, or 0 for NULL
+ */
+size_t string_arena_need(const char *string)
+{
+    if (!string) {
+        return 0;
+    }
+
+    return string_arena_need_length(strlen(string));
+}
+
+/**
+ * @brief Intern the first characters of a string
+ * @param arena - the arena
+ * @param string - the characters, which need not be terminated
+ * @param length - number of characters
+ * @return the terminated string in the arena, which may be one added
+ *  before, or NULL if the arena is full
+ */
+const char *
+string_arena_add_length(STRING_ARENA *arena, const char *string, size_t length)
+{
+    uint8_t header[STRING_ARENA_HEADER_MAX];
+    uint32_t *entry = NULL;
+    size_t offset;
+    char *record;
+    int header_len;
+
+    if (!arena || !arena->data || !string) {
+        return NULL;
+    }
+    if (length > STRING_ARENA_LENGTH_MAX) {
+        return NULL;
+    }
+    if (arena->index) {
+        entry = string_arena_find(arena, string, length);
+        if (*entry != 0) {
+            arena->duplicates++;
+            return string_arena_record(arena, *entry - 1);
+        }
+    }
+    if ((arena->size - arena->used) < string_arena_need_length(length)) {
+        return NULL;
+    }
+    header_len = encode_tag(
+        header, BACNET_APPLICATION_TAG_CHARACTER_STRING, false,
+        (uint32_t)(length + 1));
+    header[header_len] = CHARACTER_UTF8;
+    header_len++;
+    offset = arena->used;
+    record = &arena->data[offset];
+    memset(record, 0, STRING_ARENA_PREFIX);
+    record[0] = (char)header_len;
+    memcpy(&record[STRING_ARENA_PREFIX - header_len], header, header_len);
+    if (length) {
+        memcpy(&record[STRING_ARENA_PREFIX], string, length);
+    }
+    record[STRING_ARENA_PREFIX + length] = 0;
+    arena->used += string_arena_need_length(length);
+    arena->strings++;
+    /* the index stays at most half full; beyond that, no more dedup */
+    if (entry && (arena->indexed < ((arena->index_mask + 1) / 2))) {
+        *entry = (uint32_t)offset + 1;
+        arena->indexed++;
+    }
+
+    return string_arena_record(arena, offset);
+}
+
+/**
+ * @brief Intern a string
+ * @param arena - the arena
+ * @param string - the terminated string
+ * @return the string in the arena, which may be one added before, or
+ *  NULL if the string is NULL or the arena is full
+ */
+const char *string_arena_add(STRING_ARENA *arena, const char *string)
+{
+    if (!string) {
+        return NULL;
+    }
+
+    return string_arena_add_length(arena, string, strlen(string));
+}
+
+/**
+ * @brief Octets of the arena in use
+ * @param arena - the arena
+ * @return octets used by the string records
+ */
+size_t string_arena_used(const STRING_ARENA *arena)
+{
+    return arena ? arena->used : 0;
+}
+
+/**
+ * @brief Octets of the arena still free
+ * @param arena - the arena
+ * @return octets that are free
+ */
+size_t string_arena_free(const STRING_ARENA *arena)
+{
+    return arena ? (arena->size - arena->used) : 0;
+}
+
+/**
+ * @brief Determine if a string is held by the arena
+ * @param arena - the arena
+ * @param string - the string
+ * @return true if the string points into the used part of the arena;
+ *  pointers into the arena are assumed to be ones it handed out
+ */
+bool string_arena_contains(const STRING_ARENA *arena, const char *string)
+{
+    if (!arena || !arena->data || !string) {
+        return false;
+    }
+
+    return (string >= &arena->data[STRING_ARENA_PREFIX]) &&
+        (string < &arena->data[arena->used]);
+}
+
+/**
+ * @brief The length of a string held by the arena, without strlen()
+ * @param arena - the arena
+ * @param string - a string from string_arena_add()
+ * @return number of characters, or 0 if the arena does not hold it
+ */
+size_t string_arena_length(const STRING_ARENA *arena, const char *string)
+{
+    if (!string_arena_contains(arena, string)) {
+        return 0;
+    }
+
+    return string_arena_record_length(string);
+}
+
+/**
+ * @brief Encode a string held by the arena as an application tagged
+ *  CharacterString, with one copy of its pre-encoded octets
+ * @param arena - the arena, or NULL
+ * @param string - a string from string_arena_add()
+ * @param apdu - where to encode, or NULL to get the length
+ * @return number of octets encoded, or 0 if the arena does not hold the
+ *  string, and the caller encodes it the usual way
+ */
+int string_arena_encode(
+    const STRING_ARENA *arena, const char *string, uint8_t *apdu)
+{
+    uint8_t header_len;
+    size_t length;
+
+    if (!string_arena_contains(arena, string)) {
+        return 0;
+    }
+    length = string_arena_record_length(string);
+    if (length > STRING_ARENA_ENCODE_MAX) {
+        return 0;
+    }
+    header_len = (uint8_t)string[-STRING_ARENA_PREFIX];
+    if (apdu) {
+        memcpy(apdu, string - header_len, header_len + length);
+    }
+
+    return (int)(header_len + length);
+}
+
+/**
+ * @brief Encode a string as an application tagged CharacterString: with
+ *  one copy if the shared arena holds it, else the usual way
+ * @param apdu - where to encode, or NULL to get the length
+ * @param string - the string, or NULL for an empty string
+ * @return number of octets encoded
+ */
+int string_arena_encode_ansi(uint8_t *apdu, const char *string)
+{
+    BACNET_CHARACTER_STRING char_string;
+    int len;
+
+    len = string_arena_encode(String_Arena_Shared, string, apdu);
+    if (len == 0) {
+        characterstring_init_ansi(&char_string, string);
+        len = encode_application_character_string(apdu, &char_string);
+    }
+
+    return len;
+}
+
+/**
+ * @brief Set the arena that holds the strings of the objects
+ * @param arena - the arena, or NULL for none
+ */
+void string_arena_shared_set(STRING_ARENA *arena)
+{
+    String_Arena_Shared = arena;
+}
+
+/**
+ * @brief The arena that holds the strings of the objects
+ * @return the arena, or NULL if there is none
+ */
+STRING_ARENA *string_arena_shared(void)
+{
+    return String_Arena_Shared;
+}
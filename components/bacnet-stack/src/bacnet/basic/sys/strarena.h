@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @brief API for a read-mostly arena of interned strings, sized once,
+ *  that holds the names, descriptions and state texts of the objects in
+ *  this device, each with its BACnet CharacterString encoding.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_SYS_STRARENA_H
+#define BACNET_SYS_STRARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+
+/* application tag, extended length (3) and character set of a string */
+#define STRING_ARENA_HEADER_MAX 5
+/* octets stored in front of the characters of each string */
+#define STRING_ARENA_PREFIX (1 + STRING_ARENA_HEADER_MAX)
+/* longest string: the CharacterString length must fit in 16 bits */
+#define STRING_ARENA_LENGTH_MAX 65534
+
+/**
+ * @brief The arena: one block of memory, filled from the front, and an
+ *  optional hash index of the strings in it, so that a string added
+ *  twice is stored once.  Strings are never freed one by one.
+ */
+typedef struct string_arena {
+    char *data;
+    size_t size;
+    size_t used;
+    /* offset + 1 of a string record, or 0 for an empty slot */
+    uint32_t *index;
+    uint32_t index_mask;
+    unsigned indexed;
+    unsigned strings;
+    unsigned duplicates;
+} STRING_ARENA;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+void string_arena_init(STRING_ARENA *arena, char *data, size_t size);
+
+BACNET_STACK_EXPORT
+size_t string_arena_index_size(unsigned strings);
+
+BACNET_STACK_EXPORT
+void string_arena_index_set(STRING_ARENA *arena, void *index, size_t size);
+
+BACNET_STACK_EXPORT
+size_t string_arena_need(const char *string);
+
+BACNET_STACK_EXPORT
+size_t string_arena_need_length(size_t length);
+
+BACNET_STACK_EXPORT
+const char *string_arena_add(STRING_ARENA *arena, const char *string);
+
+BACNET_STACK_EXPORT
+const char *
+string_arena_add_length(STRING_ARENA *arena, const char *string, size_t length);
+
+BACNET_STACK_EXPORT
+size_t string_arena_used(const STRING_ARENA *arena);
+
+BACNET_STACK_EXPORT
+size_t string_arena_free(const STRING_ARENA *arena);
+
+BACNET_STACK_EXPORT
+bool string_arena_contains(const STRING_ARENA *arena, const char *string);
+
+BACNET_STACK_EXPORT
+size_t string_arena_length(const STRING_ARENA *arena, const char *string);
+
+BACNET_STACK_EXPORT
+int string_arena_encode(
+    const STRING_ARENA *arena, const char *string, uint8_t *apdu);
+
+BACNET_STACK_EXPORT
+int string_arena_encode_ansi(uint8_t *apdu, const char *string);
+
+BACNET_STACK_EXPORT
+void string_arena_shared_set(STRING_ARENA *arena);
+
+BACNET_STACK_EXPORT
+STRING_ARENA *string_arena_shared(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -9,9 +9,11 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 /* BACnet Stack defines - first */
 #include "bacnet/bacdef.h"
 /* BACnet Stack API */
+#include "bacnet/abort.h"
 #include "bacnet/apdu.h"
 #include "bacnet/bacaddr.h"
 #include "bacnet/bacdcode.h"
@@ -23,7 +25,9 @@
 
 /** @file tsm.c  BACnet Transaction State Machine operations  */
 /* FIXME: modify basic service handlers to use TSM rather than this buffer! */
+#if !defined(BACDL_MULTIPLE)
 uint8_t Handler_Transmit_Buffer[MAX_PDU];
+#endif
 
 #if (MAX_TSM_TRANSACTIONS)
 /* Really only needed for segmented messages */
@@ -31,12 +35,47 @@ uint8_t Handler_Transmit_Buffer[MAX_PDU];
 /* If we are only a server and only initiate broadcasts, */
 /* then we don't need a TSM layer. */
 
-/* FIXME: not coded for segmentation */
+/* segmented messages are kept apart from the transactions - see
+   tsm_segmented_response_buffer() and tsm_segment_received() */
 
 /* declare space for the TSM transactions, and set it up in the init. */
 /* table rules: an Invoke ID = 0 is an unused spot in the table */
 static BACNET_TSM_DATA TSM_List[MAX_TSM_TRANSACTIONS];
 
+/* A transaction is found by its invoke ID with an index, and a free spot
+   is taken from a list, so neither walks the table.  The index and the
+   links between spots are the index of a spot plus one, so that zero,
+   which is how the tables start, is no spot. */
+#if (MAX_TSM_TRANSACTIONS > 255)
+#error "MAX_TSM_TRANSACTIONS must be 255 or less"
+#endif
+static uint8_t TSM_Invoke_Index[256];
+/* spots that were used and are free again, linked through Next */
+static uint8_t TSM_Free_List;
+/* spots from this one up have never been used */
+static uint8_t TSM_Used;
+/* spots with an invoke ID */
+static uint8_t TSM_Active;
+
+/* The request timers are kept in a hierarchical timer wheel: a level of
+   64 slots of one millisecond, then one of 64 slots of 64 milliseconds,
+   then one of 64 slots of 4096 milliseconds, which covers the longest APDU
+   timeout.  A timer goes in the slot of its expiry time in the lowest
+   level that reaches it, and moves down a level when the clock gets to
+   the start of its slot.  Each millisecond looks at one slot, so the cost
+   of the timers follows the transactions that have one running, not the
+   size of the table. */
+#define TSM_WHEEL_BITS 6
+#define TSM_WHEEL_SLOTS (1U << TSM_WHEEL_BITS)
+#define TSM_WHEEL_MASK (TSM_WHEEL_SLOTS - 1U)
+#define TSM_WHEEL_LEVELS 3
+static uint8_t TSM_Wheel[TSM_WHEEL_LEVELS * TSM_WHEEL_SLOTS];
+/* the clock of the wheel, in milliseconds */
+static uint32_t TSM_Clock;
+/* the timers that are running, and those in the lowest level */
+static uint8_t TSM_Timer_Count;
+static uint8_t TSM_Timer_Near_Count;
+
 /* invoke ID for incrementing between subsequent calls. */
 static uint8_t Current_Invoke_ID = 1;
 
@@ -57,63 +96,124 @@ void tsm_set_timeout_handler(tsm_timeout_function pFunction)
  */
 static uint8_t tsm_find_invokeID_index(uint8_t invokeID)
 {
-    unsigned i = 0; /* counter */
     uint8_t index = MAX_TSM_TRANSACTIONS; /* return value */
 
-    const BACNET_TSM_DATA *plist = TSM_List;
-
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if (plist->InvokeID == invokeID) {
-            index = (uint8_t)i;
-            break;
-        }
+    if (invokeID && TSM_Invoke_Index[invokeID]) {
+        index = TSM_Invoke_Index[invokeID] - 1;
     }
 
     return index;
 }
 
-/** Find the first free index in the TSM table.
+/** Take a free spot in the TSM table.
  *
- * @return Index of the id or MAX_TSM_TRANSACTIONS
- *         if no entry is free.
+ * @return Index of the spot or MAX_TSM_TRANSACTIONS
+ *         if no spot is free.
  */
-static uint8_t tsm_find_first_free_index(void)
+static uint8_t tsm_free_list_take(void)
 {
-    unsigned i = 0; /* counter */
     uint8_t index = MAX_TSM_TRANSACTIONS; /* return value */
 
-    const BACNET_TSM_DATA *plist = TSM_List;
-
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if (plist->InvokeID == 0) {
-            index = (uint8_t)i;
-            break;
-        }
+    if (TSM_Free_List) {
+        index = TSM_Free_List - 1;
+        TSM_Free_List = TSM_List[index].Next;
+        TSM_List[index].Next = 0;
+    } else if (TSM_Used < MAX_TSM_TRANSACTIONS) {
+        index = TSM_Used;
+        TSM_Used++;
+    }
+    if (index < MAX_TSM_TRANSACTIONS) {
+        TSM_Active++;
     }
 
     return index;
 }
 
-/** Check if space for transactions is available.
+/** Give a spot back to the free list.
  *
- * @return true/false
+ * @param index  Index of the spot
  */
-bool tsm_transaction_available(void)
+static void tsm_free_list_put(uint8_t index)
 {
-    bool status = false; /* return value */
-    unsigned i = 0; /* counter */
+    TSM_List[index].Next = TSM_Free_List;
+    TSM_Free_List = index + 1;
+    TSM_Active--;
+}
 
-    const BACNET_TSM_DATA *plist = TSM_List;
+/* Put a running timer into the slot of the wheel for its expiry time */
+static void tsm_timer_insert(uint8_t index)
+{
+    BACNET_TSM_DATA *plist = &TSM_List[index];
+    uint32_t expires = plist->RequestExpires;
+    unsigned level = 0;
+    unsigned slot;
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if (plist->InvokeID == 0) {
-            /* one is available! */
-            status = true;
-            break;
-        }
+    while ((level < (TSM_WHEEL_LEVELS - 1U)) &&
+           (((expires >> (level * TSM_WHEEL_BITS)) -
+             (TSM_Clock >> (level * TSM_WHEEL_BITS))) >= TSM_WHEEL_SLOTS)) {
+        level++;
     }
+    slot = (level * TSM_WHEEL_SLOTS) +
+        ((expires >> (level * TSM_WHEEL_BITS)) & TSM_WHEEL_MASK);
+    plist->Slot = (uint8_t)(slot + 1U);
+    plist->Prev = 0;
+    plist->Next = TSM_Wheel[slot];
+    if (plist->Next) {
+        TSM_List[plist->Next - 1].Prev = index + 1;
+    }
+    TSM_Wheel[slot] = index + 1;
+    TSM_Timer_Count++;
+    if (level == 0) {
+        TSM_Timer_Near_Count++;
+    }
+}
 
-    return status;
+/* Take a timer out of the wheel */
+static void tsm_timer_stop(uint8_t index)
+{
+    BACNET_TSM_DATA *plist = &TSM_List[index];
+    unsigned slot;
+
+    if (!plist->Slot) {
+        return;
+    }
+    slot = plist->Slot - 1U;
+    if (plist->Prev) {
+        TSM_List[plist->Prev - 1].Next = plist->Next;
+    } else {
+        TSM_Wheel[slot] = plist->Next;
+    }
+    if (plist->Next) {
+        TSM_List[plist->Next - 1].Prev = plist->Prev;
+    }
+    plist->Slot = 0;
+    plist->Next = 0;
+    plist->Prev = 0;
+    TSM_Timer_Count--;
+    if (slot < TSM_WHEEL_SLOTS) {
+        TSM_Timer_Near_Count--;
+    }
+}
+
+/* (Re)start the request timer of a transaction */
+static void tsm_timer_start(uint8_t index, uint16_t milliseconds)
+{
+    tsm_timer_stop(index);
+    if (milliseconds == 0) {
+        /* expires on the next tick of the clock */
+        milliseconds = 1;
+    }
+    TSM_List[index].RequestExpires = TSM_Clock + milliseconds;
+    tsm_timer_insert(index);
+}
+
+/** Check if space for transactions is available.
+ *
+ * @return true/false
+ */
+bool tsm_transaction_available(void)
+{
+    return TSM_Active < MAX_TSM_TRANSACTIONS;
 }
 
 /** Return the count of idle transaction.
@@ -122,19 +222,7 @@ bool tsm_transaction_available(void)
  */
 uint8_t tsm_transaction_idle_count(void)
 {
-    uint8_t count = 0; /* return value */
-    unsigned i = 0; /* counter */
-
-    const BACNET_TSM_DATA *plist = TSM_List;
-
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if ((plist->InvokeID == 0) && (plist->state == TSM_STATE_IDLE)) {
-            /* one is available! */
-            count++;
-        }
-    }
-
-    return count;
+    return (uint8_t)(MAX_TSM_TRANSACTIONS - TSM_Active);
 }
 
 /**
@@ -160,56 +248,38 @@ uint8_t tsm_next_free_invokeID(void)
 {
     uint8_t index = 0;
     uint8_t invokeID = 0;
-    bool found = false;
     BACNET_TSM_DATA *plist = NULL;
 
-    /* Is there even space available? */
-    if (tsm_transaction_available()) {
-        while (!found) {
-            index = tsm_find_invokeID_index(Current_Invoke_ID);
-            if (index == MAX_TSM_TRANSACTIONS) {
-                /* Not found, so this invokeID is not used */
-                found = true;
-                /* set this id into the table */
-                index = tsm_find_first_free_index();
-                if (index != MAX_TSM_TRANSACTIONS) {
-                    plist = &TSM_List[index];
-                    plist->InvokeID = invokeID = Current_Invoke_ID;
-                    plist->state = TSM_STATE_IDLE;
-                    plist->RequestTimer = apdu_timeout();
-                    /* update for the next call or check */
-                    Current_Invoke_ID++;
-                    /* skip zero - we treat that internally as invalid or no
-                     * free */
-                    if (Current_Invoke_ID == 0) {
-                        Current_Invoke_ID = 1;
-                    }
-                }
-            } else {
-                /* found! This invokeID is already used */
-                /* try next one */
-                Current_Invoke_ID++;
-                /* skip zero - we treat that internally as invalid or no free */
-                if (Current_Invoke_ID == 0) {
-                    Current_Invoke_ID = 1;
-                }
+    index = tsm_free_list_take();
+    if (index < MAX_TSM_TRANSACTIONS) {
+        /* skip the invokeIDs in use - with a free spot, fewer than 255
+           are in use, so one is not */
+        while (TSM_Invoke_Index[Current_Invoke_ID]) {
+            Current_Invoke_ID++;
+            /* skip zero - we treat that internally as invalid or no free */
+            if (Current_Invoke_ID == 0) {
+                Current_Invoke_ID = 1;
             }
         }
+        /* set this id into the table */
+        plist = &TSM_List[index];
+        plist->InvokeID = invokeID = Current_Invoke_ID;
+        plist->state = TSM_STATE_IDLE;
+        TSM_Invoke_Index[invokeID] = index + 1;
+        /* update for the next call or check */
+        Current_Invoke_ID++;
+        /* skip zero - we treat that internally as invalid or no free */
+        if (Current_Invoke_ID == 0) {
+            Current_Invoke_ID = 1;
+        }
     }
 
     return invokeID;
 }
 
-/** Set for an unsegmented transaction
- *  the state to await confirmation.
- *
- * @param invokeID  Invoke-ID
- * @param dest  Pointer to the BACnet destination address.
- * @param ndpu_data  Pointer to the NPDU structure.
- * @param apdu  Pointer to the received message.
- * @param apdu_len  Bytes valid in the received message.
- */
-void tsm_set_confirmed_unsegmented_transaction(
+/* Set an unsegmented transaction to await confirmation, and return it,
+   or NULL if the invoke ID is not in use */
+static BACNET_TSM_DATA *tsm_unsegmented_transaction_set(
     uint8_t invokeID,
     const BACNET_ADDRESS *dest,
     const BACNET_NPDU_DATA *ndpu_data,
@@ -218,7 +288,7 @@ void tsm_set_confirmed_unsegmented_transaction(
 {
     uint16_t j = 0;
     uint8_t index;
-    BACNET_TSM_DATA *plist;
+    BACNET_TSM_DATA *plist = NULL;
 
     if (invokeID && ndpu_data && apdu && (apdu_len > 0)) {
         index = tsm_find_invokeID_index(invokeID);
@@ -228,7 +298,7 @@ void tsm_set_confirmed_unsegmented_transaction(
             plist->state = TSM_STATE_AWAIT_CONFIRMATION;
             plist->RetryCount = 0;
             /* start the timer */
-            plist->RequestTimer = apdu_timeout();
+            tsm_timer_start(index, apdu_timeout());
             /* copy the data */
             for (j = 0; j < apdu_len; j++) {
                 plist->apdu[j] = apdu[j];
@@ -239,9 +309,69 @@ void tsm_set_confirmed_unsegmented_transaction(
         }
     }
 
-    return;
+    return plist;
 }
 
+/** Set for an unsegmented transaction
+ *  the state to await confirmation.
+ *  With multiple datalinks, the retries go out on the port bound to
+ *  the calling task.
+ *
+ * @param invokeID  Invoke-ID
+ * @param dest  Pointer to the BACnet destination address.
+ * @param ndpu_data  Pointer to the NPDU structure.
+ * @param apdu  Pointer to the received message.
+ * @param apdu_len  Bytes valid in the received message.
+ */
+void tsm_set_confirmed_unsegmented_transaction(
+    uint8_t invokeID,
+    const BACNET_ADDRESS *dest,
+    const BACNET_NPDU_DATA *ndpu_data,
+    const uint8_t *apdu,
+    uint16_t apdu_len)
+{
+    BACNET_TSM_DATA *plist;
+
+    plist = tsm_unsegmented_transaction_set(
+        invokeID, dest, ndpu_data, apdu, apdu_len);
+#if defined(BACDL_MULTIPLE)
+    if (plist) {
+        plist->port = datalink_port_bound();
+    }
+#else
+    (void)plist;
+#endif
+}
+
+#if defined(BACDL_MULTIPLE)
+/** Set for an unsegmented transaction
+ *  the state to await confirmation, with the port its retries go out on.
+ *
+ * @param port  the port, or NULL for datalink_send_pdu()
+ * @param invokeID  Invoke-ID
+ * @param dest  Pointer to the BACnet destination address.
+ * @param ndpu_data  Pointer to the NPDU structure.
+ * @param apdu  Pointer to the received message.
+ * @param apdu_len  Bytes valid in the received message.
+ */
+void tsm_port_set_confirmed_unsegmented_transaction(
+    DATALINK_PORT *port,
+    uint8_t invokeID,
+    const BACNET_ADDRESS *dest,
+    const BACNET_NPDU_DATA *ndpu_data,
+    const uint8_t *apdu,
+    uint16_t apdu_len)
+{
+    BACNET_TSM_DATA *plist;
+
+    plist = tsm_unsegmented_transaction_set(
+        invokeID, dest, ndpu_data, apdu, apdu_len);
+    if (plist) {
+        plist->port = port;
+    }
+}
+#endif
+
 /** Used to retrieve the transaction payload. Used
  *  if we wanted to find out what we sent (i.e. when
  *  we get an ack).
@@ -290,6 +420,77 @@ bool tsm_get_transaction_pdu(
     return found;
 }
 
+/* The request timer of a transaction expired: send the request again,
+   or give up on it after the last retry */
+static void tsm_timer_expired(uint8_t index)
+{
+    BACNET_TSM_DATA *plist = &TSM_List[index];
+    int bytes_sent = 0;
+
+    if (plist->state != TSM_STATE_AWAIT_CONFIRMATION) {
+        return;
+    }
+    if (plist->RetryCount < apdu_retries()) {
+        tsm_timer_start(index, apdu_timeout());
+        plist->RetryCount++;
+#if defined(BACDL_MULTIPLE)
+        /* on the port of the request, whatever task runs the timers */
+        bytes_sent = datalink_port_send_pdu(
+            plist->port, &plist->dest, &plist->npdu_data, &plist->apdu[0],
+            plist->apdu_len);
+#else
+        bytes_sent = datalink_send_pdu(
+            &plist->dest, &plist->npdu_data, &plist->apdu[0], plist->apdu_len);
+#endif
+        DEBUG_PRINTF(
+            "invoke-id[%u] Retry %u of %u after %ums\n", plist->InvokeID,
+            plist->RetryCount, apdu_retries(), apdu_timeout());
+        if (bytes_sent <= 0) {
+            debug_perror("invoke-id[%u] Failed to Send Retry");
+        }
+    } else {
+        /* note: the invoke id has not been cleared yet
+           and this indicates a failed message:
+           IDLE and a valid invoke id */
+        plist->state = TSM_STATE_IDLE;
+        if (plist->InvokeID != 0) {
+            if (Timeout_Function) {
+                Timeout_Function(plist->InvokeID);
+            }
+        }
+    }
+}
+
+/* Advance the clock of the wheel by one millisecond: move the timers of
+   the slots that start now down a level, then expire the timers of the
+   slot of the lowest level */
+static void tsm_timer_tick(void)
+{
+    unsigned level;
+    unsigned slot;
+    uint8_t index;
+
+    TSM_Clock++;
+    for (level = TSM_WHEEL_LEVELS - 1U; level > 0; level--) {
+        if (TSM_Clock & ((1UL << (level * TSM_WHEEL_BITS)) - 1UL)) {
+            continue;
+        }
+        slot = (level * TSM_WHEEL_SLOTS) +
+            ((TSM_Clock >> (level * TSM_WHEEL_BITS)) & TSM_WHEEL_MASK);
+        while (TSM_Wheel[slot]) {
+            index = TSM_Wheel[slot] - 1;
+            tsm_timer_stop(index);
+            tsm_timer_insert(index);
+        }
+    }
+    slot = TSM_Clock & TSM_WHEEL_MASK;
+    while (TSM_Wheel[slot]) {
+        index = TSM_Wheel[slot] - 1;
+        tsm_timer_stop(index);
+        tsm_timer_expired(index);
+    }
+}
+
 /** Called once a millisecond or slower.
  *  This function calls the handler for a
  *  timeout 'Timeout_Function', if necessary.
@@ -298,47 +499,28 @@ bool tsm_get_transaction_pdu(
  */
 void tsm_timer_milliseconds(uint16_t milliseconds)
 {
-    unsigned i = 0; /* counter */
-    int bytes_sent = 0;
-
-    BACNET_TSM_DATA *plist = &TSM_List[0];
+    uint16_t elapsed = milliseconds;
+    uint16_t skip;
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if (plist->state == TSM_STATE_AWAIT_CONFIRMATION) {
-            if (plist->RequestTimer > milliseconds) {
-                plist->RequestTimer -= milliseconds;
-            } else {
-                plist->RequestTimer = 0;
-            }
-            /* AWAIT_CONFIRMATION */
-            if (plist->RequestTimer == 0) {
-                if (plist->RetryCount < apdu_retries()) {
-                    plist->RequestTimer = apdu_timeout();
-                    plist->RetryCount++;
-                    bytes_sent = datalink_send_pdu(
-                        &plist->dest, &plist->npdu_data, &plist->apdu[0],
-                        plist->apdu_len);
-                    DEBUG_PRINTF(
-                        "invoke-id[%u] Retry %u of %u after %ums\n",
-                        plist->InvokeID, plist->RetryCount, apdu_retries(),
-                        plist->RequestTimer);
-                    if (bytes_sent <= 0) {
-                        debug_perror("invoke-id[%u] Failed to Send Retry");
-                    }
-                } else {
-                    /* note: the invoke id has not been cleared yet
-                       and this indicates a failed message:
-                       IDLE and a valid invoke id */
-                    plist->state = TSM_STATE_IDLE;
-                    if (plist->InvokeID != 0) {
-                        if (Timeout_Function) {
-                            Timeout_Function(plist->InvokeID);
-                        }
-                    }
-                }
+    while (elapsed > 0) {
+        if (TSM_Timer_Count == 0) {
+            TSM_Clock += elapsed;
+            break;
+        }
+        if (TSM_Timer_Near_Count == 0) {
+            /* nothing happens before the next slot of the second level */
+            skip = (uint16_t)(TSM_WHEEL_MASK - (TSM_Clock & TSM_WHEEL_MASK));
+            if (skip >= elapsed) {
+                TSM_Clock += elapsed;
+                break;
             }
+            TSM_Clock += skip;
+            elapsed -= skip;
         }
+        tsm_timer_tick();
+        elapsed--;
     }
+    tsm_segmented_timer_milliseconds(milliseconds);
 }
 
 /** Frees the invokeID and sets its state to IDLE
@@ -353,8 +535,11 @@ void tsm_free_invoke_id(uint8_t invokeID)
     index = tsm_find_invokeID_index(invokeID);
     if (index < MAX_TSM_TRANSACTIONS) {
         plist = &TSM_List[index];
+        tsm_timer_stop(index);
         plist->state = TSM_STATE_IDLE;
         plist->InvokeID = 0;
+        TSM_Invoke_Index[invokeID] = 0;
+        tsm_free_list_put(index);
     }
 }
 
@@ -399,4 +584,667 @@ bool tsm_invoke_id_failed(uint8_t invokeID)
 
     return status;
 }
+
+#if (MAX_SEGMENTED_TRANSACTIONS)
+/** The first segment of a segmented complex ACK stops the retries of the
+ *  request; a segmented ACK that is never completed fails the request.
+ *
+ * @param invokeID  Invoke-ID of the request
+ * @param failed  true if the segments stopped coming
+ */
+static void tsm_segmented_confirmation(uint8_t invokeID, bool failed)
+{
+    uint8_t index;
+    BACNET_TSM_DATA *plist;
+
+    index = tsm_find_invokeID_index(invokeID);
+    if (index < MAX_TSM_TRANSACTIONS) {
+        plist = &TSM_List[index];
+        /* the segment timers take over from the request timer */
+        tsm_timer_stop(index);
+        if (failed) {
+            plist->state = TSM_STATE_IDLE;
+            if (Timeout_Function) {
+                Timeout_Function(invokeID);
+            }
+        } else if (plist->state == TSM_STATE_AWAIT_CONFIRMATION) {
+            plist->state = TSM_STATE_SEGMENTED_CONFIRMATION;
+        }
+    }
+}
+#endif
+#endif
+
+#if (MAX_SEGMENTED_TRANSACTIONS)
+/* Segmented messages (clause 5.4).  A reply too long for the peer is
+   encoded whole into a buffer of the pool and sent as segments of the
+   peer's max-APDU, one window of segments per SegmentACK, the window being
+   the one the peer asks for.  The segments of a request or complex ACK
+   sent to us are put back together in a buffer of the pool and then
+   handled as one message.  The pool is a fixed number of buffers, so a
+   peer can not make us allocate memory. */
+
+/* octets in front of the service data: type, invoke ID and service
+   choice of a complex ACK, plus the sequence number and window size of a
+   segment */
+#define TSM_COMPLEX_ACK_HEADER 3
+#define TSM_SEGMENT_HEADER 5
+/* sequence numbers are not wrapped: a message has at most 255 segments */
+#define TSM_SEGMENTS_MAX 255
+
+typedef enum {
+    TSM_SEGMENTED_IDLE,
+    /* a buffer lent to a service handler for its reply */
+    TSM_SEGMENTED_RESERVED,
+    /* sending the segments of a reply */
+    TSM_SEGMENTED_RESPONSE,
+    /* receiving the segments of a request or complex ACK */
+    TSM_SEGMENTED_RECEIVE,
+    /* a whole message lent to its service handler */
+    TSM_SEGMENTED_RECEIVED
+} TSM_SEGMENTED_STATE;
+
+/* where the APDUs of a segmented transaction go */
+typedef struct tsm_segmented_peer {
+    BACNET_ADDRESS address;
+#if defined(BACDL_MULTIPLE)
+    DATALINK_PORT *port;
+#endif
+    uint8_t priority;
+    /* true if this device is the server of the transaction */
+    bool server;
+    uint8_t invoke_id;
+} TSM_SEGMENTED_PEER;
+
+typedef struct tsm_segmented_data {
+    TSM_SEGMENTED_STATE state;
+    TSM_SEGMENTED_PEER peer;
+    /* what the peer accepts, from its request */
+    uint16_t max_resp;
+    uint16_t max_segs;
+    /* the octets of service data in each segment, and the segments */
+    uint16_t segment_len;
+    uint16_t segment_count;
+    uint8_t initial_sequence_number;
+    uint8_t last_sequence_number;
+    uint8_t actual_window_size;
+    uint8_t retry_count;
+    uint16_t segment_timer;
+    /* a reply: the whole complex ACK; a message received: the service
+       data of its segments */
+    uint16_t apdu_len;
+    uint8_t apdu[MAX_SEGMENTED_APDU];
+} TSM_SEGMENTED_DATA;
+
+static TSM_SEGMENTED_DATA TSM_Segmented_List[MAX_SEGMENTED_TRANSACTIONS];
+
+/* Find the segmented transaction of a peer, in any state but idle */
+static TSM_SEGMENTED_DATA *
+tsm_segmented_find(const BACNET_ADDRESS *peer, uint8_t invoke_id, bool server)
+{
+    TSM_SEGMENTED_DATA *data = TSM_Segmented_List;
+    unsigned i;
+
+    for (i = 0; i < MAX_SEGMENTED_TRANSACTIONS; i++, data++) {
+        if ((data->state != TSM_SEGMENTED_IDLE) &&
+            (data->peer.invoke_id == invoke_id) &&
+            (data->peer.server == server) &&
+            bacnet_address_same(&data->peer.address, peer)) {
+            return data;
+        }
+    }
+
+    return NULL;
+}
+
+/* Find the segmented transaction that owns a buffer */
+static TSM_SEGMENTED_DATA *tsm_segmented_find_apdu(const uint8_t *apdu)
+{
+    TSM_SEGMENTED_DATA *data = TSM_Segmented_List;
+    unsigned i;
+
+    for (i = 0; i < MAX_SEGMENTED_TRANSACTIONS; i++, data++) {
+        if ((data->state != TSM_SEGMENTED_IDLE) && (apdu == data->apdu)) {
+            return data;
+        }
+    }
+
+    return NULL;
+}
+
+/* Address a transaction with a peer, on the port it came in on */
+static void tsm_segmented_peer_init(
+    TSM_SEGMENTED_PEER *peer,
+    const BACNET_ADDRESS *address,
+    uint8_t invoke_id,
+    bool server)
+{
+    bacnet_address_copy(&peer->address, address);
+#if defined(BACDL_MULTIPLE)
+    peer->port = datalink_port_bound();
+#endif
+    peer->priority = MESSAGE_PRIORITY_NORMAL;
+    peer->server = server;
+    peer->invoke_id = invoke_id;
+}
+
+/* Take a buffer from the pool for a transaction with a peer */
+static TSM_SEGMENTED_DATA *tsm_segmented_alloc(
+    const BACNET_ADDRESS *peer, uint8_t invoke_id, bool server)
+{
+    TSM_SEGMENTED_DATA *data = TSM_Segmented_List;
+    unsigned i;
+
+    for (i = 0; i < MAX_SEGMENTED_TRANSACTIONS; i++, data++) {
+        if (data->state == TSM_SEGMENTED_IDLE) {
+            tsm_segmented_peer_init(&data->peer, peer, invoke_id, server);
+            data->max_resp = MAX_APDU;
+            data->max_segs = 0;
+            data->segment_len = 0;
+            data->segment_count = 0;
+            data->initial_sequence_number = 0;
+            data->last_sequence_number = 0;
+            data->actual_window_size = 1;
+            data->retry_count = 0;
+            data->segment_timer = 0;
+            data->apdu_len = 0;
+            return data;
+        }
+    }
+
+    return NULL;
+}
+
+/* Send an APDU of a segmented transaction to its peer */
+static int tsm_segmented_send(
+    TSM_SEGMENTED_PEER *peer,
+    bool expecting_reply,
+    const uint8_t *header,
+    uint16_t header_len,
+    const uint8_t *apdu,
+    uint16_t apdu_len)
+{
+    BACNET_NPDU_DATA npdu_data;
+    BACNET_ADDRESS my_address;
+    uint8_t *pdu = &Handler_Transmit_Buffer[0];
+    int pdu_len;
+
+#if defined(BACDL_MULTIPLE)
+    datalink_port_get_my_address(peer->port, &my_address);
+#else
+    datalink_get_my_address(&my_address);
+#endif
+    npdu_encode_npdu_data(&npdu_data, expecting_reply, peer->priority);
+    pdu_len = npdu_encode_pdu(pdu, &peer->address, &my_address, &npdu_data);
+    if ((pdu_len <= 0) || ((pdu_len + header_len + apdu_len) > MAX_PDU)) {
+        return 0;
+    }
+    memcpy(&pdu[pdu_len], header, header_len);
+    pdu_len += header_len;
+    if (apdu_len) {
+        memcpy(&pdu[pdu_len], apdu, apdu_len);
+        pdu_len += apdu_len;
+    }
+#if defined(BACDL_MULTIPLE)
+    return datalink_port_send_pdu(
+        peer->port, &peer->address, &npdu_data, pdu, (unsigned)pdu_len);
+#else
+    return datalink_send_pdu(
+        &peer->address, &npdu_data, pdu, (unsigned)pdu_len);
+#endif
+}
+
+/* Send an Abort to the peer of a segmented transaction */
+static void tsm_segmented_send_abort(TSM_SEGMENTED_PEER *peer, uint8_t reason)
+{
+    uint8_t header[3];
+    int len;
+
+    len = abort_encode_apdu(header, peer->invoke_id, reason, peer->server);
+    (void)tsm_segmented_send(peer, false, header, (uint16_t)len, NULL, 0);
+}
+
+/* Abort a segmented transaction and give back its buffer */
+static void tsm_segmented_end(TSM_SEGMENTED_DATA *data, uint8_t reason)
+{
+    tsm_segmented_send_abort(&data->peer, reason);
+    data->state = TSM_SEGMENTED_IDLE;
+}
+
+/* Send a SegmentACK, or a negative one, for the segments received */
+static void tsm_segmented_send_ack(
+    TSM_SEGMENTED_DATA *data, bool negative, uint8_t sequence_number)
+{
+    uint8_t header[4];
+
+    header[0] = PDU_TYPE_SEGMENT_ACK;
+    if (negative) {
+        header[0] |= BIT(1);
+    }
+    if (data->peer.server) {
+        header[0] |= BIT(0);
+    }
+    header[1] = data->peer.invoke_id;
+    header[2] = sequence_number;
+    header[3] = data->actual_window_size;
+    (void)tsm_segmented_send(
+        &data->peer, false, header, sizeof(header), NULL, 0);
+}
+
+/* Send one segment of a reply */
+static int tsm_segmented_send_segment(
+    TSM_SEGMENTED_DATA *data, uint8_t sequence_number)
+{
+    uint8_t header[TSM_SEGMENT_HEADER];
+    uint16_t offset;
+    uint16_t len;
+
+    offset = (uint16_t)(TSM_COMPLEX_ACK_HEADER +
+                        (sequence_number * data->segment_len));
+    len = data->apdu_len - offset;
+    if (len > data->segment_len) {
+        len = data->segment_len;
+    }
+    header[0] = PDU_TYPE_COMPLEX_ACK | BIT(3);
+    if ((sequence_number + 1U) < data->segment_count) {
+        header[0] |= BIT(2);
+    }
+    header[1] = data->peer.invoke_id;
+    header[2] = sequence_number;
+    header[3] = MAX_SEGMENT_WINDOW_SIZE;
+    /* service choice */
+    header[4] = data->apdu[2];
+    /* a segment of a complex ACK expects a SegmentACK (clause 6.2.2) */
+    return tsm_segmented_send(
+        &data->peer, true, header, sizeof(header), &data->apdu[offset], len);
+}
+
+/* Send the window of segments that starts with a sequence number */
+static void
+tsm_segmented_fill_window(TSM_SEGMENTED_DATA *data, uint8_t sequence_number)
+{
+    unsigned i;
+
+    for (i = 0; (i < data->actual_window_size) &&
+         ((sequence_number + i) < data->segment_count);
+         i++) {
+        if (tsm_segmented_send_segment(data, (uint8_t)(sequence_number + i)) <=
+            0) {
+            debug_perror("Failed to Send Segment");
+            break;
+        }
+    }
+    data->segment_timer = apdu_segment_timeout();
+}
+
+/** Lend a buffer of the segmented message pool to a service handler for
+ *  a reply that may be longer than the requester accepts in one APDU.
+ *  The reply is sent with tsm_segmented_response_send(), which gives the
+ *  buffer back.
+ *
+ * @param dest  The requester, to which the reply is sent.
+ * @param service_data  The header of the request.
+ * @param apdu_size  Takes the size of the buffer.
+ *
+ * @return The buffer, or NULL if the requester does not accept a
+ *         segmented reply or there is no free buffer.
+ */
+uint8_t *tsm_segmented_response_buffer(
+    const BACNET_ADDRESS *dest,
+    const BACNET_CONFIRMED_SERVICE_DATA *service_data,
+    uint16_t *apdu_size)
+{
+    TSM_SEGMENTED_DATA *data;
+
+    if (!dest || !service_data || !service_data->segmented_response_accepted) {
+        return NULL;
+    }
+    data = tsm_segmented_alloc(dest, service_data->invoke_id, true);
+    if (!data) {
+        return NULL;
+    }
+    data->state = TSM_SEGMENTED_RESERVED;
+    data->peer.priority = service_data->priority;
+    if ((service_data->max_resp > 0) && (service_data->max_resp < MAX_APDU)) {
+        data->max_resp = (uint16_t)service_data->max_resp;
+    }
+    data->max_segs = (uint16_t)service_data->max_segs;
+    if (apdu_size) {
+        *apdu_size = sizeof(data->apdu);
+    }
+
+    return data->apdu;
+}
+
+/** Send a reply encoded in a buffer from tsm_segmented_response_buffer():
+ *  in one APDU if it fits, else in segments, the first one now and the
+ *  others as the requester acknowledges them.
+ *
+ * @param apdu  The buffer, with the whole reply.
+ * @param apdu_len  The length of the reply.
+ *
+ * @return The number of bytes sent of the first APDU, or 0 on failure.
+ */
+int tsm_segmented_response_send(uint8_t *apdu, uint16_t apdu_len)
+{
+    TSM_SEGMENTED_DATA *data;
+    uint16_t segment_len;
+    unsigned segment_count;
+    int bytes_sent;
+
+    data = tsm_segmented_find_apdu(apdu);
+    if (!data || (data->state != TSM_SEGMENTED_RESERVED)) {
+        return 0;
+    }
+    if ((apdu_len <= data->max_resp) ||
+        ((apdu[0] & 0xF0) != PDU_TYPE_COMPLEX_ACK)) {
+        bytes_sent =
+            tsm_segmented_send(&data->peer, false, apdu, apdu_len, NULL, 0);
+        data->state = TSM_SEGMENTED_IDLE;
+        return bytes_sent;
+    }
+    segment_len = data->max_resp - TSM_SEGMENT_HEADER;
+    segment_count = (apdu_len - TSM_COMPLEX_ACK_HEADER + segment_len - 1U) /
+        segment_len;
+    if ((segment_count > TSM_SEGMENTS_MAX) ||
+        ((data->max_segs > 0) && (segment_count > data->max_segs))) {
+        /* more segments than the requester takes */
+        debug_printf(
+            "invoke-id[%u] Reply of %u segments is too long\n",
+            data->peer.invoke_id, segment_count);
+        tsm_segmented_end(data, ABORT_REASON_BUFFER_OVERFLOW);
+        return 0;
+    }
+    data->apdu_len = apdu_len;
+    data->segment_len = segment_len;
+    data->segment_count = (uint16_t)segment_count;
+    data->state = TSM_SEGMENTED_RESPONSE;
+    /* the first segment goes alone, and the SegmentACK of it gives the
+       window size of the requester */
+    data->initial_sequence_number = 0;
+    data->actual_window_size = 1;
+    data->retry_count = 0;
+    data->segment_timer = apdu_segment_timeout();
+    bytes_sent = tsm_segmented_send_segment(data, 0);
+    if (bytes_sent <= 0) {
+        data->state = TSM_SEGMENTED_IDLE;
+    }
+
+    return bytes_sent;
+}
+
+/** Determine if a confirmed request is a repeat of one whose segmented
+ *  reply is being sent, which is ignored.
+ *
+ * @param src  The requester.
+ * @param invoke_id  The invoke ID of the request.
+ *
+ * @return true if the reply to the request is being sent.
+ */
+bool tsm_segmented_response_pending(
+    const BACNET_ADDRESS *src, uint8_t invoke_id)
+{
+    TSM_SEGMENTED_DATA *data;
+
+    data = tsm_segmented_find(src, invoke_id, true);
+
+    return data && (data->state == TSM_SEGMENTED_RESPONSE);
+}
+
+/** Handle a SegmentACK-PDU for a reply being sent in segments.
+ *
+ * @param src  The source of the SegmentACK.
+ * @param apdu  The SegmentACK-PDU.
+ * @param apdu_len  The length of the SegmentACK-PDU.
+ */
+void tsm_segment_ack_handler(
+    const BACNET_ADDRESS *src, const uint8_t *apdu, uint16_t apdu_len)
+{
+    TSM_SEGMENTED_DATA *data;
+    uint8_t sequence_number;
+    uint8_t window_size;
+
+    if (!src || !apdu || (apdu_len < 4)) {
+        return;
+    }
+    if (apdu[0] & BIT(0)) {
+        /* from a server: we do not send segmented requests */
+        return;
+    }
+    data = tsm_segmented_find(src, apdu[1], true);
+    if (!data || (data->state != TSM_SEGMENTED_RESPONSE)) {
+        return;
+    }
+    sequence_number = apdu[2];
+    window_size = apdu[3];
+    if ((sequence_number < data->initial_sequence_number) ||
+        (sequence_number >=
+         (data->initial_sequence_number + data->actual_window_size))) {
+        /* a duplicate of an earlier SegmentACK */
+        data->segment_timer = apdu_segment_timeout();
+        return;
+    }
+    if ((sequence_number + 1U) >= data->segment_count) {
+        /* the last segment was received: done */
+        data->state = TSM_SEGMENTED_IDLE;
+        return;
+    }
+    /* a SegmentACK, or a negative one, with the sequence number of the
+       last segment received in order: send the next window from there */
+    if ((window_size == 0) || (window_size > 127)) {
+        tsm_segmented_end(data, ABORT_REASON_WINDOW_SIZE_OUT_OF_RANGE);
+        return;
+    }
+    data->initial_sequence_number = sequence_number + 1;
+    data->actual_window_size = window_size;
+    data->retry_count = 0;
+    tsm_segmented_fill_window(data, data->initial_sequence_number);
+}
+
+/** Handle one segment of a confirmed request or a complex ACK, putting
+ *  it together with the segments before it.
+ *
+ * @param src  The source of the segment.
+ * @param server  true for a segment of a request to this device, false for
+ *                a segment of a complex ACK to this device.
+ * @param invoke_id  The invoke ID of the segment.
+ * @param sequence_number  The sequence number of the segment.
+ * @param proposed_window_size  The window size proposed by the sender.
+ * @param more_follows  true if more segments follow this one.
+ * @param service_request  In: the service data of the segment.
+ *                         Out: the service data of the whole message.
+ * @param service_request_len  In: the length of the segment service data.
+ *                             Out: the length of the whole message.
+ *
+ * @return true if the message is whole, and is to be handled and then
+ *         given back with tsm_segmented_release().
+ */
+bool tsm_segment_received(
+    const BACNET_ADDRESS *src,
+    bool server,
+    uint8_t invoke_id,
+    uint8_t sequence_number,
+    uint8_t proposed_window_size,
+    bool more_follows,
+    uint8_t **service_request,
+    uint16_t *service_request_len)
+{
+    TSM_SEGMENTED_DATA *data;
+    uint16_t len;
+
+    if (!src || !service_request || !service_request_len) {
+        return false;
+    }
+    len = *service_request_len;
+    data = tsm_segmented_find(src, invoke_id, server);
+    if (data && (data->state != TSM_SEGMENTED_RECEIVE)) {
+        /* a reply to this request is being sent */
+        return false;
+    }
+    if (sequence_number == 0) {
+        if (!data) {
+            data = tsm_segmented_alloc(src, invoke_id, server);
+            if (!data) {
+                /* no buffer: the sender is told with an Abort */
+                TSM_SEGMENTED_PEER peer;
+
+                tsm_segmented_peer_init(&peer, src, invoke_id, server);
+                tsm_segmented_send_abort(
+                    &peer, ABORT_REASON_OUT_OF_RESOURCES);
+                return false;
+            }
+        }
+        /* the first segment, or the sender starting over */
+        data->state = TSM_SEGMENTED_RECEIVE;
+        data->apdu_len = 0;
+        data->initial_sequence_number = 0;
+        data->actual_window_size = proposed_window_size;
+        if (data->actual_window_size > MAX_SEGMENT_WINDOW_SIZE) {
+            data->actual_window_size = MAX_SEGMENT_WINDOW_SIZE;
+        }
+        if (data->actual_window_size == 0) {
+            data->actual_window_size = 1;
+        }
+#if (MAX_TSM_TRANSACTIONS)
+        if (!server) {
+            tsm_segmented_confirmation(invoke_id, false);
+        }
+#endif
+    } else if (!data) {
+        /* not a transaction we know about */
+        return false;
+    } else if (sequence_number != (data->last_sequence_number + 1U)) {
+        /* lost or out of order: ask for the segments after the last one
+           received in order */
+        data->initial_sequence_number = data->last_sequence_number;
+        tsm_segmented_send_ack(data, true, data->last_sequence_number);
+        data->segment_timer = apdu_segment_timeout();
+        return false;
+    }
+    if ((sizeof(data->apdu) - data->apdu_len) < len) {
+        tsm_segmented_end(data, ABORT_REASON_BUFFER_OVERFLOW);
+        return false;
+    }
+    if (len) {
+        memcpy(&data->apdu[data->apdu_len], *service_request, len);
+        data->apdu_len += len;
+    }
+    data->last_sequence_number = sequence_number;
+    data->retry_count = 0;
+    data->segment_timer = apdu_segment_timeout();
+    if (!more_follows) {
+        tsm_segmented_send_ack(data, false, sequence_number);
+        data->state = TSM_SEGMENTED_RECEIVED;
+        *service_request = data->apdu;
+        *service_request_len = data->apdu_len;
+        return true;
+    }
+    if ((sequence_number == 0) ||
+        (sequence_number ==
+         (data->initial_sequence_number + data->actual_window_size))) {
+        /* the first segment, or the last of a window */
+        data->initial_sequence_number = sequence_number;
+        tsm_segmented_send_ack(data, false, sequence_number);
+    } else if (sequence_number == TSM_SEGMENTS_MAX) {
+        tsm_segmented_end(data, ABORT_REASON_BUFFER_OVERFLOW);
+    }
+
+    return false;
+}
+
+/** Give back a buffer of the segmented message pool: a whole message
+ *  from tsm_segment_received() once it has been handled.
+ *
+ * @param apdu  The buffer.
+ */
+void tsm_segmented_release(const uint8_t *apdu)
+{
+    TSM_SEGMENTED_DATA *data;
+
+    data = tsm_segmented_find_apdu(apdu);
+    if (data && (data->state == TSM_SEGMENTED_RECEIVED)) {
+        data->state = TSM_SEGMENTED_IDLE;
+    }
+}
+
+/** End a segmented transaction that the peer aborted.
+ *
+ * @param src  The source of the Abort.
+ * @param invoke_id  The invoke ID of the Abort.
+ * @param server  true if this device is the server of the transaction.
+ */
+void tsm_segmented_abort(
+    const BACNET_ADDRESS *src, uint8_t invoke_id, bool server)
+{
+    TSM_SEGMENTED_DATA *data;
+
+    data = tsm_segmented_find(src, invoke_id, server);
+    if (data && (data->state != TSM_SEGMENTED_RECEIVED)) {
+        data->state = TSM_SEGMENTED_IDLE;
+    }
+}
+
+/** Called once a millisecond or slower: sends the window of segments
+ *  again when the SegmentACK for it does not come, and gives up on the
+ *  segments of a message that stop coming.
+ *
+ * @param milliseconds - Count of milliseconds passed, since the last call.
+ */
+void tsm_segmented_timer_milliseconds(uint16_t milliseconds)
+{
+    TSM_SEGMENTED_DATA *data = TSM_Segmented_List;
+    unsigned i;
+
+    for (i = 0; i < MAX_SEGMENTED_TRANSACTIONS; i++, data++) {
+        if ((data->state != TSM_SEGMENTED_RESPONSE) &&
+            (data->state != TSM_SEGMENTED_RECEIVE)) {
+            continue;
+        }
+        if (data->segment_timer > milliseconds) {
+            data->segment_timer -= milliseconds;
+            continue;
+        }
+        data->segment_timer = 0;
+        if (data->state == TSM_SEGMENTED_RECEIVE) {
+            /* the sender waits a segment timeout per retry */
+            if (data->retry_count < apdu_retries()) {
+                data->retry_count++;
+                data->segment_timer = apdu_segment_timeout();
+            } else {
+                data->state = TSM_SEGMENTED_IDLE;
+#if (MAX_TSM_TRANSACTIONS)
+                if (!data->peer.server) {
+                    tsm_segmented_confirmation(data->peer.invoke_id, true);
+                }
+#endif
+            }
+        } else if (data->retry_count < apdu_retries()) {
+            data->retry_count++;
+            DEBUG_PRINTF(
+                "invoke-id[%u] Segment Retry %u of %u\n", data->peer.invoke_id,
+                data->retry_count, apdu_retries());
+            tsm_segmented_fill_window(data, data->initial_sequence_number);
+        } else {
+            data->state = TSM_SEGMENTED_IDLE;
+        }
+    }
+}
+
+/** Return the count of idle buffers of the segmented message pool.
+ *
+ * @return Count of idle buffers.
+ */
+uint8_t tsm_segmented_idle_count(void)
+{
+    uint8_t count = 0;
+    unsigned i;
+
+    for (i = 0; i < MAX_SEGMENTED_TRANSACTIONS; i++) {
+        if (TSM_Segmented_List[i].state == TSM_SEGMENTED_IDLE) {
+            count++;
+        }
+    }
+
+    return count;
+}
 #endif
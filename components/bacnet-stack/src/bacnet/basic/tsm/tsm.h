@@ -15,6 +15,9 @@
 #include "bacnet/bacdef.h"
 /* BACnet Stack API */
 #include "bacnet/npdu.h"
+#if defined(BACDL_MULTIPLE)
+#include "bacnet/datalink/datalink.h"
+#endif
 
 /* note: TSM functionality is optional - only needed if we are
    doing client requests */
@@ -24,7 +27,12 @@ extern "C" {
 #endif /* __cplusplus */
 
 /* FIXME: modify basic service handlers to use TSM rather than this buffer! */
+#if defined(BACDL_MULTIPLE)
+/* each datalink port has its own buffer - see datalink_port_bind() */
+#define Handler_Transmit_Buffer (*datalink_port_transmit_buffer())
+#else
 BACNET_STACK_EXPORT extern uint8_t Handler_Transmit_Buffer[MAX_PDU];
+#endif
 
 #ifdef __cplusplus
 }
@@ -63,14 +71,23 @@ typedef struct BACnet_TSM_Data {
     /*  used to perform timeout on PDU segments */
     /*uint8_t SegmentTimer; */
     /* used to perform timeout on Confirmed Requests */
-    /* in milliseconds */
-    uint16_t RequestTimer;
+    /* clock time in milliseconds when the request timer expires */
+    uint32_t RequestExpires;
+    /* links (index + 1, or 0) in the free list or a slot of the timers */
+    uint8_t Next;
+    uint8_t Prev;
+    /* slot + 1 of the timers holding the request timer, or 0 if stopped */
+    uint8_t Slot;
     /* unique id */
     uint8_t InvokeID;
     /* state that the TSM is in */
     BACNET_TSM_STATE state;
     /* the address we sent it to */
     BACNET_ADDRESS dest;
+#if defined(BACDL_MULTIPLE)
+    /* the port we sent it on, and send the retries on */
+    DATALINK_PORT *port;
+#endif
     /* the network layer info */
     BACNET_NPDU_DATA npdu_data;
     /* copy of the APDU, should we need to send it again */
@@ -109,6 +126,18 @@ void tsm_set_confirmed_unsegmented_transaction(
     const BACNET_NPDU_DATA *ndpu_data,
     const uint8_t *apdu,
     uint16_t apdu_len);
+#if defined(BACDL_MULTIPLE)
+/* the same, with the port the request is sent on, for a task that is
+   bound to no port or to another one */
+BACNET_STACK_EXPORT
+void tsm_port_set_confirmed_unsegmented_transaction(
+    DATALINK_PORT *port,
+    uint8_t invokeID,
+    const BACNET_ADDRESS *dest,
+    const BACNET_NPDU_DATA *ndpu_data,
+    const uint8_t *apdu,
+    uint16_t apdu_len);
+#endif
 /* returns true if transaction is found */
 BACNET_STACK_EXPORT
 bool tsm_get_transaction_pdu(
@@ -128,4 +157,55 @@ bool tsm_invoke_id_failed(uint8_t invokeID);
 #endif /* __cplusplus */
 /* define out any functions necessary for compile */
 #endif
+
+/* Segmented messages, sent and received with a bounded pool of
+   MAX_SEGMENTED_TRANSACTIONS buffers - see config.h */
+#if (!MAX_SEGMENTED_TRANSACTIONS)
+#define tsm_segmented_response_buffer(dest, service_data, apdu_size) NULL
+#define tsm_segmented_response_send(apdu, apdu_len) 0
+#define tsm_segmented_timer_milliseconds(milliseconds) (void)milliseconds
+#else
+#include "bacnet/apdu.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+uint8_t *tsm_segmented_response_buffer(
+    const BACNET_ADDRESS *dest,
+    const BACNET_CONFIRMED_SERVICE_DATA *service_data,
+    uint16_t *apdu_size);
+BACNET_STACK_EXPORT
+int tsm_segmented_response_send(uint8_t *apdu, uint16_t apdu_len);
+BACNET_STACK_EXPORT
+bool tsm_segmented_response_pending(
+    const BACNET_ADDRESS *src, uint8_t invoke_id);
+BACNET_STACK_EXPORT
+bool tsm_segment_received(
+    const BACNET_ADDRESS *src,
+    bool server,
+    uint8_t invoke_id,
+    uint8_t sequence_number,
+    uint8_t proposed_window_size,
+    bool more_follows,
+    uint8_t **service_request,
+    uint16_t *service_request_len);
+BACNET_STACK_EXPORT
+void tsm_segmented_release(const uint8_t *apdu);
+BACNET_STACK_EXPORT
+void tsm_segment_ack_handler(
+    const BACNET_ADDRESS *src, const uint8_t *apdu, uint16_t apdu_len);
+BACNET_STACK_EXPORT
+void tsm_segmented_abort(
+    const BACNET_ADDRESS *src, uint8_t invoke_id, bool server);
+BACNET_STACK_EXPORT
+void tsm_segmented_timer_milliseconds(uint16_t milliseconds);
+BACNET_STACK_EXPORT
+uint8_t tsm_segmented_idle_count(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
 #endif
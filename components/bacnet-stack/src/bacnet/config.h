@@ -179,6 +179,22 @@
 #if !defined(MAX_TSM_TRANSACTIONS)
 #define MAX_TSM_TRANSACTIONS 8
 #endif
+/* Segmented messages: the number of confirmed requests and complex ACKs */
+/* that can be sent or received in segments at once. Each one holds a */
+/* buffer of MAX_SEGMENTED_APDU bytes for the whole message. */
+/* Configure to zero to abort segmented messages. */
+#if !defined(MAX_SEGMENTED_TRANSACTIONS)
+#define MAX_SEGMENTED_TRANSACTIONS 0
+#endif
+/* the longest segmented message, up to 65535 bytes */
+#if !defined(MAX_SEGMENTED_APDU)
+#define MAX_SEGMENTED_APDU 4096
+#endif
+/* the window size proposed to the peer: segments sent or received */
+/* between two SegmentACKs, 1..127 */
+#if !defined(MAX_SEGMENT_WINDOW_SIZE)
+#define MAX_SEGMENT_WINDOW_SIZE 8
+#endif
 /* The address cache is used for binding to BACnet devices */
 /* The number of entries corresponds to the number of */
 /* devices that might respond to an I-Am on the network. */
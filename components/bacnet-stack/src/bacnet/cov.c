@@ -6,6 +6,7 @@
  * @copyright SPDX-License-Identifier: GPL-2.0-or-later WITH GCC-exception-2.0
  */
 #include <stdint.h>
+#include <string.h>
 /* BACnet Stack defines - first */
 #include "bacnet/bacdef.h"
 /* BACnet Stack API */
@@ -21,21 +22,21 @@ COV Notification
 Unconfirmed COV Notification
 */
 
+/* called by the objects when a change-of-value is detected */
+static cov_change_detected_callback COV_Change_Detected_Callback;
+
 /**
- * @brief Encode APDU for COV Notification.
+ * @brief Encode the tags 0 to 3 of a COV Notification: everything but
+ *  the list-of-values
  * @param apdu  Pointer to the buffer, or NULL for length
  * @param data  Pointer to the data to encode.
- * @return number of bytes encoded, or zero on error.
+ * @return number of bytes encoded
  */
-int cov_notify_encode_apdu(uint8_t *apdu, const BACNET_COV_DATA *data)
+static int cov_notify_header_encode(uint8_t *apdu, const BACNET_COV_DATA *data)
 {
     int len = 0; /* length of each encoding */
     int apdu_len = 0; /* total length of the apdu, return value */
-    const BACNET_PROPERTY_VALUE *value = NULL; /* value in list */
 
-    if (!data) {
-        return 0;
-    }
     /* tag 0 - subscriberProcessIdentifier */
     len = encode_context_unsigned(apdu, 0, data->subscriberProcessIdentifier);
     apdu_len += len;
@@ -60,9 +61,23 @@ int cov_notify_encode_apdu(uint8_t *apdu, const BACNET_COV_DATA *data)
     /* tag 3 - timeRemaining */
     len = encode_context_unsigned(apdu, 3, data->timeRemaining);
     apdu_len += len;
-    if (apdu) {
-        apdu += len;
-    }
+
+    return apdu_len;
+}
+
+/**
+ * @brief Encode the tag 4 list-of-values of a COV Notification
+ * @param apdu  Pointer to the buffer, or NULL for length
+ * @param value_list  the first value, linked to the next one
+ * @return number of bytes encoded
+ */
+static int
+cov_notify_list_encode(uint8_t *apdu, const BACNET_PROPERTY_VALUE *value_list)
+{
+    int len = 0; /* length of each encoding */
+    int apdu_len = 0; /* total length of the apdu, return value */
+    const BACNET_PROPERTY_VALUE *value = NULL; /* value in list */
+
     /* tag 4 - listOfValues */
     len = encode_opening_tag(apdu, 4);
     apdu_len += len;
@@ -70,7 +85,7 @@ int cov_notify_encode_apdu(uint8_t *apdu, const BACNET_COV_DATA *data)
         apdu += len;
     }
     /* the first value includes a pointer to the next value, etc */
-    value = data->listOfValues;
+    value = value_list;
     while (value != NULL) {
         len = bacapp_property_value_encode(apdu, value);
         apdu_len += len;
@@ -86,6 +101,104 @@ int cov_notify_encode_apdu(uint8_t *apdu, const BACNET_COV_DATA *data)
     return apdu_len;
 }
 
+/**
+ * @brief Encode APDU for COV Notification.
+ * @param apdu  Pointer to the buffer, or NULL for length
+ * @param data  Pointer to the data to encode.
+ * @return number of bytes encoded, or zero on error.
+ */
+int cov_notify_encode_apdu(uint8_t *apdu, const BACNET_COV_DATA *data)
+{
+    int len = 0; /* length of each encoding */
+    int apdu_len = 0; /* total length of the apdu, return value */
+
+    if (!data) {
+        return 0;
+    }
+    len = cov_notify_header_encode(apdu, data);
+    apdu_len += len;
+    if (apdu) {
+        apdu += len;
+    }
+    len = cov_notify_list_encode(apdu, data->listOfValues);
+    apdu_len += len;
+
+    return apdu_len;
+}
+
+/**
+ * @brief Encode the list-of-values of a COV Notification on its own, so
+ *  that the values of an object are encoded once and copied into the
+ *  notification of each subscriber with cov_notify_values_apdu_encode()
+ * @param apdu  Pointer to the buffer for encoding into
+ * @param apdu_size number of bytes available in the buffer
+ * @param value_list  the first value, linked to the next one
+ * @return number of bytes encoded, or zero if too large
+ */
+int cov_notify_values_encode(
+    uint8_t *apdu, size_t apdu_size, const BACNET_PROPERTY_VALUE *value_list)
+{
+    size_t apdu_len = 0; /* total length of the apdu, return value */
+
+    apdu_len = (size_t)cov_notify_list_encode(NULL, value_list);
+    if (apdu_len > apdu_size) {
+        apdu_len = 0;
+    } else {
+        apdu_len = (size_t)cov_notify_list_encode(apdu, value_list);
+    }
+
+    return (int)apdu_len;
+}
+
+/**
+ * @brief Encode the APDU of a confirmed or unconfirmed COV Notification
+ *  with a list-of-values encoded by cov_notify_values_encode()
+ * @param apdu  Pointer to the buffer for encoding into
+ * @param apdu_size number of bytes available in the buffer
+ * @param confirmed  true for a ConfirmedCOVNotification
+ * @param invoke_id  invoke ID of a confirmed notification
+ * @param data  Pointer to the data to encode; listOfValues is not used
+ * @param values  the encoded list-of-values
+ * @param values_len  number of bytes of the encoded list-of-values
+ * @return number of bytes encoded, or zero if unable to encode or too large
+ */
+int cov_notify_values_apdu_encode(
+    uint8_t *apdu,
+    size_t apdu_size,
+    bool confirmed,
+    uint8_t invoke_id,
+    const BACNET_COV_DATA *data,
+    const uint8_t *values,
+    size_t values_len)
+{
+    size_t apdu_len = 0; /* return value */
+
+    if (!apdu || !data || !values) {
+        return 0;
+    }
+    apdu_len = confirmed ? 4 : 2;
+    apdu_len += (size_t)cov_notify_header_encode(NULL, data);
+    if ((apdu_len + values_len) > apdu_size) {
+        return 0;
+    }
+    if (confirmed) {
+        apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
+        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+        apdu[2] = invoke_id;
+        apdu[3] = SERVICE_CONFIRMED_COV_NOTIFICATION;
+        apdu_len = 4;
+    } else {
+        apdu[0] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+        apdu[1] = SERVICE_UNCONFIRMED_COV_NOTIFICATION;
+        apdu_len = 2;
+    }
+    apdu_len += (size_t)cov_notify_header_encode(&apdu[apdu_len], data);
+    memcpy(&apdu[apdu_len], values, values_len);
+    apdu_len += values_len;
+
+    return (int)apdu_len;
+}
+
 /**
  * @brief Encode the COVNotification service request
  * @param apdu  Pointer to the buffer for encoding into
@@ -880,6 +993,31 @@ void cov_data_value_list_link(
     }
 }
 
+/**
+ * @brief Set the callback used by objects to report a detected
+ *  change-of-value, so that the COV handler can queue the object
+ *  rather than polling every subscription for changes.
+ * @param cb - callback function, or NULL to disable
+ */
+void cov_change_detected_callback_set(cov_change_detected_callback cb)
+{
+    COV_Change_Detected_Callback = cb;
+}
+
+/**
+ * @brief Report that an object has detected a change-of-value
+ *  (i.e. its COV flag has been set)
+ * @param object_type - object type of the changed object
+ * @param object_instance - object-instance number of the changed object
+ */
+void cov_change_detected_notify(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    if (COV_Change_Detected_Callback) {
+        COV_Change_Detected_Callback(object_type, object_instance);
+    }
+}
+
 /**
  * @brief Encode the Value List for REAL Present-Value and Status-Flags
  * @param value_list - #BACNET_PROPERTY_VALUE with at least 2 entries
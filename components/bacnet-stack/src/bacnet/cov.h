@@ -48,6 +48,10 @@ typedef struct BACnet_COV_Notification {
     BACnet_COV_Notification_Callback callback;
 } BACNET_COV_NOTIFICATION;
 
+/* callback used by objects to report a detected change-of-value */
+typedef void (*cov_change_detected_callback)(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance);
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -59,6 +63,20 @@ size_t cov_notify_service_request_encode(
 BACNET_STACK_EXPORT
 int cov_notify_encode_apdu(uint8_t *apdu, const BACNET_COV_DATA *data);
 
+BACNET_STACK_EXPORT
+int cov_notify_values_encode(
+    uint8_t *apdu, size_t apdu_size, const BACNET_PROPERTY_VALUE *value_list);
+
+BACNET_STACK_EXPORT
+int cov_notify_values_apdu_encode(
+    uint8_t *apdu,
+    size_t apdu_size,
+    bool confirmed,
+    uint8_t invoke_id,
+    const BACNET_COV_DATA *data,
+    const uint8_t *values,
+    size_t values_len);
+
 BACNET_STACK_EXPORT
 int ucov_notify_encode_apdu(
     uint8_t *apdu, unsigned max_apdu_len, const BACNET_COV_DATA *data);
@@ -135,6 +153,12 @@ BACNET_STACK_EXPORT
 void cov_data_value_list_link(
     BACNET_COV_DATA *data, BACNET_PROPERTY_VALUE *value_list, size_t count);
 
+BACNET_STACK_EXPORT
+void cov_change_detected_callback_set(cov_change_detected_callback cb);
+BACNET_STACK_EXPORT
+void cov_change_detected_notify(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance);
+
 BACNET_STACK_EXPORT
 bool cov_value_list_encode_real(
     BACNET_PROPERTY_VALUE *value_list,
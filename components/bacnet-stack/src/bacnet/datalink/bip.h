@@ -21,6 +21,24 @@
 /* specific defines for BACnet/IP over Ethernet */
 #define BIP_HEADER_MAX (1 + 1 + 2)
 #define BIP_MPDU_MAX (BIP_HEADER_MAX + MAX_PDU)
+/* bip_receive_wait() timeout that waits until a datagram or shutdown */
+#define BIP_RECEIVE_WAIT_FOREVER (~0U)
+
+/**
+ * @brief One datagram of a batch for bip_receive_mpdu_batch() and
+ *  bip_send_mpdu_batch().  The address is the source of a received
+ *  datagram, or the destination of one to send.
+ */
+typedef struct bip_mpdu {
+    BACNET_IP_ADDRESS addr;
+    uint8_t *mtu;
+    /* size of the mtu buffer, for receive */
+    uint16_t mtu_size;
+    /* number of octets in the datagram */
+    uint16_t mtu_len;
+    /* received on the broadcast socket */
+    bool broadcast;
+} BIP_MPDU;
 
 #ifdef __cplusplus
 extern "C" {
@@ -67,6 +85,24 @@ BACNET_STACK_EXPORT
 uint16_t bip_receive(
     BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max_pdu, unsigned timeout);
 
+/* implement in ports module: block on the socket without receiving */
+BACNET_STACK_EXPORT
+int bip_receive_wait(unsigned timeout);
+
+BACNET_STACK_EXPORT
+void bip_receive_shutdown(void);
+
+/* implement in ports module: one system call per batch where the
+   IP stack has one, else a loop of the single datagram calls */
+BACNET_STACK_EXPORT
+int bip_receive_mpdu_batch(BIP_MPDU *batch, unsigned count);
+
+BACNET_STACK_EXPORT
+int bip_send_mpdu_batch(const BIP_MPDU *batch, unsigned count);
+
+BACNET_STACK_EXPORT
+int bip_mpdu_handler(BIP_MPDU *mpdu, BACNET_ADDRESS *src);
+
 /* use host byte order for setting UDP port */
 BACNET_STACK_EXPORT
 void bip_set_port(uint16_t port);
@@ -0,0 +1,247 @@
+/**
+ * @file
+ * @brief A BACnet/IP receive task that blocks on the socket, and a
+ *  transmit batch.
+ *
+ * The task sleeps in bip_receive_wait() until the port has a datagram
+ * queued, then takes every queued datagram before it sleeps again,
+ * as many per call as the batch holds (bip_receive_mpdu_batch() is one
+ * recvmmsg() on Linux).  There is no polling period and no fixed delay,
+ * so each datagram is handled as soon as it arrives, and a burst (a
+ * Who-Is storm, or Forwarded-NPDUs from a BBMD) is drained in one
+ * wakeup instead of backing up in the IP stack.
+ *
+ * Between bip_send_batch_begin() and bip_send_batch_flush(), the MPDUs
+ * given to bip_send_mpdu() are copied into the batch and sent together
+ * (one sendmmsg() on Linux), for example the COV notifications to every
+ * subscriber of a changed object.
+ *
+ * Only the port functions of bip.h are used, so the same code runs on
+ * lwIP and on BSD sockets.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/datalink/bip.h"
+#include "bacnet/datalink/biptask.h"
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define BIP_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define BIP_THREAD_LOCAL __thread
+#else
+#define BIP_THREAD_LOCAL
+#endif
+/* the transmit batch: one task at a time has it open, and only that
+   task's MPDUs are held, so a BVLC-Result sent from the receive task
+   is not caught in a batch of COV notifications */
+static BIP_MPDU Send_Batch[BIP_SEND_BATCH_MAX];
+static uint8_t Send_Batch_Buffer[BIP_SEND_BATCH_OCTETS];
+static unsigned Send_Batch_Count;
+static unsigned Send_Batch_Octets;
+static BIP_THREAD_LOCAL bool Send_Batch_Open;
+
+/**
+ * @brief Handle every datagram already queued on the socket, without
+ *  waiting for more
+ * @param batch - buffers for the datagrams; mtu and mtu_size are set
+ *  by the caller
+ * @param count - number of buffers in the batch
+ * @param handler - called for each NPDU
+ * @param context - passed to the handler
+ * @return number of NPDUs handled
+ */
+unsigned bip_receive_batch_drain(
+    BIP_MPDU *batch, unsigned count, bip_npdu_handler handler, void *context)
+{
+    BACNET_ADDRESS src = { 0 };
+    int received = 0;
+    int offset = 0;
+    int i;
+    unsigned handled = 0;
+
+    if (!batch || (count == 0) || !handler) {
+        return 0;
+    }
+    /* a short batch means the sockets are empty */
+    do {
+        received = bip_receive_mpdu_batch(batch, count);
+        for (i = 0; i < received; i++) {
+            memset(&src, 0, sizeof(src));
+            /* BVLC-only datagrams have no NPDU */
+            offset = bip_mpdu_handler(&batch[i], &src);
+            if (offset > 0) {
+                handler(
+                    &src, &batch[i].mtu[offset],
+                    (uint16_t)(batch[i].mtu_len - offset), context);
+                handled++;
+            }
+        }
+    } while (received == (int)count);
+
+    return handled;
+}
+
+/**
+ * @brief Handle every datagram already queued on the socket, one at a
+ *  time, without waiting for more
+ * @param npdu - buffer for each received datagram
+ * @param max_npdu - size of the buffer
+ * @param handler - called for each NPDU
+ * @param context - passed to the handler
+ * @return number of NPDUs handled
+ */
+unsigned bip_receive_drain(
+    uint8_t *npdu,
+    uint16_t max_npdu,
+    bip_npdu_handler handler,
+    void *context)
+{
+    BIP_MPDU mpdu = { 0 };
+
+    if (!npdu) {
+        return 0;
+    }
+    mpdu.mtu = npdu;
+    mpdu.mtu_size = max_npdu;
+
+    return bip_receive_batch_drain(&mpdu, 1, handler, context);
+}
+
+/**
+ * @brief Run the receive loop until bip_receive_shutdown() is called
+ * @param batch - buffers for the datagrams; mtu and mtu_size are set
+ *  by the caller
+ * @param count - number of buffers in the batch
+ * @param handler - called for each NPDU
+ * @param context - passed to the handler
+ */
+void bip_receive_batch_task(
+    BIP_MPDU *batch, unsigned count, bip_npdu_handler handler, void *context)
+{
+    int status;
+
+    for (;;) {
+        status = bip_receive_wait(BIP_RECEIVE_WAIT_FOREVER);
+        if (status < 0) {
+            break;
+        }
+        if (status > 0) {
+            bip_receive_batch_drain(batch, count, handler, context);
+        }
+    }
+}
+
+/**
+ * @brief Run the receive loop with one buffer until
+ *  bip_receive_shutdown() is called
+ * @param npdu - buffer for each received datagram
+ * @param max_npdu - size of the buffer
+ * @param handler - called for each NPDU
+ * @param context - passed to the handler
+ */
+void bip_receive_task(
+    uint8_t *npdu,
+    uint16_t max_npdu,
+    bip_npdu_handler handler,
+    void *context)
+{
+    BIP_MPDU mpdu = { 0 };
+
+    if (!npdu) {
+        return;
+    }
+    mpdu.mtu = npdu;
+    mpdu.mtu_size = max_npdu;
+    bip_receive_batch_task(&mpdu, 1, handler, context);
+}
+
+/**
+ * @brief Send the datagrams held in the transmit batch
+ * @return number of datagrams sent
+ */
+static int bip_send_batch_submit(void)
+{
+    int sent = 0;
+
+    if (Send_Batch_Count > 0) {
+        /* a port without a batch call sends with bip_send_mpdu() */
+        Send_Batch_Open = false;
+        sent = bip_send_mpdu_batch(Send_Batch, Send_Batch_Count);
+        Send_Batch_Open = true;
+    }
+    Send_Batch_Count = 0;
+    Send_Batch_Octets = 0;
+
+    return sent;
+}
+
+/**
+ * @brief Hold the MPDUs the calling task sends from now on, until it
+ *  calls bip_send_batch_flush()
+ */
+void bip_send_batch_begin(void)
+{
+    Send_Batch_Count = 0;
+    Send_Batch_Octets = 0;
+    Send_Batch_Open = true;
+}
+
+/**
+ * @brief Called by bip_send_mpdu() in the port: copy the MPDU into the
+ *  transmit batch, if one is open.  A full batch is sent first.
+ * @param dest - destination B/IP address
+ * @param mtu - the MPDU, with its BVLC header
+ * @param mtu_len - number of octets in the MPDU
+ * @return true if the MPDU is held for bip_send_batch_flush(), false
+ *  if the caller is to send it now
+ */
+bool bip_send_batch_queue(
+    const BACNET_IP_ADDRESS *dest, const uint8_t *mtu, uint16_t mtu_len)
+{
+    BIP_MPDU *mpdu;
+
+    if (!Send_Batch_Open || !dest || !mtu) {
+        return false;
+    }
+    if ((Send_Batch_Count >= BIP_SEND_BATCH_MAX) ||
+        ((Send_Batch_Octets + mtu_len) > sizeof(Send_Batch_Buffer))) {
+        bip_send_batch_submit();
+    }
+    if (mtu_len > sizeof(Send_Batch_Buffer)) {
+        /* the batch is empty, so the order is kept */
+        return false;
+    }
+    mpdu = &Send_Batch[Send_Batch_Count];
+    mpdu->addr = *dest;
+    mpdu->mtu = &Send_Batch_Buffer[Send_Batch_Octets];
+    mpdu->mtu_size = mtu_len;
+    mpdu->mtu_len = mtu_len;
+    mpdu->broadcast = false;
+    memcpy(mpdu->mtu, mtu, mtu_len);
+    Send_Batch_Octets += mtu_len;
+    Send_Batch_Count++;
+
+    return true;
+}
+
+/**
+ * @brief Send the MPDUs held since bip_send_batch_begin(), and go back
+ *  to sending each MPDU as it is given
+ * @return number of datagrams sent by the flush
+ */
+int bip_send_batch_flush(void)
+{
+    int sent;
+
+    sent = bip_send_batch_submit();
+    Send_Batch_Open = false;
+
+    return sent;
+}
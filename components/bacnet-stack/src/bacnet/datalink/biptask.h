@@ -0,0 +1,77 @@
+/**
+ * @file
+ * @brief API for a BACnet/IP receive task that blocks on the socket and
+ *  hands every datagram queued at each wakeup to the application, and
+ *  for sending a run of datagrams as one batch.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_BIP_TASK_H
+#define BACNET_BIP_TASK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/datalink/bip.h"
+
+/* datagrams held by bip_send_batch_begin() before they are sent */
+#ifndef BIP_SEND_BATCH_MAX
+#define BIP_SEND_BATCH_MAX 32
+#endif
+/* octets held by bip_send_batch_begin(); COV notifications are small */
+#ifndef BIP_SEND_BATCH_OCTETS
+#define BIP_SEND_BATCH_OCTETS 4096
+#endif
+
+/**
+ * @brief Called for each NPDU the receive task takes off the socket
+ * @param src - source address of the NPDU
+ * @param npdu - the NPDU, without the BVLC header
+ * @param npdu_len - number of octets in the NPDU
+ * @param context - from bip_receive_task() or bip_receive_drain()
+ */
+typedef void (*bip_npdu_handler)(
+    BACNET_ADDRESS *src, uint8_t *npdu, uint16_t npdu_len, void *context);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+unsigned bip_receive_drain(
+    uint8_t *npdu,
+    uint16_t max_npdu,
+    bip_npdu_handler handler,
+    void *context);
+
+BACNET_STACK_EXPORT
+void bip_receive_task(
+    uint8_t *npdu,
+    uint16_t max_npdu,
+    bip_npdu_handler handler,
+    void *context);
+
+BACNET_STACK_EXPORT
+unsigned bip_receive_batch_drain(
+    BIP_MPDU *batch, unsigned count, bip_npdu_handler handler, void *context);
+
+BACNET_STACK_EXPORT
+void bip_receive_batch_task(
+    BIP_MPDU *batch, unsigned count, bip_npdu_handler handler, void *context);
+
+BACNET_STACK_EXPORT
+void bip_send_batch_begin(void);
+
+BACNET_STACK_EXPORT
+bool bip_send_batch_queue(
+    const BACNET_IP_ADDRESS *dest, const uint8_t *mtu, uint16_t mtu_len);
+
+BACNET_STACK_EXPORT
+int bip_send_batch_flush(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -15,6 +15,17 @@
 /* BACnet Stack defines - first */
 #include "bacnet/bacdef.h"
 
+/* CRC_SLICE_BY selects the block CRC calculation at build time: 0 for the
+   bitwise calculation of the standard, 1 for a 256 entry table, or 4 or 8
+   for slicing-by-4 or slicing-by-8 tables (2K or 4K octets of tables) */
+#ifndef CRC_SLICE_BY
+#if defined(CRC_USE_TABLE)
+#define CRC_SLICE_BY 1
+#else
+#define CRC_SLICE_BY 0
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -23,6 +34,12 @@ BACNET_STACK_EXPORT
 uint8_t CRC_Calc_Header(uint8_t dataValue, uint8_t crcValue);
 BACNET_STACK_EXPORT
 uint16_t CRC_Calc_Data(uint8_t dataValue, uint16_t crcValue);
+BACNET_STACK_EXPORT
+uint16_t
+CRC_Calc_Data_Block(const uint8_t *buffer, size_t length, uint16_t crcValue);
+BACNET_STACK_EXPORT
+uint16_t CRC_Calc_Data_Block_Slices(
+    const uint8_t *buffer, size_t length, uint16_t crcValue, unsigned slices);
 
 #ifdef __cplusplus
 }
@@ -37,7 +37,7 @@
 #include "bacnet/datalink/bsc/bsc-datalink.h"
 #endif
 
-static enum {
+typedef enum {
     DATALINK_NONE = 0,
     DATALINK_ARCNET,
     DATALINK_ETHERNET,
@@ -45,49 +45,261 @@ static enum {
     DATALINK_BIP6,
     DATALINK_MSTP,
     DATALINK_ZIGBEE,
-    DATALINK_BSC
-} Datalink_Transport;
+    DATALINK_BSC,
+    DATALINK_UNKNOWN
+} DATALINK_TRANSPORT;
+static DATALINK_TRANSPORT Datalink_Transport;
 
-void datalink_set(char *datalink_string)
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define DATALINK_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define DATALINK_THREAD_LOCAL __thread
+#else
+#define DATALINK_THREAD_LOCAL
+#endif
+/* port bound to the calling thread, or NULL to use Datalink_Transport */
+static DATALINK_THREAD_LOCAL DATALINK_PORT *Datalink_Port;
+/* encode buffer for the threads without a port */
+static DATALINK_TRANSMIT_BUFFER Datalink_Transmit_Buffer;
+
+static DATALINK_TRANSPORT datalink_transport(const char *datalink_string)
 {
+    DATALINK_TRANSPORT transport = DATALINK_UNKNOWN;
+
     if (bacnet_stricmp("none", datalink_string) == 0) {
-        Datalink_Transport = DATALINK_NONE;
+        transport = DATALINK_NONE;
     }
 #if defined(BACDL_BIP)
     else if (bacnet_stricmp("bip", datalink_string) == 0) {
-        Datalink_Transport = DATALINK_BIP;
+        transport = DATALINK_BIP;
     }
 #endif
 #if defined(BACDL_BIP6)
     else if (bacnet_stricmp("bip6", datalink_string) == 0) {
-        Datalink_Transport = DATALINK_BIP6;
+        transport = DATALINK_BIP6;
     }
 #endif
 #if defined(BACDL_ETHERNET)
     else if (bacnet_stricmp("ethernet", datalink_string) == 0) {
-        Datalink_Transport = DATALINK_ETHERNET;
+        transport = DATALINK_ETHERNET;
     }
 #endif
 #if defined(BACDL_ARCNET)
     else if (bacnet_stricmp("arcnet", datalink_string) == 0) {
-        Datalink_Transport = DATALINK_ARCNET;
+        transport = DATALINK_ARCNET;
     }
 #endif
 #if defined(BACDL_MSTP)
     else if (bacnet_stricmp("mstp", datalink_string) == 0) {
-        Datalink_Transport = DATALINK_MSTP;
+        transport = DATALINK_MSTP;
     }
 #endif
 #if defined(BACDL_ZIGBEE)
     else if (bacnet_stricmp("zigbee", datalink_string) == 0) {
-        Datalink_Transport = DATALINK_ARCNET;
+        transport = DATALINK_ARCNET;
     }
 #endif
 #if defined(BACDL_BSC)
     else if (bacnet_stricmp("bsc", datalink_string) == 0) {
-        Datalink_Transport = DATALINK_BSC;
+        transport = DATALINK_BSC;
     }
 #endif
+
+    return transport;
+}
+
+void datalink_set(char *datalink_string)
+{
+    DATALINK_TRANSPORT transport = datalink_transport(datalink_string);
+
+    if (transport != DATALINK_UNKNOWN) {
+        Datalink_Transport = transport;
+    }
+}
+
+static int datalink_none_send_pdu(
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    (void)dest;
+    (void)npdu_data;
+    (void)pdu;
+
+    return pdu_len;
+}
+
+static uint16_t datalink_none_receive(
+    BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max_pdu, unsigned timeout)
+{
+    (void)src;
+    (void)pdu;
+    (void)max_pdu;
+    (void)timeout;
+
+    return 0;
+}
+
+static void datalink_none_address(BACNET_ADDRESS *address)
+{
+    (void)address;
+}
+
+/**
+ * @brief Load a port with the functions of a transport
+ * @param port [out] the port to initialize
+ * @param name [in] transport name, as used by datalink_set()
+ * @return true if the transport is built into this application
+ */
+bool datalink_port_init(DATALINK_PORT *port, const char *name)
+{
+    bool status = true;
+
+    if (!port || !name) {
+        return false;
+    }
+    port->name = name;
+    port->maintenance_timer = NULL;
+    switch (datalink_transport(name)) {
+        case DATALINK_NONE:
+            port->send_pdu = datalink_none_send_pdu;
+            port->receive = datalink_none_receive;
+            port->get_broadcast_address = datalink_none_address;
+            port->get_my_address = datalink_none_address;
+            break;
+#if defined(BACDL_ARCNET)
+        case DATALINK_ARCNET:
+            port->send_pdu = arcnet_send_pdu;
+            port->receive = arcnet_receive;
+            port->get_broadcast_address = arcnet_get_broadcast_address;
+            port->get_my_address = arcnet_get_my_address;
+            break;
+#endif
+#if defined(BACDL_ETHERNET)
+        case DATALINK_ETHERNET:
+            port->send_pdu = ethernet_send_pdu;
+            port->receive = ethernet_receive;
+            port->get_broadcast_address = ethernet_get_broadcast_address;
+            port->get_my_address = ethernet_get_my_address;
+            break;
+#endif
+#if defined(BACDL_BIP)
+        case DATALINK_BIP:
+            port->send_pdu = bip_send_pdu;
+            port->receive = bip_receive;
+            port->get_broadcast_address = bip_get_broadcast_address;
+            port->get_my_address = bip_get_my_address;
+            port->maintenance_timer = bvlc_maintenance_timer;
+            break;
+#endif
+#if defined(BACDL_BIP6)
+        case DATALINK_BIP6:
+            port->send_pdu = bip6_send_pdu;
+            port->receive = bip6_receive;
+            port->get_broadcast_address = bip6_get_broadcast_address;
+            port->get_my_address = bip6_get_my_address;
+            port->maintenance_timer = bvlc6_maintenance_timer;
+            break;
+#endif
+#if defined(BACDL_MSTP)
+        case DATALINK_MSTP:
+            port->send_pdu = dlmstp_send_pdu;
+            port->receive = dlmstp_receive;
+            port->get_broadcast_address = dlmstp_get_broadcast_address;
+            port->get_my_address = dlmstp_get_my_address;
+            break;
+#endif
+#if defined(BACDL_ZIGBEE)
+        case DATALINK_ZIGBEE:
+            port->send_pdu = bzll_send_pdu;
+            port->receive = bzll_receive;
+            port->get_broadcast_address = bzll_get_broadcast_address;
+            port->get_my_address = bzll_get_my_address;
+            port->maintenance_timer = bzll_maintenance_timer;
+            break;
+#endif
+#if defined(BACDL_BSC)
+        case DATALINK_BSC:
+            port->send_pdu = bsc_send_pdu;
+            port->receive = bsc_receive;
+            port->get_broadcast_address = bsc_get_broadcast_address;
+            port->get_my_address = bsc_get_my_address;
+            port->maintenance_timer = bsc_maintenance_timer;
+            break;
+#endif
+        default:
+            status = false;
+            break;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Route the datalink_xxx() calls of the calling thread to a port.
+ *  A receive task binds its own port once, then the handlers it calls
+ *  reply on that port without switching the global transport.
+ * @param port [in] the port, or NULL to go back to datalink_set()
+ */
+void datalink_port_bind(DATALINK_PORT *port)
+{
+    Datalink_Port = port;
+}
+
+/**
+ * @brief Get the port bound to the calling thread
+ * @return the port, or NULL if none is bound
+ */
+DATALINK_PORT *datalink_port_bound(void)
+{
+    return Datalink_Port;
+}
+
+/**
+ * @brief Get the buffer the service handlers encode into
+ * @return the transmit buffer of the bound port, or the shared one
+ */
+DATALINK_TRANSMIT_BUFFER *datalink_port_transmit_buffer(void)
+{
+    if (Datalink_Port) {
+        return &Datalink_Port->transmit_buffer;
+    }
+
+    return &Datalink_Transmit_Buffer;
+}
+
+/**
+ * @brief Send a PDU on a given port, whatever port the thread is bound to
+ * @param port [in] the port, or NULL for datalink_send_pdu()
+ * @return number of bytes sent, or 0 on failure
+ */
+int datalink_port_send_pdu(
+    DATALINK_PORT *port,
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    if (port) {
+        return port->send_pdu(dest, npdu_data, pdu, pdu_len);
+    }
+
+    return datalink_send_pdu(dest, npdu_data, pdu, pdu_len);
+}
+
+/**
+ * @brief Get the address of this device on a given port
+ * @param port [in] the port, or NULL for datalink_get_my_address()
+ */
+void datalink_port_get_my_address(
+    DATALINK_PORT *port, BACNET_ADDRESS *my_address)
+{
+    if (port) {
+        port->get_my_address(my_address);
+    } else {
+        datalink_get_my_address(my_address);
+    }
 }
 
 bool datalink_init(char *ifname)
@@ -148,6 +360,10 @@ int datalink_send_pdu(
 {
     int bytes = 0;
 
+    if (Datalink_Port) {
+        return Datalink_Port->send_pdu(dest, npdu_data, pdu, pdu_len);
+    }
+
     switch (Datalink_Transport) {
         case DATALINK_NONE:
             bytes = pdu_len;
@@ -199,6 +415,10 @@ uint16_t datalink_receive(
 {
     uint16_t bytes = 0;
 
+    if (Datalink_Port) {
+        return Datalink_Port->receive(src, pdu, max_pdu, timeout);
+    }
+
     switch (Datalink_Transport) {
         case DATALINK_NONE:
             break;
@@ -291,6 +511,10 @@ void datalink_cleanup(void)
 
 void datalink_get_broadcast_address(BACNET_ADDRESS *dest)
 {
+    if (Datalink_Port) {
+        Datalink_Port->get_broadcast_address(dest);
+        return;
+    }
     switch (Datalink_Transport) {
         case DATALINK_NONE:
             break;
@@ -336,6 +560,10 @@ void datalink_get_broadcast_address(BACNET_ADDRESS *dest)
 
 void datalink_get_my_address(BACNET_ADDRESS *my_address)
 {
+    if (Datalink_Port) {
+        Datalink_Port->get_my_address(my_address);
+        return;
+    }
     switch (Datalink_Transport) {
         case DATALINK_NONE:
             break;
@@ -427,6 +655,12 @@ void datalink_set_interface(char *ifname)
 
 void datalink_maintenance_timer(uint16_t seconds)
 {
+    if (Datalink_Port) {
+        if (Datalink_Port->maintenance_timer) {
+            Datalink_Port->maintenance_timer(seconds);
+        }
+        return;
+    }
     switch (Datalink_Transport) {
         case DATALINK_NONE:
             break;
@@ -171,6 +171,59 @@ void datalink_set(char *datalink_string);
 BACNET_STACK_EXPORT
 void datalink_maintenance_timer(uint16_t seconds);
 
+#if defined(BACDL_MULTIPLE)
+typedef uint8_t DATALINK_TRANSMIT_BUFFER[MAX_PDU];
+
+/**
+ * @brief One transport of a multiple datalink application.
+ *  A port bound to a thread with datalink_port_bind() takes every
+ *  datalink_xxx() call made from that thread instead of the transport
+ *  chosen by datalink_set(), so a service handler replies on the port
+ *  the request came in on.  The port also owns the buffer the handlers
+ *  encode into (Handler_Transmit_Buffer), so threads bound to different
+ *  ports can build and send their replies at the same time.
+ */
+typedef struct datalink_port {
+    const char *name;
+    int (*send_pdu)(
+        BACNET_ADDRESS *dest,
+        BACNET_NPDU_DATA *npdu_data,
+        uint8_t *pdu,
+        unsigned pdu_len);
+    uint16_t (*receive)(
+        BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max_pdu, unsigned timeout);
+    void (*get_broadcast_address)(BACNET_ADDRESS *dest);
+    void (*get_my_address)(BACNET_ADDRESS *my_address);
+    /* optional */
+    void (*maintenance_timer)(uint16_t seconds);
+    DATALINK_TRANSMIT_BUFFER transmit_buffer;
+} DATALINK_PORT;
+
+BACNET_STACK_EXPORT
+bool datalink_port_init(DATALINK_PORT *port, const char *name);
+
+BACNET_STACK_EXPORT
+void datalink_port_bind(DATALINK_PORT *port);
+
+BACNET_STACK_EXPORT
+DATALINK_PORT *datalink_port_bound(void);
+
+BACNET_STACK_EXPORT
+DATALINK_TRANSMIT_BUFFER *datalink_port_transmit_buffer(void);
+
+BACNET_STACK_EXPORT
+int datalink_port_send_pdu(
+    DATALINK_PORT *port,
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len);
+
+BACNET_STACK_EXPORT
+void datalink_port_get_my_address(
+    DATALINK_PORT *port, BACNET_ADDRESS *my_address);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -74,6 +74,13 @@ int dlmstp_send_pdu(
         }
         if (Ringbuf_Data_Put(&user->PDU_Queue, (uint8_t *)pkt)) {
             bytes_sent = pdu_len;
+            if (user->RS485_Driver && user->RS485_Driver->wake &&
+                (MSTP_Port->SlaveNodeEnabled ||
+                 (MSTP_Port->master_state ==
+                  MSTP_MASTER_STATE_ANSWER_DATA_REQUEST))) {
+                /* the reply may be sent now: end the receive wait */
+                user->RS485_Driver->wake();
+            }
         }
     }
 
@@ -129,6 +136,7 @@ uint16_t MSTP_Get_Reply(struct mstp_port_struct_t *mstp_port, unsigned timeout)
     bool matched = false;
     struct dlmstp_user_data_t *user = NULL;
     struct dlmstp_packet *pkt;
+    const uint8_t *request;
 
     (void)timeout;
     if (!mstp_port) {
@@ -143,9 +151,15 @@ uint16_t MSTP_Get_Reply(struct mstp_port_struct_t *mstp_port, unsigned timeout)
     }
     /* look at next PDU in queue without removing it */
     pkt = (struct dlmstp_packet *)(void *)Ringbuf_Peek(&user->PDU_Queue);
-    /* is this the reply to the DER? */
+    /* is this the reply to the DER? The DER may have been lent to the
+       caller, and the input buffer swapped for the spare */
+    if (user->Receive_PDU) {
+        request = user->Receive_PDU;
+    } else {
+        request = mstp_port->InputBuffer;
+    }
     matched = npdu_is_data_expecting_reply(
-        &mstp_port->InputBuffer[0], mstp_port->DataLength,
+        request, mstp_port->DataLength,
         mstp_port->SourceAddress, &pkt->pdu[0], pkt->pdu_len,
         pkt->address.mac[0]);
     if (!matched) {
@@ -221,52 +235,54 @@ uint16_t MSTP_Put_Receive(struct mstp_port_struct_t *mstp_port)
         return 0;
     }
     user->ReceivePacketPending = true;
+    user->Receive_PDU = mstp_port->InputBuffer;
 
     return mstp_port->DataLength;
 }
 
 /**
- * @brief Run the MS/TP state machines, and get packet if available
- * @param pdu - place to put PDU data for the caller
- * @param max_pdu - number of bytes of PDU data that caller can receive
- * @return number of bytes in received packet, or 0 if no packet was received
- * @note Must be called at least once every 1 milliseconds, with no more than
- *  5 milliseconds jitter.
+ * @brief Determine if the received frame is held for the turnaround before
+ *  the node state machine acts on it: a frame for us, or a frame that ends
+ *  the wait for a reply or a poll.  Other frames do not make the node
+ *  transmit, so they are taken at once.
+ * @return true if the node waits for the turnaround after the frame
  */
-uint16_t dlmstp_receive(
-    BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max_pdu, unsigned timeout)
+static bool dlmstp_turnaround_frame(void)
+{
+    if (MSTP_Port->ReceivedValidFrame) {
+        return true;
+    }
+    if (!MSTP_Port->ReceivedInvalidFrame &&
+        !MSTP_Port->ReceivedValidFrameNotForUs) {
+        return false;
+    }
+    if (MSTP_Port->SlaveNodeEnabled) {
+        return false;
+    }
+
+    return (MSTP_Port->master_state == MSTP_MASTER_STATE_WAIT_FOR_REPLY) ||
+        (MSTP_Port->master_state == MSTP_MASTER_STATE_POLL_FOR_MASTER);
+}
+
+/**
+ * @brief Run the MS/TP receive and node state machines
+ * @param user - user data of the MSTP port
+ * @param driver - RS-485 driver of the MSTP port
+ */
+static void dlmstp_receive_fsm(
+    struct dlmstp_user_data_t *user, struct dlmstp_rs485_driver *driver)
 {
-    uint16_t pdu_len = 0;
     uint8_t data_register = 0;
-    struct dlmstp_user_data_t *user;
-    struct dlmstp_rs485_driver *driver;
-    uint16_t i;
     uint32_t milliseconds;
     MSTP_MASTER_STATE master_state;
 
-    (void)timeout;
-    if (!MSTP_Port) {
-        return 0;
-    }
-    user = MSTP_Port->UserData;
-    if (!user) {
-        return 0;
-    }
-    driver = user->RS485_Driver;
-    if (!driver) {
-        return 0;
-    }
-    while (!MSTP_Port->InputBuffer) {
-        /* FIXME: develop configure an input buffer! */
-    }
-    if (driver->transmitting()) {
-        /* we're transmitting; do nothing else */
-        return 0;
-    }
-    /* only do receive state machine while we don't have a frame */
+    /* only do receive state machine while we don't have a frame,
+       and while the input buffer is not holding a frame for the caller */
     while ((MSTP_Port->ReceivedValidFrame == false) &&
            (MSTP_Port->ReceivedInvalidFrame == false) &&
-           (MSTP_Port->ReceivedValidFrameNotForUs == false)) {
+           (MSTP_Port->ReceivedValidFrameNotForUs == false) &&
+           (user->ReceivePacketPending == false) &&
+           (user->Receive_Buffer_Lent != MSTP_Port->InputBuffer)) {
         MSTP_Port->DataAvailable = driver->read(&data_register);
         if (MSTP_Port->DataAvailable) {
             MSTP_Port->DataRegister = data_register;
@@ -282,13 +298,12 @@ uint16_t dlmstp_receive(
             break;
         }
     }
-    if (MSTP_Port->ReceivedValidFrame || MSTP_Port->ReceivedInvalidFrame ||
-        MSTP_Port->ReceivedValidFrameNotForUs) {
+    if (dlmstp_turnaround_frame()) {
         /* delay after reception before transmitting - per MS/TP spec */
         milliseconds = MSTP_Port->SilenceTimer(MSTP_Port);
         if (milliseconds < MSTP_Port->Tturnaround_timeout) {
             /* we're waiting; do nothing else */
-            return 0;
+            return;
         }
     }
     if (MSTP_Port->ReceivedValidFrame) {
@@ -345,27 +360,153 @@ uint16_t dlmstp_receive(
             };
         }
     }
-    /* see if there is a packet available */
-    if (user->ReceivePacketPending) {
-        user->ReceivePacketPending = false;
-        user->Statistics.receive_pdu_counter++;
-        pdu_len = MSTP_Port->DataLength;
-        if (pdu_len > max_pdu) {
-            /* PDU is too large */
-            return 0;
+}
+
+/**
+ * @brief Get the time until the state machines need to run again without
+ *  a byte being received: the turnaround after a received frame, a reply
+ *  queued while the node answers a request, or the next timeout of the
+ *  MS/TP state machines
+ * @param user - user data of the MSTP port
+ * @return microseconds until the next deadline, zero to run now, or
+ *  MSTP_DEADLINE_NONE if only a received byte moves them on
+ */
+static uint32_t dlmstp_deadline(struct dlmstp_user_data_t *user)
+{
+    uint32_t silence;
+    uint32_t turnaround;
+    bool answering;
+
+    answering = !MSTP_Port->SlaveNodeEnabled &&
+        (MSTP_Port->master_state == MSTP_MASTER_STATE_ANSWER_DATA_REQUEST);
+    if (!answering && dlmstp_turnaround_frame()) {
+        /* the frame is held for the turnaround before the node acts */
+        silence = MSTP_Silence_Microseconds(MSTP_Port);
+        turnaround = MSTP_Port->Tturnaround_timeout * 1000UL;
+        if (silence < turnaround) {
+            return turnaround - silence;
         }
-        if (!pdu) {
-            /* no place to put a PDU */
+        return 0;
+    }
+    if (!Ringbuf_Empty(&user->PDU_Queue)) {
+        if (MSTP_Port->SlaveNodeEnabled) {
+            /* a reply is matched until Treply_delay, then left queued */
+            if (MSTP_Silence_Microseconds(MSTP_Port) <=
+                (MSTP_Port->Treply_delay * 1000UL)) {
+                return MSTP_DEADLINE_POLL;
+            }
+        } else if (answering) {
             return 0;
         }
-        /* copy input buffer to PDU */
-        for (i = 0; i < pdu_len; i++) {
-            pdu[i] = MSTP_Port->InputBuffer[i];
+    }
+
+    return MSTP_Next_Deadline(MSTP_Port);
+}
+
+/**
+ * @brief Get the time until the MS/TP state machines next need to run
+ *  without a byte being received, for a caller that waits on the line
+ *  itself
+ * @return microseconds until the next deadline, zero to run now, or
+ *  MSTP_DEADLINE_NONE if only a received byte moves them on
+ */
+uint32_t dlmstp_next_deadline(void)
+{
+    struct dlmstp_user_data_t *user;
+
+    if (!MSTP_Port) {
+        return MSTP_DEADLINE_NONE;
+    }
+    user = MSTP_Port->UserData;
+    if (!user) {
+        return MSTP_DEADLINE_NONE;
+    }
+    if (user->ReceivePacketPending && !user->Receive_Buffer_Lent) {
+        /* a packet is waiting for the caller */
+        return 0;
+    }
+
+    return dlmstp_deadline(user);
+}
+
+/**
+ * @brief Run the MS/TP state machines, and lend the received packet to
+ *  the caller without copying it.  The packet stays in the MS/TP input
+ *  buffer until the caller calls dlmstp_receive_release().
+ *
+ *  If the user data has a spare input buffer, the input buffers are
+ *  swapped so that the next frame is received while the caller holds
+ *  this one.  Otherwise no frames are received until the release.
+ *
+ *  If the driver can wait for data, the caller sleeps until a byte is
+ *  received, or until the next deadline of the MS/TP state machines, for
+ *  no more than timeout milliseconds.  Every byte that has been received
+ *  is then consumed in one pass.
+ *
+ * @param src - place to put the source address of the packet
+ * @param pdu - place to put a pointer to the PDU data of the packet
+ * @param timeout - number of milliseconds to wait for a byte
+ * @return number of bytes in received packet, or 0 if no packet was received
+ * @note Must be called at least once every 1 milliseconds, with no more than
+ *  5 milliseconds jitter, unless the driver can wait: then the timeout may
+ *  be as long as the caller likes, since the wait ends at the deadline.
+ */
+uint16_t
+dlmstp_receive_lend(BACNET_ADDRESS *src, uint8_t **pdu, unsigned timeout)
+{
+    uint16_t pdu_len = 0;
+    uint32_t deadline, milliseconds;
+    struct dlmstp_user_data_t *user;
+    struct dlmstp_rs485_driver *driver;
+
+    if (!MSTP_Port) {
+        return 0;
+    }
+    user = MSTP_Port->UserData;
+    if (!user) {
+        return 0;
+    }
+    driver = user->RS485_Driver;
+    if (!driver) {
+        return 0;
+    }
+    while (!MSTP_Port->InputBuffer) {
+        /* FIXME: develop configure an input buffer! */
+    }
+    if (driver->transmitting()) {
+        /* we're transmitting; do nothing else */
+        return 0;
+    }
+    if (timeout && driver->wait && !user->ReceivePacketPending &&
+        !driver->read(NULL)) {
+        deadline = dlmstp_deadline(user);
+        if (deadline > 0) {
+            /* sleep until a byte is received, or the next deadline,
+               rounded up to whole milliseconds */
+            milliseconds = (deadline / 1000UL) + ((deadline % 1000UL) ? 1 : 0);
+            if (milliseconds < timeout) {
+                timeout = milliseconds;
+            }
+            (void)driver->wait(timeout);
         }
-        if (!src) {
-            /* no place to put a source address */
+    }
+    dlmstp_receive_fsm(user, driver);
+    /* see if there is a packet available, and a place to lend it */
+    if (user->ReceivePacketPending && !user->Receive_Buffer_Lent) {
+        user->ReceivePacketPending = false;
+        user->Statistics.receive_pdu_counter++;
+        if (!pdu || !src) {
+            /* no place to put a PDU */
             return 0;
         }
+        pdu_len = MSTP_Port->DataLength;
+        user->Receive_Buffer_Lent = MSTP_Port->InputBuffer;
+        if (user->Receive_Buffer_Spare) {
+            /* receive the next frame while this one is lent */
+            MSTP_Port->InputBuffer = user->Receive_Buffer_Spare;
+            user->Receive_Buffer_Spare = NULL;
+        }
+        *pdu = user->Receive_Buffer_Lent;
         /* copy source address */
         src->len = 0;
         src->net = 0;
@@ -376,6 +517,59 @@ uint16_t dlmstp_receive(
     return pdu_len;
 }
 
+/**
+ * @brief Return the packet lent by dlmstp_receive_lend() to the datalink
+ */
+void dlmstp_receive_release(void)
+{
+    struct dlmstp_user_data_t *user;
+
+    if (!MSTP_Port) {
+        return;
+    }
+    user = MSTP_Port->UserData;
+    if (!user || !user->Receive_Buffer_Lent) {
+        return;
+    }
+    if (user->Receive_Buffer_Lent != MSTP_Port->InputBuffer) {
+        /* the lent buffer is the spare for the next swap */
+        user->Receive_Buffer_Spare = user->Receive_Buffer_Lent;
+    }
+    user->Receive_Buffer_Lent = NULL;
+}
+
+/**
+ * @brief Run the MS/TP state machines, and get packet if available
+ * @param pdu - place to put PDU data for the caller
+ * @param max_pdu - number of bytes of PDU data that caller can receive
+ * @return number of bytes in received packet, or 0 if no packet was received
+ * @note Must be called at least once every 1 milliseconds, with no more than
+ *  5 milliseconds jitter.
+ */
+uint16_t dlmstp_receive(
+    BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max_pdu, unsigned timeout)
+{
+    uint16_t pdu_len = 0;
+    uint8_t *frame = NULL;
+    BACNET_ADDRESS frame_src = { 0 };
+
+    pdu_len = dlmstp_receive_lend(&frame_src, &frame, timeout);
+    if (pdu_len == 0) {
+        return 0;
+    }
+    if ((pdu_len > max_pdu) || !pdu || !src) {
+        /* PDU is too large, or no place to put it */
+        pdu_len = 0;
+    } else {
+        /* copy input buffer to PDU */
+        memcpy(pdu, frame, pdu_len);
+        bacnet_address_copy(src, &frame_src);
+    }
+    dlmstp_receive_release();
+
+    return pdu_len;
+}
+
 /**
  * @brief fill a BACNET_ADDRESS with the MSTP MAC address
  * @param src - a #BACNET_ADDRESS structure
@@ -653,6 +847,37 @@ bool dlmstp_check_auto_baud_set(bool flag)
     return true;
 }
 
+/**
+ * @brief Get the MSTP port AdaptivePollEnabled status
+ * @return true if the MSTP port has AdaptivePollEnabled
+ */
+bool dlmstp_adaptive_poll_enabled(void)
+{
+    if (!MSTP_Port) {
+        return false;
+    }
+    return MSTP_Port->AdaptivePollEnabled;
+}
+
+/**
+ * @brief Set the MSTP port AdaptivePollEnabled flag
+ * @param flag - true if the MSTP port has AdaptivePollEnabled
+ * @return true if the MSTP port AdaptivePollEnabled was set
+ * @note With this flag, the maintenance Poll For Master of a master node
+ * only polls the addresses that it heard frames from, and polls every
+ * address up to Max_Master once every Npoll_full_range maintenance
+ * cycles.  A new master node is found within that many cycles.
+ */
+bool dlmstp_adaptive_poll_enabled_set(bool flag)
+{
+    if (!MSTP_Port) {
+        return false;
+    }
+    MSTP_Port->AdaptivePollEnabled = flag;
+
+    return true;
+}
+
 /**
  * @brief Get the MSTP port MAC address that this node prefers to use.
  * @return ZeroConfigStation value, or an out-of-range value if invalid
@@ -934,6 +1159,39 @@ uint32_t dlmstp_silence_milliseconds(void *arg)
     return milliseconds;
 }
 
+/**
+ * @brief Return the RS-485 silence time in microseconds, from the driver
+ *  if it timestamps the line, otherwise from its milliseconds
+ * @param arg - pointer to MSTP port structure
+ * @return silence time in microseconds
+ */
+uint32_t dlmstp_silence_microseconds(void *arg)
+{
+    uint32_t microseconds = 0, milliseconds = 0;
+    struct mstp_port_struct_t *port = arg;
+    struct dlmstp_user_data_t *user = NULL;
+    struct dlmstp_rs485_driver *driver = NULL;
+
+    if (port) {
+        user = port->UserData;
+    }
+    if (user) {
+        driver = user->RS485_Driver;
+    }
+    if (driver && driver->silence_microseconds) {
+        microseconds = driver->silence_microseconds();
+    } else if (driver) {
+        milliseconds = driver->silence_milliseconds();
+        if (milliseconds > (UINT32_MAX / 1000UL)) {
+            microseconds = UINT32_MAX;
+        } else {
+            microseconds = milliseconds * 1000UL;
+        }
+    }
+
+    return microseconds;
+}
+
 /**
  * @brief Return the valid frame time in milliseconds
  * @param arg - pointer to MSTP port structure
@@ -1042,6 +1300,7 @@ bool dlmstp_init(char *ifname)
             MSTP_Init(MSTP_Port);
             user->Initialized = true;
         }
+        MSTP_Port->SilenceTimerMicroseconds = dlmstp_silence_microseconds;
         status = true;
     }
 
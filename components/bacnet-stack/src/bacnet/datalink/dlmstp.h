@@ -83,6 +83,18 @@ struct dlmstp_rs485_driver {
 
     /** Reset the silence time */
     void (*silence_reset)(void);
+
+    /** Optional: block until a byte is received, or the milliseconds
+        have elapsed.  Returns true if a byte is available. */
+    bool (*wait)(uint32_t milliseconds);
+
+    /** Optional: get the current silence time in microseconds, from the
+        last receive or transmit edge timestamped by the driver */
+    uint32_t (*silence_microseconds)(void);
+
+    /** Optional: end a wait early, from another task, because a PDU
+        was queued that the node can send now */
+    void (*wake)(void);
 };
 
 /* callback to signify the receipt of a preamble */
@@ -112,6 +124,13 @@ struct dlmstp_user_data_t {
     struct dlmstp_packet PDU_Buffer[DLMSTP_MAX_INFO_FRAMES];
     bool Initialized;
     bool ReceivePacketPending;
+    /* optional second input buffer of InputBufferSize octets, so that the
+       next frame is received while the caller holds a lent frame */
+    uint8_t *Receive_Buffer_Spare;
+    /* the input buffer lent by dlmstp_receive_lend(), or NULL */
+    uint8_t *Receive_Buffer_Lent;
+    /* the input buffer holding the last frame passed up */
+    uint8_t *Receive_PDU;
     void *Context;
 };
 
@@ -146,6 +165,19 @@ uint16_t dlmstp_receive(
     uint16_t max_pdu, /* amount of space available in the PDU  */
     unsigned timeout); /* milliseconds to wait for a packet */
 
+/* returns the number of octets in the PDU lent by the datalink, or zero */
+BACNET_STACK_EXPORT
+uint16_t dlmstp_receive_lend(
+    BACNET_ADDRESS *src, /* source address */
+    uint8_t **pdu, /* lent PDU data */
+    unsigned timeout); /* milliseconds to wait for a packet */
+BACNET_STACK_EXPORT
+void dlmstp_receive_release(void);
+/* microseconds until the MS/TP state machines next need to run without
+   a byte being received, or MSTP_DEADLINE_NONE */
+BACNET_STACK_EXPORT
+uint32_t dlmstp_next_deadline(void);
+
 /* This parameter represents the value of the Max_Info_Frames property of */
 /* the node's Device object. The value of Max_Info_Frames specifies the */
 /* maximum number of information frames the node may send before it must */
@@ -205,6 +237,10 @@ bool dlmstp_check_auto_baud(void);
 BACNET_STACK_EXPORT
 bool dlmstp_check_auto_baud_set(bool flag);
 BACNET_STACK_EXPORT
+bool dlmstp_adaptive_poll_enabled(void);
+BACNET_STACK_EXPORT
+bool dlmstp_adaptive_poll_enabled_set(bool flag);
+BACNET_STACK_EXPORT
 uint8_t dlmstp_zero_config_preferred_station(void);
 BACNET_STACK_EXPORT
 bool dlmstp_zero_config_preferred_station_set(uint8_t station);
@@ -222,6 +258,8 @@ uint8_t dlmstp_max_master_limit(void);
 BACNET_STACK_EXPORT
 uint32_t dlmstp_silence_milliseconds(void *arg);
 BACNET_STACK_EXPORT
+uint32_t dlmstp_silence_microseconds(void *arg);
+BACNET_STACK_EXPORT
 void dlmstp_silence_reset(void *arg);
 
 BACNET_STACK_EXPORT
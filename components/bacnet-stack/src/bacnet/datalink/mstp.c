@@ -91,6 +91,52 @@ static __inline__ void printf_master(const char *format, ...)
 /*           least significant octet first */
 /* (pad): (optional) at most one octet of padding: X'FF' */
 
+/**
+ * @brief Convert a timeout in milliseconds to microseconds, to compare
+ *  with the silence
+ * @param milliseconds - timeout in milliseconds
+ * @return timeout in microseconds, limited to UINT32_MAX
+ */
+static uint32_t mstp_microseconds(uint32_t milliseconds)
+{
+    if (milliseconds > (UINT32_MAX / 1000UL)) {
+        return UINT32_MAX;
+    }
+
+    return milliseconds * 1000UL;
+}
+
+/**
+ * @brief Get the silence on the medium in microseconds.  A port that only
+ *  counts milliseconds gets the same decisions as before, since every
+ *  timeout is compared in microseconds.
+ * @param mstp_port - port specific data
+ * @return silence time in microseconds, limited to UINT32_MAX
+ */
+uint32_t MSTP_Silence_Microseconds(struct mstp_port_struct_t *mstp_port)
+{
+    if (!mstp_port) {
+        return 0;
+    }
+    if (mstp_port->SilenceTimerMicroseconds) {
+        return mstp_port->SilenceTimerMicroseconds((void *)mstp_port);
+    }
+
+    return mstp_microseconds(mstp_port->SilenceTimer((void *)mstp_port));
+}
+
+/**
+ * @brief Check if the data and data CRC octets of the frame being
+ *  received all fit in the input buffer, so that the data CRC can be
+ *  calculated as a block when the last octet arrives
+ * @param mstp_port - port specific data
+ * @return true if the data CRC is calculated as a block
+ */
+static bool mstp_receive_crc_block(const struct mstp_port_struct_t *mstp_port)
+{
+    return ((uint32_t)mstp_port->DataLength + 2) <= mstp_port->InputBufferSize;
+}
+
 /* we need to be able to increment without rolling over */
 #define INCREMENT_AND_LIMIT_UINT8(x) \
     {                                \
@@ -218,10 +264,9 @@ uint16_t MSTP_Create_Frame(
         if ((8 + data_len + 2) > buffer_size) {
             return 0;
         }
-        for (index = 8; index < (data_len + 8); index++, data++) {
-            buffer[index] = *data;
-            crc16 = CRC_Calc_Data(buffer[index], crc16);
-        }
+        memmove(&buffer[8], data, data_len);
+        crc16 = CRC_Calc_Data_Block(&buffer[8], data_len, crc16);
+        index = 8 + data_len;
         crc16 = ~crc16;
         buffer[index] = crc16 & 0xFF; /* LSB first */
         buffer[index + 1] = crc16 >> 8;
@@ -330,8 +375,8 @@ void MSTP_Receive_Frame_FSM(struct mstp_port_struct_t *mstp_port)
             /* In the PREAMBLE state, the node waits for
                the second octet of the preamble. */
             /* Timeout */
-            if (mstp_port->SilenceTimer((void *)mstp_port) >
-                mstp_port->Tframe_abort) {
+            if (MSTP_Silence_Microseconds(mstp_port) >
+                mstp_microseconds(mstp_port->Tframe_abort)) {
                 /* a correct preamble has not been received */
                 /* wait for the start of a frame. */
                 mstp_port->receive_state = MSTP_RECEIVE_STATE_IDLE;
@@ -367,8 +412,8 @@ void MSTP_Receive_Frame_FSM(struct mstp_port_struct_t *mstp_port)
             /* In the HEADER state, the node waits for
                the fixed message header. */
             /* Timeout */
-            if (mstp_port->SilenceTimer((void *)mstp_port) >
-                mstp_port->Tframe_abort) {
+            if (MSTP_Silence_Microseconds(mstp_port) >
+                mstp_microseconds(mstp_port->Tframe_abort)) {
                 /* indicate that an error has occurred during the reception of a
                  * frame */
                 mstp_port->ReceivedInvalidFrame = true;
@@ -499,8 +544,8 @@ void MSTP_Receive_Frame_FSM(struct mstp_port_struct_t *mstp_port)
         case MSTP_RECEIVE_STATE_SKIP_DATA:
             /* In the DATA and SKIP DATA states, the node waits for the
                data portion of a frame. */
-            if (mstp_port->SilenceTimer((void *)mstp_port) >
-                mstp_port->Tframe_abort) {
+            if (MSTP_Silence_Microseconds(mstp_port) >
+                mstp_microseconds(mstp_port->Tframe_abort)) {
                 /* Timeout */
                 /* indicate that an error has occurred during the reception of a
                  * frame */
@@ -525,8 +570,10 @@ void MSTP_Receive_Frame_FSM(struct mstp_port_struct_t *mstp_port)
                 printf_receive_data("%02X ", mstp_port->DataRegister);
                 if (mstp_port->Index < mstp_port->DataLength) {
                     /* DataOctet */
-                    mstp_port->DataCRC = CRC_Calc_Data(
-                        mstp_port->DataRegister, mstp_port->DataCRC);
+                    if (!mstp_receive_crc_block(mstp_port)) {
+                        mstp_port->DataCRC = CRC_Calc_Data(
+                            mstp_port->DataRegister, mstp_port->DataCRC);
+                    }
                     if (mstp_port->Index < mstp_port->InputBufferSize) {
                         mstp_port->InputBuffer[mstp_port->Index] =
                             mstp_port->DataRegister;
@@ -535,8 +582,10 @@ void MSTP_Receive_Frame_FSM(struct mstp_port_struct_t *mstp_port)
                     /* SKIP_DATA or DATA - no change in state */
                 } else if (mstp_port->Index == mstp_port->DataLength) {
                     /* CRC1 */
-                    mstp_port->DataCRC = CRC_Calc_Data(
-                        mstp_port->DataRegister, mstp_port->DataCRC);
+                    if (!mstp_receive_crc_block(mstp_port)) {
+                        mstp_port->DataCRC = CRC_Calc_Data(
+                            mstp_port->DataRegister, mstp_port->DataCRC);
+                    }
                     mstp_port->DataCRCActualMSB = mstp_port->DataRegister;
                     if (mstp_port->Index < mstp_port->InputBufferSize) {
                         mstp_port->InputBuffer[mstp_port->Index] =
@@ -550,8 +599,15 @@ void MSTP_Receive_Frame_FSM(struct mstp_port_struct_t *mstp_port)
                         mstp_port->InputBuffer[mstp_port->Index] =
                             mstp_port->DataRegister;
                     }
-                    mstp_port->DataCRC = CRC_Calc_Data(
-                        mstp_port->DataRegister, mstp_port->DataCRC);
+                    if (mstp_receive_crc_block(mstp_port)) {
+                        /* the data and CRC octets are in the input buffer */
+                        mstp_port->DataCRC = CRC_Calc_Data_Block(
+                            mstp_port->InputBuffer, mstp_port->Index + 1,
+                            mstp_port->DataCRC);
+                    } else {
+                        mstp_port->DataCRC = CRC_Calc_Data(
+                            mstp_port->DataRegister, mstp_port->DataCRC);
+                    }
                     mstp_port->DataCRCActualLSB = mstp_port->DataRegister;
                     printf_receive_data(
                         "%s",
@@ -621,6 +677,66 @@ void MSTP_Receive_Frame_FSM(struct mstp_port_struct_t *mstp_port)
     return;
 }
 
+/**
+ * @brief Note the source of a frame heard on the bus, for the adaptive
+ *  maintenance poll
+ * @param mstp_port MSTP port context data
+ * @param station - source address of the frame
+ */
+static void
+mstp_poll_heard(struct mstp_port_struct_t *mstp_port, uint8_t station)
+{
+    if (station <= Nmax_master_station) {
+        mstp_port->Poll_Heard[station / 8] |= (uint8_t)(1U << (station % 8));
+    }
+}
+
+/**
+ * @brief The next address of an adaptive maintenance poll, which skips
+ *  the addresses that were not heard on the bus, but in a full range poll
+ * @param mstp_port MSTP port context data
+ * @return the address after Poll_Station, or NS when there are no more
+ */
+static uint8_t mstp_poll_next(const struct mstp_port_struct_t *mstp_port)
+{
+    uint8_t station = mstp_port->Poll_Station;
+
+    for (;;) {
+        station = (station + 1) % (mstp_port->Nmax_master + 1);
+        if ((station == mstp_port->Next_Station) ||
+            (station == mstp_port->This_Station)) {
+            return mstp_port->Next_Station;
+        }
+        if (mstp_port->PollFullRange ||
+            (mstp_port->Poll_Heard[station / 8] & (1U << (station % 8)))) {
+            return station;
+        }
+    }
+}
+
+/**
+ * @brief A maintenance poll cycle is done: count it, and make every
+ *  Npoll_full_range-th cycle a full range poll, which starts with the
+ *  heard addresses forgotten, so that a node that left is not polled for
+ * @param mstp_port MSTP port context data
+ */
+static void mstp_poll_cycle_done(struct mstp_port_struct_t *mstp_port)
+{
+    if (!mstp_port->AdaptivePollEnabled) {
+        return;
+    }
+    if (mstp_port->PollFullRange) {
+        mstp_port->PollFullRange = false;
+        mstp_port->Poll_Cycles = 0;
+    } else {
+        mstp_port->Poll_Cycles++;
+        if (mstp_port->Poll_Cycles >= Npoll_full_range) {
+            mstp_port->PollFullRange = true;
+            memset(mstp_port->Poll_Heard, 0, sizeof(mstp_port->Poll_Heard));
+        }
+    }
+}
+
 /**
  * @brief Finite State Machine for receiving an MSTP frame
  * @param mstp_port MSTP port context data
@@ -637,9 +753,20 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
     bool transition_now = false;
     MSTP_MASTER_STATE master_state = mstp_port->master_state;
 
+    if (mstp_port->ReceivedValidFrame ||
+        mstp_port->ReceivedValidFrameNotForUs) {
+        mstp_poll_heard(mstp_port, mstp_port->SourceAddress);
+    }
     /* some calculations that several states need */
-    next_poll_station =
-        (mstp_port->Poll_Station + 1) % (mstp_port->Nmax_master + 1);
+    if (mstp_port->AdaptivePollEnabled &&
+        (mstp_port->Next_Station != mstp_port->This_Station)) {
+        next_poll_station = mstp_poll_next(mstp_port);
+    } else {
+        /* the standard poll, and the search for a successor, go to
+           every address */
+        next_poll_station =
+            (mstp_port->Poll_Station + 1) % (mstp_port->Nmax_master + 1);
+    }
     next_this_station =
         (mstp_port->This_Station + 1) % (mstp_port->Nmax_master + 1);
     next_next_station =
@@ -789,7 +916,8 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
                     mstp_port->ReceivedValidFrame = false;
                 }
             } else if (
-                mstp_port->SilenceTimer((void *)mstp_port) >= Tno_token) {
+                MSTP_Silence_Microseconds(mstp_port) >=
+                mstp_microseconds(Tno_token)) {
                 /* LostToken */
                 /* assume that the token has been lost */
                 mstp_port->EventCount = 0; /* Addendum 135-2004d-8 */
@@ -847,8 +975,8 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
         case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
             /* In the WAIT_FOR_REPLY state, the node waits for  */
             /* a reply from another node. */
-            if (mstp_port->SilenceTimer((void *)mstp_port) >=
-                mstp_port->Treply_timeout) {
+            if (MSTP_Silence_Microseconds(mstp_port) >=
+                mstp_microseconds(mstp_port->Treply_timeout)) {
                 /* ReplyTimeout */
                 /* assume that the request has failed */
                 mstp_port->FrameCount = mstp_port->Nmax_info_frames;
@@ -985,6 +1113,7 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
                     mstp_port->master_state = MSTP_MASTER_STATE_POLL_FOR_MASTER;
                 } else {
                     /* ResetMaintenancePFM */
+                    mstp_poll_cycle_done(mstp_port);
                     mstp_port->Poll_Station = mstp_port->This_Station;
                     /* transmit a Token frame to NS */
                     MSTP_Create_And_Send_Frame(
@@ -1009,8 +1138,8 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
         case MSTP_MASTER_STATE_PASS_TOKEN:
             /* The PASS_TOKEN state listens for a successor to begin using */
             /* the token that this node has just attempted to pass. */
-            if (mstp_port->SilenceTimer((void *)mstp_port) <=
-                mstp_port->Tusage_timeout) {
+            if (MSTP_Silence_Microseconds(mstp_port) <=
+                mstp_microseconds(mstp_port->Tusage_timeout)) {
                 if (mstp_port->EventCount > Nmin_octets) {
                     /* SawTokenUser */
                     /* Assume that a frame has been sent by the new token user.
@@ -1059,7 +1188,8 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
             /* for that period of time. The timeout is continued to determine */
             /* whether or not this node may create a token. */
             my_timeout = Tno_token + (Tslot * mstp_port->This_Station);
-            if (mstp_port->SilenceTimer((void *)mstp_port) < my_timeout) {
+            if (MSTP_Silence_Microseconds(mstp_port) <
+                mstp_microseconds(my_timeout)) {
                 if (mstp_port->EventCount > Nmin_octets) {
                     /* SawFrame */
                     /* Some other node exists at a lower address.  */
@@ -1072,8 +1202,10 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
                 ns_timeout =
                     Tno_token + (Tslot * (mstp_port->This_Station + 1));
                 mm_timeout = Tno_token + (Tslot * (mstp_port->Nmax_master + 1));
-                if ((mstp_port->SilenceTimer((void *)mstp_port) < ns_timeout) ||
-                    (mstp_port->SilenceTimer((void *)mstp_port) > mm_timeout)) {
+                if ((MSTP_Silence_Microseconds(mstp_port) <
+                     mstp_microseconds(ns_timeout)) ||
+                    (MSTP_Silence_Microseconds(mstp_port) >
+                     mstp_microseconds(mm_timeout))) {
                     /* GenerateToken */
                     /* Assume that this node is the lowest numerical address  */
                     /* on the network and is empowered to create a token.  */
@@ -1139,8 +1271,8 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
                 }
                 mstp_port->ReceivedValidFrame = false;
             } else if (
-                (mstp_port->SilenceTimer((void *)mstp_port) >
-                 mstp_port->Tusage_timeout) ||
+                (MSTP_Silence_Microseconds(mstp_port) >
+                 mstp_microseconds(mstp_port->Tusage_timeout)) ||
                 (mstp_port->ReceivedInvalidFrame == true) ||
                 (mstp_port->ReceivedValidFrameNotForUs == true)) {
                 if (mstp_port->SoleMaster == true) {
@@ -1214,8 +1346,8 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port)
                 /* clear our flag we were holding for comparison */
                 mstp_port->ReceivedValidFrame = false;
             } else if (
-                mstp_port->SilenceTimer((void *)mstp_port) >
-                mstp_port->Treply_delay) {
+                MSTP_Silence_Microseconds(mstp_port) >
+                mstp_microseconds(mstp_port->Treply_delay)) {
                 /* DeferredReply */
                 /* If no reply will be available from the higher layers */
                 /* within Treply_delay after the reception of the */
@@ -1329,8 +1461,8 @@ void MSTP_Slave_Node_FSM(struct mstp_port_struct_t *mstp_port)
             /* clear our flag we were holding for comparison */
             mstp_port->ReceivedValidFrame = false;
         } else if (
-            mstp_port->SilenceTimer((void *)mstp_port) >
-            mstp_port->Treply_delay) {
+            MSTP_Silence_Microseconds(mstp_port) >
+            mstp_microseconds(mstp_port->Treply_delay)) {
             /* If no reply will be available from the higher layers
                 within Treply_delay after the reception of the final
                 octet of the requesting frame (the mechanism used to
@@ -1342,6 +1474,96 @@ void MSTP_Slave_Node_FSM(struct mstp_port_struct_t *mstp_port)
     }
 }
 
+/**
+ * @brief Get the microseconds left of a timeout, from the silence
+ * @param silence - silence on the medium in microseconds
+ * @param timeout - timeout in milliseconds
+ * @param after - true if the timeout expires only once the silence is
+ *  greater than it, rather than equal to it
+ * @return microseconds until the timeout expires, or zero if it has
+ */
+static uint32_t
+mstp_remaining(uint32_t silence, uint32_t timeout, bool after)
+{
+    uint32_t expiry = mstp_microseconds(timeout);
+
+    if (after && (expiry < UINT32_MAX)) {
+        expiry++;
+    }
+    if (silence >= expiry) {
+        return 0;
+    }
+
+    return expiry - silence;
+}
+
+/**
+ * @brief Get the time until the receive and node state machines next
+ *  move on without another octet being received, so that the caller can
+ *  sleep until then, or until an octet is received, instead of running
+ *  the state machines every millisecond.
+ * @param mstp_port the context of the MSTP port
+ * @return microseconds until the next timeout, zero if the state machines
+ *  need to run now, or MSTP_DEADLINE_NONE if only a received octet
+ *  moves them on
+ */
+uint32_t MSTP_Next_Deadline(struct mstp_port_struct_t *mstp_port)
+{
+    uint32_t silence;
+    uint16_t my_timeout;
+
+    if (!mstp_port) {
+        return MSTP_DEADLINE_NONE;
+    }
+    silence = MSTP_Silence_Microseconds(mstp_port);
+    if ((mstp_port->master_state == MSTP_MASTER_STATE_ANSWER_DATA_REQUEST) &&
+        !mstp_port->SlaveNodeEnabled) {
+        /* the request frame is kept for the reply, until Treply_delay */
+        return mstp_remaining(silence, mstp_port->Treply_delay, true);
+    }
+    if (mstp_port->ReceivedValidFrame || mstp_port->ReceivedInvalidFrame ||
+        mstp_port->ReceivedValidFrameNotForUs) {
+        return 0;
+    }
+    if (mstp_port->receive_state != MSTP_RECEIVE_STATE_IDLE) {
+        /* the node state machines wait for the frame to end */
+        return mstp_remaining(silence, mstp_port->Tframe_abort, true);
+    }
+    if (mstp_port->SlaveNodeEnabled) {
+        return MSTP_DEADLINE_NONE;
+    }
+    switch (mstp_port->master_state) {
+        case MSTP_MASTER_STATE_INITIALIZE:
+            if (mstp_port->CheckAutoBaud || mstp_port->ZeroConfigEnabled) {
+                return MSTP_DEADLINE_POLL;
+            }
+            return 0;
+        case MSTP_MASTER_STATE_IDLE:
+            return mstp_remaining(silence, Tno_token, false);
+        case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
+            return mstp_remaining(silence, mstp_port->Treply_timeout, false);
+        case MSTP_MASTER_STATE_PASS_TOKEN:
+            if (mstp_port->EventCount > Nmin_octets) {
+                return 0;
+            }
+            return mstp_remaining(silence, mstp_port->Tusage_timeout, true);
+        case MSTP_MASTER_STATE_NO_TOKEN:
+            if (mstp_port->EventCount > Nmin_octets) {
+                return 0;
+            }
+            my_timeout = Tno_token + (Tslot * mstp_port->This_Station);
+            return mstp_remaining(silence, my_timeout, false);
+        case MSTP_MASTER_STATE_POLL_FOR_MASTER:
+            return mstp_remaining(silence, mstp_port->Tusage_timeout, true);
+        case MSTP_MASTER_STATE_USE_TOKEN:
+        case MSTP_MASTER_STATE_DONE_WITH_TOKEN:
+        default:
+            break;
+    }
+
+    return 0;
+}
+
 /**
  * @brief Initialize a UUID for storing the unique identifier of this node
  *  which is used to send and validate a test request and test response
@@ -1468,8 +1690,8 @@ static void MSTP_Zero_Config_State_Idle(struct mstp_port_struct_t *mstp_port)
         /* IdleValidFrameNotForUs */
         mstp_port->ReceivedValidFrameNotForUs = false;
     } else if (mstp_port->Zero_Config_Silence > 0) {
-        if (mstp_port->SilenceTimer((void *)mstp_port) >
-            mstp_port->Zero_Config_Silence) {
+        if (MSTP_Silence_Microseconds(mstp_port) >
+            mstp_microseconds(mstp_port->Zero_Config_Silence)) {
             /* IdleTimeout */
             /* long silence indicates we are alone or
             with other silent devices */
@@ -1540,8 +1762,8 @@ static void MSTP_Zero_Config_State_Lurk(struct mstp_port_struct_t *mstp_port)
         /* LurkValidFrameNotForUs */
         mstp_port->ReceivedValidFrameNotForUs = false;
     } else if (mstp_port->Zero_Config_Silence > 0) {
-        if (mstp_port->SilenceTimer((void *)mstp_port) >
-            mstp_port->Zero_Config_Silence) {
+        if (MSTP_Silence_Microseconds(mstp_port) >
+            mstp_microseconds(mstp_port->Zero_Config_Silence)) {
             /* LurkTimeout */
             mstp_port->Zero_Config_State = MSTP_ZERO_CONFIG_STATE_IDLE;
         }
@@ -1592,8 +1814,8 @@ static void MSTP_Zero_Config_State_Claim(struct mstp_port_struct_t *mstp_port)
         mstp_port->ReceivedValidFrameNotForUs = false;
     } else if (mstp_port->Zero_Config_Silence > 0) {
         /* ClaimTimeout */
-        if (mstp_port->SilenceTimer((void *)mstp_port) >
-            mstp_port->Zero_Config_Silence) {
+        if (MSTP_Silence_Microseconds(mstp_port) >
+            mstp_microseconds(mstp_port->Zero_Config_Silence)) {
             mstp_port->Zero_Config_State = MSTP_ZERO_CONFIG_STATE_IDLE;
         }
     }
@@ -1654,8 +1876,8 @@ static void MSTP_Zero_Config_State_Confirm(struct mstp_port_struct_t *mstp_port)
         /* ConfirmationValidFrameNotForUs */
         mstp_port->ReceivedValidFrameNotForUs = false;
     } else if (
-        mstp_port->SilenceTimer((void *)mstp_port) >=
-        mstp_port->Treply_timeout) {
+        MSTP_Silence_Microseconds(mstp_port) >=
+        mstp_microseconds(mstp_port->Treply_timeout)) {
         /* ConfirmationTimeout */
         /* In case validating device doesn't support Test Request */
         /* no response and no collision */
@@ -1845,6 +2067,8 @@ void MSTP_Init(struct mstp_port_struct_t *mstp_port)
             (mstp_port->Tusage_timeout > 35)) {
             mstp_port->Tusage_timeout = DEFAULT_Tusage_timeout;
         }
+        /* a port with a microsecond silence timer sets it after init */
+        mstp_port->SilenceTimerMicroseconds = NULL;
         mstp_port->receive_state = MSTP_RECEIVE_STATE_IDLE;
         mstp_port->master_state = MSTP_MASTER_STATE_INITIALIZE;
         mstp_port->ReceiveError = false;
@@ -1867,6 +2091,11 @@ void MSTP_Init(struct mstp_port_struct_t *mstp_port)
         mstp_port->SoleMaster = false;
         mstp_port->SourceAddress = 0;
         mstp_port->TokenCount = 0;
+        /* adaptive poll: the search for a successor at startup polls
+           every address, so the full range poll comes later */
+        mstp_port->PollFullRange = false;
+        memset(mstp_port->Poll_Heard, 0, sizeof(mstp_port->Poll_Heard));
+        mstp_port->Poll_Cycles = 0;
         /* zero config */
         mstp_port->Zero_Config_State = MSTP_ZERO_CONFIG_STATE_INIT;
     }
@@ -28,6 +28,14 @@
 /* size of the buffer used to send and validate a unique test request */
 #define MSTP_UUID_SIZE 16
 
+/* no timeout pending: only a received octet moves the state machines on */
+#define MSTP_DEADLINE_NONE UINT32_MAX
+/* microseconds between runs of the state machines that have timers
+   without a deadline, such as the zero config and auto baud ones */
+#ifndef MSTP_DEADLINE_POLL
+#define MSTP_DEADLINE_POLL 1000UL
+#endif
+
 struct mstp_port_struct_t {
     MSTP_RECEIVE_STATE receive_state;
     /* When a master node is powered up or reset, */
@@ -58,6 +66,13 @@ struct mstp_port_struct_t {
     unsigned SlaveNodeEnabled : 1;
     /* A Boolean flag set to TRUE if this node is using a ZeroConfig address */
     unsigned ZeroConfigEnabled : 1;
+    /* A Boolean flag set to TRUE if the maintenance Poll For Master only
+       polls the addresses heard on the bus, but for a poll of every
+       address up to Nmax_master every Npoll_full_range cycles */
+    unsigned AdaptivePollEnabled : 1;
+    /* A Boolean flag set to TRUE while the maintenance poll goes to every
+       address up to Nmax_master */
+    unsigned PollFullRange : 1;
     /* stores the latest received data */
     uint8_t DataRegister;
     /* Used to accumulate the CRC on the data field of a frame. */
@@ -118,6 +133,11 @@ struct mstp_port_struct_t {
        so that you can be atomic on 8 bit microcontrollers */
     uint32_t (*SilenceTimer)(void *pArg);
     void (*SilenceTimerReset)(void *pArg);
+    /* Optional: the same silence in microseconds, measured from the last
+       receive or transmit edge that the driver timestamped, so that the
+       timeouts are decided exactly instead of to the millisecond.
+       MSTP_Init() clears it, so set it after MSTP_Init(). */
+    uint32_t (*SilenceTimerMicroseconds)(void *pArg);
 
     /* A timer used to measure and generate Reply Postponed frames.  It is
        incremented by a timer process and is cleared by the Master Node State
@@ -188,6 +208,15 @@ struct mstp_port_struct_t {
        In the absence of other fixed address nodes, this value shall be 127. */
     uint8_t Zero_Config_Max_Master;
 
+    /* A bit for each master address, set when a frame from the address is
+       heard on the bus, and cleared at the start of a full range poll.
+       The adaptive maintenance poll polls these addresses only, so that a
+       master that drops out of the ring gets back in at the next cycle. */
+    uint8_t Poll_Heard[(Nmax_master_station + 1) / 8];
+    /* The number of maintenance poll cycles since the last full range
+       poll */
+    uint8_t Poll_Cycles;
+
     /* The minimum time without a DataAvailable or ReceiveError event within
        a frame before a receiving node may discard the frame: 60 bit times.
        Implementations may use larger values for this timeout,
@@ -255,6 +284,11 @@ bool MSTP_Master_Node_FSM(struct mstp_port_struct_t *mstp_port);
 BACNET_STACK_EXPORT
 void MSTP_Slave_Node_FSM(struct mstp_port_struct_t *mstp_port);
 
+BACNET_STACK_EXPORT
+uint32_t MSTP_Silence_Microseconds(struct mstp_port_struct_t *mstp_port);
+BACNET_STACK_EXPORT
+uint32_t MSTP_Next_Deadline(struct mstp_port_struct_t *mstp_port);
+
 /* returns true if line is active */
 BACNET_STACK_EXPORT
 bool MSTP_Line_Active(const struct mstp_port_struct_t *mstp_port);
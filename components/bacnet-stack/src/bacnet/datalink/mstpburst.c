@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @brief A ring of received RS-485 bursts for BACnet MS/TP.
+ *
+ * The writer is the UART interrupt or event handler.  It gets the data
+ * of the next free burst, reads up to MSTP_BURST_SIZE octets from the
+ * UART directly into it, and commits the burst with the time it arrived.
+ * The reader is the MS/TP receive state machine, which takes one octet
+ * at a time until the ring is empty.  The ring has one writer and one
+ * reader, so it needs no lock beyond what the RING_BUFFER provides.
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/basic/sys/ringbuf.h"
+#include "bacnet/datalink/mstpburst.h"
+
+/**
+ * @brief Initialize an empty ring of bursts
+ * @param b - ring of bursts
+ */
+void MSTP_Burst_Init(MSTP_BURST_BUFFER *b)
+{
+    if (b) {
+        Ringbuf_Initialize(
+            &b->Ring, (volatile uint8_t *)b->Bursts, sizeof(b->Bursts),
+            sizeof(struct mstp_burst), MSTP_BURST_COUNT);
+        b->Offset = 0;
+        b->Overruns = 0;
+    }
+}
+
+/**
+ * @brief Discard every octet that has not been read
+ * @param b - ring of bursts
+ */
+void MSTP_Burst_Flush(MSTP_BURST_BUFFER *b)
+{
+    if (b) {
+        while (Ringbuf_Pop(&b->Ring, NULL)) {
+            /* discard */
+        }
+        b->Offset = 0;
+    }
+}
+
+/**
+ * @brief Get the data of the next free burst, so that the UART can be
+ *  read directly into it
+ * @param b - ring of bursts
+ * @return MSTP_BURST_SIZE octets to write, or NULL if the ring is full
+ */
+uint8_t *MSTP_Burst_Write_Buffer(MSTP_BURST_BUFFER *b)
+{
+    struct mstp_burst *burst;
+
+    if (!b) {
+        return NULL;
+    }
+    burst = (struct mstp_burst *)Ringbuf_Data_Peek(&b->Ring);
+    if (!burst) {
+        b->Overruns++;
+        return NULL;
+    }
+
+    return burst->data;
+}
+
+/**
+ * @brief Add the burst written by MSTP_Burst_Write_Buffer() to the ring
+ * @param b - ring of bursts
+ * @param length - number of octets written, up to MSTP_BURST_SIZE
+ * @param timestamp - time that the burst was received
+ * @return true if the burst was added
+ */
+bool MSTP_Burst_Write_Commit(
+    MSTP_BURST_BUFFER *b, uint16_t length, uint32_t timestamp)
+{
+    struct mstp_burst *burst;
+
+    if (!b || (length == 0) || (length > MSTP_BURST_SIZE)) {
+        return false;
+    }
+    burst = (struct mstp_burst *)Ringbuf_Data_Peek(&b->Ring);
+    if (!burst) {
+        return false;
+    }
+    burst->length = length;
+    burst->timestamp = timestamp;
+
+    return Ringbuf_Data_Put(&b->Ring, (volatile uint8_t *)burst);
+}
+
+/**
+ * @brief Copy octets into as many bursts as they need
+ * @param b - ring of bursts
+ * @param data - octets that were received
+ * @param length - number of octets that were received
+ * @param timestamp - time that the octets were received
+ * @return number of octets added, less than length if the ring is full
+ */
+unsigned MSTP_Burst_Write(
+    MSTP_BURST_BUFFER *b,
+    const uint8_t *data,
+    unsigned length,
+    uint32_t timestamp)
+{
+    unsigned written = 0, chunk;
+    uint8_t *burst_data;
+
+    if (!data) {
+        return 0;
+    }
+    while (written < length) {
+        burst_data = MSTP_Burst_Write_Buffer(b);
+        if (!burst_data) {
+            break;
+        }
+        chunk = length - written;
+        if (chunk > MSTP_BURST_SIZE) {
+            chunk = MSTP_BURST_SIZE;
+        }
+        memcpy(burst_data, &data[written], chunk);
+        MSTP_Burst_Write_Commit(b, (uint16_t)chunk, timestamp);
+        written += chunk;
+    }
+
+    return written;
+}
+
+/**
+ * @brief Read the next octet, or check if one is available
+ * @param b - ring of bursts
+ * @param data_register - place for the octet, or NULL to only check
+ * @param timestamp - place for the time the burst of the octet was
+ *  received, or NULL
+ * @return true if an octet is available
+ */
+bool MSTP_Burst_Read(
+    MSTP_BURST_BUFFER *b, uint8_t *data_register, uint32_t *timestamp)
+{
+    struct mstp_burst *burst;
+
+    if (!b) {
+        return false;
+    }
+    burst = (struct mstp_burst *)Ringbuf_Peek(&b->Ring);
+    if (!burst) {
+        return false;
+    }
+    if (!data_register) {
+        return true;
+    }
+    *data_register = burst->data[b->Offset];
+    if (timestamp) {
+        *timestamp = burst->timestamp;
+    }
+    b->Offset++;
+    if (b->Offset >= burst->length) {
+        b->Offset = 0;
+        (void)Ringbuf_Pop(&b->Ring, NULL);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Check if no octets are waiting to be read
+ * @param b - ring of bursts
+ * @return true if the ring is empty
+ */
+bool MSTP_Burst_Empty(const MSTP_BURST_BUFFER *b)
+{
+    if (b) {
+        return Ringbuf_Empty(&b->Ring);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get the number of bursts dropped because the ring was full
+ * @param b - ring of bursts
+ * @return number of bursts
+ */
+uint32_t MSTP_Burst_Overruns(const MSTP_BURST_BUFFER *b)
+{
+    if (b) {
+        return b->Overruns;
+    }
+
+    return 0;
+}
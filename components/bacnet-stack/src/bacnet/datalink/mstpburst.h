@@ -0,0 +1,77 @@
+/**
+ * @file
+ * @brief API for a ring of received RS-485 bursts for BACnet MS/TP.
+ *  An interrupt or event handler stores each burst of octets read from
+ *  the UART with the time it arrived, and the MS/TP receive state machine
+ *  consumes the octets of every available burst in one pass.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef BACNET_MSTP_BURST_H
+#define BACNET_MSTP_BURST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+/* BACnet Stack defines - first */
+#include "bacnet/bacdef.h"
+/* BACnet Stack API */
+#include "bacnet/basic/sys/ringbuf.h"
+
+/* octets in each burst - the size of a typical UART receive FIFO */
+#ifndef MSTP_BURST_SIZE
+#define MSTP_BURST_SIZE 128
+#endif
+/* number of bursts in the ring - must be a power of two */
+#ifndef MSTP_BURST_COUNT
+#define MSTP_BURST_COUNT 8
+#endif
+
+struct mstp_burst {
+    /* time that the burst was received, in driver units */
+    uint32_t timestamp;
+    uint16_t length;
+    uint8_t data[MSTP_BURST_SIZE];
+};
+
+typedef struct mstp_burst_buffer {
+    RING_BUFFER Ring;
+    struct mstp_burst Bursts[MSTP_BURST_COUNT];
+    /* octets of the oldest burst that have been read - reader only */
+    uint16_t Offset;
+    /* bursts that were dropped because the ring was full - writer only */
+    uint32_t Overruns;
+} MSTP_BURST_BUFFER;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BACNET_STACK_EXPORT
+void MSTP_Burst_Init(MSTP_BURST_BUFFER *b);
+BACNET_STACK_EXPORT
+void MSTP_Burst_Flush(MSTP_BURST_BUFFER *b);
+
+BACNET_STACK_EXPORT
+uint8_t *MSTP_Burst_Write_Buffer(MSTP_BURST_BUFFER *b);
+BACNET_STACK_EXPORT
+bool MSTP_Burst_Write_Commit(
+    MSTP_BURST_BUFFER *b, uint16_t length, uint32_t timestamp);
+BACNET_STACK_EXPORT
+unsigned MSTP_Burst_Write(
+    MSTP_BURST_BUFFER *b,
+    const uint8_t *data,
+    unsigned length,
+    uint32_t timestamp);
+
+BACNET_STACK_EXPORT
+bool MSTP_Burst_Read(
+    MSTP_BURST_BUFFER *b, uint8_t *data_register, uint32_t *timestamp);
+BACNET_STACK_EXPORT
+bool MSTP_Burst_Empty(const MSTP_BURST_BUFFER *b);
+BACNET_STACK_EXPORT
+uint32_t MSTP_Burst_Overruns(const MSTP_BURST_BUFFER *b);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
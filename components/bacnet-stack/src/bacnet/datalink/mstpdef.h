@@ -117,6 +117,12 @@ typedef enum MSTP_Auto_Baud_State {
 /* is executed: 50. */
 #define Npoll 50
 
+/* The number of maintenance Poll For Master cycles of an adaptive poll */
+/* between polls of the addresses up to Max_Master: not in the standard */
+#ifndef Npoll_full_range
+#define Npoll_full_range 8
+#endif
+
 /* The minimum number of polls received before a zero-config address */
 /* is claimed: 8. */
 #define Nmin_poll 8
@@ -495,7 +495,12 @@ int rp_ack_decode_service_request(
     }
     /* count the opening tag number length */
     apdu_len += len;
+#if (MAX_SEGMENTED_TRANSACTIONS)
+    /* the data of a segmented ACK is put back together by the TSM */
+    if (data_len > MAX_SEGMENTED_APDU) {
+#else
     if (data_len > MAX_APDU) {
+#endif
         /* not enough size in application_data to store the data chunk */
         return BACNET_STATUS_ERROR;
     } else if (data) {
@@ -0,0 +1,146 @@
+/**
+ * @file
+ * @brief benchmark of the BACnet address cache: a storm of I-Am from
+ *  5000 devices into a cache of 255
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <time.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacaddr.h>
+#include <bacnet/iam.h>
+#include <bacnet/basic/binding/address.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+/* a B/IP address for each device of the network */
+static void set_bip_address(uint32_t device_id, BACNET_ADDRESS *dest)
+{
+    uint16_t port = 0xBAC0;
+
+    dest->mac_len = 6;
+    dest->mac[0] = 10;
+    dest->mac[1] = (uint8_t)(device_id >> 16);
+    dest->mac[2] = (uint8_t)(device_id >> 8);
+    dest->mac[3] = (uint8_t)device_id;
+    dest->mac[4] = (uint8_t)(port >> 8);
+    dest->mac[5] = (uint8_t)port;
+    dest->net = 0;
+    dest->len = 0;
+}
+
+/* time in nanoseconds */
+static uint64_t test_nanoseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+#define TEST_STORM_DEVICES 5000
+
+/* each device of the network sends an I-Am, handled as
+   handler_i_am_add() does; returns the CPU time in nanoseconds */
+static uint64_t test_i_am_storm(uint32_t first, uint32_t count)
+{
+    static uint8_t apdu[TEST_STORM_DEVICES][MAX_APDU];
+    static BACNET_ADDRESS src[TEST_STORM_DEVICES];
+    uint32_t device_id = 0;
+    unsigned max_apdu = 0;
+    int segmentation = 0;
+    uint16_t vendor_id = 0;
+    uint64_t start;
+    uint32_t i;
+    int len;
+
+    for (i = 0; i < count; i++) {
+        (void)iam_encode_apdu(
+            apdu[i], first + i, 480, SEGMENTATION_NONE, 260);
+        set_bip_address(first + i, &src[i]);
+    }
+    start = test_nanoseconds();
+    for (i = 0; i < count; i++) {
+        len = bacnet_iam_request_decode(
+            &apdu[i][2], MAX_APDU - 2, &device_id, &max_apdu, &segmentation,
+            &vendor_id);
+        if (len > 0) {
+            address_add(device_id, max_apdu, &src[i]);
+        }
+    }
+
+    return test_nanoseconds() - start;
+}
+
+/**
+ * @brief A storm of I-Am from 5000 devices into a cache of 255: the
+ *  CPU time for each I-Am while the cache fills and then drops the least
+ *  recently used device for each new one, for each I-Am of a device that
+ *  is in the cache, and for each second of the cache timer
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(address_storm_tests, testAddressStormBenchmark)
+#else
+static void testAddressStormBenchmark(void)
+#endif
+{
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS test_address = { 0 };
+    uint32_t test_device_id = 0;
+    unsigned test_max_apdu = 0;
+    uint64_t storm_ns, renew_ns, timer_ns;
+    const unsigned seconds = 86400;
+    uint32_t first;
+    unsigned i;
+
+    address_init();
+    storm_ns = test_i_am_storm(1, TEST_STORM_DEVICES);
+    zassert_equal(address_count(), MAX_ADDRESS_CACHE, NULL);
+    /* the most recent devices are in the cache */
+    first = TEST_STORM_DEVICES - MAX_ADDRESS_CACHE + 1;
+    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+        zassert_true(
+            address_get_by_device(first + i, &test_max_apdu, &test_address),
+            NULL);
+        set_bip_address(first + i, &src);
+        zassert_true(address_get_device_id(&src, &test_device_id), NULL);
+        zassert_equal(test_device_id, first + i, NULL);
+    }
+    zassert_false(
+        address_get_by_device(first - 1, &test_max_apdu, &test_address), NULL);
+    renew_ns = test_i_am_storm(first, MAX_ADDRESS_CACHE);
+    zassert_equal(address_count(), MAX_ADDRESS_CACHE, NULL);
+    /* a day of the cache timer: an I-Am renews an entry for a day */
+    timer_ns = test_nanoseconds();
+    for (i = 0; i <= seconds; i++) {
+        address_cache_timer(1);
+    }
+    timer_ns = test_nanoseconds() - timer_ns;
+    zassert_equal(address_count(), 0, NULL);
+    printf(
+        "I-Am storm of %u devices into a cache of %u: %.1f ns per I-Am; "
+        "%.1f ns per I-Am of a cached device; cache timer %.1f ns/s\n",
+        TEST_STORM_DEVICES, MAX_ADDRESS_CACHE,
+        (double)storm_ns / TEST_STORM_DEVICES,
+        (double)renew_ns / MAX_ADDRESS_CACHE, (double)timer_ns / seconds);
+}
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(address_storm_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        address_storm_tests, ztest_unit_test(testAddressStormBenchmark));
+
+    ztest_run_test_suite(address_storm_tests);
+}
+#endif
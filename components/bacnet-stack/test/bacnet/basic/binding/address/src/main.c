@@ -197,6 +197,147 @@ static void testAddress(void)
         zassert_equal(count, (MAX_ADDRESS_CACHE - i - 1), NULL);
     }
 }
+/* a B/IP address for each device of the network */
+static void set_bip_address(uint32_t device_id, BACNET_ADDRESS *dest)
+{
+    uint16_t port = 0xBAC0;
+
+    dest->mac_len = 6;
+    dest->mac[0] = 10;
+    dest->mac[1] = (uint8_t)(device_id >> 16);
+    dest->mac[2] = (uint8_t)(device_id >> 8);
+    dest->mac[3] = (uint8_t)device_id;
+    dest->mac[4] = (uint8_t)(port >> 8);
+    dest->mac[5] = (uint8_t)port;
+    dest->net = 0;
+    dest->len = 0;
+}
+
+/* an empty cache, without the static entries of the file */
+static void test_address_cache_clear(void)
+{
+#ifdef BACNET_ADDRESS_CACHE_FILE
+    (void)remove(Address_Cache_Filename);
+#endif
+    address_init();
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(address_tests, testAddressTimeToLive)
+#else
+static void testAddressTimeToLive(void)
+#endif
+{
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS test_address = { 0 };
+    uint32_t test_device_id = 0;
+    uint32_t device_ttl = 0;
+    unsigned test_max_apdu = 0;
+    unsigned i;
+
+    test_address_cache_clear();
+    /* an I-Am that nobody asked for is kept for an hour */
+    set_bip_address(1, &src);
+    address_add(1, 480, &src);
+    zassert_true(
+        address_device_get_by_index(0, NULL, &device_ttl, NULL, NULL), NULL);
+    zassert_equal(device_ttl, 3600, NULL);
+    address_cache_timer(3599);
+    zassert_true(address_get_by_device(1, &test_max_apdu, &test_address), NULL);
+    address_cache_timer(1);
+    zassert_true(
+        address_device_get_by_index(0, NULL, &device_ttl, NULL, NULL), NULL);
+    zassert_equal(device_ttl, 0, NULL);
+    address_cache_timer(1);
+    zassert_false(
+        address_get_by_device(1, &test_max_apdu, &test_address), NULL);
+    zassert_false(address_get_device_id(&src, &test_device_id), NULL);
+    zassert_equal(address_count(), 0, NULL);
+    /* a bind request, then the I-Am that binds it for a day */
+    zassert_false(address_bind_request(2, &test_max_apdu, &test_address), NULL);
+    zassert_equal(address_count(), 0, NULL);
+    set_bip_address(2, &src);
+    address_add(2, 1476, &src);
+    zassert_true(address_bind_request(2, &test_max_apdu, &test_address), NULL);
+    zassert_equal(test_max_apdu, 1476, NULL);
+    zassert_true(bacnet_address_same(&test_address, &src), NULL);
+    for (i = 0; i < 86400; i += 1000) {
+        address_cache_timer(1000);
+    }
+    zassert_false(address_bind_request(2, &test_max_apdu, &test_address), NULL);
+    address_remove_device(2);
+    /* a time to live longer than the timer wheel, and a static entry */
+    set_bip_address(3, &src);
+    address_add(3, 480, &src);
+    address_set_device_TTL(3, 300000UL, false);
+    set_bip_address(4, &src);
+    address_add(4, 480, &src);
+    address_set_device_TTL(4, 0, true);
+    for (i = 0; i < 300000UL; i += 60000UL) {
+        address_cache_timer(60000U);
+    }
+    zassert_true(address_get_by_device(3, &test_max_apdu, &test_address), NULL);
+    address_cache_timer(1);
+    zassert_false(
+        address_get_by_device(3, &test_max_apdu, &test_address), NULL);
+    zassert_true(address_get_by_device(4, &test_max_apdu, &test_address), NULL);
+    zassert_true(address_get_device_id(&src, &test_device_id), NULL);
+    zassert_equal(test_device_id, 4, NULL);
+    zassert_equal(address_count(), 1, NULL);
+    address_remove_device(4);
+    zassert_equal(address_count(), 0, NULL);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(address_tests, testAddressLeastRecentlyUsed)
+#else
+static void testAddressLeastRecentlyUsed(void)
+#endif
+{
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS test_address = { 0 };
+    unsigned test_max_apdu = 0;
+    uint32_t device_id;
+
+    test_address_cache_clear();
+    for (device_id = 1; device_id <= MAX_ADDRESS_CACHE; device_id++) {
+        set_bip_address(device_id, &src);
+        address_add(device_id, 480, &src);
+    }
+    zassert_equal(address_count(), MAX_ADDRESS_CACHE, NULL);
+    /* the first device is used, so the second one makes room */
+    zassert_true(address_get_by_device(1, &test_max_apdu, &test_address), NULL);
+    set_bip_address(MAX_ADDRESS_CACHE + 1, &src);
+    address_add(MAX_ADDRESS_CACHE + 1, 480, &src);
+    zassert_equal(address_count(), MAX_ADDRESS_CACHE, NULL);
+    zassert_true(address_get_by_device(1, &test_max_apdu, &test_address), NULL);
+    zassert_false(
+        address_get_by_device(2, &test_max_apdu, &test_address), NULL);
+    zassert_true(
+        address_get_by_device(
+            MAX_ADDRESS_CACHE + 1, &test_max_apdu, &test_address),
+        NULL);
+    /* protected and static entries are not dropped */
+    address_protected_entry_index_set(3);
+    address_set_device_TTL(4, 0, true);
+    for (device_id = 1000; device_id < 1000 + MAX_ADDRESS_CACHE; device_id++) {
+        set_bip_address(device_id, &src);
+        address_add(device_id, 480, &src);
+    }
+    zassert_true(address_get_by_device(1, &test_max_apdu, &test_address), NULL);
+    zassert_true(
+        address_get_by_device(
+            MAX_ADDRESS_CACHE + 1, &test_max_apdu, &test_address),
+        NULL);
+    zassert_true(address_get_by_device(3, &test_max_apdu, &test_address), NULL);
+    zassert_true(address_get_by_device(4, &test_max_apdu, &test_address), NULL);
+    zassert_false(
+        address_get_by_device(5, &test_max_apdu, &test_address), NULL);
+    zassert_equal(address_count(), MAX_ADDRESS_CACHE, NULL);
+    test_address_cache_clear();
+    zassert_equal(address_count(), 0, NULL);
+}
+
 /**
  * @}
  */
@@ -209,11 +350,15 @@ void test_main(void)
 #ifdef BACNET_ADDRESS_CACHE_FILE
     ztest_test_suite(
         address_tests, ztest_unit_test(testAddressFile),
-        ztest_unit_test(testAddress));
+        ztest_unit_test(testAddress), ztest_unit_test(testAddressTimeToLive),
+        ztest_unit_test(testAddressLeastRecentlyUsed));
 
     ztest_run_test_suite(address_tests);
 #else
-    ztest_test_suite(address_tests, ztest_unit_test(testAddress));
+    ztest_test_suite(
+        address_tests, ztest_unit_test(testAddress),
+        ztest_unit_test(testAddressTimeToLive),
+        ztest_unit_test(testAddressLeastRecentlyUsed));
 
     ztest_run_test_suite(address_tests);
 #endif
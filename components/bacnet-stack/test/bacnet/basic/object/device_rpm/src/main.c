@@ -0,0 +1,610 @@
+/**
+ * @file
+ * @brief benchmark of ReadPropertyMultiple through the Device object:
+ *  throughput of a 40-property request, and of ALL requests for 100
+ *  objects with and without the cache of encoded results.  Build
+ *  test_device_rpm_linear for the same benchmark with the object type
+ *  lookup walking the table.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/rpm.h>
+#include <bacnet/npdu.h>
+#include <bacnet/basic/services.h>
+#include <bacnet/basic/object/device.h>
+#include <bacnet/basic/object/ai.h>
+#include <bacnet/basic/object/av.h>
+#include <bacnet/basic/object/bi.h>
+#include <bacnet/basic/object/bo.h>
+#include <bacnet/basic/object/bv.h>
+#include <bacnet/datalink/datalink.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_RPM_PROPERTIES 40
+/* objects of each type read with ALL */
+#define TEST_RPM_ALL_INSTANCES 20
+
+uint8_t Handler_Transmit_Buffer[MAX_PDU];
+
+static unsigned Test_Complex_Acks;
+static unsigned Test_Other_Replies;
+/* the last reply */
+static uint8_t Test_Reply[MAX_PDU];
+static unsigned Test_Reply_Len;
+
+/* the objects save their configuration to NVS on the ESP32 */
+void bacnet_nvs_save_ai_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_ai_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_ai_cov_increment(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_av_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_av_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_av_units(uint32_t instance, uint16_t units)
+{
+    (void)instance;
+    (void)units;
+}
+
+void bacnet_nvs_save_av_pv(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_av_cov_increment(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_bi_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bi_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bo_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bo_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_pv(uint32_t instance, uint8_t value)
+{
+    (void)instance;
+    (void)value;
+}
+
+/* the network port objects are not in this build */
+uint32_t Network_Port_Index_To_Instance(unsigned index)
+{
+    (void)index;
+    return BACNET_MAX_INSTANCE;
+}
+
+/* datalink stubs that count the replies */
+void datalink_get_my_address(BACNET_ADDRESS *my_address)
+{
+    bacnet_address_init(my_address, NULL, 0, NULL);
+}
+
+int datalink_send_pdu(
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    int offset;
+
+    (void)dest;
+    if (pdu_len <= sizeof(Test_Reply)) {
+        memcpy(Test_Reply, pdu, pdu_len);
+        Test_Reply_Len = pdu_len;
+    }
+    offset = npdu_decode(pdu, NULL, NULL, npdu_data);
+    if ((offset > 0) && ((pdu[offset] & 0xF0) == PDU_TYPE_COMPLEX_ACK) &&
+        (pdu[offset + 2] == SERVICE_CONFIRMED_READ_PROP_MULTIPLE)) {
+        Test_Complex_Acks++;
+    } else {
+        Test_Other_Replies++;
+    }
+
+    return (int)pdu_len;
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t test_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Encode one object of the request with four of its properties
+ */
+static int test_rpm_object_encode(
+    uint8_t *apdu,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID fourth_property)
+{
+    int len = 0;
+
+    len += rpm_encode_apdu_object_begin(
+        &apdu[len], object_type, object_instance);
+    len += rpm_encode_apdu_object_property(
+        &apdu[len], PROP_OBJECT_NAME, BACNET_ARRAY_ALL);
+    len += rpm_encode_apdu_object_property(
+        &apdu[len], PROP_PRESENT_VALUE, BACNET_ARRAY_ALL);
+    len += rpm_encode_apdu_object_property(
+        &apdu[len], PROP_STATUS_FLAGS, BACNET_ARRAY_ALL);
+    len += rpm_encode_apdu_object_property(
+        &apdu[len], fourth_property, BACNET_ARRAY_ALL);
+    len += rpm_encode_apdu_object_end(&apdu[len]);
+
+    return len;
+}
+
+/**
+ * @brief Encode the service request of a ReadPropertyMultiple of 40
+ *  properties: 4 properties each of 10 objects of every type
+ */
+static int test_rpm_request_encode(uint8_t *apdu)
+{
+    int len = 0;
+    uint32_t instance;
+
+    for (instance = 1; instance <= 2; instance++) {
+        len += test_rpm_object_encode(
+            &apdu[len], OBJECT_ANALOG_VALUE, instance, PROP_UNITS);
+        len += test_rpm_object_encode(
+            &apdu[len], OBJECT_BINARY_VALUE, instance, PROP_OUT_OF_SERVICE);
+        len += test_rpm_object_encode(
+            &apdu[len], OBJECT_ANALOG_INPUT, instance, PROP_UNITS);
+        len += test_rpm_object_encode(
+            &apdu[len], OBJECT_BINARY_INPUT, instance, PROP_POLARITY);
+        len += test_rpm_object_encode(
+            &apdu[len], OBJECT_BINARY_OUTPUT, instance, PROP_POLARITY);
+    }
+
+    return len;
+}
+
+/**
+ * @brief Encode the service request of a ReadPropertyMultiple of ALL
+ *  properties of one object
+ */
+static int test_rpm_all_request_encode(
+    uint8_t *apdu, BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    int len = 0;
+
+    len += rpm_encode_apdu_object_begin(
+        &apdu[len], object_type, object_instance);
+    len += rpm_encode_apdu_object_property(
+        &apdu[len], PROP_ALL, BACNET_ARRAY_ALL);
+    len += rpm_encode_apdu_object_end(&apdu[len]);
+
+    return len;
+}
+
+/**
+ * @brief Read ALL properties of one object, and keep the reply
+ * @return the length of the reply, in Test_Reply
+ */
+static unsigned test_rpm_all_read(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance, uint8_t *reply)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_MAC_ADDRESS mac = { .len = 1, .adr = { 42 } };
+    int len;
+
+    len = test_rpm_all_request_encode(apdu, object_type, object_instance);
+    bacnet_address_init(&src, &mac, 0, NULL);
+    service_data.invoke_id = 1;
+    service_data.max_resp = MAX_APDU;
+    Test_Reply_Len = 0;
+    handler_read_property_multiple(apdu, (uint16_t)len, &src, &service_data);
+    if (reply) {
+        memcpy(reply, Test_Reply, Test_Reply_Len);
+    }
+
+    return Test_Reply_Len;
+}
+
+/**
+ * @brief Read ALL properties of one object twice: from the cache, then
+ *  encoded again with the cache dropped, and check that they are equal
+ * @return true if the first read was copied from the cache
+ */
+static bool test_rpm_all_cached(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    uint8_t cached[MAX_PDU];
+    unsigned cached_len, len;
+    uint32_t hits, misses;
+    uint32_t hits_before;
+
+    rpm_cache_statistics(&hits_before, NULL);
+    cached_len = test_rpm_all_read(object_type, object_instance, cached);
+    rpm_cache_statistics(&hits, &misses);
+    rpm_cache_invalidate();
+    len = test_rpm_all_read(object_type, object_instance, NULL);
+    zassert_true(len > 0, NULL);
+    zassert_equal(len, cached_len, NULL);
+    zassert_mem_equal(Test_Reply, cached, len, NULL);
+    /* leave the results of the fresh encoding in the cache */
+
+    return hits != hits_before;
+}
+
+static void test_device_objects_create(void)
+{
+    uint32_t instance;
+
+    Device_Init(NULL);
+    for (instance = 1; instance <= 2; instance++) {
+        Analog_Value_Create(instance);
+        Binary_Value_Create(instance);
+        Analog_Input_Create(instance);
+        Binary_Input_Create(instance);
+        Binary_Output_Create(instance);
+    }
+}
+
+/**
+ * @brief Every standard and proprietary type in the table is found, and
+ *  every other type is not
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(device_rpm_tests, test_device_object_functions_find)
+#else
+static void test_device_object_functions_find(void)
+#endif
+{
+    struct object_functions *pObject;
+    struct object_functions *pTable;
+    unsigned type;
+
+    test_device_objects_create();
+    pTable = Device_Object_Functions();
+    while (pTable->Object_Type < MAX_BACNET_OBJECT_TYPE) {
+        pObject = Device_Object_Functions_Find(pTable->Object_Type);
+        zassert_equal(pObject, pTable, NULL);
+        pTable++;
+    }
+    for (type = 0; type < MAX_BACNET_OBJECT_TYPE; type++) {
+        pObject = Device_Object_Functions_Find((BACNET_OBJECT_TYPE)type);
+        if (pObject) {
+            zassert_equal(pObject->Object_Type, type, NULL);
+        }
+    }
+    zassert_is_null(Device_Object_Functions_Find(OBJECT_LOOP), NULL);
+    zassert_is_null(Device_Object_Functions_Find(OBJECT_PROPRIETARY_MIN), NULL);
+    zassert_is_null(Device_Objects_RR_Info(OBJECT_ANALOG_VALUE), NULL);
+    zassert_not_null(Device_Objects_RR_Info(OBJECT_DEVICE), NULL);
+}
+
+/**
+ * @brief Measure the requests per second of a 40-property
+ *  ReadPropertyMultiple
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(device_rpm_tests, test_device_rpm_benchmark)
+#else
+static void test_device_rpm_benchmark(void)
+#endif
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_MAC_ADDRESS mac = { .len = 1, .adr = { 42 } };
+    const unsigned iterations = 20000;
+    uint64_t start, elapsed_ns, find_ns;
+    unsigned n;
+    int len;
+
+    test_device_objects_create();
+    len = test_rpm_request_encode(apdu);
+    zassert_true(len > 0, NULL);
+    bacnet_address_init(&src, &mac, 0, NULL);
+    service_data.invoke_id = 1;
+    service_data.max_resp = MAX_APDU;
+    Test_Complex_Acks = 0;
+    Test_Other_Replies = 0;
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        handler_read_property_multiple(
+            apdu, (uint16_t)len, &src, &service_data);
+    }
+    elapsed_ns = test_clock_ns() - start;
+    zassert_equal(Test_Complex_Acks, iterations, NULL);
+    zassert_equal(Test_Other_Replies, 0, NULL);
+    /* the lookup of the last object type in the table */
+    start = test_clock_ns();
+    for (n = 0; n < iterations * 10; n++) {
+        zassert_not_null(
+            Device_Object_Functions_Find(OBJECT_BINARY_OUTPUT), NULL);
+    }
+    find_ns = test_clock_ns() - start;
+    printf(
+        "RPM %u properties, %s object type lookup: %6.0f ns/request, "
+        "%6.0f requests/s, %3.0f ns/lookup\n",
+        TEST_RPM_PROPERTIES,
+#if defined(DEVICE_OBJECT_TYPE_INDEX) && (DEVICE_OBJECT_TYPE_INDEX == 0)
+        "table walk",
+#else
+        "indexed",
+#endif
+        (double)elapsed_ns / iterations,
+        (double)iterations * 1000000000.0 / (double)elapsed_ns,
+        (double)find_ns / (iterations * 10));
+}
+
+/**
+ * @brief The cached ALL results are the same octets as encoding each
+ *  property, and a change of the object or of the database revision is
+ *  seen by the next read
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(device_rpm_tests, test_device_rpm_cache)
+#else
+static void test_device_rpm_cache(void)
+#endif
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data = { 0 };
+    BACNET_APPLICATION_DATA_VALUE value = { 0 };
+    uint8_t first[MAX_PDU];
+    unsigned first_len;
+    uint32_t hits, misses;
+    uint32_t misses_before;
+
+    test_device_objects_create();
+    zassert_true(rpm_cache_object_type(OBJECT_ANALOG_INPUT), NULL);
+    zassert_false(rpm_cache_object_type(OBJECT_DEVICE), NULL);
+    rpm_cache_invalidate();
+    rpm_cache_statistics(NULL, &misses_before);
+    first_len = test_rpm_all_read(OBJECT_ANALOG_INPUT, 1, first);
+    rpm_cache_statistics(&hits, &misses);
+    zassert_equal(misses, misses_before + 1, NULL);
+    zassert_true(test_rpm_all_cached(OBJECT_ANALOG_INPUT, 1), NULL);
+    zassert_equal(Test_Reply_Len, first_len, NULL);
+    zassert_mem_equal(Test_Reply, first, first_len, NULL);
+    /* a new present value is patched into the cached results */
+    Analog_Input_Present_Value_Set(1, 42.5f);
+    zassert_true(test_rpm_all_cached(OBJECT_ANALOG_INPUT, 1), NULL);
+    zassert_equal(Test_Reply_Len, first_len, NULL);
+    zassert_true(memcmp(Test_Reply, first, first_len) != 0, NULL);
+    zassert_false(test_rpm_all_cached(OBJECT_BINARY_VALUE, 2), NULL);
+    Binary_Value_Present_Value_Set(2, BINARY_ACTIVE);
+    zassert_true(test_rpm_all_cached(OBJECT_BINARY_VALUE, 2), NULL);
+    /* other changes drop the cached results of the object */
+    zassert_false(test_rpm_all_cached(OBJECT_ANALOG_INPUT, 2), NULL);
+    zassert_true(test_rpm_all_cached(OBJECT_ANALOG_INPUT, 2), NULL);
+    Analog_Input_Units_Set(2, UNITS_PERCENT);
+    zassert_false(test_rpm_all_cached(OBJECT_ANALOG_INPUT, 2), NULL);
+    Analog_Input_Out_Of_Service_Set(2, true);
+    zassert_false(test_rpm_all_cached(OBJECT_ANALOG_INPUT, 2), NULL);
+    zassert_false(test_rpm_all_cached(OBJECT_BINARY_OUTPUT, 1), NULL);
+    Binary_Output_Present_Value_Set(1, BINARY_ACTIVE, 8);
+    zassert_false(test_rpm_all_cached(OBJECT_BINARY_OUTPUT, 1), NULL);
+    Binary_Output_Present_Value_Relinquish(1, 8);
+    zassert_false(test_rpm_all_cached(OBJECT_BINARY_OUTPUT, 1), NULL);
+    zassert_true(test_rpm_all_cached(OBJECT_BINARY_OUTPUT, 1), NULL);
+    /* and so does a WriteProperty */
+    zassert_false(test_rpm_all_cached(OBJECT_ANALOG_VALUE, 1), NULL);
+    zassert_true(test_rpm_all_cached(OBJECT_ANALOG_VALUE, 1), NULL);
+    value.tag = BACNET_APPLICATION_TAG_BOOLEAN;
+    value.type.Boolean = true;
+    wp_data.object_type = OBJECT_ANALOG_VALUE;
+    wp_data.object_instance = 1;
+    wp_data.object_property = PROP_OUT_OF_SERVICE;
+    wp_data.array_index = BACNET_ARRAY_ALL;
+    wp_data.priority = BACNET_NO_PRIORITY;
+    wp_data.application_data_len =
+        bacapp_encode_application_data(wp_data.application_data, &value);
+    zassert_true(Device_Write_Property(&wp_data), NULL);
+    zassert_false(test_rpm_all_cached(OBJECT_ANALOG_VALUE, 1), NULL);
+    /* a new database revision drops every cached result */
+    zassert_false(test_rpm_all_cached(OBJECT_BINARY_INPUT, 1), NULL);
+    zassert_true(test_rpm_all_cached(OBJECT_BINARY_INPUT, 1), NULL);
+    Device_Inc_Database_Revision();
+    zassert_false(test_rpm_all_cached(OBJECT_BINARY_INPUT, 1), NULL);
+    zassert_true(test_rpm_all_cached(OBJECT_BINARY_INPUT, 1), NULL);
+}
+
+/**
+ * @brief Measure the requests per second, and the CPU time per request,
+ *  of ReadPropertyMultiple ALL for each of 100 objects: encoded every
+ *  time, copied from the cache, and copied with a new present value
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(device_rpm_tests, test_device_rpm_all_benchmark)
+#else
+static void test_device_rpm_all_benchmark(void)
+#endif
+{
+    static const BACNET_OBJECT_TYPE types[] = {
+        OBJECT_ANALOG_VALUE, OBJECT_BINARY_VALUE, OBJECT_ANALOG_INPUT,
+        OBJECT_BINARY_INPUT, OBJECT_BINARY_OUTPUT
+    };
+    static const char *modes[] = { "encoded", "cached", "new value" };
+    const unsigned objects = TEST_RPM_ALL_INSTANCES * 5;
+    const unsigned sweeps = 200;
+    uint8_t apdu[TEST_RPM_ALL_INSTANCES * 5][16];
+    int apdu_len[TEST_RPM_ALL_INSTANCES * 5];
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_MAC_ADDRESS mac = { .len = 1, .adr = { 42 } };
+    uint64_t start, cpu, elapsed_ns, cpu_ns;
+    uint32_t hits, misses, hits_before, misses_before;
+    unsigned mode, sweep, i, t;
+    uint32_t instance;
+
+    test_device_objects_create();
+    for (instance = 1; instance <= TEST_RPM_ALL_INSTANCES; instance++) {
+        Analog_Value_Create(instance);
+        Binary_Value_Create(instance);
+        Analog_Input_Create(instance);
+        Binary_Input_Create(instance);
+        Binary_Output_Create(instance);
+    }
+    i = 0;
+    for (t = 0; t < 5; t++) {
+        for (instance = 1; instance <= TEST_RPM_ALL_INSTANCES; instance++) {
+            apdu_len[i] =
+                test_rpm_all_request_encode(apdu[i], types[t], instance);
+            i++;
+        }
+    }
+    bacnet_address_init(&src, &mac, 0, NULL);
+    service_data.invoke_id = 1;
+    service_data.max_resp = MAX_APDU;
+    for (mode = 0; mode < 3; mode++) {
+        rpm_cache_invalidate();
+        Test_Complex_Acks = 0;
+        Test_Other_Replies = 0;
+        rpm_cache_statistics(&hits_before, &misses_before);
+        start = test_clock_ns();
+        cpu = test_cpu_ns();
+        for (sweep = 0; sweep < sweeps; sweep++) {
+            if (mode == 0) {
+                rpm_cache_invalidate();
+            } else if (mode == 2) {
+                /* every analog value changes between polls */
+                for (instance = 1; instance <= TEST_RPM_ALL_INSTANCES;
+                     instance++) {
+                    Analog_Value_Present_Value_Set(
+                        instance, (float)sweep, BACNET_MAX_PRIORITY);
+                    Analog_Input_Present_Value_Set(instance, (float)sweep);
+                }
+            }
+            for (i = 0; i < objects; i++) {
+                handler_read_property_multiple(
+                    apdu[i], (uint16_t)apdu_len[i], &src, &service_data);
+            }
+        }
+        cpu_ns = test_cpu_ns() - cpu;
+        elapsed_ns = test_clock_ns() - start;
+        rpm_cache_statistics(&hits, &misses);
+        zassert_equal(Test_Complex_Acks, sweeps * objects, NULL);
+        zassert_equal(Test_Other_Replies, 0, NULL);
+        printf(
+            "RPM ALL of %u objects, %-9s: %6.0f ns/request, "
+            "%7.0f requests/s, %6.0f ns CPU/request, %3.0f%% hits\n",
+            objects, modes[mode], (double)elapsed_ns / (sweeps * objects),
+            (double)(sweeps * objects) * 1000000000.0 / (double)elapsed_ns,
+            (double)cpu_ns / (sweeps * objects),
+            100.0 * (double)(hits - hits_before) /
+                (double)((hits - hits_before) + (misses - misses_before)));
+    }
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(device_rpm_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        device_rpm_tests, ztest_unit_test(test_device_object_functions_find),
+        ztest_unit_test(test_device_rpm_benchmark),
+        ztest_unit_test(test_device_rpm_cache),
+        ztest_unit_test(test_device_rpm_all_benchmark));
+
+    ztest_run_test_suite(device_rpm_tests);
+}
+#endif
@@ -0,0 +1,269 @@
+/**
+ * @file
+ * @brief test and benchmark of the object name index: lookup cost
+ *  from 20 to 5000 objects, compared with a walk of the object list.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/bacstr.h>
+#include <bacnet/basic/object/name_index.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_OBJECTS_MAX 5000
+
+/* simulated object table: the names are owned by the objects */
+static char Test_Object_Name[TEST_OBJECTS_MAX][32];
+static unsigned Test_Object_Count;
+static unsigned Test_Changed_Count;
+
+static BACNET_OBJECT_TYPE test_object_type(unsigned index)
+{
+    static const BACNET_OBJECT_TYPE types[] = { OBJECT_ANALOG_VALUE,
+                                                OBJECT_BINARY_VALUE,
+                                                OBJECT_ANALOG_INPUT };
+
+    return types[index % 3];
+}
+
+static bool test_object_name(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_CHARACTER_STRING *object_name)
+{
+    if ((object_instance < Test_Object_Count) &&
+        (test_object_type(object_instance) == object_type)) {
+        return characterstring_init_ansi(
+            object_name, Test_Object_Name[object_instance]);
+    }
+
+    return false;
+}
+
+static bool test_object_name_match(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    const BACNET_CHARACTER_STRING *object_name)
+{
+    BACNET_CHARACTER_STRING name;
+
+    if (test_object_name(object_type, object_instance, &name)) {
+        return characterstring_same(object_name, &name);
+    }
+
+    return false;
+}
+
+static void test_object_name_changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    BACNET_CHARACTER_STRING name;
+
+    Test_Changed_Count++;
+    if (test_object_name(object_type, object_instance, &name)) {
+        Object_Name_Index_Set(object_type, object_instance, &name);
+    }
+}
+
+/**
+ * @brief The previous Device_Valid_Object_Name(): fetch and compare the
+ *  name of every object in the list
+ */
+static bool test_object_list_find(
+    const BACNET_CHARACTER_STRING *object_name,
+    BACNET_OBJECT_TYPE *object_type,
+    uint32_t *object_instance)
+{
+    BACNET_CHARACTER_STRING name;
+    unsigned i;
+
+    for (i = 0; i < Test_Object_Count; i++) {
+        if (test_object_name(test_object_type(i), i, &name) &&
+            characterstring_same(object_name, &name)) {
+            *object_type = test_object_type(i);
+            *object_instance = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void test_objects_create(unsigned count)
+{
+    unsigned i;
+
+    Object_Name_Index_Cleanup();
+    Object_Name_Index_Changed_Callback_Set(test_object_name_changed);
+    Test_Object_Count = count;
+    for (i = 0; i < count; i++) {
+        snprintf(
+            Test_Object_Name[i], sizeof(Test_Object_Name[i]),
+            "Zone %u Temperature", i);
+        Object_Name_Index_Changed(test_object_type(i), i);
+    }
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Names are found after create, rename and delete
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(name_index_tests, test_name_index_rename)
+#else
+static void test_name_index_rename(void)
+#endif
+{
+    BACNET_CHARACTER_STRING name;
+    BACNET_OBJECT_TYPE type = OBJECT_NONE;
+    uint32_t instance = 0;
+    bool status;
+
+    Test_Changed_Count = 0;
+    test_objects_create(100);
+    zassert_equal(Test_Changed_Count, 100, NULL);
+    zassert_equal(Object_Name_Index_Count(), 100, NULL);
+    characterstring_init_ansi(&name, "Zone 42 Temperature");
+    status = Object_Name_Index_Find(
+        &name, test_object_name_match, &type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(type, test_object_type(42), NULL);
+    zassert_equal(instance, 42, NULL);
+    /* the name buffer is overwritten before the object reports the rename,
+       so the old entry is found by object identifier */
+    snprintf(Test_Object_Name[42], sizeof(Test_Object_Name[42]), "Lobby");
+    Object_Name_Index_Changed(test_object_type(42), 42);
+    zassert_equal(Object_Name_Index_Count(), 100, NULL);
+    status = Object_Name_Index_Find(
+        &name, test_object_name_match, &type, &instance);
+    zassert_false(status, NULL);
+    characterstring_init_ansi(&name, "Lobby");
+    status = Object_Name_Index_Find(
+        &name, test_object_name_match, &type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(instance, 42, NULL);
+    /* a stale entry is rejected by the match function */
+    snprintf(Test_Object_Name[42], sizeof(Test_Object_Name[42]), "Atrium");
+    status = Object_Name_Index_Find(
+        &name, test_object_name_match, &type, &instance);
+    zassert_false(status, NULL);
+    /* delete */
+    zassert_true(Object_Name_Index_Remove(test_object_type(42), 42), NULL);
+    zassert_false(Object_Name_Index_Remove(test_object_type(42), 42), NULL);
+    zassert_equal(Object_Name_Index_Count(), 99, NULL);
+    characterstring_init_ansi(&name, "Zone 43 Temperature");
+    status = Object_Name_Index_Find(
+        &name, test_object_name_match, NULL, NULL);
+    zassert_true(status, NULL);
+    /* the freed entry is reused */
+    snprintf(Test_Object_Name[42], sizeof(Test_Object_Name[42]), "Lobby");
+    Object_Name_Index_Changed(test_object_type(42), 42);
+    zassert_equal(Object_Name_Index_Count(), 100, NULL);
+    characterstring_init_ansi(&name, "Lobby");
+    status = Object_Name_Index_Find(
+        &name, test_object_name_match, &type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(instance, 42, NULL);
+    Object_Name_Index_Changed_Callback_Set(NULL);
+    Object_Name_Index_Cleanup();
+    zassert_equal(Object_Name_Index_Count(), 0, NULL);
+    status = Object_Name_Index_Find(
+        &name, test_object_name_match, &type, &instance);
+    zassert_false(status, NULL);
+}
+
+/**
+ * @brief Measure a lookup of a name that exists and of one that does
+ *  not, which is what every write of an Object_Name does
+ */
+static void test_name_index_lookup(unsigned count)
+{
+    BACNET_CHARACTER_STRING name[64];
+    BACNET_CHARACTER_STRING missing;
+    BACNET_OBJECT_TYPE type = OBJECT_NONE;
+    uint32_t instance = 0;
+    const unsigned iterations = 20000;
+    const unsigned list_iterations = 200;
+    uint64_t start, hit_ns, miss_ns, list_ns;
+    unsigned i, n;
+    bool status;
+
+    test_objects_create(count);
+    for (i = 0; i < 64; i++) {
+        characterstring_init_ansi(
+            &name[i], Test_Object_Name[(i * 7919U) % count]);
+    }
+    characterstring_init_ansi(&missing, "Zone 99999 Humidity");
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        status = Object_Name_Index_Find(
+            &name[n % 64], test_object_name_match, &type, &instance);
+        zassert_true(status, NULL);
+    }
+    hit_ns = test_clock_ns() - start;
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        status = Object_Name_Index_Find(
+            &missing, test_object_name_match, &type, &instance);
+        zassert_false(status, NULL);
+    }
+    miss_ns = test_clock_ns() - start;
+    start = test_clock_ns();
+    for (n = 0; n < list_iterations; n++) {
+        status = test_object_list_find(&missing, &type, &instance);
+        zassert_false(status, NULL);
+    }
+    list_ns = test_clock_ns() - start;
+    printf(
+        "object names %4u: index hit %5.0f ns, index miss %5.0f ns, "
+        "list walk miss %9.0f ns\n",
+        count, (double)hit_ns / iterations, (double)miss_ns / iterations,
+        (double)list_ns / list_iterations);
+    Object_Name_Index_Changed_Callback_Set(NULL);
+    Object_Name_Index_Cleanup();
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(name_index_tests, test_name_index_benchmark)
+#else
+static void test_name_index_benchmark(void)
+#endif
+{
+    test_name_index_lookup(20);
+    test_name_index_lookup(200);
+    test_name_index_lookup(1000);
+    test_name_index_lookup(5000);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(name_index_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        name_index_tests, ztest_unit_test(test_name_index_rename),
+        ztest_unit_test(test_name_index_benchmark));
+
+    ztest_run_test_suite(name_index_tests);
+}
+#endif
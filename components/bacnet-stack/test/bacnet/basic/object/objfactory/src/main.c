@@ -0,0 +1,559 @@
+/**
+ * @file
+ * @brief test the table-driven object factory and its string arena, and
+ *  report the heap used per object for 1000 mixed objects and the time
+ *  to encode their string properties for ReadPropertyMultiple
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/rp.h>
+#include <bacnet/basic/object/ai.h>
+#include <bacnet/basic/object/av.h>
+#include <bacnet/basic/object/bi.h>
+#include <bacnet/basic/object/bo.h>
+#include <bacnet/basic/object/bv.h>
+#include <bacnet/basic/object/objfactory.h>
+#include <bacnet/basic/sys/strarena.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_OBJECTS 1000
+/* the name and description buffers each object had before the arena */
+#define TEST_FIXED_STRINGS (65 + 129)
+/* times each string property of every object is read in the benchmark */
+#define TEST_READS 100
+
+/* the objects save their configuration to NVS on the ESP32 */
+void bacnet_nvs_save_ai_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_ai_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_ai_cov_increment(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_av_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_av_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_av_units(uint32_t instance, uint16_t units)
+{
+    (void)instance;
+    (void)units;
+}
+
+void bacnet_nvs_save_av_pv(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_av_cov_increment(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_bi_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bi_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bo_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bo_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_pv(uint32_t instance, uint8_t value)
+{
+    (void)instance;
+    (void)value;
+}
+
+/* the objects of the display, as in its object table */
+static const BACNET_OBJECT_DESCRIPTOR Test_Objects[] = {
+    BACNET_OBJECT_ANALOG_VALUE(
+        1, "AV1", "PM2.5 from PMS5003", UNITS_MICROGRAMS_PER_CUBIC_METER,
+        12.5f, 1.0f),
+    BACNET_OBJECT_BINARY_VALUE(
+        1, "BV1", "Binary Value 1", "ACTIVE", "INACTIVE", BINARY_ACTIVE),
+    BACNET_OBJECT_ANALOG_INPUT(
+        1, "AI1", "Analog Input 1", UNITS_DEGREES_CELSIUS, 21.0f, 0.5f),
+    BACNET_OBJECT_BINARY_INPUT(
+        1, "BI1", "Binary Input 1", "ACTIVE", "INACTIVE", BINARY_INACTIVE),
+    BACNET_OBJECT_BINARY_OUTPUT(
+        1, "PMS5003_SET", "PMS5003 Sleep Mode Control", "SLEEP", "AWAKE",
+        BINARY_ACTIVE),
+};
+
+#define TEST_OBJECT_COUNT (sizeof(Test_Objects) / sizeof(Test_Objects[0]))
+
+static void test_objects_cleanup(void)
+{
+    Analog_Value_Cleanup();
+    Binary_Value_Cleanup();
+    Analog_Input_Cleanup();
+    Binary_Input_Cleanup();
+    Binary_Output_Cleanup();
+}
+
+/* bytes of heap in use */
+static size_t test_heap_used(void)
+{
+#if defined(__GLIBC__)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Every object of the table is created with its properties, and
+ *  its strings in the arena rather than in the table
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(objfactory_tests, test_object_factory_create)
+#else
+static void test_object_factory_create(void)
+#endif
+{
+    BACNET_OBJECT_DESCRIPTOR unsupported = Test_Objects[0];
+    STRING_ARENA arena;
+    unsigned strings = 0;
+    size_t size, index_size;
+    char *data;
+    void *index;
+
+    size = Object_Factory_Arena_Size(Test_Objects, TEST_OBJECT_COUNT, &strings);
+    zassert_equal(strings, 16, NULL);
+    /* the second ACTIVE and INACTIVE take no room */
+    zassert_equal(
+        size,
+        (14 * STRING_ARENA_PREFIX) + 4 + 19 + 4 + 15 + 7 + 9 + 4 + 15 + 4 +
+            15 + 12 + 27 + 6 + 6,
+        NULL);
+    index_size = string_arena_index_size(strings);
+    data = malloc(size);
+    index = malloc(index_size);
+    zassert_not_null(data, NULL);
+    zassert_not_null(index, NULL);
+    string_arena_init(&arena, data, size);
+    string_arena_index_set(&arena, index, index_size);
+    zassert_equal(
+        Object_Factory_Create(Test_Objects, TEST_OBJECT_COUNT, &arena),
+        TEST_OBJECT_COUNT, NULL);
+    /* the state texts of BV1 and BI1 are stored once */
+    zassert_equal(arena.duplicates, 2, NULL);
+    zassert_equal(string_arena_free(&arena), 0, NULL);
+    zassert_true(
+        Binary_Value_Active_Text(1) == Binary_Input_Active_Text(1), NULL);
+    zassert_true(
+        Binary_Value_Inactive_Text(1) == Binary_Input_Inactive_Text(1), NULL);
+
+    zassert_equal(strcmp(Analog_Value_Name_ASCII(1), "AV1"), 0, NULL);
+    zassert_true(
+        string_arena_contains(&arena, Analog_Value_Name_ASCII(1)), NULL);
+    zassert_true(
+        string_arena_contains(&arena, Analog_Value_Description(1)), NULL);
+    zassert_equal(
+        Analog_Value_Units(1), UNITS_MICROGRAMS_PER_CUBIC_METER, NULL);
+    zassert_false(islessgreater(Analog_Value_Present_Value(1), 12.5f), NULL);
+    zassert_false(islessgreater(Analog_Value_COV_Increment(1), 1.0f), NULL);
+    zassert_equal(Binary_Value_Present_Value(1), BINARY_ACTIVE, NULL);
+    zassert_true(
+        string_arena_contains(&arena, Binary_Value_Name_ASCII(1)), NULL);
+    zassert_equal(Analog_Input_Units(1), UNITS_DEGREES_CELSIUS, NULL);
+    zassert_false(islessgreater(Analog_Input_Present_Value(1), 21.0f), NULL);
+    zassert_false(islessgreater(Analog_Input_COV_Increment(1), 0.5f), NULL);
+    zassert_equal(strcmp(Binary_Input_Description(1), "Binary Input 1"), 0,
+        NULL);
+    zassert_equal(strcmp(Binary_Output_Name_ASCII(1), "PMS5003_SET"), 0,
+        NULL);
+    zassert_equal(Binary_Output_Present_Value(1), BINARY_ACTIVE, NULL);
+    zassert_equal(
+        Object_Factory_Count(
+            Test_Objects, TEST_OBJECT_COUNT, OBJECT_BINARY_OUTPUT),
+        1, NULL);
+
+    /* no room left in the arena, and a type the factory does not make */
+    unsupported.object_instance = 2;
+    unsupported.name = "AV2";
+    zassert_false(Object_Factory_Object_Create(&unsupported, &arena), NULL);
+    zassert_false(Analog_Value_Valid_Instance(2), NULL);
+    unsupported.object_type = OBJECT_ANALOG_OUTPUT;
+    zassert_false(Object_Factory_Supported(OBJECT_ANALOG_OUTPUT), NULL);
+    zassert_false(Object_Factory_Object_Create(&unsupported, NULL), NULL);
+    zassert_true(Object_Factory_Supported(OBJECT_BINARY_INPUT), NULL);
+
+    test_objects_cleanup();
+    free(data);
+}
+
+/* A table of 1000 objects of the five types, mixed, whose strings are
+   freed with it */
+static BACNET_OBJECT_DESCRIPTOR *test_object_table(void)
+{
+    static const BACNET_OBJECT_TYPE types[] = {
+        OBJECT_ANALOG_VALUE, OBJECT_BINARY_VALUE, OBJECT_ANALOG_INPUT,
+        OBJECT_BINARY_INPUT, OBJECT_BINARY_OUTPUT
+    };
+    static const char *prefix[] = { "AV", "BV", "AI", "BI", "BO" };
+    BACNET_OBJECT_DESCRIPTOR *table;
+    char(*names)[16];
+    char(*descriptions)[48];
+    uint32_t instance;
+    unsigned i, type;
+
+    /* the strings follow the table in one block */
+    table = calloc(
+        1,
+        TEST_OBJECTS *
+            (sizeof(*table) + sizeof(*names) + sizeof(*descriptions)));
+    zassert_not_null(table, NULL);
+    names = (void *)&table[TEST_OBJECTS];
+    descriptions = (void *)&names[TEST_OBJECTS];
+    for (i = 0; i < TEST_OBJECTS; i++) {
+        type = i % 5;
+        instance = 1 + (i / 5);
+        snprintf(names[i], sizeof(names[i]), "%s%lu", prefix[type],
+            (unsigned long)instance);
+        snprintf(descriptions[i], sizeof(descriptions[i]),
+            "Point %lu of %s, floor %u", (unsigned long)instance,
+            prefix[type], 1 + (i % 7));
+        table[i].object_type = types[type];
+        table[i].object_instance = instance;
+        table[i].name = names[i];
+        table[i].description = descriptions[i];
+        if ((types[type] == OBJECT_ANALOG_VALUE) ||
+            (types[type] == OBJECT_ANALOG_INPUT)) {
+            table[i].units = UNITS_DEGREES_CELSIUS;
+            table[i].present_value = (float)i;
+            table[i].cov_increment = 1.0f;
+        } else {
+            table[i].active_text = "ACTIVE";
+            table[i].inactive_text = "INACTIVE";
+            table[i].present_value_binary = BINARY_INACTIVE;
+        }
+    }
+
+    return table;
+}
+
+/* Octets the strings of a table took when each was copied with its
+   terminator only, and not shared */
+static size_t test_object_table_plain_size(
+    const BACNET_OBJECT_DESCRIPTOR *table, size_t count)
+{
+    size_t size = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        size += strlen(table[i].name) + 1;
+        size += strlen(table[i].description) + 1;
+        if (table[i].active_text) {
+            size += strlen(table[i].active_text) + 1;
+            size += strlen(table[i].inactive_text) + 1;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * @brief Create 1000 objects of the five types, mixed, from a table whose
+ *  strings are freed afterwards, and report the heap used per object
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(objfactory_tests, test_object_factory_heap)
+#else
+static void test_object_factory_heap(void)
+#endif
+{
+    BACNET_OBJECT_DESCRIPTOR *table;
+    STRING_ARENA arena;
+    unsigned strings = 0;
+    char *data;
+    void *index;
+    size_t size, index_size, plain_size;
+    size_t heap_before, heap_objects, heap_total;
+
+    table = test_object_table();
+    heap_before = test_heap_used();
+    size = Object_Factory_Arena_Size(table, TEST_OBJECTS, &strings);
+    index_size = string_arena_index_size(strings);
+    data = malloc(size);
+    index = malloc(index_size);
+    zassert_not_null(data, NULL);
+    zassert_not_null(index, NULL);
+    string_arena_init(&arena, data, size);
+    string_arena_index_set(&arena, index, index_size);
+    zassert_equal(
+        Object_Factory_Create(table, TEST_OBJECTS, &arena), TEST_OBJECTS,
+        NULL);
+    /* the index is only needed while the objects are created */
+    string_arena_index_set(&arena, NULL, 0);
+    free(index);
+    heap_total = test_heap_used() - heap_before;
+    heap_objects = heap_total - size;
+    plain_size = test_object_table_plain_size(table, TEST_OBJECTS);
+    zassert_equal(string_arena_free(&arena), 0, NULL);
+
+    /* the objects no longer need the table */
+    memset(table, 0, TEST_OBJECTS * sizeof(*table));
+    free(table);
+    zassert_equal(Analog_Value_Count(), TEST_OBJECTS / 5, NULL);
+    zassert_equal(Binary_Output_Count(), TEST_OBJECTS / 5, NULL);
+    zassert_equal(strcmp(Analog_Value_Name_ASCII(200), "AV200"), 0, NULL);
+    zassert_equal(strcmp(Binary_Input_Name_ASCII(17), "BI17"), 0, NULL);
+    zassert_equal(
+        strcmp(Binary_Output_Description(3), "Point 3 of BO, floor 1"), 0,
+        NULL);
+    /* the state texts of 600 binary objects are stored once */
+    zassert_equal(arena.strings, 2 * TEST_OBJECTS + 2, NULL);
+    zassert_equal(arena.duplicates, (3 * TEST_OBJECTS / 5) * 2 - 2, NULL);
+
+    printf("objfactory: %u mixed AV, BV, AI, BI and BO objects\n",
+        TEST_OBJECTS);
+    printf("objfactory: %u strings, %u of them duplicates\n", strings,
+        arena.duplicates);
+    printf("objfactory: interned strings %zu octets, %.1f per object, "
+           "with their encoded tags (index while created: %zu octets)\n",
+        size, (double)size / TEST_OBJECTS, index_size);
+    printf("objfactory: plain strings %zu octets, %.1f per object "
+           "(fixed name and description buffers: %u)\n",
+        plain_size, (double)plain_size / TEST_OBJECTS, TEST_FIXED_STRINGS);
+    if (heap_total > 0) {
+        printf("objfactory: object heap %zu octets, %.1f per object\n",
+            heap_objects, (double)heap_objects / TEST_OBJECTS);
+        printf("objfactory: heap %zu octets, %.1f per object\n", heap_total,
+            (double)heap_total / TEST_OBJECTS);
+    }
+
+    test_objects_cleanup();
+    free(data);
+}
+
+/* nanoseconds of a monotonic clock */
+static uint64_t test_nanoseconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+/* Read the name, description and state texts of every object, as a
+   ReadPropertyMultiple of them would, and return the octets encoded */
+static size_t test_read_strings(
+    const BACNET_OBJECT_DESCRIPTOR *table, size_t count)
+{
+    static const BACNET_PROPERTY_ID properties[] = {
+        PROP_OBJECT_NAME, PROP_DESCRIPTION, PROP_ACTIVE_TEXT,
+        PROP_INACTIVE_TEXT
+    };
+    uint8_t apdu[MAX_APDU];
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    int (*read_property)(BACNET_READ_PROPERTY_DATA *);
+    size_t octets = 0;
+    size_t i, p, properties_count;
+    int len;
+
+    rpdata.application_data = apdu;
+    rpdata.application_data_len = sizeof(apdu);
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    for (i = 0; i < count; i++) {
+        rpdata.object_type = table[i].object_type;
+        rpdata.object_instance = table[i].object_instance;
+        properties_count = 4;
+        switch (table[i].object_type) {
+            case OBJECT_ANALOG_VALUE:
+                read_property = Analog_Value_Read_Property;
+                properties_count = 2;
+                break;
+            case OBJECT_ANALOG_INPUT:
+                read_property = Analog_Input_Read_Property;
+                properties_count = 2;
+                break;
+            case OBJECT_BINARY_VALUE:
+                read_property = Binary_Value_Read_Property;
+                break;
+            case OBJECT_BINARY_INPUT:
+                read_property = Binary_Input_Read_Property;
+                break;
+            default:
+                read_property = Binary_Output_Read_Property;
+                break;
+        }
+        for (p = 0; p < properties_count; p++) {
+            rpdata.object_property = properties[p];
+            len = read_property(&rpdata);
+            zassert_true(len > 0, NULL);
+            octets += (size_t)len;
+        }
+    }
+
+    return octets;
+}
+
+/**
+ * @brief Encode the string properties of 1000 objects with one copy of
+ *  their octets from the shared arena, and the usual way, and report the
+ *  time each takes
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(objfactory_tests, test_object_factory_read_strings)
+#else
+static void test_object_factory_read_strings(void)
+#endif
+{
+    BACNET_OBJECT_DESCRIPTOR *table;
+    STRING_ARENA arena;
+    unsigned strings = 0;
+    char *data;
+    void *index;
+    size_t size, index_size, octets, shared_octets = 0, plain_octets = 0;
+    uint64_t start, shared_ns, plain_ns;
+    unsigned reads, i;
+
+    table = test_object_table();
+    size = Object_Factory_Arena_Size(table, TEST_OBJECTS, &strings);
+    index_size = string_arena_index_size(strings);
+    data = malloc(size);
+    index = malloc(index_size);
+    zassert_not_null(data, NULL);
+    zassert_not_null(index, NULL);
+    string_arena_init(&arena, data, size);
+    string_arena_index_set(&arena, index, index_size);
+    zassert_equal(
+        Object_Factory_Create(table, TEST_OBJECTS, &arena), TEST_OBJECTS,
+        NULL);
+    string_arena_index_set(&arena, NULL, 0);
+    free(index);
+    reads = 0;
+    for (i = 0; i < TEST_OBJECTS; i++) {
+        reads += table[i].active_text ? 4 : 2;
+    }
+
+    string_arena_shared_set(&arena);
+    start = test_nanoseconds();
+    for (i = 0; i < TEST_READS; i++) {
+        shared_octets += test_read_strings(table, TEST_OBJECTS);
+    }
+    shared_ns = test_nanoseconds() - start;
+    string_arena_shared_set(NULL);
+    start = test_nanoseconds();
+    for (i = 0; i < TEST_READS; i++) {
+        plain_octets += test_read_strings(table, TEST_OBJECTS);
+    }
+    plain_ns = test_nanoseconds() - start;
+    /* both encode the same octets */
+    zassert_equal(shared_octets, plain_octets, NULL);
+    octets = shared_octets / TEST_READS;
+
+    printf("objfactory: %u string properties of %u objects, %zu octets\n",
+        reads, TEST_OBJECTS, octets);
+    printf("objfactory: read from the shared arena: %.1f ns per property\n",
+        (double)shared_ns / ((double)reads * TEST_READS));
+    printf("objfactory: read the usual way: %.1f ns per property\n",
+        (double)plain_ns / ((double)reads * TEST_READS));
+
+    test_objects_cleanup();
+    free(table);
+    free(data);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(objfactory_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        objfactory_tests, ztest_unit_test(test_object_factory_create),
+        ztest_unit_test(test_object_factory_heap),
+        ztest_unit_test(test_object_factory_read_strings));
+
+    ztest_run_test_suite(objfactory_tests);
+}
+#endif
@@ -0,0 +1,788 @@
+/**
+ * @file
+ * @brief test and benchmark of the compressed Trend Log record store:
+ *  records of each type read back by position and time, the oldest
+ *  records dropped when full, and bytes per sample and ReadRange By Time
+ *  latency of a logged PM2.5 value at 10k and 1M samples.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/bacdcode.h>
+#include <bacnet/bacdevobjpropref.h>
+#include <bacnet/datetime.h>
+#include <bacnet/basic/object/device.h>
+#include <bacnet/basic/object/trendlog.h>
+#include <bacnet/basic/object/trendlog_store.h>
+#include <bacnet/basic/sys/flashlog.h>
+#include "flash_file.h"
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_RECORDS 20000
+#define TEST_DEVICE_INSTANCE 260001
+#define TEST_FLASH_PATHNAME "test_trendlog_store.bin"
+#define TEST_FLASH_SIZE (256UL * 1024UL)
+#define TEST_FLASH_SEGMENT 4096UL
+#define TEST_FLASH_SAMPLES 20000
+
+static TRENDLOG_STORE Test_Store;
+static TRENDLOG_STORE Test_Copy;
+static FLASH_LOG_DRIVER Test_Flash_Driver = {
+    .read = flash_file_read,
+    .write = flash_file_write,
+    .erase = flash_file_erase,
+};
+static TL_DATA_REC Test_Records[TEST_RECORDS];
+static uint32_t Test_Random = 2463534242UL;
+/* the simulated device: its clock and the logged analog value */
+static bacnet_time_t Test_Time;
+static float Test_Value;
+
+static uint32_t test_random(void)
+{
+    Test_Random ^= Test_Random << 13;
+    Test_Random ^= Test_Random >> 17;
+    Test_Random ^= Test_Random << 5;
+
+    return Test_Random;
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+uint32_t Device_Object_Instance_Number(void)
+{
+    return TEST_DEVICE_INSTANCE;
+}
+
+bool Device_Valid_Object_Name(
+    const BACNET_CHARACTER_STRING *object_name,
+    BACNET_OBJECT_TYPE *object_type,
+    uint32_t *object_instance)
+{
+    (void)object_name;
+    (void)object_type;
+    (void)object_instance;
+    return true;
+}
+
+void Device_Inc_Database_Revision(void)
+{
+}
+
+bool Device_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
+{
+    (void)wp_data;
+    return false;
+}
+
+void Device_getCurrentDateTime(BACNET_DATE_TIME *DateTime)
+{
+    datetime_since_epoch_seconds(DateTime, Test_Time);
+}
+
+int Device_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
+{
+    BACNET_BIT_STRING bit_string;
+
+    if ((rpdata->object_type != OBJECT_ANALOG_VALUE) ||
+        (rpdata->object_instance != 1)) {
+        rpdata->error_class = ERROR_CLASS_OBJECT;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+        return BACNET_STATUS_ERROR;
+    }
+    if (rpdata->object_property == PROP_STATUS_FLAGS) {
+        bitstring_init(&bit_string);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_IN_ALARM, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_OVERRIDDEN, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_OUT_OF_SERVICE, false);
+        return encode_application_bitstring(
+            rpdata->application_data, &bit_string);
+    }
+
+    return encode_application_real(rpdata->application_data, Test_Value);
+}
+
+/**
+ * @brief Check a record read back from the store
+ */
+static void test_record_check(
+    const TL_DATA_REC *record, const TL_DATA_REC *expected)
+{
+    zassert_true(record->tTimeStamp == expected->tTimeStamp, NULL);
+    zassert_equal(record->ucRecType, expected->ucRecType, NULL);
+    zassert_equal(record->ucStatus, expected->ucStatus, NULL);
+    zassert_equal(
+        memcmp(&record->Datum, &expected->Datum, sizeof(record->Datum)), 0,
+        NULL);
+}
+
+/**
+ * @brief Make records of each type, changing in the ways the encoding
+ *  handles: runs, small steps, noise, new types and uneven times
+ */
+static void test_records_make(TL_DATA_REC *records, unsigned count)
+{
+    bacnet_time_t time = 1700000000;
+    uint32_t r;
+    unsigned i, phase;
+    float real = 20.0f;
+
+    for (i = 0; i < count; i++) {
+        memset(&records[i], 0, sizeof(records[i]));
+        r = test_random();
+        /* mostly even times, some late, some at the same time */
+        if ((r & 0x0F) == 0) {
+            time += r % 97;
+        } else if ((r & 0x0F) != 1) {
+            time += 2;
+        }
+        records[i].tTimeStamp = time;
+        records[i].ucStatus = ((r >> 8) & 0x3F) == 0 ? 0x81 : 0x80;
+        phase = (i / 500) % 12;
+        switch (phase) {
+            case 0:
+            case 1:
+                /* an integral value waiting for changes */
+                records[i].ucRecType = TL_TYPE_REAL;
+                if ((r >> 16) % 4 == 0) {
+                    real += (float)((int)((r >> 20) % 3) - 1);
+                } else if ((r >> 16) % 16 == 1) {
+                    real += (float)((int)((r >> 20) % 61) - 30);
+                }
+                records[i].Datum.fReal = real;
+                break;
+            case 2:
+                records[i].ucRecType = TL_TYPE_REAL;
+                records[i].Datum.fReal = (float)(r % 100000) / 7.0f;
+                break;
+            case 3:
+                records[i].ucRecType = TL_TYPE_UNSIGN;
+                records[i].Datum.ulUValue =
+                    (i % 7) ? 4000000000UL + (r % 5) : r;
+                break;
+            case 4:
+                records[i].ucRecType = TL_TYPE_SIGN;
+                records[i].Datum.lSValue = (int32_t)(r % 200) - 100;
+                if (i % 50 == 0) {
+                    records[i].Datum.lSValue = (int32_t)r;
+                }
+                break;
+            case 5:
+                records[i].ucRecType = TL_TYPE_ENUM;
+                records[i].Datum.ulEnum = (r >> 4) % 4;
+                break;
+            case 6:
+                records[i].ucRecType = TL_TYPE_BOOL;
+                records[i].Datum.ucBoolean = (r >> 12) & 1;
+                break;
+            case 7:
+                records[i].ucRecType = TL_TYPE_STATUS;
+                records[i].ucStatus = 0;
+                records[i].Datum.ucLogStatus = 1 << ((r >> 3) % 3);
+                break;
+            case 8:
+                records[i].ucRecType = TL_TYPE_BITS;
+                records[i].Datum.Bits.ucLen = (uint8_t)((1 + (r % 4)) << 4);
+                memcpy(
+                    records[i].Datum.Bits.ucStore, &r,
+                    records[i].Datum.Bits.ucLen >> 4);
+                break;
+            case 9:
+                records[i].ucRecType = TL_TYPE_ERROR;
+                records[i].Datum.Error.usClass = (uint16_t)(r % 8);
+                records[i].Datum.Error.usCode = (uint16_t)(r >> 16);
+                break;
+            case 10:
+                records[i].ucRecType = TL_TYPE_NULL;
+                break;
+            default:
+                /* types changing at every record */
+                records[i].ucRecType = (uint8_t)((r >> 5) % 10);
+                if (records[i].ucRecType == TL_TYPE_BITS) {
+                    records[i].Datum.Bits.ucLen = 1 << 4;
+                    records[i].Datum.Bits.ucStore[0] = (uint8_t)r;
+                } else if (records[i].ucRecType == TL_TYPE_ERROR) {
+                    records[i].Datum.Error.usCode = (uint16_t)r;
+                } else if (
+                    (records[i].ucRecType == TL_TYPE_BOOL) ||
+                    (records[i].ucRecType == TL_TYPE_STATUS)) {
+                    records[i].Datum.ucBoolean = (uint8_t)(r & 1);
+                } else if (records[i].ucRecType != TL_TYPE_NULL) {
+                    records[i].Datum.ulUValue = r >> 24;
+                }
+                break;
+        }
+    }
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(trendlog_store_tests, test_trendlog_store_records)
+#else
+static void test_trendlog_store_records(void)
+#endif
+{
+    TRENDLOG_STORE_CURSOR cursor = { 0 };
+    uint32_t position;
+    unsigned i;
+
+    test_records_make(Test_Records, TEST_RECORDS);
+    trendlog_store_init(&Test_Store, TEST_RECORDS);
+    zassert_false(
+        trendlog_store_seek_position(&Test_Store, 1, &cursor), NULL);
+    for (i = 0; i < TEST_RECORDS; i++) {
+        zassert_true(
+            trendlog_store_append(&Test_Store, &Test_Records[i]), NULL);
+    }
+    zassert_equal(trendlog_store_count(&Test_Store), TEST_RECORDS, NULL);
+    zassert_equal(trendlog_store_sequence(&Test_Store), TEST_RECORDS, NULL);
+    zassert_true(trendlog_store_full(&Test_Store), NULL);
+    zassert_true(
+        trendlog_store_octets(&Test_Store) <
+            (TEST_RECORDS * sizeof(TL_DATA_REC)) / 2,
+        NULL);
+    /* every record, in order */
+    zassert_true(trendlog_store_seek_position(&Test_Store, 1, &cursor), NULL);
+    for (i = 0; i < TEST_RECORDS; i++) {
+        zassert_equal(cursor.position, i + 1, NULL);
+        zassert_equal(cursor.sequence, i + 1, NULL);
+        test_record_check(&cursor.record, &Test_Records[i]);
+        zassert_equal(
+            trendlog_store_next(&cursor), (i + 1) < TEST_RECORDS, NULL);
+    }
+    zassert_false(
+        trendlog_store_seek_position(&Test_Store, TEST_RECORDS + 1, &cursor),
+        NULL);
+    /* any record */
+    for (i = 0; i < 2000; i++) {
+        position = 1 + (test_random() % TEST_RECORDS);
+        zassert_true(
+            trendlog_store_seek_position(&Test_Store, position, &cursor),
+            NULL);
+        test_record_check(&cursor.record, &Test_Records[position - 1]);
+    }
+    /* a purge keeps counting the sequence numbers */
+    trendlog_store_purge(&Test_Store, 77);
+    zassert_equal(trendlog_store_count(&Test_Store), 0, NULL);
+    zassert_equal(trendlog_store_octets(&Test_Store), 0, NULL);
+    zassert_true(trendlog_store_append(&Test_Store, &Test_Records[5]), NULL);
+    zassert_true(trendlog_store_seek_position(&Test_Store, 1, &cursor), NULL);
+    zassert_equal(cursor.sequence, 78, NULL);
+    test_record_check(&cursor.record, &Test_Records[5]);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(trendlog_store_tests, test_trendlog_store_full)
+#else
+static void test_trendlog_store_full(void)
+#endif
+{
+    TRENDLOG_STORE_CURSOR cursor = { 0 };
+    TL_DATA_REC record = { 0 };
+    uint32_t i, count, first;
+    uint32_t bits;
+
+    /* the oldest records go, one at a time */
+    test_records_make(Test_Records, TEST_RECORDS);
+    trendlog_store_init(&Test_Store, 1000);
+    for (i = 0; i < 2500; i++) {
+        zassert_true(
+            trendlog_store_append(&Test_Store, &Test_Records[i]), NULL);
+        count = trendlog_store_count(&Test_Store);
+        zassert_equal(count, (i < 1000) ? i + 1 : 1000, NULL);
+    }
+    zassert_equal(trendlog_store_sequence(&Test_Store), 2500, NULL);
+    zassert_true(trendlog_store_seek_position(&Test_Store, 1, &cursor), NULL);
+    for (i = 1500; i < 2500; i++) {
+        zassert_equal(cursor.sequence, i + 1, NULL);
+        test_record_check(&cursor.record, &Test_Records[i]);
+        trendlog_store_next(&cursor);
+    }
+    /* the oldest blocks go when they are all in use */
+    trendlog_store_init(&Test_Store, UINT32_MAX);
+    record.ucRecType = TL_TYPE_REAL;
+    for (i = 0; i < 600000; i++) {
+        bits = i * 2654435761UL;
+        record.tTimeStamp = 1700000000 + (2 * i);
+        memcpy(&record.Datum.fReal, &bits, sizeof(bits));
+        zassert_true(trendlog_store_append(&Test_Store, &record), NULL);
+    }
+    count = trendlog_store_count(&Test_Store);
+    zassert_true(count < 600000, NULL);
+    zassert_true(
+        trendlog_store_octets(&Test_Store) <=
+            (size_t)TRENDLOG_STORE_BLOCKS * TRENDLOG_STORE_BLOCK_SIZE,
+        NULL);
+    zassert_true(trendlog_store_seek_position(&Test_Store, 1, &cursor), NULL);
+    first = 600000 - count;
+    for (i = first; i < 600000; i++) {
+        bits = i * 2654435761UL;
+        record.tTimeStamp = 1700000000 + (2 * i);
+        memcpy(&record.Datum.fReal, &bits, sizeof(bits));
+        zassert_equal(cursor.sequence, i + 1, NULL);
+        test_record_check(&cursor.record, &record);
+        trendlog_store_next(&cursor);
+    }
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(trendlog_store_tests, test_trendlog_store_seek_time)
+#else
+static void test_trendlog_store_seek_time(void)
+#endif
+{
+    TRENDLOG_STORE_CURSOR cursor = { 0 };
+    bacnet_time_t time, first, last;
+    unsigned i, n, after, before;
+    bool status;
+
+    test_records_make(Test_Records, TEST_RECORDS);
+    trendlog_store_init(&Test_Store, TEST_RECORDS / 2);
+    for (i = 0; i < TEST_RECORDS; i++) {
+        zassert_true(
+            trendlog_store_append(&Test_Store, &Test_Records[i]), NULL);
+    }
+    first = Test_Records[TEST_RECORDS / 2].tTimeStamp;
+    last = Test_Records[TEST_RECORDS - 1].tTimeStamp;
+    for (n = 0; n < 3000; n++) {
+        if (n < 3) {
+            time = (n == 0) ? first - 1 : ((n == 1) ? first : last);
+        } else {
+            time = first - 10 + (test_random() % (last - first + 20));
+        }
+        /* the same answer as looking at each record */
+        after = TEST_RECORDS;
+        before = TEST_RECORDS;
+        for (i = TEST_RECORDS / 2; i < TEST_RECORDS; i++) {
+            if (Test_Records[i].tTimeStamp < time) {
+                before = i;
+            }
+            if ((after == TEST_RECORDS) &&
+                (Test_Records[i].tTimeStamp > time)) {
+                after = i;
+            }
+        }
+        status = trendlog_store_seek_after(&Test_Store, time, &cursor);
+        zassert_equal(status, after < TEST_RECORDS, NULL);
+        if (status) {
+            zassert_equal(cursor.sequence, after + 1, NULL);
+            zassert_equal(cursor.position, after + 1 - TEST_RECORDS / 2, NULL);
+            test_record_check(&cursor.record, &Test_Records[after]);
+        }
+        status = trendlog_store_seek_before(&Test_Store, time, &cursor);
+        zassert_equal(status, before < TEST_RECORDS, NULL);
+        if (status) {
+            zassert_equal(cursor.sequence, before + 1, NULL);
+            test_record_check(&cursor.record, &Test_Records[before]);
+        }
+    }
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(trendlog_store_tests, test_trendlog_store_blocks)
+#else
+static void test_trendlog_store_blocks(void)
+#endif
+{
+    TRENDLOG_STORE_CURSOR cursor = { 0 }, copy = { 0 };
+    TRENDLOG_STORE_BLOCK index, newest;
+    const uint8_t *data = NULL;
+    uint16_t block, blocks;
+    unsigned i;
+
+    /* a store rebuilt from its blocks has the same records */
+    test_records_make(Test_Records, TEST_RECORDS);
+    trendlog_store_init(&Test_Store, TEST_RECORDS / 2);
+    for (i = 0; i < TEST_RECORDS; i++) {
+        zassert_true(
+            trendlog_store_append(&Test_Store, &Test_Records[i]), NULL);
+    }
+    trendlog_store_init(&Test_Copy, TEST_RECORDS / 2);
+    blocks = trendlog_store_blocks(&Test_Store);
+    zassert_true(blocks > 1, NULL);
+    for (block = 0; block < blocks; block++) {
+        zassert_true(
+            trendlog_store_block(&Test_Store, block, &index, &data), NULL);
+        zassert_true(trendlog_store_block_add(&Test_Copy, &index, data), NULL);
+    }
+    zassert_false(
+        trendlog_store_block(&Test_Store, blocks, &index, &data), NULL);
+    zassert_equal(
+        trendlog_store_count(&Test_Copy), trendlog_store_count(&Test_Store),
+        NULL);
+    zassert_equal(trendlog_store_sequence(&Test_Copy), TEST_RECORDS, NULL);
+    zassert_true(trendlog_store_seek_position(&Test_Store, 1, &cursor), NULL);
+    zassert_true(trendlog_store_seek_position(&Test_Copy, 1, &copy), NULL);
+    do {
+        zassert_equal(copy.sequence, cursor.sequence, NULL);
+        test_record_check(&copy.record, &cursor.record);
+        zassert_equal(
+            trendlog_store_next(&copy), trendlog_store_next(&cursor), NULL);
+    } while (cursor.sequence < TEST_RECORDS);
+    /* blocks already there are not added again */
+    zassert_true(trendlog_store_block(&Test_Store, 0, &index, &data), NULL);
+    zassert_false(trendlog_store_block_add(&Test_Copy, &index, data), NULL);
+    /* an earlier copy of the newest block does not replace it */
+    zassert_true(
+        trendlog_store_block(&Test_Store, blocks - 1, &newest, &data), NULL);
+    index = newest;
+    index.count--;
+    zassert_false(trendlog_store_block_add(&Test_Copy, &index, data), NULL);
+    zassert_true(trendlog_store_block_add(&Test_Copy, &newest, data), NULL);
+    zassert_equal(trendlog_store_sequence(&Test_Copy), TEST_RECORDS, NULL);
+    /* a closed block: the next record starts a new one */
+    zassert_true(trendlog_store_append(&Test_Copy, &Test_Records[7]), NULL);
+    zassert_equal(trendlog_store_blocks(&Test_Copy), blocks + 1, NULL);
+    zassert_true(
+        trendlog_store_seek_position(
+            &Test_Copy, trendlog_store_count(&Test_Copy), &copy),
+        NULL);
+    zassert_equal(copy.sequence, TEST_RECORDS + 1, NULL);
+    test_record_check(&copy.record, &Test_Records[7]);
+    /* missing records: the blocks before are dropped */
+    newest.first_sequence += 1000;
+    zassert_true(trendlog_store_block_add(&Test_Copy, &newest, data), NULL);
+    zassert_equal(trendlog_store_blocks(&Test_Copy), 1, NULL);
+    zassert_equal(trendlog_store_count(&Test_Copy), newest.count, NULL);
+    zassert_true(trendlog_store_seek_position(&Test_Copy, 1, &copy), NULL);
+    zassert_equal(copy.sequence, newest.first_sequence, NULL);
+}
+
+/**
+ * @brief Write a property of Trend Log 0
+ */
+static bool test_trend_log_write(
+    BACNET_PROPERTY_ID property, const BACNET_APPLICATION_DATA_VALUE *value)
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data = { 0 };
+
+    wp_data.object_type = OBJECT_TRENDLOG;
+    wp_data.object_instance = 0;
+    wp_data.object_property = property;
+    wp_data.array_index = BACNET_ARRAY_ALL;
+    wp_data.priority = BACNET_NO_PRIORITY;
+    wp_data.application_data_len =
+        bacapp_encode_application_data(wp_data.application_data, value);
+
+    return Trend_Log_Write_Property(&wp_data);
+}
+
+/**
+ * @brief Read the Record_Count or Total_Record_Count of Trend Log 0
+ */
+static uint32_t test_trend_log_count(BACNET_PROPERTY_ID property)
+{
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    BACNET_UNSIGNED_INTEGER count = 0;
+    uint8_t apdu[MAX_APDU];
+
+    rpdata.object_type = OBJECT_TRENDLOG;
+    rpdata.object_instance = 0;
+    rpdata.object_property = property;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    rpdata.application_data = apdu;
+    rpdata.application_data_len = sizeof(apdu);
+    zassert_true(Trend_Log_Read_Property(&rpdata) > 0, NULL);
+    bacnet_unsigned_application_decode(apdu, sizeof(apdu), &count);
+
+    return (uint32_t)count;
+}
+
+/**
+ * @brief Log AV1 every 2 seconds, not aligned to the clock, from empty
+ */
+static void test_trend_log_setup(void)
+{
+    BACNET_APPLICATION_DATA_VALUE value = { 0 };
+    BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE source = { 0 };
+
+    Trend_Log_Init();
+    source.objectIdentifier.type = OBJECT_ANALOG_VALUE;
+    source.objectIdentifier.instance = 1;
+    source.propertyIdentifier = PROP_PRESENT_VALUE;
+    source.arrayIndex = BACNET_ARRAY_ALL;
+    source.deviceIdentifier.type = OBJECT_DEVICE;
+    source.deviceIdentifier.instance = TEST_DEVICE_INSTANCE;
+    zassert_true(Trend_Log_Source_Set(0, &source), NULL);
+    value.tag = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+    value.type.Unsigned_Int = 200;
+    zassert_true(test_trend_log_write(PROP_LOG_INTERVAL, &value), NULL);
+    value.tag = BACNET_APPLICATION_TAG_BOOLEAN;
+    value.type.Boolean = false;
+    zassert_true(test_trend_log_write(PROP_ALIGN_INTERVALS, &value), NULL);
+    zassert_true(Trend_Log_Enable_Set(0, true), NULL);
+    value.tag = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+    value.type.Unsigned_Int = 0;
+    zassert_true(test_trend_log_write(PROP_RECORD_COUNT, &value), NULL);
+}
+
+/**
+ * @brief Next sample of a PM2.5 sensor in whole ug/m3: mostly steady,
+ *  often moving by one, now and then by more
+ */
+static float test_pm25_next(float value)
+{
+    uint32_t r = test_random() % 100;
+    int step = 0;
+
+    if (r < 20) {
+        step = 1;
+    } else if (r < 40) {
+        step = -1;
+    } else if (r < 43) {
+        step = (int)(test_random() % 11) - 5;
+    }
+    value += (float)step;
+    if (value < 0.0f) {
+        value = 0.0f;
+    }
+
+    return value;
+}
+
+/**
+ * @brief Time ReadRange By Time requests of 20 records at random times
+ * @param first - time of the first sample
+ * @param sequence - sequence number of the record before the first sample
+ * @param samples - number of samples, the oldest of them no longer in
+ *  the log when it is full
+ * @return nanoseconds per request
+ */
+static double test_read_range_by_time(
+    bacnet_time_t first, uint32_t sequence, uint32_t samples)
+{
+    static uint8_t apdu[MAX_APDU];
+    BACNET_READ_RANGE_DATA request = { 0 };
+    const unsigned requests = 20000;
+    uint64_t start, elapsed_ns = 0;
+    bacnet_time_t time;
+    uint32_t sample;
+    unsigned n;
+    int len;
+
+    for (n = 0; n < requests; n++) {
+        /* between two samples, away from the ends of the log */
+        sample = 100 + test_random() % (samples - 200);
+        time = first + (2 * sample) + 1;
+        memset(&request, 0, sizeof(request));
+        request.object_type = OBJECT_TRENDLOG;
+        request.object_instance = 0;
+        request.object_property = PROP_LOG_BUFFER;
+        request.array_index = BACNET_ARRAY_ALL;
+        request.RequestType = RR_BY_TIME;
+        request.Overhead = RR_OVERHEAD + RR_1ST_SEQ_OVERHEAD;
+        request.Count = (n & 1) ? 20 : -20;
+        datetime_since_epoch_seconds(&request.Range.RefTime, time);
+        start = test_clock_ns();
+        len = rr_trend_log_encode(apdu, &request);
+        elapsed_ns += test_clock_ns() - start;
+        zassert_true(len > 0, NULL);
+        zassert_equal(request.ItemCount, 20, NULL);
+        /* from the sample after the time, or up to the one before it */
+        if (n & 1) {
+            zassert_equal(request.FirstSequence, sequence + sample + 2, NULL);
+        } else {
+            zassert_equal(request.FirstSequence, sequence + sample - 18, NULL);
+        }
+    }
+
+    return (double)elapsed_ns / requests;
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(trendlog_store_tests, test_trendlog_benchmark)
+#else
+static void test_trendlog_benchmark(void)
+#endif
+{
+    const uint32_t milestones[] = { 10000, 43200, 1000000 };
+    BACNET_DATE_TIME bdatetime = { 0 };
+    bacnet_time_t first;
+    uint32_t sequence, samples = 0, records;
+    uint64_t start, elapsed_ns = 0;
+    unsigned m;
+    size_t octets;
+
+    datetime_set_values(&bdatetime, 2019, 1, 1, 0, 0, 0, 0);
+    Test_Time = datetime_seconds_since_epoch(&bdatetime);
+    Test_Value = 12.0f;
+    test_trend_log_setup();
+    /* the purge is the newest record; the samples come after it */
+    sequence = test_trend_log_count(PROP_TOTAL_RECORD_COUNT);
+    first = Test_Time + 2;
+    for (m = 0; m < ARRAY_SIZE(milestones); m++) {
+        start = test_clock_ns();
+        while (samples < milestones[m]) {
+            Test_Time += 2;
+            Test_Value = test_pm25_next(Test_Value);
+            trend_log_timer(2);
+            samples++;
+        }
+        elapsed_ns += test_clock_ns() - start;
+        records = test_trend_log_count(PROP_RECORD_COUNT);
+        if (samples < TL_MAX_ENTRIES) {
+            zassert_equal(records, samples + 1, NULL);
+        } else {
+            zassert_equal(records, TL_MAX_ENTRIES, NULL);
+        }
+        octets = Trend_Log_Buffer_Octets(0);
+        printf(
+            "Trend Log of a PM2.5 value every 2 s, %7lu samples: "
+            "%8lu octets, %5.2f octets per sample (%u uncompressed), "
+            "%4.0f ns per sample logged\n",
+            (unsigned long)samples, (unsigned long)octets,
+            (double)octets / records, (unsigned)sizeof(TL_DATA_REC),
+            (double)elapsed_ns / samples);
+        if (milestones[m] != 43200) {
+            printf(
+                "ReadRange By Time of 20 records, %7lu samples: "
+                "%6.0f ns per request\n",
+                (unsigned long)samples,
+                test_read_range_by_time(first, sequence, samples));
+        }
+    }
+}
+
+/**
+ * @brief Read every record of Trend Log 0, as ReadRange encodes them
+ * @param records - filled with the encoded records, each up to 64 octets
+ * @param max - most records to read
+ * @return number of records
+ */
+static uint32_t test_trend_log_records(uint8_t (*records)[64], uint32_t max)
+{
+    uint8_t apdu[MAX_APDU];
+    uint32_t count = test_trend_log_count(PROP_RECORD_COUNT);
+    uint32_t i;
+    int len;
+
+    zassert_true(count <= max, NULL);
+    for (i = 0; i < count; i++) {
+        len = TL_encode_entry(apdu, 0, i + 1);
+        zassert_true((len > 0) && (len < 64), NULL);
+        memset(records[i], 0, 64);
+        memcpy(records[i], apdu, len);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Trend Log 0 after a reset: the flash log is mounted again, and
+ *  the log rebuilt from it
+ */
+static void test_trend_log_reset(FLASH_LOG *log)
+{
+    memset(log, 0, sizeof(*log));
+    flash_file_reset();
+    zassert_true(
+        flash_log_init(
+            log, &Test_Flash_Driver, TEST_FLASH_SIZE, TEST_FLASH_SEGMENT),
+        NULL);
+    zassert_true(Trend_Log_Flash_Set(log), NULL);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(trendlog_store_tests, test_trendlog_flash)
+#else
+static void test_trendlog_flash(void)
+#endif
+{
+    static uint8_t before[TEST_FLASH_SAMPLES + 8][64];
+    static uint8_t after[TEST_FLASH_SAMPLES + 8][64];
+    static FLASH_LOG log;
+    BACNET_APPLICATION_DATA_VALUE value = { 0 };
+    uint32_t count, restored, sequence, i;
+    unsigned cut;
+
+    flash_file_close(true);
+    zassert_true(
+        flash_file_open(
+            TEST_FLASH_PATHNAME, TEST_FLASH_SIZE, TEST_FLASH_SEGMENT),
+        NULL);
+    Test_Flash_Driver.mapped = flash_file_mapped();
+    test_trend_log_reset(&log);
+    for (cut = 0; cut < 2; cut++) {
+        /* from a purge, which goes to flash too */
+        value.tag = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+        value.type.Unsigned_Int = 0;
+        zassert_true(test_trend_log_write(PROP_RECORD_COUNT, &value), NULL);
+        for (i = 0; i < TEST_FLASH_SAMPLES; i++) {
+            Test_Time += 2;
+            Test_Value = test_pm25_next(Test_Value);
+            trend_log_timer(2);
+            if ((cut == 1) && (i == (TEST_FLASH_SAMPLES / 2))) {
+                /* the power fails part way through a flash write */
+                flash_file_power_cut(1 + (test_random() % 4096));
+            }
+        }
+        count = test_trend_log_records(before, TEST_FLASH_SAMPLES + 8);
+        sequence = test_trend_log_count(PROP_TOTAL_RECORD_COUNT);
+        /* the reset, and the log back from flash */
+        test_trend_log_reset(&log);
+        restored = test_trend_log_records(after, TEST_FLASH_SAMPLES + 8);
+        zassert_true(restored > 1, NULL);
+        /* what was in flash comes back as it was, up to the reset,
+           which is marked by a Log-Interrupted status record */
+        for (i = 0; i < (restored - 1); i++) {
+            zassert_mem_equal(after[i], before[i], 64, NULL);
+        }
+        zassert_equal(
+            test_trend_log_count(PROP_TOTAL_RECORD_COUNT),
+            sequence - (count - restored), NULL);
+        printf(
+            "Trend Log in flash: %lu of %lu records restored after a "
+            "reset%s, %u segments erased %lu times at most\n",
+            (unsigned long)(restored - 1), (unsigned long)count,
+            cut ? " in a flash write" : "",
+            (unsigned)flash_log_segments_used(&log),
+            (unsigned long)flash_log_erase_count(&log));
+        if (cut == 0) {
+            /* no more than a checkpoint of records is lost */
+            zassert_true((count - (restored - 1)) <= 150, NULL);
+        }
+        /* and logging carries on */
+        Test_Time += 2;
+        trend_log_timer(2);
+        zassert_equal(
+            test_trend_log_count(PROP_RECORD_COUNT), restored + 1, NULL);
+    }
+    zassert_true(Trend_Log_Flash_Set(NULL), NULL);
+    flash_file_close(true);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(trendlog_store_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        trendlog_store_tests, ztest_unit_test(test_trendlog_store_records),
+        ztest_unit_test(test_trendlog_store_full),
+        ztest_unit_test(test_trendlog_store_seek_time),
+        ztest_unit_test(test_trendlog_store_blocks),
+        ztest_unit_test(test_trendlog_benchmark),
+        ztest_unit_test(test_trendlog_flash));
+
+    ztest_run_test_suite(trendlog_store_tests);
+}
+#endif
@@ -0,0 +1,500 @@
+/**
+ * @file
+ * @brief test and benchmark of the COV subscription handler, state
+ *  machine, and task: change-to-notification latency at 8, 128 and 1024
+ *  subscriptions, unconfirmed and confirmed, and the fan-out of one
+ *  change to 64 subscribers.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/cov.h>
+#include <bacnet/basic/services.h>
+#include <bacnet/basic/object/device.h>
+#include <bacnet/basic/tsm/tsm.h>
+#include <bacnet/datalink/datalink.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_OBJECTS_MAX 1024
+#define TEST_DEVICE_INSTANCE 260001
+
+uint8_t Handler_Transmit_Buffer[MAX_PDU];
+
+static bool Test_Object_Changed[TEST_OBJECTS_MAX];
+static float Test_Object_Value[TEST_OBJECTS_MAX];
+static unsigned Test_Notifications;
+static unsigned Test_Acks;
+static uint32_t Test_Last_Process_Identifier;
+static float Test_Last_Value;
+/* the benchmarks count the notifications without decoding them */
+static bool Test_Decode = true;
+/* invoke IDs of the confirmed notifications not yet acknowledged */
+static bool Test_Invoke_Busy[256];
+static uint8_t Test_Invoke_Last;
+
+/* simulated device object table: analog values 0..TEST_OBJECTS_MAX-1 */
+uint32_t Device_Object_Instance_Number(void)
+{
+    return TEST_DEVICE_INSTANCE;
+}
+
+bool Device_Valid_Object_Id(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    return (object_type == OBJECT_ANALOG_VALUE) &&
+        (object_instance < TEST_OBJECTS_MAX);
+}
+
+bool Device_Value_List_Supported(BACNET_OBJECT_TYPE object_type)
+{
+    return object_type == OBJECT_ANALOG_VALUE;
+}
+
+bool Device_COV(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    if (Device_Valid_Object_Id(object_type, object_instance)) {
+        return Test_Object_Changed[object_instance];
+    }
+
+    return false;
+}
+
+void Device_COV_Clear(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    if (Device_Valid_Object_Id(object_type, object_instance)) {
+        Test_Object_Changed[object_instance] = false;
+    }
+}
+
+bool Device_Encode_Value_List(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_VALUE *value_list)
+{
+    if (Device_Valid_Object_Id(object_type, object_instance)) {
+        return cov_value_list_encode_real(
+            value_list, Test_Object_Value[object_instance], false, false,
+            false, false);
+    }
+
+    return false;
+}
+
+/* TSM stubs - invoke IDs are handed out in turn, and a transaction is
+   done once the test acknowledges it */
+bool tsm_transaction_available(void)
+{
+    unsigned i;
+
+    for (i = 1; i < 256; i++) {
+        if (!Test_Invoke_Busy[i]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint8_t tsm_next_free_invokeID(void)
+{
+    unsigned i;
+
+    for (i = 0; i < 256; i++) {
+        Test_Invoke_Last++;
+        if (Test_Invoke_Last && !Test_Invoke_Busy[Test_Invoke_Last]) {
+            Test_Invoke_Busy[Test_Invoke_Last] = true;
+            return Test_Invoke_Last;
+        }
+    }
+
+    return 0;
+}
+
+void tsm_set_confirmed_unsegmented_transaction(
+    uint8_t invokeID,
+    const BACNET_ADDRESS *dest,
+    const BACNET_NPDU_DATA *ndpu_data,
+    const uint8_t *apdu,
+    uint16_t apdu_len)
+{
+    (void)invokeID;
+    (void)dest;
+    (void)ndpu_data;
+    (void)apdu;
+    (void)apdu_len;
+}
+
+void tsm_free_invoke_id(uint8_t invokeID)
+{
+    Test_Invoke_Busy[invokeID] = false;
+}
+
+bool tsm_invoke_id_free(uint8_t invokeID)
+{
+    return !Test_Invoke_Busy[invokeID];
+}
+
+bool tsm_invoke_id_failed(uint8_t invokeID)
+{
+    (void)invokeID;
+    return false;
+}
+
+/* datalink stubs that count the notifications */
+void datalink_get_my_address(BACNET_ADDRESS *my_address)
+{
+    bacnet_address_init(my_address, NULL, 0, NULL);
+}
+
+int datalink_send_pdu(
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    BACNET_COV_DATA cov_data = { 0 };
+    BACNET_PROPERTY_VALUE value_list[2] = { 0 };
+    int offset;
+
+    (void)dest;
+    if (!Test_Decode) {
+        Test_Notifications++;
+        return (int)pdu_len;
+    }
+    offset = npdu_decode(pdu, NULL, NULL, npdu_data);
+    if ((offset > 0) &&
+        (pdu[offset] == PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST) &&
+        (pdu[offset + 1] == SERVICE_UNCONFIRMED_COV_NOTIFICATION)) {
+        cov_data_value_list_link(&cov_data, value_list, 2);
+        if (cov_notify_decode_service_request(
+                &pdu[offset + 2], pdu_len - offset - 2, &cov_data) > 0) {
+            Test_Last_Process_Identifier = cov_data.subscriberProcessIdentifier;
+            Test_Last_Value = value_list[0].value.type.Real;
+        }
+        Test_Notifications++;
+    } else if (
+        (offset > 0) &&
+        ((pdu[offset] & 0xF0) == PDU_TYPE_CONFIRMED_SERVICE_REQUEST) &&
+        (pdu[offset + 3] == SERVICE_CONFIRMED_COV_NOTIFICATION)) {
+        Test_Notifications++;
+    } else if (
+        (offset > 0) && (pdu[offset] == PDU_TYPE_SIMPLE_ACK)) {
+        Test_Acks++;
+    }
+
+    return (int)pdu_len;
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Subscribe one process to one analog value
+ */
+static void test_subscribe_confirmed(
+    uint32_t process_id, uint32_t object_instance, bool confirmed)
+{
+    BACNET_SUBSCRIBE_COV_DATA data = { 0 };
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_MAC_ADDRESS mac = { .len = 1, .adr = { 42 } };
+    uint8_t apdu[MAX_APDU] = { 0 };
+    int len;
+    unsigned acks = Test_Acks;
+
+    bacnet_address_init(&src, &mac, 0, NULL);
+    data.subscriberProcessIdentifier = process_id;
+    data.monitoredObjectIdentifier.type = OBJECT_ANALOG_VALUE;
+    data.monitoredObjectIdentifier.instance = object_instance;
+    data.cancellationRequest = false;
+    data.issueConfirmedNotifications = confirmed;
+    data.lifetime = 0;
+    len = cov_subscribe_service_request_encode(apdu, sizeof(apdu), &data);
+    zassert_true(len > 0, NULL);
+    service_data.invoke_id = 1;
+    handler_cov_subscribe(apdu, (uint16_t)len, &src, &service_data);
+    zassert_equal(Test_Acks, acks + 1, "subscription %u", process_id);
+}
+
+/**
+ * @brief Subscribe one process to one analog value, unconfirmed
+ */
+static void test_subscribe(uint32_t process_id, uint32_t object_instance)
+{
+    test_subscribe_confirmed(process_id, object_instance, false);
+}
+
+/**
+ * @brief Acknowledge every confirmed notification sent so far
+ */
+static void test_ack_all(void)
+{
+    memset(Test_Invoke_Busy, 0, sizeof(Test_Invoke_Busy));
+}
+
+/**
+ * @brief Change an analog value the way the object does: set the COV flag
+ *  and report the change
+ */
+static void test_value_change(uint32_t object_instance, float value)
+{
+    Test_Object_Value[object_instance] = value;
+    Test_Object_Changed[object_instance] = true;
+    cov_change_detected_notify(OBJECT_ANALOG_VALUE, object_instance);
+}
+
+/**
+ * @brief Subscribe a number of processes, one per object, then measure
+ *  the latency from a change to the notification, in task passes and time
+ */
+static void test_cov_latency(unsigned subscriptions)
+{
+    unsigned i, n;
+    unsigned passes;
+    const unsigned iterations = 2000;
+    uint64_t start, elapsed_ns, idle_ns;
+    uint32_t object_instance;
+
+    handler_cov_init();
+    memset(Test_Object_Changed, 0, sizeof(Test_Object_Changed));
+    for (i = 0; i < subscriptions; i++) {
+        test_subscribe(i + 1, i);
+    }
+    /* initial notifications for the new subscriptions */
+    Test_Notifications = 0;
+    handler_cov_task();
+    zassert_equal(Test_Notifications, subscriptions, NULL);
+    zassert_false(handler_cov_pending(), NULL);
+    /* a change is notified by the very next task pass */
+    object_instance = subscriptions - 1;
+    Test_Notifications = 0;
+    test_value_change(object_instance, 12.5f);
+    zassert_true(handler_cov_pending(), NULL);
+    passes = 0;
+    do {
+        handler_cov_task();
+        passes++;
+    } while (Test_Notifications == 0);
+    zassert_equal(passes, 1, NULL);
+    zassert_equal(Test_Notifications, 1, NULL);
+    zassert_equal(Test_Last_Process_Identifier, subscriptions, NULL);
+    zassert_false(Test_Object_Changed[object_instance], NULL);
+    /* latency from change to notification */
+    Test_Notifications = 0;
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        test_value_change(n % subscriptions, (float)n);
+        handler_cov_task();
+    }
+    elapsed_ns = test_clock_ns() - start;
+    zassert_equal(Test_Notifications, iterations, NULL);
+    /* cost of a pass with nothing changed */
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        handler_cov_task();
+    }
+    idle_ns = test_clock_ns() - start;
+    zassert_equal(Test_Notifications, iterations, NULL);
+    printf(
+        "COV %4u subscriptions: %u pass(es) to notify, "
+        "%6.0f ns change-to-notification, %4.0f ns idle pass\n",
+        subscriptions, passes, (double)elapsed_ns / iterations,
+        (double)idle_ns / iterations);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(h_cov_tests, test_cov_latency_benchmark)
+#else
+static void test_cov_latency_benchmark(void)
+#endif
+{
+    test_cov_latency(8);
+    test_cov_latency(128);
+    test_cov_latency(1024);
+}
+
+/**
+ * @brief Subscribe a number of processes to confirmed notifications, one
+ *  per object, then measure the latency from a change to the notification
+ *  when each is acknowledged before the next change, and the cost of a
+ *  pass while 8 notifications wait for their acknowledgement
+ */
+static void test_cov_confirmed_latency(unsigned subscriptions)
+{
+    unsigned i, n;
+    const unsigned iterations = 2000;
+    const unsigned outstanding = 8;
+    uint64_t start, elapsed_ns, waiting_ns;
+
+    handler_cov_init();
+    test_ack_all();
+    memset(Test_Object_Changed, 0, sizeof(Test_Object_Changed));
+    for (i = 0; i < subscriptions; i++) {
+        test_subscribe_confirmed(i + 1, i, true);
+    }
+    /* initial notifications, as fast as the invoke IDs come back */
+    Test_Notifications = 0;
+    for (n = 0; (n < subscriptions) && handler_cov_pending(); n++) {
+        handler_cov_task();
+        test_ack_all();
+    }
+    zassert_equal(Test_Notifications, subscriptions, NULL);
+    zassert_false(handler_cov_pending(), NULL);
+    /* latency from change to notification, acknowledged in between */
+    Test_Notifications = 0;
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        test_value_change(n % subscriptions, (float)n);
+        handler_cov_task();
+        test_ack_all();
+    }
+    elapsed_ns = test_clock_ns() - start;
+    zassert_equal(Test_Notifications, iterations, NULL);
+    handler_cov_task();
+    zassert_false(handler_cov_pending(), NULL);
+    /* cost of a pass while notifications wait for their ack */
+    for (i = 0; i < outstanding; i++) {
+        test_value_change(i % subscriptions, 1.0f);
+    }
+    handler_cov_task();
+    zassert_true(handler_cov_pending(), NULL);
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        handler_cov_task();
+    }
+    waiting_ns = test_clock_ns() - start;
+    zassert_equal(Test_Notifications, iterations + outstanding, NULL);
+    test_ack_all();
+    handler_cov_task();
+    zassert_false(handler_cov_pending(), NULL);
+    printf(
+        "COV %4u confirmed:     %6.0f ns change-to-notification, "
+        "%4.0f ns pass with %u awaiting ack\n",
+        subscriptions, (double)elapsed_ns / iterations,
+        (double)waiting_ns / iterations, outstanding);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(h_cov_tests, test_cov_confirmed_benchmark)
+#else
+static void test_cov_confirmed_benchmark(void)
+#endif
+{
+    test_cov_confirmed_latency(8);
+    test_cov_confirmed_latency(128);
+    test_cov_confirmed_latency(1024);
+}
+
+/**
+ * @brief Every subscriber of a changed object is notified in one pass,
+ *  and the other subscriptions are left alone
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(h_cov_tests, test_cov_fan_out)
+#else
+static void test_cov_fan_out(void)
+#endif
+{
+    unsigned i;
+
+    handler_cov_init();
+    memset(Test_Object_Changed, 0, sizeof(Test_Object_Changed));
+    for (i = 0; i < 16; i++) {
+        /* 8 subscribers to AV1, 8 to AV2 */
+        test_subscribe(100 + i, 1 + (i % 2));
+    }
+    handler_cov_task();
+    Test_Notifications = 0;
+    handler_cov_task();
+    zassert_equal(Test_Notifications, 0, NULL);
+    test_value_change(1, 3.0f);
+    handler_cov_task();
+    zassert_equal(Test_Notifications, 8, NULL);
+    /* the same object queued twice is only notified once */
+    Test_Notifications = 0;
+    test_value_change(2, 4.0f);
+    test_value_change(2, 5.0f);
+    handler_cov_task();
+    zassert_equal(Test_Notifications, 8, NULL);
+    zassert_false(handler_cov_pending(), NULL);
+}
+
+/**
+ * @brief One change of an analog value with 64 subscribers: the values
+ *  are encoded once and copied into each notification
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(h_cov_tests, test_cov_fan_out_benchmark)
+#else
+static void test_cov_fan_out_benchmark(void)
+#endif
+{
+    const unsigned subscribers = 64;
+    const unsigned iterations = 2000;
+    uint64_t start, elapsed_ns;
+    unsigned i, n;
+
+    handler_cov_init();
+    memset(Test_Object_Changed, 0, sizeof(Test_Object_Changed));
+    for (i = 0; i < subscribers; i++) {
+        test_subscribe(200 + i, 7);
+    }
+    handler_cov_task();
+    /* every subscriber gets its own process identifier and the value */
+    Test_Notifications = 0;
+    test_value_change(7, 42.5f);
+    handler_cov_task();
+    zassert_equal(Test_Notifications, subscribers, NULL);
+    zassert_false(islessgreater(Test_Last_Value, 42.5f), NULL);
+    zassert_true(Test_Last_Process_Identifier >= 200, NULL);
+    zassert_true(Test_Last_Process_Identifier < 200 + subscribers, NULL);
+    Test_Notifications = 0;
+    Test_Decode = false;
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        test_value_change(7, (float)n);
+        handler_cov_task();
+    }
+    elapsed_ns = test_clock_ns() - start;
+    Test_Decode = true;
+    zassert_equal(Test_Notifications, iterations * subscribers, NULL);
+    printf(
+        "COV fan-out to %u subscribers of one AV: %7.0f ns per change, "
+        "%4.0f ns per notification\n",
+        subscribers, (double)elapsed_ns / iterations,
+        (double)elapsed_ns / (iterations * subscribers));
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(h_cov_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        h_cov_tests, ztest_unit_test(test_cov_fan_out),
+        ztest_unit_test(test_cov_latency_benchmark),
+        ztest_unit_test(test_cov_confirmed_benchmark),
+        ztest_unit_test(test_cov_fan_out_benchmark));
+
+    ztest_run_test_suite(h_cov_tests);
+}
+#endif
@@ -0,0 +1,497 @@
+/**
+ * @file
+ * @brief test of the Who-Is responder: jittered, rate limited I-Am
+ *  replies with duplicate suppression and a backing-off periodic I-Am,
+ *  and a simulation of 200 devices on one B/IP segment answering the
+ *  Who-Is of two workstations, against the immediate handler_who_is().
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/whois.h>
+#include <bacnet/basic/services.h>
+#include <bacnet/basic/service/h_whois.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_DEVICES 200
+#define TEST_DEVICE_FIRST 1000
+/* length of the simulation of a discovery, in milliseconds */
+#define TEST_SIMULATION_MS 10000
+
+uint8_t Handler_Transmit_Buffer[MAX_PDU];
+
+/* the device that handles the Who-Is, and the I-Am it sent */
+static uint32_t Test_Device_Instance = TEST_DEVICE_FIRST;
+static unsigned Test_I_Am_Sent;
+
+uint32_t Device_Object_Instance_Number(void)
+{
+    return Test_Device_Instance;
+}
+
+uint16_t Device_Vendor_Identifier(void)
+{
+    return 260;
+}
+
+const char *Device_Model_Name(void)
+{
+    return "test";
+}
+
+const char *Device_Serial_Number(void)
+{
+    return "1";
+}
+
+void Send_I_Am_Broadcast(uint8_t *buffer)
+{
+    (void)buffer;
+    Test_I_Am_Sent++;
+}
+
+void Send_I_Am_Unicast(uint8_t *buffer, const BACNET_ADDRESS *src)
+{
+    (void)buffer;
+    (void)src;
+    Test_I_Am_Sent++;
+}
+
+int Send_Who_Am_I_To_Network(
+    BACNET_ADDRESS *target_address,
+    uint16_t vendor_id,
+    const BACNET_CHARACTER_STRING *model_name,
+    const BACNET_CHARACTER_STRING *serial_number)
+{
+    (void)target_address;
+    (void)vendor_id;
+    (void)model_name;
+    (void)serial_number;
+    return 0;
+}
+
+/* a workstation on the B/IP segment */
+static void test_client_address(uint8_t host, BACNET_ADDRESS *src)
+{
+    memset(src, 0, sizeof(*src));
+    src->mac_len = 6;
+    src->mac[0] = 192;
+    src->mac[1] = 168;
+    src->mac[2] = 1;
+    src->mac[3] = host;
+    src->mac[4] = 0xBA;
+    src->mac[5] = 0xC0;
+}
+
+/* a Who-Is service request; -1 for no limits */
+static uint16_t
+test_who_is_encode(uint8_t *apdu, int32_t low_limit, int32_t high_limit)
+{
+    return (uint16_t)whois_request_encode(apdu, low_limit, high_limit);
+}
+
+/* run the responder clock in steps until an event, at most limit ms */
+static uint32_t test_responder_until_event(
+    WHO_IS_RESPONDER *responder,
+    uint32_t limit,
+    uint32_t step,
+    WHO_IS_RESPONDER_EVENT *event)
+{
+    uint32_t elapsed = 0;
+
+    *event = WHO_IS_RESPONDER_NONE;
+    while (elapsed < limit) {
+        elapsed += step;
+        *event = who_is_responder_timer(responder, step);
+        if (*event != WHO_IS_RESPONDER_NONE) {
+            break;
+        }
+    }
+
+    return elapsed;
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(who_is_tests, test_who_is_responder_reply)
+#else
+static void test_who_is_responder_reply(void)
+#endif
+{
+    WHO_IS_RESPONDER responder;
+    WHO_IS_RESPONDER_EVENT event;
+    BACNET_ADDRESS client_a, client_b;
+    uint8_t apdu[MAX_APDU];
+    uint16_t apdu_len;
+    uint32_t elapsed, next;
+
+    test_client_address(10, &client_a);
+    test_client_address(11, &client_b);
+    who_is_responder_init(&responder, TEST_DEVICE_FIRST);
+    zassert_equal(who_is_responder_next(&responder), UINT32_MAX, NULL);
+    zassert_equal(
+        who_is_responder_timer(&responder, 60000), WHO_IS_RESPONDER_NONE,
+        NULL);
+    /* not for this device, and not a valid request */
+    apdu_len = test_who_is_encode(apdu, 0, TEST_DEVICE_FIRST - 1);
+    zassert_false(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client_a),
+        NULL);
+    apdu_len = test_who_is_encode(apdu, 0, TEST_DEVICE_FIRST);
+    zassert_false(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len - 1, &client_a),
+        NULL);
+    zassert_equal(responder.requests, 0, NULL);
+    /* a reply within the window, which answers the Who-Is of another
+       client that comes in meanwhile */
+    apdu_len = test_who_is_encode(apdu, -1, -1);
+    zassert_true(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client_a),
+        NULL);
+    next = who_is_responder_next(&responder);
+    zassert_true(next < WHO_IS_REPLY_WINDOW_MS, NULL);
+    zassert_true(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client_b),
+        NULL);
+    elapsed = test_responder_until_event(
+        &responder, WHO_IS_REPLY_WINDOW_MS, 1, &event);
+    zassert_equal(event, WHO_IS_RESPONDER_REPLY, NULL);
+    zassert_equal(elapsed, next == 0 ? 1 : next, NULL);
+    zassert_equal(responder.coalesced, 1, NULL);
+    zassert_equal(responder.replies, 1, NULL);
+    /* the same Who-Is again within the window is not answered again */
+    zassert_false(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client_a),
+        NULL);
+    zassert_equal(responder.duplicates, 1, NULL);
+    zassert_equal(who_is_responder_next(&responder), UINT32_MAX, NULL);
+    /* but a different one is, and so is the same one after the window */
+    apdu_len = test_who_is_encode(apdu, TEST_DEVICE_FIRST, TEST_DEVICE_FIRST);
+    zassert_true(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client_a),
+        NULL);
+    (void)test_responder_until_event(
+        &responder, WHO_IS_REPLY_WINDOW_MS, 1, &event);
+    zassert_equal(event, WHO_IS_RESPONDER_REPLY, NULL);
+    zassert_equal(
+        who_is_responder_timer(&responder, WHO_IS_DUPLICATE_WINDOW_MS),
+        WHO_IS_RESPONDER_NONE, NULL);
+    apdu_len = test_who_is_encode(apdu, -1, -1);
+    zassert_true(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client_a),
+        NULL);
+    zassert_equal(responder.requests, 5, NULL);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(who_is_tests, test_who_is_responder_rate_limit)
+#else
+static void test_who_is_responder_rate_limit(void)
+#endif
+{
+    WHO_IS_RESPONDER responder;
+    WHO_IS_RESPONDER_EVENT event;
+    BACNET_ADDRESS client;
+    uint8_t apdu[MAX_APDU];
+    uint16_t apdu_len;
+    uint32_t elapsed;
+    unsigned i;
+
+    who_is_responder_init(&responder, TEST_DEVICE_FIRST);
+    responder.reply_window_ms = 0;
+    apdu_len = test_who_is_encode(apdu, -1, -1);
+    /* a burst of replies to different clients, then one per interval */
+    for (i = 0; i < WHO_IS_REPLY_BURST; i++) {
+        test_client_address((uint8_t)(10 + i), &client);
+        zassert_true(
+            who_is_responder_request(
+                &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client),
+            NULL);
+        zassert_equal(
+            who_is_responder_timer(&responder, 0), WHO_IS_RESPONDER_REPLY,
+            NULL);
+    }
+    test_client_address(100, &client);
+    zassert_true(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client),
+        NULL);
+    zassert_equal(
+        who_is_responder_next(&responder), WHO_IS_REPLY_INTERVAL_MS, NULL);
+    elapsed = test_responder_until_event(
+        &responder, 2 * WHO_IS_REPLY_INTERVAL_MS, 100, &event);
+    zassert_equal(event, WHO_IS_RESPONDER_REPLY, NULL);
+    zassert_equal(elapsed, WHO_IS_REPLY_INTERVAL_MS, NULL);
+    zassert_equal(responder.replies, WHO_IS_REPLY_BURST + 1, NULL);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(who_is_tests, test_who_is_responder_announce)
+#else
+static void test_who_is_responder_announce(void)
+#endif
+{
+    static const uint32_t intervals[] = { 60, 120, 240, 240 };
+    WHO_IS_RESPONDER responder;
+    WHO_IS_RESPONDER_EVENT event;
+    BACNET_ADDRESS client;
+    uint8_t apdu[MAX_APDU];
+    uint16_t apdu_len;
+    uint32_t elapsed;
+    unsigned i;
+
+    who_is_responder_init(&responder, TEST_DEVICE_FIRST);
+    who_is_responder_announce_set(&responder, 60000, 240000);
+    who_is_responder_sent(&responder);
+    for (i = 0; i < ARRAY_SIZE(intervals); i++) {
+        elapsed =
+            test_responder_until_event(&responder, 1000000, 1000, &event);
+        zassert_equal(event, WHO_IS_RESPONDER_ANNOUNCE, NULL);
+        zassert_equal(elapsed, intervals[i] * 1000, NULL);
+    }
+    /* a reply is an I-Am too: the next periodic one is counted from it */
+    (void)who_is_responder_timer(&responder, 100000);
+    test_client_address(10, &client);
+    apdu_len = test_who_is_encode(apdu, -1, -1);
+    zassert_true(
+        who_is_responder_request(
+            &responder, TEST_DEVICE_FIRST, apdu, apdu_len, &client),
+        NULL);
+    elapsed = test_responder_until_event(&responder, 1000000, 1, &event);
+    zassert_equal(event, WHO_IS_RESPONDER_REPLY, NULL);
+    elapsed = test_responder_until_event(&responder, 1000000, 1000, &event);
+    zassert_equal(event, WHO_IS_RESPONDER_ANNOUNCE, NULL);
+    zassert_true(elapsed >= 240000, NULL);
+    zassert_true(elapsed <= 241000, NULL);
+    /* and the port coming back up starts over */
+    who_is_responder_announce_reset(&responder);
+    elapsed = test_responder_until_event(&responder, 1000000, 1000, &event);
+    zassert_equal(event, WHO_IS_RESPONDER_ANNOUNCE, NULL);
+    zassert_equal(elapsed, 60000, NULL);
+    zassert_equal(responder.announcements, ARRAY_SIZE(intervals) + 2, NULL);
+}
+
+/* a Who-Is on the segment */
+struct test_who_is {
+    uint32_t time;
+    uint8_t client;
+    int32_t low_limit;
+    int32_t high_limit;
+};
+
+/* what a simulation of the segment saw */
+struct test_segment {
+    uint16_t i_am[TEST_SIMULATION_MS];
+    unsigned total;
+    unsigned peak_per_second;
+    unsigned peak_per_ms;
+    uint32_t discovered_ms;
+};
+
+/* Two workstations discover the segment at once; the first one asks a
+   part of the range again, then repeats its Who-Is for the devices it
+   missed */
+static const struct test_who_is Test_Who_Is[] = {
+    { 0, 10, -1, -1 },
+    { 40, 11, -1, -1 },
+    { 1000, 10, TEST_DEVICE_FIRST + 100, TEST_DEVICE_FIRST + 149 },
+    { 3000, 10, -1, -1 },
+};
+
+static void test_segment_summary(struct test_segment *segment)
+{
+    unsigned window = 0;
+    uint32_t t;
+
+    segment->total = 0;
+    segment->peak_per_second = 0;
+    segment->peak_per_ms = 0;
+    for (t = 0; t < TEST_SIMULATION_MS; t++) {
+        window += segment->i_am[t];
+        if (t >= 1000) {
+            window -= segment->i_am[t - 1000];
+        }
+        if (window > segment->peak_per_second) {
+            segment->peak_per_second = window;
+        }
+        if (segment->i_am[t] > segment->peak_per_ms) {
+            segment->peak_per_ms = segment->i_am[t];
+        }
+        segment->total += segment->i_am[t];
+    }
+}
+
+/* every device answers every Who-Is for it at once, as handler_who_is()
+   does */
+static void test_segment_immediate(struct test_segment *segment)
+{
+    bool discovered[TEST_DEVICES] = { false };
+    BACNET_ADDRESS src;
+    uint8_t apdu[MAX_APDU];
+    uint16_t apdu_len;
+    unsigned found = 0;
+    unsigned w, d;
+
+    memset(segment, 0, sizeof(*segment));
+    for (w = 0; w < ARRAY_SIZE(Test_Who_Is); w++) {
+        test_client_address(Test_Who_Is[w].client, &src);
+        apdu_len = test_who_is_encode(
+            apdu, Test_Who_Is[w].low_limit, Test_Who_Is[w].high_limit);
+        for (d = 0; d < TEST_DEVICES; d++) {
+            Test_Device_Instance = TEST_DEVICE_FIRST + d;
+            Test_I_Am_Sent = 0;
+            handler_who_is(apdu, apdu_len, &src);
+            segment->i_am[Test_Who_Is[w].time] += Test_I_Am_Sent;
+            if (Test_I_Am_Sent && !discovered[d]) {
+                discovered[d] = true;
+                found++;
+                if (found == TEST_DEVICES) {
+                    segment->discovered_ms = Test_Who_Is[w].time;
+                }
+            }
+        }
+    }
+    test_segment_summary(segment);
+}
+
+/* every device answers with its own responder */
+static void test_segment_responder(struct test_segment *segment)
+{
+    static WHO_IS_RESPONDER responder[TEST_DEVICES];
+    bool discovered[TEST_DEVICES] = { false };
+    BACNET_ADDRESS src;
+    uint8_t apdu[MAX_APDU];
+    uint16_t apdu_len;
+    unsigned found = 0;
+    unsigned w = 0;
+    unsigned d;
+    uint32_t t;
+
+    memset(segment, 0, sizeof(*segment));
+    for (d = 0; d < TEST_DEVICES; d++) {
+        who_is_responder_init(&responder[d], TEST_DEVICE_FIRST + d);
+    }
+    for (t = 0; t < TEST_SIMULATION_MS; t++) {
+        while ((w < ARRAY_SIZE(Test_Who_Is)) && (Test_Who_Is[w].time == t)) {
+            test_client_address(Test_Who_Is[w].client, &src);
+            apdu_len = test_who_is_encode(
+                apdu, Test_Who_Is[w].low_limit, Test_Who_Is[w].high_limit);
+            for (d = 0; d < TEST_DEVICES; d++) {
+                (void)who_is_responder_request(
+                    &responder[d], TEST_DEVICE_FIRST + d, apdu, apdu_len,
+                    &src);
+            }
+            w++;
+        }
+        for (d = 0; d < TEST_DEVICES; d++) {
+            if (who_is_responder_timer(&responder[d], 1) ==
+                WHO_IS_RESPONDER_NONE) {
+                continue;
+            }
+            segment->i_am[t]++;
+            if (!discovered[d]) {
+                discovered[d] = true;
+                found++;
+                if (found == TEST_DEVICES) {
+                    segment->discovered_ms = t;
+                }
+            }
+        }
+    }
+    zassert_equal(found, TEST_DEVICES, NULL);
+    test_segment_summary(segment);
+}
+
+/* periodic I-Am of one device in a day */
+static unsigned test_announcements(uint32_t min_ms, uint32_t max_ms)
+{
+    WHO_IS_RESPONDER responder;
+    unsigned count = 0;
+    uint32_t s;
+
+    who_is_responder_init(&responder, TEST_DEVICE_FIRST);
+    who_is_responder_announce_set(&responder, min_ms, max_ms);
+    who_is_responder_sent(&responder);
+    for (s = 0; s < 86400; s++) {
+        if (who_is_responder_timer(&responder, 1000) ==
+            WHO_IS_RESPONDER_ANNOUNCE) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief 200 devices on a B/IP segment, two workstations that discover
+ *  them at once: I-Am sent, the peak rate of I-Am on the segment, and
+ *  the time until the first workstation heard every device; and the
+ *  periodic I-Am of a device in a day
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(who_is_tests, test_who_is_storm_simulation)
+#else
+static void test_who_is_storm_simulation(void)
+#endif
+{
+    static struct test_segment immediate, limited;
+    unsigned fixed, adaptive;
+
+    test_segment_immediate(&immediate);
+    test_segment_responder(&limited);
+    printf(
+        "%u devices, %u Who-Is from 2 workstations, immediate: %u I-Am, "
+        "peak %u/s (%u in 1 ms), all heard after %u ms\n",
+        TEST_DEVICES, (unsigned)ARRAY_SIZE(Test_Who_Is), immediate.total,
+        immediate.peak_per_second, immediate.peak_per_ms,
+        (unsigned)immediate.discovered_ms);
+    printf(
+        "%u devices, %u Who-Is from 2 workstations, responder: %u I-Am, "
+        "peak %u/s (%u in 1 ms), all heard after %u ms\n",
+        TEST_DEVICES, (unsigned)ARRAY_SIZE(Test_Who_Is), limited.total,
+        limited.peak_per_second, limited.peak_per_ms,
+        (unsigned)limited.discovered_ms);
+    zassert_true(limited.total < immediate.total, NULL);
+    zassert_true(limited.peak_per_ms * 10 < immediate.peak_per_ms, NULL);
+    zassert_true(limited.discovered_ms < WHO_IS_REPLY_WINDOW_MS, NULL);
+    fixed = test_announcements(60000, 60000);
+    adaptive = test_announcements(60000, 960000);
+    printf(
+        "Periodic I-Am of a device in a day: every 60 s: %u, "
+        "60 s backing off to 960 s: %u\n",
+        fixed, adaptive);
+    zassert_equal(fixed, 1440, NULL);
+    zassert_true(adaptive < 100, NULL);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(who_is_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        who_is_tests, ztest_unit_test(test_who_is_responder_reply),
+        ztest_unit_test(test_who_is_responder_rate_limit),
+        ztest_unit_test(test_who_is_responder_announce),
+        ztest_unit_test(test_who_is_storm_simulation));
+
+    ztest_run_test_suite(who_is_tests);
+}
+#endif
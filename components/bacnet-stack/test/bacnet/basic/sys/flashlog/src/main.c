@@ -0,0 +1,340 @@
+/**
+ * @file
+ * @brief test the flash log against a file backed partition image, with
+ *  resets part way through writes and erases
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacint.h>
+#include <bacnet/basic/sys/flashlog.h>
+#include "flash_file.h"
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_FLASH_PATHNAME "test_flashlog.bin"
+#define TEST_FLASH_SIZE (64UL * 1024UL)
+#define TEST_SEGMENT_SIZE 4096UL
+#define TEST_SEGMENTS (TEST_FLASH_SIZE / TEST_SEGMENT_SIZE)
+#define TEST_RECORD_MAX 300
+#define TEST_POWER_CUTS 400
+
+static FLASH_LOG_DRIVER Test_Driver = {
+    .read = flash_file_read,
+    .write = flash_file_write,
+    .erase = flash_file_erase,
+};
+
+static FLASH_LOG Test_Log;
+static uint32_t Test_Random = 12345;
+
+static uint32_t test_random(void)
+{
+    Test_Random = (Test_Random * 1103515245UL) + 12345UL;
+
+    return (Test_Random >> 8) & 0xFFFFFF;
+}
+
+/* a blank partition, read through the map or through the driver */
+static void test_setup(bool mapped)
+{
+    flash_file_close(true);
+    zassert_true(
+        flash_file_open(
+            TEST_FLASH_PATHNAME, TEST_FLASH_SIZE, TEST_SEGMENT_SIZE),
+        NULL);
+    Test_Driver.mapped = mapped ? flash_file_mapped() : NULL;
+    zassert_true(
+        flash_log_init(
+            &Test_Log, &Test_Driver, TEST_FLASH_SIZE, TEST_SEGMENT_SIZE),
+        NULL);
+    zassert_equal(flash_log_segments_used(&Test_Log), 0, NULL);
+}
+
+/* a record: its id, then a pattern from the id */
+static size_t test_record(uint32_t id, uint8_t *record)
+{
+    size_t length = 4 + (id % (TEST_RECORD_MAX - 4));
+    size_t i;
+
+    encode_unsigned32(record, id);
+    for (i = 4; i < length; i++) {
+        record[i] = (uint8_t)(id + i);
+    }
+
+    return length;
+}
+
+static bool test_append(uint32_t id)
+{
+    uint8_t record[TEST_RECORD_MAX];
+
+    return flash_log_append(&Test_Log, record, test_record(id, record));
+}
+
+/**
+ * @brief Check every record of the log
+ * @param first - set to the id of the oldest record
+ * @return the number of records, with ids counting up one at a time
+ */
+static uint32_t test_records(uint32_t *first)
+{
+    FLASH_LOG_CURSOR cursor;
+    uint8_t buffer[TEST_RECORD_MAX];
+    uint8_t expected[TEST_RECORD_MAX];
+    const uint8_t *record;
+    uint32_t count = 0;
+    uint32_t id = 0;
+    size_t length;
+
+    if (!flash_log_first(&Test_Log, &cursor)) {
+        return 0;
+    }
+    do {
+        record = flash_log_read(&Test_Log, &cursor, buffer, sizeof(buffer));
+        zassert_not_null(record, NULL);
+        zassert_true(cursor.length >= 4, NULL);
+        decode_unsigned32(record, &id);
+        if (count == 0) {
+            *first = id;
+        } else {
+            zassert_equal(id, *first + count, NULL);
+        }
+        length = test_record(id, expected);
+        zassert_equal(cursor.length, length, NULL);
+        zassert_mem_equal(record, expected, length, NULL);
+        count++;
+    } while (flash_log_next(&Test_Log, &cursor));
+
+    return count;
+}
+
+/**
+ * @brief Records come back in order and whole, across laps of the ring
+ *  and a remount, mapped or not
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(flashlog_tests, test_flash_log_append)
+#else
+static void test_flash_log_append(void)
+#endif
+{
+    FLASH_LOG_CURSOR cursor;
+    uint8_t buffer[4];
+    uint32_t first = 0;
+    uint32_t count;
+    uint32_t id;
+    unsigned pass;
+
+    for (pass = 0; pass < 2; pass++) {
+        test_setup(pass == 0);
+        zassert_false(flash_log_first(&Test_Log, &cursor), NULL);
+        zassert_false(flash_log_append(&Test_Log, buffer, 0), NULL);
+        zassert_false(
+            flash_log_append(
+                &Test_Log, buffer, flash_log_record_max(&Test_Log) + 1),
+            NULL);
+        for (id = 0; id < 100; id++) {
+            zassert_true(test_append(id), NULL);
+        }
+        zassert_equal(test_records(&first), 100, NULL);
+        zassert_equal(first, 0, NULL);
+        /* several times round the ring */
+        for (; id < 2000; id++) {
+            zassert_true(test_append(id), NULL);
+        }
+        zassert_equal(flash_log_segments_used(&Test_Log), TEST_SEGMENTS, NULL);
+        count = test_records(&first);
+        zassert_equal(first + count, id, NULL);
+        /* no more than a segment of records is dropped at once */
+        zassert_true(count > (TEST_SEGMENTS - 1) * 14, NULL);
+        /* the same log after a reset */
+        zassert_true(
+            flash_log_init(
+                &Test_Log, &Test_Driver, TEST_FLASH_SIZE, TEST_SEGMENT_SIZE),
+            NULL);
+        zassert_equal(test_records(&first), count, NULL);
+        zassert_equal(first + count, id, NULL);
+        zassert_true(test_append(id), NULL);
+        zassert_equal(first + test_records(&first), id + 1, NULL);
+        /* a buffer too small to copy into */
+        zassert_true(flash_log_first(&Test_Log, &cursor), NULL);
+        if (pass == 1) {
+            zassert_is_null(
+                flash_log_read(&Test_Log, &cursor, buffer, sizeof(buffer)),
+                NULL);
+        } else {
+            zassert_not_null(flash_log_read(&Test_Log, &cursor, NULL, 0), NULL);
+        }
+        /* and a blank log once formatted */
+        zassert_true(flash_log_format(&Test_Log), NULL);
+        zassert_false(flash_log_first(&Test_Log, &cursor), NULL);
+        zassert_true(
+            flash_log_init(
+                &Test_Log, &Test_Driver, TEST_FLASH_SIZE, TEST_SEGMENT_SIZE),
+            NULL);
+        zassert_false(flash_log_first(&Test_Log, &cursor), NULL);
+    }
+    flash_file_close(true);
+}
+
+/**
+ * @brief Every segment is erased once per lap of the ring
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(flashlog_tests, test_flash_log_wear)
+#else
+static void test_flash_log_wear(void)
+#endif
+{
+    uint32_t least = UINT32_MAX;
+    uint32_t most = 0;
+    uint32_t erases;
+    uint32_t sector;
+    uint32_t id;
+
+    test_setup(true);
+    for (id = 0; id < 20000; id++) {
+        zassert_true(test_append(id), NULL);
+        if ((id % 5000) == 0) {
+            /* a reset now and then does not skew the wear */
+            zassert_true(
+                flash_log_init(
+                    &Test_Log, &Test_Driver, TEST_FLASH_SIZE,
+                    TEST_SEGMENT_SIZE),
+                NULL);
+        }
+    }
+    for (sector = 0; sector < TEST_SEGMENTS; sector++) {
+        erases = flash_file_erases(sector);
+        if (erases < least) {
+            least = erases;
+        }
+        if (erases > most) {
+            most = erases;
+        }
+    }
+    printf(
+        "flashlog: %u segments erased %u to %u times\n",
+        (unsigned)TEST_SEGMENTS, (unsigned)least, (unsigned)most);
+    zassert_true(least > 10, NULL);
+    zassert_true((most - least) <= 1, NULL);
+    zassert_equal(flash_log_erase_count(&Test_Log), most, NULL);
+    flash_file_close(true);
+}
+
+/**
+ * @brief A reset at any octet of a write or erase loses no record that
+ *  was written, and leaves no torn record behind
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(flashlog_tests, test_flash_log_power_cut)
+#else
+static void test_flash_log_power_cut(void)
+#endif
+{
+    uint32_t first = 0;
+    uint32_t count;
+    uint32_t written = 0;
+    uint32_t id = 0;
+    unsigned cut;
+    unsigned torn = 0;
+
+    test_setup(true);
+    for (cut = 0; cut < TEST_POWER_CUTS; cut++) {
+        flash_file_power_cut(1 + (test_random() % (8 * TEST_SEGMENT_SIZE)));
+        while (test_append(id)) {
+            written = id;
+            id++;
+        }
+        zassert_true(flash_file_power_off(), NULL);
+        flash_file_reset();
+        Test_Driver.mapped = (cut & 1) ? NULL : flash_file_mapped();
+        zassert_true(
+            flash_log_init(
+                &Test_Log, &Test_Driver, TEST_FLASH_SIZE, TEST_SEGMENT_SIZE),
+            NULL);
+        count = test_records(&first);
+        zassert_true(count > 0, NULL);
+        /* the last record written is there, and the one cut short is
+           there whole or not at all */
+        zassert_true(first <= written, NULL);
+        if ((first + count - 1) == id) {
+            torn++;
+        } else {
+            zassert_equal(first + count - 1, written, NULL);
+        }
+        id = first + count;
+        /* and the log goes on from there */
+        zassert_true(test_append(id), NULL);
+        written = id;
+        id++;
+        zassert_equal(first + test_records(&first), id, NULL);
+    }
+    printf(
+        "flashlog: %u resets, %u with the record in flight kept\n",
+        (unsigned)TEST_POWER_CUTS, torn);
+    flash_file_close(true);
+}
+
+/**
+ * @brief Mounting reads the segment headers and one segment, however
+ *  much the log holds
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(flashlog_tests, test_flash_log_recovery_bound)
+#else
+static void test_flash_log_recovery_bound(void)
+#endif
+{
+    const uint32_t bound = (2 * TEST_SEGMENTS * FLASH_LOG_SEGMENT_HEADER) +
+        (2 * TEST_SEGMENT_SIZE);
+    uint32_t most = 0;
+    uint32_t id;
+
+    test_setup(false);
+    for (id = 0; id < 3000; id++) {
+        zassert_true(test_append(id), NULL);
+        if ((id % 97) == 0) {
+            flash_file_counters_reset();
+            zassert_true(
+                flash_log_init(
+                    &Test_Log, &Test_Driver, TEST_FLASH_SIZE,
+                    TEST_SEGMENT_SIZE),
+                NULL);
+            if (flash_file_octets_read() > most) {
+                most = flash_file_octets_read();
+            }
+        }
+    }
+    printf(
+        "flashlog: mount reads at most %u octets of %lu\n", (unsigned)most,
+        (unsigned long)TEST_FLASH_SIZE);
+    zassert_true(most <= bound, NULL);
+    flash_file_close(true);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(flashlog_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        flashlog_tests, ztest_unit_test(test_flash_log_append),
+        ztest_unit_test(test_flash_log_wear),
+        ztest_unit_test(test_flash_log_power_cut),
+        ztest_unit_test(test_flash_log_recovery_bound));
+
+    ztest_run_test_suite(flashlog_tests);
+}
+#endif
@@ -0,0 +1,620 @@
+/**
+ * @file
+ * @brief test the packed object snapshot, and benchmark a cold start
+ *  restore from it against one store key per property
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <zephyr/ztest.h>
+#include <bacnet/basic/sys/nvsnapshot.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_STORE_PATHNAME "test_nvsnapshot.nvs"
+#define TEST_NAME_MAX 65
+#define TEST_DESCRIPTION_MAX 129
+/* keys are up to 15 characters, as in NVS */
+#define TEST_KEY_MAX 16
+
+/* the persisted properties of the objects of the display */
+typedef struct test_object {
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    const char *name;
+    const char *description;
+    uint16_t units;
+    float present_value;
+    uint32_t present_value_enumerated;
+    float cov_increment;
+    /* what the legacy restore reads the strings into */
+    char name_buffer[TEST_NAME_MAX];
+    char description_buffer[TEST_DESCRIPTION_MAX];
+} TEST_OBJECT;
+
+static TEST_OBJECT *Test_Objects;
+static unsigned Test_Object_Count;
+
+/**
+ * A key/value store in a file, with the key index in RAM as NVS keeps
+ * it once mounted: every read is an index lookup and a read of the file.
+ */
+typedef struct test_store_key {
+    char key[TEST_KEY_MAX];
+    uint32_t offset;
+    uint32_t length;
+} TEST_STORE_KEY;
+
+static TEST_STORE_KEY *Store_Index;
+static unsigned Store_Index_Size;
+static int Store_File = -1;
+static uint32_t Store_End;
+static unsigned Store_Reads;
+
+static uint32_t test_store_hash(const char *key)
+{
+    uint32_t hash = 2166136261UL;
+
+    while (*key) {
+        hash = (hash ^ (uint8_t)*key++) * 16777619UL;
+    }
+
+    return hash;
+}
+
+static TEST_STORE_KEY *test_store_key(const char *key, bool create)
+{
+    unsigned i = test_store_hash(key) & (Store_Index_Size - 1);
+
+    while (Store_Index[i].key[0]) {
+        if (strcmp(Store_Index[i].key, key) == 0) {
+            return &Store_Index[i];
+        }
+        i = (i + 1) & (Store_Index_Size - 1);
+    }
+    if (!create) {
+        return NULL;
+    }
+    zassert_true(strlen(key) < sizeof(Store_Index[i].key), NULL);
+    snprintf(Store_Index[i].key, sizeof(Store_Index[i].key), "%s", key);
+
+    return &Store_Index[i];
+}
+
+static void test_store_open(unsigned keys_max)
+{
+    Store_Index_Size = 16;
+    while (Store_Index_Size < (keys_max * 2)) {
+        Store_Index_Size *= 2;
+    }
+    Store_Index = calloc(Store_Index_Size, sizeof(TEST_STORE_KEY));
+    zassert_not_null(Store_Index, NULL);
+    Store_File =
+        open(TEST_STORE_PATHNAME, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    zassert_true(Store_File >= 0, NULL);
+    Store_End = 0;
+    Store_Reads = 0;
+}
+
+static void test_store_close(void)
+{
+    close(Store_File);
+    Store_File = -1;
+    unlink(TEST_STORE_PATHNAME);
+    free(Store_Index);
+    Store_Index = NULL;
+}
+
+static void test_store_set(const char *key, const void *data, size_t length)
+{
+    TEST_STORE_KEY *entry = test_store_key(key, true);
+
+    zassert_equal(
+        pwrite(Store_File, data, length, Store_End), (ssize_t)length, NULL);
+    entry->offset = Store_End;
+    entry->length = (uint32_t)length;
+    Store_End += (uint32_t)length;
+}
+
+static bool test_store_get(const char *key, void *data, size_t *length)
+{
+    TEST_STORE_KEY *entry = test_store_key(key, false);
+
+    if (!entry || (entry->length > *length)) {
+        return false;
+    }
+    Store_Reads++;
+    if (pread(Store_File, data, entry->length, entry->offset) !=
+        (ssize_t)entry->length) {
+        return false;
+    }
+    *length = entry->length;
+
+    return true;
+}
+
+/* AV, BV and AI in turn, as the display creates them */
+static void test_objects_create(unsigned count)
+{
+    static const char *names[] = { "Setpoint", "Fan Enable", "PM2.5" };
+    static const char *descriptions[] = {
+        "Zone temperature setpoint written by the supervisor",
+        "Starts the air handler fan",
+        "Particulate matter from the PMS5003 sensor"
+    };
+    TEST_OBJECT *object;
+    unsigned i;
+
+    Test_Objects = calloc(count, sizeof(TEST_OBJECT));
+    zassert_not_null(Test_Objects, NULL);
+    Test_Object_Count = count;
+    for (i = 0; i < count; i++) {
+        object = &Test_Objects[i];
+        object->object_instance = i;
+        switch (i % 3) {
+            case 0:
+                object->object_type = OBJECT_ANALOG_VALUE;
+                object->units = UNITS_DEGREES_CELSIUS;
+                object->present_value = 21.5f + (float)i;
+                object->cov_increment = 0.5f;
+                break;
+            case 1:
+                object->object_type = OBJECT_BINARY_VALUE;
+                object->present_value_enumerated = i & 1;
+                break;
+            default:
+                object->object_type = OBJECT_ANALOG_INPUT;
+                object->units = UNITS_MICROGRAMS_PER_CUBIC_METER;
+                object->cov_increment = 1.0f;
+                break;
+        }
+        snprintf(
+            object->name_buffer, sizeof(object->name_buffer), "%s %u",
+            names[i % 3], i);
+        snprintf(
+            object->description_buffer, sizeof(object->description_buffer),
+            "%s", descriptions[i % 3]);
+        object->name = object->name_buffer;
+        object->description = object->description_buffer;
+    }
+}
+
+static void test_objects_delete(void)
+{
+    free(Test_Objects);
+    Test_Objects = NULL;
+    Test_Object_Count = 0;
+}
+
+/* back to the defaults the firmware creates the objects with */
+static void test_objects_reset(void)
+{
+    TEST_OBJECT *object;
+    unsigned i;
+
+    for (i = 0; i < Test_Object_Count; i++) {
+        object = &Test_Objects[i];
+        object->name = "";
+        object->description = "";
+        object->units = UNITS_NO_UNITS;
+        object->present_value = 0.0f;
+        object->present_value_enumerated = 0;
+        object->cov_increment = 0.0f;
+        memset(object->name_buffer, 0, sizeof(object->name_buffer));
+        memset(
+            object->description_buffer, 0,
+            sizeof(object->description_buffer));
+    }
+}
+
+static bool test_object_get(
+    unsigned index, NV_SNAPSHOT_OBJECT *snapshot, void *context)
+{
+    TEST_OBJECT *object;
+
+    (void)context;
+    if (index >= Test_Object_Count) {
+        return false;
+    }
+    object = &Test_Objects[index];
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->object_type = object->object_type;
+    snapshot->object_instance = object->object_instance;
+    snapshot->name = object->name;
+    snapshot->description = object->description;
+    snapshot->properties = NV_SNAPSHOT_NAME | NV_SNAPSHOT_DESCRIPTION;
+    switch (object->object_type) {
+        case OBJECT_ANALOG_VALUE:
+            snapshot->properties |= NV_SNAPSHOT_UNITS |
+                NV_SNAPSHOT_PRESENT_VALUE_REAL | NV_SNAPSHOT_COV_INCREMENT;
+            break;
+        case OBJECT_BINARY_VALUE:
+            snapshot->properties |= NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED;
+            break;
+        default:
+            snapshot->properties |=
+                NV_SNAPSHOT_UNITS | NV_SNAPSHOT_COV_INCREMENT;
+            break;
+    }
+    snapshot->units = object->units;
+    snapshot->present_value = object->present_value;
+    snapshot->present_value_enumerated = object->present_value_enumerated;
+    snapshot->cov_increment = object->cov_increment;
+
+    return true;
+}
+
+static void test_object_set(const NV_SNAPSHOT_OBJECT *snapshot, void *context)
+{
+    TEST_OBJECT *object;
+
+    (void)context;
+    if (snapshot->object_instance >= Test_Object_Count) {
+        return;
+    }
+    object = &Test_Objects[snapshot->object_instance];
+    if (object->object_type != snapshot->object_type) {
+        return;
+    }
+    if (snapshot->properties & NV_SNAPSHOT_NAME) {
+        object->name = snapshot->name;
+    }
+    if (snapshot->properties & NV_SNAPSHOT_DESCRIPTION) {
+        object->description = snapshot->description;
+    }
+    if (snapshot->properties & NV_SNAPSHOT_UNITS) {
+        object->units = snapshot->units;
+    }
+    if (snapshot->properties & NV_SNAPSHOT_PRESENT_VALUE_REAL) {
+        object->present_value = snapshot->present_value;
+    }
+    if (snapshot->properties & NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED) {
+        object->present_value_enumerated = snapshot->present_value_enumerated;
+    }
+    if (snapshot->properties & NV_SNAPSHOT_COV_INCREMENT) {
+        object->cov_increment = snapshot->cov_increment;
+    }
+}
+
+/* "ai" as the display uses; its "analog" and "binary" prefixes go over
+   the 15 character key limit of NVS from instance 1000 */
+static const char *test_legacy_prefix(BACNET_OBJECT_TYPE object_type)
+{
+    switch (object_type) {
+        case OBJECT_ANALOG_VALUE:
+            return "av";
+        case OBJECT_BINARY_VALUE:
+            return "bv";
+        default:
+            return "ai";
+    }
+}
+
+/* one key per property, as bacnet_nvs_save_av_name() and friends */
+static void test_legacy_save(void)
+{
+    char key[32];
+    const char *prefix;
+    TEST_OBJECT *object;
+    uint8_t state;
+    unsigned i;
+
+    for (i = 0; i < Test_Object_Count; i++) {
+        object = &Test_Objects[i];
+        prefix = test_legacy_prefix(object->object_type);
+        snprintf(key, sizeof(key), "%s_%u_name", prefix, i);
+        test_store_set(key, object->name, strlen(object->name) + 1);
+        snprintf(key, sizeof(key), "%s_%u_desc", prefix, i);
+        test_store_set(
+            key, object->description, strlen(object->description) + 1);
+        snprintf(key, sizeof(key), "%s_%u_val", prefix, i);
+        if (object->object_type == OBJECT_BINARY_VALUE) {
+            state = (uint8_t)object->present_value_enumerated;
+            test_store_set(key, &state, sizeof(state));
+        } else {
+            test_store_set(
+                key, &object->present_value, sizeof(object->present_value));
+        }
+        if (object->object_type == OBJECT_ANALOG_VALUE) {
+            snprintf(key, sizeof(key), "%s_%u_unit", prefix, i);
+            test_store_set(key, &object->units, sizeof(object->units));
+        }
+    }
+}
+
+/* as bacnet_nvs_load_av() and friends */
+static void test_legacy_restore(void)
+{
+    char key[32];
+    const char *prefix;
+    TEST_OBJECT *object;
+    uint8_t state;
+    size_t len;
+    unsigned i;
+
+    for (i = 0; i < Test_Object_Count; i++) {
+        object = &Test_Objects[i];
+        prefix = test_legacy_prefix(object->object_type);
+        snprintf(key, sizeof(key), "%s_%u_name", prefix, i);
+        len = sizeof(object->name_buffer);
+        if (test_store_get(key, object->name_buffer, &len)) {
+            object->name = object->name_buffer;
+        }
+        snprintf(key, sizeof(key), "%s_%u_desc", prefix, i);
+        len = sizeof(object->description_buffer);
+        if (test_store_get(key, object->description_buffer, &len)) {
+            object->description = object->description_buffer;
+        }
+        snprintf(key, sizeof(key), "%s_%u_val", prefix, i);
+        if (object->object_type == OBJECT_BINARY_VALUE) {
+            len = sizeof(state);
+            if (test_store_get(key, &state, &len)) {
+                object->present_value_enumerated = state;
+            }
+        } else {
+            len = sizeof(object->present_value);
+            (void)test_store_get(key, &object->present_value, &len);
+        }
+        if (object->object_type == OBJECT_ANALOG_VALUE) {
+            snprintf(key, sizeof(key), "%s_%u_unit", prefix, i);
+            len = sizeof(object->units);
+            (void)test_store_get(key, &object->units, &len);
+        }
+    }
+}
+
+/* a single read of the blob, which the restored names point into */
+static uint8_t *test_snapshot_restore(size_t size, int *count)
+{
+    uint8_t *buffer;
+    size_t len = size;
+
+    buffer = malloc(size);
+    zassert_not_null(buffer, NULL);
+    *count = -1;
+    if (test_store_get(NV_SNAPSHOT_KEY, buffer, &len)) {
+        *count = nv_snapshot_decode(buffer, len, test_object_set, NULL);
+    }
+
+    return buffer;
+}
+
+static uint8_t *test_snapshot_save(size_t *length)
+{
+    uint8_t *buffer;
+    size_t size;
+
+    size = nv_snapshot_size(test_object_get, NULL);
+    buffer = malloc(size);
+    zassert_not_null(buffer, NULL);
+    *length = nv_snapshot_encode(buffer, size, test_object_get, NULL);
+    zassert_equal(*length, size, NULL);
+
+    return buffer;
+}
+
+/**
+ * @brief Every property round trips, and restored names point into the
+ *  snapshot
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(nvsnapshot_tests, test_nv_snapshot_round_trip)
+#else
+static void test_nv_snapshot_round_trip(void)
+#endif
+{
+    NV_SNAPSHOT_OBJECT object = { 0 };
+    uint8_t *buffer;
+    size_t length;
+    unsigned count = 0;
+    unsigned i;
+
+    test_objects_create(6);
+    /* no description, and an empty name */
+    Test_Objects[4].name = "";
+    buffer = test_snapshot_save(&length);
+    zassert_true(nv_snapshot_valid(buffer, length, &count), NULL);
+    zassert_equal(count, 6, NULL);
+    test_objects_reset();
+    zassert_equal(
+        nv_snapshot_decode(buffer, length, test_object_set, NULL), 6, NULL);
+    zassert_equal(strcmp(Test_Objects[0].name, "Setpoint 0"), 0, NULL);
+    zassert_equal(strcmp(Test_Objects[4].name, ""), 0, NULL);
+    zassert_equal(strcmp(Test_Objects[5].name, "PM2.5 5"), 0, NULL);
+    zassert_true(
+        (Test_Objects[0].name >= (const char *)buffer) &&
+            (Test_Objects[0].name < (const char *)&buffer[length]),
+        NULL);
+    zassert_equal(
+        strcmp(
+            Test_Objects[1].description, "Starts the air handler fan"),
+        0, NULL);
+    for (i = 0; i < 6; i++) {
+        zassert_equal(Test_Objects[i].object_instance, i, NULL);
+    }
+    zassert_equal(Test_Objects[3].units, UNITS_DEGREES_CELSIUS, NULL);
+    zassert_true(Test_Objects[3].present_value > 24.4f, NULL);
+    zassert_true(Test_Objects[3].present_value < 24.6f, NULL);
+    zassert_true(Test_Objects[3].cov_increment > 0.4f, NULL);
+    zassert_equal(Test_Objects[1].present_value_enumerated, 1, NULL);
+    zassert_equal(Test_Objects[4].present_value_enumerated, 0, NULL);
+    zassert_equal(
+        Test_Objects[5].units, UNITS_MICROGRAMS_PER_CUBIC_METER, NULL);
+    /* a single object */
+    zassert_true(
+        nv_snapshot_object_find(
+            buffer, length, OBJECT_BINARY_VALUE, 4, &object),
+        NULL);
+    zassert_equal(object.properties & NV_SNAPSHOT_UNITS, 0, NULL);
+    zassert_false(
+        nv_snapshot_object_find(
+            buffer, length, OBJECT_ANALOG_VALUE, 4, &object),
+        NULL);
+    /* too small a buffer */
+    zassert_equal(
+        nv_snapshot_encode(buffer, length - 1, test_object_get, NULL), 0,
+        NULL);
+    free(buffer);
+    test_objects_delete();
+}
+
+/**
+ * @brief A snapshot that is cut short, damaged, or of a newer version
+ *  is not restored
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(nvsnapshot_tests, test_nv_snapshot_invalid)
+#else
+static void test_nv_snapshot_invalid(void)
+#endif
+{
+    uint8_t *buffer;
+    size_t length;
+    size_t i;
+
+    test_objects_create(9);
+    buffer = test_snapshot_save(&length);
+    zassert_equal(nv_snapshot_decode(buffer, length, NULL, NULL), 9, NULL);
+    zassert_equal(
+        nv_snapshot_decode(buffer, length - 1, NULL, NULL), -1, NULL);
+    zassert_equal(nv_snapshot_decode(buffer, 0, NULL, NULL), -1, NULL);
+    zassert_equal(nv_snapshot_decode(NULL, length, NULL, NULL), -1, NULL);
+    for (i = 0; i < length; i += 7) {
+        buffer[i] ^= 0x20;
+        zassert_equal(
+            nv_snapshot_decode(buffer, length, test_object_set, NULL), -1,
+            NULL);
+        buffer[i] ^= 0x20;
+    }
+    buffer[2] = NV_SNAPSHOT_VERSION + 1;
+    zassert_false(nv_snapshot_valid(buffer, length, NULL), NULL);
+    free(buffer);
+    test_objects_delete();
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec now = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+static void test_cold_start(unsigned count)
+{
+    TEST_OBJECT *expected;
+    uint8_t *snapshot;
+    uint8_t *restored;
+    uint64_t start, legacy_ns, migrate_ns, snapshot_ns;
+    unsigned legacy_reads, snapshot_reads;
+    size_t length;
+    int restored_count;
+    unsigned i;
+
+    test_objects_create(count);
+    expected = malloc(count * sizeof(TEST_OBJECT));
+    zassert_not_null(expected, NULL);
+    memcpy(expected, Test_Objects, count * sizeof(TEST_OBJECT));
+    test_store_open(count * 4 + 1);
+    test_legacy_save();
+
+    /* the legacy layout: a formatted key and a read per property */
+    test_objects_reset();
+    Store_Reads = 0;
+    start = test_clock_ns();
+    test_legacy_restore();
+    legacy_ns = test_clock_ns() - start;
+    legacy_reads = Store_Reads;
+
+    /* the first boot with a snapshot: none yet, so restore from the
+       legacy keys and write the snapshot */
+    test_objects_reset();
+    Store_Reads = 0;
+    start = test_clock_ns();
+    restored = test_snapshot_restore(count * 256, &restored_count);
+    zassert_equal(restored_count, -1, NULL);
+    test_legacy_restore();
+    snapshot = test_snapshot_save(&length);
+    test_store_set(NV_SNAPSHOT_KEY, snapshot, length);
+    migrate_ns = test_clock_ns() - start;
+    free(snapshot);
+    free(restored);
+
+    /* every boot after */
+    test_objects_reset();
+    Store_Reads = 0;
+    start = test_clock_ns();
+    restored = test_snapshot_restore(length, &restored_count);
+    snapshot_ns = test_clock_ns() - start;
+    snapshot_reads = Store_Reads;
+    zassert_equal(restored_count, (int)count, NULL);
+    for (i = 0; i < count; i++) {
+        zassert_equal(
+            strcmp(Test_Objects[i].name, expected[i].name_buffer), 0, NULL);
+        zassert_equal(
+            strcmp(
+                Test_Objects[i].description,
+                expected[i].description_buffer),
+            0, NULL);
+        if (expected[i].object_type == OBJECT_ANALOG_VALUE) {
+            /* the legacy layout keeps only the units of an AV */
+            zassert_equal(Test_Objects[i].units, expected[i].units, NULL);
+        }
+        zassert_equal(
+            Test_Objects[i].present_value_enumerated,
+            expected[i].present_value_enumerated, NULL);
+    }
+    printf(
+        "  %5u objects  per-key %8.1f us %5u reads  migrate %8.1f us  "
+        "snapshot %7.1f us %u read %6zu octets\n",
+        count, (double)legacy_ns / 1000.0, legacy_reads,
+        (double)migrate_ns / 1000.0, (double)snapshot_ns / 1000.0,
+        snapshot_reads, length);
+    zassert_equal(snapshot_reads, 1, NULL);
+    free(restored);
+    free(expected);
+    test_store_close();
+    test_objects_delete();
+}
+
+/**
+ * @brief Cold start restore time of 20, 200 and 2000 objects
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(nvsnapshot_tests, test_nv_snapshot_benchmark)
+#else
+static void test_nv_snapshot_benchmark(void)
+#endif
+{
+    printf("nvsnapshot: cold start restore of AV, BV and AI objects\n");
+    test_cold_start(20);
+    test_cold_start(200);
+    test_cold_start(2000);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(nvsnapshot_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        nvsnapshot_tests, ztest_unit_test(test_nv_snapshot_round_trip),
+        ztest_unit_test(test_nv_snapshot_invalid),
+        ztest_unit_test(test_nv_snapshot_benchmark));
+
+    ztest_run_test_suite(nvsnapshot_tests);
+}
+#endif
@@ -0,0 +1,266 @@
+/**
+ * @file
+ * @brief test the arena of interned strings and their pre-encoded
+ *  CharacterString octets
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdcode.h>
+#include <bacnet/bacstr.h>
+#include <bacnet/basic/sys/strarena.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+/* octets of strings in the arena of each test */
+#define TEST_ARENA_OCTETS 1024
+/* most strings added in each test */
+#define TEST_ARENA_STRINGS 16
+
+static char Test_Data[TEST_ARENA_OCTETS];
+static uint32_t Test_Index[2 * TEST_ARENA_STRINGS];
+
+/**
+ * @brief Without an index the arena stores every string it is given,
+ *  each with its prefix and terminator, and refuses what does not fit
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(strarena_tests, test_string_arena_add)
+#else
+static void test_string_arena_add(void)
+#endif
+{
+    STRING_ARENA arena;
+    const char *one, *two, *three;
+    size_t size = 3 * string_arena_need_length(3);
+
+    string_arena_init(&arena, Test_Data, size);
+    zassert_equal(string_arena_need("AV1"), STRING_ARENA_PREFIX + 4, NULL);
+    zassert_equal(string_arena_need(NULL), 0, NULL);
+    one = string_arena_add(&arena, "AV1");
+    zassert_not_null(one, NULL);
+    zassert_equal(strcmp(one, "AV1"), 0, NULL);
+    two = string_arena_add_length(&arena, "BV12345", 3);
+    zassert_not_null(two, NULL);
+    zassert_equal(strcmp(two, "BV1"), 0, NULL);
+    zassert_equal(two - one, (ptrdiff_t)string_arena_need_length(3), NULL);
+    zassert_equal(string_arena_length(&arena, two), 3, NULL);
+    zassert_equal(string_arena_used(&arena), 2 * string_arena_need("AV1"),
+        NULL);
+    zassert_true(string_arena_contains(&arena, two), NULL);
+    zassert_false(string_arena_contains(&arena, "AV1"), NULL);
+    zassert_equal(string_arena_length(&arena, "AV1"), 0, NULL);
+    /* no index: the same string again is a second copy */
+    three = string_arena_add(&arena, "AV1");
+    zassert_not_null(three, NULL);
+    zassert_true(three != one, NULL);
+    zassert_equal(string_arena_free(&arena), 0, NULL);
+    zassert_is_null(string_arena_add(&arena, ""), NULL);
+    zassert_is_null(string_arena_add(&arena, NULL), NULL);
+    zassert_is_null(string_arena_add(NULL, "AV1"), NULL);
+}
+
+/**
+ * @brief With an index, a string added twice is stored once
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(strarena_tests, test_string_arena_dedup)
+#else
+static void test_string_arena_dedup(void)
+#endif
+{
+    STRING_ARENA arena;
+    const char *active, *inactive;
+    size_t used;
+
+    zassert_equal(
+        string_arena_index_size(TEST_ARENA_STRINGS), sizeof(Test_Index), NULL);
+    string_arena_init(&arena, Test_Data, sizeof(Test_Data));
+    string_arena_index_set(&arena, Test_Index, sizeof(Test_Index));
+    active = string_arena_add(&arena, "ACTIVE");
+    inactive = string_arena_add(&arena, "INACTIVE");
+    zassert_not_null(active, NULL);
+    zassert_not_null(inactive, NULL);
+    used = string_arena_used(&arena);
+    zassert_true(string_arena_add(&arena, "ACTIVE") == active, NULL);
+    zassert_true(string_arena_add_length(&arena, "INACTIVE!", 8) == inactive,
+        NULL);
+    /* a string is not a duplicate of another that it begins */
+    zassert_true(string_arena_add_length(&arena, "ACTIVE", 3) != active,
+        NULL);
+    zassert_equal(arena.duplicates, 2, NULL);
+    zassert_equal(arena.strings, 3, NULL);
+    zassert_equal(
+        string_arena_used(&arena), used + string_arena_need_length(3), NULL);
+    /* the empty string is a string too */
+    zassert_true(
+        string_arena_add(&arena, "") == string_arena_add(&arena, ""), NULL);
+}
+
+/**
+ * @brief The index can be removed once the strings are added, and set
+ *  again over the strings already in the arena
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(strarena_tests, test_string_arena_index_set)
+#else
+static void test_string_arena_index_set(void)
+#endif
+{
+    STRING_ARENA arena;
+    const char *name, *description, *copy;
+
+    string_arena_init(&arena, Test_Data, sizeof(Test_Data));
+    string_arena_index_set(&arena, Test_Index, sizeof(Test_Index));
+    name = string_arena_add(&arena, "AV1");
+    description = string_arena_add(&arena, "PM2.5 from PMS5003");
+    string_arena_index_set(&arena, NULL, 0);
+    zassert_is_null(arena.index, NULL);
+    copy = string_arena_add(&arena, "AV1");
+    zassert_true(copy != name, NULL);
+    zassert_equal(strcmp(copy, name), 0, NULL);
+    /* too small for an index */
+    string_arena_index_set(&arena, Test_Index, sizeof(uint32_t));
+    zassert_is_null(arena.index, NULL);
+    string_arena_index_set(&arena, Test_Index, sizeof(Test_Index));
+    zassert_equal(arena.indexed, 2, NULL);
+    zassert_true(string_arena_add(&arena, "AV1") == name, NULL);
+    zassert_true(
+        string_arena_add(&arena, "PM2.5 from PMS5003") == description, NULL);
+    zassert_equal(strcmp(string_arena_add(&arena, "AV2"), "AV2"), 0, NULL);
+    zassert_equal(arena.indexed, 3, NULL);
+    zassert_equal(arena.strings, 4, NULL);
+}
+
+/**
+ * @brief Once the index is half full, strings are still stored, but no
+ *  longer found again
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(strarena_tests, test_string_arena_index_full)
+#else
+static void test_string_arena_index_full(void)
+#endif
+{
+    static const char *text[] = { "A", "B", "C", "D", "E", "F" };
+    STRING_ARENA arena;
+    const char *copy[6];
+    unsigned i;
+
+    /* eight slots, of which four are used */
+    string_arena_init(&arena, Test_Data, sizeof(Test_Data));
+    string_arena_index_set(&arena, Test_Index, string_arena_index_size(1));
+    zassert_equal(arena.index_mask, 7, NULL);
+    for (i = 0; i < 6; i++) {
+        copy[i] = string_arena_add(&arena, text[i]);
+        zassert_not_null(copy[i], NULL);
+    }
+    zassert_true(string_arena_add(&arena, "D") == copy[3], NULL);
+    zassert_true(string_arena_add(&arena, "E") != copy[4], NULL);
+    zassert_equal(strcmp(string_arena_add(&arena, "F"), "F"), 0, NULL);
+}
+
+/* Encode a string with the arena and the usual way, and compare */
+static void test_string_arena_encode_same(STRING_ARENA *arena, size_t length)
+{
+    static char text[300];
+    uint8_t apdu[320] = { 0 };
+    uint8_t expected[320] = { 0 };
+    BACNET_CHARACTER_STRING char_string;
+    const char *string;
+    int len, expected_len;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        text[i] = (char)('a' + (i % 26));
+    }
+    text[length] = 0;
+    string = string_arena_add(arena, text);
+    zassert_not_null(string, NULL);
+    zassert_equal(string_arena_length(arena, string), length, NULL);
+    zassert_true(characterstring_init_ansi(&char_string, text), NULL);
+    expected_len = encode_application_character_string(expected, &char_string);
+    len = string_arena_encode(arena, string, NULL);
+    zassert_equal(len, expected_len, "length=%u", (unsigned)length);
+    len = string_arena_encode(arena, string, apdu);
+    zassert_equal(len, expected_len, "length=%u", (unsigned)length);
+    zassert_equal(memcmp(apdu, expected, len), 0, "length=%u",
+        (unsigned)length);
+}
+
+/**
+ * @brief The pre-encoded octets are those of
+ *  encode_application_character_string(), for each form of tag length
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(strarena_tests, test_string_arena_encode)
+#else
+static void test_string_arena_encode(void)
+#endif
+{
+    STRING_ARENA arena;
+    uint8_t apdu[32] = { 0 };
+    uint8_t expected[32] = { 0 };
+    BACNET_CHARACTER_STRING char_string;
+    const char *name;
+    int len;
+
+    zassert_equal(
+        string_arena_index_size(TEST_ARENA_STRINGS), sizeof(Test_Index), NULL);
+    string_arena_init(&arena, Test_Data, sizeof(Test_Data));
+    string_arena_index_set(&arena, Test_Index, sizeof(Test_Index));
+    /* length in the tag, in one octet, and in two octets */
+    test_string_arena_encode_same(&arena, 0);
+    test_string_arena_encode_same(&arena, 3);
+    test_string_arena_encode_same(&arena, 4);
+    test_string_arena_encode_same(&arena, 252);
+    test_string_arena_encode_same(&arena, 253);
+    test_string_arena_encode_same(&arena, 254);
+    /* a string the arena does not hold */
+    zassert_equal(string_arena_encode(&arena, "AV1", apdu), 0, NULL);
+    zassert_equal(string_arena_encode(NULL, "AV1", apdu), 0, NULL);
+
+    /* the shared arena is used when set, and the usual encoding when not */
+    name = string_arena_add(&arena, "AV1");
+    characterstring_init_ansi(&char_string, "AV1");
+    len = encode_application_character_string(expected, &char_string);
+    string_arena_shared_set(NULL);
+    zassert_equal(string_arena_encode_ansi(apdu, name), len, NULL);
+    zassert_equal(memcmp(apdu, expected, len), 0, NULL);
+    string_arena_shared_set(&arena);
+    zassert_true(string_arena_shared() == &arena, NULL);
+    memset(apdu, 0, sizeof(apdu));
+    zassert_equal(string_arena_encode_ansi(apdu, name), len, NULL);
+    zassert_equal(memcmp(apdu, expected, len), 0, NULL);
+    zassert_equal(string_arena_encode_ansi(NULL, "AV1"), len, NULL);
+    /* NULL is the empty string */
+    characterstring_init_ansi(&char_string, NULL);
+    len = encode_application_character_string(expected, &char_string);
+    zassert_equal(string_arena_encode_ansi(apdu, NULL), len, NULL);
+    zassert_equal(memcmp(apdu, expected, len), 0, NULL);
+    string_arena_shared_set(NULL);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(strarena_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        strarena_tests, ztest_unit_test(test_string_arena_add),
+        ztest_unit_test(test_string_arena_dedup),
+        ztest_unit_test(test_string_arena_index_set),
+        ztest_unit_test(test_string_arena_index_full),
+        ztest_unit_test(test_string_arena_encode));
+
+    ztest_run_test_suite(strarena_tests);
+}
+#endif
@@ -0,0 +1,273 @@
+/**
+ * @file
+ * @brief A file backed stand-in for a flash partition, for host tests of
+ *  the flash log.
+ *
+ * The partition is a file, mapped into memory as a flash partition is
+ * mapped on the target.  It behaves as NOR flash: an erase sets a whole
+ * sector to all ones and a write only clears bits.  flash_file_power_cut()
+ * fails the power after a number of octets have been written or erased:
+ * the write or erase in progress stops part way, with the octet it stopped
+ * at left with random bits, and every later access fails until
+ * flash_file_reset().
+ *
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "flash_file.h"
+
+#define FLASH_FILE_SECTORS_MAX 1024
+
+static char Flash_Pathname[256];
+static int Flash_File = -1;
+static uint8_t *Flash_Mapped;
+static uint32_t Flash_Size;
+static uint32_t Flash_Sector;
+static uint32_t Flash_Erases[FLASH_FILE_SECTORS_MAX];
+static uint32_t Flash_Octets_Read;
+/* octets left before the power fails, or 0 for none */
+static uint32_t Flash_Power_Cut;
+static bool Flash_Power_Off;
+static uint32_t Flash_Random = 0x2545F491;
+
+static uint8_t flash_file_random(void)
+{
+    Flash_Random ^= Flash_Random << 13;
+    Flash_Random ^= Flash_Random >> 17;
+    Flash_Random ^= Flash_Random << 5;
+
+    return (uint8_t)Flash_Random;
+}
+
+/**
+ * @brief Take octets from the power budget
+ * @return the octets done before the power fails
+ */
+static size_t flash_file_budget(size_t length)
+{
+    if (Flash_Power_Cut == 0) {
+        return length;
+    }
+    if (length < Flash_Power_Cut) {
+        Flash_Power_Cut -= (uint32_t)length;
+        return length;
+    }
+    length = Flash_Power_Cut;
+    Flash_Power_Cut = 0;
+    Flash_Power_Off = true;
+
+    return length;
+}
+
+/**
+ * @brief Open a partition image, creating an erased one if there is none
+ */
+bool flash_file_open(const char *pathname, uint32_t size, uint32_t sector)
+{
+    uint8_t erased[256];
+    uint32_t offset;
+
+    if ((size % sector) || ((size / sector) > FLASH_FILE_SECTORS_MAX)) {
+        return false;
+    }
+    snprintf(Flash_Pathname, sizeof(Flash_Pathname), "%s", pathname);
+    Flash_File = open(Flash_Pathname, O_RDWR | O_CREAT, 0644);
+    if (Flash_File < 0) {
+        return false;
+    }
+    if (lseek(Flash_File, 0, SEEK_END) != (off_t)size) {
+        memset(erased, 0xFF, sizeof(erased));
+        if (ftruncate(Flash_File, 0) != 0) {
+            return false;
+        }
+        for (offset = 0; offset < size; offset += sizeof(erased)) {
+            if (pwrite(Flash_File, erased, sizeof(erased), offset) !=
+                (ssize_t)sizeof(erased)) {
+                return false;
+            }
+        }
+    }
+    Flash_Mapped = mmap(NULL, size, PROT_READ, MAP_SHARED, Flash_File, 0);
+    if (Flash_Mapped == MAP_FAILED) {
+        Flash_Mapped = NULL;
+        return false;
+    }
+    Flash_Size = size;
+    Flash_Sector = sector;
+    Flash_Power_Cut = 0;
+    Flash_Power_Off = false;
+    memset(Flash_Erases, 0, sizeof(Flash_Erases));
+    flash_file_counters_reset();
+
+    return true;
+}
+
+void flash_file_close(bool remove_file)
+{
+    if (Flash_Mapped) {
+        munmap(Flash_Mapped, Flash_Size);
+        Flash_Mapped = NULL;
+    }
+    if (Flash_File >= 0) {
+        close(Flash_File);
+        Flash_File = -1;
+    }
+    if (remove_file) {
+        remove(Flash_Pathname);
+    }
+}
+
+/**
+ * @brief The partition mapped into memory, read only
+ */
+const uint8_t *flash_file_mapped(void)
+{
+    return Flash_Mapped;
+}
+
+/**
+ * @brief Reset: restore power.  What was written stays written.
+ */
+void flash_file_reset(void)
+{
+    Flash_Power_Cut = 0;
+    Flash_Power_Off = false;
+}
+
+/**
+ * @brief Fail the power after the given number of octets are written or
+ *  erased
+ */
+void flash_file_power_cut(uint32_t octets)
+{
+    Flash_Power_Cut = octets;
+    Flash_Power_Off = (octets == 0);
+}
+
+bool flash_file_power_off(void)
+{
+    return Flash_Power_Off;
+}
+
+bool flash_file_read(
+    void *context, uint32_t address, void *data, size_t length)
+{
+    (void)context;
+    if (Flash_Power_Off || ((address + length) > Flash_Size)) {
+        return false;
+    }
+    Flash_Octets_Read += (uint32_t)length;
+
+    return pread(Flash_File, data, length, address) == (ssize_t)length;
+}
+
+bool flash_file_write(
+    void *context, uint32_t address, const void *data, size_t length)
+{
+    const uint8_t *octets = data;
+    uint8_t flash[256];
+    size_t done;
+    size_t len;
+    size_t i;
+
+    (void)context;
+    if (Flash_Power_Off || ((address + length) > Flash_Size)) {
+        return false;
+    }
+    done = flash_file_budget(length);
+    while (length > 0) {
+        len = (length > sizeof(flash)) ? sizeof(flash) : length;
+        if (pread(Flash_File, flash, len, address) != (ssize_t)len) {
+            return false;
+        }
+        for (i = 0; i < len; i++) {
+            if (done > 0) {
+                /* a write only clears bits */
+                flash[i] &= octets[i];
+                done--;
+            } else if (Flash_Power_Off) {
+                /* cut part way through programming this octet */
+                flash[i] &= (uint8_t)(octets[i] | flash_file_random());
+                len = i + 1;
+                break;
+            }
+        }
+        if (pwrite(Flash_File, flash, len, address) != (ssize_t)len) {
+            return false;
+        }
+        if (Flash_Power_Off && (done == 0)) {
+            return false;
+        }
+        octets += len;
+        address += (uint32_t)len;
+        length -= len;
+    }
+
+    return !Flash_Power_Off;
+}
+
+bool flash_file_erase(void *context, uint32_t address, size_t length)
+{
+    uint8_t flash[256];
+    size_t done;
+    size_t len;
+    size_t i;
+    uint32_t sector;
+
+    (void)context;
+    if (Flash_Power_Off || (address % Flash_Sector) ||
+        (length % Flash_Sector) || ((address + length) > Flash_Size)) {
+        return false;
+    }
+    for (sector = address / Flash_Sector;
+         sector < ((address + length) / Flash_Sector); sector++) {
+        Flash_Erases[sector]++;
+    }
+    done = flash_file_budget(length);
+    while (length > 0) {
+        len = (length > sizeof(flash)) ? sizeof(flash) : length;
+        memset(flash, 0xFF, len);
+        if (done < len) {
+            /* cut part way: the rest keeps what it had, but for the octet
+               the erase stopped at */
+            if (pread(Flash_File, flash, len, address) != (ssize_t)len) {
+                return false;
+            }
+            for (i = 0; i < done; i++) {
+                flash[i] = 0xFF;
+            }
+            flash[done] |= flash_file_random();
+            (void)pwrite(Flash_File, flash, len, address);
+            return false;
+        }
+        if (pwrite(Flash_File, flash, len, address) != (ssize_t)len) {
+            return false;
+        }
+        done -= len;
+        address += (uint32_t)len;
+        length -= len;
+    }
+
+    return true;
+}
+
+uint32_t flash_file_erases(uint32_t sector)
+{
+    return (sector < FLASH_FILE_SECTORS_MAX) ? Flash_Erases[sector] : 0;
+}
+
+uint32_t flash_file_octets_read(void)
+{
+    return Flash_Octets_Read;
+}
+
+void flash_file_counters_reset(void)
+{
+    Flash_Octets_Read = 0;
+}
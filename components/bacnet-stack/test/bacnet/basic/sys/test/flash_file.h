@@ -0,0 +1,32 @@
+/**
+ * @file
+ * @brief A file backed stand-in for a flash partition, for host tests of
+ *  the flash log
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef FLASH_FILE_H
+#define FLASH_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+bool flash_file_open(const char *pathname, uint32_t size, uint32_t sector);
+void flash_file_close(bool remove_file);
+const uint8_t *flash_file_mapped(void);
+void flash_file_reset(void);
+void flash_file_power_cut(uint32_t octets);
+bool flash_file_power_off(void);
+
+bool flash_file_read(
+    void *context, uint32_t address, void *data, size_t length);
+bool flash_file_write(
+    void *context, uint32_t address, const void *data, size_t length);
+bool flash_file_erase(void *context, uint32_t address, size_t length);
+
+uint32_t flash_file_erases(uint32_t sector);
+uint32_t flash_file_octets_read(void);
+void flash_file_counters_reset(void);
+
+#endif
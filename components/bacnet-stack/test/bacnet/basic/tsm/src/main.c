@@ -0,0 +1,1050 @@
+/**
+ * @file
+ * @brief test of segmented messages through the TSM: a client and a
+ *  server in one process, joined by a queue of frames, read the object
+ *  list and names of a 500-object device with and without segmented
+ *  replies, with segments and SegmentACKs lost on the way, and with a
+ *  request too long for one APDU.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/bacdcode.h>
+#include <bacnet/rp.h>
+#include <bacnet/rpm.h>
+#include <bacnet/npdu.h>
+#include <bacnet/basic/services.h>
+#include <bacnet/basic/tsm/tsm.h>
+#include <bacnet/basic/object/device.h>
+#include <bacnet/basic/object/av.h>
+#include <bacnet/datalink/datalink.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_OBJECTS 500
+/* the max-APDU of the client, as on MS/TP */
+#define TEST_MAX_APDU 480
+#define TEST_SERVER_MAC 1
+#define TEST_CLIENT_MAC 2
+#define TEST_FRAMES 64
+/* MS/TP at 38400 bps: 10 bits per octet, a frame header and CRC of 10
+   octets, and one token frame of 8 octets and a turnaround of 40 bits for
+   every frame sent */
+#define TEST_MSTP_BAUD 38400.0
+#define TEST_MSTP_FRAME_BITS ((10 + 8) * 10 + 40)
+
+/* the objects save their configuration to NVS on the ESP32 */
+void bacnet_nvs_save_ai_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_ai_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_ai_cov_increment(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_av_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_av_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_av_units(uint32_t instance, uint16_t units)
+{
+    (void)instance;
+    (void)units;
+}
+
+void bacnet_nvs_save_av_pv(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_av_cov_increment(uint32_t instance, float value)
+{
+    (void)instance;
+    (void)value;
+}
+
+void bacnet_nvs_save_bi_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bi_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bo_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bo_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_name(
+    uint32_t instance, const char *name, uint16_t length)
+{
+    (void)instance;
+    (void)name;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_desc(
+    uint32_t instance, const char *desc, uint16_t length)
+{
+    (void)instance;
+    (void)desc;
+    (void)length;
+}
+
+void bacnet_nvs_save_bv_pv(uint32_t instance, uint8_t value)
+{
+    (void)instance;
+    (void)value;
+}
+
+/* the network port objects are not in this build */
+uint32_t Network_Port_Index_To_Instance(unsigned index)
+{
+    (void)index;
+    return BACNET_MAX_INSTANCE;
+}
+
+/* a frame on its way from one node to the other */
+struct test_frame {
+    uint8_t from;
+    uint8_t to;
+    uint16_t pdu_len;
+    uint8_t pdu[MAX_PDU];
+};
+
+static struct test_frame Test_Frames[TEST_FRAMES];
+static unsigned Test_Frame_Head;
+static unsigned Test_Frame_Count;
+
+/* what went over the wire */
+static unsigned Test_Transactions;
+static unsigned Test_Frames_Sent;
+static unsigned long Test_Octets_Sent;
+static unsigned Test_Segments_Sent;
+static unsigned Test_Segment_Acks_Sent;
+static unsigned Test_Aborts_Sent;
+/* the last SegmentACK sent by the server */
+static uint8_t Test_Server_Ack_Sequence;
+static uint8_t Test_Server_Ack_Window;
+
+/* drop the first APDU of this type with this sequence number, once */
+static bool Test_Drop_Armed;
+static uint8_t Test_Drop_Type;
+static uint8_t Test_Drop_Sequence;
+
+/* drop every frame, for transactions that never get a reply */
+static bool Test_Drop_All;
+
+/* what the client received */
+static enum { TEST_NO_REPLY, TEST_ACK, TEST_ABORT } Test_Result;
+static uint8_t Test_Abort_Reason;
+static uint8_t Test_Ack[MAX_SEGMENTED_APDU];
+static uint16_t Test_Ack_Len;
+static unsigned Test_Names_Read;
+
+static char Test_Names[TEST_OBJECTS][24];
+
+void datalink_get_my_address(BACNET_ADDRESS *my_address)
+{
+    bacnet_address_init(my_address, NULL, 0, NULL);
+}
+
+/* queue a frame for one node, from the other one */
+int datalink_send_pdu(
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    struct test_frame *frame;
+    BACNET_NPDU_DATA npdu = { 0 };
+    uint8_t *apdu;
+    int offset;
+
+    (void)npdu_data;
+    offset = npdu_decode(pdu, NULL, NULL, &npdu);
+    zassert_true(offset > 0, NULL);
+    zassert_true(pdu_len <= MAX_PDU, NULL);
+    apdu = &pdu[offset];
+    if ((apdu[0] & 0xF0) == PDU_TYPE_SEGMENT_ACK) {
+        Test_Segment_Acks_Sent++;
+        if (apdu[0] & BIT(0)) {
+            Test_Server_Ack_Sequence = apdu[2];
+            Test_Server_Ack_Window = apdu[3];
+        }
+    } else if ((apdu[0] & 0xF0) == PDU_TYPE_ABORT) {
+        Test_Aborts_Sent++;
+    } else if (apdu[0] & BIT(3)) {
+        Test_Segments_Sent++;
+    }
+    Test_Frames_Sent++;
+    Test_Octets_Sent += pdu_len;
+    if (Test_Drop_All) {
+        return (int)pdu_len;
+    }
+    if (Test_Drop_Armed && ((apdu[0] & 0xF0) == Test_Drop_Type) &&
+        (apdu[2] == Test_Drop_Sequence)) {
+        Test_Drop_Armed = false;
+        return (int)pdu_len;
+    }
+    zassert_true(Test_Frame_Count < TEST_FRAMES, NULL);
+    frame = &Test_Frames[(Test_Frame_Head + Test_Frame_Count) % TEST_FRAMES];
+    frame->to = dest->mac[0];
+    frame->from =
+        (frame->to == TEST_SERVER_MAC) ? TEST_CLIENT_MAC : TEST_SERVER_MAC;
+    frame->pdu_len = (uint16_t)pdu_len;
+    memcpy(frame->pdu, pdu, pdu_len);
+    Test_Frame_Count++;
+
+    return (int)pdu_len;
+}
+
+/* hand each queued frame to the node it is for, until none are left */
+static void test_frames_deliver(void)
+{
+    struct test_frame *frame;
+    BACNET_ADDRESS src = { 0 };
+    BACNET_MAC_ADDRESS mac = { .len = 1, .adr = { 0 } };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    int offset;
+
+    while (Test_Frame_Count) {
+        frame = &Test_Frames[Test_Frame_Head];
+        Test_Frame_Head = (Test_Frame_Head + 1) % TEST_FRAMES;
+        Test_Frame_Count--;
+        mac.adr[0] = frame->from;
+        bacnet_address_init(&src, &mac, 0, NULL);
+        offset = npdu_decode(frame->pdu, NULL, NULL, &npdu_data);
+        apdu_handler(
+            &src, &frame->pdu[offset], (uint16_t)(frame->pdu_len - offset));
+    }
+}
+
+static void test_server_address(BACNET_ADDRESS *dest)
+{
+    BACNET_MAC_ADDRESS mac = { .len = 1, .adr = { TEST_SERVER_MAC } };
+
+    bacnet_address_init(dest, &mac, 0, NULL);
+}
+
+/* the client: keep the service data of a complex ACK */
+static void test_complex_ack_handler(
+    uint8_t *service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS *src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA *service_data)
+{
+    (void)src;
+    (void)service_data;
+    zassert_true(service_len <= sizeof(Test_Ack), NULL);
+    memcpy(Test_Ack, service_request, service_len);
+    Test_Ack_Len = service_len;
+    Test_Result = TEST_ACK;
+}
+
+static void test_abort_handler(
+    BACNET_ADDRESS *src, uint8_t invoke_id, uint8_t abort_reason, bool server)
+{
+    (void)src;
+    (void)invoke_id;
+    (void)server;
+    Test_Abort_Reason = abort_reason;
+    Test_Result = TEST_ABORT;
+}
+
+/* count the object names of a ReadPropertyMultiple-ACK */
+static void test_rpm_ack_process(
+    uint32_t device_id, BACNET_READ_PROPERTY_DATA *rp_data)
+{
+    (void)device_id;
+    if ((rp_data->object_property == PROP_OBJECT_NAME) &&
+        (rp_data->application_data_len > 0)) {
+        Test_Names_Read++;
+    }
+}
+
+/**
+ * @brief Start a confirmed request from the client, with or without the
+ *  segmented-response-accepted bit, without handling any frames
+ * @param apdu - the request, its invoke ID is filled in
+ * @return the invoke ID
+ */
+static uint8_t
+test_request_start(uint8_t *apdu, uint16_t apdu_len, bool segmented)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS my_address = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t pdu[MAX_PDU];
+    uint8_t invoke_id;
+    int pdu_len;
+
+    invoke_id = tsm_next_free_invokeID();
+    zassert_true(invoke_id != 0, NULL);
+    apdu[1] = encode_max_segs_max_apdu(segmented ? 64 : 0, TEST_MAX_APDU);
+    if (segmented) {
+        apdu[0] |= BIT(1);
+    }
+    apdu[2] = invoke_id;
+    test_server_address(&dest);
+    datalink_get_my_address(&my_address);
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(pdu, &dest, &my_address, &npdu_data);
+    memcpy(&pdu[pdu_len], apdu, apdu_len);
+    tsm_set_confirmed_unsegmented_transaction(
+        invoke_id, &dest, &npdu_data, apdu, apdu_len);
+    Test_Result = TEST_NO_REPLY;
+    Test_Ack_Len = 0;
+    Test_Transactions++;
+    datalink_send_pdu(&dest, &npdu_data, pdu, (unsigned)(pdu_len + apdu_len));
+
+    return invoke_id;
+}
+
+/* send a confirmed request and handle every frame that follows */
+static void test_request(uint8_t *apdu, uint16_t apdu_len, bool segmented)
+{
+    (void)test_request_start(apdu, apdu_len, segmented);
+    test_frames_deliver();
+}
+
+/* ReadProperty of the object list of the device */
+static uint16_t
+test_object_list_request_encode(uint8_t *apdu, BACNET_ARRAY_INDEX index)
+{
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+
+    rpdata.object_type = OBJECT_DEVICE;
+    rpdata.object_instance = Device_Object_Instance_Number();
+    rpdata.object_property = PROP_OBJECT_LIST;
+    rpdata.array_index = index;
+
+    return (uint16_t)rp_encode_apdu(apdu, 0, &rpdata);
+}
+
+/**
+ * @brief Decode the object list of a ReadProperty-ACK
+ * @return the number of objects in it
+ */
+static unsigned test_object_list_decode(
+    BACNET_OBJECT_TYPE *object_type, uint32_t *object_instance, unsigned size)
+{
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    BACNET_OBJECT_TYPE type;
+    uint32_t instance;
+    unsigned count = 0;
+    int offset = 0;
+    int len;
+
+    len = rp_ack_decode_service_request(Test_Ack, Test_Ack_Len, &rpdata);
+    zassert_true(len > 0, NULL);
+    while (offset < rpdata.application_data_len) {
+        len = bacnet_object_id_application_decode(
+            &rpdata.application_data[offset],
+            rpdata.application_data_len - offset, &type, &instance);
+        zassert_true(len > 0, NULL);
+        if (count < size) {
+            object_type[count] = type;
+            object_instance[count] = instance;
+        }
+        count++;
+        offset += len;
+    }
+
+    return count;
+}
+
+/* ReadPropertyMultiple of the names of some objects */
+static uint16_t test_names_request_encode(
+    uint8_t *apdu,
+    const BACNET_OBJECT_TYPE *object_type,
+    const uint32_t *object_instance,
+    unsigned count)
+{
+    int len;
+    unsigned i;
+
+    len = rpm_encode_apdu_init(apdu, 0);
+    for (i = 0; i < count; i++) {
+        len += rpm_encode_apdu_object_begin(
+            &apdu[len], object_type[i], object_instance[i]);
+        len += rpm_encode_apdu_object_property(
+            &apdu[len], PROP_OBJECT_NAME, BACNET_ARRAY_ALL);
+        len += rpm_encode_apdu_object_end(&apdu[len]);
+    }
+
+    return (uint16_t)len;
+}
+
+static void test_device_objects_create(void)
+{
+    uint32_t instance;
+
+    Device_Init(NULL);
+    for (instance = 1; instance <= TEST_OBJECTS; instance++) {
+        Analog_Value_Create(instance);
+        snprintf(
+            Test_Names[instance - 1], sizeof(Test_Names[0]),
+            "Zone %03u Temperature", (unsigned)instance);
+        Analog_Value_Name_Set(instance, Test_Names[instance - 1]);
+    }
+    apdu_set_confirmed_handler(
+        SERVICE_CONFIRMED_READ_PROPERTY, handler_read_property);
+    apdu_set_confirmed_handler(
+        SERVICE_CONFIRMED_READ_PROP_MULTIPLE, handler_read_property_multiple);
+    apdu_set_confirmed_ack_handler(
+        SERVICE_CONFIRMED_READ_PROPERTY, test_complex_ack_handler);
+    apdu_set_confirmed_ack_handler(
+        SERVICE_CONFIRMED_READ_PROP_MULTIPLE, test_complex_ack_handler);
+    apdu_set_abort_handler(test_abort_handler);
+    Test_Frame_Head = 0;
+    Test_Frame_Count = 0;
+    Test_Drop_Armed = false;
+}
+
+static void test_counters_reset(void)
+{
+    Test_Transactions = 0;
+    Test_Frames_Sent = 0;
+    Test_Octets_Sent = 0;
+    Test_Segments_Sent = 0;
+    Test_Segment_Acks_Sent = 0;
+    Test_Aborts_Sent = 0;
+    Test_Names_Read = 0;
+}
+
+
+/**
+ * @brief Read the object list, then the names of all objects, the way a
+ *  workstation discovers a device: the whole list, or one element at a
+ *  time if the reply is aborted; and as many names per request as fit in
+ *  one APDU, halved while the reply is aborted.
+ * @return the number of objects in the list
+ */
+static unsigned test_discovery(bool segmented)
+{
+    static BACNET_OBJECT_TYPE object_type[TEST_OBJECTS + 8];
+    static uint32_t object_instance[TEST_OBJECTS + 8];
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    BACNET_UNSIGNED_INTEGER list_size = 0;
+    uint8_t apdu[MAX_APDU];
+    uint16_t apdu_len;
+    unsigned count, index, chunk, n;
+    int len;
+
+    apdu_len = test_object_list_request_encode(apdu, BACNET_ARRAY_ALL);
+    test_request(apdu, apdu_len, segmented);
+    if (Test_Result == TEST_ACK) {
+        count = test_object_list_decode(
+            object_type, object_instance, TEST_OBJECTS + 8);
+    } else {
+        zassert_equal(Test_Result, TEST_ABORT, NULL);
+        zassert_equal(
+            Test_Abort_Reason, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, NULL);
+        apdu_len = test_object_list_request_encode(apdu, 0);
+        test_request(apdu, apdu_len, segmented);
+        zassert_equal(Test_Result, TEST_ACK, NULL);
+        len = rp_ack_decode_service_request(Test_Ack, Test_Ack_Len, &rpdata);
+        zassert_true(len > 0, NULL);
+        len = bacnet_unsigned_application_decode(
+            rpdata.application_data, rpdata.application_data_len, &list_size);
+        zassert_true(len > 0, NULL);
+        count = (unsigned)list_size;
+        zassert_true(count <= TEST_OBJECTS + 8, NULL);
+        for (index = 1; index <= count; index++) {
+            apdu_len = test_object_list_request_encode(apdu, index);
+            test_request(apdu, apdu_len, segmented);
+            zassert_equal(Test_Result, TEST_ACK, NULL);
+            n = test_object_list_decode(
+                &object_type[index - 1], &object_instance[index - 1], 1);
+            zassert_equal(n, 1, NULL);
+        }
+    }
+    /* the most names that fit in one request */
+    chunk = (TEST_MAX_APDU - 4) / 9;
+    index = 0;
+    while (index < count) {
+        n = chunk;
+        if (n > (count - index)) {
+            n = count - index;
+        }
+        apdu_len = test_names_request_encode(
+            apdu, &object_type[index], &object_instance[index], n);
+        zassert_true(apdu_len <= TEST_MAX_APDU, NULL);
+        test_request(apdu, apdu_len, segmented);
+        if (Test_Result == TEST_ABORT) {
+            zassert_true(chunk > 1, NULL);
+            chunk /= 2;
+            continue;
+        }
+        zassert_equal(Test_Result, TEST_ACK, NULL);
+        rpm_ack_object_property_process(
+            Test_Ack, Test_Ack_Len, 0, &rpdata, test_rpm_ack_process);
+        index += n;
+    }
+
+    return count;
+}
+
+/**
+ * @brief The object list of 500 objects is read in one segmented reply,
+ *  and is aborted for a client that does not accept segments
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(tsm_tests, test_tsm_segmented_object_list)
+#else
+static void test_tsm_segmented_object_list(void)
+#endif
+{
+    static BACNET_OBJECT_TYPE object_type[TEST_OBJECTS + 8];
+    static uint32_t object_instance[TEST_OBJECTS + 8];
+    uint8_t apdu[MAX_APDU];
+    uint16_t apdu_len;
+    unsigned count;
+
+    test_device_objects_create();
+    test_counters_reset();
+    apdu_len = test_object_list_request_encode(apdu, BACNET_ARRAY_ALL);
+    test_request(apdu, apdu_len, false);
+    zassert_equal(Test_Result, TEST_ABORT, NULL);
+    zassert_equal(
+        Test_Abort_Reason, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, NULL);
+    zassert_equal(Test_Segments_Sent, 0, NULL);
+    test_request(apdu, apdu_len, true);
+    zassert_equal(Test_Result, TEST_ACK, NULL);
+    count = test_object_list_decode(
+        object_type, object_instance, TEST_OBJECTS + 8);
+    zassert_equal(count, Device_Object_List_Count(), NULL);
+    zassert_equal(count, TEST_OBJECTS + 1, NULL);
+    zassert_equal(object_type[0], OBJECT_DEVICE, NULL);
+    zassert_equal(object_type[count - 1], OBJECT_ANALOG_VALUE, NULL);
+    zassert_equal(object_instance[count - 1], TEST_OBJECTS, NULL);
+    /* 5 octets for each object in segments of 475 octets */
+    zassert_equal(Test_Segments_Sent, 6, NULL);
+    zassert_equal(Test_Aborts_Sent, 1, NULL);
+    zassert_equal(tsm_segmented_idle_count(), MAX_SEGMENTED_TRANSACTIONS, NULL);
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+}
+
+/**
+ * @brief A lost segment is asked for again with a negative SegmentACK,
+ *  and a lost SegmentACK is recovered by the segment timer of the server
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(tsm_tests, test_tsm_segmented_lost)
+#else
+static void test_tsm_segmented_lost(void)
+#endif
+{
+    static uint8_t expected[MAX_SEGMENTED_APDU];
+    uint16_t expected_len;
+    uint8_t apdu[MAX_APDU];
+    uint16_t apdu_len;
+    uint8_t invoke_id;
+    unsigned segments;
+
+    test_device_objects_create();
+    test_counters_reset();
+    apdu_len = test_object_list_request_encode(apdu, BACNET_ARRAY_ALL);
+    test_request(apdu, apdu_len, true);
+    zassert_equal(Test_Result, TEST_ACK, NULL);
+    memcpy(expected, Test_Ack, Test_Ack_Len);
+    expected_len = Test_Ack_Len;
+    segments = Test_Segments_Sent;
+    /* the third segment is lost: the window is sent again from there */
+    test_counters_reset();
+    Test_Drop_Type = PDU_TYPE_COMPLEX_ACK;
+    Test_Drop_Sequence = 2;
+    Test_Drop_Armed = true;
+    test_request(apdu, apdu_len, true);
+    zassert_false(Test_Drop_Armed, NULL);
+    zassert_equal(Test_Result, TEST_ACK, NULL);
+    zassert_equal(Test_Ack_Len, expected_len, NULL);
+    zassert_mem_equal(Test_Ack, expected, expected_len, NULL);
+    zassert_equal(Test_Segments_Sent, segments + 4, NULL);
+    zassert_equal(tsm_segmented_idle_count(), MAX_SEGMENTED_TRANSACTIONS, NULL);
+    /* the SegmentACK of the first segment is lost */
+    test_counters_reset();
+    Test_Drop_Type = PDU_TYPE_SEGMENT_ACK;
+    Test_Drop_Sequence = 0;
+    Test_Drop_Armed = true;
+    test_request(apdu, apdu_len, true);
+    zassert_false(Test_Drop_Armed, NULL);
+    zassert_equal(Test_Result, TEST_NO_REPLY, NULL);
+    zassert_equal(Test_Segments_Sent, 1, NULL);
+    tsm_timer_milliseconds(apdu_segment_timeout() - 1);
+    test_frames_deliver();
+    zassert_equal(Test_Segments_Sent, 1, NULL);
+    tsm_timer_milliseconds(1);
+    test_frames_deliver();
+    zassert_equal(Test_Result, TEST_ACK, NULL);
+    zassert_equal(Test_Ack_Len, expected_len, NULL);
+    zassert_mem_equal(Test_Ack, expected, expected_len, NULL);
+    zassert_equal(Test_Segments_Sent, segments + 1, NULL);
+    zassert_equal(tsm_segmented_idle_count(), MAX_SEGMENTED_TRANSACTIONS, NULL);
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+    /* the segments stop coming: the server and the client give up */
+    test_counters_reset();
+    Test_Drop_Type = PDU_TYPE_SEGMENT_ACK;
+    Test_Drop_Sequence = 0;
+    Test_Drop_Armed = true;
+    invoke_id = test_request_start(apdu, apdu_len, true);
+    test_frames_deliver();
+    zassert_equal(
+        tsm_segmented_idle_count(), MAX_SEGMENTED_TRANSACTIONS - 2, NULL);
+    for (segments = 0; segments <= apdu_retries(); segments++) {
+        /* every segment sent again is lost */
+        Test_Drop_Type = PDU_TYPE_COMPLEX_ACK;
+        Test_Drop_Armed = true;
+        tsm_timer_milliseconds(apdu_segment_timeout());
+        test_frames_deliver();
+    }
+    zassert_equal(Test_Result, TEST_NO_REPLY, NULL);
+    zassert_equal(tsm_segmented_idle_count(), MAX_SEGMENTED_TRANSACTIONS, NULL);
+    zassert_true(tsm_invoke_id_failed(invoke_id), NULL);
+    tsm_free_invoke_id(invoke_id);
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+}
+
+/**
+ * @brief A ReadPropertyMultiple request too long for one APDU is sent in
+ *  segments, acknowledged a window at a time, and answered once whole
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(tsm_tests, test_tsm_segmented_request)
+#else
+static void test_tsm_segmented_request(void)
+#endif
+{
+    static BACNET_OBJECT_TYPE object_type[100];
+    static uint32_t object_instance[100];
+    static uint8_t request[MAX_SEGMENTED_APDU];
+    const uint16_t segment_len = 250;
+    const uint8_t window_size = 2;
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS my_address = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t pdu[MAX_PDU];
+    uint8_t invoke_id;
+    uint16_t request_len, offset, len;
+    uint8_t sequence_number = 0;
+    int pdu_len;
+    unsigned i;
+
+    test_device_objects_create();
+    test_counters_reset();
+    for (i = 0; i < 100; i++) {
+        object_type[i] = OBJECT_ANALOG_VALUE;
+        object_instance[i] = i + 1;
+    }
+    /* the service data of the request, after its 4 octet header */
+    request_len =
+        test_names_request_encode(request, object_type, object_instance, 100);
+    zassert_true(request_len > 3 * segment_len, NULL);
+    invoke_id = tsm_next_free_invokeID();
+    test_server_address(&dest);
+    datalink_get_my_address(&my_address);
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    Test_Result = TEST_NO_REPLY;
+    for (offset = 4; offset < request_len; offset += len) {
+        len = request_len - offset;
+        if (len > segment_len) {
+            len = segment_len;
+        }
+        pdu_len = npdu_encode_pdu(pdu, &dest, &my_address, &npdu_data);
+        pdu[pdu_len] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST | BIT(3) | BIT(1);
+        if ((offset + len) < request_len) {
+            pdu[pdu_len] |= BIT(2);
+        }
+        pdu[pdu_len + 1] = encode_max_segs_max_apdu(64, TEST_MAX_APDU);
+        pdu[pdu_len + 2] = invoke_id;
+        pdu[pdu_len + 3] = sequence_number;
+        pdu[pdu_len + 4] = window_size;
+        pdu[pdu_len + 5] = SERVICE_CONFIRMED_READ_PROP_MULTIPLE;
+        memcpy(&pdu[pdu_len + 6], &request[offset], len);
+        if (sequence_number == 0) {
+            tsm_set_confirmed_unsegmented_transaction(
+                invoke_id, &dest, &npdu_data, &pdu[pdu_len], len + 6);
+        }
+        datalink_send_pdu(
+            &dest, &npdu_data, pdu, (unsigned)(pdu_len + 6 + len));
+        test_frames_deliver();
+        if ((sequence_number == 0) || (sequence_number == 2)) {
+            /* the first segment, and the last of the window after it */
+            zassert_equal(Test_Server_Ack_Sequence, sequence_number, NULL);
+            zassert_equal(Test_Server_Ack_Window, window_size, NULL);
+        }
+        sequence_number++;
+    }
+    zassert_equal(sequence_number, 4, NULL);
+    /* 0, 2 and the last segment were acknowledged */
+    zassert_equal(Test_Server_Ack_Sequence, 3, NULL);
+    zassert_equal(Test_Result, TEST_ACK, NULL);
+    zassert_true(Test_Ack_Len > TEST_MAX_APDU, NULL);
+    rpm_ack_object_property_process(
+        Test_Ack, Test_Ack_Len, 0, &rpdata, test_rpm_ack_process);
+    zassert_equal(Test_Names_Read, 100, NULL);
+    zassert_equal(tsm_segmented_idle_count(), MAX_SEGMENTED_TRANSACTIONS, NULL);
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+}
+
+/**
+ * @brief Discovery of a device of 500 objects by a client that does not
+ *  accept segmented replies and by one that does: transactions, frames
+ *  and octets, the time they take on MS/TP at 38400 bps, and CPU time
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(tsm_tests, test_tsm_segmented_discovery_benchmark)
+#else
+static void test_tsm_segmented_discovery_benchmark(void)
+#endif
+{
+    static const char *modes[] = { "unsegmented", "segmented" };
+    unsigned transactions[2];
+    struct timespec ts;
+    uint64_t start, cpu_ns;
+    double wire_s;
+    unsigned mode, count;
+
+    test_device_objects_create();
+    for (mode = 0; mode < 2; mode++) {
+        test_counters_reset();
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        start = ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+        count = test_discovery(mode == 1);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        cpu_ns = ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec -
+            start;
+        zassert_equal(count, TEST_OBJECTS + 1, NULL);
+        zassert_equal(Test_Names_Read, count, NULL);
+        zassert_equal(
+            tsm_segmented_idle_count(), MAX_SEGMENTED_TRANSACTIONS, NULL);
+        transactions[mode] = Test_Transactions;
+        wire_s = ((double)Test_Octets_Sent * 10.0 +
+                  (double)Test_Frames_Sent * TEST_MSTP_FRAME_BITS) /
+            TEST_MSTP_BAUD;
+        printf(
+            "Discovery of %u objects, %-11s: %4u transactions, %5u frames "
+            "(%u segments, %u SegmentACKs, %u aborts), %6lu octets, "
+            "%5.1f s on MS/TP, %5.1f ms CPU\n",
+            count, modes[mode], Test_Transactions, Test_Frames_Sent,
+            Test_Segments_Sent, Test_Segment_Acks_Sent, Test_Aborts_Sent,
+            Test_Octets_Sent, wire_s, (double)cpu_ns / 1000000.0);
+    }
+    zassert_true(transactions[1] * 10 < transactions[0], NULL);
+}
+
+/* invoke IDs of the transactions that timed out */
+static unsigned Test_Timeouts;
+static uint8_t Test_Timeout_Invoke_ID;
+
+static void test_timeout_handler(uint8_t invoke_id)
+{
+    Test_Timeouts++;
+    Test_Timeout_Invoke_ID = invoke_id;
+}
+
+/**
+ * @brief Start a confirmed request that gets no reply, as a client does:
+ *  the transaction holds the whole PDU, to send it again on a retry
+ * @return the invoke ID, or 0 if no transaction was free
+ */
+static uint8_t test_request_outstanding(void)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS my_address = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    BACNET_READ_PROPERTY_DATA data = { 0 };
+    uint8_t pdu[MAX_PDU];
+    uint8_t invoke_id;
+    int pdu_len;
+
+    invoke_id = tsm_next_free_invokeID();
+    if (invoke_id == 0) {
+        return 0;
+    }
+    test_server_address(&dest);
+    datalink_get_my_address(&my_address);
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(pdu, &dest, &my_address, &npdu_data);
+    data.object_type = OBJECT_DEVICE;
+    data.object_instance = Device_Object_Instance_Number();
+    data.object_property = PROP_OBJECT_NAME;
+    data.array_index = BACNET_ARRAY_ALL;
+    pdu_len += rp_encode_apdu(&pdu[pdu_len], invoke_id, &data);
+    tsm_set_confirmed_unsegmented_transaction(
+        invoke_id, &dest, &npdu_data, pdu, (uint16_t)pdu_len);
+    datalink_send_pdu(&dest, &npdu_data, pdu, (unsigned)pdu_len);
+
+    return invoke_id;
+}
+
+/* advance the request timers in steps of no more than step milliseconds */
+static void test_timer_advance(unsigned milliseconds, uint16_t step)
+{
+    uint16_t elapsed;
+
+    while (milliseconds) {
+        elapsed = (milliseconds < step) ? (uint16_t)milliseconds : step;
+        tsm_timer_milliseconds(elapsed);
+        milliseconds -= elapsed;
+    }
+}
+
+/**
+ * @brief The table of transactions: every invoke ID of a full table is
+ *  unique, a freed one is reused, and the request timers retry and time
+ *  out exactly on time, for short and long APDU timeouts and for any
+ *  step of the timer
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(tsm_tests, test_tsm_invoke_id_table)
+#else
+static void test_tsm_invoke_id_table(void)
+#endif
+{
+    static const uint16_t timeouts[] = { 1, 63, 64, 3000, 4096, 10000,
+                                         60000 };
+    static const uint16_t steps[] = { 1, 7, 100, 65535 };
+    bool used[256] = { false };
+    uint8_t invoke_id[MAX_TSM_TRANSACTIONS];
+    unsigned i, t, s, retry;
+    uint16_t timeout;
+    uint8_t id;
+
+    test_device_objects_create();
+    test_counters_reset();
+    tsm_set_timeout_handler(test_timeout_handler);
+    Test_Drop_All = true;
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        invoke_id[i] = tsm_next_free_invokeID();
+        zassert_true(invoke_id[i] != 0, NULL);
+        zassert_false(used[invoke_id[i]], NULL);
+        used[invoke_id[i]] = true;
+    }
+    zassert_false(tsm_transaction_available(), NULL);
+    zassert_equal(tsm_transaction_idle_count(), 0, NULL);
+    zassert_equal(tsm_next_free_invokeID(), 0, NULL);
+    /* a freed invoke ID is the only one there is to take */
+    id = invoke_id[MAX_TSM_TRANSACTIONS / 2];
+    tsm_free_invoke_id(id);
+    zassert_true(tsm_invoke_id_free(id), NULL);
+    zassert_true(tsm_transaction_available(), NULL);
+    zassert_equal(tsm_next_free_invokeID(), id, NULL);
+    zassert_false(tsm_invoke_id_free(id), NULL);
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        tsm_free_invoke_id(invoke_id[i]);
+    }
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+    /* the invoke IDs go around, skipping zero */
+    tsm_invokeID_set(255);
+    id = tsm_next_free_invokeID();
+    zassert_equal(id, 255, NULL);
+    tsm_free_invoke_id(id);
+    id = tsm_next_free_invokeID();
+    zassert_equal(id, 1, NULL);
+    tsm_free_invoke_id(id);
+    /* the request timers */
+    for (t = 0; t < ARRAY_SIZE(timeouts); t++) {
+        timeout = timeouts[t];
+        apdu_timeout_set(timeout);
+        for (s = 0; s < ARRAY_SIZE(steps); s++) {
+            Test_Timeouts = 0;
+            Test_Frames_Sent = 0;
+            /* start the request part way into a slot */
+            tsm_timer_milliseconds(1 + t + s);
+            id = test_request_outstanding();
+            zassert_true(id != 0, NULL);
+            zassert_equal(Test_Frames_Sent, 1, NULL);
+            for (retry = 0; retry <= apdu_retries(); retry++) {
+                test_timer_advance(timeout - 1U, steps[s]);
+                zassert_equal(Test_Frames_Sent, 1 + retry, NULL);
+                zassert_equal(Test_Timeouts, 0, NULL);
+                tsm_timer_milliseconds(1);
+            }
+            zassert_equal(Test_Frames_Sent, 1 + apdu_retries(), NULL);
+            zassert_equal(Test_Timeouts, 1, NULL);
+            zassert_equal(Test_Timeout_Invoke_ID, id, NULL);
+            zassert_true(tsm_invoke_id_failed(id), NULL);
+            /* the failed transaction holds its spot until it is freed */
+            zassert_equal(
+                tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS - 1, NULL);
+            tsm_free_invoke_id(id);
+            zassert_equal(
+                tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+        }
+    }
+    /* a freed transaction does not time out */
+    apdu_timeout_set(3000);
+    Test_Timeouts = 0;
+    id = test_request_outstanding();
+    tsm_free_invoke_id(id);
+    test_timer_advance(60000, 1000);
+    zassert_equal(Test_Timeouts, 0, NULL);
+    Test_Drop_All = false;
+    tsm_set_timeout_handler(NULL);
+}
+
+/* time in nanoseconds */
+static uint64_t test_nanoseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief A client with 255 confirmed requests outstanding: the CPU time
+ *  to start one, for each millisecond of the request timers, to look one
+ *  up, and to free one; and each millisecond with one request outstanding
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(tsm_tests, test_tsm_invoke_id_benchmark)
+#else
+static void test_tsm_invoke_id_benchmark(void)
+#endif
+{
+    const unsigned rounds = 100;
+    const unsigned milliseconds = 2000;
+    uint8_t invoke_id[MAX_TSM_TRANSACTIONS];
+    uint64_t start, start_ns = 0, lookup_ns = 0, free_ns = 0;
+    uint64_t timer_ns = 0, timer_one_ns = 0;
+    unsigned lookups = 0;
+    unsigned r, i;
+    uint8_t id;
+
+    test_device_objects_create();
+    Test_Drop_All = true;
+    apdu_timeout_set(3000);
+    for (r = 0; r < rounds; r++) {
+        start = test_nanoseconds();
+        for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+            invoke_id[i] = test_request_outstanding();
+        }
+        start_ns += test_nanoseconds() - start;
+        zassert_equal(tsm_transaction_idle_count(), 0, NULL);
+        /* less than the APDU timeout: none of them retries */
+        Test_Frames_Sent = 0;
+        start = test_nanoseconds();
+        for (i = 0; i < milliseconds; i++) {
+            tsm_timer_milliseconds(1);
+        }
+        timer_ns += test_nanoseconds() - start;
+        zassert_equal(Test_Frames_Sent, 0, NULL);
+        /* a COV task checks each of its subscriptions */
+        start = test_nanoseconds();
+        for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+            if (!tsm_invoke_id_free(invoke_id[i]) &&
+                !tsm_invoke_id_failed(invoke_id[i])) {
+                lookups++;
+            }
+        }
+        lookup_ns += test_nanoseconds() - start;
+        start = test_nanoseconds();
+        for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+            tsm_free_invoke_id(invoke_id[i]);
+        }
+        free_ns += test_nanoseconds() - start;
+        zassert_equal(
+            tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+        /* and with one outstanding */
+        id = test_request_outstanding();
+        start = test_nanoseconds();
+        for (i = 0; i < milliseconds; i++) {
+            tsm_timer_milliseconds(1);
+        }
+        timer_one_ns += test_nanoseconds() - start;
+        tsm_free_invoke_id(id);
+    }
+    zassert_equal(lookups, rounds * MAX_TSM_TRANSACTIONS, NULL);
+    printf(
+        "TSM of %u transactions, all outstanding: start %.1f ns, "
+        "lookup %.1f ns, free %.1f ns, timer %.1f ns/ms; "
+        "one outstanding: timer %.1f ns/ms\n",
+        MAX_TSM_TRANSACTIONS,
+        (double)start_ns / (rounds * MAX_TSM_TRANSACTIONS),
+        (double)lookup_ns / (rounds * MAX_TSM_TRANSACTIONS * 2),
+        (double)free_ns / (rounds * MAX_TSM_TRANSACTIONS),
+        (double)timer_ns / (rounds * milliseconds),
+        (double)timer_one_ns / (rounds * milliseconds));
+    Test_Drop_All = false;
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(tsm_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        tsm_tests, ztest_unit_test(test_tsm_segmented_object_list),
+        ztest_unit_test(test_tsm_segmented_lost),
+        ztest_unit_test(test_tsm_segmented_request),
+        ztest_unit_test(test_tsm_segmented_discovery_benchmark),
+        ztest_unit_test(test_tsm_invoke_id_table),
+        ztest_unit_test(test_tsm_invoke_id_benchmark));
+
+    ztest_run_test_suite(tsm_tests);
+}
+#endif
@@ -265,6 +265,40 @@ static void testCCOVNotifyData(uint8_t invoke_id, const BACNET_COV_DATA *data)
     testCOVNotifyData(data, &test_data);
 }
 
+/* the list-of-values encoded once gives the same notifications */
+static void
+testCOVNotifyValuesData(uint8_t invoke_id, const BACNET_COV_DATA *data)
+{
+    uint8_t values[64] = { 0 };
+    uint8_t apdu[480] = { 0 };
+    uint8_t test_apdu[480] = { 0 };
+    int values_len = 0, len = 0, test_len = 0;
+
+    values_len =
+        cov_notify_values_encode(values, sizeof(values), data->listOfValues);
+    zassert_true(values_len > 0, NULL);
+    zassert_equal(
+        cov_notify_values_encode(values, values_len - 1, data->listOfValues),
+        0, NULL);
+    len = ucov_notify_encode_apdu(&apdu[0], sizeof(apdu), data);
+    test_len = cov_notify_values_apdu_encode(
+        &test_apdu[0], sizeof(test_apdu), false, 0, data, values,
+        (size_t)values_len);
+    zassert_equal(len, test_len, NULL);
+    zassert_mem_equal(apdu, test_apdu, len, NULL);
+    zassert_equal(
+        cov_notify_values_apdu_encode(
+            &test_apdu[0], len - 1, false, 0, data, values,
+            (size_t)values_len),
+        0, NULL);
+    len = ccov_notify_encode_apdu(&apdu[0], sizeof(apdu), invoke_id, data);
+    test_len = cov_notify_values_apdu_encode(
+        &test_apdu[0], sizeof(test_apdu), true, invoke_id, data, values,
+        (size_t)values_len);
+    zassert_equal(len, test_len, NULL);
+    zassert_mem_equal(apdu, test_apdu, len, NULL);
+}
+
 #if defined(CONFIG_ZTEST_NEW_API)
 ZTEST(cov_tests, testCOVNotify)
 #else
@@ -297,6 +331,7 @@ static void testCOVNotify(void)
 
     testUCOVNotifyData(&data);
     testCCOVNotifyData(invoke_id, &data);
+    testCOVNotifyValuesData(invoke_id, &data);
 }
 
 static void testCOVSubscribeData(
@@ -0,0 +1,358 @@
+/**
+ * @file
+ * @brief test and benchmark of the batched BACnet/IP receive and transmit:
+ *  packets per second and socket calls per packet at batch sizes 1, 8
+ *  and 32 on the loopback interface, and the COV style transmit batch.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef _GNU_SOURCE
+/* recvmmsg() and sendmmsg() */
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/npdu.h>
+#include <bacnet/datalink/bip.h>
+#include <bacnet/datalink/biptask.h>
+#include <bacnet/datalink/bvlc.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_BIP_PORT 47810
+/* datagrams in flight at once: what a BBMD fan-out delivers in a burst */
+#define TEST_BURST 64
+#define TEST_ROUNDS 500
+#define TEST_BATCH_MAX 32
+/* a small unconfirmed NPDU, the size of a COV notification */
+#define TEST_NPDU_LEN 40
+
+/* socket calls made on the B/IP socket, counted by the linker wraps */
+static unsigned long Test_Socket_Calls;
+static int Test_Client_Socket = -1;
+static struct sockaddr_in Test_Server_Address;
+static BACNET_IP_ADDRESS Test_Client_Address;
+
+int __real_recvfrom(int fd, void *buf, size_t len, int flags,
+    struct sockaddr *addr, socklen_t *addr_len);
+int __real_recvmmsg(int fd, struct mmsghdr *msg, unsigned int vlen, int flags,
+    struct timespec *timeout);
+ssize_t __real_sendto(int fd, const void *buf, size_t len, int flags,
+    const struct sockaddr *addr, socklen_t addr_len);
+int __real_sendmmsg(
+    int fd, struct mmsghdr *msg, unsigned int vlen, int flags);
+
+static void test_socket_call(int fd)
+{
+    if ((fd == bip_get_socket()) || (fd == bip_get_broadcast_socket())) {
+        Test_Socket_Calls++;
+    }
+}
+
+int __wrap_recvfrom(int fd, void *buf, size_t len, int flags,
+    struct sockaddr *addr, socklen_t *addr_len)
+{
+    test_socket_call(fd);
+    return __real_recvfrom(fd, buf, len, flags, addr, addr_len);
+}
+
+int __wrap_recvmmsg(int fd, struct mmsghdr *msg, unsigned int vlen, int flags,
+    struct timespec *timeout)
+{
+    test_socket_call(fd);
+    return __real_recvmmsg(fd, msg, vlen, flags, timeout);
+}
+
+ssize_t __wrap_sendto(int fd, const void *buf, size_t len, int flags,
+    const struct sockaddr *addr, socklen_t addr_len)
+{
+    test_socket_call(fd);
+    return __real_sendto(fd, buf, len, flags, addr, addr_len);
+}
+
+int __wrap_sendmmsg(int fd, struct mmsghdr *msg, unsigned int vlen, int flags)
+{
+    test_socket_call(fd);
+    return __real_sendmmsg(fd, msg, vlen, flags);
+}
+
+static void test_npdu_handler(
+    BACNET_ADDRESS *src, uint8_t *npdu, uint16_t npdu_len, void *context)
+{
+    unsigned *count = context;
+
+    (void)src;
+    (void)npdu;
+    if (npdu_len == TEST_NPDU_LEN) {
+        (*count)++;
+    }
+}
+
+static bool test_init(void)
+{
+    struct sockaddr_in sin = { 0 };
+    socklen_t sin_len = sizeof(sin);
+
+    bip_set_port(TEST_BIP_PORT);
+    if (!bip_init("lo")) {
+        return false;
+    }
+    Test_Client_Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (Test_Client_Socket < 0) {
+        bip_cleanup();
+        return false;
+    }
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((bind(Test_Client_Socket, (struct sockaddr *)&sin, sizeof(sin)) <
+         0) ||
+        (getsockname(Test_Client_Socket, (struct sockaddr *)&sin, &sin_len) <
+         0)) {
+        close(Test_Client_Socket);
+        bip_cleanup();
+        return false;
+    }
+    memcpy(&Test_Client_Address.address[0], &sin.sin_addr.s_addr, 4);
+    Test_Client_Address.port = ntohs(sin.sin_port);
+    memset(&Test_Server_Address, 0, sizeof(Test_Server_Address));
+    Test_Server_Address.sin_family = AF_INET;
+    Test_Server_Address.sin_port = htons(TEST_BIP_PORT);
+    Test_Server_Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    return true;
+}
+
+static void test_cleanup(void)
+{
+    close(Test_Client_Socket);
+    Test_Client_Socket = -1;
+    bip_cleanup();
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec now = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+/* the datagrams a BBMD forwards: Forwarded-NPDU from another subnet */
+static int test_forwarded_npdu_encode(uint8_t *mtu, uint16_t mtu_size)
+{
+    BACNET_IP_ADDRESS origin = { { 192, 168, 1, 20 }, 0xBAC0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t npdu[TEST_NPDU_LEN] = { 0 };
+    int len;
+
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    len = npdu_encode_pdu(npdu, NULL, NULL, &npdu_data);
+    npdu[len] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+    npdu[len + 1] = SERVICE_UNCONFIRMED_COV_NOTIFICATION;
+
+    return bvlc_encode_forwarded_npdu(
+        mtu, mtu_size, &origin, npdu, sizeof(npdu));
+}
+
+/* receive from the client socket until it is empty */
+static unsigned test_client_drain(void)
+{
+    uint8_t mtu[BIP_MPDU_MAX];
+    unsigned count = 0;
+
+    while (recv(Test_Client_Socket, mtu, sizeof(mtu), MSG_DONTWAIT) > 0) {
+        count++;
+    }
+
+    return count;
+}
+
+static void test_report(
+    const char *label, unsigned batch, unsigned packets, uint64_t elapsed_ns)
+{
+    printf(
+        "  %s batch %2u: %9.0f packets/s  %5.3f socket calls/packet\n", label,
+        batch, (double)packets * 1e9 / (double)elapsed_ns,
+        (double)Test_Socket_Calls / (double)packets);
+}
+
+/**
+ * @brief Forwarded-NPDU bursts drained with batches of 1, 8 and 32
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(bip_batch_tests, test_bip_batch_receive)
+#else
+static void test_bip_batch_receive(void)
+#endif
+{
+    static uint8_t buffer[TEST_BATCH_MAX][BIP_MPDU_MAX];
+    const unsigned batch_sizes[] = { 1, 8, 32 };
+    BIP_MPDU batch[TEST_BATCH_MAX] = { 0 };
+    uint8_t mtu[BIP_MPDU_MAX];
+    uint64_t elapsed_ns, start_ns;
+    unsigned handled, size, round, i, b;
+    int mtu_len;
+
+    if (!test_init()) {
+        printf("bip-batch: no loopback interface, skipped\n");
+        return;
+    }
+    for (i = 0; i < TEST_BATCH_MAX; i++) {
+        batch[i].mtu = buffer[i];
+        batch[i].mtu_size = sizeof(buffer[i]);
+    }
+    mtu_len = test_forwarded_npdu_encode(mtu, sizeof(mtu));
+    zassert_true(mtu_len > 0, NULL);
+    printf(
+        "bip-batch: receive %u bursts of %u Forwarded-NPDU\n", TEST_ROUNDS,
+        TEST_BURST);
+    for (b = 0; b < ARRAY_SIZE(batch_sizes); b++) {
+        size = batch_sizes[b];
+        handled = 0;
+        elapsed_ns = 0;
+        Test_Socket_Calls = 0;
+        for (round = 0; round < TEST_ROUNDS; round++) {
+            for (i = 0; i < TEST_BURST; i++) {
+                sendto(
+                    Test_Client_Socket, mtu, mtu_len, 0,
+                    (struct sockaddr *)&Test_Server_Address,
+                    sizeof(Test_Server_Address));
+            }
+            start_ns = test_clock_ns();
+            bip_receive_batch_drain(batch, size, test_npdu_handler, &handled);
+            elapsed_ns += test_clock_ns() - start_ns;
+        }
+        zassert_equal(handled, TEST_ROUNDS * TEST_BURST, NULL);
+        test_report("receive", size, handled, elapsed_ns);
+    }
+    test_cleanup();
+}
+
+/**
+ * @brief COV sized datagrams sent with batches of 1, 8 and 32
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(bip_batch_tests, test_bip_batch_send)
+#else
+static void test_bip_batch_send(void)
+#endif
+{
+    const unsigned batch_sizes[] = { 1, 8, 32 };
+    BIP_MPDU batch[TEST_BATCH_MAX] = { 0 };
+    uint8_t mtu[BIP_MPDU_MAX];
+    uint64_t elapsed_ns, start_ns;
+    unsigned received, size, round, sent, b, i;
+    int mtu_len;
+
+    if (!test_init()) {
+        printf("bip-batch: no loopback interface, skipped\n");
+        return;
+    }
+    mtu_len = test_forwarded_npdu_encode(mtu, sizeof(mtu));
+    zassert_true(mtu_len > 0, NULL);
+    for (i = 0; i < TEST_BATCH_MAX; i++) {
+        batch[i].addr = Test_Client_Address;
+        batch[i].mtu = mtu;
+        batch[i].mtu_len = (uint16_t)mtu_len;
+    }
+    printf(
+        "bip-batch: send %u bursts of %u datagrams\n", TEST_ROUNDS,
+        TEST_BURST);
+    for (b = 0; b < ARRAY_SIZE(batch_sizes); b++) {
+        size = batch_sizes[b];
+        received = 0;
+        elapsed_ns = 0;
+        Test_Socket_Calls = 0;
+        for (round = 0; round < TEST_ROUNDS; round++) {
+            start_ns = test_clock_ns();
+            for (sent = 0; sent < TEST_BURST; sent += size) {
+                zassert_equal(
+                    bip_send_mpdu_batch(batch, size), (int)size, NULL);
+            }
+            elapsed_ns += test_clock_ns() - start_ns;
+            received += test_client_drain();
+        }
+        zassert_equal(received, TEST_ROUNDS * TEST_BURST, NULL);
+        test_report("send   ", size, received, elapsed_ns);
+    }
+    test_cleanup();
+}
+
+/**
+ * @brief MPDUs sent between bip_send_batch_begin() and
+ *  bip_send_batch_flush() go out in one submit, as the COV task sends
+ *  the notifications to every subscriber of a changed object
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(bip_batch_tests, test_bip_send_batch_coalesce)
+#else
+static void test_bip_send_batch_coalesce(void)
+#endif
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t pdu[TEST_NPDU_LEN] = { 0 };
+    const unsigned subscribers = 10;
+    unsigned i;
+
+    if (!test_init()) {
+        printf("bip-batch: no loopback interface, skipped\n");
+        return;
+    }
+    bvlc_ip_address_to_bacnet_local(&dest, &Test_Client_Address);
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    Test_Socket_Calls = 0;
+    bip_send_batch_begin();
+    for (i = 0; i < subscribers; i++) {
+        zassert_true(
+            bip_send_pdu(&dest, &npdu_data, pdu, sizeof(pdu)) > 0, NULL);
+    }
+    zassert_equal(Test_Socket_Calls, 0, NULL);
+    zassert_equal(bip_send_batch_flush(), (int)subscribers, NULL);
+    zassert_equal(Test_Socket_Calls, 1, NULL);
+    zassert_equal(test_client_drain(), subscribers, NULL);
+    /* after the flush, each PDU is sent when it is given */
+    zassert_true(bip_send_pdu(&dest, &npdu_data, pdu, sizeof(pdu)) > 0, NULL);
+    zassert_equal(Test_Socket_Calls, 2, NULL);
+    zassert_equal(test_client_drain(), 1, NULL);
+    /* a full batch is submitted and the next one started */
+    Test_Socket_Calls = 0;
+    bip_send_batch_begin();
+    for (i = 0; i < BIP_SEND_BATCH_MAX + 1; i++) {
+        bip_send_pdu(&dest, &npdu_data, pdu, sizeof(pdu));
+    }
+    zassert_equal(Test_Socket_Calls, 1, NULL);
+    zassert_equal(bip_send_batch_flush(), 1, NULL);
+    zassert_equal(Test_Socket_Calls, 2, NULL);
+    zassert_equal(test_client_drain(), BIP_SEND_BATCH_MAX + 1, NULL);
+    test_cleanup();
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(bip_batch_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        bip_batch_tests, ztest_unit_test(test_bip_batch_receive),
+        ztest_unit_test(test_bip_batch_send),
+        ztest_unit_test(test_bip_send_batch_coalesce));
+
+    ztest_run_test_suite(bip_batch_tests);
+}
+#endif
@@ -0,0 +1,409 @@
+/**
+ * @file
+ * @brief test and benchmark of the blocking BACnet/IP receive task:
+ *  ReadProperty round-trip latency (p50/p99) from a readprop-style client
+ *  on the loopback interface, with the task blocking on the socket and
+ *  with the old 100 ms receive timeout plus 10 ms sleep.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/bacdcode.h>
+#include <bacnet/npdu.h>
+#include <bacnet/rp.h>
+#include <bacnet/basic/services.h>
+#include <bacnet/basic/object/device.h>
+#include <bacnet/basic/tsm/tsm.h>
+#include <bacnet/datalink/bip.h>
+#include <bacnet/datalink/biptask.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_DEVICE_INSTANCE 260001
+#define TEST_BIP_PORT 47809
+#define TEST_BURST 16
+#define TEST_REPLY_TIMEOUT_MS 1000
+/* the receive loop this replaces: bip_receive(..., 100), then 10 ms */
+#define TEST_LEGACY_TIMEOUT_MS 100
+#define TEST_LEGACY_SLEEP_US 10000
+
+uint8_t Handler_Transmit_Buffer[MAX_PDU];
+
+static volatile bool Test_Legacy_Stop;
+static int Test_Client_Socket = -1;
+static struct sockaddr_in Test_Server_Address;
+
+/* simulated device: the properties readprop reads from a device */
+uint32_t Device_Object_Instance_Number(void)
+{
+    return TEST_DEVICE_INSTANCE;
+}
+
+uint32_t Network_Port_Index_To_Instance(unsigned find_index)
+{
+    return find_index;
+}
+
+int Device_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
+{
+    BACNET_CHARACTER_STRING char_string;
+
+    if ((rpdata->object_type != OBJECT_DEVICE) ||
+        (rpdata->object_instance != TEST_DEVICE_INSTANCE)) {
+        rpdata->error_class = ERROR_CLASS_OBJECT;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+        return BACNET_STATUS_ERROR;
+    }
+    if (rpdata->object_property != PROP_OBJECT_NAME) {
+        rpdata->error_class = ERROR_CLASS_PROPERTY;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_PROPERTY;
+        return BACNET_STATUS_ERROR;
+    }
+    characterstring_init_ansi(&char_string, "bip-receive");
+
+    return encode_application_character_string(
+        rpdata->application_data, &char_string);
+}
+
+/* no confirmed requests are sent by the device under test */
+void tsm_free_invoke_id(uint8_t invokeID)
+{
+    (void)invokeID;
+}
+
+/* the work the ESP32 receive task does for each NPDU */
+static void test_npdu_handler(
+    BACNET_ADDRESS *src, uint8_t *npdu, uint16_t npdu_len, void *context)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    unsigned *count = context;
+    int apdu_offset;
+
+    apdu_offset = bacnet_npdu_decode(npdu, npdu_len, &dest, src, &npdu_data);
+    if ((apdu_offset > 0) && (apdu_offset < npdu_len)) {
+        apdu_handler(src, &npdu[apdu_offset], npdu_len - apdu_offset);
+    }
+    if (count) {
+        (*count)++;
+    }
+}
+
+static void *test_receive_task(void *arg)
+{
+    static uint8_t npdu[BIP_MPDU_MAX];
+
+    (void)arg;
+    bip_receive_task(npdu, sizeof(npdu), test_npdu_handler, NULL);
+
+    return NULL;
+}
+
+static void *test_legacy_receive_task(void *arg)
+{
+    static uint8_t npdu[BIP_MPDU_MAX];
+    BACNET_ADDRESS src = { 0 };
+    uint16_t npdu_len;
+
+    (void)arg;
+    while (!Test_Legacy_Stop) {
+        memset(&src, 0, sizeof(src));
+        npdu_len =
+            bip_receive(&src, npdu, sizeof(npdu), TEST_LEGACY_TIMEOUT_MS);
+        if (npdu_len > 0) {
+            test_npdu_handler(&src, npdu, npdu_len, NULL);
+        }
+        usleep(TEST_LEGACY_SLEEP_US);
+    }
+
+    return NULL;
+}
+
+static bool test_server_init(void)
+{
+    bip_set_port(TEST_BIP_PORT);
+    if (!bip_init("lo")) {
+        return false;
+    }
+    apdu_set_confirmed_handler(
+        SERVICE_CONFIRMED_READ_PROPERTY, handler_read_property);
+    Test_Client_Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (Test_Client_Socket < 0) {
+        bip_cleanup();
+        return false;
+    }
+    memset(&Test_Server_Address, 0, sizeof(Test_Server_Address));
+    Test_Server_Address.sin_family = AF_INET;
+    Test_Server_Address.sin_port = htons(TEST_BIP_PORT);
+    Test_Server_Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    return true;
+}
+
+static void test_server_cleanup(void)
+{
+    close(Test_Client_Socket);
+    Test_Client_Socket = -1;
+    bip_cleanup();
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec now = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+/* the request readprop sends: Object_Name of the device */
+static void test_client_request(uint8_t invoke_id)
+{
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t mtu[BIP_MPDU_MAX];
+    int len = BIP_HEADER_MAX;
+
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    len += npdu_encode_pdu(&mtu[len], NULL, NULL, &npdu_data);
+    rpdata.object_type = OBJECT_DEVICE;
+    rpdata.object_instance = TEST_DEVICE_INSTANCE;
+    rpdata.object_property = PROP_OBJECT_NAME;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    len += rp_encode_apdu(&mtu[len], invoke_id, &rpdata);
+    bvlc_encode_header(
+        mtu, sizeof(mtu), BVLC_ORIGINAL_UNICAST_NPDU, (uint16_t)len);
+    sendto(
+        Test_Client_Socket, mtu, len, 0,
+        (struct sockaddr *)&Test_Server_Address, sizeof(Test_Server_Address));
+}
+
+/* returns the invoke ID of a ReadProperty ack, or -1 on timeout */
+static int test_client_reply(void)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t mtu[BIP_MPDU_MAX];
+    struct timeval timeout = { 0 };
+    fd_set read_fds;
+    int len;
+    int offset;
+
+    for (;;) {
+        FD_ZERO(&read_fds);
+        FD_SET(Test_Client_Socket, &read_fds);
+        timeout.tv_sec = TEST_REPLY_TIMEOUT_MS / 1000;
+        timeout.tv_usec = (TEST_REPLY_TIMEOUT_MS % 1000) * 1000;
+        if (select(Test_Client_Socket + 1, &read_fds, NULL, NULL, &timeout) <=
+            0) {
+            return -1;
+        }
+        len = recv(Test_Client_Socket, mtu, sizeof(mtu), 0);
+        if ((len <= BIP_HEADER_MAX) || (mtu[0] != BVLL_TYPE_BACNET_IP)) {
+            continue;
+        }
+        offset = bacnet_npdu_decode(
+            &mtu[BIP_HEADER_MAX], len - BIP_HEADER_MAX, &dest, &src,
+            &npdu_data);
+        if (offset <= 0) {
+            continue;
+        }
+        offset += BIP_HEADER_MAX;
+        if ((offset + 3 <= len) && (mtu[offset] == PDU_TYPE_COMPLEX_ACK) &&
+            (mtu[offset + 2] == SERVICE_CONFIRMED_READ_PROPERTY)) {
+            return mtu[offset + 1];
+        }
+    }
+}
+
+static int test_compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* sends readprop-style requests, one at a time and in bursts, and
+   prints the p50/p99 round trip; returns the number of replies lost */
+static unsigned test_latency(const char *label, unsigned sequential,
+    unsigned bursts)
+{
+    unsigned count = sequential + (bursts * TEST_BURST);
+    uint64_t *latency = calloc(count, sizeof(uint64_t));
+    uint64_t sent_ns[256] = { 0 };
+    unsigned samples = 0;
+    unsigned lost = 0;
+    unsigned i, b;
+    uint8_t invoke_id = 0;
+    int reply;
+
+    zassert_not_null(latency, NULL);
+    for (i = 0; i < sequential; i++) {
+        invoke_id++;
+        sent_ns[invoke_id] = test_clock_ns();
+        test_client_request(invoke_id);
+        reply = test_client_reply();
+        if (reply == invoke_id) {
+            latency[samples++] = test_clock_ns() - sent_ns[invoke_id];
+        } else {
+            lost++;
+        }
+    }
+    for (b = 0; b < bursts; b++) {
+        for (i = 0; i < TEST_BURST; i++) {
+            invoke_id++;
+            sent_ns[invoke_id] = test_clock_ns();
+            test_client_request(invoke_id);
+        }
+        for (i = 0; i < TEST_BURST; i++) {
+            reply = test_client_reply();
+            if (reply < 0) {
+                lost += TEST_BURST - i;
+                break;
+            }
+            latency[samples++] = test_clock_ns() - sent_ns[reply];
+        }
+    }
+    if (samples) {
+        qsort(latency, samples, sizeof(uint64_t), test_compare_u64);
+        printf(
+            "  %-34s p50 %9.1f us  p99 %9.1f us  (%u RP)\n", label,
+            (double)latency[samples / 2] / 1000.0,
+            (double)latency[(samples * 99) / 100] / 1000.0, samples);
+    }
+    free(latency);
+
+    return lost;
+}
+
+/**
+ * @brief One wakeup drains every datagram queued on the socket
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(bip_receive_tests, test_bip_receive_drain)
+#else
+static void test_bip_receive_drain(void)
+#endif
+{
+    static uint8_t npdu[BIP_MPDU_MAX];
+    unsigned handled = 0;
+    unsigned i;
+
+    if (!test_server_init()) {
+        printf("bip-receive: no loopback interface, skipped\n");
+        return;
+    }
+    zassert_equal(bip_receive_wait(0), 0, NULL);
+    for (i = 0; i < TEST_BURST; i++) {
+        test_client_request((uint8_t)(i + 1));
+    }
+    zassert_true(bip_receive_wait(TEST_REPLY_TIMEOUT_MS) > 0, NULL);
+    zassert_equal(
+        bip_receive_drain(npdu, sizeof(npdu), test_npdu_handler, &handled),
+        TEST_BURST, NULL);
+    zassert_equal(handled, TEST_BURST, NULL);
+    zassert_equal(bip_receive_wait(0), 0, NULL);
+    for (i = 0; i < TEST_BURST; i++) {
+        zassert_equal(test_client_reply(), (int)(i + 1), NULL);
+    }
+    test_server_cleanup();
+}
+
+/**
+ * @brief bip_receive_shutdown() wakes a task blocked on the socket
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(bip_receive_tests, test_bip_receive_shutdown)
+#else
+static void test_bip_receive_shutdown(void)
+#endif
+{
+    pthread_t task;
+    uint64_t start_ns;
+
+    if (!test_server_init()) {
+        printf("bip-receive: no loopback interface, skipped\n");
+        return;
+    }
+    zassert_equal(
+        pthread_create(&task, NULL, test_receive_task, NULL), 0, NULL);
+    test_client_request(1);
+    zassert_equal(test_client_reply(), 1, NULL);
+    start_ns = test_clock_ns();
+    bip_receive_shutdown();
+    pthread_join(task, NULL);
+    zassert_true((test_clock_ns() - start_ns) < 100000000ULL, NULL);
+    zassert_true(bip_receive_wait(0) < 0, NULL);
+    test_server_cleanup();
+}
+
+/**
+ * @brief p50/p99 ReadProperty round trip with the old receive loop and
+ *  with the task blocking on the socket
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(bip_receive_tests, test_bip_receive_latency)
+#else
+static void test_bip_receive_latency(void)
+#endif
+{
+    pthread_t task;
+
+    if (!test_server_init()) {
+        printf("bip-receive: no loopback interface, skipped\n");
+        return;
+    }
+    printf(
+        "bip-receive: ReadProperty round trip on loopback, single and in "
+        "bursts of %u\n",
+        TEST_BURST);
+    Test_Legacy_Stop = false;
+    zassert_equal(
+        pthread_create(&task, NULL, test_legacy_receive_task, NULL), 0, NULL);
+    zassert_equal(
+        test_latency("100 ms timeout + 10 ms sleep:", 50, 4), 0, NULL);
+    Test_Legacy_Stop = true;
+    pthread_join(task, NULL);
+
+    zassert_equal(
+        pthread_create(&task, NULL, test_receive_task, NULL), 0, NULL);
+    zassert_equal(
+        test_latency("blocking, drained per wakeup:", 2000, 100), 0, NULL);
+    bip_receive_shutdown();
+    pthread_join(task, NULL);
+    test_server_cleanup();
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(bip_receive_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        bip_receive_tests, ztest_unit_test(test_bip_receive_drain),
+        ztest_unit_test(test_bip_receive_shutdown),
+        ztest_unit_test(test_bip_receive_latency));
+
+    ztest_run_test_suite(bip_receive_tests);
+}
+#endif
@@ -5,8 +5,13 @@
  * @date 2004
  * @copyright SPDX-License-Identifier: MIT
  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include <zephyr/ztest.h>
 #include <bacnet/datalink/crc.h>
+#include <bacnet/datalink/cobs.h>
+#include <bacnet/datalink/mstpdef.h>
 #include <bacnet/basic/sys/bytes.h>
 
 /**
@@ -128,6 +133,213 @@ static void testCRC16CreateTable(void)
     }
     printf("};\n");
 }
+
+/* an MS/TP frame payload, and a COBS encoded extended frame payload */
+#define CRC_TEST_DATA_SIZE 1497
+static uint8_t CRC_Test_Data[CRC_TEST_DATA_SIZE + 8];
+
+static void crc_test_data_init(void)
+{
+    unsigned i;
+
+    srand(1);
+    for (i = 0; i < sizeof(CRC_Test_Data); i++) {
+        CRC_Test_Data[i] = (uint8_t)rand();
+    }
+}
+
+static uint16_t crc_test_data_octets(const uint8_t *buffer, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        crc = CRC_Calc_Data(buffer[i], crc);
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Test that every block CRC16 calculation matches the octet at a
+ *  time calculation, for any length and alignment
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(crc_tests, testCRC16Block)
+#else
+static void testCRC16Block(void)
+#endif
+{
+    static const unsigned slices[] = { 0, 1, 4, 8 };
+    static const size_t lengths[] = { 0,  1,  2,  3,  4,   5,   7,   8,
+                                      9,  15, 16, 17, 31,  33,  501, 1497 };
+    uint8_t frame[16 + 2];
+    uint16_t crc, expected;
+    size_t i, j, k, offset;
+
+    crc_test_data_init();
+    for (i = 0; i < ARRAY_SIZE(lengths); i++) {
+        for (offset = 0; offset < 8; offset++) {
+            expected =
+                crc_test_data_octets(&CRC_Test_Data[offset], lengths[i]);
+            crc = CRC_Calc_Data_Block(
+                &CRC_Test_Data[offset], lengths[i], 0xFFFF);
+            zassert_equal(crc, expected, NULL);
+            for (j = 0; j < ARRAY_SIZE(slices); j++) {
+                crc = CRC_Calc_Data_Block_Slices(
+                    &CRC_Test_Data[offset], lengths[i], 0xFFFF, slices[j]);
+                zassert_equal(crc, expected, NULL);
+            }
+        }
+    }
+    /* a block can continue the CRC of the octets before it */
+    expected = crc_test_data_octets(CRC_Test_Data, 501);
+    crc = CRC_Calc_Data_Block(CRC_Test_Data, 3, 0xFFFF);
+    crc = CRC_Calc_Data_Block(&CRC_Test_Data[3], 498, crc);
+    zassert_equal(crc, expected, NULL);
+    /* the data with its CRC leaves the residue */
+    for (k = 0; k < 16; k++) {
+        frame[k] = CRC_Test_Data[k];
+    }
+    crc = ~CRC_Calc_Data_Block(frame, 16, 0xFFFF);
+    frame[16] = LO_BYTE(crc);
+    frame[17] = HI_BYTE(crc);
+    zassert_equal(
+        CRC_Calc_Data_Block(frame, sizeof(frame), 0xFFFF), 0xF0B8, NULL);
+    zassert_equal(CRC_Calc_Data_Block(NULL, 10, 0x1234), 0x1234, NULL);
+}
+
+/**
+ * @brief Test that the block CRC32K matches the octet at a time
+ *  calculation, for any length and alignment
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(crc_tests, testCRC32KBlock)
+#else
+static void testCRC32KBlock(void)
+#endif
+{
+    uint32_t crc, expected;
+    size_t length, offset, i;
+
+    crc_test_data_init();
+    for (length = 0; length < 40; length++) {
+        for (offset = 0; offset < 4; offset++) {
+            expected = CRC32K_INITIAL_VALUE;
+            for (i = 0; i < length; i++) {
+                expected = cobs_crc32k(CRC_Test_Data[offset + i], expected);
+            }
+            crc = cobs_crc32k_block(
+                &CRC_Test_Data[offset], length, CRC32K_INITIAL_VALUE);
+            zassert_equal(crc, expected, NULL);
+        }
+    }
+    expected = CRC32K_INITIAL_VALUE;
+    for (i = 0; i < CRC_TEST_DATA_SIZE; i++) {
+        expected = cobs_crc32k(CRC_Test_Data[i], expected);
+    }
+    crc = cobs_crc32k_block(
+        CRC_Test_Data, CRC_TEST_DATA_SIZE, CRC32K_INITIAL_VALUE);
+    zassert_equal(crc, expected, NULL);
+}
+
+static uint64_t crc_test_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Measure the CRC16 throughput of a block calculation
+ * @return nanoseconds per block
+ */
+static double crc_test_block_ns(size_t length, unsigned slices)
+{
+    const unsigned iterations = 20000;
+    volatile uint16_t crc = 0;
+    uint64_t start;
+    unsigned n;
+
+    start = crc_test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        crc ^= CRC_Calc_Data_Block_Slices(
+            CRC_Test_Data, length, 0xFFFF, slices);
+    }
+
+    return (double)(crc_test_clock_ns() - start) / iterations;
+}
+
+/**
+ * @brief Measure the CRC32K throughput, octet at a time or as a block
+ * @return nanoseconds per block
+ */
+static double crc_test_crc32k_ns(size_t length, bool block)
+{
+    const unsigned iterations = 20000;
+    volatile uint32_t crc = 0;
+    uint32_t value;
+    uint64_t start;
+    unsigned n;
+    size_t i;
+
+    start = crc_test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        if (block) {
+            value = cobs_crc32k_block(
+                CRC_Test_Data, length, CRC32K_INITIAL_VALUE);
+        } else {
+            value = CRC32K_INITIAL_VALUE;
+            for (i = 0; i < length; i++) {
+                value = cobs_crc32k(CRC_Test_Data[i], value);
+            }
+        }
+        crc ^= value;
+    }
+
+    return (double)(crc_test_clock_ns() - start) / iterations;
+}
+
+/**
+ * @brief Compare the throughput of the bitwise, byte table and sliced
+ *  calculations on MS/TP and extended frame payloads
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(crc_tests, testCRCBlockBenchmark)
+#else
+static void testCRCBlockBenchmark(void)
+#endif
+{
+    static const size_t lengths[] = { 501, 1497 };
+    static const char *names[] = { "bitwise", "table", "slice-by-4",
+                                   "slice-by-8" };
+    static const unsigned slices[] = { 0, 1, 4, 8 };
+    double ns;
+    size_t i, j;
+
+    crc_test_data_init();
+    for (i = 0; i < ARRAY_SIZE(lengths); i++) {
+        for (j = 0; j < ARRAY_SIZE(slices); j++) {
+            ns = crc_test_block_ns(lengths[i], slices[j]);
+            printf(
+                "CRC16  %4u octets %-10s %8.0f ns %7.1f MB/s\n",
+                (unsigned)lengths[i], names[j], ns,
+                (double)lengths[i] * 1000.0 / ns);
+        }
+        ns = crc_test_crc32k_ns(lengths[i], false);
+        printf(
+            "CRC32K %4u octets %-10s %8.0f ns %7.1f MB/s\n",
+            (unsigned)lengths[i], "bitwise", ns,
+            (double)lengths[i] * 1000.0 / ns);
+        ns = crc_test_crc32k_ns(lengths[i], true);
+        printf(
+            "CRC32K %4u octets %-10s %8.0f ns %7.1f MB/s\n",
+            (unsigned)lengths[i], "block", ns,
+            (double)lengths[i] * 1000.0 / ns);
+    }
+}
 /**
  * @}
  */
@@ -140,7 +352,9 @@ void test_main(void)
     ztest_test_suite(
         crc_tests, ztest_unit_test(testCRC8), ztest_unit_test(testCRC16),
         ztest_unit_test(testCRC8CreateTable),
-        ztest_unit_test(testCRC16CreateTable));
+        ztest_unit_test(testCRC16CreateTable),
+        ztest_unit_test(testCRC16Block), ztest_unit_test(testCRC32KBlock),
+        ztest_unit_test(testCRCBlockBenchmark));
 
     ztest_run_test_suite(crc_tests);
 }
@@ -0,0 +1,791 @@
+/**
+ * @file
+ * @brief test of the datalink ports: replies are routed on the port the
+ *  request came in on, COV notifications and their retries on the port
+ *  the subscription came in on, and a stress run that drives B/IP and MS/TP
+ *  loopback links at once, reporting the aggregate ReadProperty rate
+ *  with one global datalink lock and with a port bound to each task.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/bacdcode.h>
+#include <bacnet/cov.h>
+#include <bacnet/npdu.h>
+#include <bacnet/rp.h>
+#include <bacnet/basic/services.h>
+#include <bacnet/basic/object/device.h>
+#include <bacnet/basic/tsm/tsm.h>
+#include <bacnet/datalink/datalink.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_DEVICE_INSTANCE 260001
+#define TEST_OBJECTS_MAX 64
+#define TEST_QUEUE_SIZE 16
+/* requests each client keeps outstanding */
+#define TEST_WINDOW 8
+#define TEST_REQUESTS 100000UL
+
+/* one direction of a loopback link */
+struct test_queue {
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    unsigned head;
+    unsigned count;
+    bool closed;
+    struct {
+        BACNET_ADDRESS address;
+        uint16_t pdu_len;
+        uint8_t pdu[MAX_PDU];
+    } slot[TEST_QUEUE_SIZE];
+};
+
+/* a loopback link: a client on one side, the datalink driver stand-in
+   on the other */
+struct test_link {
+    char *name;
+    BACNET_ADDRESS client;
+    BACNET_ADDRESS my_address;
+    struct test_queue request;
+    struct test_queue reply;
+    DATALINK_PORT port;
+    unsigned long sent;
+    unsigned long replies;
+    unsigned long errors;
+};
+
+enum { TEST_LINK_BIP, TEST_LINK_MSTP, TEST_LINK_MAX };
+static struct test_link Test_Link[TEST_LINK_MAX];
+static float Test_Object_Value[TEST_OBJECTS_MAX];
+static bool Test_Object_Changed[TEST_OBJECTS_MAX];
+static bool Test_Ports;
+static pthread_mutex_t Test_Datalink_Mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t Test_Object_Lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static void test_queue_init(struct test_queue *queue)
+{
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = false;
+}
+
+static void test_queue_close(struct test_queue *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static int test_queue_push(
+    struct test_queue *queue,
+    const BACNET_ADDRESS *address,
+    const uint8_t *pdu,
+    unsigned pdu_len)
+{
+    unsigned index;
+
+    if (pdu_len > MAX_PDU) {
+        return 0;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    while ((queue->count == TEST_QUEUE_SIZE) && !queue->closed) {
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+    }
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->mutex);
+        return 0;
+    }
+    index = (queue->head + queue->count) % TEST_QUEUE_SIZE;
+    bacnet_address_copy(&queue->slot[index].address, address);
+    memcpy(queue->slot[index].pdu, pdu, pdu_len);
+    queue->slot[index].pdu_len = (uint16_t)pdu_len;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+
+    return (int)pdu_len;
+}
+
+/* blocks until a PDU arrives, or returns 0 once the queue is closed */
+static uint16_t test_queue_pop(
+    struct test_queue *queue,
+    BACNET_ADDRESS *address,
+    uint8_t *pdu,
+    uint16_t max_pdu)
+{
+    uint16_t pdu_len = 0;
+
+    pthread_mutex_lock(&queue->mutex);
+    while ((queue->count == 0) && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    if (queue->count) {
+        pdu_len = queue->slot[queue->head].pdu_len;
+        if (pdu_len <= max_pdu) {
+            bacnet_address_copy(address, &queue->slot[queue->head].address);
+            memcpy(pdu, queue->slot[queue->head].pdu, pdu_len);
+        } else {
+            pdu_len = 0;
+        }
+        queue->head = (queue->head + 1) % TEST_QUEUE_SIZE;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    return pdu_len;
+}
+
+/* driver stand-ins: the datalink layer routes to these by transport */
+static int test_link_send(
+    struct test_link *link, BACNET_ADDRESS *dest, uint8_t *pdu, unsigned len)
+{
+    return test_queue_push(&link->reply, dest, pdu, len);
+}
+
+static uint16_t test_link_receive(
+    struct test_link *link, BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max)
+{
+    return test_queue_pop(&link->request, src, pdu, max);
+}
+
+bool bip_init(char *ifname)
+{
+    (void)ifname;
+    return true;
+}
+
+void bip_cleanup(void)
+{
+}
+
+int bip_send_pdu(
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    (void)npdu_data;
+    return test_link_send(&Test_Link[TEST_LINK_BIP], dest, pdu, pdu_len);
+}
+
+uint16_t bip_receive(
+    BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max_pdu, unsigned timeout)
+{
+    (void)timeout;
+    return test_link_receive(&Test_Link[TEST_LINK_BIP], src, pdu, max_pdu);
+}
+
+void bip_get_broadcast_address(BACNET_ADDRESS *dest)
+{
+    bacnet_address_init(dest, NULL, 0, NULL);
+}
+
+void bip_get_my_address(BACNET_ADDRESS *my_address)
+{
+    bacnet_address_copy(my_address, &Test_Link[TEST_LINK_BIP].my_address);
+}
+
+void bvlc_maintenance_timer(uint16_t seconds)
+{
+    (void)seconds;
+}
+
+bool dlmstp_init(char *ifname)
+{
+    (void)ifname;
+    return true;
+}
+
+void dlmstp_cleanup(void)
+{
+}
+
+int dlmstp_send_pdu(
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    (void)npdu_data;
+    return test_link_send(&Test_Link[TEST_LINK_MSTP], dest, pdu, pdu_len);
+}
+
+uint16_t dlmstp_receive(
+    BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max_pdu, unsigned timeout)
+{
+    (void)timeout;
+    return test_link_receive(&Test_Link[TEST_LINK_MSTP], src, pdu, max_pdu);
+}
+
+void dlmstp_get_broadcast_address(BACNET_ADDRESS *dest)
+{
+    bacnet_address_init(dest, NULL, 0, NULL);
+}
+
+void dlmstp_get_my_address(BACNET_ADDRESS *my_address)
+{
+    bacnet_address_copy(my_address, &Test_Link[TEST_LINK_MSTP].my_address);
+}
+
+/* simulated device: analog values 0..TEST_OBJECTS_MAX-1 */
+uint32_t Device_Object_Instance_Number(void)
+{
+    return TEST_DEVICE_INSTANCE;
+}
+
+uint32_t Network_Port_Index_To_Instance(unsigned find_index)
+{
+    return find_index;
+}
+
+int Device_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
+{
+    if ((rpdata->object_type != OBJECT_ANALOG_VALUE) ||
+        (rpdata->object_instance >= TEST_OBJECTS_MAX)) {
+        rpdata->error_class = ERROR_CLASS_OBJECT;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+        return BACNET_STATUS_ERROR;
+    }
+    if (rpdata->object_property != PROP_PRESENT_VALUE) {
+        rpdata->error_class = ERROR_CLASS_PROPERTY;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_PROPERTY;
+        return BACNET_STATUS_ERROR;
+    }
+
+    return encode_application_real(
+        rpdata->application_data,
+        Test_Object_Value[rpdata->object_instance]);
+}
+
+bool Device_Valid_Object_Id(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    return (object_type == OBJECT_ANALOG_VALUE) &&
+        (object_instance < TEST_OBJECTS_MAX);
+}
+
+bool Device_Value_List_Supported(BACNET_OBJECT_TYPE object_type)
+{
+    return object_type == OBJECT_ANALOG_VALUE;
+}
+
+bool Device_COV(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    if (Device_Valid_Object_Id(object_type, object_instance)) {
+        return Test_Object_Changed[object_instance];
+    }
+
+    return false;
+}
+
+void Device_COV_Clear(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    if (Device_Valid_Object_Id(object_type, object_instance)) {
+        Test_Object_Changed[object_instance] = false;
+    }
+}
+
+bool Device_Encode_Value_List(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_VALUE *value_list)
+{
+    if (Device_Valid_Object_Id(object_type, object_instance)) {
+        return cov_value_list_encode_real(
+            value_list, Test_Object_Value[object_instance], false, false,
+            false, false);
+    }
+
+    return false;
+}
+
+static void test_links_init(void)
+{
+    uint8_t bip_mac[6] = { 192, 168, 1, 10, 0xBA, 0xC0 };
+    uint8_t bip_client_mac[6] = { 192, 168, 1, 20, 0xBA, 0xC0 };
+    uint8_t mstp_mac = 1;
+    uint8_t mstp_client_mac = 2;
+    unsigned i;
+
+    memset(Test_Link, 0, sizeof(Test_Link));
+    Test_Link[TEST_LINK_BIP].name = "bip";
+    Test_Link[TEST_LINK_BIP].my_address.mac_len = 6;
+    memcpy(Test_Link[TEST_LINK_BIP].my_address.mac, bip_mac, 6);
+    Test_Link[TEST_LINK_BIP].client.mac_len = 6;
+    memcpy(Test_Link[TEST_LINK_BIP].client.mac, bip_client_mac, 6);
+    Test_Link[TEST_LINK_MSTP].name = "mstp";
+    Test_Link[TEST_LINK_MSTP].my_address.mac_len = 1;
+    Test_Link[TEST_LINK_MSTP].my_address.mac[0] = mstp_mac;
+    Test_Link[TEST_LINK_MSTP].client.mac_len = 1;
+    Test_Link[TEST_LINK_MSTP].client.mac[0] = mstp_client_mac;
+    for (i = 0; i < TEST_LINK_MAX; i++) {
+        test_queue_init(&Test_Link[i].request);
+        test_queue_init(&Test_Link[i].reply);
+        datalink_port_init(&Test_Link[i].port, Test_Link[i].name);
+    }
+    for (i = 0; i < TEST_OBJECTS_MAX; i++) {
+        Test_Object_Value[i] = (float)i + 0.5f;
+        Test_Object_Changed[i] = false;
+    }
+    apdu_set_confirmed_handler(
+        SERVICE_CONFIRMED_READ_PROPERTY, handler_read_property);
+    apdu_set_confirmed_handler(
+        SERVICE_CONFIRMED_SUBSCRIBE_COV, handler_cov_subscribe);
+}
+
+/* takes the PDUs a link sent to its client, without waiting */
+static unsigned test_link_sent_drain(
+    struct test_link *link, uint8_t *pdu, uint16_t *pdu_len)
+{
+    BACNET_ADDRESS dest = { 0 };
+    unsigned count = 0;
+    uint16_t len;
+
+    while (link->reply.count) {
+        len = test_queue_pop(&link->reply, &dest, pdu, MAX_PDU);
+        if (bacnet_address_same(&dest, &link->client)) {
+            *pdu_len = len;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+/* the APDU type and service of a PDU sent to a client */
+static bool test_pdu_service(
+    uint8_t *pdu, uint16_t pdu_len, uint8_t pdu_type, uint8_t service)
+{
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    int offset;
+
+    offset = bacnet_npdu_decode(pdu, pdu_len, &dest, &src, &npdu_data);
+    if ((offset <= 0) || (offset + 2 >= pdu_len)) {
+        return false;
+    }
+    if (pdu_type == PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST) {
+        return (pdu[offset] == pdu_type) && (pdu[offset + 1] == service);
+    }
+    if (pdu_type == PDU_TYPE_CONFIRMED_SERVICE_REQUEST) {
+        return ((pdu[offset] & 0xF0) == pdu_type) &&
+            (pdu[offset + 3] == service);
+    }
+
+    return (pdu[offset] == pdu_type) && (pdu[offset + 2] == service);
+}
+
+/* a SubscribeCOV from the client of a link, handled by its receive
+   task, which is bound to the port of the link */
+static void test_cov_subscribe(
+    struct test_link *link, uint32_t object_instance, bool confirmed)
+{
+    BACNET_SUBSCRIBE_COV_DATA data = { 0 };
+    uint8_t apdu[MAX_APDU] = { 0 };
+    uint8_t pdu[MAX_PDU] = { 0 };
+    uint16_t pdu_len = 0;
+    int len;
+
+    data.subscriberProcessIdentifier = 1;
+    data.monitoredObjectIdentifier.type = OBJECT_ANALOG_VALUE;
+    data.monitoredObjectIdentifier.instance = object_instance;
+    data.issueConfirmedNotifications = confirmed;
+    data.lifetime = 300;
+    len = cov_subscribe_encode_apdu(apdu, sizeof(apdu), 1, &data);
+    zassert_true(len > 0, NULL);
+    datalink_port_bind(&link->port);
+    apdu_handler(&link->client, apdu, (uint16_t)len);
+    datalink_port_bind(NULL);
+    zassert_equal(test_link_sent_drain(link, pdu, &pdu_len), 1, NULL);
+    zassert_true(
+        test_pdu_service(
+            pdu, pdu_len, PDU_TYPE_SIMPLE_ACK,
+            SERVICE_CONFIRMED_SUBSCRIBE_COV),
+        NULL);
+}
+
+/* the receive task of one link, the way main/main.c runs it */
+static void *test_server_task(void *arg)
+{
+    struct test_link *link = arg;
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t pdu[MAX_PDU];
+    uint16_t pdu_len;
+    int apdu_offset;
+
+    if (Test_Ports) {
+        datalink_port_bind(&link->port);
+    }
+    for (;;) {
+        pdu_len = link->port.receive(&src, pdu, sizeof(pdu), 0);
+        if (pdu_len == 0) {
+            break;
+        }
+        apdu_offset =
+            bacnet_npdu_decode(pdu, pdu_len, &dest, &src, &npdu_data);
+        if ((apdu_offset <= 0) || (apdu_offset >= pdu_len)) {
+            continue;
+        }
+        if (Test_Ports) {
+            pthread_rwlock_rdlock(&Test_Object_Lock);
+            apdu_handler(&src, &pdu[apdu_offset], pdu_len - apdu_offset);
+            pthread_rwlock_unlock(&Test_Object_Lock);
+        } else {
+            /* the single datalink lock this replaces */
+            pthread_mutex_lock(&Test_Datalink_Mutex);
+            datalink_set(link->name);
+            apdu_handler(&src, &pdu[apdu_offset], pdu_len - apdu_offset);
+            datalink_set("bip");
+            pthread_mutex_unlock(&Test_Datalink_Mutex);
+        }
+    }
+
+    return NULL;
+}
+
+static bool test_client_request(struct test_link *link, uint8_t invoke_id)
+{
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t pdu[MAX_PDU];
+    int pdu_len;
+
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(pdu, NULL, NULL, &npdu_data);
+    rpdata.object_type = OBJECT_ANALOG_VALUE;
+    rpdata.object_instance = invoke_id % TEST_OBJECTS_MAX;
+    rpdata.object_property = PROP_PRESENT_VALUE;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    pdu_len += rp_encode_apdu(&pdu[pdu_len], invoke_id, &rpdata);
+    link->sent++;
+
+    return test_queue_push(&link->request, &link->client, pdu, pdu_len) > 0;
+}
+
+/* checks that the reply is an ack to this link's client, in order */
+static bool test_client_reply_valid(
+    struct test_link *link,
+    const BACNET_ADDRESS *dest,
+    uint8_t *pdu,
+    uint16_t pdu_len,
+    uint8_t invoke_id)
+{
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS npdu_dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    float value = 0.0f;
+    int offset;
+    uint8_t *apdu;
+
+    if (!bacnet_address_same(dest, &link->client)) {
+        return false;
+    }
+    offset = bacnet_npdu_decode(pdu, pdu_len, &npdu_dest, &src, &npdu_data);
+    if ((offset <= 0) || (offset + 3 >= pdu_len)) {
+        return false;
+    }
+    apdu = &pdu[offset];
+    if ((apdu[0] != PDU_TYPE_COMPLEX_ACK) || (apdu[1] != invoke_id) ||
+        (apdu[2] != SERVICE_CONFIRMED_READ_PROPERTY)) {
+        return false;
+    }
+    if (rp_ack_decode_service_request(
+            &apdu[3], pdu_len - offset - 3, &rpdata) <= 0) {
+        return false;
+    }
+    if (bacnet_real_application_decode(
+            rpdata.application_data, rpdata.application_data_len, &value) <=
+        0) {
+        return false;
+    }
+
+    return (rpdata.object_instance == invoke_id % TEST_OBJECTS_MAX) &&
+        (memcmp(
+             &value, &Test_Object_Value[rpdata.object_instance],
+             sizeof(value)) == 0);
+}
+
+static void *test_client_task(void *arg)
+{
+    struct test_link *link = arg;
+    BACNET_ADDRESS dest = { 0 };
+    uint8_t pdu[MAX_PDU];
+    uint16_t pdu_len;
+    uint8_t expected_id = 1;
+    uint8_t next_id = 1;
+    unsigned i;
+
+    for (i = 0; i < TEST_WINDOW; i++) {
+        test_client_request(link, next_id++);
+    }
+    while (link->replies < TEST_REQUESTS) {
+        pdu_len = test_queue_pop(&link->reply, &dest, pdu, sizeof(pdu));
+        if (pdu_len == 0) {
+            break;
+        }
+        if (!test_client_reply_valid(link, &dest, pdu, pdu_len, expected_id)) {
+            link->errors++;
+        }
+        expected_id++;
+        link->replies++;
+        if (link->sent < TEST_REQUESTS) {
+            test_client_request(link, next_id++);
+        }
+    }
+
+    return NULL;
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec now = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+/* runs both links at once; returns the aggregate RP/s */
+static double test_stress_run(bool ports)
+{
+    pthread_t server[TEST_LINK_MAX];
+    pthread_t client[TEST_LINK_MAX];
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+    unsigned long replies = 0;
+    unsigned i;
+
+    test_links_init();
+    Test_Ports = ports;
+    datalink_set("bip");
+    start_ns = test_clock_ns();
+    for (i = 0; i < TEST_LINK_MAX; i++) {
+        pthread_create(&server[i], NULL, test_server_task, &Test_Link[i]);
+        pthread_create(&client[i], NULL, test_client_task, &Test_Link[i]);
+    }
+    for (i = 0; i < TEST_LINK_MAX; i++) {
+        pthread_join(client[i], NULL);
+    }
+    elapsed_ns = test_clock_ns() - start_ns;
+    for (i = 0; i < TEST_LINK_MAX; i++) {
+        test_queue_close(&Test_Link[i].request);
+        test_queue_close(&Test_Link[i].reply);
+        pthread_join(server[i], NULL);
+        zassert_equal(Test_Link[i].replies, TEST_REQUESTS, NULL);
+        zassert_equal(Test_Link[i].errors, 0, NULL);
+        replies += Test_Link[i].replies;
+    }
+    if (elapsed_ns == 0) {
+        elapsed_ns = 1;
+    }
+
+    return (double)replies * 1e9 / (double)elapsed_ns;
+}
+
+/**
+ * @brief A port bound to the thread takes the datalink calls, whatever
+ *  transport datalink_set() chose, and owns the transmit buffer
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(datalink_port_tests, test_datalink_port_bind)
+#else
+static void test_datalink_port_bind(void)
+#endif
+{
+    BACNET_ADDRESS address = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    DATALINK_PORT port = { 0 };
+    uint8_t pdu[4] = { 0x01, 0x00, 0x10, 0x08 };
+
+    test_links_init();
+    zassert_true(datalink_port_init(&Test_Link[TEST_LINK_BIP].port, "bip"), NULL);
+    zassert_false(datalink_port_init(&port, "ethernet"), NULL);
+    zassert_false(datalink_port_init(NULL, "bip"), NULL);
+    zassert_is_null(datalink_port_bound(), NULL);
+
+    datalink_set("mstp");
+    datalink_get_my_address(&address);
+    zassert_equal(address.mac_len, 1, NULL);
+    datalink_port_bind(&Test_Link[TEST_LINK_BIP].port);
+    zassert_equal_ptr(datalink_port_bound(), &Test_Link[TEST_LINK_BIP].port, NULL);
+    datalink_get_my_address(&address);
+    zassert_equal(address.mac_len, 6, NULL);
+    zassert_equal(
+        datalink_send_pdu(&address, &npdu_data, pdu, sizeof(pdu)), sizeof(pdu),
+        NULL);
+    zassert_equal(Test_Link[TEST_LINK_BIP].reply.count, 1, NULL);
+    zassert_equal(Test_Link[TEST_LINK_MSTP].reply.count, 0, NULL);
+    zassert_equal_ptr(
+        &Handler_Transmit_Buffer[0],
+        &Test_Link[TEST_LINK_BIP].port.transmit_buffer[0], NULL);
+    zassert_equal(sizeof(Handler_Transmit_Buffer), MAX_PDU, NULL);
+
+    /* an explicit port, whatever the thread is bound to */
+    datalink_port_send_pdu(
+        &Test_Link[TEST_LINK_MSTP].port, &address, &npdu_data, pdu,
+        sizeof(pdu));
+    zassert_equal(Test_Link[TEST_LINK_MSTP].reply.count, 1, NULL);
+
+    /* unbound: back to the transport from datalink_set() */
+    datalink_port_bind(NULL);
+    zassert_not_equal(
+        &Handler_Transmit_Buffer[0],
+        &Test_Link[TEST_LINK_BIP].port.transmit_buffer[0], NULL);
+    datalink_send_pdu(&address, &npdu_data, pdu, sizeof(pdu));
+    zassert_equal(Test_Link[TEST_LINK_MSTP].reply.count, 2, NULL);
+    zassert_equal(Test_Link[TEST_LINK_BIP].reply.count, 1, NULL);
+    datalink_set("bip");
+}
+
+/**
+ * @brief A COV notification goes out on the port the subscription came
+ *  in on, from the COV task that is bound to no port, and not on the
+ *  transport of datalink_set()
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(datalink_port_tests, test_datalink_port_cov)
+#else
+static void test_datalink_port_cov(void)
+#endif
+{
+    struct test_link *mstp = &Test_Link[TEST_LINK_MSTP];
+    struct test_link *bip = &Test_Link[TEST_LINK_BIP];
+    uint8_t pdu[MAX_PDU] = { 0 };
+    uint16_t pdu_len = 0;
+
+    test_links_init();
+    datalink_set("bip");
+    handler_cov_init();
+    test_cov_subscribe(mstp, 3, false);
+    /* the COV task: the initial notification */
+    zassert_is_null(datalink_port_bound(), NULL);
+    handler_cov_task();
+    zassert_equal(test_link_sent_drain(mstp, pdu, &pdu_len), 1, NULL);
+    zassert_true(
+        test_pdu_service(
+            pdu, pdu_len, PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST,
+            SERVICE_UNCONFIRMED_COV_NOTIFICATION),
+        NULL);
+    zassert_equal(bip->reply.count, 0, NULL);
+    /* the object changes */
+    Test_Object_Value[3] = 42.0f;
+    Test_Object_Changed[3] = true;
+    cov_change_detected_notify(OBJECT_ANALOG_VALUE, 3);
+    handler_cov_task();
+    zassert_equal(test_link_sent_drain(mstp, pdu, &pdu_len), 1, NULL);
+    zassert_true(
+        test_pdu_service(
+            pdu, pdu_len, PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST,
+            SERVICE_UNCONFIRMED_COV_NOTIFICATION),
+        NULL);
+    zassert_equal(bip->reply.count, 0, NULL);
+}
+
+/**
+ * @brief A confirmed COV notification that is not acknowledged is sent
+ *  again by the TSM timers of the COV task on the port of the
+ *  subscription, and not on the transport of datalink_set()
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(datalink_port_tests, test_datalink_port_tsm_retry)
+#else
+static void test_datalink_port_tsm_retry(void)
+#endif
+{
+    struct test_link *mstp = &Test_Link[TEST_LINK_MSTP];
+    struct test_link *bip = &Test_Link[TEST_LINK_BIP];
+    uint8_t pdu[MAX_PDU] = { 0 };
+    uint16_t pdu_len = 0;
+    unsigned retry;
+
+    test_links_init();
+    datalink_set("bip");
+    handler_cov_init();
+    test_cov_subscribe(mstp, 4, true);
+    handler_cov_task();
+    zassert_equal(test_link_sent_drain(mstp, pdu, &pdu_len), 1, NULL);
+    zassert_true(
+        test_pdu_service(
+            pdu, pdu_len, PDU_TYPE_CONFIRMED_SERVICE_REQUEST,
+            SERVICE_CONFIRMED_COV_NOTIFICATION),
+        NULL);
+    for (retry = 0; retry < apdu_retries(); retry++) {
+        zassert_is_null(datalink_port_bound(), NULL);
+        tsm_timer_milliseconds(apdu_timeout());
+        zassert_equal(
+            test_link_sent_drain(mstp, pdu, &pdu_len), 1, "retry %u", retry);
+        zassert_true(
+            test_pdu_service(
+                pdu, pdu_len, PDU_TYPE_CONFIRMED_SERVICE_REQUEST,
+                SERVICE_CONFIRMED_COV_NOTIFICATION),
+            NULL);
+        zassert_equal(bip->reply.count, 0, NULL);
+    }
+    /* given up on after the last retry */
+    tsm_timer_milliseconds(apdu_timeout());
+    handler_cov_task();
+    zassert_equal(mstp->reply.count, 0, NULL);
+    zassert_equal(bip->reply.count, 0, NULL);
+}
+
+/**
+ * @brief ReadProperty on B/IP and MS/TP at once: every reply goes back
+ *  to the client on its own link; prints the aggregate RP/s with one
+ *  datalink lock and with a port per receive task
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(datalink_port_tests, test_datalink_port_stress)
+#else
+static void test_datalink_port_stress(void)
+#endif
+{
+    double locked_rate;
+    double ports_rate;
+
+    locked_rate = test_stress_run(false);
+    ports_rate = test_stress_run(true);
+    printf(
+        "datalink ports: %lu RP per link, B/IP + MS/TP at once\n",
+        TEST_REQUESTS);
+    printf("  datalink_set() under one lock: %10.0f RP/s\n", locked_rate);
+    printf("  port bound to each task:       %10.0f RP/s\n", ports_rate);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(datalink_port_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        datalink_port_tests, ztest_unit_test(test_datalink_port_bind),
+        ztest_unit_test(test_datalink_port_cov),
+        ztest_unit_test(test_datalink_port_tsm_retry),
+        ztest_unit_test(test_datalink_port_stress));
+
+    ztest_run_test_suite(datalink_port_tests);
+}
+#endif
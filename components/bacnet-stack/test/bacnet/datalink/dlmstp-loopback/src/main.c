@@ -0,0 +1,437 @@
+/**
+ * @file
+ * @brief test of the MS/TP datalink receive path running the real MS/TP
+ *  state machines over a loopback RS-485 driver: frames lent without a
+ *  copy, the spare input buffer, and the bytes copied per frame.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/bacaddr.h>
+#include <bacnet/datalink/mstp.h>
+#include <bacnet/datalink/dlmstp.h>
+#include <bacnet/basic/sys/mstimer.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_STATION 1
+#define TEST_PEER_STATION 2
+#define TEST_WIRE_SIZE 4096
+
+/* the RS-485 wire: frames from the peer station are looped back into
+   the receiver of this station */
+static uint8_t Test_Wire[TEST_WIRE_SIZE];
+static unsigned Test_Wire_Head;
+static unsigned Test_Wire_Tail;
+static unsigned Test_Wire_Bytes_Read;
+static unsigned Test_Wire_Bytes_Sent;
+/* milliseconds of the test clock, advanced by each poll */
+static uint32_t Test_Milliseconds;
+static uint32_t Test_Silence_Start;
+
+static uint8_t Test_Rx_Buffer[DLMSTP_MPDU_MAX];
+static uint8_t Test_Rx_Spare_Buffer[DLMSTP_MPDU_MAX];
+static uint8_t Test_Tx_Buffer[DLMSTP_MPDU_MAX];
+static struct mstp_port_struct_t Test_MSTP_Port;
+static struct dlmstp_user_data_t Test_MSTP_User;
+
+static void test_rs485_init(void)
+{
+    Test_Wire_Head = 0;
+    Test_Wire_Tail = 0;
+}
+
+static void test_rs485_send(const uint8_t *payload, uint16_t payload_len)
+{
+    (void)payload;
+    Test_Wire_Bytes_Sent += payload_len;
+}
+
+static bool test_rs485_read(uint8_t *buf)
+{
+    if (Test_Wire_Tail == Test_Wire_Head) {
+        return false;
+    }
+    if (buf) {
+        *buf = Test_Wire[Test_Wire_Tail % TEST_WIRE_SIZE];
+        Test_Wire_Tail++;
+        Test_Wire_Bytes_Read++;
+    }
+
+    return true;
+}
+
+static bool test_rs485_transmitting(void)
+{
+    return false;
+}
+
+static uint32_t test_rs485_baud_rate(void)
+{
+    return 38400;
+}
+
+static bool test_rs485_baud_rate_set(uint32_t baud)
+{
+    return baud == 38400;
+}
+
+static uint32_t test_rs485_silence_milliseconds(void)
+{
+    return Test_Milliseconds - Test_Silence_Start;
+}
+
+static void test_rs485_silence_reset(void)
+{
+    Test_Silence_Start = Test_Milliseconds;
+}
+
+static struct dlmstp_rs485_driver Test_RS485_Driver = {
+    .init = test_rs485_init,
+    .send = test_rs485_send,
+    .read = test_rs485_read,
+    .transmitting = test_rs485_transmitting,
+    .baud_rate = test_rs485_baud_rate,
+    .baud_rate_set = test_rs485_baud_rate_set,
+    .silence_milliseconds = test_rs485_silence_milliseconds,
+    .silence_reset = test_rs485_silence_reset
+};
+
+unsigned long mstimer_now(void)
+{
+    return Test_Milliseconds;
+}
+
+/**
+ * @brief Put a data frame from the peer station onto the wire
+ */
+static void test_wire_frame(const uint8_t *pdu, uint16_t pdu_len)
+{
+    uint8_t frame[DLMSTP_MPDU_MAX];
+    uint16_t frame_len, i;
+
+    frame_len = MSTP_Create_Frame(
+        frame, sizeof(frame), FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY,
+        TEST_STATION, TEST_PEER_STATION, pdu, pdu_len);
+    zassert_true(frame_len > 0, NULL);
+    zassert_true(
+        (Test_Wire_Head - Test_Wire_Tail + frame_len) <= TEST_WIRE_SIZE,
+        NULL);
+    for (i = 0; i < frame_len; i++) {
+        Test_Wire[Test_Wire_Head % TEST_WIRE_SIZE] = frame[i];
+        Test_Wire_Head++;
+    }
+}
+
+static void test_datalink_init(bool spare)
+{
+    memset(&Test_MSTP_Port, 0, sizeof(Test_MSTP_Port));
+    memset(&Test_MSTP_User, 0, sizeof(Test_MSTP_User));
+    Test_RS485_Driver.init();
+    Test_MSTP_User.RS485_Driver = &Test_RS485_Driver;
+    if (spare) {
+        Test_MSTP_User.Receive_Buffer_Spare = Test_Rx_Spare_Buffer;
+    }
+    Test_MSTP_Port.UserData = &Test_MSTP_User;
+    Test_MSTP_Port.InputBuffer = Test_Rx_Buffer;
+    Test_MSTP_Port.InputBufferSize = sizeof(Test_Rx_Buffer);
+    Test_MSTP_Port.OutputBuffer = Test_Tx_Buffer;
+    Test_MSTP_Port.OutputBufferSize = sizeof(Test_Tx_Buffer);
+    Test_MSTP_Port.This_Station = TEST_STATION;
+    Test_MSTP_Port.Nmax_info_frames = DEFAULT_MAX_INFO_FRAMES;
+    Test_MSTP_Port.Nmax_master = DEFAULT_MAX_MASTER;
+    zassert_true(dlmstp_init((char *)&Test_MSTP_Port), NULL);
+}
+
+/**
+ * @brief Number of octets of the PDU that were copied out of the
+ *  MS/TP input buffers on the way to the caller
+ */
+static unsigned test_bytes_copied(const uint8_t *pdu, uint16_t pdu_len)
+{
+    if ((pdu >= Test_Rx_Buffer) &&
+        (pdu < &Test_Rx_Buffer[sizeof(Test_Rx_Buffer)])) {
+        return 0;
+    }
+    if ((pdu >= Test_Rx_Spare_Buffer) &&
+        (pdu < &Test_Rx_Spare_Buffer[sizeof(Test_Rx_Spare_Buffer)])) {
+        return 0;
+    }
+
+    return pdu_len;
+}
+
+/**
+ * @brief Poll the datalink the way the receive task does, one
+ *  millisecond apart, until a packet is lent
+ */
+static uint16_t test_receive_lend(BACNET_ADDRESS *src, uint8_t **pdu)
+{
+    uint16_t pdu_len = 0;
+    unsigned polls;
+
+    for (polls = 0; polls < 10; polls++) {
+        Test_Milliseconds++;
+        pdu_len = dlmstp_receive_lend(src, pdu, 0);
+        if (pdu_len > 0) {
+            break;
+        }
+    }
+
+    return pdu_len;
+}
+
+static uint16_t test_receive(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t max)
+{
+    uint16_t pdu_len = 0;
+    unsigned polls;
+
+    for (polls = 0; polls < 10; polls++) {
+        Test_Milliseconds++;
+        pdu_len = dlmstp_receive(src, pdu, max, 0);
+        if (pdu_len > 0) {
+            break;
+        }
+    }
+
+    return pdu_len;
+}
+
+static void test_pdu_fill(uint8_t *pdu, uint16_t pdu_len, uint8_t seed)
+{
+    uint16_t i;
+
+    /* an NPDU without a reply expected */
+    pdu[0] = BACNET_PROTOCOL_VERSION;
+    pdu[1] = 0;
+    for (i = 2; i < pdu_len; i++) {
+        pdu[i] = (uint8_t)(seed + i);
+    }
+}
+
+/**
+ * @brief A lent frame is the MS/TP input buffer, and is not overwritten
+ *  until it is released
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(dlmstp_loopback_tests, test_dlmstp_receive_lend_single)
+#else
+static void test_dlmstp_receive_lend_single(void)
+#endif
+{
+    uint8_t pdu_a[64], pdu_b[64];
+    BACNET_ADDRESS src = { 0 };
+    uint8_t *pdu = NULL;
+    uint16_t pdu_len;
+
+    test_datalink_init(false);
+    test_pdu_fill(pdu_a, sizeof(pdu_a), 0xA0);
+    test_pdu_fill(pdu_b, sizeof(pdu_b), 0xB0);
+    test_wire_frame(pdu_a, sizeof(pdu_a));
+    pdu_len = test_receive_lend(&src, &pdu);
+    zassert_equal(pdu_len, sizeof(pdu_a), NULL);
+    zassert_equal(pdu, Test_Rx_Buffer, NULL);
+    zassert_equal(test_bytes_copied(pdu, pdu_len), 0, NULL);
+    zassert_equal(src.mac_len, 1, NULL);
+    zassert_equal(src.mac[0], TEST_PEER_STATION, NULL);
+    zassert_mem_equal(pdu, pdu_a, sizeof(pdu_a), NULL);
+    /* the next frame waits on the wire while the only buffer is lent */
+    test_wire_frame(pdu_b, sizeof(pdu_b));
+    pdu_len = test_receive_lend(&src, &pdu);
+    zassert_equal(pdu_len, 0, NULL);
+    zassert_true(Test_Wire_Head != Test_Wire_Tail, NULL);
+    zassert_mem_equal(Test_Rx_Buffer, pdu_a, sizeof(pdu_a), NULL);
+    dlmstp_receive_release();
+    pdu_len = test_receive_lend(&src, &pdu);
+    zassert_equal(pdu_len, sizeof(pdu_b), NULL);
+    zassert_equal(pdu, Test_Rx_Buffer, NULL);
+    zassert_mem_equal(pdu, pdu_b, sizeof(pdu_b), NULL);
+    dlmstp_receive_release();
+    /* releasing twice is harmless */
+    dlmstp_receive_release();
+    zassert_equal(Test_MSTP_User.Statistics.receive_pdu_counter, 2, NULL);
+}
+
+/**
+ * @brief With a spare input buffer, the next frame is received while
+ *  the caller holds the previous one, and the buffers alternate
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(dlmstp_loopback_tests, test_dlmstp_receive_lend_double)
+#else
+static void test_dlmstp_receive_lend_double(void)
+#endif
+{
+    uint8_t pdu_a[100], pdu_b[200], pdu_c[50];
+    BACNET_ADDRESS src = { 0 };
+    uint8_t *pdu = NULL;
+    uint16_t pdu_len;
+
+    test_datalink_init(true);
+    test_pdu_fill(pdu_a, sizeof(pdu_a), 0xA0);
+    test_pdu_fill(pdu_b, sizeof(pdu_b), 0xB0);
+    test_pdu_fill(pdu_c, sizeof(pdu_c), 0xC0);
+    test_wire_frame(pdu_a, sizeof(pdu_a));
+    pdu_len = test_receive_lend(&src, &pdu);
+    zassert_equal(pdu_len, sizeof(pdu_a), NULL);
+    zassert_equal(pdu, Test_Rx_Buffer, NULL);
+    zassert_equal(Test_MSTP_Port.InputBuffer, Test_Rx_Spare_Buffer, NULL);
+    /* frame B is received into the spare, but is not lent until A is
+       released */
+    test_wire_frame(pdu_b, sizeof(pdu_b));
+    pdu_len = test_receive_lend(&src, &pdu);
+    zassert_equal(pdu_len, 0, NULL);
+    zassert_equal(Test_Wire_Head, Test_Wire_Tail, NULL);
+    zassert_true(Test_MSTP_User.ReceivePacketPending, NULL);
+    zassert_mem_equal(Test_Rx_Buffer, pdu_a, sizeof(pdu_a), NULL);
+    dlmstp_receive_release();
+    pdu_len = test_receive_lend(&src, &pdu);
+    zassert_equal(pdu_len, sizeof(pdu_b), NULL);
+    zassert_equal(pdu, Test_Rx_Spare_Buffer, NULL);
+    zassert_equal(test_bytes_copied(pdu, pdu_len), 0, NULL);
+    zassert_mem_equal(pdu, pdu_b, sizeof(pdu_b), NULL);
+    zassert_equal(Test_MSTP_Port.InputBuffer, Test_Rx_Buffer, NULL);
+    /* frame C goes into the buffer that held A */
+    test_wire_frame(pdu_c, sizeof(pdu_c));
+    pdu_len = test_receive_lend(&src, &pdu);
+    zassert_equal(pdu_len, 0, NULL);
+    zassert_mem_equal(Test_Rx_Spare_Buffer, pdu_b, sizeof(pdu_b), NULL);
+    dlmstp_receive_release();
+    pdu_len = test_receive_lend(&src, &pdu);
+    zassert_equal(pdu_len, sizeof(pdu_c), NULL);
+    zassert_equal(pdu, Test_Rx_Buffer, NULL);
+    zassert_mem_equal(pdu, pdu_c, sizeof(pdu_c), NULL);
+    dlmstp_receive_release();
+    zassert_equal(Test_MSTP_User.Statistics.receive_pdu_counter, 3, NULL);
+}
+
+/**
+ * @brief The copying receive still copies the PDU and the source, and
+ *  refuses a PDU larger than the buffer of the caller
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(dlmstp_loopback_tests, test_dlmstp_receive_copy)
+#else
+static void test_dlmstp_receive_copy(void)
+#endif
+{
+    uint8_t pdu_a[64], pdu_b[64];
+    uint8_t pdu[MAX_PDU] = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    uint16_t pdu_len;
+
+    test_datalink_init(true);
+    test_pdu_fill(pdu_a, sizeof(pdu_a), 0xA0);
+    test_pdu_fill(pdu_b, sizeof(pdu_b), 0xB0);
+    test_wire_frame(pdu_a, sizeof(pdu_a));
+    pdu_len = test_receive(&src, pdu, sizeof(pdu));
+    zassert_equal(pdu_len, sizeof(pdu_a), NULL);
+    zassert_equal(test_bytes_copied(pdu, pdu_len), sizeof(pdu_a), NULL);
+    zassert_mem_equal(pdu, pdu_a, sizeof(pdu_a), NULL);
+    zassert_equal(src.mac_len, 1, NULL);
+    zassert_equal(src.mac[0], TEST_PEER_STATION, NULL);
+    zassert_is_null(Test_MSTP_User.Receive_Buffer_Lent, NULL);
+    /* too large for the caller: dropped, and the buffer is returned */
+    test_wire_frame(pdu_b, sizeof(pdu_b));
+    pdu_len = test_receive(&src, pdu, sizeof(pdu_b) - 1);
+    zassert_equal(pdu_len, 0, NULL);
+    zassert_is_null(Test_MSTP_User.Receive_Buffer_Lent, NULL);
+    test_wire_frame(pdu_a, sizeof(pdu_a));
+    pdu_len = test_receive(&src, pdu, sizeof(pdu));
+    zassert_equal(pdu_len, sizeof(pdu_a), NULL);
+    zassert_mem_equal(pdu, pdu_a, sizeof(pdu_a), NULL);
+}
+
+static uint64_t test_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Receive frames of one size through the lending receive and
+ *  through the copying receive, and count the bytes copied per frame
+ */
+static void test_dlmstp_receive_frames(uint16_t frame_pdu_len)
+{
+    uint8_t frame_pdu[MAX_PDU];
+    uint8_t pdu[MAX_PDU];
+    uint8_t *lent_pdu = NULL;
+    BACNET_ADDRESS src = { 0 };
+    const unsigned iterations = 5000;
+    unsigned n, lend_copied = 0, copy_copied = 0;
+    uint64_t start, lend_ns, copy_ns;
+    uint16_t pdu_len;
+
+    test_pdu_fill(frame_pdu, frame_pdu_len, 0x5A);
+    test_datalink_init(true);
+    Test_Wire_Bytes_Read = 0;
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        test_wire_frame(frame_pdu, frame_pdu_len);
+        pdu_len = test_receive_lend(&src, &lent_pdu);
+        zassert_equal(pdu_len, frame_pdu_len, NULL);
+        lend_copied += test_bytes_copied(lent_pdu, pdu_len);
+        dlmstp_receive_release();
+    }
+    lend_ns = test_clock_ns() - start;
+    zassert_equal(
+        Test_Wire_Bytes_Read, iterations * (frame_pdu_len + 10U), NULL);
+    test_datalink_init(true);
+    start = test_clock_ns();
+    for (n = 0; n < iterations; n++) {
+        test_wire_frame(frame_pdu, frame_pdu_len);
+        pdu_len = test_receive(&src, pdu, sizeof(pdu));
+        zassert_equal(pdu_len, frame_pdu_len, NULL);
+        copy_copied += test_bytes_copied(pdu, pdu_len);
+    }
+    copy_ns = test_clock_ns() - start;
+    zassert_equal(lend_copied, 0, NULL);
+    zassert_equal(copy_copied, iterations * frame_pdu_len, NULL);
+    printf(
+        "MS/TP frame PDU %4u octets: lend %3u bytes copied/frame "
+        "%6.0f ns/frame, copy %4u bytes copied/frame %6.0f ns/frame\n",
+        (unsigned)frame_pdu_len, lend_copied / iterations,
+        (double)lend_ns / iterations, copy_copied / iterations,
+        (double)copy_ns / iterations);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(dlmstp_loopback_tests, test_dlmstp_receive_benchmark)
+#else
+static void test_dlmstp_receive_benchmark(void)
+#endif
+{
+    test_dlmstp_receive_frames(50);
+    test_dlmstp_receive_frames(480);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(dlmstp_loopback_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        dlmstp_loopback_tests,
+        ztest_unit_test(test_dlmstp_receive_lend_single),
+        ztest_unit_test(test_dlmstp_receive_lend_double),
+        ztest_unit_test(test_dlmstp_receive_copy),
+        ztest_unit_test(test_dlmstp_receive_benchmark));
+
+    ztest_run_test_suite(dlmstp_loopback_tests);
+}
+#endif
@@ -0,0 +1,343 @@
+/**
+ * @file
+ * @brief test of the MS/TP datalink on the event driven RS-485 driver
+ *  of the Linux port, with a pseudo-terminal for the RS-485 line, and
+ *  of the ring of received bursts that the driver fills.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/datalink/crc.h>
+#include <bacnet/datalink/mstp.h>
+#include <bacnet/datalink/mstpburst.h>
+#include <bacnet/datalink/dlmstp.h>
+#include <bacnet/basic/sys/mstimer.h>
+#include "rs485-tty.h"
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_STATION 1
+#define TEST_PEER_STATION 2
+
+static uint8_t Test_Rx_Buffer[DLMSTP_MPDU_MAX];
+static uint8_t Test_Rx_Spare_Buffer[DLMSTP_MPDU_MAX];
+static uint8_t Test_Tx_Buffer[DLMSTP_MPDU_MAX];
+static struct mstp_port_struct_t Test_MSTP_Port;
+static struct dlmstp_user_data_t Test_MSTP_User;
+static struct dlmstp_rs485_driver Test_RS485_Driver = {
+    .init = RS485_TTY_Init,
+    .send = RS485_TTY_Send,
+    .read = RS485_TTY_Read,
+    .transmitting = RS485_TTY_Transmitting,
+    .baud_rate = RS485_TTY_Baud_Rate,
+    .baud_rate_set = RS485_TTY_Baud_Rate_Set,
+    .silence_milliseconds = RS485_TTY_Silence_Milliseconds,
+    .silence_reset = RS485_TTY_Silence_Reset,
+    .wait = RS485_TTY_Wait,
+    .silence_microseconds = RS485_TTY_Silence_Microseconds
+};
+/* the other end of the RS-485 line */
+static int Test_Pty = -1;
+
+static uint64_t test_clock_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000ULL) + (ts.tv_nsec / 1000000);
+}
+
+unsigned long mstimer_now(void)
+{
+    return (unsigned long)test_clock_ms();
+}
+
+/**
+ * @brief Bursts are read back in order, with the time they arrived
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(dlmstp_pty_tests, test_mstp_burst)
+#else
+static void test_mstp_burst(void)
+#endif
+{
+    static MSTP_BURST_BUFFER bursts;
+    uint8_t data[MSTP_BURST_SIZE * MSTP_BURST_COUNT + 10];
+    uint8_t *burst_data;
+    uint8_t octet = 0;
+    uint32_t timestamp = 0;
+    unsigned i, count;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+    MSTP_Burst_Init(&bursts);
+    zassert_true(MSTP_Burst_Empty(&bursts), NULL);
+    zassert_false(MSTP_Burst_Read(&bursts, NULL, NULL), NULL);
+    /* a burst written in place */
+    burst_data = MSTP_Burst_Write_Buffer(&bursts);
+    zassert_not_null(burst_data, NULL);
+    burst_data[0] = 0x55;
+    burst_data[1] = 0xFF;
+    zassert_false(MSTP_Burst_Write_Commit(&bursts, 0, 100), NULL);
+    zassert_true(MSTP_Burst_Write_Commit(&bursts, 2, 100), NULL);
+    /* a burst larger than one burst is split */
+    count = MSTP_Burst_Write(&bursts, data, MSTP_BURST_SIZE + 3, 200);
+    zassert_equal(count, MSTP_BURST_SIZE + 3, NULL);
+    zassert_true(MSTP_Burst_Read(&bursts, NULL, NULL), NULL);
+    zassert_true(MSTP_Burst_Read(&bursts, &octet, &timestamp), NULL);
+    zassert_equal(octet, 0x55, NULL);
+    zassert_equal(timestamp, 100, NULL);
+    zassert_true(MSTP_Burst_Read(&bursts, &octet, &timestamp), NULL);
+    zassert_equal(octet, 0xFF, NULL);
+    for (i = 0; i < MSTP_BURST_SIZE + 3; i++) {
+        zassert_true(MSTP_Burst_Read(&bursts, &octet, &timestamp), NULL);
+        zassert_equal(octet, data[i], NULL);
+        zassert_equal(timestamp, 200, NULL);
+    }
+    zassert_true(MSTP_Burst_Empty(&bursts), NULL);
+    /* more than the ring holds */
+    count = MSTP_Burst_Write(&bursts, data, sizeof(data), 300);
+    zassert_equal(count, MSTP_BURST_SIZE * MSTP_BURST_COUNT, NULL);
+    zassert_equal(MSTP_Burst_Overruns(&bursts), 1, NULL);
+    zassert_is_null(MSTP_Burst_Write_Buffer(&bursts), NULL);
+    zassert_true(MSTP_Burst_Read(&bursts, &octet, NULL), NULL);
+    MSTP_Burst_Flush(&bursts);
+    zassert_true(MSTP_Burst_Empty(&bursts), NULL);
+    zassert_not_null(MSTP_Burst_Write_Buffer(&bursts), NULL);
+}
+
+static void test_datalink_init(void)
+{
+    char name[64] = "";
+
+    if (Test_Pty < 0) {
+        Test_Pty = RS485_TTY_Pty_Open(name, sizeof(name));
+        zassert_true(Test_Pty >= 0, NULL);
+        fcntl(Test_Pty, F_SETFL, O_NONBLOCK);
+        RS485_TTY_Set_Interface(name);
+    }
+    memset(&Test_MSTP_Port, 0, sizeof(Test_MSTP_Port));
+    memset(&Test_MSTP_User, 0, sizeof(Test_MSTP_User));
+    Test_RS485_Driver.init();
+    Test_MSTP_User.RS485_Driver = &Test_RS485_Driver;
+    Test_MSTP_User.Receive_Buffer_Spare = Test_Rx_Spare_Buffer;
+    Test_MSTP_Port.UserData = &Test_MSTP_User;
+    Test_MSTP_Port.InputBuffer = Test_Rx_Buffer;
+    Test_MSTP_Port.InputBufferSize = sizeof(Test_Rx_Buffer);
+    Test_MSTP_Port.OutputBuffer = Test_Tx_Buffer;
+    Test_MSTP_Port.OutputBufferSize = sizeof(Test_Tx_Buffer);
+    Test_MSTP_Port.This_Station = TEST_STATION;
+    Test_MSTP_Port.Nmax_info_frames = DEFAULT_MAX_INFO_FRAMES;
+    Test_MSTP_Port.Nmax_master = DEFAULT_MAX_MASTER;
+    zassert_true(dlmstp_init((char *)&Test_MSTP_Port), NULL);
+    /* a quiet line, well inside Tno_token */
+    Test_RS485_Driver.silence_reset();
+}
+
+static uint16_t test_frame_encode(
+    uint8_t *frame,
+    uint8_t frame_type,
+    uint8_t destination,
+    const uint8_t *pdu,
+    uint16_t pdu_len)
+{
+    return MSTP_Create_Frame(
+        frame, DLMSTP_MPDU_MAX, frame_type, destination, TEST_PEER_STATION,
+        pdu, pdu_len);
+}
+
+static void test_pdu_fill(uint8_t *pdu, uint16_t pdu_len, uint8_t seed)
+{
+    uint16_t i;
+
+    /* an NPDU without a reply expected */
+    pdu[0] = BACNET_PROTOCOL_VERSION;
+    pdu[1] = 0;
+    for (i = 2; i < pdu_len; i++) {
+        pdu[i] = (uint8_t)(seed + i);
+    }
+}
+
+/**
+ * @brief Several frames written to the line at once arrive as one burst,
+ *  and every frame of the burst is received
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(dlmstp_pty_tests, test_dlmstp_pty_burst_receive)
+#else
+static void test_dlmstp_pty_burst_receive(void)
+#endif
+{
+    uint8_t line[3 * DLMSTP_MPDU_MAX];
+    uint8_t pdu[3][200];
+    uint16_t pdu_size[3] = { 20, 200, 75 };
+    BACNET_ADDRESS src = { 0 };
+    uint8_t *lent_pdu = NULL;
+    uint16_t line_len = 0, pdu_len;
+    unsigned i, frames = 0, calls = 0;
+    uint64_t start;
+
+    test_datalink_init();
+    for (i = 0; i < 3; i++) {
+        test_pdu_fill(pdu[i], pdu_size[i], (uint8_t)(0x10 * i));
+        line_len += test_frame_encode(
+            &line[line_len], FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY,
+            TEST_STATION, pdu[i], pdu_size[i]);
+    }
+    zassert_equal(write(Test_Pty, line, line_len), line_len, NULL);
+    start = test_clock_ms();
+    while ((frames < 3) && ((test_clock_ms() - start) < 1000)) {
+        calls++;
+        pdu_len = dlmstp_receive_lend(&src, &lent_pdu, 100);
+        if (pdu_len > 0) {
+            zassert_equal(pdu_len, pdu_size[frames], NULL);
+            zassert_mem_equal(lent_pdu, pdu[frames], pdu_len, NULL);
+            zassert_equal(src.mac[0], TEST_PEER_STATION, NULL);
+            dlmstp_receive_release();
+            frames++;
+        }
+    }
+    zassert_equal(frames, 3, NULL);
+    zassert_equal(Test_MSTP_User.Statistics.receive_pdu_counter, 3, NULL);
+    printf(
+        "3 frames of %u octets in one burst: %u calls, %u sleeps\n",
+        (unsigned)line_len, calls, (unsigned)RS485_TTY_Wakeups());
+}
+
+/**
+ * @brief With nothing on the line, the datalink sleeps for the timeout
+ *  instead of polling
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(dlmstp_pty_tests, test_dlmstp_pty_idle)
+#else
+static void test_dlmstp_pty_idle(void)
+#endif
+{
+    BACNET_ADDRESS src = { 0 };
+    uint8_t *lent_pdu = NULL;
+    unsigned calls = 0, poll_calls = 0;
+    uint64_t start;
+
+    test_datalink_init();
+    /* well inside Tno_token, so that the node stays idle */
+    start = test_clock_ms();
+    while ((test_clock_ms() - start) < 200) {
+        calls++;
+        zassert_equal(dlmstp_receive_lend(&src, &lent_pdu, 20), 0, NULL);
+    }
+    zassert_true(calls <= 15, NULL);
+    test_datalink_init();
+    start = test_clock_ms();
+    while ((test_clock_ms() - start) < 200) {
+        poll_calls++;
+        zassert_equal(dlmstp_receive_lend(&src, &lent_pdu, 0), 0, NULL);
+    }
+    printf(
+        "idle line for 200 ms: %u calls with a 20 ms wait, "
+        "%u calls without waiting\n",
+        calls, poll_calls);
+    zassert_true(poll_calls > calls, NULL);
+}
+
+static void *test_line_writer(void *arg)
+{
+    uint8_t frame[DLMSTP_MPDU_MAX];
+    uint8_t pdu[50];
+    uint16_t frame_len;
+
+    (void)arg;
+    test_pdu_fill(pdu, sizeof(pdu), 0x42);
+    frame_len = test_frame_encode(
+        frame, FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY, TEST_STATION,
+        pdu, sizeof(pdu));
+    usleep(50000);
+    if (write(Test_Pty, frame, frame_len) != frame_len) {
+        return NULL;
+    }
+
+    return arg;
+}
+
+/**
+ * @brief A sleeping datalink wakes when a frame arrives, not when its
+ *  timeout expires, and answers a token on the line
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(dlmstp_pty_tests, test_dlmstp_pty_wakeup)
+#else
+static void test_dlmstp_pty_wakeup(void)
+#endif
+{
+    uint8_t frame[DLMSTP_MPDU_MAX];
+    uint8_t reply[DLMSTP_MPDU_MAX];
+    BACNET_ADDRESS src = { 0 };
+    uint8_t *lent_pdu = NULL;
+    pthread_t writer;
+    uint16_t pdu_len = 0, frame_len;
+    uint64_t start, elapsed = 0;
+    ssize_t len = 0;
+
+    test_datalink_init();
+    start = test_clock_ms();
+    zassert_equal(
+        pthread_create(&writer, NULL, test_line_writer, NULL), 0, NULL);
+    while ((pdu_len == 0) && ((test_clock_ms() - start) < 2000)) {
+        pdu_len = dlmstp_receive_lend(&src, &lent_pdu, 1000);
+    }
+    elapsed = test_clock_ms() - start;
+    pthread_join(writer, NULL);
+    zassert_equal(pdu_len, 50, NULL);
+    zassert_true(elapsed < 500, NULL);
+    dlmstp_receive_release();
+    printf("frame 50 ms after the datalink slept for 1000 ms: "
+           "received after %u ms\n",
+           (unsigned)elapsed);
+    /* pass the token to this node: it has nothing to send, so it polls
+       for the next master or passes the token on */
+    frame_len =
+        test_frame_encode(frame, FRAME_TYPE_TOKEN, TEST_STATION, NULL, 0);
+    zassert_equal(write(Test_Pty, frame, frame_len), frame_len, NULL);
+    start = test_clock_ms();
+    while ((len <= 0) && ((test_clock_ms() - start) < 1000)) {
+        (void)dlmstp_receive_lend(&src, &lent_pdu, 10);
+        len = read(Test_Pty, reply, sizeof(reply));
+    }
+    zassert_true(len >= 8, NULL);
+    zassert_equal(reply[0], 0x55, NULL);
+    zassert_equal(reply[1], 0xFF, NULL);
+    zassert_equal(reply[4], TEST_STATION, NULL);
+    zassert_true(Test_MSTP_User.Statistics.transmit_frame_counter > 0, NULL);
+    RS485_TTY_Cleanup();
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(dlmstp_pty_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        dlmstp_pty_tests, ztest_unit_test(test_mstp_burst),
+        ztest_unit_test(test_dlmstp_pty_burst_receive),
+        ztest_unit_test(test_dlmstp_pty_idle),
+        ztest_unit_test(test_dlmstp_pty_wakeup));
+
+    ztest_run_test_suite(dlmstp_pty_tests);
+}
+#endif
@@ -0,0 +1,522 @@
+/**
+ * @file
+ * @brief MS/TP trunk benchmark: stations on a virtual bus, each running
+ *  the real datalink and state machines, under a seeded load and noise,
+ *  for a table of baud rates, Max_Info_Frames and Max_Master.  For each
+ *  trunk it reports the token loop time, the PDU latency distribution,
+ *  the share of the bus taken by Poll For Master, and the goodput.
+ *  With the adaptive poll, it also reports how long a new master takes
+ *  to join the ring.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/bacint.h>
+#include <bacnet/npdu.h>
+#include <bacnet/datalink/mstp.h>
+#include <bacnet/datalink/mstpdef.h>
+#include <bacnet/datalink/dlmstp.h>
+#include "mstp-bus.h"
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+/* the longest the ring may take to form before the measurement */
+#define BENCH_SETTLE_MAX_US 30000000UL
+/* once formed, the last master has polled up to Max_Master */
+#define BENCH_SETTLE_EXTRA_US 5000000UL
+#define BENCH_MEASURE_US 30000000UL
+/* time for the PDUs in the queues to go out after the load stops */
+#define BENCH_DRAIN_US 5000000UL
+#define BENCH_TICK_US 1000UL
+/* octets of application data in each PDU */
+#define BENCH_APDU_LEN 50
+#define BENCH_PDUS_MAX 8192
+/* the longest a new master may take to join the ring */
+#define BENCH_JOIN_MAX_US 120000000UL
+
+/* a trunk, and the load on it */
+struct bench_config {
+    uint32_t baud;
+    uint8_t stations;
+    uint8_t max_info_frames;
+    uint8_t max_master;
+    /* PDUs queued per second, trunk wide, half of them by station 0 */
+    uint16_t pdus_per_second;
+    uint32_t bit_error_ppb;
+    uint32_t crc_error_ppm;
+    /* MAC addresses of the stations, in order, or NULL for 0 and up */
+    const uint8_t *macs;
+    bool adaptive_poll;
+};
+
+/* a small trunk: the head-end, this node at 6, and four others */
+static const uint8_t Bench_MACs_Small[] = { 1, 6, 12, 25, 33, 47, 90 };
+
+/* the trunks to size: edit this table to benchmark others */
+static const struct bench_config Bench_Config[] = {
+    { 38400, 32, 1, 127, 20, 0, 0, NULL, false },
+    { 38400, 32, 1, 31, 20, 0, 0, NULL, false },
+    { 38400, 32, 1, 127, 60, 0, 0, NULL, false },
+    { 38400, 32, 8, 127, 60, 0, 0, NULL, false },
+    { 76800, 32, 8, 127, 60, 0, 0, NULL, false },
+    { 115200, 32, 8, 127, 60, 0, 0, NULL, false },
+    { 9600, 8, 1, 127, 10, 0, 0, NULL, false },
+    { 9600, 8, 1, 7, 10, 0, 0, NULL, false },
+    { 38400, 32, 1, 127, 20, 10000, 0, NULL, false },
+    { 38400, 32, 1, 127, 20, 0, 2000, NULL, false },
+    { 38400, 32, 1, 127, 20, 0, 0, NULL, true },
+    { 38400, 6, 1, 127, 10, 0, 0, Bench_MACs_Small, false },
+    { 38400, 6, 1, 127, 10, 0, 0, Bench_MACs_Small, true },
+};
+
+struct bench_report {
+    uint32_t loops;
+    uint64_t loop_total_us;
+    uint32_t loop_max_us;
+    uint32_t polls;
+    uint64_t poll_us;
+    uint64_t busy_us;
+    uint32_t queued;
+    uint32_t refused;
+    uint32_t delivered;
+    uint32_t duplicates;
+    uint64_t delivered_octets;
+    uint32_t latency_us[BENCH_PDUS_MAX];
+    uint32_t lost_tokens;
+    uint32_t invalid_frames;
+};
+
+static struct bench_report Bench_Report;
+static const struct bench_config *Bench;
+static bool Bench_Measuring;
+static bool Bench_Loop_Seen;
+static uint32_t Bench_Loop_us;
+static bool Bench_Poll_Pending;
+static uint32_t Bench_Poll_us;
+/* PDUs queued in the measurement, by sequence number */
+static uint8_t Bench_Delivered[BENCH_PDUS_MAX];
+static uint32_t Bench_Random;
+
+/* the load is the same on every host */
+static uint32_t bench_random(uint32_t range)
+{
+    Bench_Random = (Bench_Random * 1103515245UL) + 12345UL;
+
+    return ((Bench_Random >> 8) & 0xFFFFFF) % range;
+}
+
+static uint8_t bench_mac(unsigned station)
+{
+    if (Bench->macs) {
+        return Bench->macs[station];
+    }
+
+    return (uint8_t)station;
+}
+
+/**
+ * @brief Time the token loop at station 0, and the bus time from the
+ *  start of each Poll For Master to the start of the next frame, which
+ *  is the reply or the silence of Tusage_timeout after it
+ */
+static void bench_frame(
+    unsigned station,
+    uint32_t start_us,
+    uint32_t end_us,
+    const uint8_t *frame,
+    uint16_t frame_len)
+{
+    uint8_t frame_type;
+
+    zassert_true(frame_len >= 8, NULL);
+    frame_type = frame[2];
+    if (!Bench_Measuring) {
+        Bench_Poll_Pending = false;
+        Bench_Loop_Seen = false;
+        return;
+    }
+    Bench_Report.busy_us += end_us - start_us;
+    if (Bench_Poll_Pending) {
+        Bench_Report.poll_us += start_us - Bench_Poll_us;
+        Bench_Poll_Pending = false;
+    }
+    if (frame_type == FRAME_TYPE_POLL_FOR_MASTER) {
+        Bench_Report.polls++;
+        Bench_Poll_Pending = true;
+        Bench_Poll_us = start_us;
+    }
+    if ((station == 0) && (frame_type == FRAME_TYPE_TOKEN)) {
+        if (Bench_Loop_Seen) {
+            Bench_Report.loops++;
+            Bench_Report.loop_total_us += start_us - Bench_Loop_us;
+            if ((start_us - Bench_Loop_us) > Bench_Report.loop_max_us) {
+                Bench_Report.loop_max_us = start_us - Bench_Loop_us;
+            }
+        }
+        Bench_Loop_us = start_us;
+        Bench_Loop_Seen = true;
+    }
+}
+
+/**
+ * @brief A PDU reaches the application of a station: its latency is
+ *  from the time it was queued, carried in the PDU, to now
+ */
+static void bench_pdu(
+    unsigned station,
+    const BACNET_ADDRESS *src,
+    const uint8_t *pdu,
+    uint16_t pdu_len)
+{
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint32_t queued_us = 0;
+    uint32_t latency_us;
+    uint16_t sequence = 0;
+    int offset;
+
+    (void)station;
+    (void)src;
+    offset = bacnet_npdu_decode(pdu, pdu_len, NULL, NULL, &npdu_data);
+    zassert_true(offset > 0, NULL);
+    zassert_equal(pdu_len, offset + BENCH_APDU_LEN, NULL);
+    zassert_equal(pdu[offset], PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST, NULL);
+    decode_unsigned16(&pdu[offset + 2], &sequence);
+    decode_unsigned32(&pdu[offset + 4], &queued_us);
+    if ((sequence == 0) || (sequence >= BENCH_PDUS_MAX)) {
+        /* queued before the measurement */
+        return;
+    }
+    if (Bench_Delivered[sequence]) {
+        Bench_Report.duplicates++;
+        return;
+    }
+    Bench_Delivered[sequence] = 1;
+    latency_us = mstp_bus_now() - queued_us;
+    Bench_Report.latency_us[Bench_Report.delivered] = latency_us;
+    Bench_Report.delivered++;
+    if (Bench_Measuring) {
+        Bench_Report.delivered_octets += pdu_len;
+    }
+}
+
+/**
+ * @brief Queue the PDUs due in this tick: each from station 0 or from
+ *  another station, at random, to another station
+ */
+static void bench_traffic(void)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t pdu[MAX_NPDU + BENCH_APDU_LEN];
+    unsigned source, destination;
+    uint16_t sequence = 0;
+    int len, offset;
+
+    if (bench_random(1000000UL / BENCH_TICK_US) >= Bench->pdus_per_second) {
+        return;
+    }
+    if (bench_random(2) == 0) {
+        source = 0;
+    } else {
+        source = 1 + bench_random(Bench->stations - 1);
+    }
+    destination = (source + 1 + bench_random(Bench->stations - 1)) %
+        Bench->stations;
+    if (Bench_Measuring && (Bench_Report.queued < (BENCH_PDUS_MAX - 1))) {
+        sequence = (uint16_t)(Bench_Report.queued + 1);
+    }
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    offset = npdu_encode_pdu(pdu, &dest, NULL, &npdu_data);
+    len = offset;
+    memset(&pdu[len], 0x5A, BENCH_APDU_LEN);
+    pdu[len++] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+    pdu[len++] = SERVICE_UNCONFIRMED_PRIVATE_TRANSFER;
+    len += encode_unsigned16(&pdu[len], sequence);
+    (void)encode_unsigned32(&pdu[len], mstp_bus_now());
+    len = offset + BENCH_APDU_LEN;
+    if (mstp_bus_send(source, bench_mac(destination), pdu, len, false)) {
+        if (sequence) {
+            Bench_Report.queued++;
+        }
+    } else if (Bench_Measuring) {
+        Bench_Report.refused++;
+    }
+}
+
+/**
+ * @brief The ring is formed when each master passes the token to the next
+ */
+static bool bench_ring_formed(void)
+{
+    unsigned i;
+
+    for (i = 0; i < Bench->stations; i++) {
+        if (mstp_bus_port(i)->Next_Station !=
+            bench_mac((i + 1) % Bench->stations)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int bench_latency_compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* a latency percentile, in milliseconds */
+static unsigned long bench_latency_ms(unsigned percent)
+{
+    uint32_t index;
+
+    if (Bench_Report.delivered == 0) {
+        return 0;
+    }
+    index = ((Bench_Report.delivered - 1) * percent) / 100;
+
+    return (Bench_Report.latency_us[index] + 500UL) / 1000UL;
+}
+
+/**
+ * @brief Run a trunk: form the ring, measure under the load, then let the
+ *  queues drain
+ */
+static void bench_run(const struct bench_config *config)
+{
+    uint32_t settled_us = 0;
+    uint32_t now = 0;
+    unsigned i;
+
+    Bench = config;
+    Bench_Random = 12345;
+    Bench_Measuring = false;
+    Bench_Poll_Pending = false;
+    Bench_Loop_Seen = false;
+    memset(&Bench_Report, 0, sizeof(Bench_Report));
+    memset(Bench_Delivered, 0, sizeof(Bench_Delivered));
+    mstp_bus_init(config->stations, config->baud, MSTP_BUS_MODE_SCHEDULED);
+    for (i = 0; i < config->stations; i++) {
+        mstp_bus_mac_set(i, bench_mac(i));
+        mstp_bus_port(i)->Nmax_info_frames = config->max_info_frames;
+        mstp_bus_port(i)->Nmax_master = config->max_master;
+        mstp_bus_port(i)->AdaptivePollEnabled = config->adaptive_poll;
+    }
+    mstp_bus_noise_set(config->bit_error_ppb, config->crc_error_ppm, 1);
+    mstp_bus_frame_callback_set(bench_frame);
+    mstp_bus_pdu_callback_set(bench_pdu);
+    while (settled_us == 0) {
+        now += 100000UL;
+        mstp_bus_run(now);
+        if (bench_ring_formed() || (now >= BENCH_SETTLE_MAX_US)) {
+            settled_us = now;
+        }
+    }
+    zassert_true(bench_ring_formed(), NULL);
+    while (now < (settled_us + BENCH_SETTLE_EXTRA_US)) {
+        now += BENCH_TICK_US;
+        bench_traffic();
+        mstp_bus_run(now);
+    }
+    for (i = 0; i < config->stations; i++) {
+        Bench_Report.lost_tokens -=
+            mstp_bus_user(i)->Statistics.lost_token_counter;
+        Bench_Report.invalid_frames -=
+            mstp_bus_user(i)->Statistics.receive_invalid_frame_counter;
+    }
+    Bench_Measuring = true;
+    while (now < (settled_us + BENCH_SETTLE_EXTRA_US + BENCH_MEASURE_US)) {
+        now += BENCH_TICK_US;
+        bench_traffic();
+        mstp_bus_run(now);
+    }
+    Bench_Measuring = false;
+    for (i = 0; i < config->stations; i++) {
+        Bench_Report.lost_tokens +=
+            mstp_bus_user(i)->Statistics.lost_token_counter;
+        Bench_Report.invalid_frames +=
+            mstp_bus_user(i)->Statistics.receive_invalid_frame_counter;
+    }
+    mstp_bus_run(now + BENCH_DRAIN_US);
+    qsort(
+        Bench_Report.latency_us, Bench_Report.delivered, sizeof(uint32_t),
+        bench_latency_compare);
+    printf(
+        "mstp-bench: %6lu baud %3u stations max-info %2u max-master %3u "
+        "load %2u/s ber %5lu ppb crc %4lu ppm%s\n",
+        (unsigned long)config->baud, (unsigned)config->stations,
+        (unsigned)config->max_info_frames, (unsigned)config->max_master,
+        (unsigned)config->pdus_per_second,
+        (unsigned long)config->bit_error_ppb,
+        (unsigned long)config->crc_error_ppm,
+        config->adaptive_poll ? " adaptive poll" : "");
+    printf(
+        "  token loop %lu ms mean %lu ms max; latency ms p50 %lu p90 %lu "
+        "p99 %lu max %lu\n",
+        (unsigned long)((Bench_Report.loop_total_us /
+                         (Bench_Report.loops ? Bench_Report.loops : 1)) /
+                        1000UL),
+        (unsigned long)(Bench_Report.loop_max_us / 1000UL),
+        bench_latency_ms(50), bench_latency_ms(90), bench_latency_ms(99),
+        bench_latency_ms(100));
+    printf(
+        "  poll for master %u frames %lu.%lu%% of the bus; bus busy "
+        "%lu%%; goodput %lu bit/s, %lu%% of the line\n",
+        (unsigned)Bench_Report.polls,
+        (unsigned long)((Bench_Report.poll_us * 100ULL) / BENCH_MEASURE_US),
+        (unsigned long)(((Bench_Report.poll_us * 1000ULL) /
+                         BENCH_MEASURE_US) %
+                        10),
+        (unsigned long)((Bench_Report.busy_us * 100ULL) / BENCH_MEASURE_US),
+        (unsigned long)((Bench_Report.delivered_octets * 8ULL * 1000000ULL) /
+                        BENCH_MEASURE_US),
+        (unsigned long)((Bench_Report.delivered_octets * 10ULL * 100ULL *
+                         1000000ULL) /
+                        ((uint64_t)config->baud * BENCH_MEASURE_US)));
+    printf(
+        "  %u of %u PDUs delivered, %u refused by a full queue; %u lost "
+        "tokens, %u invalid frames, %u collisions\n",
+        (unsigned)Bench_Report.delivered, (unsigned)Bench_Report.queued,
+        (unsigned)Bench_Report.refused, (unsigned)Bench_Report.lost_tokens,
+        (unsigned)Bench_Report.invalid_frames,
+        (unsigned)mstp_bus_collisions());
+}
+
+/**
+ * @brief Benchmark each trunk of the table.  A clean trunk loses no PDU;
+ *  a smaller Max_Master polls less, and a faster bus loops faster.
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(mstp_bench_tests, test_mstp_bench)
+#else
+static void test_mstp_bench(void)
+#endif
+{
+    uint64_t poll_us[ARRAY_SIZE(Bench_Config)];
+    uint32_t loop_us[ARRAY_SIZE(Bench_Config)];
+    const struct bench_config *config;
+    unsigned i;
+
+    for (i = 0; i < ARRAY_SIZE(Bench_Config); i++) {
+        config = &Bench_Config[i];
+        bench_run(config);
+        zassert_true(Bench_Report.loops > 0, NULL);
+        zassert_true(Bench_Report.queued > 0, NULL);
+        zassert_true(Bench_Report.delivered > 0, NULL);
+        zassert_equal(Bench_Report.duplicates, 0, NULL);
+        if ((config->bit_error_ppb == 0) && (config->crc_error_ppm == 0)) {
+            zassert_equal(Bench_Report.delivered, Bench_Report.queued, NULL);
+            zassert_equal(Bench_Report.lost_tokens, 0, NULL);
+            zassert_equal(mstp_bus_collisions(), 0, NULL);
+        }
+        poll_us[i] = Bench_Report.poll_us;
+        loop_us[i] = Bench_Report.loop_total_us / Bench_Report.loops;
+    }
+    /* Max_Master at the top station: no empty addresses to poll */
+    zassert_true(poll_us[1] < poll_us[0], NULL);
+    zassert_true(poll_us[7] < poll_us[6], NULL);
+    /* the adaptive poll: less polling, and a faster token loop */
+    zassert_true(poll_us[10] < poll_us[0], NULL);
+    zassert_true(loop_us[10] < loop_us[0], NULL);
+    zassert_true(poll_us[12] < poll_us[11], NULL);
+    zassert_true(loop_us[12] < loop_us[11], NULL);
+    /* the same load on a faster bus */
+    zassert_true(loop_us[4] < loop_us[3], NULL);
+    zassert_true(loop_us[5] < loop_us[4], NULL);
+}
+
+/**
+ * @brief Time how long a master that comes onto the small trunk, above
+ *  the highest address of the ring, takes to be polled into the ring
+ * @return microseconds from its arrival to the token passed to it
+ */
+static uint32_t bench_join(bool adaptive_poll)
+{
+    const struct bench_config config = {
+        38400, 6, 1, 127, 0, 0, 0, Bench_MACs_Small, adaptive_poll
+    };
+    const unsigned stations = ARRAY_SIZE(Bench_MACs_Small);
+    uint32_t now = 0;
+    uint32_t joined_us = 0;
+    unsigned i;
+
+    Bench = &config;
+    Bench_Measuring = false;
+    mstp_bus_init(stations, config.baud, MSTP_BUS_MODE_SCHEDULED);
+    for (i = 0; i < stations; i++) {
+        mstp_bus_mac_set(i, Bench_MACs_Small[i]);
+        mstp_bus_port(i)->AdaptivePollEnabled = adaptive_poll;
+    }
+    mstp_bus_attach(stations - 1, false);
+    while (!bench_ring_formed() && (now < BENCH_SETTLE_MAX_US)) {
+        now += 100000UL;
+        mstp_bus_run(now);
+    }
+    zassert_true(bench_ring_formed(), NULL);
+    /* and a while later, the new master */
+    now += BENCH_SETTLE_EXTRA_US;
+    mstp_bus_run(now);
+    mstp_bus_attach(stations - 1, true);
+    joined_us = now;
+    while ((mstp_bus_port(config.stations - 1)->Next_Station !=
+            Bench_MACs_Small[stations - 1]) &&
+           ((now - joined_us) < BENCH_JOIN_MAX_US)) {
+        now += 10000UL;
+        mstp_bus_run(now);
+    }
+    zassert_equal(mstp_bus_collisions(), 0, NULL);
+
+    return now - joined_us;
+}
+
+/**
+ * @brief A new master above the highest address heard is still found by
+ *  the adaptive poll, in the full range poll that comes every
+ *  Npoll_full_range maintenance cycles
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(mstp_bench_tests, test_mstp_bench_join)
+#else
+static void test_mstp_bench_join(void)
+#endif
+{
+    uint32_t standard_us, adaptive_us;
+
+    standard_us = bench_join(false);
+    adaptive_us = bench_join(true);
+    printf(
+        "mstp-bench: a master at %u joins the small trunk in %lu ms, "
+        "%lu ms with the adaptive poll\n",
+        (unsigned)Bench_MACs_Small[ARRAY_SIZE(Bench_MACs_Small) - 1],
+        (unsigned long)(standard_us / 1000UL),
+        (unsigned long)(adaptive_us / 1000UL));
+    zassert_true(standard_us < BENCH_JOIN_MAX_US, NULL);
+    zassert_true(adaptive_us < BENCH_JOIN_MAX_US, NULL);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(mstp_bench_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        mstp_bench_tests, ztest_unit_test(test_mstp_bench),
+        ztest_unit_test(test_mstp_bench_join));
+
+    ztest_run_test_suite(mstp_bench_tests);
+}
+#endif
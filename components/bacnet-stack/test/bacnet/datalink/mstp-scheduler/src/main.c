@@ -0,0 +1,404 @@
+/**
+ * @file
+ * @brief test of the MS/TP deadline scheduler: the next deadline of the
+ *  state machines, and 32 masters on a virtual bus whose receive tasks
+ *  either run the datalink every millisecond or sleep until a byte or the
+ *  next deadline, compared for token rotation, wakeups and deadlines kept.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/npdu.h>
+#include <bacnet/datalink/mstp.h>
+#include <bacnet/datalink/mstpdef.h>
+#include <bacnet/datalink/dlmstp.h>
+#include "mstp-bus.h"
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_STATIONS 32
+#define TEST_BAUD 38400UL
+/* the ring is built, and the last master has polled the empty addresses
+   up to Max_Master, before the measurement starts */
+#define TEST_SETTLE_US 10000000UL
+#define TEST_MEASURE_US 10000000UL
+/* the application queues a request this often */
+#define TEST_SLICE_US 50000UL
+/* the longest a node may take to use a token or answer a poll, and to
+   answer a request */
+#define TEST_USAGE_DELAY_US (Tusage_delay * 1000UL)
+#define TEST_REPLY_DELAY_US 250000UL
+#define TEST_SERVICE_CHOICE 15
+/* the workstation gives up on a request after this long */
+#define TEST_APDU_TIMEOUT_US 3000000UL
+
+struct test_bus_report {
+    uint32_t rotations;
+    uint64_t rotation_total_us;
+    uint32_t rotation_max_us;
+    uint32_t missed;
+    uint32_t requests;
+    uint32_t replies;
+    /* replies that did not fit the queue of the station, and requests
+       that the workstation gave up on */
+    uint32_t dropped;
+    uint32_t timeouts;
+    uint32_t wakeups;
+    uint32_t lost_tokens;
+};
+
+static struct test_bus_report Test_Report;
+static bool Test_Measuring;
+static uint32_t Test_Token_us;
+static bool Test_Token_Seen;
+/* the station that is due to send the next frame, and by when */
+static bool Test_Due;
+static uint8_t Test_Due_Station;
+static uint32_t Test_Due_us;
+static uint32_t Test_Silence_us;
+/* the request that the workstation waits on */
+static bool Test_Request_Pending;
+static bool Test_Request_Counted;
+static uint8_t Test_Request_Invoke_ID;
+static uint32_t Test_Request_us;
+
+static uint32_t test_silence_microseconds(void *arg)
+{
+    (void)arg;
+    return Test_Silence_us;
+}
+
+static uint32_t test_silence_milliseconds(void *arg)
+{
+    (void)arg;
+    return Test_Silence_us / 1000UL;
+}
+
+static void test_silence_reset(void *arg)
+{
+    (void)arg;
+    Test_Silence_us = 0;
+}
+
+/**
+ * @brief Check the frames against the timing the standard asks of the
+ *  station that the frame is for: a token used or passed, and a poll for
+ *  master answered, within Tusage_delay, and a request answered within
+ *  Treply_delay.  Count the token rotations at station 0.
+ */
+static void test_bus_frame(
+    unsigned station,
+    uint32_t start_us,
+    uint32_t end_us,
+    const uint8_t *frame,
+    uint16_t frame_len)
+{
+    uint8_t frame_type, destination;
+
+    zassert_true(frame_len >= 8, NULL);
+    frame_type = frame[2];
+    destination = frame[3];
+    if (Test_Due && Test_Measuring) {
+        if ((station != Test_Due_Station) || (start_us > Test_Due_us)) {
+            Test_Report.missed++;
+        }
+    }
+    Test_Due = false;
+    if (destination < TEST_STATIONS) {
+        switch (frame_type) {
+            case FRAME_TYPE_TOKEN:
+            case FRAME_TYPE_POLL_FOR_MASTER:
+                Test_Due = true;
+                Test_Due_us = end_us + TEST_USAGE_DELAY_US;
+                break;
+            case FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY:
+                Test_Due = true;
+                Test_Due_us = end_us + TEST_REPLY_DELAY_US;
+                break;
+            default:
+                break;
+        }
+        Test_Due_Station = destination;
+    }
+    if ((station == 0) && (frame_type == FRAME_TYPE_TOKEN)) {
+        if (Test_Token_Seen && Test_Measuring) {
+            Test_Report.rotations++;
+            Test_Report.rotation_total_us += start_us - Test_Token_us;
+            if ((start_us - Test_Token_us) > Test_Report.rotation_max_us) {
+                Test_Report.rotation_max_us = start_us - Test_Token_us;
+            }
+        }
+        Test_Token_us = start_us;
+        Test_Token_Seen = true;
+    }
+}
+
+/**
+ * @brief The application of each station answers a confirmed request
+ *  with a simple ack, at once, and counts the acks it gets back
+ */
+static void test_bus_pdu(
+    unsigned station,
+    const BACNET_ADDRESS *src,
+    const uint8_t *pdu,
+    uint16_t pdu_len)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t reply[8];
+    int offset, len;
+
+    offset = bacnet_npdu_decode(pdu, pdu_len, NULL, NULL, &npdu_data);
+    zassert_true(offset > 0, NULL);
+    zassert_true(pdu_len > offset, NULL);
+    if ((pdu[offset] & 0xF0) == PDU_TYPE_CONFIRMED_SERVICE_REQUEST) {
+        npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+        len = npdu_encode_pdu(reply, &dest, NULL, &npdu_data);
+        reply[len++] = PDU_TYPE_SIMPLE_ACK;
+        reply[len++] = pdu[offset + 2];
+        reply[len++] = TEST_SERVICE_CHOICE;
+        if (!mstp_bus_send(station, src->mac[0], reply, len, false)) {
+            Test_Report.dropped++;
+        }
+    } else if ((pdu[offset] & 0xF0) == PDU_TYPE_SIMPLE_ACK) {
+        if (Test_Request_Pending &&
+            (pdu[offset + 1] == Test_Request_Invoke_ID)) {
+            Test_Request_Pending = false;
+            if (Test_Request_Counted) {
+                Test_Report.replies++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Station 0 is a workstation that reads the other stations in
+ *  turn, one request at a time, and one of the other stations announces
+ *  itself with an unconfirmed broadcast
+ */
+static void test_bus_traffic(unsigned slice)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t pdu[32];
+    unsigned station;
+    int len;
+
+    if (Test_Request_Pending &&
+        ((mstp_bus_now() - Test_Request_us) > TEST_APDU_TIMEOUT_US)) {
+        Test_Request_Pending = false;
+        if (Test_Request_Counted) {
+            Test_Report.timeouts++;
+        }
+    }
+    if (!Test_Request_Pending) {
+        station = 1 + (slice % (TEST_STATIONS - 1));
+        npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+        len = npdu_encode_pdu(pdu, &dest, NULL, &npdu_data);
+        pdu[len++] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
+        pdu[len++] = 0x05;
+        pdu[len++] = (uint8_t)slice;
+        pdu[len++] = TEST_SERVICE_CHOICE;
+        memset(&pdu[len], 0x3E, 12);
+        len += 12;
+        if (mstp_bus_send(0, station, pdu, len, true)) {
+            Test_Request_Pending = true;
+            Test_Request_Invoke_ID = (uint8_t)slice;
+            Test_Request_us = mstp_bus_now();
+            Test_Request_Counted = Test_Measuring;
+            if (Test_Measuring) {
+                Test_Report.requests++;
+            }
+        }
+    }
+    station = 1 + ((slice * 7) % (TEST_STATIONS - 1));
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    len = npdu_encode_pdu(pdu, &dest, NULL, &npdu_data);
+    pdu[len++] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+    pdu[len++] = SERVICE_UNCONFIRMED_I_AM;
+    memset(&pdu[len], 0x21, 10);
+    len += 10;
+    (void)mstp_bus_send(station, MSTP_BROADCAST_ADDRESS, pdu, len, false);
+}
+
+/**
+ * @brief Run the stations on the bus, build the ring, and measure
+ */
+static void test_bus_measure(MSTP_BUS_MODE mode, const char *name)
+{
+    uint32_t now = 0;
+    unsigned slice = 0;
+    unsigned i;
+
+    memset(&Test_Report, 0, sizeof(Test_Report));
+    Test_Measuring = false;
+    Test_Token_Seen = false;
+    Test_Due = false;
+    Test_Request_Pending = false;
+    mstp_bus_init(TEST_STATIONS, TEST_BAUD, mode);
+    mstp_bus_frame_callback_set(test_bus_frame);
+    mstp_bus_pdu_callback_set(test_bus_pdu);
+    while (now < (TEST_SETTLE_US + TEST_MEASURE_US)) {
+        if (!Test_Measuring && (now >= TEST_SETTLE_US)) {
+            Test_Measuring = true;
+            for (i = 0; i < TEST_STATIONS; i++) {
+                Test_Report.wakeups -= mstp_bus_wakeups(i);
+                Test_Report.lost_tokens -=
+                    mstp_bus_user(i)->Statistics.lost_token_counter;
+            }
+        }
+        test_bus_traffic(slice++);
+        now += TEST_SLICE_US;
+        mstp_bus_run(now);
+    }
+    for (i = 0; i < TEST_STATIONS; i++) {
+        Test_Report.wakeups += mstp_bus_wakeups(i);
+        Test_Report.lost_tokens +=
+            mstp_bus_user(i)->Statistics.lost_token_counter;
+    }
+    printf(
+        "mstp-scheduler: %s: %u masters, token rotation %lu us mean, "
+        "%lu us max, %lu wakeups/s per station, %u missed deadlines, "
+        "%u lost tokens, %u of %u requests answered, %u replies dropped, "
+        "%u collisions\n",
+        name, (unsigned)TEST_STATIONS,
+        (unsigned long)(Test_Report.rotation_total_us /
+                        (Test_Report.rotations ? Test_Report.rotations : 1)),
+        (unsigned long)Test_Report.rotation_max_us,
+        (unsigned long)(Test_Report.wakeups /
+                        (TEST_STATIONS * (TEST_MEASURE_US / 1000000UL))),
+        (unsigned)Test_Report.missed, (unsigned)Test_Report.lost_tokens,
+        (unsigned)Test_Report.replies, (unsigned)Test_Report.requests,
+        (unsigned)Test_Report.dropped, (unsigned)mstp_bus_collisions());
+}
+
+/**
+ * @brief The next deadline follows the timer of each master state
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(mstp_scheduler_tests, test_mstp_next_deadline)
+#else
+static void test_mstp_next_deadline(void)
+#endif
+{
+    struct mstp_port_struct_t port = { 0 };
+
+    zassert_equal(MSTP_Next_Deadline(NULL), MSTP_DEADLINE_NONE, NULL);
+    port.SilenceTimer = test_silence_milliseconds;
+    port.SilenceTimerReset = test_silence_reset;
+    MSTP_Init(&port);
+    port.SilenceTimerMicroseconds = test_silence_microseconds;
+    port.This_Station = 3;
+    /* passing through a state */
+    zassert_equal(port.master_state, MSTP_MASTER_STATE_INITIALIZE, NULL);
+    zassert_equal(MSTP_Next_Deadline(&port), 0, NULL);
+    port.master_state = MSTP_MASTER_STATE_USE_TOKEN;
+    zassert_equal(MSTP_Next_Deadline(&port), 0, NULL);
+    port.master_state = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
+    zassert_equal(MSTP_Next_Deadline(&port), 0, NULL);
+    /* waiting for the token */
+    port.master_state = MSTP_MASTER_STATE_IDLE;
+    Test_Silence_us = 100250;
+    zassert_equal(
+        MSTP_Next_Deadline(&port), (Tno_token * 1000UL) - 100250, NULL);
+    Test_Silence_us = Tno_token * 1000UL;
+    zassert_equal(MSTP_Next_Deadline(&port), 0, NULL);
+    /* a frame to act on */
+    Test_Silence_us = 0;
+    port.ReceivedValidFrameNotForUs = true;
+    zassert_equal(MSTP_Next_Deadline(&port), 0, NULL);
+    port.ReceivedValidFrameNotForUs = false;
+    /* part way through a frame */
+    port.receive_state = MSTP_RECEIVE_STATE_HEADER;
+    Test_Silence_us = 2000;
+    zassert_equal(
+        MSTP_Next_Deadline(&port), (port.Tframe_abort * 1000UL) + 1 - 2000,
+        NULL);
+    port.receive_state = MSTP_RECEIVE_STATE_IDLE;
+    /* the timeouts after the node sends */
+    port.master_state = MSTP_MASTER_STATE_WAIT_FOR_REPLY;
+    zassert_equal(
+        MSTP_Next_Deadline(&port), (port.Treply_timeout * 1000UL) - 2000,
+        NULL);
+    port.master_state = MSTP_MASTER_STATE_PASS_TOKEN;
+    zassert_equal(
+        MSTP_Next_Deadline(&port), (port.Tusage_timeout * 1000UL) + 1 - 2000,
+        NULL);
+    port.EventCount = Nmin_octets + 1;
+    zassert_equal(MSTP_Next_Deadline(&port), 0, NULL);
+    port.EventCount = 0;
+    port.master_state = MSTP_MASTER_STATE_POLL_FOR_MASTER;
+    zassert_equal(
+        MSTP_Next_Deadline(&port), (port.Tusage_timeout * 1000UL) + 1 - 2000,
+        NULL);
+    /* the request is kept while the reply is awaited */
+    port.master_state = MSTP_MASTER_STATE_ANSWER_DATA_REQUEST;
+    port.ReceivedValidFrame = true;
+    zassert_equal(
+        MSTP_Next_Deadline(&port), (port.Treply_delay * 1000UL) + 1 - 2000,
+        NULL);
+    port.ReceivedValidFrame = false;
+    /* the time slot of this station to make a token */
+    port.master_state = MSTP_MASTER_STATE_NO_TOKEN;
+    Test_Silence_us = Tno_token * 1000UL;
+    zassert_equal(MSTP_Next_Deadline(&port), Tslot * 3 * 1000UL, NULL);
+    /* a slave only acts on a frame */
+    port.SlaveNodeEnabled = true;
+    zassert_equal(MSTP_Next_Deadline(&port), MSTP_DEADLINE_NONE, NULL);
+}
+
+/**
+ * @brief 32 masters keep every deadline with far fewer wakeups when the
+ *  receive tasks sleep until the next deadline
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(mstp_scheduler_tests, test_mstp_scheduler_bus)
+#else
+static void test_mstp_scheduler_bus(void)
+#endif
+{
+    struct test_bus_report poll, scheduled;
+
+    test_bus_measure(MSTP_BUS_MODE_POLL, "1 ms poll");
+    poll = Test_Report;
+    test_bus_measure(MSTP_BUS_MODE_SCHEDULED, "deadline");
+    scheduled = Test_Report;
+    zassert_true(poll.rotations > 0, NULL);
+    zassert_true(scheduled.rotations > 0, NULL);
+    zassert_equal(scheduled.missed, 0, NULL);
+    zassert_equal(scheduled.lost_tokens, 0, NULL);
+    /* every request answered, but for the ones in flight at the end */
+    zassert_true(scheduled.requests > 0, NULL);
+    zassert_true((scheduled.replies + 1) >= scheduled.requests, NULL);
+    zassert_equal(scheduled.timeouts, 0, NULL);
+    zassert_equal(scheduled.dropped, 0, NULL);
+    /* the token goes round no slower, for fewer wakeups */
+    zassert_true(
+        (scheduled.rotation_total_us / scheduled.rotations) <=
+            (poll.rotation_total_us / poll.rotations),
+        NULL);
+    zassert_true((scheduled.wakeups * 2) < poll.wakeups, NULL);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(mstp_scheduler_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        mstp_scheduler_tests, ztest_unit_test(test_mstp_next_deadline),
+        ztest_unit_test(test_mstp_scheduler_bus));
+
+    ztest_run_test_suite(mstp_scheduler_tests);
+}
+#endif
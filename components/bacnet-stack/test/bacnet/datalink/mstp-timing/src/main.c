@@ -0,0 +1,485 @@
+/**
+ * @file
+ * @brief test of the MS/TP timing decisions: byte streams captured with
+ *  the time of their last edge are replayed through the real MS/TP state
+ *  machines, and the frames the node sends, and when, are checked with a
+ *  microsecond silence timer and with a millisecond one.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <bacnet/bacdef.h>
+#include <bacnet/bacaddr.h>
+#include <bacnet/datalink/mstp.h>
+#include <bacnet/datalink/mstpdef.h>
+#include <bacnet/datalink/dlmstp.h>
+#include <bacnet/basic/sys/mstimer.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_STATION 1
+#define TEST_PEER_STATION 2
+#define TEST_BAUD 38400UL
+/* the receive task polls the datalink this often */
+#define TEST_POLL_US 100
+#define TEST_CAPTURE_MAX 8
+#define TEST_TX_MAX 16
+
+/* a captured burst of octets, stamped with the edge of its last octet */
+struct test_capture {
+    /* microseconds after the edge that the burst follows */
+    uint32_t delay_us;
+    /* follows the end of the Nth frame the node sent, or 0 for the
+       start of the replay */
+    unsigned after_tx;
+    uint16_t length;
+    uint8_t data[DLMSTP_MPDU_MAX];
+};
+
+/* a frame sent by the node */
+struct test_tx {
+    uint32_t start_us;
+    uint32_t end_us;
+    uint8_t frame_type;
+    uint8_t destination;
+};
+
+static struct test_capture Test_Capture[TEST_CAPTURE_MAX];
+static unsigned Test_Capture_Count;
+static unsigned Test_Capture_Index;
+static uint16_t Test_Capture_Offset;
+static struct test_tx Test_Tx[TEST_TX_MAX];
+static unsigned Test_Tx_Count;
+/* microseconds of the replay clock */
+static uint32_t Test_Microseconds;
+static uint32_t Test_Silence_Start;
+/* the edge of the burst of the last octet read, for the silence reset
+   that the receive state machine does after each octet */
+static uint32_t Test_Rx_Edge;
+static bool Test_Rx_Edge_Pending;
+
+static uint8_t Test_Rx_Buffer[DLMSTP_MPDU_MAX];
+static uint8_t Test_Tx_Buffer[DLMSTP_MPDU_MAX];
+static struct mstp_port_struct_t Test_MSTP_Port;
+static struct dlmstp_user_data_t Test_MSTP_User;
+
+/**
+ * @brief Get the time the burst is replayed, if it can be known yet
+ */
+static bool
+test_capture_edge(const struct test_capture *capture, uint32_t *edge)
+{
+    if (capture->after_tx == 0) {
+        *edge = capture->delay_us;
+        return true;
+    }
+    if (capture->after_tx > Test_Tx_Count) {
+        return false;
+    }
+    *edge = Test_Tx[capture->after_tx - 1].end_us + capture->delay_us;
+
+    return true;
+}
+
+static void test_rs485_init(void)
+{
+    Test_Capture_Index = 0;
+    Test_Capture_Offset = 0;
+    Test_Tx_Count = 0;
+    Test_Rx_Edge_Pending = false;
+    Test_Silence_Start = Test_Microseconds;
+}
+
+static void test_rs485_send(const uint8_t *payload, uint16_t payload_len)
+{
+    struct test_tx *tx;
+
+    zassert_true(Test_Tx_Count < TEST_TX_MAX, NULL);
+    tx = &Test_Tx[Test_Tx_Count];
+    tx->start_us = Test_Microseconds;
+    tx->frame_type = payload[2];
+    tx->destination = payload[3];
+    /* the send blocks until the stop bit of the last octet */
+    Test_Microseconds +=
+        (uint32_t)((payload_len * 10UL * 1000000UL) / TEST_BAUD);
+    tx->end_us = Test_Microseconds;
+    Test_Tx_Count++;
+    Test_Rx_Edge_Pending = false;
+    Test_Silence_Start = Test_Microseconds;
+}
+
+static bool test_rs485_read(uint8_t *buf)
+{
+    struct test_capture *capture;
+    uint32_t edge = 0;
+
+    if (Test_Capture_Index >= Test_Capture_Count) {
+        return false;
+    }
+    capture = &Test_Capture[Test_Capture_Index];
+    if (!test_capture_edge(capture, &edge) || (edge > Test_Microseconds)) {
+        return false;
+    }
+    if (buf) {
+        *buf = capture->data[Test_Capture_Offset];
+        Test_Rx_Edge = edge;
+        Test_Rx_Edge_Pending = true;
+        Test_Capture_Offset++;
+        if (Test_Capture_Offset >= capture->length) {
+            Test_Capture_Offset = 0;
+            Test_Capture_Index++;
+        }
+    }
+
+    return true;
+}
+
+static bool test_rs485_transmitting(void)
+{
+    return false;
+}
+
+static uint32_t test_rs485_baud_rate(void)
+{
+    return TEST_BAUD;
+}
+
+static bool test_rs485_baud_rate_set(uint32_t baud)
+{
+    return baud == TEST_BAUD;
+}
+
+static uint32_t test_rs485_silence_microseconds(void)
+{
+    return Test_Microseconds - Test_Silence_Start;
+}
+
+static uint32_t test_rs485_silence_milliseconds(void)
+{
+    return test_rs485_silence_microseconds() / 1000UL;
+}
+
+static void test_rs485_silence_reset(void)
+{
+    if (Test_Rx_Edge_Pending) {
+        Test_Silence_Start = Test_Rx_Edge;
+        Test_Rx_Edge_Pending = false;
+    } else {
+        Test_Silence_Start = Test_Microseconds;
+    }
+}
+
+static struct dlmstp_rs485_driver Test_RS485_Driver = {
+    .init = test_rs485_init,
+    .send = test_rs485_send,
+    .read = test_rs485_read,
+    .transmitting = test_rs485_transmitting,
+    .baud_rate = test_rs485_baud_rate,
+    .baud_rate_set = test_rs485_baud_rate_set,
+    .silence_milliseconds = test_rs485_silence_milliseconds,
+    .silence_reset = test_rs485_silence_reset
+};
+
+unsigned long mstimer_now(void)
+{
+    return Test_Microseconds / 1000UL;
+}
+
+/**
+ * @brief Add a frame from a peer to the capture
+ */
+static void test_capture_frame(
+    unsigned after_tx,
+    uint32_t delay_us,
+    uint8_t frame_type,
+    uint8_t destination,
+    uint8_t source,
+    const uint8_t *pdu,
+    uint16_t pdu_len)
+{
+    struct test_capture *capture;
+
+    zassert_true(Test_Capture_Count < TEST_CAPTURE_MAX, NULL);
+    capture = &Test_Capture[Test_Capture_Count];
+    capture->after_tx = after_tx;
+    capture->delay_us = delay_us;
+    capture->length = MSTP_Create_Frame(
+        capture->data, sizeof(capture->data), frame_type, destination,
+        source, pdu, pdu_len);
+    zassert_true(capture->length > 0, NULL);
+    Test_Capture_Count++;
+}
+
+/**
+ * @brief Split the last captured frame in two bursts, the second one
+ *  a gap after the first
+ */
+static void test_capture_split(uint16_t offset, uint32_t gap_us)
+{
+    struct test_capture *first, *second;
+
+    zassert_true(Test_Capture_Count < TEST_CAPTURE_MAX, NULL);
+    first = &Test_Capture[Test_Capture_Count - 1];
+    second = &Test_Capture[Test_Capture_Count];
+    zassert_true(offset < first->length, NULL);
+    second->after_tx = first->after_tx;
+    second->delay_us = first->delay_us + gap_us;
+    second->length = first->length - offset;
+    memcpy(second->data, &first->data[offset], second->length);
+    first->length = offset;
+    Test_Capture_Count++;
+}
+
+/**
+ * @brief Start a replay with an idle node that knows its successor
+ * @param microseconds - true if the driver has a microsecond silence
+ */
+static void test_replay_init(bool microseconds)
+{
+    BACNET_ADDRESS src = { 0 };
+    uint8_t *pdu = NULL;
+
+    memset(&Test_MSTP_Port, 0, sizeof(Test_MSTP_Port));
+    memset(&Test_MSTP_User, 0, sizeof(Test_MSTP_User));
+    Test_Capture_Count = 0;
+    Test_Microseconds = 0;
+    if (microseconds) {
+        Test_RS485_Driver.silence_microseconds =
+            test_rs485_silence_microseconds;
+    } else {
+        Test_RS485_Driver.silence_microseconds = NULL;
+    }
+    Test_RS485_Driver.init();
+    Test_MSTP_User.RS485_Driver = &Test_RS485_Driver;
+    Test_MSTP_Port.UserData = &Test_MSTP_User;
+    Test_MSTP_Port.InputBuffer = Test_Rx_Buffer;
+    Test_MSTP_Port.InputBufferSize = sizeof(Test_Rx_Buffer);
+    Test_MSTP_Port.OutputBuffer = Test_Tx_Buffer;
+    Test_MSTP_Port.OutputBufferSize = sizeof(Test_Tx_Buffer);
+    Test_MSTP_Port.This_Station = TEST_STATION;
+    Test_MSTP_Port.Nmax_info_frames = DEFAULT_MAX_INFO_FRAMES;
+    Test_MSTP_Port.Nmax_master = DEFAULT_MAX_MASTER;
+    Test_MSTP_Port.Tusage_timeout = 20;
+    Test_MSTP_Port.Treply_delay = 20;
+    zassert_true(dlmstp_init((char *)&Test_MSTP_Port), NULL);
+    /* Tframe_abort of 60 bit times at the baud rate */
+    Test_MSTP_Port.Tframe_abort = 0;
+    dlmstp_set_baud_rate(TEST_BAUD);
+    /* done initializing, the node knows its successor from an earlier
+       poll for master */
+    (void)dlmstp_receive_lend(&src, &pdu, 0);
+    zassert_equal(Test_MSTP_Port.master_state, MSTP_MASTER_STATE_IDLE, NULL);
+    Test_MSTP_Port.Next_Station = TEST_PEER_STATION;
+    Test_MSTP_Port.TokenCount = 0;
+}
+
+/**
+ * @brief Poll the datalink the way the receive task does, until the
+ *  replay clock reaches the end
+ */
+static void test_replay(uint32_t end_us)
+{
+    BACNET_ADDRESS src = { 0 };
+    uint8_t *pdu = NULL;
+
+    while (Test_Microseconds < end_us) {
+        Test_Microseconds += TEST_POLL_US;
+        if (dlmstp_receive_lend(&src, &pdu, 0) > 0) {
+            /* the application never replies */
+            dlmstp_receive_release();
+        }
+    }
+}
+
+static unsigned test_tx_frames(uint8_t frame_type, uint8_t destination)
+{
+    unsigned i, count = 0;
+
+    for (i = 0; i < Test_Tx_Count; i++) {
+        if ((Test_Tx[i].frame_type == frame_type) &&
+            (Test_Tx[i].destination == destination)) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief A token passed to a successor that starts using it just inside,
+ *  or just outside, Tusage_timeout
+ */
+static unsigned test_usage_timeout(bool microseconds, int32_t offset_us)
+{
+    uint32_t usage_us;
+
+    test_replay_init(microseconds);
+    usage_us = Test_MSTP_Port.Tusage_timeout * 1000UL;
+    /* the peer passes the token to the node */
+    test_capture_frame(
+        0, 1000, FRAME_TYPE_TOKEN, TEST_STATION, TEST_PEER_STATION, NULL, 0);
+    /* and uses the token that the node passes back */
+    test_capture_frame(
+        1, usage_us + offset_us, FRAME_TYPE_TOKEN, TEST_PEER_STATION + 1,
+        TEST_PEER_STATION, NULL, 0);
+    test_replay(100000);
+    zassert_equal(Test_Capture_Index, Test_Capture_Count, NULL);
+
+    return test_tx_frames(FRAME_TYPE_TOKEN, TEST_PEER_STATION);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(mstp_timing_tests, test_mstp_timing_usage_timeout)
+#else
+static void test_mstp_timing_usage_timeout(void)
+#endif
+{
+    /* used 250us before the timeout: the token is not passed again */
+    zassert_equal(test_usage_timeout(true, -250), 1, NULL);
+    zassert_equal(test_usage_timeout(false, -250), 1, NULL);
+    /* used 250us after the timeout: the token is passed again */
+    zassert_equal(test_usage_timeout(true, 250), 2, NULL);
+    /* a millisecond timer still reads the timeout, and misses it */
+    zassert_equal(test_usage_timeout(false, 250), 1, NULL);
+}
+
+/**
+ * @brief A request that is not answered is postponed after Treply_delay
+ * @return microseconds from the end of the request to the postponement
+ */
+static uint32_t test_reply_delay(bool microseconds)
+{
+    uint8_t pdu[8] = { BACNET_PROTOCOL_VERSION, 0x04, 0, 1, 2, 3, 4, 5 };
+    uint32_t request_us = 1000;
+    unsigned i;
+
+    test_replay_init(microseconds);
+    test_capture_frame(
+        0, request_us, FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY, TEST_STATION,
+        TEST_PEER_STATION, pdu, sizeof(pdu));
+    test_replay(100000);
+    for (i = 0; i < Test_Tx_Count; i++) {
+        if (Test_Tx[i].frame_type == FRAME_TYPE_REPLY_POSTPONED) {
+            zassert_equal(Test_Tx[i].destination, TEST_PEER_STATION, NULL);
+            return Test_Tx[i].start_us - request_us;
+        }
+    }
+    zassert_unreachable("no Reply Postponed");
+
+    return 0;
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(mstp_timing_tests, test_mstp_timing_reply_delay)
+#else
+static void test_mstp_timing_reply_delay(void)
+#endif
+{
+    uint32_t delay_us, reply_delay_us;
+
+    reply_delay_us = 20 * 1000UL;
+    delay_us = test_reply_delay(true);
+    zassert_true(delay_us > reply_delay_us, NULL);
+    zassert_true(delay_us <= (reply_delay_us + TEST_POLL_US), NULL);
+    printf(
+        "Treply_delay %lu us: postponed after %lu us with a microsecond "
+        "silence, ",
+        (unsigned long)reply_delay_us, (unsigned long)delay_us);
+    delay_us = test_reply_delay(false);
+    zassert_true(delay_us >= (reply_delay_us + 1000UL), NULL);
+    printf("%lu us with a millisecond silence\n", (unsigned long)delay_us);
+}
+
+/**
+ * @brief A token that stops between octets for longer than Tframe_abort
+ * @return number of tokens passed on by the node
+ */
+static unsigned test_frame_abort(bool microseconds, uint32_t gap_us)
+{
+    test_replay_init(microseconds);
+    test_capture_frame(
+        0, 1000, FRAME_TYPE_TOKEN, TEST_STATION, TEST_PEER_STATION, NULL, 0);
+    /* the header stops after the destination address */
+    test_capture_split(4, gap_us);
+    /* the peer uses the token, if it was passed back */
+    test_capture_frame(
+        1, 5000, FRAME_TYPE_TOKEN, TEST_PEER_STATION + 1, TEST_PEER_STATION,
+        NULL, 0);
+    test_replay(50000);
+
+    return test_tx_frames(FRAME_TYPE_TOKEN, TEST_PEER_STATION);
+}
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(mstp_timing_tests, test_mstp_timing_frame_abort)
+#else
+static void test_mstp_timing_frame_abort(void)
+#endif
+{
+    uint32_t abort_us;
+
+    test_replay_init(true);
+    abort_us = Test_MSTP_Port.Tframe_abort * 1000UL;
+    zassert_equal(abort_us, 2000, NULL);
+    /* a gap inside Tframe_abort: the token is received */
+    zassert_equal(test_frame_abort(true, abort_us - 250), 1, NULL);
+    zassert_equal(test_frame_abort(false, abort_us - 250), 1, NULL);
+    /* a gap outside Tframe_abort: the frame is aborted */
+    zassert_equal(test_frame_abort(true, abort_us + 250), 0, NULL);
+    zassert_equal(
+        Test_MSTP_User.Statistics.receive_invalid_frame_counter, 1, NULL);
+    /* a millisecond timer takes the broken frame as a token */
+    zassert_equal(test_frame_abort(false, abort_us + 250), 1, NULL);
+}
+
+static uint32_t Test_Port_Silence_Milliseconds;
+
+static uint32_t test_port_silence_milliseconds(void *arg)
+{
+    (void)arg;
+    return Test_Port_Silence_Milliseconds;
+}
+
+/**
+ * @brief A port with only a millisecond silence timer gets the same
+ *  silence in microseconds, without wrapping around
+ */
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST(mstp_timing_tests, test_mstp_timing_silence_milliseconds)
+#else
+static void test_mstp_timing_silence_milliseconds(void)
+#endif
+{
+    struct mstp_port_struct_t mstp_port = { 0 };
+
+    mstp_port.SilenceTimer = test_port_silence_milliseconds;
+    Test_Port_Silence_Milliseconds = 7;
+    zassert_equal(MSTP_Silence_Microseconds(&mstp_port), 7000, NULL);
+    Test_Port_Silence_Milliseconds = 5000000UL;
+    zassert_equal(MSTP_Silence_Microseconds(&mstp_port), UINT32_MAX, NULL);
+    zassert_equal(MSTP_Silence_Microseconds(NULL), 0, NULL);
+}
+
+/**
+ * @}
+ */
+
+#if defined(CONFIG_ZTEST_NEW_API)
+ZTEST_SUITE(mstp_timing_tests, NULL, NULL, NULL, NULL, NULL);
+#else
+void test_main(void)
+{
+    ztest_test_suite(
+        mstp_timing_tests, ztest_unit_test(test_mstp_timing_usage_timeout),
+        ztest_unit_test(test_mstp_timing_reply_delay),
+        ztest_unit_test(test_mstp_timing_frame_abort),
+        ztest_unit_test(test_mstp_timing_silence_milliseconds));
+
+    ztest_run_test_suite(mstp_timing_tests);
+}
+#endif
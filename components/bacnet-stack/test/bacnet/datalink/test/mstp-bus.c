@@ -0,0 +1,603 @@
+/**
+ * @file
+ * @brief A virtual RS-485 bus for host tests.  Every station has its own
+ *  MS/TP port, datalink user data and receive queue of timed octets, and
+ *  runs the real datalink and state machines when its receive task would
+ *  run: every millisecond, or when its wait for a byte or a deadline ends.
+ *  The datalink is bound to one station at a time with dlmstp_init(), and
+ *  the RS-485 driver works on the station that is running.  Octets reach
+ *  the other stations at the stop bit, ten bit times apart at the baud
+ *  rate, and noise from a seeded generator flips bits in them, so that a
+ *  run is the same on every host.
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include "bacnet/bacdef.h"
+#include "bacnet/npdu.h"
+#include "bacnet/datalink/mstp.h"
+#include "bacnet/datalink/mstpdef.h"
+#include "bacnet/datalink/dlmstp.h"
+#include "bacnet/basic/sys/mstimer.h"
+#include "mstp-bus.h"
+
+/* octets in flight to one station */
+#define MSTP_BUS_RX_SIZE 4096
+/* longest sleep of a receive task */
+#define MSTP_BUS_TIMEOUT_MS 1000
+/* datalink calls in one run of a receive task before it is taken as
+   spinning, and the time the spinning takes */
+#define MSTP_BUS_PASSES_MAX 16
+#define MSTP_BUS_SPIN_US 50
+
+struct mstp_bus_octet {
+    /* time of the stop bit */
+    uint32_t arrival_us;
+    uint8_t data;
+    /* the last octet of a frame: the UART raises its receive event */
+    bool last;
+};
+
+struct mstp_bus_station {
+    struct mstp_port_struct_t port;
+    struct dlmstp_user_data_t user;
+    uint8_t rx_buffer[DLMSTP_MPDU_MAX];
+    uint8_t rx_spare_buffer[DLMSTP_MPDU_MAX];
+    uint8_t tx_buffer[DLMSTP_MPDU_MAX];
+    struct mstp_bus_octet rx[MSTP_BUS_RX_SIZE];
+    unsigned rx_head;
+    unsigned rx_tail;
+    /* the stop bit of the last octet read, for the silence reset that the
+       receive state machine does after each octet */
+    uint32_t rx_edge_us;
+    bool rx_edge_pending;
+    uint32_t silence_start_us;
+    /* when the receive task runs next, and if it sleeps until then */
+    uint32_t run_us;
+    bool waiting;
+    uint32_t wakeups;
+    /* a station off the bus neither runs nor hears it */
+    bool off;
+};
+
+static struct mstp_bus_station Bus_Station[MSTP_BUS_STATIONS_MAX];
+static unsigned Bus_Stations;
+static struct mstp_bus_station *Bus_Current;
+static MSTP_BUS_MODE Bus_Mode;
+static uint32_t Bus_Baud;
+/* simulated time of the station that is running */
+static uint32_t Bus_Now;
+/* the last stop bit of any frame on the bus */
+static uint32_t Bus_Idle_us;
+static uint32_t Bus_Collisions;
+/* the noise on the bus, and the damage it did */
+static uint32_t Bus_Bit_Error_ppb;
+static uint32_t Bus_CRC_Error_ppm;
+static uint64_t Bus_Random;
+static uint32_t Bus_Octets_Corrupted;
+static uint32_t Bus_Frames_Corrupted;
+static mstp_bus_frame_cb Bus_Frame_Callback;
+static mstp_bus_pdu_cb Bus_PDU_Callback;
+
+/**
+ * @brief Time from the start bit of the first octet to the stop bit of
+ *  the octet at the index, with 10 bit times for each octet
+ */
+static uint32_t mstp_bus_octets_us(unsigned octets)
+{
+    return (uint32_t)(((uint64_t)octets * 10ULL * 1000000ULL) / Bus_Baud);
+}
+
+/**
+ * @brief A random number from the seeded xorshift64* generator
+ * @param range - the number is less than this
+ */
+static uint32_t mstp_bus_random(uint32_t range)
+{
+    Bus_Random ^= Bus_Random >> 12;
+    Bus_Random ^= Bus_Random << 25;
+    Bus_Random ^= Bus_Random >> 27;
+
+    return (uint32_t)(((Bus_Random * 2685821657736338717ULL) >> 32) % range);
+}
+
+/**
+ * @brief An octet as a station hears it: a bit error flips one of the
+ *  data bits
+ */
+static uint8_t mstp_bus_noise(uint8_t data)
+{
+    if (Bus_Bit_Error_ppb &&
+        (mstp_bus_random(1000000000UL) < (8UL * Bus_Bit_Error_ppb))) {
+        data ^= (uint8_t)(1U << mstp_bus_random(8));
+        Bus_Octets_Corrupted++;
+    }
+
+    return data;
+}
+
+/**
+ * @brief Two drivers on the bus at once: each station hears garbage for
+ *  the octets of the earlier frame that overlap the new one
+ */
+static void
+mstp_bus_collision(struct mstp_bus_station *station, uint32_t start_us)
+{
+    struct mstp_bus_octet *octet;
+    unsigned i;
+
+    for (i = station->rx_tail; i != station->rx_head; i++) {
+        octet = &station->rx[i % MSTP_BUS_RX_SIZE];
+        if (octet->arrival_us > start_us) {
+            octet->data ^= 0x55;
+        }
+    }
+}
+
+static void mstp_bus_rs485_init(void)
+{
+}
+
+static void mstp_bus_rs485_send(const uint8_t *payload, uint16_t payload_len)
+{
+    struct mstp_bus_station *station;
+    struct mstp_bus_octet *octet;
+    uint32_t start_us = Bus_Now;
+    uint32_t end_us;
+    uint32_t busy_us = Bus_Idle_us;
+    bool crc_error;
+    unsigned i, j;
+
+    if (payload_len == 0) {
+        return;
+    }
+    end_us = start_us + mstp_bus_octets_us(payload_len);
+    if (start_us < Bus_Idle_us) {
+        Bus_Collisions++;
+    }
+    if (end_us > Bus_Idle_us) {
+        Bus_Idle_us = end_us;
+    }
+    for (i = 0; i < Bus_Stations; i++) {
+        station = &Bus_Station[i];
+        if ((station == Bus_Current) || station->off) {
+            continue;
+        }
+        zassert_true(
+            (station->rx_head - station->rx_tail + payload_len) <=
+                MSTP_BUS_RX_SIZE,
+            NULL);
+        if (start_us < busy_us) {
+            mstp_bus_collision(station, start_us);
+        }
+        /* every frame ends in a CRC octet: one flipped bit fails it */
+        crc_error = Bus_CRC_Error_ppm &&
+            (mstp_bus_random(1000000UL) < Bus_CRC_Error_ppm);
+        if (crc_error) {
+            Bus_Frames_Corrupted++;
+        }
+        for (j = 0; j < payload_len; j++) {
+            octet = &station->rx[station->rx_head % MSTP_BUS_RX_SIZE];
+            octet->arrival_us = start_us + mstp_bus_octets_us(j + 1);
+            octet->data = mstp_bus_noise(payload[j]);
+            if (octet->arrival_us <= busy_us) {
+                octet->data ^= 0xAA;
+            }
+            octet->last = (j == (payload_len - 1U));
+            if (octet->last && crc_error) {
+                octet->data ^= 0x01;
+            }
+            station->rx_head++;
+        }
+        if (station->waiting && (end_us < station->run_us)) {
+            /* the receive event ends the wait */
+            station->run_us = end_us;
+        }
+    }
+    if (Bus_Frame_Callback) {
+        Bus_Frame_Callback(
+            (unsigned)(Bus_Current - Bus_Station), start_us, end_us, payload,
+            payload_len);
+    }
+    /* the send blocks until the stop bit of the last octet */
+    Bus_Now = end_us;
+    Bus_Current->silence_start_us = end_us;
+    Bus_Current->rx_edge_pending = false;
+}
+
+static bool mstp_bus_rs485_read(uint8_t *buf)
+{
+    struct mstp_bus_station *station = Bus_Current;
+    struct mstp_bus_octet *octet;
+
+    if (station->rx_tail == station->rx_head) {
+        return false;
+    }
+    octet = &station->rx[station->rx_tail % MSTP_BUS_RX_SIZE];
+    if (octet->arrival_us > Bus_Now) {
+        return false;
+    }
+    if (buf) {
+        *buf = octet->data;
+        station->rx_edge_us = octet->arrival_us;
+        station->rx_edge_pending = true;
+        station->rx_tail++;
+    }
+
+    return true;
+}
+
+static bool mstp_bus_rs485_transmitting(void)
+{
+    return false;
+}
+
+static uint32_t mstp_bus_rs485_baud_rate(void)
+{
+    return Bus_Baud;
+}
+
+static bool mstp_bus_rs485_baud_rate_set(uint32_t baud)
+{
+    return baud == Bus_Baud;
+}
+
+static uint32_t mstp_bus_rs485_silence_microseconds(void)
+{
+    if (Bus_Now < Bus_Current->silence_start_us) {
+        return 0;
+    }
+
+    return Bus_Now - Bus_Current->silence_start_us;
+}
+
+static uint32_t mstp_bus_rs485_silence_milliseconds(void)
+{
+    return mstp_bus_rs485_silence_microseconds() / 1000UL;
+}
+
+static void mstp_bus_rs485_silence_reset(void)
+{
+    if (Bus_Current->rx_edge_pending) {
+        Bus_Current->silence_start_us = Bus_Current->rx_edge_us;
+        Bus_Current->rx_edge_pending = false;
+    } else {
+        Bus_Current->silence_start_us = Bus_Now;
+    }
+}
+
+/* the task sleeps: it runs again at the end of the wait, or sooner at
+   the receive event of a frame */
+static bool mstp_bus_rs485_wait(uint32_t milliseconds)
+{
+    Bus_Current->waiting = true;
+    Bus_Current->run_us = Bus_Now + (milliseconds * 1000UL);
+
+    return false;
+}
+
+static void mstp_bus_rs485_wake(void)
+{
+    if (Bus_Current->waiting && (Bus_Now < Bus_Current->run_us)) {
+        Bus_Current->run_us = Bus_Now;
+    }
+}
+
+/* a receive task that is called every millisecond */
+static struct dlmstp_rs485_driver Bus_Poll_Driver = {
+    .init = mstp_bus_rs485_init,
+    .send = mstp_bus_rs485_send,
+    .read = mstp_bus_rs485_read,
+    .transmitting = mstp_bus_rs485_transmitting,
+    .baud_rate = mstp_bus_rs485_baud_rate,
+    .baud_rate_set = mstp_bus_rs485_baud_rate_set,
+    .silence_milliseconds = mstp_bus_rs485_silence_milliseconds,
+    .silence_reset = mstp_bus_rs485_silence_reset,
+    .silence_microseconds = mstp_bus_rs485_silence_microseconds
+};
+
+/* a receive task that sleeps on the UART events */
+static struct dlmstp_rs485_driver Bus_Wait_Driver = {
+    .init = mstp_bus_rs485_init,
+    .send = mstp_bus_rs485_send,
+    .read = mstp_bus_rs485_read,
+    .transmitting = mstp_bus_rs485_transmitting,
+    .baud_rate = mstp_bus_rs485_baud_rate,
+    .baud_rate_set = mstp_bus_rs485_baud_rate_set,
+    .silence_milliseconds = mstp_bus_rs485_silence_milliseconds,
+    .silence_reset = mstp_bus_rs485_silence_reset,
+    .wait = mstp_bus_rs485_wait,
+    .silence_microseconds = mstp_bus_rs485_silence_microseconds,
+    .wake = mstp_bus_rs485_wake
+};
+
+unsigned long mstimer_now(void)
+{
+    return Bus_Now / 1000UL;
+}
+
+/**
+ * @brief Bind the datalink and the driver to a station
+ */
+static void mstp_bus_select(struct mstp_bus_station *station)
+{
+    Bus_Current = station;
+    (void)dlmstp_init((char *)&station->port);
+}
+
+/**
+ * @brief Find the receive event of the next frame on its way to a station
+ * @param station - the station
+ * @param event_us - set to the stop bit of the last octet of the frame
+ * @return true if a whole frame is on its way
+ */
+static bool
+mstp_bus_rx_event(const struct mstp_bus_station *station, uint32_t *event_us)
+{
+    const struct mstp_bus_octet *octet;
+    unsigned i;
+
+    for (i = station->rx_tail; i != station->rx_head; i++) {
+        octet = &station->rx[i % MSTP_BUS_RX_SIZE];
+        if (octet->last) {
+            *event_us = octet->arrival_us;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Run the receive task of a station once, and find when it runs
+ *  next
+ */
+static void mstp_bus_station_run(struct mstp_bus_station *station)
+{
+    BACNET_ADDRESS src = { 0 };
+    uint8_t *pdu = NULL;
+    uint16_t pdu_len;
+    unsigned passes;
+    unsigned timeout = MSTP_BUS_TIMEOUT_MS;
+    uint32_t event_us;
+
+    mstp_bus_select(station);
+    station->wakeups++;
+    station->waiting = false;
+    if (Bus_Mode == MSTP_BUS_MODE_POLL) {
+        timeout = 0;
+    }
+    for (passes = 0; passes < MSTP_BUS_PASSES_MAX; passes++) {
+        pdu_len = dlmstp_receive_lend(&src, &pdu, timeout);
+        if (pdu_len > 0) {
+            if (Bus_PDU_Callback) {
+                Bus_PDU_Callback(
+                    (unsigned)(station - Bus_Station), &src, pdu, pdu_len);
+                /* the callback may have sent from another station */
+                mstp_bus_select(station);
+            }
+            dlmstp_receive_release();
+        }
+        if ((Bus_Mode == MSTP_BUS_MODE_POLL) || station->waiting) {
+            break;
+        }
+    }
+    if (Bus_Mode == MSTP_BUS_MODE_POLL) {
+        /* the task delays until its next tick */
+        while (station->run_us <= Bus_Now) {
+            station->run_us += 1000UL;
+        }
+    } else if (!station->waiting) {
+        /* the task did not sleep: it spins on the datalink */
+        station->run_us = Bus_Now + MSTP_BUS_SPIN_US;
+    } else {
+        if (mstp_bus_rx_event(station, &event_us) &&
+            (event_us < station->run_us)) {
+            /* a frame is already on its way */
+            station->run_us = event_us;
+        }
+        if (station->run_us < Bus_Now) {
+            station->run_us = Bus_Now;
+        }
+    }
+}
+
+/**
+ * @brief Put the stations on a quiet bus, as masters at MAC addresses from
+ *  zero, each one just powered up
+ * @param stations - number of stations
+ * @param baud - baud rate of the bus
+ * @param mode - how the receive tasks run the datalink
+ */
+void mstp_bus_init(unsigned stations, uint32_t baud, MSTP_BUS_MODE mode)
+{
+    struct mstp_bus_station *station;
+    unsigned i;
+
+    zassert_true(stations <= MSTP_BUS_STATIONS_MAX, NULL);
+    Bus_Stations = stations;
+    Bus_Baud = baud;
+    Bus_Mode = mode;
+    Bus_Now = 0;
+    Bus_Idle_us = 0;
+    Bus_Collisions = 0;
+    Bus_Bit_Error_ppb = 0;
+    Bus_CRC_Error_ppm = 0;
+    Bus_Random = 1;
+    Bus_Octets_Corrupted = 0;
+    Bus_Frames_Corrupted = 0;
+    Bus_Frame_Callback = NULL;
+    Bus_PDU_Callback = NULL;
+    for (i = 0; i < stations; i++) {
+        station = &Bus_Station[i];
+        memset(station, 0, sizeof(*station));
+        if (mode == MSTP_BUS_MODE_POLL) {
+            station->user.RS485_Driver = &Bus_Poll_Driver;
+        } else {
+            station->user.RS485_Driver = &Bus_Wait_Driver;
+        }
+        station->user.Receive_Buffer_Spare = station->rx_spare_buffer;
+        station->port.UserData = &station->user;
+        station->port.InputBuffer = station->rx_buffer;
+        station->port.InputBufferSize = sizeof(station->rx_buffer);
+        station->port.OutputBuffer = station->tx_buffer;
+        station->port.OutputBufferSize = sizeof(station->tx_buffer);
+        station->port.This_Station = (uint8_t)i;
+        station->port.Nmax_info_frames = DEFAULT_MAX_INFO_FRAMES;
+        station->port.Nmax_master = DEFAULT_MAX_MASTER;
+        mstp_bus_select(station);
+        dlmstp_set_baud_rate(baud);
+        /* the receive tasks do not start in step */
+        station->run_us = (i * 97UL) % 1000UL;
+    }
+}
+
+/**
+ * @brief Add noise to the bus, heard by each station on its own
+ * @param bit_error_ppb - data bits flipped, per 10^9 bits
+ * @param crc_error_ppm - frames with a bad CRC, per 10^6 frames heard
+ * @param seed - seed of the noise; the same seed gives the same run
+ */
+void mstp_bus_noise_set(
+    uint32_t bit_error_ppb, uint32_t crc_error_ppm, uint32_t seed)
+{
+    zassert_true(bit_error_ppb <= (1000000000UL / 8UL), NULL);
+    Bus_Bit_Error_ppb = bit_error_ppb;
+    Bus_CRC_Error_ppm = crc_error_ppm;
+    Bus_Random = 0x9E3779B97F4A7C15ULL ^ seed;
+}
+
+/**
+ * @brief Move a station to another MAC address, before the bus runs
+ * @param station - the station
+ * @param mac - its MAC address
+ */
+void mstp_bus_mac_set(unsigned station, uint8_t mac)
+{
+    struct mstp_port_struct_t *port = &Bus_Station[station].port;
+
+    port->This_Station = mac;
+    port->Next_Station = mac;
+    port->Poll_Station = mac;
+}
+
+/**
+ * @brief Take a station off the bus, or put it back: its receive task
+ *  goes on from where it was, without the frames sent while it was off
+ * @param station - the station
+ * @param attached - true to put it on the bus
+ */
+void mstp_bus_attach(unsigned station, bool attached)
+{
+    struct mstp_bus_station *bus_station = &Bus_Station[station];
+
+    if (attached && bus_station->off) {
+        bus_station->rx_tail = bus_station->rx_head;
+        bus_station->waiting = false;
+        bus_station->run_us = Bus_Now;
+        bus_station->silence_start_us = Bus_Now;
+    }
+    bus_station->off = !attached;
+}
+
+void mstp_bus_frame_callback_set(mstp_bus_frame_cb callback)
+{
+    Bus_Frame_Callback = callback;
+}
+
+void mstp_bus_pdu_callback_set(mstp_bus_pdu_cb callback)
+{
+    Bus_PDU_Callback = callback;
+}
+
+/**
+ * @brief Run the receive tasks in time order until the time
+ * @param until_us - simulated time to run to
+ */
+void mstp_bus_run(uint32_t until_us)
+{
+    struct mstp_bus_station *next;
+    unsigned i;
+
+    for (;;) {
+        next = NULL;
+        for (i = 0; i < Bus_Stations; i++) {
+            if (Bus_Station[i].off) {
+                continue;
+            }
+            if (!next || (Bus_Station[i].run_us < next->run_us)) {
+                next = &Bus_Station[i];
+            }
+        }
+        if (!next || (next->run_us >= until_us)) {
+            break;
+        }
+        Bus_Now = next->run_us;
+        mstp_bus_station_run(next);
+    }
+    Bus_Now = until_us;
+}
+
+uint32_t mstp_bus_now(void)
+{
+    return Bus_Now;
+}
+
+/**
+ * @brief Queue a PDU at a station, the way another task of the station
+ *  sends one
+ * @return true if the PDU was queued
+ */
+bool mstp_bus_send(
+    unsigned station,
+    uint8_t destination,
+    const uint8_t *pdu,
+    uint16_t pdu_len,
+    bool expecting_reply)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+
+    if (station >= Bus_Stations) {
+        return false;
+    }
+    mstp_bus_select(&Bus_Station[station]);
+    dest.mac_len = 1;
+    dest.mac[0] = destination;
+    npdu_data.data_expecting_reply = expecting_reply;
+
+    return dlmstp_send_pdu(&dest, &npdu_data, (uint8_t *)pdu, pdu_len) > 0;
+}
+
+struct mstp_port_struct_t *mstp_bus_port(unsigned station)
+{
+    return &Bus_Station[station].port;
+}
+
+struct dlmstp_user_data_t *mstp_bus_user(unsigned station)
+{
+    return &Bus_Station[station].user;
+}
+
+uint32_t mstp_bus_wakeups(unsigned station)
+{
+    return Bus_Station[station].wakeups;
+}
+
+uint32_t mstp_bus_collisions(void)
+{
+    return Bus_Collisions;
+}
+
+uint32_t mstp_bus_octets_corrupted(void)
+{
+    return Bus_Octets_Corrupted;
+}
+
+uint32_t mstp_bus_frames_corrupted(void)
+{
+    return Bus_Frames_Corrupted;
+}
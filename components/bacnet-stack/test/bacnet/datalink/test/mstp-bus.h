@@ -0,0 +1,63 @@
+/**
+ * @file
+ * @brief A virtual RS-485 bus for host tests: MS/TP stations that each run
+ *  the real datalink and state machines, one at a time, in simulated time
+ * @date 2026
+ * @copyright SPDX-License-Identifier: MIT
+ */
+#ifndef MSTP_BUS_H
+#define MSTP_BUS_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacnet/bacdef.h"
+#include "bacnet/datalink/mstp.h"
+#include "bacnet/datalink/dlmstp.h"
+
+#define MSTP_BUS_STATIONS_MAX 128
+
+/* how the receive task of every station runs the datalink */
+typedef enum mstp_bus_mode {
+    /* the datalink is called every millisecond, and never waits */
+    MSTP_BUS_MODE_POLL,
+    /* the datalink sleeps until a byte or the next MS/TP deadline */
+    MSTP_BUS_MODE_SCHEDULED
+} MSTP_BUS_MODE;
+
+/* a frame put on the bus, from its first start bit to its last stop bit */
+typedef void (*mstp_bus_frame_cb)(
+    unsigned station,
+    uint32_t start_us,
+    uint32_t end_us,
+    const uint8_t *frame,
+    uint16_t frame_len);
+
+/* a PDU received by a station, in the receive task of the station */
+typedef void (*mstp_bus_pdu_cb)(
+    unsigned station,
+    const BACNET_ADDRESS *src,
+    const uint8_t *pdu,
+    uint16_t pdu_len);
+
+void mstp_bus_init(unsigned stations, uint32_t baud, MSTP_BUS_MODE mode);
+void mstp_bus_mac_set(unsigned station, uint8_t mac);
+void mstp_bus_attach(unsigned station, bool attached);
+void mstp_bus_noise_set(
+    uint32_t bit_error_ppb, uint32_t crc_error_ppm, uint32_t seed);
+void mstp_bus_frame_callback_set(mstp_bus_frame_cb callback);
+void mstp_bus_pdu_callback_set(mstp_bus_pdu_cb callback);
+void mstp_bus_run(uint32_t until_us);
+uint32_t mstp_bus_now(void);
+bool mstp_bus_send(
+    unsigned station,
+    uint8_t destination,
+    const uint8_t *pdu,
+    uint16_t pdu_len,
+    bool expecting_reply);
+struct mstp_port_struct_t *mstp_bus_port(unsigned station);
+struct dlmstp_user_data_t *mstp_bus_user(unsigned station);
+uint32_t mstp_bus_wakeups(unsigned station);
+uint32_t mstp_bus_collisions(void);
+uint32_t mstp_bus_octets_corrupted(void);
+uint32_t mstp_bus_frames_corrupted(void);
+
+#endif
@@ -31,6 +31,18 @@ void MSTP_Slave_Node_FSM(struct mstp_port_struct_t *mstp_port)
     ztest_check_expected_value(mstp_port);
 }
 
+uint32_t MSTP_Silence_Microseconds(struct mstp_port_struct_t *mstp_port)
+{
+    ztest_check_expected_value(mstp_port);
+    return ztest_get_return_value();
+}
+
+uint32_t MSTP_Next_Deadline(struct mstp_port_struct_t *mstp_port)
+{
+    ztest_check_expected_value(mstp_port);
+    return ztest_get_return_value();
+}
+
 bool MSTP_Line_Active(const struct mstp_port_struct_t *mstp_port)
 {
     ztest_check_expected_value(mstp_port);
@@ -27,165 +27,41 @@ const bool USER_ENABLE_BACNET_MSTP = true;
 const uint8_t USER_MSTP_MAC_ADDRESS = 6;
 const uint8_t USER_MSTP_MAX_INFO_FRAMES = 80;
 const uint8_t USER_MSTP_MAX_MASTER = 127;
+/* poll for masters above the highest address heard only now and then */
+const bool USER_MSTP_ADAPTIVE_POLL = true;
 const uint32_t USER_MSTP_BAUD_RATE = 38400U;
+const uint32_t USER_BACNET_IAM_INTERVAL_SECONDS = 60;
+const uint32_t USER_BACNET_IAM_INTERVAL_MAX_SECONDS = 960;
 
-/* BACnet object defaults */
-const uint32_t USER_AV_INSTANCES[USER_AV_COUNT] = { 1, 2, 3, 4 };
-const char *USER_AV_NAMES[USER_AV_COUNT] = {
-    "AV1",
-    "AV2",
-    "AV3",
-    "AV4"
-};
-const char *USER_AV_DESCRIPTIONS[USER_AV_COUNT] = {
-    "PM2.5 from PMS5003",
-    "Analog Value 2",
-    "Analog Value 3",
-    "Analog Value 4"
-};
-const uint16_t USER_AV_UNITS[USER_AV_COUNT] = {
-    UNITS_MICROGRAMS_PER_CUBIC_METER,
-    UNITS_DEGREES_CELSIUS,
-    UNITS_DEGREES_CELSIUS,
-    UNITS_DEGREES_CELSIUS
-};
-const float USER_AV_INITIAL_VALUES[USER_AV_COUNT] = {
-    0.0f,
-    0.0f,
-    0.0f,
-    0.0f
-};
-const float USER_AV_COV_INCREMENTS[USER_AV_COUNT] = {
-    1.0f,
-    1.0f,
-    1.0f,
-    1.0f
-};
-
-const uint32_t USER_BV_INSTANCES[USER_BV_COUNT] = { 1, 2, 3, 4 };
-const char *USER_BV_NAMES[USER_BV_COUNT] = {
-    "BV1",
-    "BV2",
-    "BV3",
-    "BV4"
-};
-const char *USER_BV_DESCRIPTIONS[USER_BV_COUNT] = {
-    "Binary Value 1",
-    "Binary Value 2",
-    "Binary Value 3",
-    "Binary Value 4"
-};
-const char *USER_BV_ACTIVE_TEXT[USER_BV_COUNT] = {
-    "ACTIVE",
-    "ACTIVE",
-    "ACTIVE",
-    "ACTIVE"
-};
-const char *USER_BV_INACTIVE_TEXT[USER_BV_COUNT] = {
-    "INACTIVE",
-    "INACTIVE",
-    "INACTIVE",
-    "INACTIVE"
-};
-const uint8_t USER_BV_INITIAL_VALUES[USER_BV_COUNT] = {
-    BINARY_ACTIVE,
-    BINARY_INACTIVE,
-    BINARY_ACTIVE,
-    BINARY_INACTIVE
-};
-
-const uint32_t USER_AI_INSTANCES[USER_AI_COUNT] = { 1, 2, 3, 4 };
-const char *USER_AI_NAMES[USER_AI_COUNT] = {
-    "AI1",
-    "AI2",
-    "AI3",
-    "AI4"
-};
-const char *USER_AI_DESCRIPTIONS[USER_AI_COUNT] = {
-    "Analog Input 1",
-    "Analog Input 2",
-    "Analog Input 3",
-    "Analog Input 4"
-};
-const uint16_t USER_AI_UNITS[USER_AI_COUNT] = {
-    UNITS_DEGREES_CELSIUS,
-    UNITS_DEGREES_CELSIUS,
-    UNITS_DEGREES_CELSIUS,
-    UNITS_DEGREES_CELSIUS
-};
-const float USER_AI_INITIAL_VALUES[USER_AI_COUNT] = {
-    0.0f,
-    0.0f,
-    0.0f,
-    0.0f
-};
-const float USER_AI_COV_INCREMENTS[USER_AI_COUNT] = {
-    1.0f,
-    1.0f,
-    1.0f,
-    1.0f
-};
-
-const uint32_t USER_BI_INSTANCES[USER_BI_COUNT] = { 1, 2, 3, 4 };
-const char *USER_BI_NAMES[USER_BI_COUNT] = {
-    "BI1",
-    "BI2",
-    "BI3",
-    "BI4"
-};
-const char *USER_BI_DESCRIPTIONS[USER_BI_COUNT] = {
-    "Binary Input 1",
-    "Binary Input 2",
-    "Binary Input 3",
-    "Binary Input 4"
-};
-const char *USER_BI_ACTIVE_TEXT[USER_BI_COUNT] = {
-    "ACTIVE",
-    "ACTIVE",
-    "ACTIVE",
-    "ACTIVE"
-};
-const char *USER_BI_INACTIVE_TEXT[USER_BI_COUNT] = {
-    "INACTIVE",
-    "INACTIVE",
-    "INACTIVE",
-    "INACTIVE"
-};
-const uint8_t USER_BI_INITIAL_VALUES[USER_BI_COUNT] = {
-    BINARY_INACTIVE,
-    BINARY_INACTIVE,
-    BINARY_INACTIVE,
-    BINARY_INACTIVE
-};
+/* BACnet objects of this device, created at startup */
+const BACNET_OBJECT_DESCRIPTOR USER_OBJECTS[] = {
+    /* instance, name, description, units, initial value, COV increment */
+    BACNET_OBJECT_ANALOG_VALUE(1, "AV1", "PM2.5 from PMS5003", UNITS_MICROGRAMS_PER_CUBIC_METER, 0.0f, 1.0f),
+    BACNET_OBJECT_ANALOG_VALUE(2, "AV2", "Analog Value 2", UNITS_DEGREES_CELSIUS, 0.0f, 1.0f),
+    BACNET_OBJECT_ANALOG_VALUE(3, "AV3", "Analog Value 3", UNITS_DEGREES_CELSIUS, 0.0f, 1.0f),
+    BACNET_OBJECT_ANALOG_VALUE(4, "AV4", "Analog Value 4", UNITS_DEGREES_CELSIUS, 0.0f, 1.0f),
+    /* instance, name, description, active text, inactive text, initial value */
+    BACNET_OBJECT_BINARY_VALUE(1, "BV1", "Binary Value 1", "ACTIVE", "INACTIVE", BINARY_ACTIVE),
+    BACNET_OBJECT_BINARY_VALUE(2, "BV2", "Binary Value 2", "ACTIVE", "INACTIVE", BINARY_INACTIVE),
+    BACNET_OBJECT_BINARY_VALUE(3, "BV3", "Binary Value 3", "ACTIVE", "INACTIVE", BINARY_ACTIVE),
+    BACNET_OBJECT_BINARY_VALUE(4, "BV4", "Binary Value 4", "ACTIVE", "INACTIVE", BINARY_INACTIVE),
+    /* instance, name, description, units, initial value, COV increment */
+    BACNET_OBJECT_ANALOG_INPUT(1, "AI1", "Analog Input 1", UNITS_DEGREES_CELSIUS, 0.0f, 1.0f),
+    BACNET_OBJECT_ANALOG_INPUT(2, "AI2", "Analog Input 2", UNITS_DEGREES_CELSIUS, 0.0f, 1.0f),
+    BACNET_OBJECT_ANALOG_INPUT(3, "AI3", "Analog Input 3", UNITS_DEGREES_CELSIUS, 0.0f, 1.0f),
+    BACNET_OBJECT_ANALOG_INPUT(4, "AI4", "Analog Input 4", UNITS_DEGREES_CELSIUS, 0.0f, 1.0f),
+    /* instance, name, description, active text, inactive text, initial value */
+    BACNET_OBJECT_BINARY_INPUT(1, "BI1", "Binary Input 1", "ACTIVE", "INACTIVE", BINARY_INACTIVE),
+    BACNET_OBJECT_BINARY_INPUT(2, "BI2", "Binary Input 2", "ACTIVE", "INACTIVE", BINARY_INACTIVE),
+    BACNET_OBJECT_BINARY_INPUT(3, "BI3", "Binary Input 3", "ACTIVE", "INACTIVE", BINARY_INACTIVE),
+    BACNET_OBJECT_BINARY_INPUT(4, "BI4", "Binary Input 4", "ACTIVE", "INACTIVE", BINARY_INACTIVE),
+    /* instance, name, description, active text, inactive text, initial value */
+    BACNET_OBJECT_BINARY_OUTPUT(1, "PMS5003_SET", "PMS5003 Sleep Mode Control", "SLEEP", "AWAKE", BINARY_INACTIVE),
+    BACNET_OBJECT_BINARY_OUTPUT(2, "BO2", "Binary Output 2", "ON", "OFF", BINARY_INACTIVE),
+    BACNET_OBJECT_BINARY_OUTPUT(3, "BO3", "Binary Output 3", "ON", "OFF", BINARY_INACTIVE),
+    BACNET_OBJECT_BINARY_OUTPUT(4, "BO4", "Binary Output 4", "ON", "OFF", BINARY_INACTIVE),
+};
+const size_t USER_OBJECT_COUNT = sizeof(USER_OBJECTS) / sizeof(USER_OBJECTS[0]);
 
-const uint32_t USER_BO_INSTANCES[USER_BO_COUNT] = { 1, 2, 3, 4 };
-const char *USER_BO_NAMES[USER_BO_COUNT] = {
-    "PMS5003_SET",
-    "BO2",
-    "BO3",
-    "BO4"
-};
-const char *USER_BO_DESCRIPTIONS[USER_BO_COUNT] = {
-    "PMS5003 Sleep Mode Control",
-    "Binary Output 2",
-    "Binary Output 3",
-    "Binary Output 4"
-};
-const char *USER_BO_ACTIVE_TEXT[USER_BO_COUNT] = {
-    "SLEEP",
-    "ON",
-    "ON",
-    "ON"
-};
-const char *USER_BO_INACTIVE_TEXT[USER_BO_COUNT] = {
-    "AWAKE",
-    "OFF",
-    "OFF",
-    "OFF"
-};
-const uint8_t USER_BO_INITIAL_VALUES[USER_BO_COUNT] = {
-    BINARY_INACTIVE,
-    BINARY_INACTIVE,
-    BINARY_INACTIVE,
-    BINARY_INACTIVE
-};
+/* Binary Output that drives the PMS5003 SET pin */
+const uint32_t USER_PMS5003_SET_BO_INSTANCE = 1;
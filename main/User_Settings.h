@@ -2,7 +2,9 @@
 #define USER_SETTINGS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "bacnet/basic/object/objfactory.h"
 
 /* WiFi settings */
 extern const bool USER_ENABLE_BACNET_IP;
@@ -30,48 +32,18 @@ extern const bool USER_ENABLE_BACNET_MSTP;
 extern const uint8_t USER_MSTP_MAC_ADDRESS;
 extern const uint8_t USER_MSTP_MAX_INFO_FRAMES;
 extern const uint8_t USER_MSTP_MAX_MASTER;
+extern const bool USER_MSTP_ADAPTIVE_POLL;
 extern const uint32_t USER_MSTP_BAUD_RATE;
+/* Periodic I-Am on MS/TP: first after this many seconds, then backing off
+   by doubling up to the maximum; 0 for none */
+extern const uint32_t USER_BACNET_IAM_INTERVAL_SECONDS;
+extern const uint32_t USER_BACNET_IAM_INTERVAL_MAX_SECONDS;
 
-/* BACnet object defaults */
-#define USER_AV_COUNT 4
-#define USER_BV_COUNT 4
-#define USER_AI_COUNT 4
-#define USER_BI_COUNT 4
-#define USER_BO_COUNT 4
+/* BACnet objects of this device, created at startup */
+extern const BACNET_OBJECT_DESCRIPTOR USER_OBJECTS[];
+extern const size_t USER_OBJECT_COUNT;
 
-extern const uint32_t USER_AV_INSTANCES[USER_AV_COUNT];
-extern const char *USER_AV_NAMES[USER_AV_COUNT];
-extern const char *USER_AV_DESCRIPTIONS[USER_AV_COUNT];
-extern const uint16_t USER_AV_UNITS[USER_AV_COUNT];
-extern const float USER_AV_INITIAL_VALUES[USER_AV_COUNT];
-extern const float USER_AV_COV_INCREMENTS[USER_AV_COUNT];
-
-extern const uint32_t USER_BV_INSTANCES[USER_BV_COUNT];
-extern const char *USER_BV_NAMES[USER_BV_COUNT];
-extern const char *USER_BV_DESCRIPTIONS[USER_BV_COUNT];
-extern const char *USER_BV_ACTIVE_TEXT[USER_BV_COUNT];
-extern const char *USER_BV_INACTIVE_TEXT[USER_BV_COUNT];
-extern const uint8_t USER_BV_INITIAL_VALUES[USER_BV_COUNT];
-
-extern const uint32_t USER_AI_INSTANCES[USER_AI_COUNT];
-extern const char *USER_AI_NAMES[USER_AI_COUNT];
-extern const char *USER_AI_DESCRIPTIONS[USER_AI_COUNT];
-extern const uint16_t USER_AI_UNITS[USER_AI_COUNT];
-extern const float USER_AI_INITIAL_VALUES[USER_AI_COUNT];
-extern const float USER_AI_COV_INCREMENTS[USER_AI_COUNT];
-
-extern const uint32_t USER_BI_INSTANCES[USER_BI_COUNT];
-extern const char *USER_BI_NAMES[USER_BI_COUNT];
-extern const char *USER_BI_DESCRIPTIONS[USER_BI_COUNT];
-extern const char *USER_BI_ACTIVE_TEXT[USER_BI_COUNT];
-extern const char *USER_BI_INACTIVE_TEXT[USER_BI_COUNT];
-extern const uint8_t USER_BI_INITIAL_VALUES[USER_BI_COUNT];
-
-extern const uint32_t USER_BO_INSTANCES[USER_BO_COUNT];
-extern const char *USER_BO_NAMES[USER_BO_COUNT];
-extern const char *USER_BO_DESCRIPTIONS[USER_BO_COUNT];
-extern const char *USER_BO_ACTIVE_TEXT[USER_BO_COUNT];
-extern const char *USER_BO_INACTIVE_TEXT[USER_BO_COUNT];
-extern const uint8_t USER_BO_INITIAL_VALUES[USER_BO_COUNT];
+/* Binary Output that drives the PMS5003 SET pin */
+extern const uint32_t USER_PMS5003_SET_BO_INSTANCE;
 
 #endif /* USER_SETTINGS_H */
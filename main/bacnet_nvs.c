@@ -0,0 +1,705 @@
+#include "bacnet_nvs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/* bacnet-stack headers */
+#include "bacnet/basic/object/av.h"
+#include "bacnet/basic/object/bv.h"
+#include "bacnet/basic/object/ai.h"
+#include "bacnet/basic/object/bi.h"
+#include "bacnet/basic/object/bo.h"
+#include "bacnet/basic/sys/strarena.h"
+
+#define NVS_NAMESPACE "bacnet"
+/* No snapshot is due */
+#define BACNET_NVS_IDLE UINT32_MAX
+
+static const char *TAG = "bacnet_nvs";
+static nvs_handle_t bacnet_nvs_handle;
+static SemaphoreHandle_t bacnet_nvs_mutex = NULL;
+static TaskHandle_t bacnet_nvs_task_handle = NULL;
+static void (*bacnet_nvs_object_lock)(void) = NULL;
+static void (*bacnet_nvs_object_unlock)(void) = NULL;
+/* The snapshot read at boot; freed once its strings are in the arena */
+static uint8_t *bacnet_nvs_snapshot = NULL;
+static size_t bacnet_nvs_snapshot_len = 0;
+/* A property changed since the last snapshot was written, and when */
+static bool bacnet_nvs_snapshot_dirty = false;
+static uint32_t bacnet_nvs_snapshot_since = 0;
+
+/* The object types with persisted properties, in snapshot order */
+typedef struct bacnet_nvs_object_type {
+    BACNET_OBJECT_TYPE object_type;
+    unsigned (*count)(void);
+    uint32_t (*index_to_instance)(unsigned index);
+    bool (*valid_instance)(uint32_t instance);
+    /* the per-key layout of older firmware: "<prefix>_<instance>_name",
+       "_desc", "_unit" and "_val", and which of them it has */
+    const char *legacy_prefix;
+    uint8_t legacy_properties;
+} BACNET_NVS_OBJECT_TYPE;
+
+static const BACNET_NVS_OBJECT_TYPE bacnet_nvs_object_types[] = {
+    { OBJECT_ANALOG_VALUE, Analog_Value_Count, Analog_Value_Index_To_Instance,
+        Analog_Value_Valid_Instance, "analog", NV_SNAPSHOT_NAME |
+        NV_SNAPSHOT_DESCRIPTION | NV_SNAPSHOT_UNITS |
+        NV_SNAPSHOT_PRESENT_VALUE_REAL },
+    { OBJECT_BINARY_VALUE, Binary_Value_Count, Binary_Value_Index_To_Instance,
+        Binary_Value_Valid_Instance, "binary", NV_SNAPSHOT_NAME |
+        NV_SNAPSHOT_DESCRIPTION | NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED },
+    { OBJECT_ANALOG_INPUT, Analog_Input_Count, Analog_Input_Index_To_Instance,
+        Analog_Input_Valid_Instance, "ai", NV_SNAPSHOT_NAME |
+        NV_SNAPSHOT_DESCRIPTION | NV_SNAPSHOT_PRESENT_VALUE_REAL },
+    { OBJECT_BINARY_INPUT, Binary_Input_Count, Binary_Input_Index_To_Instance,
+        Binary_Input_Valid_Instance, "bi", NV_SNAPSHOT_NAME |
+        NV_SNAPSHOT_DESCRIPTION | NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED },
+    { OBJECT_BINARY_OUTPUT, Binary_Output_Count,
+        Binary_Output_Index_To_Instance, Binary_Output_Valid_Instance, "bo",
+        NV_SNAPSHOT_NAME | NV_SNAPSHOT_DESCRIPTION |
+        NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED },
+};
+
+#define BACNET_NVS_OBJECT_TYPES \
+    (sizeof(bacnet_nvs_object_types) / sizeof(bacnet_nvs_object_types[0]))
+
+typedef struct bacnet_nvs_restore_data {
+    /* restored strings that still point into the snapshot */
+    unsigned borrowed;
+} BACNET_NVS_RESTORE_DATA;
+
+typedef struct bacnet_nvs_size_data {
+    const BACNET_OBJECT_DESCRIPTOR *table;
+    size_t count;
+    size_t octets;
+    unsigned strings;
+} BACNET_NVS_SIZE_DATA;
+
+static uint32_t bacnet_nvs_milliseconds(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void bacnet_nvs_notify(void) {
+    if (bacnet_nvs_task_handle) {
+        xTaskNotifyGive(bacnet_nvs_task_handle);
+    }
+}
+
+static const BACNET_NVS_OBJECT_TYPE *bacnet_nvs_object_type(
+    BACNET_OBJECT_TYPE object_type) {
+    size_t i;
+
+    for (i = 0; i < BACNET_NVS_OBJECT_TYPES; i++) {
+        if (bacnet_nvs_object_types[i].object_type == object_type) {
+            return &bacnet_nvs_object_types[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* The persisted properties of the object at an index across all types */
+static bool bacnet_nvs_object_get(unsigned index, NV_SNAPSHOT_OBJECT *object,
+    void *context) {
+    const BACNET_NVS_OBJECT_TYPE *type = NULL;
+    uint32_t instance;
+    unsigned count;
+    size_t i;
+    (void)context;
+
+    for (i = 0; i < BACNET_NVS_OBJECT_TYPES; i++) {
+        count = bacnet_nvs_object_types[i].count();
+        if (index < count) {
+            type = &bacnet_nvs_object_types[i];
+            break;
+        }
+        index -= count;
+    }
+    if (!type) {
+        return false;
+    }
+    instance = type->index_to_instance(index);
+    memset(object, 0, sizeof(*object));
+    object->object_type = type->object_type;
+    object->object_instance = instance;
+    object->properties = NV_SNAPSHOT_NAME | NV_SNAPSHOT_DESCRIPTION;
+    switch (type->object_type) {
+    case OBJECT_ANALOG_VALUE:
+        object->name = Analog_Value_Name_ASCII(instance);
+        object->description = Analog_Value_Description(instance);
+        object->properties |= NV_SNAPSHOT_UNITS |
+            NV_SNAPSHOT_PRESENT_VALUE_REAL | NV_SNAPSHOT_COV_INCREMENT;
+        object->units = (uint16_t)Analog_Value_Units(instance);
+        object->present_value = Analog_Value_Present_Value(instance);
+        object->cov_increment = Analog_Value_COV_Increment(instance);
+        break;
+    case OBJECT_BINARY_VALUE:
+        object->name = Binary_Value_Name_ASCII(instance);
+        object->description = Binary_Value_Description(instance);
+        object->properties |= NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED;
+        object->present_value_enumerated =
+            Binary_Value_Present_Value(instance);
+        break;
+    case OBJECT_ANALOG_INPUT:
+        /* the present value comes from the sensor */
+        object->name = Analog_Input_Name_ASCII(instance);
+        object->description = Analog_Input_Description(instance);
+        object->properties |= NV_SNAPSHOT_UNITS | NV_SNAPSHOT_COV_INCREMENT;
+        object->units = (uint16_t)Analog_Input_Units(instance);
+        object->cov_increment = Analog_Input_COV_Increment(instance);
+        break;
+    case OBJECT_BINARY_INPUT:
+        object->name = Binary_Input_Name_ASCII(instance);
+        object->description = Binary_Input_Description(instance);
+        break;
+    case OBJECT_BINARY_OUTPUT:
+        object->name = Binary_Output_Name_ASCII(instance);
+        object->description = Binary_Output_Description(instance);
+        object->properties |= NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED;
+        object->present_value_enumerated =
+            Binary_Output_Present_Value(instance);
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+/* The copy of a restored string in the shared arena, or the string itself
+   if the arena has no room for it */
+static const char *bacnet_nvs_intern(const char *string,
+    BACNET_NVS_RESTORE_DATA *restore) {
+    const char *interned = string_arena_add(string_arena_shared(), string);
+
+    if (interned) {
+        return interned;
+    }
+    restore->borrowed++;
+
+    return string;
+}
+
+/* Apply one object of the snapshot */
+static void bacnet_nvs_object_set(const NV_SNAPSHOT_OBJECT *record,
+    void *context) {
+    BACNET_NVS_RESTORE_DATA *restore = context;
+    NV_SNAPSHOT_OBJECT interned = *record;
+    const NV_SNAPSHOT_OBJECT *object = &interned;
+    const BACNET_NVS_OBJECT_TYPE *type =
+        bacnet_nvs_object_type(object->object_type);
+    uint32_t instance = object->object_instance;
+
+    if (!type || !type->valid_instance(instance)) {
+        return;
+    }
+    if (interned.properties & NV_SNAPSHOT_NAME) {
+        interned.name = bacnet_nvs_intern(interned.name, restore);
+    }
+    if (interned.properties & NV_SNAPSHOT_DESCRIPTION) {
+        interned.description =
+            bacnet_nvs_intern(interned.description, restore);
+    }
+    switch (object->object_type) {
+    case OBJECT_ANALOG_VALUE:
+        if (object->properties & NV_SNAPSHOT_NAME) {
+            Analog_Value_Name_Set(instance, object->name);
+        }
+        if (object->properties & NV_SNAPSHOT_DESCRIPTION) {
+            Analog_Value_Description_Set(instance, object->description);
+        }
+        if (object->properties & NV_SNAPSHOT_UNITS) {
+            Analog_Value_Units_Set(instance, object->units);
+        }
+        if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_REAL) {
+            Analog_Value_Present_Value_Set(instance, object->present_value, 16);
+        }
+        if (object->properties & NV_SNAPSHOT_COV_INCREMENT) {
+            Analog_Value_COV_Increment_Set(instance, object->cov_increment);
+        }
+        break;
+    case OBJECT_BINARY_VALUE:
+        if (object->properties & NV_SNAPSHOT_NAME) {
+            Binary_Value_Name_Set(instance, object->name);
+        }
+        if (object->properties & NV_SNAPSHOT_DESCRIPTION) {
+            Binary_Value_Description_Set(instance, object->description);
+        }
+        if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED) {
+            Binary_Value_Present_Value_Set(instance,
+                (BACNET_BINARY_PV)object->present_value_enumerated);
+        }
+        break;
+    case OBJECT_ANALOG_INPUT:
+        if (object->properties & NV_SNAPSHOT_NAME) {
+            Analog_Input_Name_Set(instance, object->name);
+        }
+        if (object->properties & NV_SNAPSHOT_DESCRIPTION) {
+            Analog_Input_Description_Set(instance, object->description);
+        }
+        if (object->properties & NV_SNAPSHOT_UNITS) {
+            Analog_Input_Units_Set(instance, object->units);
+        }
+        if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_REAL) {
+            Analog_Input_Present_Value_Set(instance, object->present_value);
+        }
+        if (object->properties & NV_SNAPSHOT_COV_INCREMENT) {
+            Analog_Input_COV_Increment_Set(instance, object->cov_increment);
+        }
+        break;
+    case OBJECT_BINARY_INPUT:
+        if (object->properties & NV_SNAPSHOT_NAME) {
+            Binary_Input_Name_Set(instance, object->name);
+        }
+        if (object->properties & NV_SNAPSHOT_DESCRIPTION) {
+            Binary_Input_Description_Set(instance, object->description);
+        }
+        break;
+    case OBJECT_BINARY_OUTPUT:
+        if (object->properties & NV_SNAPSHOT_NAME) {
+            Binary_Output_Name_Set(instance, object->name);
+        }
+        if (object->properties & NV_SNAPSHOT_DESCRIPTION) {
+            Binary_Output_Description_Set(instance, object->description);
+        }
+        if (object->properties & NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED) {
+            Binary_Output_Present_Value_Set(instance,
+                (BACNET_BINARY_PV)object->present_value_enumerated, 16);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Format the per-key name of one property of an object */
+static void bacnet_nvs_legacy_key(char *key, size_t size,
+    const BACNET_NVS_OBJECT_TYPE *type, uint32_t instance, const char *name) {
+    snprintf(key, size, "%s_%lu_%s", type->legacy_prefix,
+        (unsigned long)instance, name);
+}
+
+/* Add the string arena the per-key name and description will take */
+static void bacnet_nvs_legacy_size(const BACNET_NVS_OBJECT_TYPE *type,
+    uint32_t instance, BACNET_NVS_SIZE_DATA *size) {
+    char key[32];
+    size_t len;
+
+    bacnet_nvs_legacy_key(key, sizeof(key), type, instance, "name");
+    if ((nvs_get_str(bacnet_nvs_handle, key, NULL, &len) == ESP_OK) &&
+        (len > 0)) {
+        size->octets += string_arena_need_length(len - 1);
+        size->strings++;
+    }
+    bacnet_nvs_legacy_key(key, sizeof(key), type, instance, "desc");
+    if ((nvs_get_str(bacnet_nvs_handle, key, NULL, &len) == ESP_OK) &&
+        (len > 0)) {
+        size->octets += string_arena_need_length(len - 1);
+        size->strings++;
+    }
+}
+
+/* A per-key string kept for the life of the object: in the shared arena,
+   or a copy of its own if the arena has no room for it */
+static const char *bacnet_nvs_legacy_string(const char *text) {
+    const char *string = string_arena_add(string_arena_shared(), text);
+
+    if (!string) {
+        string = strdup(text);
+    }
+
+    return string;
+}
+
+/* Read the per-key properties of one object, with its strings interned,
+   and apply them like a snapshot record */
+static void bacnet_nvs_legacy_load(const BACNET_NVS_OBJECT_TYPE *type,
+    uint32_t instance, BACNET_NVS_RESTORE_DATA *restore) {
+    NV_SNAPSHOT_OBJECT object = { 0 };
+    char key[32];
+    char text[NV_SNAPSHOT_STRING_MAX + 1];
+    uint8_t value8;
+    size_t len;
+
+    object.object_type = type->object_type;
+    object.object_instance = instance;
+    bacnet_nvs_legacy_key(key, sizeof(key), type, instance, "name");
+    len = sizeof(text);
+    if (nvs_get_str(bacnet_nvs_handle, key, text, &len) == ESP_OK) {
+        object.name = bacnet_nvs_legacy_string(text);
+        if (object.name) {
+            object.properties |= NV_SNAPSHOT_NAME;
+        }
+    }
+    bacnet_nvs_legacy_key(key, sizeof(key), type, instance, "desc");
+    len = sizeof(text);
+    if (nvs_get_str(bacnet_nvs_handle, key, text, &len) == ESP_OK) {
+        object.description = bacnet_nvs_legacy_string(text);
+        if (object.description) {
+            object.properties |= NV_SNAPSHOT_DESCRIPTION;
+        }
+    }
+    if (type->legacy_properties & NV_SNAPSHOT_UNITS) {
+        bacnet_nvs_legacy_key(key, sizeof(key), type, instance, "unit");
+        if (nvs_get_u16(bacnet_nvs_handle, key, &object.units) == ESP_OK) {
+            object.properties |= NV_SNAPSHOT_UNITS;
+        }
+    }
+    bacnet_nvs_legacy_key(key, sizeof(key), type, instance, "val");
+    if (type->legacy_properties & NV_SNAPSHOT_PRESENT_VALUE_REAL) {
+        len = sizeof(object.present_value);
+        if ((nvs_get_blob(bacnet_nvs_handle, key, &object.present_value,
+                &len) == ESP_OK) && (len == sizeof(object.present_value))) {
+            object.properties |= NV_SNAPSHOT_PRESENT_VALUE_REAL;
+        }
+    } else if (type->legacy_properties &
+        NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED) {
+        if (nvs_get_u8(bacnet_nvs_handle, key, &value8) == ESP_OK) {
+            object.present_value_enumerated = value8;
+            object.properties |= NV_SNAPSHOT_PRESENT_VALUE_ENUMERATED;
+        }
+    }
+    bacnet_nvs_object_set(&object, restore);
+}
+
+/* Determine if the snapshot holds an object */
+static bool bacnet_nvs_snapshot_holds(BACNET_OBJECT_TYPE object_type,
+    uint32_t instance) {
+    return bacnet_nvs_snapshot &&
+        nv_snapshot_object_find(bacnet_nvs_snapshot, bacnet_nvs_snapshot_len,
+            object_type, instance, NULL);
+}
+
+/* Add the string arena the strings of one snapshot object will take,
+   unless they are those of the table, which the arena holds already */
+static void bacnet_nvs_snapshot_size(const NV_SNAPSHOT_OBJECT *object,
+    void *context) {
+    BACNET_NVS_SIZE_DATA *size = context;
+    const BACNET_OBJECT_DESCRIPTOR *row = NULL;
+    size_t i;
+
+    for (i = 0; i < size->count; i++) {
+        if ((size->table[i].object_type == object->object_type) &&
+            (size->table[i].object_instance == object->object_instance)) {
+            row = &size->table[i];
+            break;
+        }
+    }
+    if (!row) {
+        return;
+    }
+    if ((object->properties & NV_SNAPSHOT_NAME) &&
+        (!row->name || (strcmp(row->name, object->name) != 0))) {
+        size->octets += string_arena_need(object->name);
+        size->strings++;
+    }
+    if ((object->properties & NV_SNAPSHOT_DESCRIPTION) &&
+        (!row->description ||
+            (strcmp(row->description, object->description) != 0))) {
+        size->octets += string_arena_need(object->description);
+        size->strings++;
+    }
+}
+
+size_t bacnet_nvs_restore_size(const BACNET_OBJECT_DESCRIPTOR *table,
+    size_t count, unsigned *strings) {
+    BACNET_NVS_SIZE_DATA size = { table, count, 0, 0 };
+    const BACNET_NVS_OBJECT_TYPE *type;
+    size_t i;
+
+    if (bacnet_nvs_snapshot && table) {
+        (void)nv_snapshot_decode(bacnet_nvs_snapshot, bacnet_nvs_snapshot_len,
+            bacnet_nvs_snapshot_size, &size);
+    }
+    for (i = 0; table && (i < count); i++) {
+        type = bacnet_nvs_object_type(table[i].object_type);
+        if (type && !bacnet_nvs_snapshot_holds(table[i].object_type,
+                table[i].object_instance)) {
+            bacnet_nvs_legacy_size(type, table[i].object_instance, &size);
+        }
+    }
+    if (strings) {
+        *strings = size.strings;
+    }
+
+    return size.octets;
+}
+
+void bacnet_nvs_restore(void) {
+    BACNET_NVS_RESTORE_DATA restore = { 0 };
+    const BACNET_NVS_OBJECT_TYPE *type;
+    unsigned migrated = 0;
+    uint32_t instance;
+    unsigned count;
+    unsigned i;
+    size_t t;
+
+    if (bacnet_nvs_snapshot) {
+        (void)nv_snapshot_decode(bacnet_nvs_snapshot, bacnet_nvs_snapshot_len,
+            bacnet_nvs_object_set, &restore);
+    }
+    /* objects the snapshot does not hold yet: the per-key layout */
+    for (t = 0; t < BACNET_NVS_OBJECT_TYPES; t++) {
+        type = &bacnet_nvs_object_types[t];
+        count = type->count();
+        for (i = 0; i < count; i++) {
+            instance = type->index_to_instance(i);
+            if (!bacnet_nvs_snapshot_holds(type->object_type, instance)) {
+                bacnet_nvs_legacy_load(type, instance, &restore);
+                migrated++;
+            }
+        }
+    }
+    /* the objects now point into the string arena, not the snapshot */
+    if (bacnet_nvs_snapshot && (restore.borrowed == 0)) {
+        free(bacnet_nvs_snapshot);
+        bacnet_nvs_snapshot = NULL;
+        bacnet_nvs_snapshot_len = 0;
+    }
+    if (migrated > 0) {
+        ESP_LOGI(TAG, "Loaded %u objects from per-key NVS", migrated);
+        bacnet_nvs_changed();
+    }
+}
+
+void bacnet_nvs_changed(void) {
+    bool notify = false;
+
+    if (!bacnet_nvs_mutex) {
+        return;
+    }
+    xSemaphoreTake(bacnet_nvs_mutex, portMAX_DELAY);
+    if (!bacnet_nvs_snapshot_dirty) {
+        bacnet_nvs_snapshot_dirty = true;
+        bacnet_nvs_snapshot_since = bacnet_nvs_milliseconds();
+        notify = true;
+    }
+    xSemaphoreGive(bacnet_nvs_mutex);
+    if (notify) {
+        bacnet_nvs_notify();
+    }
+}
+
+/* Milliseconds until the snapshot is due, 0 for now, or BACNET_NVS_IDLE */
+static uint32_t bacnet_nvs_snapshot_due(void) {
+    uint32_t due = BACNET_NVS_IDLE;
+    uint32_t elapsed;
+
+    xSemaphoreTake(bacnet_nvs_mutex, portMAX_DELAY);
+    if (bacnet_nvs_snapshot_dirty) {
+        elapsed = bacnet_nvs_milliseconds() - bacnet_nvs_snapshot_since;
+        if (elapsed >= BACNET_NVS_MAX_LATENCY_MS) {
+            due = 0;
+        } else {
+            due = BACNET_NVS_MAX_LATENCY_MS - elapsed;
+        }
+    }
+    xSemaphoreGive(bacnet_nvs_mutex);
+
+    return due;
+}
+
+/* Pack every object into one blob and replace the snapshot with it */
+static void bacnet_nvs_snapshot_write(void) {
+    uint8_t *buffer = NULL;
+    size_t length = 0;
+    size_t size;
+    esp_err_t err = ESP_ERR_NO_MEM;
+
+    xSemaphoreTake(bacnet_nvs_mutex, portMAX_DELAY);
+    bacnet_nvs_snapshot_dirty = false;
+    xSemaphoreGive(bacnet_nvs_mutex);
+    if (bacnet_nvs_object_lock) {
+        bacnet_nvs_object_lock();
+    }
+    size = nv_snapshot_size(bacnet_nvs_object_get, NULL);
+    buffer = malloc(size);
+    if (buffer) {
+        length = nv_snapshot_encode(buffer, size, bacnet_nvs_object_get, NULL);
+    }
+    if (bacnet_nvs_object_unlock) {
+        bacnet_nvs_object_unlock();
+    }
+    if (length > 0) {
+        err = nvs_set_blob(bacnet_nvs_handle, NV_SNAPSHOT_KEY, buffer, length);
+        if (err == ESP_OK) {
+            err = nvs_commit(bacnet_nvs_handle);
+        }
+    }
+    free(buffer);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Saved object snapshot, %u octets", (unsigned)length);
+    } else {
+        ESP_LOGE(TAG, "Object snapshot write failed: %d", err);
+        bacnet_nvs_changed();
+    }
+}
+
+/* Read the snapshot with a single read; it is kept for the object names */
+static void bacnet_nvs_snapshot_read(void) {
+    size_t length = 0;
+
+    if ((nvs_get_blob(bacnet_nvs_handle, NV_SNAPSHOT_KEY, NULL, &length) !=
+            ESP_OK) || (length == 0)) {
+        ESP_LOGI(TAG, "No object snapshot in NVS");
+        return;
+    }
+    bacnet_nvs_snapshot = malloc(length);
+    if (!bacnet_nvs_snapshot) {
+        return;
+    }
+    if ((nvs_get_blob(bacnet_nvs_handle, NV_SNAPSHOT_KEY, bacnet_nvs_snapshot,
+            &length) != ESP_OK) ||
+        !nv_snapshot_valid(bacnet_nvs_snapshot, length, NULL)) {
+        ESP_LOGW(TAG, "Object snapshot in NVS is not valid");
+        free(bacnet_nvs_snapshot);
+        bacnet_nvs_snapshot = NULL;
+        return;
+    }
+    bacnet_nvs_snapshot_len = length;
+}
+
+/* Sleeps until the oldest written property has waited
+   BACNET_NVS_MAX_LATENCY_MS, then writes a new object snapshot that holds
+   everything written so far. */
+static void bacnet_nvs_task(void *pvParameters) {
+    uint32_t due;
+    (void)pvParameters;
+
+    for (;;) {
+        due = bacnet_nvs_snapshot_due();
+        if (due == BACNET_NVS_IDLE) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        } else if (due > 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(due) + 1);
+        }
+        if (bacnet_nvs_snapshot_due() == 0) {
+            bacnet_nvs_snapshot_write();
+        }
+    }
+}
+
+bool bacnet_nvs_init(void (*object_lock)(void), void (*object_unlock)(void)) {
+    esp_err_t err;
+
+    bacnet_nvs_object_lock = object_lock;
+    bacnet_nvs_object_unlock = object_unlock;
+    bacnet_nvs_mutex = xSemaphoreCreateMutex();
+    if (!bacnet_nvs_mutex) {
+        ESP_LOGE(TAG, "Failed to create NVS mutex");
+        return false;
+    }
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &bacnet_nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "NVS open failed: %d", err);
+        return false;
+    }
+    bacnet_nvs_snapshot_read();
+    if (xTaskCreate(bacnet_nvs_task, "bacnet_nvs", 4096, NULL, 2,
+            &bacnet_nvs_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create bacnet_nvs task");
+        return false;
+    }
+    ESP_LOGI(TAG, "NVS snapshot task ready");
+
+    return true;
+}
+
+/* Called by the objects when a persisted property is written; the write
+   is queued and the property is packed into the next snapshot */
+void bacnet_nvs_save_av_name(uint32_t instance, const char *name, uint16_t length) {
+    ESP_LOGI(TAG, "Queued AV%lu name: %.*s", (unsigned long)instance, (int)length, name ? name : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_av_desc(uint32_t instance, const char *desc, uint16_t length) {
+    ESP_LOGI(TAG, "Queued AV%lu desc: %.*s", (unsigned long)instance, (int)length, desc ? desc : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_av_units(uint32_t instance, uint16_t units) {
+    ESP_LOGI(TAG, "Queued AV%lu units: %u", (unsigned long)instance, units);
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_av_pv(uint32_t instance, float value) {
+    ESP_LOGI(TAG, "Queued AV%lu value: %.2f", (unsigned long)instance, value);
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_av_cov_increment(uint32_t instance, float value) {
+    ESP_LOGI(TAG, "Queued AV%lu COV increment: %.2f", (unsigned long)instance, value);
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bv_name(uint32_t instance, const char *name, uint16_t length) {
+    ESP_LOGI(TAG, "Queued BV%lu name: %.*s", (unsigned long)instance, (int)length, name ? name : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bv_desc(uint32_t instance, const char *desc, uint16_t length) {
+    ESP_LOGI(TAG, "Queued BV%lu desc: %.*s", (unsigned long)instance, (int)length, desc ? desc : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bv_pv(uint32_t instance, uint8_t value) {
+    ESP_LOGI(TAG, "Queued BV%lu value: %u", (unsigned long)instance, value);
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_ai_name(uint32_t instance, const char *name, uint16_t length) {
+    ESP_LOGI(TAG, "Queued AI%lu name: %.*s", (unsigned long)instance, (int)length, name ? name : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_ai_desc(uint32_t instance, const char *desc, uint16_t length) {
+    ESP_LOGI(TAG, "Queued AI%lu desc: %.*s", (unsigned long)instance, (int)length, desc ? desc : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_ai_pv(uint32_t instance, float value) {
+    ESP_LOGI(TAG, "Queued AI%lu value: %.2f", (unsigned long)instance, value);
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_ai_cov_increment(uint32_t instance, float value) {
+    ESP_LOGI(TAG, "Queued AI%lu COV increment: %.2f", (unsigned long)instance, value);
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bi_name(uint32_t instance, const char *name, uint16_t length) {
+    ESP_LOGI(TAG, "Queued BI%lu name: %.*s", (unsigned long)instance, (int)length, name ? name : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bi_desc(uint32_t instance, const char *desc, uint16_t length) {
+    ESP_LOGI(TAG, "Queued BI%lu desc: %.*s", (unsigned long)instance, (int)length, desc ? desc : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bi_pv(uint32_t instance, uint8_t value) {
+    ESP_LOGI(TAG, "Queued BI%lu value: %u", (unsigned long)instance, value);
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bo_name(uint32_t instance, const char *name, uint16_t length) {
+    ESP_LOGI(TAG, "Queued BO%lu name: %.*s", (unsigned long)instance, (int)length, name ? name : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bo_desc(uint32_t instance, const char *desc, uint16_t length) {
+    ESP_LOGI(TAG, "Queued BO%lu desc: %.*s", (unsigned long)instance, (int)length, desc ? desc : "");
+    bacnet_nvs_changed();
+}
+
+void bacnet_nvs_save_bo_pv(uint32_t instance, uint8_t value) {
+    ESP_LOGI(TAG, "Queued BO%lu value: %u", (unsigned long)instance, value);
+    bacnet_nvs_changed();
+}
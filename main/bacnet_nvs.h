@@ -0,0 +1,56 @@
+#ifndef BACNET_NVS_H
+#define BACNET_NVS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bacnet/bacenum.h"
+#include "bacnet/basic/object/objfactory.h"
+#include "bacnet/basic/sys/nvsnapshot.h"
+
+/* Longest time a written property waits in RAM before it is committed */
+#ifndef BACNET_NVS_MAX_LATENCY_MS
+#define BACNET_NVS_MAX_LATENCY_MS 1000
+#endif
+
+/* Open the NVS namespace, read the object snapshot and start the task
+   that writes the next one. Call after nvs_flash_init() and before the
+   objects are created. The lock functions guard the objects while the
+   snapshot task packs them into the snapshot. */
+bool bacnet_nvs_init(void (*object_lock)(void), void (*object_unlock)(void));
+
+/* Octets and number of strings the names and descriptions restored for
+   the objects of a table will add to the shared string arena */
+size_t bacnet_nvs_restore_size(const BACNET_OBJECT_DESCRIPTOR *table,
+    size_t count, unsigned *strings);
+
+/* Restore the persisted properties of every object from the snapshot,
+   with their strings interned in the shared string arena; objects it
+   does not hold yet load from the per-key layout of older firmware and
+   are added to the next snapshot. The snapshot is freed once none of
+   the objects point into it. */
+void bacnet_nvs_restore(void);
+
+/* A persisted property has been written: schedule a new snapshot */
+void bacnet_nvs_changed(void);
+
+/* Called by the objects when a persisted property is written */
+void bacnet_nvs_save_av_name(uint32_t instance, const char *name, uint16_t length);
+void bacnet_nvs_save_av_desc(uint32_t instance, const char *desc, uint16_t length);
+void bacnet_nvs_save_av_units(uint32_t instance, uint16_t units);
+void bacnet_nvs_save_av_pv(uint32_t instance, float value);
+void bacnet_nvs_save_av_cov_increment(uint32_t instance, float value);
+void bacnet_nvs_save_bv_name(uint32_t instance, const char *name, uint16_t length);
+void bacnet_nvs_save_bv_desc(uint32_t instance, const char *desc, uint16_t length);
+void bacnet_nvs_save_bv_pv(uint32_t instance, uint8_t value);
+void bacnet_nvs_save_ai_name(uint32_t instance, const char *name, uint16_t length);
+void bacnet_nvs_save_ai_desc(uint32_t instance, const char *desc, uint16_t length);
+void bacnet_nvs_save_ai_pv(uint32_t instance, float value);
+void bacnet_nvs_save_ai_cov_increment(uint32_t instance, float value);
+void bacnet_nvs_save_bi_name(uint32_t instance, const char *name, uint16_t length);
+void bacnet_nvs_save_bi_desc(uint32_t instance, const char *desc, uint16_t length);
+void bacnet_nvs_save_bi_pv(uint32_t instance, uint8_t value);
+void bacnet_nvs_save_bo_name(uint32_t instance, const char *name, uint16_t length);
+void bacnet_nvs_save_bo_desc(uint32_t instance, const char *desc, uint16_t length);
+void bacnet_nvs_save_bo_pv(uint32_t instance, uint8_t value);
+
+#endif /* BACNET_NVS_H */
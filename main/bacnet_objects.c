@@ -0,0 +1,81 @@
+#include "bacnet_objects.h"
+
+#include <stdlib.h>
+#include "esp_log.h"
+#include "bacnet_nvs.h"
+
+/* bacnet-stack headers */
+#include "bacnet/basic/object/objfactory.h"
+#include "bacnet/basic/sys/strarena.h"
+
+static const char *TAG = "bacnet_objects";
+
+/* Override NVS values with code defaults - set in main config */
+extern int override_nvs_on_flash;
+
+/* The names, descriptions and state texts of every object */
+static STRING_ARENA bacnet_objects_arena;
+
+/* The object types of the factory, in snapshot order */
+static const struct {
+    BACNET_OBJECT_TYPE object_type;
+    const char *name;
+} bacnet_objects_types[] = {
+    { OBJECT_ANALOG_VALUE, "Analog Value" },
+    { OBJECT_BINARY_VALUE, "Binary Value" },
+    { OBJECT_ANALOG_INPUT, "Analog Input" },
+    { OBJECT_BINARY_INPUT, "Binary Input" },
+    { OBJECT_BINARY_OUTPUT, "Binary Output" },
+};
+
+bool bacnet_objects_create(const BACNET_OBJECT_DESCRIPTOR *table, size_t count) {
+    unsigned strings = 0;
+    unsigned restored = 0;
+    size_t size = Object_Factory_Arena_Size(table, count, &strings);
+    size_t index_size;
+    char *data = NULL;
+    void *index;
+    unsigned created;
+    size_t i;
+
+    /* One arena for the strings of the table and those restored from
+       NVS, so every name, description and state text is read with one
+       copy of its encoded octets */
+    if (!override_nvs_on_flash) {
+        size += bacnet_nvs_restore_size(table, count, &restored);
+        strings += restored;
+    }
+    if (size > 0) {
+        data = malloc(size);
+        if (!data) {
+            ESP_LOGE(TAG, "No memory for %u octets of object strings", (unsigned)size);
+            return false;
+        }
+    }
+    string_arena_init(&bacnet_objects_arena, data, size);
+    /* The index that stores each string once is only needed until the
+       objects are restored; without it every string is still stored */
+    index_size = string_arena_index_size(strings);
+    index = malloc(index_size);
+    string_arena_index_set(&bacnet_objects_arena, index, index_size);
+    string_arena_shared_set(&bacnet_objects_arena);
+    created = Object_Factory_Create(table, count, &bacnet_objects_arena);
+    /* Restore persisted values from NVS (if any) - unless override flag is set */
+    if (!override_nvs_on_flash) {
+        bacnet_nvs_restore();
+    }
+    string_arena_index_set(&bacnet_objects_arena, NULL, 0);
+    free(index);
+    for (i = 0; i < sizeof(bacnet_objects_types) / sizeof(bacnet_objects_types[0]); i++) {
+        ESP_LOGI(TAG, "Created %u %s objects", Object_Factory_Count(table, count,
+            bacnet_objects_types[i].object_type), bacnet_objects_types[i].name);
+    }
+    if (created < count) {
+        ESP_LOGE(TAG, "Created %u of %u objects", created, (unsigned)count);
+    }
+    ESP_LOGI(TAG, "%u octets of object strings, %u strings, %u duplicates",
+        (unsigned)string_arena_used(&bacnet_objects_arena),
+        bacnet_objects_arena.strings, bacnet_objects_arena.duplicates);
+
+    return created == count;
+}
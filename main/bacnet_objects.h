@@ -0,0 +1,15 @@
+#ifndef BACNET_OBJECTS_H
+#define BACNET_OBJECTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "bacnet/basic/object/objfactory.h"
+
+/* Create every object of a descriptor table, then restore the persisted
+   properties from NVS unless override_nvs_on_flash is set. The names and
+   other strings of both are interned in one shared arena, sized from the
+   table and the snapshot, that ReadProperty encodes them from.
+   Call after bacnet_nvs_init(). */
+bool bacnet_objects_create(const BACNET_OBJECT_DESCRIPTOR *table, size_t count);
+
+#endif /* BACNET_OBJECTS_H */
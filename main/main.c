@@ -12,13 +12,12 @@
 #include "esp_netif.h"
 #include "wifi_helper.h"
 #include "display.h"
-#include "analog_value.h"
-#include "binary_value.h"
-#include "analog_input.h"
-#include "binary_input.h"
+#include "bacnet_objects.h"
 #include "binary_output.h"
 #include "pms5003.h"
 #include "mstp_rs485.h"
+#include "bacnet_nvs.h"
+#include "trendlog_flash.h"
 #include "User_Settings.h"
 
 /* bacnet-stack headers */
@@ -28,12 +27,14 @@
 #include "bacnet/basic/object/ai.h"
 #include "bacnet/basic/object/bi.h"
 #include "bacnet/basic/object/bo.h"
+#include "bacnet/basic/object/trendlog.h"
 #include "bacnet/basic/service/s_iam.h"
 #include "bacnet/basic/tsm/tsm.h"
 #include "bacnet/bacaddr.h"
 #include "bacnet/basic/bbmd/h_bbmd.h"
 #include "bacnet/datalink/datalink.h"
 #include "bacnet/datalink/bip.h"
+#include "bacnet/datalink/biptask.h"
 #include "bacnet/datalink/dlmstp.h"
 #include "bacnet/datalink/mstp.h"
 /* service handlers from bacnet-stack library */
@@ -44,14 +45,18 @@
 #include "bacnet/basic/service/h_whois.h"
 #include "bacnet/basic/service/h_iam.h"
 #include "bacnet/basic/service/h_cov.h"
+#include "bacnet/basic/service/h_rr.h"
 #include "bacnet/basic/service/s_whois.h"
 #include "bacnet/npdu.h"
 #include "bacnet/basic/npdu/h_npdu.h"
 #include "bacnet/bacenum.h"
 
 static const char *TAG = "bacnet";
+/* longest sleep of the MS/TP receive task; the datalink ends it sooner
+   at a byte, or at the next MS/TP timeout */
+#define MSTP_RECEIVE_TIMEOUT_MS 1000
 
-int override_nvs_on_flash = 0;  /* Exported for AV/BV modules */
+int override_nvs_on_flash = 0;  /* Exported for bacnet_objects.c */
 
 static void bacnet_register_with_bbmd(void);
 static void bacnet_receive_task(void *pvParameters);
@@ -59,7 +64,12 @@ static void bacnet_mstp_receive_task(void *pvParameters);
 static void bacnet_cov_task(void *pvParameters);
 static void pms5003_task(void *pvParameters);
 static TaskHandle_t bacnet_cov_task_handle = NULL;
-static SemaphoreHandle_t bacnet_datalink_mutex = NULL;
+/* object lock: any number of readers, or one writer */
+static SemaphoreHandle_t bacnet_object_mutex = NULL;
+static SemaphoreHandle_t bacnet_object_write = NULL;
+static unsigned bacnet_object_readers = 0;
+/* the MS/TP PDU queue takes one producer at a time */
+static SemaphoreHandle_t bacnet_mstp_send_mutex = NULL;
 static volatile uint32_t mstp_pdu_count = 0;
 static volatile uint32_t mstp_apdu_count = 0;
 static volatile uint32_t mstp_rp_total = 0;
@@ -85,8 +95,16 @@ static void bacnet_log_whois_iam(const uint8_t *apdu, int apdu_len, const char *
 static char datalink_bip[] = "bip";
 static char datalink_mstp[] = "mstp";
 static char *datalink_default = NULL;
+/* each receive task binds its own port, so replies go back out the link
+   the request came in on without switching the global datalink */
+static DATALINK_PORT bacnet_bip_port;
+static DATALINK_PORT bacnet_mstp_port;
+/* I-Am replies to Who-Is and the periodic I-Am of each port */
+static WHO_IS_RESPONDER bacnet_bip_who_is;
+static WHO_IS_RESPONDER bacnet_mstp_who_is;
 
 static uint8_t mstp_rx_buffer[512];
+static uint8_t mstp_rx_spare_buffer[sizeof(mstp_rx_buffer)];
 static uint8_t mstp_tx_buffer[512];
 static struct mstp_port_struct_t mstp_port;
 static struct dlmstp_user_data_t mstp_user;
@@ -98,27 +116,190 @@ static struct dlmstp_rs485_driver mstp_rs485_driver = {
     .baud_rate = MSTP_RS485_Baud_Rate,
     .baud_rate_set = MSTP_RS485_Baud_Rate_Set,
     .silence_milliseconds = MSTP_RS485_Silence_Milliseconds,
-    .silence_reset = MSTP_RS485_Silence_Reset
+    .silence_reset = MSTP_RS485_Silence_Reset,
+    .wait = MSTP_RS485_Wait,
+    .silence_microseconds = MSTP_RS485_Silence_Microseconds,
+    .wake = MSTP_RS485_Wake
 };
 
-static void bacnet_datalink_lock(char *name)
+static bool bacnet_object_lock_init(void)
 {
-    if (bacnet_datalink_mutex) {
-        xSemaphoreTake(bacnet_datalink_mutex, portMAX_DELAY);
+    bacnet_object_mutex = xSemaphoreCreateMutex();
+    /* binary: the last reader out may not be the task that took it */
+    bacnet_object_write = xSemaphoreCreateBinary();
+    if (!bacnet_object_mutex || !bacnet_object_write) {
+        return false;
     }
-    datalink_set(name);
+    xSemaphoreGive(bacnet_object_write);
+
+    return true;
 }
 
-static void bacnet_datalink_unlock(void)
+/* Object reads from the receive tasks - both links can read at once */
+static void bacnet_object_read_lock(void)
 {
-    if (datalink_default) {
-        datalink_set(datalink_default);
+    if (bacnet_object_mutex && bacnet_object_write) {
+        xSemaphoreTake(bacnet_object_mutex, portMAX_DELAY);
+        if (++bacnet_object_readers == 1) {
+            xSemaphoreTake(bacnet_object_write, portMAX_DELAY);
+        }
+        xSemaphoreGive(bacnet_object_mutex);
+    }
+}
+
+static void bacnet_object_read_unlock(void)
+{
+    if (bacnet_object_mutex && bacnet_object_write) {
+        xSemaphoreTake(bacnet_object_mutex, portMAX_DELAY);
+        if (--bacnet_object_readers == 0) {
+            xSemaphoreGive(bacnet_object_write);
+        }
+        xSemaphoreGive(bacnet_object_mutex);
+    }
+}
+
+/* Object writes, COV state and the TSM - one task at a time */
+static void bacnet_object_lock(void)
+{
+    if (bacnet_object_write) {
+        xSemaphoreTake(bacnet_object_write, portMAX_DELAY);
     }
-    if (bacnet_datalink_mutex) {
-        xSemaphoreGive(bacnet_datalink_mutex);
+}
+
+static void bacnet_object_unlock(void)
+{
+    if (bacnet_object_write) {
+        xSemaphoreGive(bacnet_object_write);
     }
 }
 
+/* Requests that only read objects and reply: ReadProperty and Who-Is.
+   ReadPropertyMultiple shares a scratch buffer in h_rpm.c, so it is
+   handled under the write lock with everything else, as is a
+   ReadProperty that accepts a segmented reply (SA bit): its reply is
+   encoded into a buffer of the TSM segment pool. */
+static bool bacnet_apdu_read_only(const uint8_t *apdu, uint16_t apdu_len)
+{
+    if (apdu_len < 2) {
+        return false;
+    }
+    switch (apdu[0] & 0xF0) {
+        case PDU_TYPE_CONFIRMED_SERVICE_REQUEST:
+            /* a segmented request (SEG bit) has two more header octets */
+            return (apdu_len >= 4) && !(apdu[0] & 0x0A) &&
+                (apdu[3] == SERVICE_CONFIRMED_READ_PROPERTY);
+        case PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST:
+            return apdu[1] == SERVICE_UNCONFIRMED_WHO_IS;
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static void bacnet_apdu_handler(
+    BACNET_ADDRESS *src, uint8_t *apdu, uint16_t apdu_len)
+{
+    if (bacnet_apdu_read_only(apdu, apdu_len)) {
+        bacnet_object_read_lock();
+        apdu_handler(src, apdu, apdu_len);
+        bacnet_object_read_unlock();
+    } else {
+        bacnet_object_lock();
+        apdu_handler(src, apdu, apdu_len);
+        bacnet_object_unlock();
+    }
+}
+
+static int bacnet_mstp_send_pdu(
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    int bytes_sent = 0;
+
+    if (bacnet_mstp_send_mutex) {
+        xSemaphoreTake(bacnet_mstp_send_mutex, portMAX_DELAY);
+    }
+    bytes_sent = dlmstp_send_pdu(dest, npdu_data, pdu, pdu_len);
+    if (bacnet_mstp_send_mutex) {
+        xSemaphoreGive(bacnet_mstp_send_mutex);
+    }
+
+    return bytes_sent;
+}
+
+/* Send I-Am on one port from a task that has no port of its own */
+static void bacnet_send_i_am(DATALINK_PORT *port)
+{
+    bacnet_object_lock();
+    datalink_port_bind(port);
+    Send_I_Am(Handler_Transmit_Buffer);
+    datalink_port_bind(NULL);
+    bacnet_object_unlock();
+}
+
+/* Who-Is: the I-Am is not sent here but scheduled by the responder of
+   the port, at a random time and at a limited rate, and sent by the COV
+   task - see bacnet_who_is_send() */
+static void bacnet_handler_who_is(
+    uint8_t *service_request, uint16_t service_len, BACNET_ADDRESS *src)
+{
+    WHO_IS_RESPONDER *responder = &bacnet_bip_who_is;
+
+    if (datalink_port_bound() == &bacnet_mstp_port) {
+        responder = &bacnet_mstp_who_is;
+    }
+    if (who_is_responder_request(
+            responder, Device_Object_Instance_Number(), service_request,
+            service_len, src) &&
+        bacnet_cov_task_handle) {
+        xTaskNotifyGive(bacnet_cov_task_handle);
+    }
+}
+
+/* Send what the Who-Is responder of a port has due. A reply to Who-Is
+   is sent even when DeviceCommunicationControl disables initiation. */
+static void bacnet_who_is_send(
+    DATALINK_PORT *port, WHO_IS_RESPONDER_EVENT event)
+{
+    if (event == WHO_IS_RESPONDER_REPLY) {
+        bacnet_object_lock();
+        datalink_port_bind(port);
+        Send_I_Am_Broadcast(Handler_Transmit_Buffer);
+        datalink_port_bind(NULL);
+        bacnet_object_unlock();
+    } else if (event == WHO_IS_RESPONDER_ANNOUNCE) {
+        bacnet_send_i_am(port);
+    }
+}
+
+/* Wake the COV task when an object has queued a change-of-value */
+static void bacnet_cov_wake(void)
+{
+    if (bacnet_cov_task_handle && handler_cov_pending()) {
+        xTaskNotifyGive(bacnet_cov_task_handle);
+    }
+}
+
+/* Trend Log 0 keeps the PM2.5 reading of AV1 every 2 seconds, for
+   ReadRange. It was created empty and disabled by Device_Init(). */
+static void bacnet_trend_log_init(void)
+{
+    BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE source = { 0 };
+
+    source.deviceIdentifier.type = OBJECT_DEVICE;
+    source.deviceIdentifier.instance = Device_Object_Instance_Number();
+    source.objectIdentifier.type = OBJECT_ANALOG_VALUE;
+    source.objectIdentifier.instance = 1;
+    source.propertyIdentifier = PROP_PRESENT_VALUE;
+    source.arrayIndex = BACNET_ARRAY_ALL;
+    Trend_Log_Source_Set(0, &source);
+    Trend_Log_Interval_Set(0, 2);
+    Trend_Log_Enable_Set(0, true);
+}
+
 static bool bacnet_mstp_init(void)
 {
     MSTP_RS485_Init();
@@ -130,6 +311,7 @@ static bool bacnet_mstp_init(void)
     mstp_port.UserData = &mstp_user;
     mstp_port.InputBuffer = mstp_rx_buffer;
     mstp_port.InputBufferSize = sizeof(mstp_rx_buffer);
+    mstp_user.Receive_Buffer_Spare = mstp_rx_spare_buffer;
     mstp_port.OutputBuffer = mstp_tx_buffer;
     mstp_port.OutputBufferSize = sizeof(mstp_tx_buffer);
 
@@ -139,44 +321,47 @@ static bool bacnet_mstp_init(void)
     dlmstp_set_max_master(USER_MSTP_MAX_MASTER);
     dlmstp_set_baud_rate(USER_MSTP_BAUD_RATE);
     dlmstp_slave_mode_enabled_set(false);
+    dlmstp_adaptive_poll_enabled_set(USER_MSTP_ADAPTIVE_POLL);
 
     return dlmstp_init((char *)&mstp_port);
 }
 
-/* BACnet receive task - processes incoming BACnet messages */
+/* Handle one NPDU taken off the B/IP socket by bip_receive_task() */
+static void bacnet_bip_npdu_handler(
+    BACNET_ADDRESS *src, uint8_t *npdu, uint16_t npdu_len, void *context)
+{
+    /* Save original source from UDP socket before NPDU decode modifies it */
+    BACNET_ADDRESS orig_src = *src;
+    BACNET_ADDRESS dest = {0};
+    BACNET_NPDU_DATA npdu_data = {0};
+    int apdu_offset = 0;
+
+    (void)context;
+    apdu_offset = bacnet_npdu_decode(npdu, npdu_len, &dest, src, &npdu_data);
+    /* If NPDU didn't have source routing info, restore from UDP socket */
+    if (src->len == 0) {
+        *src = orig_src;
+    }
+    if (apdu_offset > 0 && apdu_offset < (int)npdu_len) {
+        bacnet_log_whois_iam(&npdu[apdu_offset], npdu_len - apdu_offset, "bip");
+        bacnet_apdu_handler(src, &npdu[apdu_offset], npdu_len - apdu_offset);
+        bacnet_cov_wake();
+    }
+}
+
+/* BACnet receive task - processes incoming BACnet messages
+ * Blocks on the socket and handles every queued datagram per wakeup. */
 static void bacnet_receive_task(void *pvParameters)
 {
     (void)pvParameters;
-    BACNET_ADDRESS src = {0};
     static uint8_t rx_buffer[600];  /* Smaller buffer in DRAM */
-    uint16_t pdu_len = 0;
 
     ESP_LOGI(TAG, "BACnet receive task started");
-
-    while (1) {
-        /* Poll for incoming BACnet messages */
-        memset(&src, 0, sizeof(src));
-        pdu_len = bip_receive(&src, rx_buffer, sizeof(rx_buffer), 100);
-        if (pdu_len > 0) {
-            /* Save original source from UDP socket before NPDU decode modifies it */
-            BACNET_ADDRESS orig_src = src;
-            BACNET_ADDRESS dest = {0};
-            BACNET_NPDU_DATA npdu_data = {0};
-            int apdu_offset = bacnet_npdu_decode(
-                rx_buffer, pdu_len, &dest, &src, &npdu_data);
-            /* If NPDU didn't have source routing info, restore from UDP socket */
-            if (src.len == 0) {
-                src = orig_src;
-            }
-            if (apdu_offset > 0 && apdu_offset < (int)pdu_len) {
-                bacnet_log_whois_iam(&rx_buffer[apdu_offset], pdu_len - apdu_offset, "bip");
-                bacnet_datalink_lock(datalink_bip);
-                apdu_handler(&src, &rx_buffer[apdu_offset], pdu_len - apdu_offset);
-                bacnet_datalink_unlock();
-            }
-        }
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
+    datalink_port_bind(&bacnet_bip_port);
+    bip_receive_task(
+        rx_buffer, sizeof(rx_buffer), bacnet_bip_npdu_handler, NULL);
+    ESP_LOGW(TAG, "BACnet receive task stopped");
+    vTaskDelete(NULL);
 }
 
 /* BACnet MS/TP receive task - processes incoming MS/TP frames */
@@ -184,14 +369,19 @@ static void bacnet_mstp_receive_task(void *pvParameters)
 {
     (void)pvParameters;
     BACNET_ADDRESS src = {0};
-    static uint8_t rx_buffer[600];
+    uint8_t *rx_buffer = NULL;
     uint16_t pdu_len = 0;
 
     ESP_LOGI(TAG, "BACnet MS/TP receive task started");
+    datalink_port_bind(&bacnet_mstp_port);
 
     while (1) {
         memset(&src, 0, sizeof(src));
-        pdu_len = dlmstp_receive(&src, rx_buffer, sizeof(rx_buffer), 0);
+        /* sleeps on the UART events until a byte arrives, or the next
+           MS/TP timeout; the frame is lent by the datalink: decode it in
+           place */
+        pdu_len = dlmstp_receive_lend(
+            &src, &rx_buffer, MSTP_RECEIVE_TIMEOUT_MS);
         if (pdu_len > 0) {
             mstp_pdu_count++;
             BACNET_ADDRESS dest = {0};
@@ -213,16 +403,16 @@ static void bacnet_mstp_receive_task(void *pvParameters)
                     }
                 }
                 bacnet_log_whois_iam(&rx_buffer[apdu_offset], pdu_len - apdu_offset, "mstp");
-                bacnet_datalink_lock(datalink_mstp);
-                apdu_handler(&src, &rx_buffer[apdu_offset], pdu_len - apdu_offset);
-                bacnet_datalink_unlock();
+                bacnet_apdu_handler(
+                    &src, &rx_buffer[apdu_offset], pdu_len - apdu_offset);
+                bacnet_cov_wake();
             } else {
                 ESP_LOGW(TAG, "MS/TP RX frame decode failed: len=%u apdu_offset=%d src.len=%u src.mac=%u",
                     (unsigned)pdu_len, apdu_offset, (unsigned)src.len,
                     (unsigned)(src.len ? src.mac[0] : 0));
             }
+            dlmstp_receive_release();
         }
-        vTaskDelay(pdMS_TO_TICKS(1));
     }
 }
 
@@ -231,9 +421,12 @@ void app_main(void)
 {
     esp_err_t ret = nvs_flash_init();
 
-    bacnet_datalink_mutex = xSemaphoreCreateMutex();
-    if (!bacnet_datalink_mutex) {
-        ESP_LOGE(TAG, "Failed to create BACnet datalink mutex");
+    if (!bacnet_object_lock_init()) {
+        ESP_LOGE(TAG, "Failed to create BACnet object lock");
+    }
+    bacnet_mstp_send_mutex = xSemaphoreCreateMutex();
+    if (!bacnet_mstp_send_mutex) {
+        ESP_LOGE(TAG, "Failed to create BACnet MS/TP send mutex");
     }
     
     /* If OVERRIDE_NVS_ON_FLASH is set, always erase NVS to reset to code defaults */
@@ -254,6 +447,10 @@ void app_main(void)
     } else if (ret == ESP_OK) {
         ESP_LOGI(TAG, "NVS initialized from existing data");
     }
+    /* before the objects restore from NVS: reads the object snapshot */
+    if (!bacnet_nvs_init(bacnet_object_read_lock, bacnet_object_read_unlock)) {
+        ESP_LOGE(TAG, "Failed to start the NVS snapshot task");
+    }
 
     if (USER_ENABLE_BACNET_IP) {
         /* Initialize network stack (must be done before WiFi init) */
@@ -268,6 +465,7 @@ void app_main(void)
             ESP_LOGE(TAG, "Failed to initialize BACnet datalink");
             return;
         }
+        datalink_port_init(&bacnet_bip_port, datalink_bip);
 
         bacnet_register_with_bbmd();
     }
@@ -281,6 +479,8 @@ void app_main(void)
             if (!datalink_init((char *)&mstp_port)) {
                 ESP_LOGE(TAG, "Failed to initialize BACnet MS/TP datalink interface");
             }
+            datalink_port_init(&bacnet_mstp_port, datalink_mstp);
+            bacnet_mstp_port.send_pdu = bacnet_mstp_send_pdu;
         }
     }
 
@@ -301,7 +501,15 @@ void app_main(void)
     /* Register service handlers - using bacnet-stack library handlers */
     ESP_LOGI(TAG, "Registering BACnet service handlers");
     apdu_set_unconfirmed_handler(SERVICE_UNCONFIRMED_I_AM, handler_i_am_add);
-    apdu_set_unconfirmed_handler(SERVICE_UNCONFIRMED_WHO_IS, handler_who_is);
+    apdu_set_unconfirmed_handler(
+        SERVICE_UNCONFIRMED_WHO_IS, bacnet_handler_who_is);
+    who_is_responder_init(&bacnet_bip_who_is, USER_BACNET_DEVICE_INSTANCE);
+    who_is_responder_init(
+        &bacnet_mstp_who_is, USER_BACNET_DEVICE_INSTANCE + 1);
+    /* no periodic I-Am on B/IP: the BBMD and Who-Is cover it */
+    who_is_responder_announce_set(&bacnet_mstp_who_is,
+        USER_BACNET_IAM_INTERVAL_SECONDS * 1000UL,
+        USER_BACNET_IAM_INTERVAL_MAX_SECONDS * 1000UL);
     apdu_set_unrecognized_service_handler_handler(handler_unrecognized_service);
     /* Read Property - REQUIRED for BACnet devices */
     apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROPERTY, handler_read_property);
@@ -309,27 +517,26 @@ void app_main(void)
     apdu_set_confirmed_handler(SERVICE_CONFIRMED_WRITE_PROPERTY, handler_write_property);
     apdu_set_confirmed_handler(SERVICE_CONFIRMED_SUBSCRIBE_COV, handler_cov_subscribe);
     apdu_set_confirmed_handler(SERVICE_CONFIRMED_SUBSCRIBE_COV_PROPERTY, handler_cov_subscribe_property);
+    /* Read Range - the Log_Buffer of the Trend Log */
+    apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_RANGE, handler_read_range);
 
     /* Initialize COV subscription list */
     handler_cov_init();
 
-    /* Create BACnet objects (AV, BV, AI, BI, BO) */
-    bacnet_create_analog_values();
-    bacnet_create_binary_values();
-    bacnet_create_analog_inputs();
-    bacnet_create_binary_inputs();
-    bacnet_create_binary_outputs_with_gpio_sync();  /* Create BO with GPIO sync task */
+    /* Create BACnet objects (AV, BV, AI, BI, BO) from the object table */
+    bacnet_objects_create(USER_OBJECTS, USER_OBJECT_COUNT);
+    bacnet_binary_output_gpio_sync_start();  /* Drive PMS5003_SET from BO1 */
+    bacnet_trend_log_init();
+    trendlog_flash_init();  /* Restore and keep the Trend Log in flash */
 
     ESP_LOGI(TAG, "Broadcasting I-Am");
     if (USER_ENABLE_BACNET_IP) {
-        bacnet_datalink_lock(datalink_bip);
-        Send_I_Am(Handler_Transmit_Buffer);
-        bacnet_datalink_unlock();
+        bacnet_send_i_am(&bacnet_bip_port);
+        who_is_responder_sent(&bacnet_bip_who_is);
     }
     if (USER_ENABLE_BACNET_MSTP) {
-        bacnet_datalink_lock(datalink_mstp);
-        Send_I_Am(Handler_Transmit_Buffer);
-        bacnet_datalink_unlock();
+        bacnet_send_i_am(&bacnet_mstp_port);
+        who_is_responder_sent(&bacnet_mstp_who_is);
     }
 
     /* Initialize display */
@@ -360,19 +567,10 @@ void app_main(void)
 
     /* Keep the task alive - maintenance + display updates */
     uint32_t display_tick = 0;
-    uint32_t iam_tick = 0;
     uint32_t mstp_rx_tick = 0;
     while (1) {
         if (USER_ENABLE_BACNET_IP) {
-            bacnet_datalink_lock(datalink_bip);
-            datalink_maintenance_timer(1);
-            bacnet_datalink_unlock();
-        }
-
-        if (USER_ENABLE_BACNET_MSTP && ++iam_tick % 60 == 0) {
-            bacnet_datalink_lock(datalink_mstp);
-            Send_I_Am(Handler_Transmit_Buffer);
-            bacnet_datalink_unlock();
+            bacnet_bip_port.maintenance_timer(1);
         }
 
         if (USER_ENABLE_BACNET_MSTP && ++mstp_rx_tick % 30 == 0) {
@@ -401,18 +599,68 @@ void app_main(void)
     }
 }
 
-/* COV task - handles COV timer and notifications */
+/* COV task - handles COV timer and notifications, the segment
+ * timers of segmented replies, and the I-Am of the Who-Is responders
+ * Sleeps until an object queues a change-of-value (see bacnet_cov_wake),
+ * a Who-Is comes in, an I-Am is due, or one second passes for the
+ * subscription lifetimes. */
 static void bacnet_cov_task(void *pvParameters)
 {
     (void)pvParameters;
-    uint32_t tick = 0;
+    TickType_t last_tick = xTaskGetTickCount();
+    TickType_t now = 0;
+    uint32_t elapsed_ms = 0;
+    uint32_t delta_ms = 0;
+    uint32_t wait_ms = 1000;
+    WHO_IS_RESPONDER_EVENT bip_i_am = WHO_IS_RESPONDER_NONE;
+    WHO_IS_RESPONDER_EVENT mstp_i_am = WHO_IS_RESPONDER_NONE;
     while (1) {
-        bacnet_datalink_lock(datalink_bip);
-        handler_cov_timer_seconds(1);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+        now = xTaskGetTickCount();
+        delta_ms = pdTICKS_TO_MS(now - last_tick);
+        elapsed_ms += delta_ms;
+        last_tick = now;
+        /* this task is bound to no port: each notification goes out
+           on the port its subscription came in on, which
+           cov_send_request() in h_cov.c passes to
+           datalink_port_send_pdu().
+           The B/IP notifications of the pass are sent as one batch. */
+        bacnet_object_lock();
+        bip_send_batch_begin();
+        if (elapsed_ms >= 1000) {
+            handler_cov_timer_seconds(elapsed_ms / 1000);
+            /* devices learned from I-Am expire from the address cache */
+            address_cache_timer((uint16_t)(elapsed_ms / 1000));
+            /* the Trend Log of AV1 takes its sample when one is due */
+            trend_log_timer((uint16_t)(elapsed_ms / 1000));
+            elapsed_ms %= 1000;
+        }
         handler_cov_task();
-        bacnet_datalink_unlock();
-        tick++;
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        bip_send_batch_flush();
+        /* confirmed notifications that were not acknowledged in time
+           are sent again, and given up on after the last retry, and so
+           are the segments of a long reply, on the port each
+           transaction was sent on - h_cov.c gives it to
+           tsm_port_set_confirmed_unsegmented_transaction() */
+        tsm_timer_milliseconds(
+            (uint16_t)(delta_ms > UINT16_MAX ? UINT16_MAX : delta_ms));
+        /* the rx tasks take a Who-Is under the read lock only */
+        bip_i_am = who_is_responder_timer(&bacnet_bip_who_is, delta_ms);
+        mstp_i_am = who_is_responder_timer(&bacnet_mstp_who_is, delta_ms);
+        wait_ms = who_is_responder_next(&bacnet_bip_who_is);
+        if (who_is_responder_next(&bacnet_mstp_who_is) < wait_ms) {
+            wait_ms = who_is_responder_next(&bacnet_mstp_who_is);
+        }
+        bacnet_object_unlock();
+        if (USER_ENABLE_BACNET_IP) {
+            bacnet_who_is_send(&bacnet_bip_port, bip_i_am);
+        }
+        if (USER_ENABLE_BACNET_MSTP) {
+            bacnet_who_is_send(&bacnet_mstp_port, mstp_i_am);
+        }
+        if (wait_ms > 1000) {
+            wait_ms = 1000;
+        }
     }
 }
 
@@ -453,7 +701,9 @@ static void __attribute__((unused)) pms5003_task(void *pvParameters)
             // pms5003_print_data(&sensor_data);
             
             /* Write only PM2.5 atmospheric value to BACnet AV1 */
+            bacnet_object_lock();
             Analog_Value_Present_Value_Set(1, (float)sensor_data.pm2_5_atm, 16);
+            bacnet_object_unlock();
             // AV2 and AV3 are not used
             // Analog_Value_Present_Value_Set(2, (float)sensor_data.pm1_0_atm, 16);
             // Analog_Value_Present_Value_Set(3, (float)sensor_data.pm10_atm, 16);
@@ -464,11 +714,15 @@ static void __attribute__((unused)) pms5003_task(void *pvParameters)
         } else {
             // ESP_LOGW(TAG, "PMS5003 read failed - sensor disconnected or no data");
             /* Clear BACnet values to indicate no valid data */
+            bacnet_object_lock();
             Analog_Value_Present_Value_Set(1, -1.0f, 16);  // -1 indicates error/no sensor
+            bacnet_object_unlock();
             // Analog_Value_Present_Value_Set(2, -1.0f, 16);
             // Analog_Value_Present_Value_Set(3, -1.0f, 16);
         }
 
+        bacnet_cov_wake();
+
         /* Read sensor every 2 seconds for faster response */
         vTaskDelay(pdMS_TO_TICKS(2000));
     }
@@ -5,6 +5,8 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "bacnet/datalink/mstpburst.h"
 
 #define MSTP_UART_PORT UART_NUM_2
 #define MSTP_UART_TX_PIN GPIO_NUM_17
@@ -14,6 +16,11 @@
 #define MSTP_UART_RX_BUF_SIZE 512
 #define MSTP_UART_TX_BUF_SIZE 512
 #define MSTP_UART_TX_TIMEOUT_MS 1000
+#define MSTP_UART_EVENT_QUEUE_SIZE 20
+/* an RX timeout event after 2 idle symbols, well inside Tturnaround */
+#define MSTP_UART_RX_TIMEOUT_SYMBOLS 2
+/* an RX full event before the 128 byte hardware FIFO overflows */
+#define MSTP_UART_RX_FULL_THRESHOLD 100
 
 static const char *TAG = "mstp_rs485";
 static bool mstp_uart_initialized = false;
@@ -24,6 +31,13 @@ static volatile uint32_t mstp_rx_bytes = 0;
 static volatile uint32_t mstp_preamble_55 = 0;
 static volatile uint32_t mstp_preamble_55ff = 0;
 static uint8_t mstp_prev_byte = 0;
+static QueueHandle_t mstp_uart_queue = NULL;
+/* bursts from the UART events, consumed by the MS/TP receive FSM */
+static MSTP_BURST_BUFFER mstp_rx_bursts;
+/* arrival time of the burst of the last byte read, for the silence
+   timer reset that follows the read */
+static int64_t mstp_rx_burst_us = 0;
+static bool mstp_rx_burst_pending = false;
 
 static void mstp_rs485_set_tx_mode(bool enabled)
 {
@@ -72,10 +86,21 @@ void MSTP_RS485_Init(void)
     }
 
     err = uart_driver_install(
-        MSTP_UART_PORT, MSTP_UART_RX_BUF_SIZE, MSTP_UART_TX_BUF_SIZE, 0, NULL, 0);
+        MSTP_UART_PORT, MSTP_UART_RX_BUF_SIZE, MSTP_UART_TX_BUF_SIZE,
+        MSTP_UART_EVENT_QUEUE_SIZE, &mstp_uart_queue, 0);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "UART driver install failed: %d", err);
     }
+    err = uart_set_rx_timeout(MSTP_UART_PORT, MSTP_UART_RX_TIMEOUT_SYMBOLS);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "UART set RX timeout failed: %d", err);
+    }
+    err = uart_set_rx_full_threshold(
+        MSTP_UART_PORT, MSTP_UART_RX_FULL_THRESHOLD);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "UART set RX full threshold failed: %d", err);
+    }
+    MSTP_Burst_Init(&mstp_rx_bursts);
 
     mstp_last_activity_us = esp_timer_get_time();
     mstp_uart_initialized = true;
@@ -107,24 +132,120 @@ void MSTP_RS485_Send(const uint8_t *payload, uint16_t payload_len)
     }
 
     uart_wait_tx_done(MSTP_UART_PORT, pdMS_TO_TICKS(MSTP_UART_TX_TIMEOUT_MS));
+    /* the silence starts at the TX done edge, before the DE release */
+    mstp_last_activity_us = esp_timer_get_time();
     mstp_rs485_set_tx_mode(false);
     mstp_tx_in_progress = false;
-    mstp_last_activity_us = esp_timer_get_time();
+    mstp_rx_burst_pending = false;
 }
 
-bool MSTP_RS485_Read(uint8_t *buf)
+/* Microseconds that the UART takes to send or receive the symbols */
+static int64_t mstp_rs485_symbols_us(uint32_t symbols)
 {
-    if (!buf) {
-        return false;
+    /* 8N1: a start bit, 8 data bits and a stop bit per symbol */
+    return ((int64_t)symbols * 10LL * 1000000LL) / (int64_t)mstp_baud_rate;
+}
+
+/* Read the bytes buffered by the UART driver into the bursts, stamped
+   with the time the last of them was received */
+static void mstp_rs485_read_buffered(int64_t edge_us)
+{
+    uint32_t timestamp = (uint32_t)edge_us;
+    uint8_t *data;
+    size_t size = 0;
+    size_t length;
+    int len;
+
+    uart_get_buffered_data_len(MSTP_UART_PORT, &size);
+    while (size > 0) {
+        data = MSTP_Burst_Write_Buffer(&mstp_rx_bursts);
+        if (!data) {
+            /* the FSM is behind: leave the rest in the driver buffer
+               for the next event */
+            break;
+        }
+        length = size;
+        if (length > MSTP_BURST_SIZE) {
+            length = MSTP_BURST_SIZE;
+        }
+        len = uart_read_bytes(MSTP_UART_PORT, data, length, 0);
+        if (len <= 0) {
+            break;
+        }
+        MSTP_Burst_Write_Commit(&mstp_rx_bursts, (uint16_t)len, timestamp);
+        mstp_rx_bytes += (uint32_t)len;
+        size -= (size_t)len;
+    }
+}
+
+/* Handle the UART events, waiting up to ticks for the first */
+static void mstp_rs485_events(TickType_t ticks)
+{
+    uart_event_t event;
+    int64_t edge_us;
+
+    if (!mstp_uart_queue) {
+        return;
     }
+    while (xQueueReceive(mstp_uart_queue, &event, ticks) == pdTRUE) {
+        switch (event.type) {
+            case UART_DATA:
+                edge_us = esp_timer_get_time();
+                if (event.timeout_flag) {
+                    /* the RX timeout interrupt came a fixed number of
+                       idle symbols after the stop bit of the last byte */
+                    edge_us -=
+                        mstp_rs485_symbols_us(MSTP_UART_RX_TIMEOUT_SYMBOLS);
+                }
+                mstp_rs485_read_buffered(edge_us);
+                break;
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                /* frames are lost; the FSM will see a bad CRC or timeout */
+                uart_flush_input(MSTP_UART_PORT);
+                xQueueReset(mstp_uart_queue);
+                break;
+            default:
+                break;
+        }
+        /* take the rest of the queued events without waiting */
+        ticks = 0;
+    }
+}
+
+/* Fill the empty bursts, waiting up to ticks for a UART event */
+static void mstp_rs485_receive(TickType_t ticks)
+{
+    mstp_rs485_events(0);
+    if (MSTP_Burst_Empty(&mstp_rx_bursts)) {
+        /* bytes left behind when the bursts were full */
+        mstp_rs485_read_buffered(esp_timer_get_time());
+    }
+    if (MSTP_Burst_Empty(&mstp_rx_bursts) && (ticks > 0)) {
+        mstp_rs485_events(ticks);
+    }
+}
+
+bool MSTP_RS485_Read(uint8_t *buf)
+{
+    uint32_t timestamp = 0;
+    int64_t now_us;
+
     if (!mstp_uart_initialized) {
         MSTP_RS485_Init();
     }
-
-    int len = uart_read_bytes(MSTP_UART_PORT, buf, 1, 0);
-    if (len > 0) {
-        mstp_last_activity_us = esp_timer_get_time();
-        mstp_rx_bytes += (uint32_t)len;
+    if (MSTP_Burst_Empty(&mstp_rx_bursts)) {
+        mstp_rs485_receive(0);
+    }
+    if (!MSTP_Burst_Read(&mstp_rx_bursts, buf, &timestamp)) {
+        return false;
+    }
+    if (buf) {
+        /* the line went silent when the burst arrived, not now */
+        now_us = esp_timer_get_time();
+        mstp_rx_burst_us = now_us - (uint32_t)((uint32_t)now_us - timestamp);
+        mstp_rx_burst_pending = true;
+        mstp_last_activity_us = mstp_rx_burst_us;
         if (*buf == 0x55) {
             mstp_preamble_55++;
         }
@@ -132,10 +253,37 @@ bool MSTP_RS485_Read(uint8_t *buf)
             mstp_preamble_55ff++;
         }
         mstp_prev_byte = *buf;
-        return true;
     }
 
-    return false;
+    return true;
+}
+
+bool MSTP_RS485_Wait(uint32_t milliseconds)
+{
+    TickType_t ticks = pdMS_TO_TICKS(milliseconds);
+
+    if (!mstp_uart_initialized) {
+        MSTP_RS485_Init();
+    }
+    if (MSTP_Burst_Empty(&mstp_rx_bursts)) {
+        if (ticks == 0) {
+            ticks = 1;
+        }
+        mstp_rs485_receive(ticks);
+    }
+
+    return !MSTP_Burst_Empty(&mstp_rx_bursts);
+}
+
+/* End a wait from another task: an event that is not a UART one only
+   wakes the receive task */
+void MSTP_RS485_Wake(void)
+{
+    uart_event_t event = { .type = UART_EVENT_MAX };
+
+    if (mstp_uart_queue) {
+        (void)xQueueSend(mstp_uart_queue, &event, 0);
+    }
 }
 
 bool MSTP_RS485_Transmitting(void)
@@ -178,9 +326,29 @@ uint32_t MSTP_RS485_Silence_Milliseconds(void)
     return (uint32_t)(delta_us / 1000);
 }
 
+uint32_t MSTP_RS485_Silence_Microseconds(void)
+{
+    int64_t delta_us = esp_timer_get_time() - mstp_last_activity_us;
+
+    if (delta_us < 0) {
+        return 0;
+    }
+    if (delta_us > (int64_t)UINT32_MAX) {
+        return UINT32_MAX;
+    }
+
+    return (uint32_t)delta_us;
+}
+
 void MSTP_RS485_Silence_Reset(void)
 {
-    mstp_last_activity_us = esp_timer_get_time();
+    if (mstp_rx_burst_pending) {
+        /* the receive FSM resets the timer for each byte it reads */
+        mstp_last_activity_us = mstp_rx_burst_us;
+        mstp_rx_burst_pending = false;
+    } else {
+        mstp_last_activity_us = esp_timer_get_time();
+    }
 }
 
 uint32_t MSTP_RS485_Rx_Bytes_Get_Reset(void)
@@ -0,0 +1,80 @@
+#include "trendlog_flash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+
+/* bacnet-stack headers */
+#include "bacnet/basic/object/trendlog.h"
+#include "bacnet/basic/sys/flashlog.h"
+
+static const char *TAG = "trendlog_flash";
+static const esp_partition_t *trendlog_flash_partition = NULL;
+static esp_partition_mmap_handle_t trendlog_flash_mmap_handle;
+static FLASH_LOG_DRIVER trendlog_flash_driver;
+static FLASH_LOG trendlog_flash_log;
+
+static bool trendlog_flash_read(void *context, uint32_t address, void *data,
+    size_t length)
+{
+    return esp_partition_read(context, address, data, length) == ESP_OK;
+}
+
+static bool trendlog_flash_write(void *context, uint32_t address,
+    const void *data, size_t length)
+{
+    return esp_partition_write(context, address, data, length) == ESP_OK;
+}
+
+static bool trendlog_flash_erase(void *context, uint32_t address,
+    size_t length)
+{
+    return esp_partition_erase_range(context, address, length) == ESP_OK;
+}
+
+bool trendlog_flash_init(void)
+{
+    const void *mapped = NULL;
+    esp_err_t err;
+
+    trendlog_flash_partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+        TRENDLOG_FLASH_PARTITION);
+    if (!trendlog_flash_partition) {
+        ESP_LOGW(TAG, "No \"%s\" partition: Trend Logs are kept in RAM only",
+            TRENDLOG_FLASH_PARTITION);
+        return false;
+    }
+    trendlog_flash_driver.read = trendlog_flash_read;
+    trendlog_flash_driver.write = trendlog_flash_write;
+    trendlog_flash_driver.erase = trendlog_flash_erase;
+    trendlog_flash_driver.context = (void *)trendlog_flash_partition;
+    /* the restore reads the records in place through the flash cache;
+       without the mapping they are copied out instead */
+    err = esp_partition_mmap(trendlog_flash_partition, 0,
+        trendlog_flash_partition->size, ESP_PARTITION_MMAP_DATA, &mapped,
+        &trendlog_flash_mmap_handle);
+    if (err == ESP_OK) {
+        trendlog_flash_driver.mapped = mapped;
+    } else {
+        ESP_LOGW(TAG, "Partition not mapped: %s", esp_err_to_name(err));
+    }
+    if (!flash_log_init(&trendlog_flash_log, &trendlog_flash_driver,
+            trendlog_flash_partition->size, TRENDLOG_FLASH_SEGMENT_SIZE)) {
+        ESP_LOGE(TAG, "Partition of %lu octets is too small",
+            (unsigned long)trendlog_flash_partition->size);
+        return false;
+    }
+    if (!Trend_Log_Flash_Set(&trendlog_flash_log)) {
+        ESP_LOGE(TAG, "Segments of %u octets cannot hold a Trend Log block",
+            (unsigned)TRENDLOG_FLASH_SEGMENT_SIZE);
+        return false;
+    }
+    ESP_LOGI(TAG, "Trend Logs restored from %u of %u segments, erased %lu "
+        "times at most", (unsigned)flash_log_segments_used(&trendlog_flash_log),
+        (unsigned)trendlog_flash_log.segments,
+        (unsigned long)flash_log_erase_count(&trendlog_flash_log));
+
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef TRENDLOG_FLASH_H
+#define TRENDLOG_FLASH_H
+
+#include <stdbool.h>
+
+/* Label of the data partition that keeps the Trend Logs across resets */
+#ifndef TRENDLOG_FLASH_PARTITION
+#define TRENDLOG_FLASH_PARTITION "trendlog"
+#endif
+
+/* Octets of a segment of the flash log, a whole number of erase sectors */
+#ifndef TRENDLOG_FLASH_SEGMENT_SIZE
+#define TRENDLOG_FLASH_SEGMENT_SIZE 4096
+#endif
+
+/* Mount the flash log in the trendlog partition, restore the Trend Logs
+   from it and keep their sealed blocks there from then on. Call once the
+   Trend Logs are configured and before the task that runs their timer
+   starts. Without the partition the logs are kept in RAM only. */
+bool trendlog_flash_init(void);
+
+#endif